@@ -0,0 +1 @@
+#include "../../../src/hed/libs/communication/ClientPool.h"
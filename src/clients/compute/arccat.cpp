@@ -120,6 +120,7 @@ int RUNMAIN(arccat)(int argc, char **argv) {
   }
 
   Arc::JobSupervisor jobmaster(usercfg, jobs);
+  configureJobSupervisor(jobmaster, opt);
   jobmaster.Update();
   jobmaster.SelectValid();
   if (!opt.status.empty()) {
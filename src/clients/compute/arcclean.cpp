@@ -117,6 +117,7 @@ int RUNMAIN(arcclean)(int argc, char **argv) {
   }
 
   Arc::JobSupervisor jobmaster(usercfg, jobs);
+  configureJobSupervisor(jobmaster, opt);
   jobmaster.Update();
   jobmaster.SelectValid();
   if (!opt.status.empty()) {
@@ -131,6 +131,7 @@ int RUNMAIN(arcget)(int argc, char **argv) {
   }
 
   Arc::JobSupervisor jobmaster(usercfg, jobs);
+  configureJobSupervisor(jobmaster, opt);
 
   jobmaster.Update();
   jobmaster.SelectValid();
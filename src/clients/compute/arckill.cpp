@@ -116,6 +116,7 @@ int RUNMAIN(arckill)(int argc, char **argv) {
   }
 
   Arc::JobSupervisor jobmaster(usercfg, jobs);
+  configureJobSupervisor(jobmaster, opt);
   jobmaster.Update();
   jobmaster.SelectValid();
   if (!opt.status.empty()) {
@@ -112,6 +112,7 @@ int RUNMAIN(arcrenew)(int argc, char **argv) {
   }
 
   Arc::JobSupervisor jobmaster(usercfg, jobs);
+  configureJobSupervisor(jobmaster, opt);
   jobmaster.Update();
   jobmaster.SelectValid();
   if (!opt.status.empty()) {
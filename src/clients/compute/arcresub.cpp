@@ -126,6 +126,7 @@ int RUNMAIN(arcresub)(int argc, char **argv) {
   }
 
   Arc::JobSupervisor jobmaster(usercfg, jobs);
+  configureJobSupervisor(jobmaster, opt);
   jobmaster.Update();
   jobmaster.SelectValid();
   if (!opt.status.empty()) {
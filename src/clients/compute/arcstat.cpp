@@ -135,6 +135,7 @@ int RUNMAIN(arcstat)(int argc, char **argv) {
   }
 
   Arc::JobSupervisor jobmaster(usercfg, jobs);
+  configureJobSupervisor(jobmaster, opt);
   jobmaster.Update();
   unsigned int queried_num = jobmaster.GetAllJobs().size();
   if (!opt.status.empty()) {
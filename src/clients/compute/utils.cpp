@@ -427,7 +427,9 @@ ClientOptions::ClientOptions(Client_t c,
     show_unavailable(false),
     testjobid(-1),
     runtime(5),
-    timeout(-1)
+    timeout(-1),
+    parallel(-1),
+    endpoint_timeout(-1)
 {
   bool cIsJobMan = (c == CO_CAT || c == CO_CLEAN || c == CO_GET || c == CO_KILL || c == CO_RENEW || c == CO_RESUME || c == CO_STAT || c == CO_ACL);
 
@@ -679,6 +681,20 @@ ClientOptions::ClientOptions(Client_t c,
   }
   
 
+  if (cIsJobMan || c == CO_RESUB) {
+    GroupAddOption("tuning", 0, "parallel",
+              Arc::IString("number of computing elements contacted in parallel (default %u)",
+                           Arc::JobSupervisor::DefaultMaxParallel).str(),
+              istring("number"),
+              parallel);
+
+    GroupAddOption("tuning", 0, "endpoint-timeout",
+              istring("skip remaining jobs of a computing element after "
+                      "processing its jobs took this number of seconds"),
+              istring("seconds"),
+              endpoint_timeout);
+  }
+
   if (cIsJobMan || c == CO_MIGRATE || c == CO_RESUB) {
     GroupAddOption("tuning", 'i', "jobids-from-file",
               istring("a file containing a list of jobIDs"),
@@ -744,3 +760,27 @@ ClientOptions::ClientOptions(Client_t c,
             showversion);
 
 }
+
+// Reports results of every computing element as soon as they are known,
+// so that progress of operations on many jobs is visible.
+class EndpointProgress : public Arc::JobSupervisorListener {
+public:
+  virtual void EndpointDone(const std::string& endpoint,
+                            const std::list<std::string>& processed,
+                            const std::list<std::string>& notprocessed,
+                            double seconds) {
+    logger.msg(Arc::INFO, "Computing element %s: %u jobs processed, %u jobs not processed (%.1f seconds)",
+               endpoint, (unsigned int)processed.size(), (unsigned int)notprocessed.size(), seconds);
+  }
+private:
+  static Arc::Logger logger;
+};
+
+Arc::Logger EndpointProgress::logger(Arc::Logger::getRootLogger(), "JobSupervisor");
+
+void configureJobSupervisor(Arc::JobSupervisor& jobmaster, const ClientOptions& opt) {
+  static EndpointProgress progress;
+  if (opt.parallel > 0) jobmaster.SetMaxParallel(opt.parallel);
+  if (opt.endpoint_timeout > 0) jobmaster.SetEndpointTimeout(opt.endpoint_timeout);
+  jobmaster.SetListener(&progress);
+}
@@ -11,6 +11,7 @@
 #include <arc/compute/Job.h>
 #include <arc/compute/JobInformationStorage.h>
 #include <arc/compute/JobDescription.h>
+#include <arc/compute/JobSupervisor.h>
 
 struct termios;
 
@@ -172,6 +173,8 @@ public:
   int testjobid;
   int runtime;
   int timeout;
+  int parallel;
+  int endpoint_timeout;
 
   std::string show_file;
 
@@ -208,4 +211,12 @@ public:
   std::list<std::string> info_types;
 };
 
+/// Applies job management tuning options to JobSupervisor
+/**
+  Sets number of computing elements processed in parallel and time limit
+  for one computing element if given on command line. Also makes results
+  of every computing element be reported as soon as they are known.
+*/
+void configureJobSupervisor(Arc::JobSupervisor& jobmaster, const ClientOptions& opt);
+
 #endif // __ARC_CLEINT_COMPUTE_UTILS_H_
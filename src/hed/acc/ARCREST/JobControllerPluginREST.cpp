@@ -6,7 +6,11 @@
 
 #include <glib.h>
 
+#include <map>
+#include <vector>
+
 #include <arc/StringConv.h>
+#include <arc/Thread.h>
 #include <arc/UserConfig.h>
 #include <arc/XMLNode.h>
 #include <arc/compute/JobDescription.h>
@@ -16,6 +20,7 @@
 #include <arc/message/MCC.h>
 #include <arc/Utils.h>
 #include <arc/communication/ClientInterface.h>
+#include <arc/communication/ClientPool.h>
 #include <arc/delegation/DelegationInterface.h>
 
 #include "SubmitterPluginREST.h"
@@ -84,86 +89,78 @@ namespace Arc {
   void JobControllerPluginREST::UpdateJobs(std::list<Job*>& jobs, std::list<std::string>& IDsProcessed, std::list<std::string>& IDsNotProcessed, bool isGrouped) const {
     class JobStateProcessor: public InfoNodeProcessor {
      public:
-      JobStateProcessor(std::list<Job*>& jobs): jobs(jobs) {}
+      JobStateProcessor(std::map<std::string, Job*>& jobs): jobs(jobs) {}
 
       virtual void operator()(std::string const& id, XMLNode node, URL const& query_url) {
         std::string job_id = node["id"];
         std::string job_state = node["state"];
         if(!job_state.empty() && !job_id.empty()) {
-          for(std::list<Job*>::iterator itJob = jobs.begin(); itJob != jobs.end(); ++itJob) {
-            std::string id = (*itJob)->JobID;
-            std::string::size_type pos = id.rfind('/');
-            if(pos != std::string::npos) id.erase(0,pos+1);
-            if(job_id == id) {
-              (*itJob)->State = JobStateARCREST(job_state);
-              // (*itJob)->RestartState = ;
-              std::string baseUrl = query_url.ConnectionURL()+query_url.Path()+"/"+job_id;
-              (*itJob)->StageInDir = baseUrl;
-              (*itJob)->StageOutDir = baseUrl;
-              (*itJob)->SessionDir = baseUrl;
-              // (*itJob)->DelegationID.push_back ;
-              break;
-            }
+          std::map<std::string, Job*>::iterator itJob = jobs.find(id);
+          if(itJob != jobs.end()) {
+            itJob->second->State = JobStateARCREST(job_state);
+            // itJob->second->RestartState = ;
+            std::string baseUrl = query_url.ConnectionURL()+query_url.Path()+"/"+job_id;
+            itJob->second->StageInDir = baseUrl;
+            itJob->second->StageOutDir = baseUrl;
+            itJob->second->SessionDir = baseUrl;
+            // itJob->second->DelegationID.push_back ;
           }
         }
       }
 
      private:
-      std::list<Job*>& jobs;
+      std::map<std::string, Job*>& jobs;
     };
 
     class JobInfoProcessor: public InfoNodeProcessor {
      public:
-      JobInfoProcessor(std::list<Job*>& jobs): jobs(jobs) {}
+      JobInfoProcessor(std::map<std::string, Job*>& jobs): jobs(jobs) {}
 
       virtual void operator()(std::string const& id, XMLNode node, URL const& query_url) {
         std::string job_id = node["id"];
         XMLNode job_info = node["info_document"];
         if(job_info && !job_id.empty()) {
-          for(std::list<Job*>::iterator itJob = jobs.begin(); itJob != jobs.end(); ++itJob) {
-            std::string id = (*itJob)->JobID;
-            std::string::size_type pos = id.rfind('/');
-            if(pos != std::string::npos) id.erase(0,pos+1);
-            if(job_id == id) {
-              (*itJob)->SetFromXML(job_info["ComputingActivity"]);              
-              std::string baseUrl = query_url.ConnectionURL()+query_url.Path()+"/"+job_id;
-              (*itJob)->StageInDir = baseUrl;
-              (*itJob)->StageOutDir = baseUrl;
-              (*itJob)->SessionDir = baseUrl;
-              for(XMLNode state = job_info["ComputingActivity"]["State"]; (bool)state; ++state) {
-                std::string stateStr = state;
-                if(strncmp(stateStr.c_str(), "arcrest:", 8) == 0) {
-                  (*itJob)->State = JobStateARCREST(stateStr.substr(8));
-                  break;
-                }
+          std::map<std::string, Job*>::iterator itJob = jobs.find(id);
+          if(itJob != jobs.end()) {
+            Job& job = *(itJob->second);
+            job.SetFromXML(job_info["ComputingActivity"]);
+            std::string baseUrl = query_url.ConnectionURL()+query_url.Path()+"/"+job_id;
+            job.StageInDir = baseUrl;
+            job.StageOutDir = baseUrl;
+            job.SessionDir = baseUrl;
+            for(XMLNode state = job_info["ComputingActivity"]["State"]; (bool)state; ++state) {
+              std::string stateStr = state;
+              if(strncmp(stateStr.c_str(), "arcrest:", 8) == 0) {
+                job.State = JobStateARCREST(stateStr.substr(8));
+                break;
               }
-              break;
             }
           }
         }
       }
 
      private:
-      std::list<Job*>& jobs;
+      std::map<std::string, Job*>& jobs;
     };
 
-    JobInfoProcessor infoProcessor(jobs);
-    Arc::URL currentServiceUrl;
-    std::list<std::string> IDs;
+    // Responses are matched to jobs through their IDs and jobs are grouped
+    // per service even if they come interleaved.
+    std::map<std::string, Job*> jobsById;
+    std::list< std::pair<URL, std::list<std::string> > > services;
+    std::map< std::string, std::list<std::string>* > servicesByUrl;
     for (std::list<Job*>::const_iterator it = jobs.begin(); it != jobs.end(); ++it) {
-      if(!currentServiceUrl || (currentServiceUrl != GetAddressOfResource(**it))) {
-        if(!IDs.empty()) {
-          std::list<std::string> fakeIDs = IDs;
-          ProcessJobs(usercfg, currentServiceUrl, "info", 200, IDs, IDsProcessed, IDsNotProcessed, infoProcessor);
-        }
-        currentServiceUrl = GetAddressOfResource(**it);
+      jobsById[(*it)->JobID] = *it;
+      URL serviceUrl = GetAddressOfResource(**it);
+      std::map< std::string, std::list<std::string>* >::iterator service = servicesByUrl.find(serviceUrl.fullstr());
+      if(service == servicesByUrl.end()) {
+        services.push_back(std::make_pair(serviceUrl, std::list<std::string>()));
+        service = servicesByUrl.insert(std::make_pair(serviceUrl.fullstr(), &(services.back().second))).first;
       }
-
-      IDs.push_back((*it)->JobID);
+      service->second->push_back((*it)->JobID);
     }
-    if(!IDs.empty()) {
-      std::list<std::string> fakeIDs = IDs;
-      ProcessJobs(usercfg, currentServiceUrl, "info", 200, IDs, IDsProcessed, IDsNotProcessed, infoProcessor);
+    JobInfoProcessor infoProcessor(jobsById);
+    for (std::list< std::pair<URL, std::list<std::string> > >::iterator service = services.begin(); service != services.end(); ++service) {
+      ProcessJobs(usercfg, service->first, "info", 200, service->second, IDsProcessed, IDsNotProcessed, infoProcessor);
     }
   }
 
@@ -280,6 +277,72 @@ namespace Arc {
     return ok;
   }
 
+  // Portion of jobs sent to service in one request. Request is sent from
+  // separate thread so that next portion can travel to service while
+  // response to previous one is being parsed.
+  class ProcessJobsBatch {
+   public:
+    ProcessJobsBatch(ClientHTTP& client, const std::string& path): client(client), path(path), response(NULL), complete(false) {}
+    ~ProcessJobsBatch() { delete response; }
+
+    // Adds job at specified position of list of all jobs
+    void Add(std::list<std::string>::iterator position) {
+      std::string id(*position);
+      std::string::size_type pos = id.rfind('/');
+      if(pos != std::string::npos) id.erase(0,pos+1);
+      index.insert(std::make_pair(id, (unsigned int)positions.size()));
+      positions.push_back(position);
+      answered.push_back(false);
+      ids.push_back(id);
+    }
+
+    void Start() {
+      XMLNode jobs_id_list("<jobs/>");
+      for (std::list<std::string>::const_iterator it = ids.begin(); it != ids.end(); ++it) {
+        Arc::XMLNode job = jobs_id_list.NewChild("job");
+        job.NewChild("id") = *it;
+      }
+      std::string jobs_id_str;
+      jobs_id_list.GetXML(jobs_id_str);
+      request.Insert(jobs_id_str.c_str(),0,jobs_id_str.length());
+      if(!CreateThreadFunction(&Send, this, &sent)) Send(this);
+    }
+
+    void Wait() { sent.wait(); }
+
+    ClientHTTP& client;
+    std::string path;
+    std::list<std::string> ids;
+    std::vector<std::list<std::string>::iterator> positions;
+    std::vector<bool> answered;
+    std::multimap<std::string, unsigned int> index;
+    PayloadRaw request;
+    PayloadRawInterface* response;
+    HTTPClientInfo info;
+    MCC_Status res;
+    // Whole response was read from connection
+    bool complete;
+
+   private:
+    SimpleCounter sent;
+
+    static void Send(void* arg) {
+      ProcessJobsBatch& batch = *reinterpret_cast<ProcessJobsBatch*>(arg);
+      std::multimap<std::string,std::string> attributes;
+      attributes.insert(std::pair<std::string, std::string>("Accept", "text/xml"));
+      batch.res = batch.client.process(std::string("POST"), batch.path, attributes, &batch.request, &batch.info, &batch.response);
+      // Body of response is read from connection on demand. Read it now,
+      // before next batch is sent through same connection.
+      batch.complete = batch.res && batch.response && (batch.response->Content() != NULL);
+    }
+  };
+
+  unsigned int JobControllerPluginREST::BatchSize() {
+    unsigned int size = 0;
+    if(stringto(GetEnv("ARCREST_BATCH_SIZE"), size) && (size > 0)) return size;
+    return DefaultBatchSize;
+  }
+
   bool JobControllerPluginREST::ProcessJobs(const UserConfig* usercfg, Arc::URL const & resourceUrl, std::string const & action, int successCode,
           std::list<std::string>& IDs, std::list<std::string>& IDsProcessed, std::list<std::string>& IDsNotProcessed,
           InfoNodeProcessor& infoNodeProcessor) {
@@ -289,87 +352,95 @@ namespace Arc {
 
     Arc::MCCConfig cfg;
     usercfg->ApplyToConfig(cfg);
-    Arc::ClientHTTP client(cfg, statusUrl);
-    Arc::PayloadRaw request;
-    Arc::PayloadRawInterface* response(NULL);
-    Arc::HTTPClientInfo info;
-    {
-      XMLNode jobs_id_list("<jobs/>");
-      for (std::list<std::string>::const_iterator it = IDs.begin(); it != IDs.end(); ++it) {
-        std::string id(*it);
-        std::string::size_type pos = id.rfind('/');
-        if(pos != std::string::npos) id.erase(0,pos+1);
-        Arc::XMLNode job = jobs_id_list.NewChild("job");
-        job.NewChild("id") = id;
+    // All batches are sent one after another through same connection
+    // taken from connections shared by whole process.
+    Arc::ClientHTTPPool& pool = Arc::ClientHTTPPool::Instance();
+    Arc::ClientHTTP* client = pool.Acquire(cfg, statusUrl);
+    std::string path = statusUrl.FullPathURIEncoded();
+    unsigned int batchSize = BatchSize();
+    bool ok = true;
+    bool reusable = true;
+    std::list<std::string>::iterator next = IDs.begin();
+    ProcessJobsBatch* following = NULL;
+    if(next != IDs.end()) {
+      following = new ProcessJobsBatch(*client, path);
+      for(unsigned int n = 0; (n < batchSize) && (next != IDs.end()); ++n, ++next) following->Add(next);
+      following->Start();
+    }
+    while(following) {
+      ProcessJobsBatch* batch = following;
+      batch->Wait();
+      following = NULL;
+      // Connection with unread response can't be used by others
+      if(!batch->complete) reusable = false;
+      if(next != IDs.end()) {
+        following = new ProcessJobsBatch(*client, path);
+        for(unsigned int n = 0; (n < batchSize) && (next != IDs.end()); ++n, ++next) following->Add(next);
+        following->Start();
       }
-      std::string jobs_id_str;
-      jobs_id_list.GetXML(jobs_id_str);
-      request.Insert(jobs_id_str.c_str(),0,jobs_id_str.length());
+      if(!ProcessBatch(*batch, statusUrl, successCode, IDs, IDsProcessed, IDsNotProcessed, infoNodeProcessor)) ok = false;
+      delete batch;
     }
-    std::multimap<std::string,std::string> attributes;
-    attributes.insert(std::pair<std::string, std::string>("Accept", "text/xml"));
-    Arc::MCC_Status res = client.process(std::string("POST"), attributes, &request, &info, &response);
-    if((!res) || (info.code != 201)) {
-      logger.msg(WARNING, "Failed to process jobs - wrong response: %u", info.code);
-      if(response && response->Content()) logger.msg(DEBUG, "Content: %s", response->Content());
-      delete response; response = NULL;
-      for (std::list<std::string>::const_iterator it = IDs.begin(); it != IDs.end(); ++it) {
-        logger.msg(WARNING, "Failed to process job: %s", *it);
-        IDsNotProcessed.push_back(*it);
+    if(reusable) pool.Release(client); else pool.Discard(client);
+    return ok;
+  }
+
+  bool JobControllerPluginREST::ProcessBatch(ProcessJobsBatch& batch, Arc::URL const & statusUrl, int successCode,
+          std::list<std::string>& IDs, std::list<std::string>& IDsProcessed, std::list<std::string>& IDsNotProcessed,
+          InfoNodeProcessor& infoNodeProcessor) {
+    if((!batch.res) || (batch.info.code != 201)) {
+      logger.msg(WARNING, "Failed to process jobs - wrong response: %u", batch.info.code);
+      if(batch.response && batch.response->Content()) logger.msg(DEBUG, "Content: %s", batch.response->Content());
+      for (unsigned int n = 0; n < batch.positions.size(); ++n) {
+        logger.msg(WARNING, "Failed to process job: %s", *(batch.positions[n]));
+        IDsNotProcessed.push_back(*(batch.positions[n]));
       }
       return false;
     }
 
-    if(response->Content()) logger.msg(DEBUG, "Content: %s", response->Content());
-    Arc::XMLNode jobs_list(response->Content()?response->Content():"");
-    delete response; response = NULL;
+    if(batch.response->Content()) logger.msg(DEBUG, "Content: %s", batch.response->Content());
+    Arc::XMLNode jobs_list(batch.response->Content()?batch.response->Content():"");
+    delete batch.response; batch.response = NULL;
     if(!jobs_list || (jobs_list.Name() != "jobs")) {
       logger.msg(WARNING, "Failed to process jobs - failed to parse response");
-      for (std::list<std::string>::const_iterator it = IDs.begin(); it != IDs.end(); ++it) {
-        logger.msg(WARNING, "Failed to process job: %s", *it);
-        IDsNotProcessed.push_back(*it);
+      for (unsigned int n = 0; n < batch.positions.size(); ++n) {
+        logger.msg(WARNING, "Failed to process job: %s", *(batch.positions[n]));
+        IDsNotProcessed.push_back(*(batch.positions[n]));
       }
       return false;
     }
 
     bool ok = true;
-    Arc::XMLNode job_item = jobs_list["job"];
-    for (;; ++job_item) {
-      if(!job_item) { // no more jobs returned 
-        for (std::list<std::string>::const_iterator it = IDs.begin(); it != IDs.end(); ++it) {
-          logger.msg(WARNING, "No response returned: %s", *it);
-          IDsNotProcessed.push_back(*it);
-          ok = false;
-        }
-        break;
-      }
-
+    std::string successCodeStr = Arc::tostring(successCode);
+    for (Arc::XMLNode job_item = jobs_list["job"]; (bool)job_item; ++job_item) {
       std::string jcode = job_item["status-code"];
       std::string jreason = job_item["reason"];
       std::string jid = job_item["id"];
-      if(jid.empty()) {
-        // hmm
+      if(jid.empty()) continue;
+      // First not yet answered job with this ID
+      std::multimap<std::string, unsigned int>::iterator found = batch.index.lower_bound(jid);
+      if((found == batch.index.end()) || (found->first != jid)) continue;
+      unsigned int n = found->second;
+      batch.index.erase(found);
+      std::string const & id = *(batch.positions[n]);
+      if(jcode != successCodeStr) {
+        logger.msg(WARNING, "Failed to process job: %s - %s %s", jid, jcode, jreason);
+        IDsNotProcessed.push_back(id);
+        ok = false;
       } else {
-        std::list<std::string>::iterator it = IDs.begin();
-        for (; it != IDs.end(); ++it) {
-          std::string id(*it);
-          std::string::size_type pos = id.rfind('/');
-          if(pos != std::string::npos) id.erase(0,pos+1);
-          if (id == jid) break;
-        }
-        if(it == IDs.end()) {
-          // hmm again
-        } else {
-          if(jcode != Arc::tostring(successCode)) {
-            logger.msg(WARNING, "Failed to process job: %s - %s %s", jid, jcode, jreason);
-            IDsNotProcessed.push_back(*it);
-            ok = false;
-          } else {
-            IDsProcessed.push_back(*it);
-          }
-          infoNodeProcessor(*it, job_item, statusUrl);
-          IDs.erase(it);
-        }
+        IDsProcessed.push_back(id);
+      }
+      infoNodeProcessor(id, job_item, statusUrl);
+      batch.answered[n] = true;
+    }
+    // Answered jobs are removed from IDs, others are left there
+    for (unsigned int n = 0; n < batch.positions.size(); ++n) {
+      if(batch.answered[n]) {
+        IDs.erase(batch.positions[n]);
+      } else {
+        logger.msg(WARNING, "No response returned: %s", *(batch.positions[n]));
+        IDsNotProcessed.push_back(*(batch.positions[n]));
+        ok = false;
       }
     }
     return ok;
@@ -441,18 +512,22 @@ namespace Arc {
 
     Arc::MCCConfig cfg;
     usercfg->ApplyToConfig(cfg);
-    Arc::ClientHTTP client(cfg, statusUrl);
+    Arc::ClientHTTPPool& pool = Arc::ClientHTTPPool::Instance();
+    Arc::ClientHTTP* client = pool.Acquire(cfg, statusUrl);
     Arc::PayloadRaw request;
     Arc::PayloadRawInterface* response(NULL);
     Arc::HTTPClientInfo info;
-    Arc::MCC_Status res = client.process(std::string("GET"), &request, &info, &response);
-    if((!res) || (info.code != 200) || (response == NULL) || (response->Buffer(0) == NULL)) {
-      delete response;
+    Arc::MCC_Status res = client->process(std::string("GET"), statusUrl.FullPathURIEncoded(), &request, &info, &response);
+    // Body is read from connection on demand, so it must be taken before
+    // connection is passed to others. Connection with unread body is dropped.
+    bool ok = res && (info.code == 200) && response && (response->Buffer(0) != NULL);
+    if(ok) desc_str.assign(response->Buffer(0),response->BufferSize(0));
+    delete response;
+    if(ok) pool.Release(client); else pool.Discard(client);
+    if(!ok) {
       logger.msg(ERROR, "Failed retrieving job description for job: %s", job.JobID);
       return false;
     }
-    desc_str.assign(response->Buffer(0),response->BufferSize(0));
-    delete response;
     return true;
   }
 
@@ -7,6 +7,8 @@
 
 namespace Arc {
 
+  class ProcessJobsBatch;
+
   class JobControllerPluginREST : public JobControllerPlugin {
   public:
     JobControllerPluginREST(const UserConfig& usercfg, PluginArgument* parg) : JobControllerPlugin(usercfg, parg) { supportedInterfaces.push_back("org.nordugrid.arcrest"); }
@@ -37,11 +39,23 @@ namespace Arc {
       virtual void operator()(std::string const& job_id, XMLNode info_node) {};
     };
 
+    /// Performs action on jobs of one service.
+    /** Jobs are sent in batches of BatchSize() over same connection. Jobs
+       for which service replied are removed from IDs. */
     static bool ProcessJobs(const UserConfig* usercfg, Arc::URL const & resourceUrl, std::string const & action, int successCode,
           std::list<std::string>& IDs, std::list<std::string>& IDsProcessed, std::list<std::string>& IDsNotProcessed,
           InfoNodeProcessor& infoNodeProcessor);
 
+    /// Number of jobs sent in one request.
+    /** Can be changed with ARCREST_BATCH_SIZE environment variable. */
+    static unsigned int BatchSize();
+
+    static const unsigned int DefaultBatchSize = 1000;
+
   private:
+    static bool ProcessBatch(ProcessJobsBatch& batch, Arc::URL const & statusUrl, int successCode,
+          std::list<std::string>& IDs, std::list<std::string>& IDsProcessed, std::list<std::string>& IDsNotProcessed,
+          InfoNodeProcessor& infoNodeProcessor);
     static URL GetAddressOfResource(const Job& job);
     static Logger logger;
 
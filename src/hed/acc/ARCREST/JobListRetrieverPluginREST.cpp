@@ -4,6 +4,8 @@
 #include <config.h>
 #endif
 
+#include <map>
+
 #include <arc/StringConv.h>
 #include <arc/message/MCC.h>
 #include <arc/message/PayloadRaw.h>
@@ -51,7 +53,7 @@ namespace Arc {
     if(jobs_list.Name() != "jobs")
       return s;
     std::list<std::string> IDs;
-    std::list<Job*> idJobs;
+    std::map<std::string, Job*> idJobs;
     for(Arc::XMLNode job = jobs_list["job"]; (bool)job; ++job) {
       std::string id = job["id"];
       if(id.empty()) continue;
@@ -78,35 +80,30 @@ namespace Arc {
 
       jobs.push_back(j);
 
-      idJobs.push_back(&(jobs.back()));
+      idJobs[id] = &(jobs.back());
       IDs.push_back(id);
     }
 
     class JobDelegationsProcessor: public JobControllerPluginREST::InfoNodeProcessor {
      public:
-      JobDelegationsProcessor(std::list<Job*>& jobs): jobs(jobs) {}
+      JobDelegationsProcessor(std::map<std::string, Job*>& jobs): jobs(jobs) {}
 
       virtual void operator()(std::string const& id, XMLNode node) {
         std::string job_id = node["id"];
         XMLNode job_delegation_id = node["delegation_id"];
         if((bool)job_delegation_id && !job_id.empty()) {
-          for(std::list<Job*>::iterator itJob = jobs.begin(); itJob != jobs.end(); ++itJob) {
-            std::string id = (*itJob)->JobID;
-            std::string::size_type pos = id.rfind('/');
-            if(pos != std::string::npos) id.erase(0,pos+1);
-            if(job_id == id) {
-              while(job_delegation_id) {
-                (*itJob)->DelegationID.push_back((std::string)job_delegation_id);
-                ++job_delegation_id;
-              }
-              break;
+          std::map<std::string, Job*>::iterator itJob = jobs.find(id);
+          if(itJob != jobs.end()) {
+            while(job_delegation_id) {
+              itJob->second->DelegationID.push_back((std::string)job_delegation_id);
+              ++job_delegation_id;
             }
           }
         }
       }
 
      private:
-      std::list<Job*>& jobs;
+      std::map<std::string, Job*>& jobs;
     };
 
     std::list<std::string> processedIDs;
@@ -0,0 +1,163 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string>
+#include <list>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arc/StringConv.h>
+#include <arc/Thread.h>
+#include <arc/UserConfig.h>
+#include <arc/Utils.h>
+#include <arc/XMLNode.h>
+#include <arc/communication/ClientPool.h>
+
+#include "../JobControllerPluginREST.h"
+
+// Minimal HTTP server answering job management requests like A-REX REST
+// interface does. Response body is sent in pieces with delays so that
+// client has time to send following request before body is read.
+class RESTServer {
+ public:
+  RESTServer(): sock(-1), port(0), requests(0), connections(0) {
+    sock = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if ((::bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) || (::listen(sock, 4) != 0)) {
+      ::close(sock);
+      sock = -1;
+      return;
+    }
+    socklen_t addrlen = sizeof(addr);
+    ::getsockname(sock, (struct sockaddr*)&addr, &addrlen);
+    port = ntohs(addr.sin_port);
+    Arc::CreateThreadFunction(&serve, this, &done);
+  }
+  ~RESTServer() {
+    if (sock != -1) ::shutdown(sock, SHUT_RDWR);
+    done.wait();
+    if (sock != -1) ::close(sock);
+  }
+  int sock;
+  int port;
+  int requests;
+  int connections;
+  Arc::SimpleCounter done;
+
+ private:
+  static void serve(void* arg) {
+    RESTServer& it = *reinterpret_cast<RESTServer*>(arg);
+    for (;;) {
+      int h = ::accept(it.sock, NULL, NULL);
+      if (h == -1) return;
+      ++it.connections;
+      it.handle(h);
+      ::close(h);
+    }
+  }
+  void handle(int h) {
+    std::string buf;
+    for (;;) {
+      std::string::size_type hend;
+      while ((hend = buf.find("\r\n\r\n")) == std::string::npos) {
+        if (!read_more(h, buf)) return;
+      }
+      std::string header = Arc::lower(buf.substr(0, hend));
+      buf.erase(0, hend + 4);
+      std::string::size_type lpos = header.find("content-length:");
+      unsigned int length = 0;
+      if (lpos != std::string::npos) length = atoi(header.c_str() + lpos + 15);
+      while (buf.length() < length) {
+        if (!read_more(h, buf)) return;
+      }
+      Arc::XMLNode request(buf.substr(0, length));
+      buf.erase(0, length);
+      ++requests;
+      Arc::XMLNode response("<jobs/>");
+      for (Arc::XMLNode job = request["job"]; (bool)job; ++job) {
+        Arc::XMLNode item = response.NewChild("job");
+        item.NewChild("id") = (std::string)job["id"];
+        item.NewChild("status-code") = "202";
+        item.NewChild("reason") = "Queued for killing";
+      }
+      std::string body;
+      response.GetXML(body);
+      std::string head = "HTTP/1.1 201 Created\r\nContent-Type: text/xml\r\nContent-Length: " +
+                         Arc::tostring(body.length()) + "\r\n\r\n";
+      std::string::size_type half = body.length() / 2;
+      send_all(h, head);
+      ::usleep(200000);
+      send_all(h, body.substr(0, half));
+      ::usleep(200000);
+      send_all(h, body.substr(half));
+    }
+  }
+  static bool read_more(int h, std::string& buf) {
+    char tmp[1024];
+    ssize_t l = ::recv(h, tmp, sizeof(tmp), 0);
+    if (l <= 0) return false;
+    buf.append(tmp, l);
+    return true;
+  }
+  static void send_all(int h, const std::string& data) {
+    std::string::size_type pos = 0;
+    while (pos < data.length()) {
+      ssize_t l = ::send(h, data.c_str() + pos, data.length() - pos, 0);
+      if (l <= 0) return;
+      pos += l;
+    }
+  }
+};
+
+class JobControllerPluginRESTTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(JobControllerPluginRESTTest);
+  CPPUNIT_TEST(TestProcessJobsBatches);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void TestProcessJobsBatches();
+};
+
+void JobControllerPluginRESTTest::TestProcessJobsBatches() {
+  RESTServer server;
+  CPPUNIT_ASSERT(server.sock != -1);
+  Arc::SetEnv("ARCREST_BATCH_SIZE", "2");
+  CPPUNIT_ASSERT_EQUAL(2U, Arc::JobControllerPluginREST::BatchSize());
+
+  Arc::URL service("http://127.0.0.1:" + Arc::tostring(server.port) + "/arex");
+  std::list<std::string> IDs;
+  for (int n = 1; n <= 5; ++n) IDs.push_back(service.str() + "/rest/1.0/jobs/job" + Arc::tostring(n));
+  std::list<std::string> IDsProcessed;
+  std::list<std::string> IDsNotProcessed;
+  Arc::UserConfig usercfg(Arc::initializeCredentialsType(Arc::initializeCredentialsType::SkipCredentials));
+  Arc::JobControllerPluginREST::InfoNodeProcessor processor;
+
+  // 5 jobs in batches of 2 need 3 requests over same connection
+  CPPUNIT_ASSERT(Arc::JobControllerPluginREST::ProcessJobs(&usercfg, service, "kill", 202,
+                 IDs, IDsProcessed, IDsNotProcessed, processor));
+  CPPUNIT_ASSERT_EQUAL(3, server.requests);
+  CPPUNIT_ASSERT_EQUAL(1, server.connections);
+  CPPUNIT_ASSERT_EQUAL(5, (int)IDsProcessed.size());
+  CPPUNIT_ASSERT_EQUAL(0, (int)IDsNotProcessed.size());
+  CPPUNIT_ASSERT(IDs.empty());
+  // Pooled connections are closed so that server can finish
+  Arc::ClientHTTPPool::Instance().Clear();
+  Arc::UnsetEnv("ARCREST_BATCH_SIZE");
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(JobControllerPluginRESTTest);
@@ -7,6 +7,7 @@
 #include <stdexcept>
 
 #include <arc/communication/ClientInterface.h>
+#include <arc/communication/ClientPool.h>
 #include <arc/delegation/DelegationInterface.h>
 #include <arc/compute/Job.h>
 #include <arc/StringConv.h>
@@ -21,6 +22,25 @@
 #define DelegationProviderSOAP DelegationProviderSOAPTest
 #endif
 
+namespace Arc {
+
+  // SOAP connections are shared with other users in process
+#ifdef CPPUNITTEST
+  static ClientSOAP* AcquireSOAPClient(const MCCConfig& cfg, const URL& url, int timeout, bool) {
+    return new ClientSOAP(cfg, url, timeout);
+  }
+  static void ReleaseSOAPClient(ClientSOAP* client) { delete client; }
+  static void DiscardSOAPClient(ClientSOAP* client) { delete client; }
+#else
+  static ClientSOAP* AcquireSOAPClient(const MCCConfig& cfg, const URL& url, int timeout, bool reuse) {
+    return ClientHTTPPool::Instance().AcquireSOAP(cfg, url, timeout, reuse);
+  }
+  static void ReleaseSOAPClient(ClientSOAP* client) { ClientHTTPPool::Instance().Release(client); }
+  static void DiscardSOAPClient(ClientSOAP* client) { ClientHTTPPool::Instance().Discard(client); }
+#endif
+
+}
+
 static const std::string ES_TYPES_NPREFIX("estypes");
 static const std::string ES_TYPES_NAMESPACE("http://www.eu-emi.eu/es/2010/12/types");
 
@@ -80,14 +100,14 @@ namespace Arc {
 
     logger.msg(DEBUG, "Creating an EMI ES client");
 
-    client = new ClientSOAP(cfg, url, timeout);
+    client = AcquireSOAPClient(cfg, url, timeout, true);
     if (!client)
       logger.msg(VERBOSE, "Unable to create SOAP client used by EMIESClient.");
     set_namespaces(ns);
   }
 
   EMIESClient::~EMIESClient() {
-    if(client) delete client;
+    if(client) ReleaseSOAPClient(client);
   }
 
 
@@ -95,7 +115,7 @@ namespace Arc {
   std::string EMIESClient::delegation(const std::string& renew_id) {
     std::string id = dodelegation(renew_id);
     if(!id.empty()) return id;
-    delete client; client = NULL;
+    DiscardSOAPClient(client); client = NULL;
     if(!reconnect()) return id;
     return dodelegation(renew_id);
   }
@@ -159,9 +179,9 @@ namespace Arc {
   }
 
   bool EMIESClient::reconnect(void) { 
-    delete client; client = NULL; 
+    DiscardSOAPClient(client); client = NULL; 
     logger.msg(DEBUG, "Re-creating an EMI ES client");
-    client = new ClientSOAP(cfg, rurl, timeout);
+    client = AcquireSOAPClient(cfg, rurl, timeout, false);
     if (!client) {
       lfailure = "Unable to create SOAP client used by EMIESClient.";
       return false;
@@ -190,7 +210,7 @@ namespace Arc {
     if (!client->process(http_attr, &req, &resp)) {
       logger.msg(VERBOSE, "%s request failed", req.Child(0).FullName());
       lfailure = "Failed processing request";
-      delete client; client = NULL;
+      DiscardSOAPClient(client); client = NULL;
       if(!retry) return false; 
       if(!reconnect()) return false; 
       return process(req,response,false);
@@ -199,7 +219,7 @@ namespace Arc {
     if (resp == NULL) {
       logger.msg(VERBOSE, "No response from %s", rurl.str());
       lfailure = "No response received";
-      delete client; client = NULL;
+      DiscardSOAPClient(client); client = NULL;
       if(!retry) return false; 
       if(!reconnect()) return false; 
       return process(req,response,false);
@@ -224,7 +244,7 @@ namespace Arc {
         logger.msg(DEBUG, "XML response: %s", s);
       };
       delete resp;
-      delete client; client = NULL;
+      DiscardSOAPClient(client); client = NULL;
       if(!retry) return false; 
       if(!reconnect()) return false; 
       return process(req,response,false);
@@ -1530,18 +1550,23 @@ namespace Arc {
   }
 
   EMIESClient* EMIESClients::acquire(const URL& url) {
-    std::multimap<URL, EMIESClient*>::iterator it = clients_.find(url);
-    if ( it != clients_.end() ) {
-      // If EMIESClient is already existing for the
-      // given URL then return with that
-      EMIESClient* client = it->second;
-      clients_.erase(it);
-      return client;
+    const UserConfig* usercfg = NULL;
+    {
+      Glib::Mutex::Lock lock(lock_);
+      std::multimap<URL, EMIESClient*>::iterator it = clients_.find(url);
+      if ( it != clients_.end() ) {
+        // If EMIESClient is already existing for the
+        // given URL then return with that
+        EMIESClient* client = it->second;
+        clients_.erase(it);
+        return client;
+      }
+      usercfg = usercfg_;
     }
     // Else create a new one and return with that
     MCCConfig cfg;
-    if(usercfg_) usercfg_->ApplyToConfig(cfg);
-    EMIESClient* client = new EMIESClient(url, cfg, usercfg_?usercfg_->Timeout():0);
+    if(usercfg) usercfg->ApplyToConfig(cfg);
+    EMIESClient* client = new EMIESClient(url, cfg, usercfg?usercfg->Timeout():0);
     return client;
   }
 
@@ -1552,12 +1577,14 @@ namespace Arc {
       return;
     }
     // TODO: maybe strip path from URL?
+    Glib::Mutex::Lock lock(lock_);
     clients_.insert(std::pair<URL, EMIESClient*>(client->url(),client));
   }
 
   void EMIESClients::SetUserConfig(const UserConfig& uc) {
     // Changing user configuration may change identity.
     // Hence all open connections become invalid.
+    Glib::Mutex::Lock lock(lock_);
     usercfg_ = &uc;
     while(true) {
       std::multimap<URL, EMIESClient*>::iterator it = clients_.begin();
@@ -11,6 +11,7 @@
 #include <arc/message/MCC.h>
 #include <arc/UserConfig.h>
 #include <arc/message/SOAPEnvelope.h>
+#include <arc/Thread.h>
 /*
 #include <utility>
 
@@ -344,9 +345,11 @@ namespace Arc {
     static Logger logger;
   };
 
+  // Thread-safe: one JobControllerPlugin may serve several endpoints in parallel.
   class EMIESClients {
     std::multimap<URL, EMIESClient*> clients_;
     const UserConfig* usercfg_;
+    Glib::Mutex lock_;
   public:
     EMIESClients(const UserConfig& usercfg);
     ~EMIESClients(void);
@@ -13,6 +13,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
 
 #include <glibmm.h>
 
@@ -100,6 +103,11 @@ namespace ArcDMCFile {
     ((DataPointFile*)arg)->read_file();
   }
 
+  // Direct copying between descriptors is disabled with URL option direct=no
+  static bool direct_allowed(const URL& url) {
+    return (url.Option("direct") != "no");
+  }
+
   void DataPointFile::read_file() {
     bool limit_length = false;
     unsigned long long int range_length = 0;
@@ -120,6 +128,22 @@ namespace ArcDMCFile {
       if(fd != -1) lseek(fd, 0, SEEK_SET);
       if(fa) fa->fa_lseek(0, SEEK_SET);
     }
+    if ((fd != -1) && !is_channel && direct_allowed(url)) {
+      // Offer writing side to copy content of regular file by itself
+      struct stat st;
+      if ((::fstat(fd, &st) == 0) && S_ISREG(st.st_mode)) {
+        unsigned long long int size = 0;
+        if (limit_length) size = range_length;
+        else if ((unsigned long long int)st.st_size > offset) size = st.st_size - offset;
+        std::list<CheckSum*> no_checksums;
+        if (buffer->offer_direct(fd, offset, size, do_cksum ? checksums : no_checksums)) {
+          logger.msg(DEBUG, "Content of %s was copied directly", url.Path());
+          close(fd);
+          buffer->eof_read(true);
+          return;
+        }
+      }
+    }
     for (;;) {
       if (limit_length) if (range_length == 0) break;
       /* read from fd here and push to buffer */
@@ -237,11 +261,129 @@ namespace ArcDMCFile {
     }
   };
 
+  // Moves data between descriptors inside kernel. Returns amount of data
+  // moved, 0 at end of source or -1 with errno set. On failure caused by
+  // lack of support in kernel or file system used method is turned off.
+  static ssize_t copy_in_kernel(int src_fd, unsigned long long int offset,
+                                int dst_fd, bool seekable, size_t length,
+                                bool& use_copy_range, bool& use_sendfile) {
+#ifdef HAVE_COPY_FILE_RANGE
+    if (use_copy_range && seekable) {
+      loff_t src_off = offset;
+      loff_t dst_off = offset;
+      ssize_t l = copy_file_range(src_fd, &src_off, dst_fd, &dst_off, length, 0);
+      if (l >= 0) return l;
+      if ((errno != EXDEV) && (errno != ENOSYS) && (errno != EINVAL) &&
+          (errno != EOPNOTSUPP) && (errno != EBADF)) return -1;
+      use_copy_range = false;
+    }
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+    if (use_sendfile) {
+      if (seekable && (lseek(dst_fd, offset, SEEK_SET) != (off_t)offset)) return -1;
+      off_t src_off = offset;
+      ssize_t l = sendfile(dst_fd, src_fd, &src_off, length);
+      if (l >= 0) return l;
+      if ((errno != ENOSYS) && (errno != EINVAL)) return -1;
+    }
+#endif
+    use_copy_range = false;
+    use_sendfile = false;
+    errno = ENOSYS;
+    return -1;
+  }
+
+  // Copies data offered by reading side without passing it through
+  // buffers. If checksums need content it is read back in blocks of
+  // buffer size from source which is expected to be still in page cache.
+  bool DataPointFile::write_direct(int src_fd, unsigned long long int offset,
+                                   unsigned long long int size, bool& do_cksum,
+                                   unsigned long long int& cksum_p) {
+    bool need_data = do_cksum || buffer->checksum_required();
+    bool seekable = !is_channel;
+    bool use_copy_range = true;
+    bool use_sendfile = true;
+    const unsigned int chunk = buffer->buffer_size();
+    char* data = NULL;
+    bool result = true;
+    if (do_cksum && (offset != cksum_p)) do_cksum = false;
+    unsigned long long int pos = offset;
+    while (pos < offset + size) {
+      size_t l = chunk;
+      if (l > (offset + size - pos)) l = offset + size - pos;
+      ssize_t ll = -1;
+      if (use_copy_range || use_sendfile) {
+        ll = copy_in_kernel(src_fd, pos, fd, seekable, l, use_copy_range, use_sendfile);
+        if ((ll == -1) && (errno == ENOSYS)) continue; // no more kernel methods
+      } else {
+        // plain copying through memory
+        if (!data) data = (char*)malloc(chunk);
+        if (!data) { result = false; break; }
+        ll = ::pread(src_fd, data, l, pos);
+        if (ll > 0) {
+          if (seekable && (lseek(fd, pos, SEEK_SET) != (off_t)pos)) {
+            ll = -1;
+          } else {
+            for (ssize_t l_ = 0; l_ < ll; ) {
+              ssize_t lw = ::write(fd, data + l_, ll - l_);
+              if (lw == -1) { ll = -1; break; }
+              l_ += lw;
+            }
+          }
+        }
+      }
+      if (ll == -1) {
+        logger.msg(VERBOSE, "Failed to copy data directly to %s: %s", url.Path(), StrError(errno));
+        result = false;
+        break;
+      }
+      if (ll == 0) break; // source is shorter than expected
+      const char* content = NULL;
+      if (need_data) {
+        if (!data) data = (char*)malloc(chunk);
+        if (data && (use_copy_range || use_sendfile)) {
+          if (::pread(src_fd, data, ll, pos) != ll) need_data = false;
+        }
+        if (!data) need_data = false;
+        if (need_data) content = data;
+        else do_cksum = false;
+      }
+      if (do_cksum) {
+        for (std::list<CheckSum*>::iterator cksum = checksums.begin();
+                  cksum != checksums.end(); ++cksum) {
+          if (*cksum) (*cksum)->add(data, ll);
+        }
+        cksum_p = pos + ll;
+      }
+      pos += ll;
+      if (!buffer->is_direct(content, ll, pos - ll)) {
+        result = false;
+        break;
+      }
+    }
+    free(data);
+    buffer->done_direct();
+    return result;
+  }
+
   void DataPointFile::write_file() {
     unsigned long long int cksum_p = 0;
     bool do_cksum = (checksums.size() > 0);
     write_file_chunks cksum_chunks;
-    for (;;) {
+    int src_fd;
+    unsigned long long int src_offset;
+    unsigned long long int src_size;
+    bool direct = (fd != -1) && direct_allowed(url) &&
+                  buffer->take_direct(src_fd, src_offset, src_size);
+    if (direct) {
+      if (write_direct(src_fd, src_offset, src_size, do_cksum, cksum_p)) {
+        if (do_cksum) cksum_chunks.add(src_offset, cksum_p);
+      } else {
+        buffer->error_write(true);
+      }
+      buffer->eof_write(true);
+    }
+    for (;!direct;) {
       /* take from buffer and write to fd */
       /* 1. claim buffer */
       int h;
@@ -45,6 +45,9 @@ namespace ArcDMCFile {
     static void write_file_start(void* arg);
     void read_file();
     void write_file();
+    bool write_direct(int src_fd, unsigned long long int offset,
+                      unsigned long long int size, bool& do_cksum,
+                      unsigned long long int& cksum_p);
     bool reading;
     bool writing;
     int fd;
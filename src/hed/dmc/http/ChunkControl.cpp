@@ -0,0 +1,154 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#define __STDC_LIMIT_MACROS
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "ChunkControl.h"
+
+namespace ArcDMCHTTP {
+
+using namespace Arc;
+
+  ChunkControl::ChunkControl(uint64_t size) {
+    chunks_[0] = size;
+  }
+
+  ChunkControl::~ChunkControl() {}
+
+  bool ChunkControl::Get(uint64_t& start, uint64_t& length) {
+    if (length == 0) return false;
+    Glib::Mutex::Lock lock(lock_);
+    ranges_t::iterator c = chunks_.begin();
+    if (c == chunks_.end()) return false;
+    start = c->first;
+    uint64_t end = c->second;
+    chunks_.erase(c++);
+    if ((end - start) <= length) {
+      length = end - start;
+    } else {
+      chunks_.insert(c, std::make_pair(start + length, end));
+    }
+    return true;
+  }
+
+  void ChunkControl::Claim(uint64_t start, uint64_t length) {
+    if (length == 0) return;
+    uint64_t end = start + length;
+    Glib::Mutex::Lock lock(lock_);
+    ranges_t::iterator c = chunks_.upper_bound(start);
+    if (c != chunks_.begin()) {
+      // Range starting at or before claimed one
+      ranges_t::iterator p = c;
+      --p;
+      if (p->second > start) {
+        uint64_t p_end = p->second;
+        if (p->first < start) {
+          p->second = start;
+        } else {
+          chunks_.erase(p);
+        }
+        if (p_end > end) {
+          chunks_.insert(c, std::make_pair(end, p_end));
+          return;
+        }
+      }
+    }
+    // Ranges starting inside claimed one
+    while ((c != chunks_.end()) && (c->first < end)) {
+      uint64_t c_end = c->second;
+      chunks_.erase(c++);
+      if (c_end > end) {
+        chunks_.insert(c, std::make_pair(end, c_end));
+        break;
+      }
+    }
+  }
+
+  void ChunkControl::Claim(uint64_t start) {
+    Claim(start, UINT64_MAX - start);
+  }
+
+  void ChunkControl::Unclaim(uint64_t start, uint64_t length) {
+    if (length == 0) return;
+    uint64_t end = start + length;
+    Glib::Mutex::Lock lock(lock_);
+    ranges_t::iterator c = chunks_.upper_bound(start);
+    if (c != chunks_.begin()) {
+      ranges_t::iterator p = c;
+      --p;
+      if (p->second >= start) {
+        start = p->first;
+        if (p->second > end) end = p->second;
+        chunks_.erase(p);
+      }
+    }
+    while ((c != chunks_.end()) && (c->first <= end)) {
+      if (c->second > end) end = c->second;
+      chunks_.erase(c++);
+    }
+    chunks_.insert(c, std::make_pair(start, end));
+  }
+
+  bool ChunkControl::Done() {
+    Glib::Mutex::Lock lock(lock_);
+    return chunks_.empty();
+  }
+
+  StreamControl::StreamControl(int streams, int max_streams)
+    : streams_(streams),
+      max_streams_(max_streams),
+      ramping_(streams < max_streams),
+      best_rate_(0),
+      probe_bytes_(0),
+      probe_chunks_(0) {
+  }
+
+  StreamControl::~StreamControl() {}
+
+  bool StreamControl::Transferred(unsigned long long int total) {
+    Glib::Mutex::Lock lock(lock_);
+    if (!ramping_) return false;
+    ++probe_chunks_;
+    // Every stream must contribute to measurement
+    if (probe_chunks_ < streams_) return false;
+    Time now;
+    Period period = now - probe_start_;
+    double seconds = period.GetPeriod() + period.GetPeriodNanoseconds() / 1000000000.0;
+    if (seconds < probe_time) return false;
+    double rate = (total - probe_bytes_) / seconds;
+    probe_start_ = now;
+    probe_bytes_ = total;
+    probe_chunks_ = 0;
+    // Stop adding streams once it does not pay off by at least 10%
+    if ((best_rate_ > 0) && (rate < (best_rate_ * 1.1))) {
+      ramping_ = false;
+      return false;
+    }
+    if (rate > best_rate_) best_rate_ = rate;
+    if (streams_ >= max_streams_) {
+      ramping_ = false;
+      return false;
+    }
+    ++streams_;
+    return true;
+  }
+
+  uint64_t StreamControl::NextChunk(uint64_t length, double seconds) {
+    // Grow at most twice per request to avoid jumps caused by short
+    // requests served from cache.
+    uint64_t next = length * 2;
+    if ((seconds > 0) && ((length * chunk_time / seconds) < next)) {
+      next = (uint64_t)(length * chunk_time / seconds);
+    }
+    if (next < chunk_min) next = chunk_min;
+    if (next > chunk_max) next = chunk_max;
+    return next;
+  }
+
+} // namespace ArcDMCHTTP
@@ -0,0 +1,79 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifndef __ARCDMCHTTP_CHUNKCONTROL_H__
+#define __ARCDMCHTTP_CHUNKCONTROL_H__
+
+#include <map>
+#include <stdint.h>
+
+#include <arc/DateTime.h>
+#include <arc/Thread.h>
+
+namespace ArcDMCHTTP {
+
+using namespace Arc;
+
+class ChunkControl {
+private:
+  // Ranges not transferred yet, start -> end, ordered by start.
+  // Overlapping and adjacent ranges are always merged, so every
+  // range is found by a logarithmic lookup.
+  typedef std::map<uint64_t, uint64_t> ranges_t;
+  ranges_t chunks_;
+  Glib::Mutex lock_;
+public:
+  ChunkControl(uint64_t size = UINT64_MAX);
+  ~ChunkControl();
+  // Get chunk to be transferred. On input 'length'
+  // contains maximal acceptable chunk size.
+  bool Get(uint64_t& start, uint64_t& length);
+  // Report chunk transferred. It may be _different_
+  // from one obtained through Get().
+  void Claim(uint64_t start, uint64_t length);
+  // Report everything after start transferred (EOF).
+  void Claim(uint64_t start);
+  // Report chunk not transferred. It must be
+  // _same_ as one obtained by Get().
+  void Unclaim(uint64_t start, uint64_t length);
+  // True if there is nothing left to transfer
+  // apart of chunks obtained through Get().
+  bool Done();
+};
+
+// Chunk size is adjusted to make every request last about this long
+static const int chunk_time = 4;
+static const uint64_t chunk_min = 1024*1024;
+static const uint64_t chunk_max = 64*1024*1024;
+// Shortest period over which throughput is compared
+static const int probe_time = 2;
+
+// Decides how many streams are used. In adaptive mode transfer starts
+// with one stream and one more stream is added as long as the previous
+// addition increased overall throughput measured by DataSpeed.
+class StreamControl {
+private:
+  int streams_;
+  int max_streams_;
+  bool ramping_;
+  double best_rate_;
+  Time probe_start_;
+  unsigned long long int probe_bytes_;
+  int probe_chunks_;
+  Glib::Mutex lock_;
+public:
+  StreamControl(int streams, int max_streams);
+  ~StreamControl();
+  // Number of streams to start with.
+  int Streams() const { return streams_; };
+  // Report chunk transferred with total amount of data passed
+  // through buffer so far. Returns true if one more stream
+  // should be started.
+  bool Transferred(unsigned long long int total);
+  // Size of next chunk for stream which transferred 'length'
+  // bytes in 'seconds'.
+  static uint64_t NextChunk(uint64_t length, double seconds);
+};
+
+} // namespace ArcDMCHTTP
+
+#endif // __ARCDMCHTTP_CHUNKCONTROL_H__
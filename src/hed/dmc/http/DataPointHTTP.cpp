@@ -21,6 +21,7 @@
 #include <arc/Utils.h>
 
 #include "StreamBuffer.h"
+#include "ChunkControl.h"
 #include "DataPointHTTP.h"
 
 namespace ArcDMCHTTP {
@@ -37,29 +38,6 @@ using namespace Arc;
     DataPointHTTP *point;
   } HTTPInfo_t;
 
-  class ChunkControl {
-  private:
-    typedef struct {
-      uint64_t start;
-      uint64_t end;
-    } chunk_t;
-    std::list<chunk_t> chunks_;
-    Glib::Mutex lock_;
-  public:
-    ChunkControl(uint64_t size = UINT64_MAX);
-    ~ChunkControl();
-    // Get chunk to be transferred. On input 'length'
-    // contains maximal acceptable chunk size.
-    bool Get(uint64_t& start, uint64_t& length);
-    // Report chunk transferred. It may be _different_
-    // from one obtained through Get().
-    void Claim(uint64_t start, uint64_t length);
-    void Claim(uint64_t length);
-    // Report chunk not transferred. It must be
-    // _same_ as one obtained by Get().
-    void Unclaim(uint64_t start, uint64_t length);
-  };
-
   class PayloadMemConst
     : public PayloadRawInterface {
   private:
@@ -131,148 +109,12 @@ using namespace Arc;
     }
   };
 
-  ChunkControl::ChunkControl(uint64_t size) {
-    chunk_t chunk = {
-      0, size
-    };
-    chunks_.push_back(chunk);
-  }
-
-  ChunkControl::~ChunkControl() {}
-
-  bool ChunkControl::Get(uint64_t& start, uint64_t& length) {
-    if (length == 0) return false;
-    lock_.lock();
-    std::list<chunk_t>::iterator c = chunks_.begin();
-    if (c == chunks_.end()) {
-      lock_.unlock();
-      return false;
-    }
-    start = c->start;
-    uint64_t l = (c->end) - (c->start);
-    if (l <= length) {
-      length = l;
-      chunks_.erase(c);
-    } else {
-      c->start += length;
-    }
-    lock_.unlock();
-    return true;
-  }
-
-  void ChunkControl::Claim(uint64_t start, uint64_t length) {
-    if (length == 0) return;
-    uint64_t end = start + length;
-    lock_.lock();
-    for (std::list<chunk_t>::iterator c = chunks_.begin();
-         c != chunks_.end();) {
-      if (end <= c->start) break;
-      if ((start <= c->start) && (end >= c->end)) {
-        start = c->end;
-        length = end - start;
-        c = chunks_.erase(c);
-        if (length > 0) continue;
-        break;
-      }
-      if ((start > c->start) && (end < c->end)) {
-        chunk_t chunk;
-        chunk.start = c->start;
-        chunk.end = start;
-        c->start = end;
-        chunks_.insert(c, chunk);
-        break;
-      }
-      if ((start <= c->start) && (end < c->end) && (end > c->start)) {
-        c->start = end;
-        break;
-      }
-      if ((start > c->start) && (start < c->end) && (end >= c->end)) {
-        uint64_t start_ = c->end;
-        c->end = start;
-        start = start_;
-        length = end - start;
-        ++c;
-        if (length > 0) continue;
-        break;
-      }
-      ++c;
-    }
-    lock_.unlock();
-  }
-
-  void ChunkControl::Claim(uint64_t start) {
-    Claim(start, UINT64_MAX - start);
-  }
-
-  void ChunkControl::Unclaim(uint64_t start, uint64_t length) {
-    if (length == 0) return;
-    uint64_t end = start + length;
-    lock_.lock();
-    for (std::list<chunk_t>::iterator c = chunks_.begin();
-         c != chunks_.end(); ++c) {
-      if ((end >= c->start) && (end <= c->end)) {
-        if (start < c->start) c->start = start;
-        lock_.unlock();
-        return;
-      }
-      if ((start <= c->end) && (start >= c->start)) {
-        if (end > c->end) {
-          c->end = end;
-          std::list<chunk_t>::iterator c_ = c;
-          ++c_;
-          while (c_ != chunks_.end())
-            if (c->end >= c_->start) {
-              if (c_->end >= c->end) {
-                c->end = c_->end;
-                break;
-              }
-              c_ = chunks_.erase(c_);
-            }
-            else break;
-        }
-        lock_.unlock();
-        return;
-      }
-      if ((start <= c->start) && (end >= c->end)) {
-        c->start = start;
-        if (end > c->end) {
-          c->end = end;
-          std::list<chunk_t>::iterator c_ = c;
-          ++c_;
-          while (c_ != chunks_.end())
-            if (c->end >= c_->start) {
-              if (c_->end >= c->end) {
-                c->end = c_->end;
-                break;
-              }
-              c_ = chunks_.erase(c_);
-            }
-            else break;
-        }
-        lock_.unlock();
-        return;
-      }
-      if (end < c->start) {
-        chunk_t chunk = {
-          start, end
-        };
-        chunks_.insert(c, chunk);
-        lock_.unlock();
-        return;
-      }
-    }
-    chunk_t chunk = {
-      start, end
-    };
-    chunks_.push_back(chunk);
-    lock_.unlock();
-  }
-
   DataPointHTTP::DataPointHTTP(const URL& url, const UserConfig& usercfg, PluginArgument* parg)
     : DataPointDirect(url, usercfg, parg),
       reading(false),
       writing(false),
       chunks(NULL),
+      streams(NULL),
       transfers_tofinish(0),
       partial_read_allowed(url.Option("httpgetpartial") == "yes"),
       partial_write_allowed(url.Option("httpputpartial") == "yes") {
@@ -282,9 +124,7 @@ using namespace Arc;
     StopReading();
     StopWriting();
     if (chunks) delete chunks;
-    for(std::multimap<std::string,ClientHTTP*>::iterator cl = clients.begin(); cl != clients.end(); ++cl) {
-      delete cl->second;
-    };
+    if (streams) delete streams;
   }
 
   Plugin* DataPointHTTP::Instance(PluginArgument *arg) {
@@ -368,7 +208,7 @@ using namespace Arc;
       std::string path = rurl.FullPathURIEncoded();
       info.lastModified = (time_t)(-1);
       info.size = (uint64_t)(-1);
-      AutoPointer<ClientHTTP> client(acquire_client(rurl));
+      AutoPointer<ClientHTTP> client(acquire_client(rurl), &discard_client);
       if (!client) return DataStatus::StatError;
       // Do HEAD to obtain some metadata
       MCC_Status r = client->process("HEAD", path, &request, &info, &inbuf);
@@ -551,7 +391,7 @@ using namespace Arc;
     propattr.insert(std::pair<std::string, std::string>("Depth","0"));
     for(int redirects_max = 10;redirects_max>=0;--redirects_max) {
       std::string path = rurl.FullPathURIEncoded();
-      AutoPointer<ClientHTTP> client(acquire_client(rurl));
+      AutoPointer<ClientHTTP> client(acquire_client(rurl), &discard_client);
       if (!client) return DataStatus::StatError;
       PayloadRawInterface *inbuf = NULL;
       HTTPClientInfo info;
@@ -645,7 +485,7 @@ using namespace Arc;
     propattr.insert(std::pair<std::string, std::string>("Depth","1")); // for listing
     for(int redirects_max = 10;redirects_max>=0;--redirects_max) {
       std::string path = rurl.FullPathURIEncoded();
-      AutoPointer<ClientHTTP> client(acquire_client(rurl));
+      AutoPointer<ClientHTTP> client(acquire_client(rurl), &discard_client);
       if (!client) return DataStatus::StatError;
       PayloadRawInterface *inbuf = NULL;
       HTTPClientInfo info;
@@ -855,29 +695,50 @@ using namespace Arc;
     return DataStatus::Success;
   }
 
+  int DataPointHTTP::setup_streams(bool chunked) {
+    // Fixed number of streams may be requested with threads=N. Otherwise
+    // number of streams is adapted to measured throughput if the data
+    // can be transferred in chunks.
+    std::string threads = url.Option("threads");
+    int transfer_streams = 1;
+    int max_streams = 1;
+    if (threads.empty() || (threads == "auto")) {
+      if (chunked) max_streams = MAX_PARALLEL_STREAMS;
+    } else {
+      strtoint(threads,transfer_streams);
+      if (transfer_streams < 1) transfer_streams = 1;
+      if (transfer_streams > MAX_PARALLEL_STREAMS) transfer_streams = MAX_PARALLEL_STREAMS;
+      max_streams = transfer_streams;
+    }
+    if (chunks) delete chunks;
+    chunks = new ChunkControl;
+    if (streams) delete streams;
+    streams = new StreamControl(transfer_streams, max_streams);
+    return transfer_streams;
+  }
+
+  bool DataPointHTTP::start_thread(void (*func)(void*)) {
+    HTTPInfo_t *info = new HTTPInfo_t;
+    info->point = this;
+    if (!CreateThreadFunction(func, info, &transfers_started)) {
+      delete info;
+      return false;
+    }
+    ++transfers_tofinish;
+    return true;
+  }
+
   DataStatus DataPointHTTP::StartReading(DataBuffer& buffer) {
     if (reading) return DataStatus::IsReadingError;
     if (writing) return DataStatus::IsWritingError;
     if (transfers_started.get() != 0) return DataStatus(DataStatus::IsReadingError, EARCLOGIC);
     reading = true;
-    int transfer_streams = 1;
-    strtoint(url.Option("threads"),transfer_streams);
-    if (transfer_streams < 1) transfer_streams = 1;
-    if (transfer_streams > MAX_PARALLEL_STREAMS) transfer_streams = MAX_PARALLEL_STREAMS;
     DataPointHTTP::buffer = &buffer;
-    if (chunks) delete chunks;
-    chunks = new ChunkControl;
+    int transfer_streams = setup_streams(partial_read_allowed && allow_out_of_order);
     transfer_lock.lock();
     transfers_tofinish = 0;
-    for (int n = 0; n < transfer_streams; ++n) {
-      HTTPInfo_t *info = new HTTPInfo_t;
-      info->point = this;
-      if (!CreateThreadFunction(&read_thread, info, &transfers_started)) {
-        delete info;
-      } else {
-        ++transfers_tofinish;
-      }
-    }
+    stream_failure_code = DataStatus::Success;
+    for (int n = 0; n < transfer_streams; ++n) start_thread(&read_thread);
     if (transfers_tofinish == 0) {
       transfer_lock.unlock();
       StopReading();
@@ -897,6 +758,8 @@ using namespace Arc;
     }
     if (chunks) delete chunks;
     chunks = NULL;
+    if (streams) delete streams;
+    streams = NULL;
     transfers_tofinish = 0;
     if (buffer->error_read()) {
       buffer = NULL;
@@ -912,24 +775,11 @@ using namespace Arc;
     if (writing) return DataStatus::IsWritingError;
     if (transfers_started.get() != 0) return DataStatus(DataStatus::IsWritingError, EARCLOGIC);
     writing = true;
-    int transfer_streams = 1;
-    strtoint(url.Option("threads"),transfer_streams);
-    if (transfer_streams < 1) transfer_streams = 1;
-    if (transfer_streams > MAX_PARALLEL_STREAMS) transfer_streams = MAX_PARALLEL_STREAMS;
     DataPointHTTP::buffer = &buffer;
-    if (chunks) delete chunks;
-    chunks = new ChunkControl;
+    int transfer_streams = setup_streams(partial_write_allowed);
     transfer_lock.lock();
     transfers_tofinish = 0;
-    for (int n = 0; n < transfer_streams; ++n) {
-      HTTPInfo_t *info = new HTTPInfo_t;
-      info->point = this;
-      if (!CreateThreadFunction(&write_thread, info, &transfers_started)) {
-        delete info;
-      } else {
-        ++transfers_tofinish;
-      }
-    }
+    for (int n = 0; n < transfer_streams; ++n) start_thread(&write_thread);
     if (transfers_tofinish == 0) {
       transfer_lock.unlock();
       StopWriting();
@@ -951,6 +801,8 @@ using namespace Arc;
       delete chunks;
     }
     chunks = NULL;
+    if (streams) delete streams;
+    streams = NULL;
     transfers_tofinish = 0;
     if (buffer->error_write()) {
       buffer = NULL;
@@ -995,7 +847,7 @@ using namespace Arc;
     PayloadRaw request;
     PayloadRawInterface *inbuf = NULL;
     HTTPClientInfo info;
-    AutoPointer<ClientHTTP> client(acquire_client(url));
+    AutoPointer<ClientHTTP> client(acquire_client(url), &discard_client);
     if (!client) return DataStatus::CheckError;
     MCC_Status r = client->process("GET", url.FullPathURIEncoded(), 0, 15,
                                   &request, &info, &inbuf);
@@ -1024,7 +876,7 @@ using namespace Arc;
   }
 
   DataStatus DataPointHTTP::Remove() {
-    AutoPointer<ClientHTTP> client(acquire_client(url));
+    AutoPointer<ClientHTTP> client(acquire_client(url), &discard_client);
     PayloadRaw request;
     PayloadRawInterface *inbuf = NULL;
     HTTPClientInfo info;
@@ -1046,7 +898,7 @@ using namespace Arc;
   }
 
   DataStatus DataPointHTTP::Rename(const URL& destination) {
-    AutoPointer<ClientHTTP> client(acquire_client(url));
+    AutoPointer<ClientHTTP> client(acquire_client(url), &discard_client);
     PayloadRaw request;
     PayloadRawInterface *inbuf = NULL;
     HTTPClientInfo info;
@@ -1073,7 +925,7 @@ using namespace Arc;
     HTTPInfo_t& info = *((HTTPInfo_t*)arg);
     DataPointHTTP& point = *(info.point);
     URL client_url = point.url;
-    AutoPointer<ClientHTTP> client(point.acquire_client(client_url));
+    AutoPointer<ClientHTTP> client(point.acquire_client(client_url), &discard_client);
     bool transfer_failure = false;
     int retries = 0;
     std::string path = point.CurrentLocation().FullPathURIEncoded();
@@ -1186,12 +1038,15 @@ using namespace Arc;
     point.transfer_lock.lock();
     point.transfer_lock.unlock();
     URL client_url = point.url;
-    AutoPointer<ClientHTTP> client(point.acquire_client(client_url));
+    AutoPointer<ClientHTTP> client(point.acquire_client(client_url), &discard_client);
     bool transfer_failure = false;
     int retries = 0;
     std::string path = point.CurrentLocation().FullPathURIEncoded();
     DataStatus failure_code;
+    // Failure after which remaining chunks may be taken over by other streams
+    bool stream_failure = false;
     bool partial_allowed = point.partial_read_allowed && point.allow_out_of_order;
+    uint64_t chunk_size = chunk_min;
     if(partial_allowed) for (;;) {
       if(client && client->GetClosed()) client = point.acquire_client(client_url);
       if (!client) {
@@ -1206,7 +1061,7 @@ using namespace Arc;
         break;
       }
       uint64_t transfer_offset = 0;
-      uint64_t chunk_length = 1024*1024;
+      uint64_t chunk_length = chunk_size;
       if(transfer_size > chunk_length) chunk_length = transfer_size;
       if (!(point.chunks->Get(transfer_offset, chunk_length))) {
         // No more chunks to transfer - quit this thread.
@@ -1218,6 +1073,7 @@ using namespace Arc;
       HTTPClientInfo transfer_info;
       PayloadRaw request;
       PayloadRawInterface *inbuf = NULL;
+      Time chunk_start;
       MCC_Status r = client->process("GET", path, transfer_offset,
                                      transfer_end, &request, &transfer_info,
                                      &inbuf);
@@ -1232,6 +1088,7 @@ using namespace Arc;
         // TODO: mark failure?
         if ((++retries) > 10) {
           transfer_failure = true;
+          stream_failure = true;
           failure_code = DataStatus(DataStatus::ReadError, r.getExplanation());
           break;
         }
@@ -1239,11 +1096,12 @@ using namespace Arc;
         client = point.acquire_new_client(client_url);
         if(client) continue;
         transfer_failure = true;
+        stream_failure = true;
         break;
       }
       if (transfer_info.code == 416) { // EOF
         point.buffer->is_read(transfer_handle, 0, 0);
-        point.chunks->Unclaim(transfer_offset, chunk_length);
+        point.chunks->Claim(transfer_offset);
         if (inbuf) delete inbuf;
         break;
       }
@@ -1300,15 +1158,16 @@ using namespace Arc;
       // pick up useful information from HTTP header
       point.modified = transfer_info.lastModified;
       retries = 0;
-      // Exclude chunks after EOF. Normally that is not needed.
-      // But Apache if asked about out of file range gets confused
-      // and sends *whole* file instead of 416.
-      if(inbuf && (inbuf->Size() > 0)) point.chunks->Claim(inbuf->Size());
+      bool size_known = (inbuf && (inbuf->Size() > 0));
       bool whole = (inbuf && (((transfer_info.size == inbuf->Size() &&
                                (inbuf->BufferPos(0) == 0))) ||
                     inbuf->Size() == -1));
       point.transfer_lock.lock();
       point.chunks->Unclaim(transfer_offset, chunk_length);
+      // Exclude chunks after EOF. Normally that is not needed.
+      // But Apache if asked about out of file range gets confused
+      // and sends *whole* file instead of 416.
+      if(size_known) point.chunks->Claim(inbuf->Size());
       uint64_t transfer_pos = 0;
       for(;;) {
         if (transfer_handle == -1) {
@@ -1335,15 +1194,39 @@ using namespace Arc;
       if (inbuf) delete inbuf;
       // If server returned chunk which is not overlaping requested one - seems
       // like server has nothing to say any more.
-      if (transfer_pos <= transfer_offset) whole = true;
+      if (transfer_pos <= transfer_offset) {
+        whole = true;
+        point.chunks->Claim(transfer_offset);
+      } else if (whole && !size_known) {
+        // Content of unknown size ends where server stopped sending
+        point.chunks->Claim(transfer_pos);
+      }
+      if ((!whole) && (transfer_pos >= (transfer_offset + chunk_length))) {
+        // Complete chunk - adapt to measured throughput
+        Period period = Time() - chunk_start;
+        chunk_size = StreamControl::NextChunk(chunk_length,
+                       period.GetPeriod() + period.GetPeriodNanoseconds() / 1000000000.0);
+        if (point.streams->Transferred(point.buffer->speed.transferred_size())) {
+          if (point.start_thread(&read_thread)) {
+            logger.msg(VERBOSE, "Throughput is increasing - using %i streams", point.transfers_tofinish);
+          }
+        }
+      }
       point.transfer_lock.unlock();
       if (whole) break;
     }
     point.transfer_lock.lock();
     --(point.transfers_tofinish);
     if (transfer_failure) {
-      point.failure_code = failure_code;
-      point.buffer->error_read(true);
+      if (stream_failure && (point.transfers_tofinish > 0)) {
+        // Chunk was returned and will be picked up by remaining streams.
+        // Reason is kept in case the transfer fails as a whole later.
+        point.stream_failure_code = failure_code;
+        logger.msg(VERBOSE, "Stream failed - transfer continues in %i streams", point.transfers_tofinish);
+      } else {
+        point.failure_code = failure_code;
+        point.buffer->error_read(true);
+      }
     }
     if (point.transfers_tofinish == 0) {
       // TODO: process/report failure?
@@ -1353,6 +1236,14 @@ using namespace Arc;
           transfer_failure = true;
           point.buffer->error_read(true);
         }
+      } else if (!point.buffer->error_read() && !point.chunks->Done()) {
+        // Last stream is gone while some ranges are still missing
+        if (!point.stream_failure_code.Passed()) {
+          point.failure_code = point.stream_failure_code;
+        } else {
+          point.failure_code = DataStatus(DataStatus::ReadError, "Not all data was transferred");
+        }
+        point.buffer->error_read(true);
       }
       point.buffer->eof_read(true);
     }
@@ -1365,7 +1256,7 @@ using namespace Arc;
     HTTPInfo_t& info = *((HTTPInfo_t*)arg);
     DataPointHTTP& point = *(info.point);
     URL client_url = point.url;
-    AutoPointer<ClientHTTP> client(point.acquire_client(client_url));
+    AutoPointer<ClientHTTP> client(point.acquire_client(client_url), &discard_client);
     if (!client) return false;
     std::string path = client_url.FullPathURIEncoded();
     // TODO: Do ping to *client in order to check if connection is alive.
@@ -1478,7 +1369,7 @@ using namespace Arc;
     point.transfer_lock.lock();
     point.transfer_lock.unlock();
     URL client_url = point.url;
-    AutoPointer<ClientHTTP> client(point.acquire_client(client_url));
+    AutoPointer<ClientHTTP> client(point.acquire_client(client_url), &discard_client);
     bool transfer_failure = false;
     int retries = 0;
     std::string path = client_url.FullPathURIEncoded();
@@ -1548,6 +1439,13 @@ using namespace Arc;
       }
       retries = 0;
       point.buffer->is_written(transfer_handle);
+      if (point.streams->Transferred(point.buffer->speed.transferred_size())) {
+        point.transfer_lock.lock();
+        if (point.start_thread(&write_thread)) {
+          logger.msg(VERBOSE, "Throughput is increasing - using %i streams", point.transfers_tofinish);
+        }
+        point.transfer_lock.unlock();
+      }
     }
     point.transfer_lock.lock();
     --(point.transfers_tofinish);
@@ -1612,7 +1510,7 @@ using namespace Arc;
   }
 
   DataStatus DataPointHTTP::makedir(const URL& dir) {
-    AutoPointer<ClientHTTP> client(acquire_client(dir));
+    AutoPointer<ClientHTTP> client(acquire_client(dir), &discard_client);
     if (!client) return DataStatus::CreateDirectoryError;
     PayloadMemConst request(NULL, 0, 0, 0);
     PayloadRawInterface *response = NULL;
@@ -1683,28 +1581,15 @@ using namespace Arc;
   }
 
   ClientHTTP* DataPointHTTP::acquire_client(const URL& curl) {
-    // TODO: lock
     if(!curl) return NULL;
     if((curl.Protocol() != "http") &&
        (curl.Protocol() != "https") &&
        (curl.Protocol() != "httpg") &&
        (curl.Protocol() != "dav") &&
        (curl.Protocol() != "davs")) return NULL;
-    ClientHTTP* client = NULL;
-    std::string key = curl.ConnectionURL();
-    clients_lock.lock();
-    std::multimap<std::string,ClientHTTP*>::iterator cl = clients.find(key);
-    if(cl != clients.end()) {
-      client = cl->second;
-      clients.erase(cl);
-      clients_lock.unlock();
-    } else {
-      clients_lock.unlock();
-      MCCConfig cfg;
-      usercfg.ApplyToConfig(cfg);
-      client = new ClientHTTP(cfg, curl, usercfg.Timeout());
-    };
-    return client;
+    MCCConfig cfg;
+    usercfg.ApplyToConfig(cfg);
+    return ClientHTTPPool::Instance().Acquire(cfg, curl, usercfg.Timeout());
   }
 
   ClientHTTP* DataPointHTTP::acquire_new_client(const URL& curl) {
@@ -1716,17 +1601,16 @@ using namespace Arc;
        (curl.Protocol() != "davs")) return NULL;
     MCCConfig cfg;
     usercfg.ApplyToConfig(cfg);
-    return new ClientHTTP(cfg, curl, usercfg.Timeout());
+    return ClientHTTPPool::Instance().Acquire(cfg, curl, usercfg.Timeout(), "", 0, false);
+  }
+
+  void DataPointHTTP::release_client(const URL& /* curl */, ClientHTTP* client) {
+    // Connections are shared with other DataPoints through process-wide pool
+    ClientHTTPPool::Instance().Release(client);
   }
 
-  void DataPointHTTP::release_client(const URL& curl, ClientHTTP* client) {
-    if(!client) return;
-    if(client->GetClosed()) { delete client; return; }
-    std::string key = curl.ConnectionURL();
-    //if(!*client) return;
-    clients_lock.lock();
-    clients.insert(std::pair<std::string,ClientHTTP*>(key,client));
-    clients_lock.unlock();
+  void DataPointHTTP::discard_client(ClientHTTP* client) {
+    ClientHTTPPool::Instance().Discard(client);
   }
 
   int DataPointHTTP::http2errno(int http_code) const {
@@ -5,6 +5,7 @@
 
 #include <arc/Thread.h>
 #include <arc/communication/ClientInterface.h>
+#include <arc/communication/ClientPool.h>
 #include <arc/data/DataPointDirect.h>
 
 namespace ArcDMCHTTP {
@@ -12,6 +13,7 @@ namespace ArcDMCHTTP {
 using namespace Arc;
 
   class ChunkControl;
+  class StreamControl;
 
   /**
    * This class allows access through HTTP to remote resources. HTTP over SSL
@@ -46,6 +48,10 @@ using namespace Arc;
     static bool read_single(void *arg);
     static void write_thread(void *arg);
     static bool write_single(void *arg);
+    /// Starts one more transfer thread. Must be called with transfer_lock held.
+    bool start_thread(void (*func)(void*));
+    /// Creates chunks and streams. Returns number of streams to start.
+    int setup_streams(bool chunked);
     DataStatus do_stat_http(URL& curl, FileInfo& file);
     DataStatus do_stat_webdav(URL& curl, FileInfo& file);
     DataStatus do_list_webdav(URL& rurl, std::list<FileInfo>& files, DataPointInfoType verb);
@@ -54,17 +60,20 @@ using namespace Arc;
     ClientHTTP* acquire_client(const URL& curl);
     ClientHTTP* acquire_new_client(const URL& curl);
     void release_client(const URL& curl, ClientHTTP* client);
+    /// Destroys client which connection is in unknown state
+    static void discard_client(ClientHTTP* client);
     /// Convert HTTP return code to errno
     int http2errno(int http_code) const;
     static Logger logger;
     bool reading;
     bool writing;
     ChunkControl *chunks;
-    std::multimap<std::string,ClientHTTP*> clients;
+    StreamControl *streams;
     SimpleCounter transfers_started;
     int transfers_tofinish;
+    /// Failure of stream which was taken over by remaining streams
+    DataStatus stream_failure_code;
     Glib::Mutex transfer_lock;
-    Glib::Mutex clients_lock;
     bool partial_read_allowed;
     bool partial_write_allowed;
   };
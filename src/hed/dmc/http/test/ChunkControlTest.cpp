@@ -0,0 +1,140 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "../ChunkControl.h"
+
+using namespace ArcDMCHTTP;
+
+class ChunkControlTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(ChunkControlTest);
+  CPPUNIT_TEST(TestGet);
+  CPPUNIT_TEST(TestClaim);
+  CPPUNIT_TEST(TestOverlap);
+  CPPUNIT_TEST(TestUnclaim);
+  CPPUNIT_TEST(TestEOF);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void TestGet();
+  void TestClaim();
+  void TestOverlap();
+  void TestUnclaim();
+  void TestEOF();
+
+private:
+  static void AssertGet(ChunkControl& chunks, uint64_t max, uint64_t start, uint64_t length);
+};
+
+void ChunkControlTest::AssertGet(ChunkControl& chunks, uint64_t max, uint64_t start, uint64_t length) {
+  uint64_t s = 0;
+  uint64_t l = max;
+  CPPUNIT_ASSERT(chunks.Get(s, l));
+  CPPUNIT_ASSERT_EQUAL(start, s);
+  CPPUNIT_ASSERT_EQUAL(length, l);
+}
+
+void ChunkControlTest::TestGet() {
+  ChunkControl chunks(100);
+  CPPUNIT_ASSERT(!chunks.Done());
+  // Zero length request gives nothing
+  uint64_t start = 0;
+  uint64_t length = 0;
+  CPPUNIT_ASSERT(!chunks.Get(start, length));
+  AssertGet(chunks, 40, 0, 40);
+  AssertGet(chunks, 40, 40, 40);
+  AssertGet(chunks, 40, 80, 20);
+  length = 40;
+  CPPUNIT_ASSERT(!chunks.Get(start, length));
+  // Chunks obtained through Get() are not counted as left
+  CPPUNIT_ASSERT(chunks.Done());
+}
+
+void ChunkControlTest::TestClaim() {
+  ChunkControl chunks(100);
+  // Claim in the middle splits range
+  chunks.Claim(10, 20);
+  AssertGet(chunks, 1000, 0, 10);
+  AssertGet(chunks, 1000, 30, 70);
+  CPPUNIT_ASSERT(chunks.Done());
+
+  // Claiming range obtained through Get() releases nothing else
+  ChunkControl whole(100);
+  uint64_t start = 0;
+  uint64_t length = 50;
+  CPPUNIT_ASSERT(whole.Get(start, length));
+  whole.Claim(start, length);
+  AssertGet(whole, 1000, 50, 50);
+  whole.Claim(50, 50);
+  CPPUNIT_ASSERT(whole.Done());
+}
+
+void ChunkControlTest::TestOverlap() {
+  ChunkControl chunks(100);
+  chunks.Claim(10, 20);
+  // Overlaps already claimed range and extends it
+  chunks.Claim(20, 30);
+  AssertGet(chunks, 1000, 0, 10);
+  chunks.Unclaim(0, 10);
+  // Spans several ranges and gaps between them
+  chunks.Claim(0, 60);
+  AssertGet(chunks, 1000, 60, 40);
+  CPPUNIT_ASSERT(chunks.Done());
+
+  // Claim beyond end of data is harmless
+  ChunkControl tail(100);
+  tail.Claim(90, 50);
+  AssertGet(tail, 1000, 0, 90);
+  CPPUNIT_ASSERT(tail.Done());
+}
+
+void ChunkControlTest::TestUnclaim() {
+  ChunkControl chunks(100);
+  AssertGet(chunks, 40, 0, 40);
+  AssertGet(chunks, 40, 40, 40);
+  chunks.Unclaim(0, 40);
+  CPPUNIT_ASSERT(!chunks.Done());
+  // Adjacent ranges are merged on both sides
+  chunks.Unclaim(40, 40);
+  AssertGet(chunks, 1000, 0, 100);
+  CPPUNIT_ASSERT(chunks.Done());
+
+  // Overlapping ranges are merged too
+  chunks.Unclaim(10, 20);
+  chunks.Unclaim(20, 20);
+  chunks.Unclaim(50, 10);
+  AssertGet(chunks, 1000, 10, 30);
+  AssertGet(chunks, 1000, 50, 10);
+  CPPUNIT_ASSERT(chunks.Done());
+
+  // Range covering several others absorbs them
+  chunks.Unclaim(10, 5);
+  chunks.Unclaim(20, 5);
+  chunks.Unclaim(30, 5);
+  chunks.Unclaim(0, 50);
+  AssertGet(chunks, 1000, 0, 50);
+  CPPUNIT_ASSERT(chunks.Done());
+}
+
+void ChunkControlTest::TestEOF() {
+  // Size is not known in advance
+  ChunkControl chunks;
+  AssertGet(chunks, 10, 0, 10);
+  chunks.Claim(0, 10);
+  CPPUNIT_ASSERT(!chunks.Done());
+  chunks.Claim(10);
+  CPPUNIT_ASSERT(chunks.Done());
+
+  // Ranges before end of data stay
+  chunks.Unclaim(0, 10);
+  chunks.Unclaim(20, 10);
+  chunks.Claim(5);
+  AssertGet(chunks, 1000, 0, 5);
+  CPPUNIT_ASSERT(chunks.Done());
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ChunkControlTest);
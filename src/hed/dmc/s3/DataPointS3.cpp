@@ -19,6 +19,8 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <arc/Base64.h>
+#include <arc/CheckSum.h>
 #include <arc/Thread.h>
 #include <arc/Logger.h>
 #include <arc/URL.h>
@@ -27,15 +29,21 @@
 #include <arc/StringConv.h>
 #include <arc/data/DataBuffer.h>
 #include <arc/data/DataCallback.h>
-//#include <arc/CheckSum.h>
 #include <arc/Utils.h>
 
 #include "DataPointS3.h"
+#include "PartControl.h"
 
 #if defined(HAVE_S3_TIMEOUT)
 #define S3_TIMEOUTMS 0
 #endif
 
+// Multipart API of libs3 is used in the form which comes with regions
+// and timeouts
+#if defined(S3_DEFAULT_REGION) && defined(S3_TIMEOUTMS)
+#define S3_MULTIPART
+#endif
+
 namespace ArcDMCS3 {
 
 using namespace Arc;
@@ -49,6 +57,106 @@ unsigned long long int DataPointS3::offset = 0;
 
 char ArcDMCS3::DataPointS3::error_details[4096] = { 0 };
 
+#if defined(S3_MULTIPART)
+// State of one request issued by part transfer threads. Unlike
+// static members used by single stream transfer it is not shared.
+class S3Transfer {
+public:
+  S3Transfer()
+      : status(S3StatusOK), buffer(NULL), data(NULL), offset(0), length(0),
+        pos(0) {}
+  S3Status status;
+  std::string error;
+  std::string etag;
+  std::string upload_id;
+  // Destination of ranged download
+  DataBuffer *buffer;
+  // Source of part upload
+  const char *data;
+  uint64_t offset;
+  uint64_t length;
+  uint64_t pos;
+};
+
+static S3Status transferPropertiesCallback(
+    const S3ResponseProperties *properties, void *callbackData) {
+  S3Transfer *transfer = (S3Transfer *)callbackData;
+  if (properties->eTag) transfer->etag = properties->eTag;
+  return S3StatusOK;
+}
+
+static void transferCompleteCallback(S3Status status,
+                                     const S3ErrorDetails *error,
+                                     void *callbackData) {
+  S3Transfer *transfer = (S3Transfer *)callbackData;
+  transfer->status = status;
+  transfer->error = S3_get_status_name(status);
+  if (error && error->message) transfer->error += std::string(": ") + error->message;
+}
+
+static S3Status rangeDataCallback(int bufferSize, const char *buffer,
+                                  void *callbackData) {
+  S3Transfer *transfer = (S3Transfer *)callbackData;
+  while (bufferSize > 0) {
+    int h;
+    unsigned int l;
+    if (!transfer->buffer->for_read(h, l, true)) {
+      // Must be error or request to exit
+      return S3StatusAbortedByCallback;
+    }
+    if (l > (unsigned int)bufferSize) l = bufferSize;
+    memcpy((*(transfer->buffer))[h], buffer, l);
+    transfer->buffer->is_read(h, l, transfer->offset + transfer->pos);
+    transfer->pos += l;
+    buffer += l;
+    bufferSize -= l;
+  }
+  return S3StatusOK;
+}
+
+static int partDataCallback(int bufferSize, char *buffer, void *callbackData) {
+  S3Transfer *transfer = (S3Transfer *)callbackData;
+  uint64_t l = transfer->length - transfer->pos;
+  if (l > (uint64_t)bufferSize) l = bufferSize;
+  memcpy(buffer, transfer->data + transfer->pos, l);
+  transfer->pos += l;
+  return l;
+}
+
+static S3Status initiateMultipartCallback(const char *upload_id,
+                                          void *callbackData) {
+  S3Transfer *transfer = (S3Transfer *)callbackData;
+  if (upload_id) transfer->upload_id = upload_id;
+  return S3StatusOK;
+}
+
+static S3Status commitMultipartCallback(const char *location,
+                                        const char *etag,
+                                        void *callbackData) {
+  S3Transfer *transfer = (S3Transfer *)callbackData;
+  if (etag) transfer->etag = etag;
+  return S3StatusOK;
+}
+
+// Base64 encoded MD5 sum as needed for Content-MD5 header
+static std::string content_md5(const char *data, uint64_t length) {
+  MD5Sum md5;
+  md5.start();
+  md5.add((void *)data, length);
+  md5.end();
+  char hex[64];
+  md5.print(hex, sizeof(hex));
+  std::string digest;
+  // Skip "md5:" prefix
+  for (const char *h = hex + 4; h[0] && h[1]; h += 2) {
+    unsigned int c;
+    if (sscanf(h, "%02x", &c) != 1) break;
+    digest += (char)c;
+  }
+  return Base64::encode(digest);
+}
+#endif
+
 S3Status
 DataPointS3::responsePropertiesCallback(const S3ResponseProperties *properties,
                                         void *callbackData) {
@@ -210,7 +318,7 @@ static int putObjectDataCallback(int bufferSize, char *buffer,
 
 DataPointS3::DataPointS3(const URL &url, const UserConfig &usercfg,
                          PluginArgument *parg)
-    : DataPointDirect(url, usercfg, parg), fd(-1), reading(false),
+    : DataPointDirect(url, usercfg, parg), parts(NULL), fd(-1), reading(false),
       writing(false) {
   hostname = std::string(url.Host() + ":" + tostring(url.Port()));
   access_key = Arc::GetEnv("S3_ACCESS_KEY");
@@ -253,10 +361,23 @@ DataPointS3::DataPointS3(const URL &url, const UserConfig &usercfg,
   uri_style = S3UriStylePath;
   S3_initialize("s3", S3_INIT_ALL, hostname.c_str());
 
+  S3BucketContext bucketContext = { 0,                  bucket_name.c_str(),
+                                    protocol,           uri_style,
+                                    access_key.c_str(), secret_key.c_str(),
+#if defined(S3_DEFAULT_REGION)
+                                    0, auth_region.c_str() };
+#else
+                                    0 };
+#endif
+  bucket_context = bucketContext;
+
   bufsize = 16384;
 }
 
-DataPointS3::~DataPointS3() { S3_deinitialize(); }
+DataPointS3::~DataPointS3() {
+  delete parts;
+  S3_deinitialize();
+}
 
 Plugin *DataPointS3::Instance(PluginArgument *arg) {
   DataPointPluginArgument *dmcarg =
@@ -520,6 +641,198 @@ DataStatus DataPointS3::CreateDirectory(bool with_parents) {
                     S3_get_status_name(request_status));
 }
 
+#if defined(S3_MULTIPART)
+bool DataPointS3::start_parts(void (*func)(void *), int streams) {
+  int started = 0;
+  for (int n = 0; n < streams; ++n) {
+    parts->Start();
+    if (!CreateThreadFunction(func, this, &transfers_started)) {
+      parts->Finish();
+      continue;
+    }
+    ++started;
+  }
+  if (started == 0) return false;
+  // Threads may have finished already
+  if (parts->Finish()) {
+    if (func == &DataPointS3::read_parts_start) {
+      read_parts_done();
+    } else {
+      write_parts_done();
+    }
+  }
+  return true;
+}
+
+void DataPointS3::read_parts_start(void *arg) {
+  ((DataPointS3 *)arg)->read_parts();
+}
+
+bool DataPointS3::read_range(uint64_t start, uint64_t length) {
+  S3GetObjectHandler getObjectHandler = { { &transferPropertiesCallback,
+                                            &transferCompleteCallback },
+                                          &rangeDataCallback };
+  S3Transfer transfer;
+  transfer.buffer = buffer;
+  transfer.offset = start;
+  transfer.length = length;
+  int retries = 0;
+  while (transfer.pos < length) {
+    uint64_t pos = transfer.pos;
+    transfer.status = S3StatusOK;
+    S3_get_object(&bucket_context, key_name.c_str(), 0, start + pos,
+                  length - pos, 0, S3_TIMEOUTMS, &getObjectHandler, &transfer);
+    if ((transfer.status == S3StatusOK) && (transfer.pos >= length)) break;
+    if (buffer->error()) return false;
+    // Continue from where previous attempt stopped
+    if (transfer.pos > pos) retries = 0;
+    if (++retries > part_retries_max) {
+      logger.msg(ERROR, "Failed to read object %s: %s", url.Path(),
+                 transfer.error);
+      return false;
+    }
+    logger.msg(VERBOSE, "Retrying read of object %s from offset %llu: %s",
+               url.Path(), start + transfer.pos, transfer.error);
+  }
+  return true;
+}
+
+void DataPointS3::read_parts() {
+  uint64_t start = 0;
+  uint64_t length = 0;
+  while (parts->Next(start, length)) {
+    if (!read_range(start, length)) {
+      parts->Failed();
+      break;
+    }
+  }
+  if (parts->Finish()) read_parts_done();
+}
+
+void DataPointS3::read_parts_done() {
+  if (parts->IsFailed()) buffer->error_read(true);
+  buffer->eof_read(true);
+}
+
+void DataPointS3::write_parts_start(void *arg) {
+  ((DataPointS3 *)arg)->write_parts();
+}
+
+bool DataPointS3::upload_part(unsigned int number, const char *data,
+                              uint64_t length) {
+  // Server verifies every part against its MD5 sum
+  std::string md5 = content_md5(data, length);
+  S3PutProperties putProperties = { 0, md5.c_str(), 0, 0, 0, -1,
+                                    S3CannedAclPrivate, 0, 0, 0 };
+  S3PutObjectHandler putObjectHandler = { { &transferPropertiesCallback,
+                                            &transferCompleteCallback },
+                                          &partDataCallback };
+  S3Transfer transfer;
+  transfer.data = data;
+  transfer.length = length;
+  for (int retries = 0;; ++retries) {
+    transfer.status = S3StatusOK;
+    transfer.pos = 0;
+    transfer.etag.clear();
+    if (parts->upload_id.empty()) {
+      S3_put_object(&bucket_context, key_name.c_str(), length, &putProperties,
+                    0, S3_TIMEOUTMS, &putObjectHandler, &transfer);
+    } else {
+      S3_upload_part(&bucket_context, key_name.c_str(), &putProperties,
+                     &putObjectHandler, number, parts->upload_id.c_str(),
+                     (int)length, 0, S3_TIMEOUTMS, &transfer);
+    }
+    if (transfer.status == S3StatusOK) break;
+    if (retries >= part_retries_max) {
+      logger.msg(ERROR, "Failed to write part %u of object %s: %s", number,
+                 url.Path(), transfer.error);
+      return false;
+    }
+    logger.msg(VERBOSE, "Retrying write of part %u of object %s: %s", number,
+               url.Path(), transfer.error);
+  }
+  parts->Uploaded(number, transfer.etag);
+  return true;
+}
+
+bool DataPointS3::complete_upload() {
+  std::string manifest = parts->Manifest();
+  if (manifest.empty()) {
+    logger.msg(ERROR, "Not all parts of object %s were written", url.Path());
+    return false;
+  }
+  S3MultipartCommitHandler commitHandler = { { &transferPropertiesCallback,
+                                               &transferCompleteCallback },
+                                             &partDataCallback,
+                                             &commitMultipartCallback };
+  S3Transfer transfer;
+  transfer.data = manifest.c_str();
+  transfer.length = manifest.length();
+  S3_complete_multipart_upload(&bucket_context, key_name.c_str(),
+                               &commitHandler, parts->upload_id.c_str(),
+                               manifest.length(), 0, S3_TIMEOUTMS, &transfer);
+  if (transfer.status != S3StatusOK) {
+    logger.msg(ERROR, "Failed to complete writing of object %s: %s",
+               url.Path(), transfer.error);
+    return false;
+  }
+  return true;
+}
+
+void DataPointS3::abort_upload() {
+  if (parts->upload_id.empty()) return;
+  // Otherwise uploaded parts are kept and charged for by server
+  S3AbortMultipartUploadHandler abortHandler = { { &transferPropertiesCallback,
+                                                   &transferCompleteCallback } };
+  S3_abort_multipart_upload(&bucket_context, key_name.c_str(),
+                            parts->upload_id.c_str(), S3_TIMEOUTMS,
+                            &abortHandler);
+}
+
+void DataPointS3::write_parts() {
+  for (;;) {
+    int h;
+    unsigned int l;
+    unsigned long long int p;
+    if (!buffer->for_write(h, l, p, true)) break;
+    std::list<PartControl::Part *> complete;
+    parts->Fill(p, (*buffer)[h], l, complete);
+    buffer->is_written(h);
+    for (std::list<PartControl::Part *>::iterator part = complete.begin();
+         part != complete.end(); ++part) {
+      if (!parts->IsFailed() &&
+          !upload_part((*part)->number, &((*part)->data[0]), (*part)->data.size())) {
+        parts->Failed();
+      }
+      delete *part;
+    }
+    if (parts->IsFailed()) {
+      buffer->error_write(true);
+      break;
+    }
+  }
+  if (parts->Finish()) write_parts_done();
+}
+
+void DataPointS3::write_parts_done() {
+  bool failed = parts->IsFailed() || buffer->error();
+  if (!failed && (size == 0)) {
+    // Empty object has no data to fill part
+    failed = !upload_part(1, "", 0);
+  }
+  if (!failed && !parts->Complete()) {
+    logger.msg(ERROR, "Not all parts of object %s were written", url.Path());
+    failed = true;
+  }
+  if (!parts->upload_id.empty()) {
+    if (!failed) failed = !complete_upload();
+    if (failed) abort_upload();
+  }
+  if (failed) buffer->error_write(true);
+  buffer->eof_write(true);
+}
+#endif
+
 void DataPointS3::read_file_start(void *arg) {
   ((DataPointS3 *)arg)->read_file();
 }
@@ -561,6 +874,25 @@ DataStatus DataPointS3::StartReading(DataBuffer &buf) {
   reading = true;
 
   buffer = &buf;
+#if defined(S3_MULTIPART)
+  if (!CheckSize()) {
+    FileInfo file;
+    if (Stat(file, INFO_TYPE_CONTENT)) SetSize(file.GetSize());
+  }
+  // Ranges are read in order only if there is one stream
+  int streams = allow_out_of_order ? bufnum : 1;
+  if (CheckSize()) {
+    delete parts;
+    parts = new PartControl(size);
+    if (parts->Count() < (unsigned int)streams) streams = parts->Count();
+    if (!start_parts(&DataPointS3::read_parts_start, streams)) {
+      reading = false;
+      buffer = NULL;
+      return DataStatus::ReadStartError;
+    }
+    return DataStatus::Success;
+  }
+#endif
   // create thread to maintain reading
   if (!CreateThreadFunction(&DataPointS3::read_file_start, this,
                             &transfers_started)) {
@@ -575,6 +907,8 @@ DataStatus DataPointS3::StartReading(DataBuffer &buf) {
 DataStatus DataPointS3::StopReading() {
 
   transfers_started.wait();
+  delete parts;
+  parts = NULL;
   return DataStatus::Success;
 }
 
@@ -640,6 +974,42 @@ DataStatus DataPointS3::StartWriting(DataBuffer &buf, DataCallback *space_cb) {
 
   /* try to open */
   buffer = &buf;
+#if defined(S3_MULTIPART)
+  delete parts;
+  parts = new PartControl(size);
+  if (parts->Count() > 1) {
+    S3PutProperties putProperties = { 0, 0, 0, 0, 0, -1,
+                                      S3CannedAclPrivate, 0, 0, 0 };
+    S3MultipartInitialHandler initialHandler = { { &transferPropertiesCallback,
+                                                   &transferCompleteCallback },
+                                                 &initiateMultipartCallback };
+    S3Transfer transfer;
+    S3_initiate_multipart(&bucket_context, key_name.c_str(), &putProperties,
+                          &initialHandler, 0, S3_TIMEOUTMS, &transfer);
+    if ((transfer.status != S3StatusOK) || transfer.upload_id.empty()) {
+      logger.msg(ERROR, "Failed to start writing of object %s: %s",
+                 url.Path(), transfer.error);
+      delete parts;
+      parts = NULL;
+      writing = false;
+      return DataStatus(DataStatus::WriteStartError, transfer.error);
+    }
+    parts->upload_id = transfer.upload_id;
+  }
+  buffer->speed.reset();
+  buffer->speed.hold(false);
+  int streams = bufnum;
+  if (parts->Count() < (unsigned int)streams) streams = parts->Count();
+  if (!start_parts(&DataPointS3::write_parts_start, streams)) {
+    abort_upload();
+    buffer->error_write(true);
+    buffer->eof_write(true);
+    writing = false;
+    return DataStatus(DataStatus::WriteStartError,
+                      "Failed to create new thread");
+  }
+  return DataStatus::Success;
+#endif
   buffer->set(NULL, 16384, 3);
   buffer->speed.reset();
   buffer->speed.hold(false);
@@ -660,10 +1030,19 @@ DataStatus DataPointS3::StopWriting() {
   writing = false;
   transfers_started.wait(); /* wait till writing thread exited */
   buffer = NULL;
+  delete parts;
+  parts = NULL;
   return DataStatus::Success;
 }
 
-bool DataPointS3::WriteOutOfOrder() const { return false; }
+bool DataPointS3::WriteOutOfOrder() const {
+#if defined(S3_MULTIPART)
+  // Parts are assembled in memory
+  return true;
+#else
+  return false;
+#endif
+}
 
 } // namespace Arc
 
@@ -13,10 +13,19 @@ namespace ArcDMCS3 {
 
 using namespace Arc;
 
+class PartControl;
+
 /**
  * This class allows access to object stores through the S3 protocol. It uses
  * the environment variables S3_ACCESS_KEY and S3_SECRET_KEY for authentication.
  *
+ * If libs3 supports multipart upload, objects are uploaded in parts which
+ * are assembled in memory, so data may be written out of order. Objects
+ * of known size are downloaded by ranged requests. Number of parts
+ * transferred concurrently is given by the "threads" URL option. Every
+ * part is retried separately and uploaded parts are validated by the
+ * server through their MD5 sums.
+ *
  * This class is a loadable module and cannot be used directly. The DataHandle
  * class loads modules at runtime and should be used instead of this.
  */
@@ -56,9 +65,24 @@ private:
   std::string key_name;
   S3Protocol protocol;
   S3UriStyle uri_style;
+  // Filled once and shared by all requests of this object
   S3BucketContext bucket_context;
   SimpleCounter transfers_started;
 
+  PartControl *parts;
+
+  static void read_parts_start(void *arg);
+  static void write_parts_start(void *arg);
+  bool start_parts(void (*func)(void *), int streams);
+  void read_parts();
+  void write_parts();
+  void read_parts_done();
+  void write_parts_done();
+  bool read_range(uint64_t start, uint64_t length);
+  bool upload_part(unsigned int number, const char *data, uint64_t length);
+  bool complete_upload();
+  void abort_upload();
+
   static void read_file_start(void *arg);
   static void write_file_start(void *arg);
   void read_file();
@@ -0,0 +1,170 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifndef __ARC_S3PARTCONTROL_H__
+#define __ARC_S3PARTCONTROL_H__
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <stdint.h>
+
+#include <arc/StringConv.h>
+#include <arc/Thread.h>
+
+namespace ArcDMCS3 {
+
+using namespace Arc;
+
+// Default size of part, S3 requires at least 5MB
+static const uint64_t part_size_default = 16 * 1024 * 1024;
+// Maximal number of parts S3 accepts for one object
+static const uint64_t part_count_max = 10000;
+// Number of failed attempts in a row after which part is given up
+static const int part_retries_max = 5;
+
+// Splits object into parts and distributes them among transfer threads.
+// While uploading, parts are assembled in memory from data blocks which
+// may come in any order and are handed out as soon as they are complete.
+class PartControl {
+public:
+  class Part {
+  public:
+    Part(unsigned int number, uint64_t length)
+        : number(number), data(length), filled(0) {}
+    unsigned int number;
+    std::vector<char> data;
+    uint64_t filled;
+  };
+
+  PartControl(uint64_t size)
+      : size_(size), part_size_(part_size_default), count_(1), next_(0),
+        running_(1), failed_(false) {
+    if (size_ / part_size_ >= part_count_max) {
+      // Round up to whole megabytes
+      part_size_ = (size_ / part_count_max + 1024 * 1024) & ~(uint64_t)(1024 * 1024 - 1);
+    }
+    if (size_ > 0) count_ = (size_ + part_size_ - 1) / part_size_;
+  }
+
+  ~PartControl() {
+    for (std::map<unsigned int, Part *>::iterator p = filling_.begin();
+         p != filling_.end(); ++p) delete p->second;
+  }
+
+  unsigned int Count() const { return count_; }
+
+  // Range of next part to be downloaded, numbered from 0.
+  bool Next(uint64_t &start, uint64_t &length) {
+    Glib::Mutex::Lock lock(lock_);
+    if (failed_ || (next_ >= count_)) return false;
+    start = next_ * part_size_;
+    length = Length(next_);
+    ++next_;
+    return true;
+  }
+
+  // Copies data block into parts it covers. Parts which became
+  // complete are moved to 'complete' and must be deleted by caller.
+  void Fill(uint64_t offset, const char *data, uint64_t length,
+            std::list<Part *> &complete) {
+    Glib::Mutex::Lock lock(lock_);
+    while (length > 0) {
+      unsigned int n = offset / part_size_;
+      uint64_t part_start = n * part_size_;
+      uint64_t part_length = (n < count_) ? Length(n) : 0;
+      if (offset >= part_start + part_length) {
+        // Source provides more data than announced
+        failed_ = true;
+        break;
+      }
+      uint64_t l = part_start + part_length - offset;
+      if (l > length) l = length;
+      Part *&part = filling_[n];
+      if (!part) part = new Part(n + 1, part_length);
+      memcpy(&(part->data[offset - part_start]), data, l);
+      part->filled += l;
+      if (part->filled >= part_length) {
+        complete.push_back(part);
+        filling_.erase(n);
+      }
+      offset += l;
+      data += l;
+      length -= l;
+    }
+  }
+
+  // Records ETag of uploaded part, numbered from 1 as in S3.
+  void Uploaded(unsigned int number, const std::string &etag) {
+    Glib::Mutex::Lock lock(lock_);
+    etags_[number] = etag;
+  }
+
+  // Body of request completing multipart upload, empty if some part
+  // is missing.
+  std::string Manifest() {
+    Glib::Mutex::Lock lock(lock_);
+    if (etags_.size() != count_) return "";
+    std::string manifest("<CompleteMultipartUpload>");
+    for (std::map<unsigned int, std::string>::iterator e = etags_.begin();
+         e != etags_.end(); ++e) {
+      manifest += "<Part><PartNumber>" + tostring(e->first) + "</PartNumber>";
+      manifest += "<ETag>" + e->second + "</ETag></Part>";
+    }
+    manifest += "</CompleteMultipartUpload>";
+    return manifest;
+  }
+
+  // True if every part was uploaded.
+  bool Complete() {
+    Glib::Mutex::Lock lock(lock_);
+    return (etags_.size() == count_);
+  }
+
+  void Failed() {
+    Glib::Mutex::Lock lock(lock_);
+    failed_ = true;
+  }
+
+  bool IsFailed() {
+    Glib::Mutex::Lock lock(lock_);
+    return failed_;
+  }
+
+  // Registers one more transfer thread. Starting code counts as
+  // thread too, so transfer can't finish before all threads are started.
+  void Start() {
+    Glib::Mutex::Lock lock(lock_);
+    ++running_;
+  }
+
+  // Called by exiting thread. Returns true for the last one.
+  bool Finish() {
+    Glib::Mutex::Lock lock(lock_);
+    return (--running_ == 0);
+  }
+
+  // Identifier of multipart upload, empty for single part objects.
+  std::string upload_id;
+
+private:
+  uint64_t Length(unsigned int n) const {
+    if (n + 1 < count_) return part_size_;
+    return size_ - n * part_size_;
+  }
+
+  uint64_t size_;
+  uint64_t part_size_;
+  unsigned int count_;
+  unsigned int next_;
+  int running_;
+  bool failed_;
+  std::map<unsigned int, Part *> filling_;
+  std::map<unsigned int, std::string> etags_;
+  Glib::Mutex lock_;
+};
+
+} // namespace ArcDMCS3
+
+#endif // __ARC_S3PARTCONTROL_H__
@@ -0,0 +1,136 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <list>
+#include <string>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "../PartControl.h"
+
+using namespace ArcDMCS3;
+
+class PartControlTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(PartControlTest);
+  CPPUNIT_TEST(TestSplit);
+  CPPUNIT_TEST(TestFill);
+  CPPUNIT_TEST(TestOverflow);
+  CPPUNIT_TEST(TestEmpty);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void TestSplit();
+  void TestFill();
+  void TestOverflow();
+  void TestEmpty();
+
+private:
+  static void Release(std::list<PartControl::Part*>& complete);
+};
+
+void PartControlTest::Release(std::list<PartControl::Part*>& complete) {
+  for (std::list<PartControl::Part*>::iterator p = complete.begin(); p != complete.end(); ++p) delete *p;
+  complete.clear();
+}
+
+void PartControlTest::TestSplit() {
+  const uint64_t mb = 1024 * 1024;
+  PartControl parts(40 * mb);
+  CPPUNIT_ASSERT_EQUAL(3U, parts.Count());
+  uint64_t start, length;
+  CPPUNIT_ASSERT(parts.Next(start, length));
+  CPPUNIT_ASSERT_EQUAL((uint64_t)0, start);
+  CPPUNIT_ASSERT_EQUAL(16 * mb, length);
+  CPPUNIT_ASSERT(parts.Next(start, length));
+  CPPUNIT_ASSERT_EQUAL(16 * mb, start);
+  CPPUNIT_ASSERT(parts.Next(start, length));
+  CPPUNIT_ASSERT_EQUAL(32 * mb, start);
+  CPPUNIT_ASSERT_EQUAL(8 * mb, length);
+  CPPUNIT_ASSERT(!parts.Next(start, length));
+
+  // Part size grows so that S3 limit on number of parts is kept
+  PartControl huge(1024 * 1024 * mb);
+  CPPUNIT_ASSERT(huge.Count() <= 10000);
+  CPPUNIT_ASSERT(huge.Count() > 1000);
+}
+
+void PartControlTest::TestFill() {
+  const uint64_t mb = 1024 * 1024;
+  uint64_t size = 32 * mb + 10;
+  std::vector<char> data(size);
+  for (uint64_t n = 0; n < size; ++n) data[n] = (char)(n % 251);
+  PartControl parts(size);
+  CPPUNIT_ASSERT_EQUAL(3U, parts.Count());
+
+  std::list<PartControl::Part*> complete;
+  // Last part first, then block spanning two parts
+  parts.Fill(32 * mb, &data[32 * mb], 10, complete);
+  CPPUNIT_ASSERT_EQUAL(1, (int)complete.size());
+  CPPUNIT_ASSERT_EQUAL(3U, complete.front()->number);
+  CPPUNIT_ASSERT_EQUAL((size_t)10, complete.front()->data.size());
+  Release(complete);
+  parts.Fill(mb, &data[mb], 30 * mb, complete);
+  CPPUNIT_ASSERT_EQUAL(0, (int)complete.size());
+  parts.Fill(31 * mb, &data[31 * mb], mb, complete);
+  CPPUNIT_ASSERT_EQUAL(1, (int)complete.size());
+  CPPUNIT_ASSERT_EQUAL(2U, complete.front()->number);
+  Release(complete);
+  parts.Fill(0, &data[0], mb, complete);
+  CPPUNIT_ASSERT_EQUAL(1, (int)complete.size());
+  PartControl::Part* first = complete.front();
+  CPPUNIT_ASSERT_EQUAL(1U, first->number);
+  CPPUNIT_ASSERT(memcmp(&(first->data[0]), &data[0], 16 * mb) == 0);
+  Release(complete);
+  CPPUNIT_ASSERT(!parts.IsFailed());
+
+  parts.Uploaded(1, "\"a\"");
+  parts.Uploaded(2, "\"b\"");
+  CPPUNIT_ASSERT(!parts.Complete());
+  CPPUNIT_ASSERT_EQUAL(std::string(""), parts.Manifest());
+  parts.Uploaded(3, "\"c\"");
+  CPPUNIT_ASSERT(parts.Complete());
+  CPPUNIT_ASSERT(parts.Manifest().find("<PartNumber>3</PartNumber><ETag>\"c\"</ETag>") != std::string::npos);
+}
+
+void PartControlTest::TestOverflow() {
+  char data[64];
+  memset(data, 'x', sizeof(data));
+  std::list<PartControl::Part*> complete;
+
+  // More data than announced - announced part is still assembled
+  PartControl longer(10);
+  longer.Fill(0, data, 20, complete);
+  CPPUNIT_ASSERT(longer.IsFailed());
+  CPPUNIT_ASSERT_EQUAL(1, (int)complete.size());
+  CPPUNIT_ASSERT_EQUAL((size_t)10, complete.front()->data.size());
+  Release(complete);
+
+  // Block starting after announced end of single part
+  PartControl beyond(10);
+  beyond.Fill(12, data, 4, complete);
+  CPPUNIT_ASSERT(beyond.IsFailed());
+  CPPUNIT_ASSERT_EQUAL(0, (int)complete.size());
+
+  // Block beyond last of several parts
+  PartControl several(40 * 1024 * 1024);
+  several.Fill(40 * 1024 * 1024, data, sizeof(data), complete);
+  CPPUNIT_ASSERT(several.IsFailed());
+  CPPUNIT_ASSERT_EQUAL(0, (int)complete.size());
+  uint64_t start, length;
+  CPPUNIT_ASSERT(!several.Next(start, length));
+}
+
+void PartControlTest::TestEmpty() {
+  char data[1] = { 'x' };
+  std::list<PartControl::Part*> complete;
+  PartControl parts(0);
+  CPPUNIT_ASSERT_EQUAL(1U, parts.Count());
+  parts.Fill(0, data, 1, complete);
+  CPPUNIT_ASSERT(parts.IsFailed());
+  CPPUNIT_ASSERT_EQUAL(0, (int)complete.size());
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PartControlTest);
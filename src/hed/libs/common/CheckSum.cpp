@@ -10,6 +10,11 @@
 #include <fcntl.h>
 #include <sys/types.h>
 
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <nmmintrin.h>
+#define HAVE_CRC32C_SSE42
+#endif
+
 #include <arc/StringConv.h>
 #include <arc/CheckSum.h>
 
@@ -87,6 +92,31 @@ static uint32_t gtable[256] = {
   0xBCB4666D, 0xB8757BDA, 0xB5365D03, 0xB1F740B4
 };
 
+// Tables for processing 8 bytes at once ("slicing-by-8"). Table k holds
+// CRC of byte followed by k zero bytes. First table is gtable itself.
+static uint32_t gtables[8][256];
+
+// Same for CRC32C (reflected Castagnoli polynomial 0x82F63B78).
+static uint32_t ctables[8][256];
+
+static class CheckSumTables {
+ public:
+  CheckSumTables(void) {
+    for (int i = 0; i < 256; ++i) {
+      gtables[0][i] = gtable[i];
+      uint32_t c = i;
+      for (int j = 0; j < 8; ++j) c = (c & 1) ? ((c >> 1) ^ 0x82F63B78) : (c >> 1);
+      ctables[0][i] = c;
+    }
+    for (int k = 1; k < 8; ++k) {
+      for (int i = 0; i < 256; ++i) {
+        gtables[k][i] = (gtables[k-1][i] << 8) ^ gtables[0][gtables[k-1][i] >> 24];
+        ctables[k][i] = (ctables[k-1][i] >> 8) ^ ctables[0][ctables[k-1][i] & 0xFF];
+      }
+    }
+  }
+} checksum_tables;
+
 namespace Arc {
 
   CRC32Sum::CRC32Sum(void) {
@@ -99,12 +129,24 @@ namespace Arc {
     computed = false;
   }
 
+  // Register holds CRC of data already multiplied by x^32. That is what
+  // 'cksum' gets by feeding 4 zero bytes at end, so they are not needed.
   void CRC32Sum::add(void *buf, unsigned long long int len) {
-    for (unsigned long long int i = 0; i < len; i++) {
-      unsigned char c = (r >> 24);
-      r = ((r << 8) | ((unsigned char*)buf)[i]) ^ gtable[c];
-    }
+    const unsigned char *p = (const unsigned char*)buf;
+    uint32_t c = r;
     count += len;
+    for (; len >= 8; len -= 8, p += 8) {
+      c ^= (((uint32_t)p[0]) << 24) | (((uint32_t)p[1]) << 16) |
+           (((uint32_t)p[2]) << 8) | ((uint32_t)p[3]);
+      c = gtables[7][c >> 24] ^ gtables[6][(c >> 16) & 0xFF] ^
+          gtables[5][(c >> 8) & 0xFF] ^ gtables[4][c & 0xFF] ^
+          gtables[3][p[4]] ^ gtables[2][p[5]] ^
+          gtables[1][p[6]] ^ gtables[0][p[7]];
+    }
+    for (; len; --len, ++p) {
+      c = (c << 8) ^ gtable[(c >> 24) ^ *p];
+    }
+    r = c;
   }
 
   void CRC32Sum::end(void) {
@@ -116,8 +158,6 @@ namespace Arc {
       ((CheckSum*)this)->add(&c, 1);
       l >>= 8;
     }
-    uint32_t u = 0;
-    ((CheckSum*)this)->add(&u, 4);
     r = ((~r) & 0xFFFFFFFF);
     computed = true;
   }
@@ -235,9 +275,121 @@ namespace Arc {
     computed = false;
   }
 
+  // Processes one block of 16 words
+  static void md5_block(uint32_t& A, uint32_t& B, uint32_t& C, uint32_t& D,
+                        const uint32_t *X) {
+    uint32_t AA = A;
+    uint32_t BB = B;
+    uint32_t CC = C;
+    uint32_t DD = D;
+
+
+    OP1(A, B, C, D, 0, 7, 1);
+    OP1(D, A, B, C, 1, 12, 2);
+    OP1(C, D, A, B, 2, 17, 3);
+    OP1(B, C, D, A, 3, 22, 4);
+
+    OP1(A, B, C, D, 4, 7, 5);
+    OP1(D, A, B, C, 5, 12, 6);
+    OP1(C, D, A, B, 6, 17, 7);
+    OP1(B, C, D, A, 7, 22, 8);
+
+    OP1(A, B, C, D, 8, 7, 9);
+    OP1(D, A, B, C, 9, 12, 10);
+    OP1(C, D, A, B, 10, 17, 11);
+    OP1(B, C, D, A, 11, 22, 12);
+
+    OP1(A, B, C, D, 12, 7, 13);
+    OP1(D, A, B, C, 13, 12, 14);
+    OP1(C, D, A, B, 14, 17, 15);
+    OP1(B, C, D, A, 15, 22, 16);
+
+
+    OP2(A, B, C, D, 1, 5, 17);
+    OP2(D, A, B, C, 6, 9, 18);
+    OP2(C, D, A, B, 11, 14, 19);
+    OP2(B, C, D, A, 0, 20, 20);
+
+    OP2(A, B, C, D, 5, 5, 21);
+    OP2(D, A, B, C, 10, 9, 22);
+    OP2(C, D, A, B, 15, 14, 23);
+    OP2(B, C, D, A, 4, 20, 24);
+
+    OP2(A, B, C, D, 9, 5, 25);
+    OP2(D, A, B, C, 14, 9, 26);
+    OP2(C, D, A, B, 3, 14, 27);
+    OP2(B, C, D, A, 8, 20, 28);
+
+    OP2(A, B, C, D, 13, 5, 29);
+    OP2(D, A, B, C, 2, 9, 30);
+    OP2(C, D, A, B, 7, 14, 31);
+    OP2(B, C, D, A, 12, 20, 32);
+
+
+    OP3(A, B, C, D, 5, 4, 33);
+    OP3(D, A, B, C, 8, 11, 34);
+    OP3(C, D, A, B, 11, 16, 35);
+    OP3(B, C, D, A, 14, 23, 36);
+
+    OP3(A, B, C, D, 1, 4, 37);
+    OP3(D, A, B, C, 4, 11, 38);
+    OP3(C, D, A, B, 7, 16, 39);
+    OP3(B, C, D, A, 10, 23, 40);
+
+    OP3(A, B, C, D, 13, 4, 41);
+    OP3(D, A, B, C, 0, 11, 42);
+    OP3(C, D, A, B, 3, 16, 43);
+    OP3(B, C, D, A, 6, 23, 44);
+
+    OP3(A, B, C, D, 9, 4, 45);
+    OP3(D, A, B, C, 12, 11, 46);
+    OP3(C, D, A, B, 15, 16, 47);
+    OP3(B, C, D, A, 2, 23, 48);
+
+
+    OP4(A, B, C, D, 0, 6, 49);
+    OP4(D, A, B, C, 7, 10, 50);
+    OP4(C, D, A, B, 14, 15, 51);
+    OP4(B, C, D, A, 5, 21, 52);
+
+    OP4(A, B, C, D, 12, 6, 53);
+    OP4(D, A, B, C, 3, 10, 54);
+    OP4(C, D, A, B, 10, 15, 55);
+    OP4(B, C, D, A, 1, 21, 56);
+
+    OP4(A, B, C, D, 8, 6, 57);
+    OP4(D, A, B, C, 15, 10, 58);
+    OP4(C, D, A, B, 6, 15, 59);
+    OP4(B, C, D, A, 13, 21, 60);
+
+    OP4(A, B, C, D, 4, 6, 61);
+    OP4(D, A, B, C, 11, 10, 62);
+    OP4(C, D, A, B, 2, 15, 63);
+    OP4(B, C, D, A, 9, 21, 64);
+
+
+    A += AA;
+    B += BB;
+    C += CC;
+    D += DD;
+  }
+
   void MD5Sum::add(void *buf, unsigned long long int len) {
     u_char *buf_ = (u_char*)buf;
+    // Whole blocks are taken directly from data, only partial
+    // blocks are collected in X.
     for (; len;) {
+      if ((Xlen == 0) && (len >= 64)) {
+        uint32_t W[16];
+        for (; len >= 64; len -= 64, buf_ += 64, count += 64) {
+          for (u_int Wi = 0; Wi < 16; ++Wi) {
+            W[Wi] = ((uint32_t)buf_[Wi*4]) | (((uint32_t)buf_[Wi*4+1]) << 8) |
+                    (((uint32_t)buf_[Wi*4+2]) << 16) | (((uint32_t)buf_[Wi*4+3]) << 24);
+          }
+          md5_block(A, B, C, D, W);
+        }
+        continue;
+      }
       for(;Xlen < 64;) { // 16 words = 64 bytes
         if(!len) break;
         u_int Xi = Xlen >> 2;
@@ -250,100 +402,7 @@ namespace Arc {
       }
       if (Xlen < 64) return;
 
-      uint32_t AA = A;
-      uint32_t BB = B;
-      uint32_t CC = C;
-      uint32_t DD = D;
-
-
-      OP1(A, B, C, D, 0, 7, 1);
-      OP1(D, A, B, C, 1, 12, 2);
-      OP1(C, D, A, B, 2, 17, 3);
-      OP1(B, C, D, A, 3, 22, 4);
-
-      OP1(A, B, C, D, 4, 7, 5);
-      OP1(D, A, B, C, 5, 12, 6);
-      OP1(C, D, A, B, 6, 17, 7);
-      OP1(B, C, D, A, 7, 22, 8);
-
-      OP1(A, B, C, D, 8, 7, 9);
-      OP1(D, A, B, C, 9, 12, 10);
-      OP1(C, D, A, B, 10, 17, 11);
-      OP1(B, C, D, A, 11, 22, 12);
-
-      OP1(A, B, C, D, 12, 7, 13);
-      OP1(D, A, B, C, 13, 12, 14);
-      OP1(C, D, A, B, 14, 17, 15);
-      OP1(B, C, D, A, 15, 22, 16);
-
-
-      OP2(A, B, C, D, 1, 5, 17);
-      OP2(D, A, B, C, 6, 9, 18);
-      OP2(C, D, A, B, 11, 14, 19);
-      OP2(B, C, D, A, 0, 20, 20);
-
-      OP2(A, B, C, D, 5, 5, 21);
-      OP2(D, A, B, C, 10, 9, 22);
-      OP2(C, D, A, B, 15, 14, 23);
-      OP2(B, C, D, A, 4, 20, 24);
-
-      OP2(A, B, C, D, 9, 5, 25);
-      OP2(D, A, B, C, 14, 9, 26);
-      OP2(C, D, A, B, 3, 14, 27);
-      OP2(B, C, D, A, 8, 20, 28);
-
-      OP2(A, B, C, D, 13, 5, 29);
-      OP2(D, A, B, C, 2, 9, 30);
-      OP2(C, D, A, B, 7, 14, 31);
-      OP2(B, C, D, A, 12, 20, 32);
-
-
-      OP3(A, B, C, D, 5, 4, 33);
-      OP3(D, A, B, C, 8, 11, 34);
-      OP3(C, D, A, B, 11, 16, 35);
-      OP3(B, C, D, A, 14, 23, 36);
-
-      OP3(A, B, C, D, 1, 4, 37);
-      OP3(D, A, B, C, 4, 11, 38);
-      OP3(C, D, A, B, 7, 16, 39);
-      OP3(B, C, D, A, 10, 23, 40);
-
-      OP3(A, B, C, D, 13, 4, 41);
-      OP3(D, A, B, C, 0, 11, 42);
-      OP3(C, D, A, B, 3, 16, 43);
-      OP3(B, C, D, A, 6, 23, 44);
-
-      OP3(A, B, C, D, 9, 4, 45);
-      OP3(D, A, B, C, 12, 11, 46);
-      OP3(C, D, A, B, 15, 16, 47);
-      OP3(B, C, D, A, 2, 23, 48);
-
-
-      OP4(A, B, C, D, 0, 6, 49);
-      OP4(D, A, B, C, 7, 10, 50);
-      OP4(C, D, A, B, 14, 15, 51);
-      OP4(B, C, D, A, 5, 21, 52);
-
-      OP4(A, B, C, D, 12, 6, 53);
-      OP4(D, A, B, C, 3, 10, 54);
-      OP4(C, D, A, B, 10, 15, 55);
-      OP4(B, C, D, A, 1, 21, 56);
-
-      OP4(A, B, C, D, 8, 6, 57);
-      OP4(D, A, B, C, 15, 10, 58);
-      OP4(C, D, A, B, 6, 15, 59);
-      OP4(B, C, D, A, 13, 21, 60);
-
-      OP4(A, B, C, D, 4, 6, 61);
-      OP4(D, A, B, C, 11, 10, 62);
-      OP4(C, D, A, B, 2, 15, 63);
-      OP4(B, C, D, A, 9, 21, 64);
-
-
-      A += AA;
-      B += BB;
-      C += CC;
-      D += DD;
+      md5_block(A, B, C, D, X);
       Xlen = 0;
       memset(X,0,sizeof(X));
     }
@@ -402,6 +461,203 @@ namespace Arc {
     return;
   }
 
+  // ----------------------------------------------------------------------------
+  // This is CRC32C implementation. Processors with SSE4.2 have instruction
+  // for it, otherwise tables are used.
+  // ----------------------------------------------------------------------------
+
+#ifdef HAVE_CRC32C_SSE42
+  __attribute__((target("sse4.2")))
+  static uint32_t crc32c_sse42(uint32_t c, const unsigned char *p, unsigned long long int len) {
+    uint64_t c64 = c;
+    for (; len && (((uintptr_t)p) & 7); --len, ++p) c64 = _mm_crc32_u8((uint32_t)c64, *p);
+    for (; len >= 8; len -= 8, p += 8) c64 = _mm_crc32_u64(c64, *((const uint64_t*)p));
+    for (; len; --len, ++p) c64 = _mm_crc32_u8((uint32_t)c64, *p);
+    return (uint32_t)c64;
+  }
+
+  static bool crc32c_sse42_supported(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+  }
+
+  static const bool crc32c_hw = crc32c_sse42_supported();
+#endif
+
+  static uint32_t crc32c_tables(uint32_t c, const unsigned char *p, unsigned long long int len) {
+    for (; len >= 8; len -= 8, p += 8) {
+      c ^= ((uint32_t)p[0]) | (((uint32_t)p[1]) << 8) |
+           (((uint32_t)p[2]) << 16) | (((uint32_t)p[3]) << 24);
+      c = ctables[7][c & 0xFF] ^ ctables[6][(c >> 8) & 0xFF] ^
+          ctables[5][(c >> 16) & 0xFF] ^ ctables[4][c >> 24] ^
+          ctables[3][p[4]] ^ ctables[2][p[5]] ^
+          ctables[1][p[6]] ^ ctables[0][p[7]];
+    }
+    for (; len; --len, ++p) c = (c >> 8) ^ ctables[0][(c ^ *p) & 0xFF];
+    return c;
+  }
+
+  CRC32CSum::CRC32CSum(void) {
+    start();
+  }
+
+  void CRC32CSum::start(void) {
+    r = 0xFFFFFFFF;
+    computed = false;
+  }
+
+  void CRC32CSum::add(void *buf, unsigned long long int len) {
+#ifdef HAVE_CRC32C_SSE42
+    if (crc32c_hw) {
+      r = crc32c_sse42(r, (const unsigned char*)buf, len);
+      return;
+    }
+#endif
+    r = crc32c_tables(r, (const unsigned char*)buf, len);
+  }
+
+  void CRC32CSum::end(void) {
+    if (computed) return;
+    r ^= 0xFFFFFFFF;
+    computed = true;
+  }
+
+  int CRC32CSum::print(char *buf, int len) const {
+    if (!computed) {
+      if (len > 0) buf[0] = 0;
+      return 0;
+    }
+    return snprintf(buf, len, "crc32c:%08x", r);
+  }
+
+  void CRC32CSum::scan(const char *buf) {
+    computed = false;
+    if (strncasecmp("crc32c:", buf, 7) != 0) return;
+    unsigned int rr;
+    if (sscanf(buf + 7, "%x", &rr) != 1) return;
+    r = rr;
+    computed = true;
+  }
+
+  // ----------------------------------------------------------------------------
+  // This is SHA-256 implementation as described in FIPS 180-4
+  // ----------------------------------------------------------------------------
+
+  static const uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+  };
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+  static void sha256_block(uint32_t *H, const unsigned char *p) {
+    uint32_t W[64];
+    for (int t = 0; t < 16; ++t) {
+      W[t] = (((uint32_t)p[t*4]) << 24) | (((uint32_t)p[t*4+1]) << 16) |
+             (((uint32_t)p[t*4+2]) << 8) | ((uint32_t)p[t*4+3]);
+    }
+    for (int t = 16; t < 64; ++t) {
+      uint32_t s0 = ROTR(W[t-15], 7) ^ ROTR(W[t-15], 18) ^ (W[t-15] >> 3);
+      uint32_t s1 = ROTR(W[t-2], 17) ^ ROTR(W[t-2], 19) ^ (W[t-2] >> 10);
+      W[t] = W[t-16] + s0 + W[t-7] + s1;
+    }
+    uint32_t a = H[0], b = H[1], c = H[2], d = H[3];
+    uint32_t e = H[4], f = H[5], g = H[6], h = H[7];
+    for (int t = 0; t < 64; ++t) {
+      uint32_t S1 = ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25);
+      uint32_t ch = (e & f) ^ ((~e) & g);
+      uint32_t t1 = h + S1 + ch + K256[t] + W[t];
+      uint32_t S0 = ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22);
+      uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+      uint32_t t2 = S0 + maj;
+      h = g; g = f; f = e; e = d + t1;
+      d = c; c = b; b = a; a = t1 + t2;
+    }
+    H[0] += a; H[1] += b; H[2] += c; H[3] += d;
+    H[4] += e; H[5] += f; H[6] += g; H[7] += h;
+  }
+
+#undef ROTR
+
+  SHA256Sum::SHA256Sum(void) {
+    start();
+  }
+
+  void SHA256Sum::start(void) {
+    H[0] = 0x6a09e667; H[1] = 0xbb67ae85; H[2] = 0x3c6ef372; H[3] = 0xa54ff53a;
+    H[4] = 0x510e527f; H[5] = 0x9b05688c; H[6] = 0x1f83d9ab; H[7] = 0x5be0cd19;
+    count = 0;
+    Xlen = 0;
+    memset(digest, 0, sizeof(digest));
+    computed = false;
+  }
+
+  void SHA256Sum::add(void *buf, unsigned long long int len) {
+    const unsigned char *p = (const unsigned char*)buf;
+    count += len;
+    if (Xlen > 0) {
+      unsigned int l = 64 - Xlen;
+      if (l > len) l = len;
+      memcpy(X + Xlen, p, l);
+      Xlen += l; p += l; len -= l;
+      if (Xlen < 64) return;
+      sha256_block(H, X);
+      Xlen = 0;
+    }
+    for (; len >= 64; len -= 64, p += 64) sha256_block(H, p);
+    if (len > 0) {
+      memcpy(X, p, len);
+      Xlen = len;
+    }
+  }
+
+  void SHA256Sum::end(void) {
+    if (computed) return;
+    uint64_t l = 8 * count; // number of bits
+    unsigned char pad[72];
+    unsigned int padlen = (Xlen < 56) ? (56 - Xlen) : (120 - Xlen);
+    memset(pad, 0, sizeof(pad));
+    pad[0] = 0x80;
+    for (int i = 0; i < 8; ++i) pad[padlen + i] = (unsigned char)(l >> (56 - 8 * i));
+    add(pad, padlen + 8);
+    for (int i = 0; i < 8; ++i) {
+      digest[i*4]   = (unsigned char)(H[i] >> 24);
+      digest[i*4+1] = (unsigned char)(H[i] >> 16);
+      digest[i*4+2] = (unsigned char)(H[i] >> 8);
+      digest[i*4+3] = (unsigned char)(H[i]);
+    }
+    computed = true;
+  }
+
+  int SHA256Sum::print(char *buf, int len) const {
+    if (!computed) {
+      if (len > 0) buf[0] = 0;
+      return 0;
+    }
+    char hex[65];
+    for (int i = 0; i < 32; ++i) snprintf(hex + i*2, 3, "%02x", (unsigned int)digest[i]);
+    return snprintf(buf, len, "sha256:%s", hex);
+  }
+
+  void SHA256Sum::scan(const char *buf) {
+    computed = false;
+    if (strncasecmp("sha256:", buf, 7) != 0) return;
+    buf += 7;
+    for (int i = 0; i < 32; ++i) {
+      unsigned int v;
+      if ((!isxdigit(buf[i*2])) || (!isxdigit(buf[i*2+1]))) return;
+      if (sscanf(buf + i*2, "%2x", &v) != 1) return;
+      digest[i] = v;
+    }
+    computed = true;
+  }
+
   // --------------------------------------------------------------------------
   // This is a wrapper for any supported checksum
   // --------------------------------------------------------------------------
@@ -426,6 +682,16 @@ namespace Arc {
       tp=adler32;
       return;
     }
+    if (strncasecmp("crc32c", type, 6) == 0) {
+      cs = new CRC32CSum;
+      tp = crc32c;
+      return;
+    }
+    if (strncasecmp("sha256", type, 6) == 0) {
+      cs = new SHA256Sum;
+      tp = sha256;
+      return;
+    }
   }
 
   CheckSumAny::CheckSumAny(type type) {
@@ -444,6 +710,16 @@ namespace Arc {
       tp = type;
       return;
     }
+    if (type == crc32c) {
+      cs = new CRC32CSum;
+      tp = type;
+      return;
+    }
+    if (type == sha256) {
+      cs = new SHA256Sum;
+      tp = type;
+      return;
+    }
   }
 
   CheckSumAny::type CheckSumAny::Type(const char *crc) {
@@ -467,6 +743,10 @@ namespace Arc {
       return md5;
     if (((p - crc) == 7) && (strncasecmp(crc, "adler32", 7) == 0))
       return adler32;
+    if (((p - crc) == 6) && (strncasecmp(crc, "crc32c", 6) == 0))
+      return crc32c;
+    if (((p - crc) == 6) && (strncasecmp(crc, "sha256", 6) == 0))
+      return sha256;
     if (((p - crc) == 9) && (strncasecmp(crc, "undefined", 9) == 0))
       return undefined;
     return unknown;
@@ -494,6 +774,16 @@ namespace Arc {
       tp = adler32;
       return;
     }
+    if (strncasecmp("crc32c", type, 6) == 0) {
+      cs = new CRC32CSum;
+      tp = crc32c;
+      return;
+    }
+    if (strncasecmp("sha256", type, 6) == 0) {
+      cs = new SHA256Sum;
+      tp = sha256;
+      return;
+    }
   }
 
   bool CheckSumAny::operator==(const char *s) {
@@ -15,7 +15,7 @@ namespace Arc {
 
   /// Interface for checksum manipulations.
   /** This class is an interface and is extended in the specialized classes
-   * CRC32Sum, MD5Sum and Adler32Sum. The interface is among others used
+   * CRC32Sum, MD5Sum, Adler32Sum, CRC32CSum and SHA256Sum. The interface is among others used
    * during data transfers through DataBuffer class. The helper class
    * CheckSumAny can be used as an easier way of handling automatically the
    * different checksum types.
@@ -24,6 +24,8 @@ namespace Arc {
    * @see CRC32Sum
    * @see MD5Sum
    * @see Adler32Sum
+   * @see CRC32CSum
+   * @see SHA256Sum
    * @ingroup common
    * @headerfile CheckSum.h arc/CheckSum.h
    **/
@@ -65,8 +67,9 @@ namespace Arc {
      * The passed string buf is filled with result of checksum algorithm in
      * base 16. At most len characters are filled into buffer buf. The
      * hexadecimal value is prepended with "algorithm:", where algorithm
-     * is one of "cksum", "md5" or "adler32" respectively corresponding to
-     * the result from the CRC32Sum, MD5Sum and Adler32 classes.
+     * is one of "cksum", "md5", "adler32", "crc32c" or "sha256" respectively
+     * corresponding to the result from the CRC32Sum, MD5Sum, Adler32,
+     * CRC32CSum and SHA256Sum classes.
      *
      * @param buf pointer to buffer which should be filled with checksum
      *  result.
@@ -223,6 +226,76 @@ namespace Arc {
     }
   };
 
+  /// Implementation of CRC32C checksum
+  /**
+   * This class is a specialized class of the CheckSum class. It provides an
+   * implementation of CRC-32 with Castagnoli polynomial as used by iSCSI
+   * and object stores. On x86-64 processors supporting SSE4.2 dedicated
+   * instruction is used.
+   * @ingroup common
+   * @headerfile CheckSum.h arc/CheckSum.h
+   **/
+  class CRC32CSum
+    : public CheckSum {
+  private:
+    uint32_t r;
+    bool computed;
+  public:
+    CRC32CSum(void);
+    virtual ~CRC32CSum(void) {}
+    virtual void start(void);
+    virtual void add(void *buf, unsigned long long int len);
+    virtual void end(void);
+    virtual void result(unsigned char*& res, unsigned int& len) const {
+      res = (unsigned char*)&r;
+      len = 4;
+    }
+    virtual int print(char *buf, int len) const;
+    virtual void scan(const char *buf);
+    virtual operator bool(void) const {
+      return computed;
+    }
+    virtual bool operator!(void) const {
+      return !computed;
+    }
+  };
+
+  /// Implementation of SHA-256 checksum
+  /**
+   * This class is a specialized class of the CheckSum class. It provides an
+   * implementation of the SHA-256 secure hash algorithm specified in
+   * FIPS 180-4.
+   * @ingroup common
+   * @headerfile CheckSum.h arc/CheckSum.h
+   **/
+  class SHA256Sum
+    : public CheckSum {
+  private:
+    bool computed;
+    uint32_t H[8];
+    uint64_t count;
+    unsigned char X[64];
+    unsigned int Xlen;
+    unsigned char digest[32];
+  public:
+    SHA256Sum(void);
+    virtual void start(void);
+    virtual void add(void *buf, unsigned long long int len);
+    virtual void end(void);
+    virtual void result(unsigned char*& res, unsigned int& len) const {
+      res = (unsigned char*)digest;
+      len = 32;
+    }
+    virtual int print(char *buf, int len) const;
+    virtual void scan(const char *buf);
+    virtual operator bool(void) const {
+      return computed;
+    }
+    virtual bool operator!(void) const {
+      return !computed;
+    }
+  };
+
   /// Wrapper for CheckSum class
   /**
    * To be used for manipulation of any supported checksum type in a
@@ -240,7 +313,9 @@ namespace Arc {
       undefined, ///< Undefined checksum
       cksum,     ///< CRC32 checksum
       md5,       ///< MD5 checksum
-      adler32    ///< ADLER32 checksum
+      adler32,   ///< ADLER32 checksum
+      crc32c,    ///< CRC32C checksum
+      sha256     ///< SHA-256 checksum
     } type;
   private:
     CheckSum *cs;
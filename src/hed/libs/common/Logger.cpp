@@ -8,6 +8,8 @@
 
 #include <unistd.h>
 
+#include <glib.h>
+
 #include <arc/DateTime.h>
 #include <arc/StringConv.h>
 #include <arc/Utils.h>
@@ -432,6 +434,191 @@ namespace Arc {
     }
   }
 
+  class LogQueue::Cell {
+   public:
+    // Equals position of message which may be stored in this cell
+    // or position+1 if message is stored already.
+    int sequence;
+    LogMessage* message;
+  };
+
+  // Positions are compared as differences because they wrap around.
+  static inline int pos_diff(int a, int b) {
+    return (int)((unsigned int)a - (unsigned int)b);
+  }
+
+  static inline int pos_add(int pos, unsigned int n) {
+    return (int)((unsigned int)pos + n);
+  }
+
+  static const unsigned int MaxLogQueueSize = 1048576;
+
+  LogQueue::LogQueue(LogDestination& destination,
+                     unsigned int size,
+                     OverflowPolicy policy)
+    : destination(destination),
+      policy(policy),
+      cells(NULL),
+      mask(0),
+      push_pos(0),
+      pop_pos(0),
+      written(0),
+      sleeping(0),
+      waiting(0),
+      dropped(0),
+      reported(0),
+      running(false),
+      exiting(false) {
+    unsigned int capacity = 2;
+    while((capacity < size) && (capacity < MaxLogQueueSize)) capacity <<= 1;
+    mask = capacity - 1;
+    cells = new Cell[capacity];
+    for(unsigned int n = 0; n < capacity; ++n) {
+      cells[n].sequence = n;
+      cells[n].message = NULL;
+    }
+    running = CreateThreadFunction(&writer, this, &thread);
+  }
+
+  LogQueue::~LogQueue() {
+    if(running) {
+      Glib::Mutex::Lock lock(queue_mutex);
+      exiting = true;
+      queue_cond.broadcast();
+    }
+    thread.wait();
+    delete[] cells;
+  }
+
+  // Bounded queue with multiple producers and single consumer. Producers
+  // reserve position by advancing push_pos and then publish message by
+  // updating sequence of its cell.
+  bool LogQueue::push(LogMessage* message) {
+    int pos = g_atomic_int_get(&push_pos);
+    while(true) {
+      Cell& cell = cells[(unsigned int)pos & mask];
+      int diff = pos_diff(g_atomic_int_get(&cell.sequence), pos);
+      if(diff == 0) {
+        if(g_atomic_int_compare_and_exchange(&push_pos, pos, pos_add(pos, 1))) {
+          cell.message = message;
+          g_atomic_int_set(&cell.sequence, pos_add(pos, 1));
+          return true;
+        }
+      } else if(diff < 0) {
+        return false; // cell is not written out yet - queue is full
+      }
+      pos = g_atomic_int_get(&push_pos);
+    }
+  }
+
+  LogMessage* LogQueue::pop() {
+    Cell& cell = cells[(unsigned int)pop_pos & mask];
+    if(pos_diff(g_atomic_int_get(&cell.sequence), pos_add(pop_pos, 1)) < 0) return NULL;
+    LogMessage* message = cell.message;
+    cell.message = NULL;
+    g_atomic_int_set(&cell.sequence, pos_add(pop_pos, mask + 1));
+    pop_pos = pos_add(pop_pos, 1);
+    return message;
+  }
+
+  bool LogQueue::empty() {
+    Cell& cell = cells[(unsigned int)pop_pos & mask];
+    return (pos_diff(g_atomic_int_get(&cell.sequence), pos_add(pop_pos, 1)) < 0);
+  }
+
+  void LogQueue::wake() {
+    Glib::Mutex::Lock lock(queue_mutex);
+    queue_cond.broadcast();
+  }
+
+  void LogQueue::log(const LogMessage& message) {
+    if(!running) {
+      destination.log(message);
+      return;
+    }
+    LogMessage* copy = new LogMessage(message);
+    while(!push(copy)) {
+      if(policy != Block) {
+        delete copy;
+        Glib::Mutex::Lock lock(queue_mutex);
+        ++dropped;
+        return;
+      }
+      Glib::Mutex::Lock lock(queue_mutex);
+      g_atomic_int_inc(&waiting);
+      queue_cond.broadcast();
+      Glib::TimeVal till;
+      till.assign_current_time();
+      till.add_milliseconds(10);
+      queue_cond.timed_wait(queue_mutex, till);
+      g_atomic_int_add(&waiting, -1);
+    }
+    // Writing thread sets flag before checking queue for last time,
+    // so either it sees this message or it is woken up here.
+    if(g_atomic_int_get(&sleeping)) wake();
+  }
+
+  void LogQueue::flush() {
+    if(!running) return;
+    int target = g_atomic_int_get(&push_pos);
+    Glib::Mutex::Lock lock(queue_mutex);
+    g_atomic_int_inc(&waiting);
+    while(pos_diff(g_atomic_int_get(&written), target) < 0) {
+      queue_cond.broadcast();
+      Glib::TimeVal till;
+      till.assign_current_time();
+      till.add_milliseconds(100);
+      queue_cond.timed_wait(queue_mutex, till);
+    }
+    g_atomic_int_add(&waiting, -1);
+  }
+
+  unsigned long long int LogQueue::getDropped() const {
+    Glib::Mutex::Lock lock(queue_mutex);
+    return dropped;
+  }
+
+  void LogQueue::report() {
+    unsigned long long int n = 0;
+    {
+      Glib::Mutex::Lock lock(queue_mutex);
+      n = dropped - reported;
+      reported = dropped;
+    }
+    if(n == 0) return;
+    destination.log(LogMessage(WARNING, IString("Log queue was full, %llu messages were dropped", n)));
+  }
+
+  void LogQueue::writer(void* arg) {
+    ((LogQueue*)arg)->write();
+  }
+
+  void LogQueue::write() {
+    while(true) {
+      LogMessage* message = pop();
+      if(message) {
+        destination.log(*message);
+        delete message;
+        g_atomic_int_inc(&written);
+        if(g_atomic_int_get(&waiting)) wake();
+        continue;
+      }
+      report();
+      Glib::Mutex::Lock lock(queue_mutex);
+      g_atomic_int_set(&sleeping, 1);
+      if(!empty()) {
+        g_atomic_int_set(&sleeping, 0);
+        continue;
+      }
+      if(exiting) break;
+      Glib::TimeVal till;
+      till.assign_current_time();
+      till.add_seconds(1);
+      queue_cond.timed_wait(queue_mutex, till);
+      g_atomic_int_set(&sleeping, 0);
+    }
+  }
+
   class LoggerContextRef: public ThreadDataItem {
     friend class Logger;
     private:
@@ -457,6 +644,51 @@ namespace Arc {
     new LoggerContextRef(context,id);
   }
 
+  // Number of logger contexts having every threshold, indexed by level.
+  // Plain integers are used because contexts of static Logger objects are
+  // created during static initialization when no mutex may be available yet.
+  static int threshold_counts[FATAL+1];
+  // Incremented on every change of threshold_counts.
+  static int threshold_generation = 0;
+
+  volatile int Logger::lowestThreshold = 0;
+
+  void LoggerContext::CountThreshold(LogLevel threshold, int change) {
+    if((threshold <= 0) || (threshold > FATAL)) return; // inherited
+    g_atomic_int_add(&threshold_counts[threshold], change);
+    g_atomic_int_inc(&threshold_generation);
+    // Concurrent changes may compute lowest threshold from different
+    // counts. Repeat till no change happened while computing, so the
+    // last stored value reflects all counts.
+    int generation;
+    do {
+      generation = g_atomic_int_get(&threshold_generation);
+      int lowest = 0;
+      for(int level = DEBUG; level <= FATAL; ++level) {
+        if(g_atomic_int_get(&threshold_counts[level]) > 0) {
+          lowest = level;
+          break;
+        }
+      }
+      g_atomic_int_set(&Logger::lowestThreshold, lowest);
+    } while(generation != g_atomic_int_get(&threshold_generation));
+  }
+
+  LoggerContext::LoggerContext(LogLevel thr):usage_count(0),threshold(thr) {
+    CountThreshold(threshold, 1);
+  }
+
+  LoggerContext::LoggerContext(const LoggerContext& ctx):
+         usage_count(0),destinations(ctx.destinations),threshold(ctx.threshold) {
+    CountThreshold(threshold, 1);
+  }
+
+  void LoggerContext::SetThreshold(LogLevel thr) {
+    CountThreshold(thr, 1);
+    CountThreshold(threshold, -1);
+    threshold = thr;
+  }
+
   void LoggerContext::Acquire(void) {
     mutex.lock();
     ++usage_count;
@@ -474,6 +706,7 @@ namespace Arc {
   }
 
   LoggerContext::~LoggerContext(void) {
+    CountThreshold(threshold, -1);
     mutex.trylock();
     mutex.unlock();
   }
@@ -499,7 +732,7 @@ namespace Arc {
     std::map<std::string,LogLevel>::const_iterator thr =
                                    defaultThresholds->find(domain);
     if(thr != defaultThresholds->end()) {
-      context.threshold = thr->second;
+      context.SetThreshold(thr->second);
     }
   }
 
@@ -573,7 +806,7 @@ namespace Arc {
 
   void Logger::setThreshold(LogLevel threshold) {
     SharedMutexExclusiveLock lock(mutex);
-    this->getContext().threshold = threshold;
+    this->getContext().SetThreshold(threshold);
   }
 
   void Logger::setThresholdForDomain(LogLevel threshold,
@@ -619,12 +852,18 @@ namespace Arc {
   }
 
   void Logger::msg(LogMessage message) {
+    if (!mayLog(message.getLevel())) return;
     message.setDomain(domain);
     if (message.getLevel() >= getThreshold()) {
       log(message);
     }
   }
 
+  void Logger::forward(LogMessage message) {
+    message.setDomain(domain);
+    log(message);
+  }
+
   Logger::Logger()
     : parent(0),
       domain("Arc"),
@@ -416,6 +416,97 @@ namespace Arc {
     Glib::Mutex file_mutex;
   };
 
+  /// A class for writing log messages asynchronously.
+  /** This class passes LogMessages to another LogDestination through
+     a queue of fixed size served by a dedicated thread. Hence threads
+     producing messages are not delayed by slow destinations like files
+     on network file systems. Storing message in the queue takes no lock
+     unless the writing thread is idle and must be woken up. If queue
+     is full the message is either dropped or the caller waits for free
+     space, as defined by OverflowPolicy. Dropped messages are counted
+     and their number is reported through the wrapped destination.
+
+     Messages are formatted by the wrapped destination, so format and
+     prefix of LogQueue itself are not used. The wrapped destination
+     must exist as long as the LogQueue object and should not be
+     attached to any Logger directly. Messages still queued are written
+     before the destructor returns.
+     \headerfile Logger.h arc/Logger.h
+   */
+  class LogQueue
+    : public LogDestination {
+  public:
+
+    /// Defines what happens to message which does not fit into queue.
+    enum OverflowPolicy {
+      /// New message is dropped and counted
+      DropNew,
+      /// Caller waits till there is space in the queue
+      Block
+    };
+
+    /// Creates a LogQueue writing to another LogDestination.
+    /** @param destination The LogDestination to which to write LogMessages.
+       @param size Maximal number of queued messages. Rounded up to power of 2.
+       @param policy What to do if queue is full.
+     */
+    LogQueue(LogDestination& destination,
+             unsigned int size = 4096,
+             OverflowPolicy policy = DropNew);
+
+    /// Writes all queued messages and stops writing thread.
+    virtual ~LogQueue();
+
+    /// Stores a LogMessage in the queue.
+    /** If writing thread could not be started the message is written
+       to the wrapped destination immediately.
+       @param message The LogMessage to write.
+     */
+    virtual void log(const LogMessage& message);
+
+    /// Waits till all messages queued so far are written.
+    void flush();
+
+    /// Returns number of messages dropped because queue was full.
+    unsigned long long int getDropped() const;
+
+  private:
+    LogQueue(const LogQueue& unique);
+    void operator=(const LogQueue& unique);
+
+    class Cell;
+
+    bool push(LogMessage* message);
+    LogMessage* pop();
+    bool empty();
+    void wake();
+    void report();
+    static void writer(void* arg);
+    void write();
+
+    LogDestination& destination;
+    OverflowPolicy policy;
+    Cell* cells;
+    unsigned int mask;
+    /// Position for storing next message. Shared by producers.
+    int push_pos;
+    /// Position of next message to write. Used by writing thread only.
+    int pop_pos;
+    /// Number of written messages.
+    int written;
+    /// Set while writing thread waits for messages.
+    int sleeping;
+    /// Number of producers waiting for space or for messages to be written.
+    int waiting;
+    unsigned long long int dropped;
+    unsigned long long int reported;
+    bool running;
+    bool exiting;
+    mutable Glib::Mutex queue_mutex;
+    Glib::Cond queue_cond;
+    SimpleCounter thread;
+  };
+
   class LoggerContextRef;
 
   /** \cond Container for internal logger configuration.
@@ -436,13 +527,18 @@ namespace Arc {
       /// The threshold of Logger.
       LogLevel threshold;
 
-      LoggerContext(LogLevel thr):usage_count(0),threshold(thr) { };
+      LoggerContext(LogLevel thr);
 
-      LoggerContext(const LoggerContext& ctx):
-             usage_count(0),destinations(ctx.destinations),threshold(ctx.threshold) { };
+      LoggerContext(const LoggerContext& ctx);
 
       ~LoggerContext(void);
 
+      /// Changes threshold keeping track of lowest threshold in use.
+      void SetThreshold(LogLevel thr);
+
+      /// Updates Logger::lowestThreshold after context with threshold appeared or disappeared.
+      static void CountThreshold(LogLevel thr, int change);
+
       void Acquire(void);
 
       void Release(void);
@@ -589,6 +685,23 @@ namespace Arc {
     /// Returns the threshold of this logger.
     LogLevel getThreshold() const;
 
+    /// Returns true if messages of specified level are logged by this logger.
+    /** The msg() methods do this check before message is composed. It may
+       also be used to avoid computing expensive arguments of messages
+       which would be discarded anyway. See also LOG macro.
+     */
+    bool isEnabled(LogLevel level) const {
+      return mayLog(level) && (level >= getThreshold());
+    }
+
+    /// Returns false if messages of specified level are discarded by all loggers.
+    /** This check takes no locks and costs one comparison. It is based
+       on the lowest threshold set in any logger and in any thread context.
+     */
+    static bool mayLog(LogLevel level) {
+      return (int)level >= lowestThreshold;
+    }
+
     /// Creates per-thread context.
     /** Creates new context for this logger which becomes effective
        for operations initiated by this thread. All new threads 
@@ -619,62 +732,76 @@ namespace Arc {
        @param str The message text.
      */
     void msg(LogLevel level, const std::string& str) {
-      msg(LogMessage(level, IString(str)));
+      if (isEnabled(level))
+        forward(LogMessage(level, IString(str)));
+    }
+
+    void msg(LogLevel level, const char* str) {
+      if (isEnabled(level))
+        forward(LogMessage(level, IString(str)));
     }
 
-    template<class T0>
-    void msg(LogLevel level, const std::string& str,
+    template<class S, class T0>
+    void msg(LogLevel level, const S& str,
              const T0& t0) {
-      msg(LogMessage(level, IString(str, t0)));
+      if (isEnabled(level))
+        forward(LogMessage(level, IString(str, t0)));
     }
 
-    template<class T0, class T1>
-    void msg(LogLevel level, const std::string& str,
+    template<class S, class T0, class T1>
+    void msg(LogLevel level, const S& str,
              const T0& t0, const T1& t1) {
-      msg(LogMessage(level, IString(str, t0, t1)));
+      if (isEnabled(level))
+        forward(LogMessage(level, IString(str, t0, t1)));
     }
 
-    template<class T0, class T1, class T2>
-    void msg(LogLevel level, const std::string& str,
+    template<class S, class T0, class T1, class T2>
+    void msg(LogLevel level, const S& str,
              const T0& t0, const T1& t1, const T2& t2) {
-      msg(LogMessage(level, IString(str, t0, t1, t2)));
+      if (isEnabled(level))
+        forward(LogMessage(level, IString(str, t0, t1, t2)));
     }
 
-    template<class T0, class T1, class T2, class T3>
-    void msg(LogLevel level, const std::string& str,
+    template<class S, class T0, class T1, class T2, class T3>
+    void msg(LogLevel level, const S& str,
              const T0& t0, const T1& t1, const T2& t2, const T3& t3) {
-      msg(LogMessage(level, IString(str, t0, t1, t2, t3)));
+      if (isEnabled(level))
+        forward(LogMessage(level, IString(str, t0, t1, t2, t3)));
     }
 
-    template<class T0, class T1, class T2, class T3, class T4>
-    void msg(LogLevel level, const std::string& str,
+    template<class S, class T0, class T1, class T2, class T3, class T4>
+    void msg(LogLevel level, const S& str,
              const T0& t0, const T1& t1, const T2& t2, const T3& t3,
              const T4& t4) {
-      msg(LogMessage(level, IString(str, t0, t1, t2, t3, t4)));
+      if (isEnabled(level))
+        forward(LogMessage(level, IString(str, t0, t1, t2, t3, t4)));
     }
 
-    template<class T0, class T1, class T2, class T3, class T4,
+    template<class S, class T0, class T1, class T2, class T3, class T4,
              class T5>
-    void msg(LogLevel level, const std::string& str,
+    void msg(LogLevel level, const S& str,
              const T0& t0, const T1& t1, const T2& t2, const T3& t3,
              const T4& t4, const T5& t5) {
-      msg(LogMessage(level, IString(str, t0, t1, t2, t3, t4, t5)));
+      if (isEnabled(level))
+        forward(LogMessage(level, IString(str, t0, t1, t2, t3, t4, t5)));
     }
 
-    template<class T0, class T1, class T2, class T3, class T4,
+    template<class S, class T0, class T1, class T2, class T3, class T4,
              class T5, class T6>
-    void msg(LogLevel level, const std::string& str,
+    void msg(LogLevel level, const S& str,
              const T0& t0, const T1& t1, const T2& t2, const T3& t3,
              const T4& t4, const T5& t5, const T6& t6) {
-      msg(LogMessage(level, IString(str, t0, t1, t2, t3, t4, t5, t6)));
+      if (isEnabled(level))
+        forward(LogMessage(level, IString(str, t0, t1, t2, t3, t4, t5, t6)));
     }
 
-    template<class T0, class T1, class T2, class T3, class T4,
+    template<class S, class T0, class T1, class T2, class T3, class T4,
              class T5, class T6, class T7>
-    void msg(LogLevel level, const std::string& str,
+    void msg(LogLevel level, const S& str,
              const T0& t0, const T1& t1, const T2& t2, const T3& t3,
              const T4& t4, const T5& t5, const T6& t6, const T7& t7) {
-      msg(LogMessage(level, IString(str, t0, t1, t2, t3, t4, t5, t6, t7)));
+      if (isEnabled(level))
+        forward(LogMessage(level, IString(str, t0, t1, t2, t3, t4, t5, t6, t7)));
     }
 
   private:
@@ -715,6 +842,9 @@ namespace Arc {
      */
     void log(const LogMessage& message);
 
+    /// Sends a LogMessage which already passed threshold.
+    void forward(LogMessage message);
+
     /// A pointer to the parent of this logger.
     Logger *parent;
 
@@ -736,6 +866,10 @@ namespace Arc {
     static Logger *rootLogger;
     static std::map<std::string,LogLevel>* defaultThresholds;
     static unsigned int rootLoggerMark;
+
+    /// Lowest threshold of all existing logger contexts.
+    static volatile int lowestThreshold;
+    friend class LoggerContext;
   };
 
   /** @} */
@@ -744,6 +878,12 @@ namespace Arc {
 
 #define rootLogger getRootLogger()
 
-#define LOG(LGR, THR, FSTR, ...) { if ((LGR).getThreshold() >= (THR)(LGR).msg((THR), (FSTR), ...); }
+/// Logs message only evaluating its arguments if it passes threshold.
+/** Usage is same as for Logger::msg():
+   @code
+   LOG(logger, Arc::DEBUG, "Received %s", payload.str());
+   @endcode
+ */
+#define LOG(LGR, THR, ...) { if ((LGR).isEnabled(THR)) (LGR).msg((THR), __VA_ARGS__); }
 
 #endif // __ARC_LOGGER__
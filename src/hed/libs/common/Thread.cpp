@@ -89,14 +89,6 @@ namespace Arc {
   };
 #endif
 
-#ifdef USE_THREAD_POOL
-  class ThreadInc {
-   public:
-    ThreadInc(void);
-    ~ThreadInc(void);
-  };
-#endif
-
   class ThreadArgument {
   public:
     typedef void (*func_t)(void*);
@@ -108,15 +100,8 @@ namespace Arc {
     ThreadData* data;
 #endif
 #ifdef USE_THREAD_POOL
-    ThreadInc* resource;
-    ThreadArgument& acquire(void) {
-      resource = new ThreadInc;
-      return *this;
-    }
-    void release(void) {
-      if(resource) delete resource;
-      resource = NULL;
-    }
+    // Time request was passed to pool
+    Glib::TimeVal submitted;
 #endif
 
     ThreadArgument(
@@ -133,9 +118,6 @@ namespace Arc {
         count(c)
 #ifdef USE_THREAD_DATA
         ,data(d)
-#endif
-#ifdef USE_THREAD_POOL
-        ,resource(NULL)
 #endif
     {}
 
@@ -152,41 +134,54 @@ namespace Arc {
         count(c)
 #ifdef USE_THREAD_DATA
         ,data(d)
-#endif
-#ifdef USE_THREAD_POOL
-        ,resource(NULL)
 #endif
     {}
 
     ~ThreadArgument(void) { }
 
+    // Body of dedicated thread
     void thread(void);
 
+    // Runs requested function in current thread and destroys this object
+    void run(void);
+
   };
 
 
 #ifdef USE_THREAD_POOL
-  // This is not a real pool. It is just a queue of requests for
-  // new threads. Hopefuly it will be converted to pool later for
-  // better performance.
+  // Pool of persistent worker threads. Request is handed to idle worker
+  // if there is one. Otherwise new worker is created unless maximal number
+  // of threads is reached, in which case request waits in queue. Because
+  // requests may block for any time - many are service loops - request
+  // never waits for busy worker while new thread can be created. Finished
+  // workers wait for new requests for a while before exiting, so short
+  // requests do not pay for thread creation.
   class ThreadPool {
-   public:
-   friend class ThreadInc;
    private:
+    // Maximal number of idle workers kept
+    static const int max_idle = 32;
+    // Time in milliseconds idle worker waits for new request
+    static const int idle_timeout = 60000;
     int max_count;
     int count;
-    Glib::Mutex count_lock;
-    Glib::Mutex queue_lock;
+    int idle;
+    int busy;
+    Glib::Mutex lock;
+    Glib::Cond cond;
     std::list<ThreadArgument*> queue;
-    int CheckQueue(void);
+    ThreadPoolStats stats;
+    bool StartWorker(void);
+    void Worker(void);
     ~ThreadPool(void) { };
    public:
     ThreadPool(void);
-    void PushQueue(ThreadArgument* arg);
-    int Num(void) { return count; };
+    bool PushQueue(ThreadArgument* arg);
+    // Number of running and waiting requests
+    int Num(void);
+    ThreadPoolStats Stats(void);
   };
 
-  ThreadPool::ThreadPool(void):max_count(0),count(0) {
+  ThreadPool::ThreadPool(void):max_count(0),count(0),idle(0),busy(0) {
     // Estimating amount of available memory 
     uint64_t n_max;
     {
@@ -225,74 +220,131 @@ namespace Arc {
     //threadLogger.msg(DEBUG, "Maximum number of threads is %i",max_count);
   }
 
-  int ThreadPool::CheckQueue(void) {
-    Glib::Mutex::Lock lock(queue_lock, Glib::TRY_LOCK);
-    if(!lock.locked()) return -1;
-    int size = queue.size();
-    while((count < max_count) && (size > 0)) {
-      ThreadArgument* argument = *(queue.begin());
-      argument->acquire();
-      try {
-        ThreadCreate(sigc::mem_fun(*argument,
-                     &ThreadArgument::thread),
-                     thread_stacksize, false, false,
-                     Glib::THREAD_PRIORITY_NORMAL);
-        queue.erase(queue.begin());
-      } catch (Glib::Error& e) {
-        threadLogger.msg(ERROR, "%s", e.what());
-        argument->release();
-      } catch (Glib::Exception& e) {
-        threadLogger.msg(ERROR, "%s", e.what());
-        argument->release();
-      } catch (std::exception& e) {
-        threadLogger.msg(ERROR, "%s", e.what());
-        argument->release();
-      };
-      size = queue.size();
-    }
-    return size;
+  bool ThreadPool::StartWorker(void) {
+    // Called with lock held. Thread is created without lock because
+    // creation switches user identity and hence takes other locks.
+    ++count;
+    ++(stats.created);
+    lock.unlock();
+    bool started = false;
+    try {
+      ThreadCreate(sigc::mem_fun(*this, &ThreadPool::Worker),
+                   thread_stacksize, false, false,
+                   Glib::THREAD_PRIORITY_NORMAL);
+      started = true;
+    } catch (Glib::Error& e) {
+      threadLogger.msg(ERROR, "%s", e.what());
+    } catch (Glib::Exception& e) {
+      threadLogger.msg(ERROR, "%s", e.what());
+    } catch (std::exception& e) {
+      threadLogger.msg(ERROR, "%s", e.what());
+    };
+    lock.lock();
+    if(!started) {
+      --count;
+      --(stats.created);
+    };
+    return started;
   }
 
-  void ThreadPool::PushQueue(ThreadArgument* arg) {
-    Glib::Mutex::Lock lock(queue_lock);
+  bool ThreadPool::PushQueue(ThreadArgument* arg) {
+    Glib::Mutex::Lock lock_(lock);
+    arg->submitted.assign_current_time();
     queue.push_back(arg);
-    lock.release();
-    if(CheckQueue() > 0)
+    ++(stats.requests);
+    if((int)queue.size() > stats.max_queued) stats.max_queued = queue.size();
+    if(idle >= (int)queue.size()) {
+      // One of idle workers will pick it up
+      cond.signal();
+      return true;
+    };
+    if(count < max_count) {
+      if(StartWorker()) return true;
+    };
+    if(count > 0) {
+      lock_.release();
       threadLogger.msg(INFO, "Maximum number of threads running - putting new request into queue");
+      return true;
+    };
+    // Nobody will ever process this request
+    for(std::list<ThreadArgument*>::iterator a = queue.begin(); a != queue.end(); ++a) {
+      if(*a == arg) {
+        queue.erase(a);
+        break;
+      };
+    };
+    return false;
   }
 
-  static ThreadPool* pool = NULL;
+  void ThreadPool::Worker(void) {
+#ifdef USE_SEQUENTIAL_THREAD_ID
+    ThreadId::getInstance().add();
+#endif
+    // Requests may change signal mask. Following request must get clean one.
+    sigset_t sigs;
+    sigemptyset(&sigs);
+    pthread_sigmask(SIG_SETMASK, NULL, &sigs);
+    Glib::Mutex::Lock lock_(lock);
+    for(;;) {
+      if(queue.empty()) {
+        if(idle >= max_idle) break;
+        ++idle;
+        Glib::TimeVal etime;
+        etime.assign_current_time();
+        etime.add_milliseconds(idle_timeout);
+        while(queue.empty()) {
+          if(!cond.timed_wait(lock, etime)) break;
+        };
+        --idle;
+        if(queue.empty()) break;
+      };
+      ThreadArgument* argument = queue.front();
+      queue.pop_front();
+      Glib::TimeVal now;
+      now.assign_current_time();
+      now.subtract(argument->submitted);
+      unsigned long long int wait = (now.tv_sec < 0) ? 0 :
+              ((unsigned long long int)now.tv_sec)*1000000 + now.tv_usec;
+      stats.wait_time += wait;
+      if(wait > stats.max_wait_time) stats.max_wait_time = wait;
+      ++busy;
+      lock_.release();
+      argument->run();
+      pthread_sigmask(SIG_SETMASK, &sigs, NULL);
+      lock_.acquire();
+      --busy;
+    };
+    --count;
+    lock_.release();
+#ifdef USE_SEQUENTIAL_THREAD_ID
+    ThreadId::getInstance().remove();
+#endif
+  }
 
-  ThreadInc::ThreadInc(void) {
-    if(!pool) return;
-    pool->count_lock.lock();
-    ++(pool->count);
-    pool->count_lock.unlock();
+  int ThreadPool::Num(void) {
+    Glib::Mutex::Lock lock_(lock);
+    return busy + queue.size();
   }
 
-  ThreadInc::~ThreadInc(void) {
-    if(!pool) return;
-    pool->count_lock.lock();
-    --(pool->count);
-    pool->count_lock.unlock();
-    pool->CheckQueue();
+  ThreadPoolStats ThreadPool::Stats(void) {
+    Glib::Mutex::Lock lock_(lock);
+    ThreadPoolStats result = stats;
+    result.workers = count;
+    result.idle = idle;
+    result.queued = queue.size();
+    return result;
   }
-#endif
 
-  void ThreadArgument::thread(void) {
-#ifdef USE_SEQUENTIAL_THREAD_ID
-    ThreadId::getInstance().add();
+  static ThreadPool* pool = NULL;
 #endif
+
+  void ThreadArgument::run(void) {
 #ifdef USE_THREAD_DATA
     ThreadData* tdata = ThreadData::Get();
     if(tdata) {
       tdata->Inherit(data);
       tdata->Release();
     }
-#endif
-#ifdef USE_THREAD_POOL
-    ThreadInc resource_;
-    release();
 #endif
     func_t f_temp = func;
     void *a_temp = arg;
@@ -314,8 +366,16 @@ namespace Arc {
     };
     if(c_temp) c_temp->dec();
 #ifdef USE_THREAD_DATA
+    // Worker may be reused - items must not leak into next request
     ThreadData::Remove();
 #endif
+  }
+
+  void ThreadArgument::thread(void) {
+#ifdef USE_SEQUENTIAL_THREAD_ID
+    ThreadId::getInstance().add();
+#endif
+    run();
 #ifdef USE_SEQUENTIAL_THREAD_ID
     ThreadId::getInstance().remove();
 #endif
@@ -354,71 +414,58 @@ namespace Arc {
 #endif
   }
 
-  bool CreateThreadFunction(void (*func)(void*), void *arg, SimpleCounter* count
-) {
-#ifdef USE_THREAD_POOL
-    if(!pool) return false;
-#ifdef USE_THREAD_DATA
-    ThreadArgument *argument = new ThreadArgument(func, arg, count, ThreadData::Get());
-#else
-    ThreadArgument *argument = new ThreadArgument(func, arg, count);
-#endif
+  static bool StartThread(ThreadArgument *argument, SimpleCounter* count) {
     if(count) count->inc();
-    pool->PushQueue(argument);
-#else
-#ifdef USE_THREAD_DATA
-    ThreadArgument *argument = new ThreadArgument(func, arg, count, ThreadData::Get());
+#ifdef USE_THREAD_POOL
+    if(pool->PushQueue(argument)) return true;
 #else
-    ThreadArgument *argument = new ThreadArgument(func, arg, count);
-#endif
-    if(count) count->inc();
     try {
       ThreadCreate(sigc::mem_fun(*argument, &ThreadArgument::thread),
                                  thread_stacksize, false, false,
                                  Glib::THREAD_PRIORITY_NORMAL);
+      return true;
     } catch (std::exception& e) {
       threadLogger.msg(ERROR, e.what());
-      if(count) count->dec();
-      delete argument;
-      return false;
     };
 #endif
-    return true;
+    if(count) count->dec();
+#ifdef USE_THREAD_DATA
+    if(argument->data) argument->data->Release();
+#endif
+    delete argument;
+    return false;
   }
 
-  bool Thread::start(SimpleCounter* count) {
+  bool CreateThreadFunction(void (*func)(void*), void *arg, SimpleCounter* count
+) {
 #ifdef USE_THREAD_POOL
-
     if(!pool) return false;
+#endif
 #ifdef USE_THREAD_DATA
-    ThreadArgument *argument = new ThreadArgument(this, count, ThreadData::Get());
+    ThreadArgument *argument = new ThreadArgument(func, arg, count, ThreadData::Get());
 #else
-    ThreadArgument *argument = new ThreadArgument(this, count);
+    ThreadArgument *argument = new ThreadArgument(func, arg, count);
 #endif
-    if(count) count->inc();
-    pool->PushQueue(argument);
-
-#else
+    return StartThread(argument, count);
+  }
 
+  bool Thread::start(SimpleCounter* count) {
+#ifdef USE_THREAD_POOL
+    if(!pool) return false;
+#endif
 #ifdef USE_THREAD_DATA
     ThreadArgument *argument = new ThreadArgument(this, count, ThreadData::Get());
 #else
     ThreadArgument *argument = new ThreadArgument(this, count);
 #endif
-    if(count) count->inc();
-    try {
-      ThreadCreate(sigc::mem_fun(*argument, &ThreadArgument::thread),
-                                 thread_stacksize, false, false,
-                                 Glib::THREAD_PRIORITY_NORMAL);
-    } catch (std::exception& e) {
-      threadLogger.msg(ERROR, e.what());
-      if(count) count->dec();
-      delete argument;
-      return false;
-    };
+    return StartThread(argument, count);
+  }
 
+  ThreadPoolStats GetThreadPoolStats(void) {
+#ifdef USE_THREAD_POOL
+    if(pool) return pool->Stats();
 #endif
-    return true;
+    return ThreadPoolStats();
   }
 
 
@@ -690,6 +737,187 @@ namespace Arc {
 
   // ----------------------------------------
 
+  class ThreadQueue::State {
+  public:
+    State(const std::string& n, int max_running, int exit_timeout)
+      : name(n), max_running(max_running), exit_timeout(exit_timeout), running(0),
+        max_queued(0), started(0), wait_time(0), refs(1) {
+    }
+    std::string name;
+    int max_running;
+    int exit_timeout;
+    int running;
+    int max_queued;
+    unsigned long long int started;
+    unsigned long long int wait_time;
+    std::list<Request*> queue;
+    // ThreadQueue object and every running function
+    int refs;
+    Glib::Mutex lock;
+    Glib::Cond cond;
+    bool can_run(void) const {
+      return (max_running <= 0) || (running < max_running);
+    }
+  };
+
+  class ThreadQueue::Request {
+  public:
+    Request(State* s, void (*f)(void*), void* a, SimpleCounter* c)
+      : state(s), func(f), arg(a), count(c) {
+      submitted.assign_current_time();
+    }
+    State* state;
+    void (*func)(void*);
+    void* arg;
+    SimpleCounter* count;
+    Glib::TimeVal submitted;
+    // Time in microseconds passed since submission
+    unsigned long long int waited(void) const {
+      Glib::TimeVal now;
+      now.assign_current_time();
+      now.subtract(submitted);
+      if(now.tv_sec < 0) return 0;
+      return ((unsigned long long int)now.tv_sec)*1000000 + now.tv_usec;
+    }
+    // Called with lock held when request is run by existing thread
+    void started(void) {
+      state->wait_time += waited();
+      ++(state->started);
+      ++(state->running);
+      ++(state->refs);
+    }
+  };
+
+  ThreadQueue::ThreadQueue(const std::string& name, int max_running, int exit_timeout)
+    : state_(new State(name, max_running, exit_timeout)) {
+  }
+
+  ThreadQueue::~ThreadQueue(void) {
+    State& state = *state_;
+    Glib::Mutex::Lock lock(state.lock);
+    Glib::TimeVal etime;
+    etime.assign_current_time();
+    etime.add_seconds(state.exit_timeout);
+    while((state.running > 0) || !state.queue.empty()) {
+      if(state.exit_timeout < 0) {
+        state.cond.wait(state.lock);
+      } else if(!state.cond.timed_wait(state.lock, etime)) {
+        break;
+      }
+    }
+    if(!state.queue.empty()) {
+      threadLogger.msg(WARNING, "%s: dropping %u requests which did not start in time",
+                       state.name, (unsigned int)state.queue.size());
+      for(std::list<Request*>::iterator r = state.queue.begin(); r != state.queue.end(); ++r) {
+        if((*r)->count) (*r)->count->dec();
+        delete *r;
+      }
+      state.queue.clear();
+    }
+    if(state.running > 0) {
+      threadLogger.msg(WARNING, "%s: %i requests are still running", state.name, state.running);
+    }
+    if(--(state.refs) > 0) return;
+    lock.release();
+    delete state_;
+  }
+
+  bool ThreadQueue::dispatch(State& state, Request* request) {
+    // Called with lock held. Request must not be touched once thread is created.
+    unsigned long long int wait = request->waited();
+    ++(state.running);
+    ++(state.refs);
+    if(CreateThreadFunction(&run, request)) {
+      state.wait_time += wait;
+      ++(state.started);
+      return true;
+    }
+    --(state.running);
+    --(state.refs);
+    return false;
+  }
+
+  bool ThreadQueue::Add(void (*func)(void*), void *arg, SimpleCounter* count) {
+    State& state = *state_;
+    Request* request = new Request(state_, func, arg, count);
+    if(count) count->inc();
+    Glib::Mutex::Lock lock(state.lock);
+    if(state.can_run()) {
+      if(dispatch(state, request)) return true;
+      if(state.running <= 0) {
+        // Nothing would take it from queue - run here
+        threadLogger.msg(WARNING, "%s: failed to create thread, running request directly", state.name);
+        request->started();
+        lock.release();
+        run(request);
+        return true;
+      }
+      // Will be started by first finished function
+      threadLogger.msg(WARNING, "%s: failed to create thread, request is kept in queue", state.name);
+    }
+    state.queue.push_back(request);
+    if((int)state.queue.size() > state.max_queued) state.max_queued = state.queue.size();
+    threadLogger.msg(DEBUG, "%s: %i requests running, %u waiting", state.name, state.running, (unsigned int)state.queue.size());
+    return true;
+  }
+
+  void ThreadQueue::run(void* arg) {
+    Request* request = (Request*)arg;
+    State& state = *(request->state);
+    while(request) {
+      (*(request->func))(request->arg);
+      if(request->count) request->count->dec();
+      delete request;
+      request = NULL;
+      Glib::Mutex::Lock lock(state.lock);
+      --(state.running);
+      --(state.refs);
+      while(!state.queue.empty() && state.can_run()) {
+        Request* next = state.queue.front();
+        state.queue.pop_front();
+        if(!dispatch(state, next)) {
+          // Failed to start new thread - run it in this one
+          next->started();
+          request = next;
+          break;
+        }
+      }
+      state.cond.broadcast();
+      if(request || (state.refs > 0)) continue;
+      // Queue object is gone and this was last running function
+      lock.release();
+      delete &state;
+    }
+  }
+
+  void ThreadQueue::MaxRunning(int max_running) {
+    Glib::Mutex::Lock lock(state_->lock);
+    state_->max_running = max_running;
+  }
+
+  int ThreadQueue::Running(void) const {
+    Glib::Mutex::Lock lock(state_->lock);
+    return state_->running;
+  }
+
+  int ThreadQueue::Queued(void) const {
+    Glib::Mutex::Lock lock(state_->lock);
+    return state_->queue.size();
+  }
+
+  int ThreadQueue::MaxQueued(void) const {
+    Glib::Mutex::Lock lock(state_->lock);
+    return state_->max_queued;
+  }
+
+  unsigned long long int ThreadQueue::AverageWait(void) const {
+    Glib::Mutex::Lock lock(state_->lock);
+    if(state_->started == 0) return 0;
+    return state_->wait_time / state_->started;
+  }
+
+  // ----------------------------------------
+
 #ifdef USE_THREAD_DATA
   class ThreadDataPool {
   private:
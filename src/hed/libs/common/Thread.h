@@ -3,7 +3,9 @@
 #ifndef __ARC_THREAD_H__
 #define __ARC_THREAD_H__
 
+#include <list>
 #include <map>
+#include <string>
 
 #include <glibmm/thread.h>
 
@@ -34,9 +36,40 @@ namespace Arc {
       runs function 'func' with argument 'arg' in a separate thread. If count
       parameter is not NULL then count will be incremented before this function
       returns and then decremented when thread finishes.
+      Functions are run by pool of persistent worker threads. Worker is
+      created only if no idle one is available, so function may block for
+      any time without delaying other requests.
       \return true on success. */
   bool CreateThreadFunction(void (*func)(void*), void *arg, SimpleCounter* count = NULL);
 
+  /// Usage counters of worker threads behind CreateThreadFunction.
+  /** \headerfile Thread.h arc/Thread.h */
+  class ThreadPoolStats {
+  public:
+    ThreadPoolStats(void)
+      : workers(0), idle(0), queued(0), max_queued(0),
+        requests(0), created(0), wait_time(0), max_wait_time(0) {}
+    /// Number of existing worker threads
+    int workers;
+    /// Number of workers waiting for requests
+    int idle;
+    /// Number of requests waiting for worker
+    int queued;
+    /// Maximal number of requests which were waiting for worker
+    int max_queued;
+    /// Number of requests accepted so far
+    unsigned long long int requests;
+    /// Number of worker threads created so far
+    unsigned long long int created;
+    /// Total time in microseconds requests waited for worker
+    unsigned long long int wait_time;
+    /// Longest time in microseconds request waited for worker
+    unsigned long long int max_wait_time;
+  };
+
+  /// Returns usage counters of worker threads.
+  ThreadPoolStats GetThreadPoolStats(void);
+
   /** \cond Internal class used to map glib thread ids (pointer addresses) to
      an incremental counter, for easier debugging. */
   class ThreadId {
@@ -606,6 +639,49 @@ namespace Arc {
     }
   };
 
+  /// Queue of thread requests with limited concurrency.
+  /** Functions passed to Add() are run through CreateThreadFunction but no
+     more than specified number of them at same time. Others wait in queue
+     in order of submission. It is meant for subsystems which split their
+     work into many short independent tasks.
+     \headerfile Thread.h arc/Thread.h */
+  class ThreadQueue {
+  public:
+    /// Creates queue running at most max_running functions (0 - unlimited).
+    /** Destructor waits at most exit_timeout seconds (negative - forever)
+       for submitted functions. */
+    ThreadQueue(const std::string& name, int max_running = 0, int exit_timeout = 60);
+    /// Waits for submitted functions to finish.
+    /** Functions which still wait in queue after timeout are dropped and
+       their counters decremented. Those already running are left to
+       finish on their own. */
+    ~ThreadQueue(void);
+    /// Submits function. Meaning of arguments is same as for CreateThreadFunction.
+    /** If new thread can't be created function is kept in queue till
+       one of running functions finishes or, if none is running, is run
+       in calling thread. */
+    bool Add(void (*func)(void*), void *arg, SimpleCounter* count = NULL);
+    /// Changes limit of concurrently running functions.
+    void MaxRunning(int max_running);
+    /// Number of functions running now.
+    int Running(void) const;
+    /// Number of functions waiting in queue now.
+    int Queued(void) const;
+    /// Maximal number of functions which were waiting in queue.
+    int MaxQueued(void) const;
+    /// Average time in microseconds functions waited in queue.
+    unsigned long long int AverageWait(void) const;
+  private:
+    class Request;
+    class State;
+    // Shared with running functions so they may outlive this object
+    State* state_;
+    static void run(void* arg);
+    static bool dispatch(State& state, Request* request);
+    ThreadQueue(const ThreadQueue&);
+    ThreadQueue& operator=(const ThreadQueue&);
+  };
+
   /** \cond Internal function to initialize Glib thread system. Use
       ThreadInitializer instead. */
   void GlibThreadInitialize(void);
@@ -17,6 +17,9 @@ class CheckSumTest
   CPPUNIT_TEST(CRC32SumTest);
   CPPUNIT_TEST(MD5SumTest);
   CPPUNIT_TEST(Adler32SumTest);
+  CPPUNIT_TEST(CRC32CSumTest);
+  CPPUNIT_TEST(SHA256SumTest);
+  CPPUNIT_TEST(ChunksTest);
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -26,6 +29,9 @@ public:
   void CRC32SumTest();
   void MD5SumTest();
   void Adler32SumTest();
+  void CRC32CSumTest();
+  void SHA256SumTest();
+  void ChunksTest();
 };
 
 
@@ -77,4 +83,56 @@ void CheckSumTest::Adler32SumTest() {
   //CPPUNIT_ASSERT_EQUAL((std::string)"adler32:471b96e5", (std::string)buf);
 }
 
+void CheckSumTest::CRC32CSumTest() {
+  CPPUNIT_ASSERT_EQUAL((std::string)"c363383e", Arc::CheckSumAny::FileChecksum("CheckSumTest.f1K.data", Arc::CheckSumAny::crc32c));
+  CPPUNIT_ASSERT_EQUAL((std::string)"382e7990", Arc::CheckSumAny::FileChecksum("CheckSumTest.f1M.data", Arc::CheckSumAny::crc32c));
+  char buf[64];
+  Arc::CheckSumAny ck("crc32c");
+  ck.add((void*)"123456789", 9);
+  ck.end();
+  ck.print(buf,sizeof(buf));
+  CPPUNIT_ASSERT_EQUAL((std::string)"crc32c:e3069283", (std::string)buf);
+  CPPUNIT_ASSERT_EQUAL(Arc::CheckSumAny::crc32c, Arc::CheckSumAny::Type(buf));
+  CPPUNIT_ASSERT(ck == "crc32c:e3069283");
+}
+
+void CheckSumTest::SHA256SumTest() {
+  CPPUNIT_ASSERT_EQUAL((std::string)"c31bca45696e0b4765427229a5fdae9a3f8dca1974e9b99229c70cf899a90e68", Arc::CheckSumAny::FileChecksum("CheckSumTest.f1K.data", Arc::CheckSumAny::sha256));
+  CPPUNIT_ASSERT_EQUAL((std::string)"ba4b3010e2d91c08bd1987998d82b89b52ae1bdbc360f066607c7ee5a9c5830e", Arc::CheckSumAny::FileChecksum("CheckSumTest.f1M.data", Arc::CheckSumAny::sha256));
+  char buf[100];
+  Arc::CheckSumAny ck(Arc::CheckSumAny::sha256);
+  ck.scan("sha256:ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  ck.print(buf,sizeof(buf));
+  CPPUNIT_ASSERT_EQUAL((std::string)"sha256:ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", (std::string)buf);
+  Arc::CheckSumAny ck2("sha256");
+  ck2.add((void*)"abc", 3);
+  ck2.end();
+  CPPUNIT_ASSERT(ck2 == ck);
+}
+
+void CheckSumTest::ChunksTest() {
+  // Result must not depend on how data is split into pieces
+  const char* types[] = { "cksum", "md5", "adler32", "crc32c", "sha256" };
+  std::string data;
+  for (int i = 0; i < 10000; ++i) data += (char)(i * 7 + i / 256);
+  for (unsigned int t = 0; t < sizeof(types)/sizeof(types[0]); ++t) {
+    Arc::CheckSumAny whole(types[t]);
+    whole.add((void*)data.c_str(), data.length());
+    whole.end();
+    Arc::CheckSumAny pieces(types[t]);
+    std::string::size_type pos = 0;
+    for (std::string::size_type l = 1; pos < data.length(); l = l * 3 % 97 + 1) {
+      if (l > data.length() - pos) l = data.length() - pos;
+      pieces.add((void*)(data.c_str() + pos), l);
+      pos += l;
+    }
+    pieces.end();
+    char buf1[100];
+    char buf2[100];
+    whole.print(buf1, sizeof(buf1));
+    pieces.print(buf2, sizeof(buf2));
+    CPPUNIT_ASSERT_EQUAL((std::string)buf1, (std::string)buf2);
+  }
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(CheckSumTest);
@@ -0,0 +1,85 @@
+// -*- indent-tabs-mode: nil -*-
+// Measures rate of log messages which are discarded by threshold and of
+// messages written to a file directly and through LogQueue.
+// Usage: LoggerBench [number_of_messages [file]]
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include <arc/Logger.h>
+
+static Arc::Logger logger(Arc::Logger::getRootLogger(), "LoggerBench");
+
+static double now(void) {
+  Glib::TimeVal t;
+  t.assign_current_time();
+  return t.as_double();
+}
+
+static void report(const char* name, int n, double start) {
+  double seconds = now() - start;
+  if (seconds <= 0) seconds = 1e-9;
+  std::cout << name << ": " << (long long int)(n / seconds) << " messages per second" << std::endl;
+}
+
+static void send(int n) {
+  std::string arg("argument");
+  for (int i = 0; i < n; ++i) logger.msg(Arc::DEBUG, "Message %i with %s", i, arg);
+}
+
+int main(int argc, char **argv) {
+  int n = 1000000;
+  if (argc > 1) n = atoi(argv[1]);
+  if (n <= 0) return 1;
+  std::string path("/dev/null");
+  if (argc > 2) path = argv[2];
+
+  std::ofstream file(path.c_str());
+  Arc::LogStream output(file);
+  Arc::Logger::getRootLogger().addDestination(output);
+
+  Arc::Logger::getRootLogger().setThreshold(Arc::INFO);
+  double start = now();
+  send(n);
+  report("DEBUG discarded by all loggers", n, start);
+
+  // Another logger with lower threshold makes quick check pass
+  Arc::Logger other(Arc::Logger::getRootLogger(), "other", Arc::DEBUG);
+  start = now();
+  send(n);
+  report("DEBUG discarded by own logger", n, start);
+
+  int written = n / 10;
+  if (written <= 0) written = 1;
+  Arc::Logger::getRootLogger().setThreshold(Arc::DEBUG);
+  start = now();
+  send(written);
+  report("DEBUG written directly", written, start);
+
+  Arc::Logger::getRootLogger().removeDestinations();
+  {
+    Arc::LogQueue queue(output, 65536, Arc::LogQueue::Block);
+    Arc::Logger::getRootLogger().addDestination(queue);
+    start = now();
+    send(written);
+    report("DEBUG queued (block when full)", written, start);
+    queue.flush();
+    report("DEBUG written through queue", written, start);
+    Arc::Logger::getRootLogger().removeDestinations();
+  }
+  {
+    Arc::LogQueue queue(output, 65536, Arc::LogQueue::DropNew);
+    Arc::Logger::getRootLogger().addDestination(queue);
+    start = now();
+    send(written);
+    report("DEBUG queued (drop when full)", written, start);
+    queue.flush();
+    Arc::Logger::getRootLogger().removeDestinations();
+    std::cout << "dropped: " << queue.getDropped() << std::endl;
+  }
+  return 0;
+}
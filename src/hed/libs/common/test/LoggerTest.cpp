@@ -9,6 +9,7 @@
 #include <cppunit/extensions/HelperMacros.h>
 
 #include <arc/Logger.h>
+#include <arc/StringConv.h>
 
 class LoggerTest
   : public CppUnit::TestFixture {
@@ -18,6 +19,9 @@ class LoggerTest
   CPPUNIT_TEST(TestLoggerVERBOSE);
   CPPUNIT_TEST(TestLoggerTHREAD);
   CPPUNIT_TEST(TestLoggerDEFAULT);
+  CPPUNIT_TEST(TestLoggerENABLED);
+  CPPUNIT_TEST(TestLoggerQUEUE);
+  CPPUNIT_TEST(TestLoggerQUEUEOVERFLOW);
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -28,6 +32,9 @@ public:
   void TestLoggerVERBOSE();
   void TestLoggerTHREAD();
   void TestLoggerDEFAULT();
+  void TestLoggerENABLED();
+  void TestLoggerQUEUE();
+  void TestLoggerQUEUEOVERFLOW();
 
 private:
   std::stringstream stream;
@@ -121,4 +128,75 @@ void LoggerTest::TestLoggerDEFAULT() {
   CPPUNIT_ASSERT_EQUAL(bad_level, default_level);
 }
 
+void LoggerTest::TestLoggerENABLED() {
+  CPPUNIT_ASSERT(!logger->isEnabled(Arc::VERBOSE));
+  CPPUNIT_ASSERT(logger->isEnabled(Arc::INFO));
+  // Root logger still has DEBUG threshold
+  CPPUNIT_ASSERT(Arc::Logger::mayLog(Arc::DEBUG));
+  int evaluated = 0;
+  LOG(*logger, Arc::VERBOSE, "Argument %i should not be evaluated", ++evaluated);
+  CPPUNIT_ASSERT_EQUAL(0, evaluated);
+  CPPUNIT_ASSERT(stream.str().empty());
+  LOG(*logger, Arc::INFO, "Argument %i should be evaluated", ++evaluated);
+  CPPUNIT_ASSERT_EQUAL(1, evaluated);
+  std::string res = stream.str();
+  res = res.substr(res.rfind(']') + 2);
+  CPPUNIT_ASSERT_EQUAL(std::string("Argument 1 should be evaluated\n"), res);
+  stream.str("");
+}
+
+void LoggerTest::TestLoggerQUEUE() {
+  std::stringstream queued;
+  Arc::LogStream queued_output(queued);
+  queued_output.setFormat(Arc::EmptyFormat);
+  {
+    Arc::LogQueue queue(queued_output, 4, Arc::LogQueue::Block);
+    Arc::Logger::getRootLogger().removeDestinations();
+    Arc::Logger::getRootLogger().addDestination(queue);
+    for (int n = 0; n < 100; ++n) logger->msg(Arc::INFO, "Message %i", n);
+    queue.flush();
+    Arc::Logger::getRootLogger().removeDestinations();
+    CPPUNIT_ASSERT_EQUAL(0ULL, queue.getDropped());
+  }
+  std::string expected;
+  for (int n = 0; n < 100; ++n) expected += "Message " + Arc::tostring(n) + "\n";
+  CPPUNIT_ASSERT_EQUAL(expected, queued.str());
+}
+
+// Destination which holds writing thread till released
+class LogBlocked: public Arc::LogDestination {
+public:
+  LogBlocked(): count(0) { hold.lock(); }
+  virtual void log(const Arc::LogMessage&) {
+    hold.lock();
+    hold.unlock();
+    Glib::Mutex::Lock lock(mutex);
+    ++count;
+  }
+  int getCount() { Glib::Mutex::Lock lock(mutex); return count; }
+  Glib::Mutex hold;
+private:
+  int count;
+};
+
+void LoggerTest::TestLoggerQUEUEOVERFLOW() {
+  LogBlocked blocked;
+  int sent = 0;
+  {
+    Arc::LogQueue queue(blocked, 4, Arc::LogQueue::DropNew);
+    Arc::Logger::getRootLogger().removeDestinations();
+    Arc::Logger::getRootLogger().addDestination(queue);
+    while (queue.getDropped() < 10) {
+      logger->msg(Arc::INFO, "Message %i", sent);
+      ++sent;
+    }
+    Arc::Logger::getRootLogger().removeDestinations();
+    blocked.hold.unlock();
+    queue.flush();
+    CPPUNIT_ASSERT_EQUAL(10ULL, queue.getDropped());
+  }
+  // Written messages and one report about dropped messages
+  CPPUNIT_ASSERT_EQUAL(sent - 10 + 1, blocked.getCount());
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(LoggerTest);
@@ -0,0 +1,67 @@
+// -*- indent-tabs-mode: nil -*-
+// Measures cost of running short functions through CreateThreadFunction
+// and compares it to creating dedicated thread for every function, which
+// is what CreateThreadFunction did before worker threads were reused.
+// Usage: ThreadBench [number_of_functions]
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cstdlib>
+#include <iostream>
+
+#include <arc/Thread.h>
+
+static void task(void*) {
+}
+
+static void dedicated_task(void) {
+}
+
+static double now(void) {
+  Glib::TimeVal t;
+  t.assign_current_time();
+  return t.as_double();
+}
+
+static void report(const char* name, int n, double start) {
+  double usec = (now() - start) * 1000000.0 / n;
+  std::cout << name << ": " << usec << " us per function" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  int n = 10000;
+  if (argc > 1) n = atoi(argv[1]);
+  if (n <= 0) return 1;
+
+  double start = now();
+  for (int i = 0; i < n; ++i) {
+    Glib::Thread* thr = Glib::Thread::create(sigc::ptr_fun(&dedicated_task),
+                                             Arc::thread_stacksize, true, false,
+                                             Glib::THREAD_PRIORITY_NORMAL);
+    thr->join();
+  }
+  report("dedicated thread, sequential", n, start);
+
+  Arc::SimpleCounter count;
+  start = now();
+  for (int i = 0; i < n; ++i) {
+    if (!Arc::CreateThreadFunction(&task, NULL, &count)) return 1;
+    count.wait();
+  }
+  report("CreateThreadFunction, sequential", n, start);
+
+  start = now();
+  for (int i = 0; i < n; ++i) {
+    if (!Arc::CreateThreadFunction(&task, NULL, &count)) return 1;
+  }
+  count.wait();
+  report("CreateThreadFunction, burst", n, start);
+
+  Arc::ThreadPoolStats stats = Arc::GetThreadPoolStats();
+  std::cout << "requests: " << stats.requests
+            << ", threads created: " << stats.created
+            << ", longest wait: " << stats.max_wait_time << " us"
+            << ", longest queue: " << stats.max_queued << std::endl;
+  return 0;
+}
@@ -17,6 +17,9 @@ class ThreadTest
   CPPUNIT_TEST_SUITE(ThreadTest);
   CPPUNIT_TEST(TestThread);
   CPPUNIT_TEST(TestBroadcast);
+  CPPUNIT_TEST(TestReuse);
+  CPPUNIT_TEST(TestQueue);
+  CPPUNIT_TEST(TestQueueTimeout);
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -24,10 +27,17 @@ public:
   void tearDown();
   void TestThread();
   void TestBroadcast();
+  void TestReuse();
+  void TestQueue();
+  void TestQueueTimeout();
 
 private:
   static void func(void*);
   static void func_wait(void* arg);
+  static void func_quick(void*);
+  static void func_queued(void*);
+  static int running;
+  static int max_running;
   static int counter;
   static Glib::Mutex* lock;
   Arc::SimpleCondition cond;
@@ -106,6 +116,74 @@ void ThreadTest::TestBroadcast() {
   CPPUNIT_ASSERT_EQUAL(2, counter);
 }
 
+void ThreadTest::TestReuse() {
+  // Sequential requests must be served by same idle worker
+  Arc::SimpleCounter count;
+  CPPUNIT_ASSERT(Arc::CreateThreadFunction(&func_quick, NULL, &count));
+  count.wait();
+  Arc::ThreadPoolStats before = Arc::GetThreadPoolStats();
+  for(int n = 0; n < 20; ++n) {
+    // Worker becomes idle shortly after request is reported finished
+    for(int w = 0; (w < 100) && (Arc::GetThreadPoolStats().idle == 0); ++w) usleep(10000);
+    CPPUNIT_ASSERT(Arc::CreateThreadFunction(&func_quick, NULL, &count));
+    count.wait();
+  }
+  Arc::ThreadPoolStats after = Arc::GetThreadPoolStats();
+  CPPUNIT_ASSERT_EQUAL(20ULL, after.requests - before.requests);
+  CPPUNIT_ASSERT_EQUAL(before.created, after.created);
+  CPPUNIT_ASSERT_EQUAL(21, counter);
+}
+
+void ThreadTest::TestQueue() {
+  Arc::SimpleCounter count;
+  {
+    Arc::ThreadQueue queue("test", 2);
+    for(int n = 0; n < 6; ++n) {
+      CPPUNIT_ASSERT(queue.Add(&func_queued, NULL, &count));
+    }
+    CPPUNIT_ASSERT_EQUAL(4, queue.Queued());
+    count.wait();
+    CPPUNIT_ASSERT_EQUAL(0, queue.Queued());
+    CPPUNIT_ASSERT_EQUAL(4, queue.MaxQueued());
+  }
+  CPPUNIT_ASSERT_EQUAL(6, counter);
+  CPPUNIT_ASSERT_EQUAL(2, max_running);
+}
+
+void ThreadTest::TestQueueTimeout() {
+  Arc::SimpleCounter count;
+  {
+    Arc::ThreadQueue queue("test", 1, 1);
+    CPPUNIT_ASSERT(queue.Add(&func_wait, this, &count));
+    CPPUNIT_ASSERT(queue.Add(&func_quick, NULL, &count));
+    CPPUNIT_ASSERT_EQUAL(1, queue.Queued());
+  }
+  // Waiting request is dropped and running one outlives queue
+  CPPUNIT_ASSERT_EQUAL(1, count.get());
+  CPPUNIT_ASSERT_EQUAL(0, counter);
+  cond.signal();
+  count.wait();
+  CPPUNIT_ASSERT_EQUAL(1, counter);
+}
+
+void ThreadTest::func_quick(void*) {
+  lock->lock();
+  ++counter;
+  lock->unlock();
+}
+
+void ThreadTest::func_queued(void*) {
+  lock->lock();
+  ++running;
+  if(running > max_running) max_running = running;
+  lock->unlock();
+  usleep(100000);
+  lock->lock();
+  --running;
+  ++counter;
+  lock->unlock();
+}
+
 void ThreadTest::func_wait(void* arg) {
   ThreadTest* test = (ThreadTest*)arg;
   test->cond.wait();
@@ -122,6 +200,8 @@ void ThreadTest::func(void*) {
 }
 
 int ThreadTest::counter = 0;
+int ThreadTest::running = 0;
+int ThreadTest::max_running = 0;
 Glib::Mutex* ThreadTest::lock = NULL;
 
 CPPUNIT_TEST_SUITE_REGISTRATION(ThreadTest);
@@ -419,6 +419,7 @@ namespace Arc {
     XMLNode compTLS = ConfigFindComponent(xmlcfg["Chain"], "tls.client", NULL);
     if(compTLS) {
       compTLS.NewChild("Hostname") = url.Host();
+      compTLS.NewChild("Port") = tostring(url.Port());
       compTLS.NewChild("Protocol") = "http/1.1"; // educated guess
     }
   }
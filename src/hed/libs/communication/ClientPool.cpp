@@ -0,0 +1,188 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+#include <arc/Utils.h>
+
+#include "ClientPool.h"
+
+namespace Arc {
+
+  Logger ClientHTTPPool::logger(Logger::getRootLogger(), "ClientHTTPPool");
+
+  static Glib::Mutex instance_lock;
+  static ClientHTTPPool* instance = NULL;
+
+  ClientHTTPPool::ClientHTTPPool(unsigned int max_idle, int idle_timeout)
+    : max_idle_(max_idle), idle_timeout_(idle_timeout) {
+  }
+
+  ClientHTTPPool::~ClientHTTPPool() {
+    Clear();
+  }
+
+  ClientHTTPPool& ClientHTTPPool::Instance() {
+    Glib::Mutex::Lock lock(instance_lock);
+    if (!instance) {
+      // Never destroyed because it may be used by other static objects.
+      // Remaining connections are closed on exit.
+      unsigned int max_idle = DefaultMaxIdle;
+      int idle_timeout = DefaultIdleTimeout;
+      std::string value = GetEnv("ARC_HTTP_POOL_SIZE");
+      if (!value.empty()) stringto(value, max_idle);
+      value = GetEnv("ARC_HTTP_POOL_IDLE");
+      if (!value.empty()) stringto(value, idle_timeout);
+      instance = new ClientHTTPPool(max_idle, idle_timeout);
+    }
+    return *instance;
+  }
+
+  std::string ClientHTTPPool::make_key(const char* kind, const BaseConfig& cfg, const URL& url, int timeout,
+                                       const std::string& proxy_host, int proxy_port) {
+    // Everything which affects configuration of MCC chain must be part of key.
+    // SOAP client can't change path hence it is bound to full URL.
+    std::string key(kind);
+    key += '\n';
+    key += (std::string(kind) == "soap") ? url.str() : url.ConnectionURL();
+    key += '\n' + URL::OptionString(url.Options(), ';');
+    key += '\n' + tostring(timeout);
+    if (!proxy_host.empty()) {
+      key += '\n' + proxy_host + ':' + tostring(proxy_port);
+    } else {
+      key += '\n' + GetEnv("ARC_" + upper(url.Protocol()) + "_PROXY");
+    }
+    key += '\n' + cfg.key + '\n' + cfg.cert + '\n' + cfg.proxy;
+    key += '\n' + cfg.cafile + '\n' + cfg.cadir;
+    key += '\n' + cfg.credential + '\n' + cfg.otoken;
+    if ((bool)cfg.overlay) {
+      std::string overlay;
+      cfg.overlay.GetXML(overlay);
+      key += '\n' + overlay;
+    }
+    return key;
+  }
+
+  void ClientHTTPPool::expire(const Time& now) {
+    for (IdleMap::iterator it = idle_.begin(); it != idle_.end();) {
+      if ((now.GetTime() - it->second.since.GetTime()) >= idle_timeout_) {
+        delete it->second.client;
+        idle_.erase(it++);
+        ++stats_.expired;
+      }
+      else {
+        ++it;
+      }
+    }
+  }
+
+  ClientHTTP* ClientHTTPPool::take(const std::string& key, const URL& url) {
+    Glib::Mutex::Lock lock(lock_);
+    expire(Time());
+    IdleMap::iterator it = idle_.find(key);
+    if (it == idle_.end()) return NULL;
+    ClientHTTP* client = it->second.client;
+    idle_.erase(it);
+    busy_[client] = key;
+    ++stats_.reused;
+    logger.msg(DEBUG, "Reusing connection to %s (%llu of %llu requested connections reused)",
+               url.ConnectionURL(), stats_.reused, stats_.reused + stats_.created);
+    return client;
+  }
+
+  ClientHTTP* ClientHTTPPool::Acquire(const BaseConfig& cfg, const URL& url, int timeout,
+                                      const std::string& proxy_host, int proxy_port, bool reuse) {
+    std::string key = make_key("http", cfg, url, timeout, proxy_host, proxy_port);
+    if (reuse) {
+      ClientHTTP* client = take(key, url);
+      if (client) return client;
+    }
+    ClientHTTP* client = new ClientHTTP(cfg, url, timeout, proxy_host, proxy_port);
+    Glib::Mutex::Lock lock(lock_);
+    busy_[client] = key;
+    ++stats_.created;
+    logger.msg(DEBUG, "Creating connection to %s (%llu of %llu requested connections reused)",
+               url.ConnectionURL(), stats_.reused, stats_.reused + stats_.created);
+    return client;
+  }
+
+  ClientSOAP* ClientHTTPPool::AcquireSOAP(const BaseConfig& cfg, const URL& url, int timeout, bool reuse) {
+    std::string key = make_key("soap", cfg, url, timeout, "", 0);
+    if (reuse) {
+      // Only ClientSOAP objects are stored under soap keys
+      ClientSOAP* client = static_cast<ClientSOAP*>(take(key, url));
+      if (client) return client;
+    }
+    ClientSOAP* client = new ClientSOAP(cfg, url, timeout);
+    Glib::Mutex::Lock lock(lock_);
+    busy_[client] = key;
+    ++stats_.created;
+    logger.msg(DEBUG, "Creating connection to %s (%llu of %llu requested connections reused)",
+               url.ConnectionURL(), stats_.reused, stats_.reused + stats_.created);
+    return client;
+  }
+
+  void ClientHTTPPool::Release(ClientHTTP* client) {
+    if (!client) return;
+    Glib::Mutex::Lock lock(lock_);
+    std::map<ClientHTTP*, std::string>::iterator b = busy_.find(client);
+    if (b == busy_.end()) {
+      delete client;
+      return;
+    }
+    std::string key = b->second;
+    busy_.erase(b);
+    if (client->GetClosed()) {
+      ++stats_.closed;
+      delete client;
+      return;
+    }
+    if ((max_idle_ == 0) || (idle_.count(key) >= max_idle_)) {
+      ++stats_.dropped;
+      delete client;
+      return;
+    }
+    Time now;
+    expire(now);
+    idle_.insert(std::make_pair(key, Idle(client, now)));
+  }
+
+  void ClientHTTPPool::Discard(ClientHTTP* client) {
+    if (!client) return;
+    {
+      Glib::Mutex::Lock lock(lock_);
+      if (busy_.erase(client) > 0) ++stats_.discarded;
+    }
+    delete client;
+  }
+
+  void ClientHTTPPool::Clear() {
+    Glib::Mutex::Lock lock(lock_);
+    for (IdleMap::iterator it = idle_.begin(); it != idle_.end(); ++it) {
+      delete it->second.client;
+    }
+    idle_.clear();
+    if ((stats_.created == 0) && (stats_.reused == 0)) return;
+    logger.msg(VERBOSE, "Connections: %llu created, %llu reused, %llu expired, %llu closed by server, %llu failed",
+               stats_.created, stats_.reused, stats_.expired, stats_.closed, stats_.discarded);
+  }
+
+  void ClientHTTPPool::MaxIdle(unsigned int max_idle) {
+    Glib::Mutex::Lock lock(lock_);
+    max_idle_ = max_idle;
+  }
+
+  void ClientHTTPPool::IdleTimeout(int idle_timeout) {
+    Glib::Mutex::Lock lock(lock_);
+    idle_timeout_ = idle_timeout;
+  }
+
+  ClientHTTPPool::Stats ClientHTTPPool::GetStats() const {
+    Glib::Mutex::Lock lock(lock_);
+    return stats_;
+  }
+
+} // namespace Arc
@@ -0,0 +1,134 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifndef __ARC_CLIENTPOOL_H__
+#define __ARC_CLIENTPOOL_H__
+
+#include <string>
+#include <map>
+
+#include <arc/ArcConfig.h>
+#include <arc/DateTime.h>
+#include <arc/Thread.h>
+#include <arc/URL.h>
+#include <arc/communication/ClientInterface.h>
+
+namespace Arc {
+
+  //! Pool of persistent HTTP(S/G) connections
+  /** Creating ClientHTTP object and establishing connection, especially
+   *  with TLS handshake, is expensive. This class keeps idle ClientHTTP
+   *  and ClientSOAP objects with their connections and passes them to
+   *  following users of the same endpoint. Clients are kept separately
+   *  for every combination of endpoint, security options, credentials,
+   *  proxy and timeout. Clients which were idle for too long or which
+   *  connection was closed by server are destroyed. Number of idle
+   *  clients kept per endpoint is limited.
+   *
+   *  Normally process-wide instance obtained through Instance() is used.
+   *  All methods are thread-safe.
+   *
+   *  ClientHTTP objects obtained through Acquire() are shared by different
+   *  URLs of the same service. Hence path must always be specified
+   *  explicitly while calling ClientHTTP::process(). ClientSOAP has no way
+   *  to specify path hence those clients are only shared for exactly same
+   *  URL.
+   **/
+  class ClientHTTPPool {
+  public:
+    /// Counters describing how pool was used
+    class Stats {
+    public:
+      Stats(): created(0), reused(0), expired(0), closed(0), discarded(0), dropped(0) {}
+      /// Number of new clients made by Acquire methods
+      unsigned long long int created;
+      /// Number of clients taken from pool
+      unsigned long long int reused;
+      /// Number of idle clients destroyed because of idle timeout
+      unsigned long long int expired;
+      /// Number of returned clients destroyed because connection was closed
+      unsigned long long int closed;
+      /// Number of clients destroyed through Discard()
+      unsigned long long int discarded;
+      /// Number of returned clients destroyed because of per-endpoint limit
+      unsigned long long int dropped;
+    };
+
+    /// Default number of idle clients kept for every endpoint
+    static const unsigned int DefaultMaxIdle = 4;
+    /// Default time in seconds idle client is kept
+    static const int DefaultIdleTimeout = 30;
+
+    ClientHTTPPool(unsigned int max_idle = DefaultMaxIdle, int idle_timeout = DefaultIdleTimeout);
+    /// Destroys all idle clients. Acquired clients must not be returned anymore.
+    ~ClientHTTPPool();
+
+    /// Process-wide pool
+    /** Limits may be changed by environment variables ARC_HTTP_POOL_SIZE
+        and ARC_HTTP_POOL_IDLE. Setting ARC_HTTP_POOL_SIZE to 0 disables
+        keeping of connections. */
+    static ClientHTTPPool& Instance();
+
+    /// Takes idle HTTP client for the endpoint or creates new one
+    /** Arguments have same meaning as for ClientHTTP constructor. If reuse is
+        false new client is always created. Obtained client must be passed
+        either to Release() or to Discard(). */
+    ClientHTTP* Acquire(const BaseConfig& cfg, const URL& url, int timeout = -1,
+                        const std::string& proxy_host = "", int proxy_port = 0, bool reuse = true);
+
+    /// Takes idle SOAP client for the URL or creates new one
+    ClientSOAP* AcquireSOAP(const BaseConfig& cfg, const URL& url, int timeout = -1, bool reuse = true);
+
+    /// Returns client to pool
+    /** Client is destroyed if connection was closed or there are enough idle
+        clients for its endpoint already. Clients not obtained from this pool
+        are destroyed. */
+    void Release(ClientHTTP* client);
+
+    /// Destroys client
+    /** Must be used instead of Release() if communication failed and state of
+        connection is unknown. */
+    void Discard(ClientHTTP* client);
+
+    /// Destroys all idle clients and logs usage counters
+    /** Process-wide pool is never destroyed. So this method should be called
+        when process stops communicating, e.g. while shutting down. */
+    void Clear();
+
+    /// Number of idle clients kept for every endpoint
+    void MaxIdle(unsigned int max_idle);
+    /// Time in seconds after which idle client is destroyed
+    void IdleTimeout(int idle_timeout);
+
+    /// Returns usage counters
+    Stats GetStats() const;
+
+  private:
+    class Idle {
+    public:
+      Idle(ClientHTTP* client, const Time& since): client(client), since(since) {}
+      ClientHTTP* client;
+      Time since;
+    };
+    typedef std::multimap<std::string, Idle> IdleMap;
+    // Idle clients by key
+    IdleMap idle_;
+    // Keys of acquired clients
+    std::map<ClientHTTP*, std::string> busy_;
+    unsigned int max_idle_;
+    int idle_timeout_;
+    Stats stats_;
+    mutable Glib::Mutex lock_;
+    static Logger logger;
+
+    ClientHTTP* take(const std::string& key, const URL& url);
+    void expire(const Time& now);
+    static std::string make_key(const char* kind, const BaseConfig& cfg, const URL& url, int timeout,
+                                const std::string& proxy_host, int proxy_port);
+
+    ClientHTTPPool(const ClientHTTPPool&);
+    ClientHTTPPool& operator=(const ClientHTTPPool&);
+  };
+
+} // namespace Arc
+
+#endif // __ARC_CLIENTPOOL_H__
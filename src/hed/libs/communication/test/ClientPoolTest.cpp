@@ -0,0 +1,229 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <unistd.h>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <arc/ArcConfig.h>
+#include <arc/URL.h>
+#include <arc/communication/ClientInterface.h>
+#include <arc/communication/ClientPool.h>
+
+// Clients are only created here. Connections are established on first
+// request, so no server is needed.
+
+class ClientPoolTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(ClientPoolTest);
+  CPPUNIT_TEST(TestReuse);
+  CPPUNIT_TEST(TestKeys);
+  CPPUNIT_TEST(TestSOAP);
+  CPPUNIT_TEST(TestMaxIdle);
+  CPPUNIT_TEST(TestExpiration);
+  CPPUNIT_TEST(TestDiscard);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void TestReuse();
+  void TestKeys();
+  void TestSOAP();
+  void TestMaxIdle();
+  void TestExpiration();
+  void TestDiscard();
+};
+
+void ClientPoolTest::TestReuse() {
+  Arc::ClientHTTPPool pool;
+  Arc::BaseConfig cfg;
+  Arc::ClientHTTP* client1 = pool.Acquire(cfg, Arc::URL("https://host1.example.org:443/path1"));
+  CPPUNIT_ASSERT(client1);
+  pool.Release(client1);
+  // Same service, different path
+  Arc::ClientHTTP* client2 = pool.Acquire(cfg, Arc::URL("https://host1.example.org:443/path2"));
+  CPPUNIT_ASSERT(client1 == client2);
+  // Client in use is not given to anyone else
+  Arc::ClientHTTP* client3 = pool.Acquire(cfg, Arc::URL("https://host1.example.org:443/path1"));
+  CPPUNIT_ASSERT(client3 != client2);
+  pool.Release(client2);
+  pool.Release(client3);
+  // New client is requested explicitly
+  Arc::ClientHTTP* client4 = pool.Acquire(cfg, Arc::URL("https://host1.example.org:443/path1"), -1, "", 0, false);
+  CPPUNIT_ASSERT((client4 != client2) && (client4 != client3));
+  pool.Release(client4);
+
+  Arc::ClientHTTPPool::Stats stats = pool.GetStats();
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)3, stats.created);
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)1, stats.reused);
+}
+
+void ClientPoolTest::TestKeys() {
+  Arc::ClientHTTPPool pool;
+  Arc::BaseConfig cfg;
+  Arc::URL url("https://host1.example.org:443/path");
+  Arc::ClientHTTP* client = pool.Acquire(cfg, url);
+  pool.Release(client);
+
+  // Different endpoint
+  Arc::ClientHTTP* other = pool.Acquire(cfg, Arc::URL("https://host2.example.org:443/path"));
+  CPPUNIT_ASSERT(other != client);
+  pool.Release(other);
+  other = pool.Acquire(cfg, Arc::URL("https://host1.example.org:8443/path"));
+  CPPUNIT_ASSERT(other != client);
+  pool.Release(other);
+  other = pool.Acquire(cfg, Arc::URL("http://host1.example.org:443/path"));
+  CPPUNIT_ASSERT(other != client);
+  pool.Release(other);
+  // Different timeout and proxy
+  other = pool.Acquire(cfg, url, 10);
+  CPPUNIT_ASSERT(other != client);
+  pool.Release(other);
+  other = pool.Acquire(cfg, url, -1, "proxy.example.org", 3128);
+  CPPUNIT_ASSERT(other != client);
+  pool.Release(other);
+
+  // Different credentials
+  Arc::BaseConfig cert_cfg;
+  cert_cfg.AddCertificate("/tmp/usercert1.pem");
+  cert_cfg.AddPrivateKey("/tmp/userkey1.pem");
+  other = pool.Acquire(cert_cfg, url);
+  CPPUNIT_ASSERT(other != client);
+  pool.Release(other);
+  Arc::BaseConfig proxy_cfg;
+  proxy_cfg.AddProxy("/tmp/x509up_u1");
+  other = pool.Acquire(proxy_cfg, url);
+  CPPUNIT_ASSERT(other != client);
+  pool.Release(other);
+  Arc::BaseConfig token_cfg;
+  token_cfg.AddOToken("token1");
+  other = pool.Acquire(token_cfg, url);
+  CPPUNIT_ASSERT(other != client);
+  pool.Release(other);
+  Arc::BaseConfig ca_cfg;
+  ca_cfg.AddCADir("/tmp/certificates");
+  other = pool.Acquire(ca_cfg, url);
+  CPPUNIT_ASSERT(other != client);
+  pool.Release(other);
+
+  // Clients with other credentials are kept separately
+  Arc::BaseConfig token2_cfg;
+  token2_cfg.AddOToken("token2");
+  other = pool.Acquire(token2_cfg, url);
+  CPPUNIT_ASSERT(other != client);
+  pool.Release(other);
+  Arc::ClientHTTP* same = pool.Acquire(token_cfg, url);
+  CPPUNIT_ASSERT(same != client);
+  CPPUNIT_ASSERT(same != other);
+  pool.Release(same);
+
+  // Original client is still there
+  Arc::ClientHTTP* again = pool.Acquire(cfg, url);
+  CPPUNIT_ASSERT(again == client);
+  pool.Release(again);
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)0, pool.GetStats().dropped);
+}
+
+void ClientPoolTest::TestSOAP() {
+  Arc::ClientHTTPPool pool;
+  Arc::BaseConfig cfg;
+  Arc::URL url1("https://host1.example.org:443/service1");
+  Arc::URL url2("https://host1.example.org:443/service2");
+  Arc::ClientSOAP* client = pool.AcquireSOAP(cfg, url1);
+  CPPUNIT_ASSERT(client);
+  pool.Release(client);
+  // SOAP client is bound to full URL
+  Arc::ClientSOAP* other = pool.AcquireSOAP(cfg, url2);
+  CPPUNIT_ASSERT(other != client);
+  pool.Release(other);
+  // and never given out as plain HTTP client
+  Arc::ClientHTTP* http = pool.Acquire(cfg, url1);
+  CPPUNIT_ASSERT(http != client);
+  pool.Release(http);
+  Arc::ClientSOAP* same = pool.AcquireSOAP(cfg, url1);
+  CPPUNIT_ASSERT(same == client);
+  pool.Release(same);
+}
+
+void ClientPoolTest::TestMaxIdle() {
+  Arc::ClientHTTPPool pool(2, 30);
+  Arc::BaseConfig cfg;
+  Arc::URL url("https://host1.example.org:443/path");
+  Arc::ClientHTTP* clients[3];
+  for (int n = 0; n < 3; ++n) clients[n] = pool.Acquire(cfg, url);
+  for (int n = 0; n < 3; ++n) pool.Release(clients[n]);
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)1, pool.GetStats().dropped);
+  // Only 2 are available for reuse
+  for (int n = 0; n < 3; ++n) clients[n] = pool.Acquire(cfg, url);
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)2, pool.GetStats().reused);
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)4, pool.GetStats().created);
+  for (int n = 0; n < 3; ++n) pool.Release(clients[n]);
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)2, pool.GetStats().dropped);
+
+  // Limit is per endpoint
+  Arc::ClientHTTP* other = pool.Acquire(cfg, Arc::URL("https://host2.example.org:443/path"));
+  pool.Release(other);
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)2, pool.GetStats().dropped);
+
+  // Nothing is kept if pool size is 0
+  pool.MaxIdle(0);
+  pool.Clear();
+  Arc::ClientHTTP* client = pool.Acquire(cfg, url);
+  pool.Release(client);
+  client = pool.Acquire(cfg, url);
+  pool.Release(client);
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)2, pool.GetStats().reused);
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)4, pool.GetStats().dropped);
+}
+
+void ClientPoolTest::TestExpiration() {
+  Arc::ClientHTTPPool pool(4, 1);
+  Arc::BaseConfig cfg;
+  Arc::URL url("https://host1.example.org:443/path");
+  Arc::ClientHTTP* client = pool.Acquire(cfg, url);
+  pool.Release(client);
+  sleep(2);
+  client = pool.Acquire(cfg, url);
+  pool.Release(client);
+  Arc::ClientHTTPPool::Stats stats = pool.GetStats();
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)1, stats.expired);
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)0, stats.reused);
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)2, stats.created);
+  // Longer timeout keeps client
+  pool.IdleTimeout(30);
+  client = pool.Acquire(cfg, url);
+  pool.Release(client);
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)1, pool.GetStats().reused);
+}
+
+void ClientPoolTest::TestDiscard() {
+  Arc::ClientHTTPPool pool;
+  Arc::BaseConfig cfg;
+  Arc::URL url("https://host1.example.org:443/path");
+  // Discarded client is destroyed and never reused
+  Arc::ClientHTTP* client = pool.Acquire(cfg, url);
+  pool.Discard(client);
+  client = pool.Acquire(cfg, url);
+  pool.Release(client);
+  Arc::ClientHTTPPool::Stats stats = pool.GetStats();
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)1, stats.discarded);
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)0, stats.reused);
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)2, stats.created);
+  // Released client is reused
+  Arc::ClientHTTP* same = pool.Acquire(cfg, url);
+  CPPUNIT_ASSERT(same == client);
+  pool.Release(same);
+  // Clients not made by pool are destroyed and not kept
+  Arc::ClientHTTP* foreign = new Arc::ClientHTTP(cfg, url);
+  pool.Release(foreign);
+  same = pool.Acquire(cfg, url);
+  CPPUNIT_ASSERT(same == client);
+  Arc::ClientHTTP* fresh = pool.Acquire(cfg, url);
+  CPPUNIT_ASSERT(fresh != client);
+  pool.Release(same);
+  pool.Discard(fresh);
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)2, pool.GetStats().discarded);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ClientPoolTest);
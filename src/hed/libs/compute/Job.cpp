@@ -14,6 +14,7 @@
 #include <arc/IString.h>
 #include <arc/Logger.h>
 #include <arc/StringConv.h>
+#include <arc/Thread.h>
 #include <arc/XMLNode.h>
 #include <arc/FileUtils.h>
 #include <arc/compute/Endpoint.h>
@@ -86,6 +87,11 @@ namespace Arc {
 
   Logger Job::logger(Logger::getRootLogger(), "Job");
 
+  // Protects loader creation
+  static Glib::Mutex loader_lock;
+  // Protects data_source and data_destination shared by all jobs
+  static Glib::Mutex data_lock;
+
   JobControllerPluginLoader& Job::getLoader() {
     // For C++ it would be enough to have 
     //   static JobControllerPluginLoader loader;
@@ -93,6 +99,7 @@ namespace Arc {
     // PluginsFactory destructor loop forever waiting for
     // plugins to exit.
     static JobControllerPluginLoader* loader = NULL;
+    Glib::Mutex::Lock lock(loader_lock);
     if(!loader) {
       loader = new JobControllerPluginLoader();
     }
@@ -1046,6 +1053,7 @@ namespace Arc {
     src_.AddOption("blocksize=1048576",false);
     dst_.AddOption("blocksize=1048576",false);
 
+    Glib::Mutex::Lock lock(data_lock);
     if ((!data_source) || (!*data_source) ||
         (!(*data_source)->SetURL(src_))) {
       if(data_source) delete data_source;
@@ -6,11 +6,14 @@
 
 #include <algorithm>
 #include <iostream>
+#include <set>
+#include <vector>
 
 #include <unistd.h>
 
 #include <arc/CheckSum.h>
 #include <arc/Logger.h>
+#include <arc/Thread.h>
 #include <arc/UserConfig.h>
 #include <arc/compute/Broker.h>
 #include <arc/compute/ComputingServiceRetriever.h>
@@ -24,7 +27,7 @@ namespace Arc {
   Logger JobSupervisor::logger(Logger::getRootLogger(), "JobSupervisor");
 
   JobSupervisor::JobSupervisor(const UserConfig& usercfg, const std::list<Job>& jobs)
-    : usercfg(usercfg) {
+    : usercfg(usercfg), maxParallel(DefaultMaxParallel), endpointTimeout(0), listener(NULL) {
     for (std::list<Job>::const_iterator it = jobs.begin();
          it != jobs.end(); ++it) {
       AddJob(*it);
@@ -188,10 +191,7 @@ namespace Arc {
   }
 
   void JobSupervisor::Update() {
-    for (JobSelectionMap::iterator it = jcJobMap.begin();
-         it != jcJobMap.end(); ++it) {
-      it->first->UpdateJobs(it->second.first, processed, notprocessed);
-    }
+    ProcessEndpoints(UpdateOp);
   }
 
   std::list<Job> JobSupervisor::GetSelectedJobs() const {
@@ -210,67 +210,49 @@ namespace Arc {
   bool JobSupervisor::Retrieve(const std::string& downloaddirprefix, bool usejobname, bool force, std::list<std::string>& downloaddirectories) {
     notprocessed.clear();
     processed.clear();
-    bool ok = true;
+    return ProcessEndpoints(RetrieveOp, &downloaddirectories, downloaddirprefix, usejobname, force);
+  }
 
-    for (JobSelectionMap::iterator it = jcJobMap.begin();
-         it != jcJobMap.end(); ++it) {
-      for (std::list<Job*>::iterator itJ = it->second.first.begin();
-           itJ != it->second.first.end();) {
-        if (!(*itJ)->State || (*itJ)->State == JobState::DELETED || !(*itJ)->State.IsFinished()) {
-          notprocessed.push_back((*itJ)->JobID);
-          it->second.second.push_back(*itJ);
-          itJ = it->second.first.erase(itJ);
-          continue;
-        }
+  bool JobSupervisor::RetrieveJob(const Job& job, const std::string& downloaddirprefix, bool usejobname, bool force, std::list<std::string>& downloaddirectories) const {
+    std::string downloaddirname;
+    if (usejobname && !job.Name.empty()) {
+      downloaddirname = job.Name;
+    } else {
+      std::string path = URL(job.JobID).Path();
+      std::string::size_type pos = path.rfind('/');
+      downloaddirname = path.substr(pos + 1);
+    }
+
+    URL downloaddir;
+    if (!downloaddirprefix.empty()) {
+      downloaddir = downloaddirprefix;
+      if (downloaddir.Protocol() == "file") {
+        downloaddir.ChangePath(downloaddir.Path() + G_DIR_SEPARATOR_S + downloaddirname);
+      } else {
+        downloaddir.ChangePath(downloaddir.Path() + "/" + downloaddirname);
+      }
+    } else {
+      downloaddir = downloaddirname;
+    }
 
-        std::string downloaddirname;
-        if (usejobname && !(*itJ)->Name.empty()) {
-          downloaddirname = (*itJ)->Name;
-        } else {
-          std::string path = URL((*itJ)->JobID).Path();
-          std::string::size_type pos = path.rfind('/');
-          downloaddirname = path.substr(pos + 1);
-        }
-
-        URL downloaddir;
-        if (!downloaddirprefix.empty()) {
-          downloaddir = downloaddirprefix;
-          if (downloaddir.Protocol() == "file") {
-            downloaddir.ChangePath(downloaddir.Path() + G_DIR_SEPARATOR_S + downloaddirname);
-          } else {
-            downloaddir.ChangePath(downloaddir.Path() + "/" + downloaddirname);
-          }
-        } else {
-          downloaddir = downloaddirname;
-        }
+    if (!job.Retrieve(usercfg, downloaddir, force)) {
+      return false;
+    }
 
-        if (!(*itJ)->Retrieve(usercfg, downloaddir, force)) {
-          ok = false;
-          notprocessed.push_back((*itJ)->JobID);
-          it->second.second.push_back(*itJ);
-          itJ = it->second.first.erase(itJ);
-        }
-        else {
-          processed.push_back((*itJ)->JobID);
-          if (downloaddir.Protocol() == "file") {
-            if (Glib::file_test(downloaddir.Path(), Glib::FILE_TEST_IS_DIR)) {
-              std::string cwd = URL(".").Path();
-              cwd.resize(cwd.size()-1);
-              if (downloaddir.Path().substr(0, cwd.size()) == cwd) {
-                downloaddirectories.push_back(downloaddir.Path().substr(cwd.size()));
-              } else {
-                downloaddirectories.push_back(downloaddir.Path());
-              }
-            }
-          } else {
-            downloaddirectories.push_back(downloaddir.str());
-          }
-          ++itJ;
+    if (downloaddir.Protocol() == "file") {
+      if (Glib::file_test(downloaddir.Path(), Glib::FILE_TEST_IS_DIR)) {
+        std::string cwd = URL(".").Path();
+        cwd.resize(cwd.size()-1);
+        if (downloaddir.Path().substr(0, cwd.size()) == cwd) {
+          downloaddirectories.push_back(downloaddir.Path().substr(cwd.size()));
+        } else {
+          downloaddirectories.push_back(downloaddir.Path());
         }
       }
+    } else {
+      downloaddirectories.push_back(downloaddir.str());
     }
-
-    return ok;
+    return true;
   }
 
   bool JobSupervisor::Renew() {
@@ -602,26 +584,157 @@ namespace Arc {
   bool JobSupervisor::Cancel() {
     notprocessed.clear();
     processed.clear();
-    bool ok = true;
+    return ProcessEndpoints(CancelOp);
+  }
+
+  bool JobSupervisor::Clean() {
+    notprocessed.clear();
+    processed.clear();
+    return ProcessEndpoints(CleanOp);
+  }
+
+  // Selected jobs of one JobControllerPlugin residing at the same endpoint
+  // and results of processing them.
+  class JobSupervisor::EndpointJobs {
+  public:
+    EndpointJobs(JobControllerPlugin* jc, const std::string& endpoint)
+      : jc(jc), endpoint(endpoint), ok(true) {}
+    JobControllerPlugin* jc;
+    std::string endpoint;
+    std::list<Job*> jobs;
+    std::list<std::string> processed;
+    std::list<std::string> notprocessed;
+    // Download directories with IDs of jobs retrieved into them
+    std::list< std::pair<std::string, std::string> > downloaddirectories;
+    // Jobs to be moved out of selection
+    std::set<Job*> rejected;
+    bool ok;
+  };
+
+  // Endpoints waiting for worker threads.
+  class JobSupervisor::EndpointQueue {
+  public:
+    EndpointQueue(JobSupervisor& js, EndpointOperation op)
+      : js(js), op(op), usejobname(false), force(false), next(0) {}
+    EndpointJobs* Take() {
+      Glib::Mutex::Lock l(lock);
+      if (next >= units.size()) return NULL;
+      return units[next++];
+    }
+    JobSupervisor& js;
+    EndpointOperation op;
+    std::string downloaddirprefix;
+    bool usejobname;
+    bool force;
+    std::vector<EndpointJobs*> units;
+    unsigned int next;
+    // Protects next and serializes calls to listener
+    Glib::Mutex lock;
+    SimpleCounter workers;
+  };
+
+  // Orders job IDs by position of job in selection. IDs of unknown jobs
+  // go last.
+  class JobSupervisor::SelectionOrder {
+  public:
+    SelectionOrder(const std::map<std::string, unsigned int>& positions)
+      : positions(positions) {}
+    bool operator()(const std::string& a, const std::string& b) const {
+      return position(a) < position(b);
+    }
+    bool operator()(const std::pair<std::string, std::string>& a,
+                    const std::pair<std::string, std::string>& b) const {
+      return position(a.first) < position(b.first);
+    }
+  private:
+    unsigned int position(const std::string& id) const {
+      std::map<std::string, unsigned int>::const_iterator it = positions.find(id);
+      return (it == positions.end()) ? (unsigned int)-1 : it->second;
+    }
+    const std::map<std::string, unsigned int>& positions;
+  };
+
+  void JobSupervisor::EndpointWorker(void* arg) {
+    EndpointQueue& queue = *reinterpret_cast<EndpointQueue*>(arg);
+    EndpointJobs* unit;
+    while ((unit = queue.Take()) != NULL) {
+      queue.js.ProcessEndpoint(queue, *unit);
+    }
+  }
 
+  bool JobSupervisor::ProcessEndpoints(EndpointOperation op, std::list<std::string>* downloaddirectories,
+                                       const std::string& downloaddirprefix, bool usejobname, bool force) {
+    EndpointQueue queue(*this, op);
+    queue.downloaddirprefix = downloaddirprefix;
+    queue.usejobname = usejobname;
+    queue.force = force;
+
+    // Split jobs by endpoint keeping order in which they were selected
+    std::map<std::string, unsigned int> positions;
     for (JobSelectionMap::iterator it = jcJobMap.begin();
          it != jcJobMap.end(); ++it) {
+      std::map<std::string, EndpointJobs*> endpoints;
       for (std::list<Job*>::iterator itJ = it->second.first.begin();
-           itJ != it->second.first.end();) {
-        if (!(*itJ)->State || (*itJ)->State == JobState::DELETED || (*itJ)->State.IsFinished()) {
-          notprocessed.push_back((*itJ)->JobID);
-          it->second.second.push_back(*itJ);
-          itJ = it->second.first.erase(itJ);
-          continue;
-        }
+           itJ != it->second.first.end(); ++itJ) {
+        positions.insert(std::make_pair((*itJ)->JobID, (unsigned int)positions.size()));
+        std::string endpoint = (*itJ)->JobManagementURL.ConnectionURL();
+        std::map<std::string, EndpointJobs*>::iterator itE = endpoints.find(endpoint);
+        if (itE == endpoints.end()) {
+          queue.units.push_back(new EndpointJobs(it->first, endpoint));
+          itE = endpoints.insert(std::make_pair(endpoint, queue.units.back())).first;
+        }
+        itE->second->jobs.push_back(*itJ);
+      }
+    }
 
-        if (!it->first->CancelJobs(std::list<Job*>(1, *itJ), processed, notprocessed)) {
-          ok = false;
-          it->second.second.push_back(*itJ);
-          itJ = it->second.first.erase(itJ);
-        }
-        else {
-          ++itJ;
+    // Current thread is one of workers. Retrieval goes through data handles
+    // shared by all jobs, hence endpoints are processed one by one.
+    unsigned int threads = std::min((unsigned int)queue.units.size(), maxParallel);
+    if (op == RetrieveOp) threads = 1;
+    for (unsigned int n = 1; n < threads; ++n) {
+      if (!CreateThreadFunction(&EndpointWorker, &queue, &queue.workers)) {
+        logger.msg(WARNING, "Failed to start thread for processing jobs - using %u threads", n);
+        break;
+      }
+    }
+    EndpointWorker(&queue);
+    queue.workers.wait();
+
+    // Results are merged in order in which jobs were selected
+    bool ok = true;
+    std::set<Job*> rejected;
+    std::list< std::pair<std::string, std::string> > directories;
+    for (std::vector<EndpointJobs*>::iterator itU = queue.units.begin();
+         itU != queue.units.end(); ++itU) {
+      processed.insert(processed.end(), (*itU)->processed.begin(), (*itU)->processed.end());
+      notprocessed.insert(notprocessed.end(), (*itU)->notprocessed.begin(), (*itU)->notprocessed.end());
+      directories.splice(directories.end(), (*itU)->downloaddirectories);
+      rejected.insert((*itU)->rejected.begin(), (*itU)->rejected.end());
+      ok &= (*itU)->ok;
+      delete *itU;
+    }
+    processed.sort(SelectionOrder(positions));
+    notprocessed.sort(SelectionOrder(positions));
+    if (downloaddirectories) {
+      directories.sort(SelectionOrder(positions));
+      for (std::list< std::pair<std::string, std::string> >::iterator itD = directories.begin();
+           itD != directories.end(); ++itD) {
+        downloaddirectories->push_back(itD->second);
+      }
+    }
+
+    if (!rejected.empty()) {
+      for (JobSelectionMap::iterator it = jcJobMap.begin();
+           it != jcJobMap.end(); ++it) {
+        for (std::list<Job*>::iterator itJ = it->second.first.begin();
+             itJ != it->second.first.end();) {
+          if (rejected.find(*itJ) != rejected.end()) {
+            it->second.second.push_back(*itJ);
+            itJ = it->second.first.erase(itJ);
+          }
+          else {
+            ++itJ;
+          }
         }
       }
     }
@@ -629,33 +742,126 @@ namespace Arc {
     return ok;
   }
 
-  bool JobSupervisor::Clean() {
-    notprocessed.clear();
-    processed.clear();
-    bool ok = true;
+  // Number of jobs updated at once when time limit for endpoint is set
+  static const unsigned int UpdateSlice = 100;
 
-    for (JobSelectionMap::iterator it = jcJobMap.begin();
-         it != jcJobMap.end(); ++it) {
-      for (std::list<Job*>::iterator itJ = it->second.first.begin();
-           itJ != it->second.first.end();) {
-        if (!(*itJ)->State || !(*itJ)->State.IsFinished()) {
-          notprocessed.push_back((*itJ)->JobID);
-          it->second.second.push_back(*itJ);
-          itJ = it->second.first.erase(itJ);
+  // Returns true if more than limit seconds passed since started.
+  // Zero or negative limit means no limit.
+  static bool TimeExceeded(const Glib::TimeVal& started, int limit) {
+    if (limit <= 0) return false;
+    Glib::TimeVal now;
+    now.assign_current_time();
+    return (now.as_double() - started.as_double() >= limit);
+  }
+
+  void JobSupervisor::ProcessEndpoint(EndpointQueue& queue, EndpointJobs& unit) {
+    Glib::TimeVal started;
+    started.assign_current_time();
+    unsigned int skipped = 0;
+
+    if (queue.op == UpdateOp) {
+      if (endpointTimeout <= 0) {
+        unit.jc->UpdateJobs(unit.jobs, unit.processed, unit.notprocessed);
+      }
+      else {
+        // Jobs are updated in slices so that time limit is checked while
+        // endpoint with many jobs is being queried
+        std::list<Job*>::iterator itJ = unit.jobs.begin();
+        while (itJ != unit.jobs.end()) {
+          if (TimeExceeded(started, endpointTimeout)) {
+            for (; itJ != unit.jobs.end(); ++itJ) {
+              ++skipped;
+              unit.notprocessed.push_back((*itJ)->JobID);
+            }
+            unit.ok = false;
+            break;
+          }
+          std::list<Job*> slice;
+          for (; (itJ != unit.jobs.end()) && (slice.size() < UpdateSlice); ++itJ) {
+            slice.push_back(*itJ);
+          }
+          unit.jc->UpdateJobs(slice, unit.processed, unit.notprocessed);
+        }
+      }
+    }
+    else {
+      for (std::list<Job*>::iterator itJ = unit.jobs.begin();
+           itJ != unit.jobs.end(); ++itJ) {
+        const JobState& state = (*itJ)->State;
+        bool applicable = false;
+        switch (queue.op) {
+        case RetrieveOp:
+          applicable = state && state != JobState::DELETED && state.IsFinished();
+          break;
+        case CancelOp:
+          applicable = state && state != JobState::DELETED && !state.IsFinished();
+          break;
+        case CleanOp:
+          applicable = state && state.IsFinished();
+          break;
+        default:
+          break;
+        }
+        if (!applicable) {
+          unit.notprocessed.push_back((*itJ)->JobID);
+          unit.rejected.insert(*itJ);
           continue;
         }
 
-        if (!it->first->CleanJobs(std::list<Job*>(1, *itJ), processed, notprocessed)) {
-          ok = false;
-          it->second.second.push_back(*itJ);
-          itJ = it->second.first.erase(itJ);
+        if (TimeExceeded(started, endpointTimeout)) {
+          ++skipped;
+          unit.ok = false;
+          unit.notprocessed.push_back((*itJ)->JobID);
+          unit.rejected.insert(*itJ);
+          continue;
         }
-        else {
-          ++itJ;
+
+        bool done = false;
+        switch (queue.op) {
+        case RetrieveOp: {
+          std::list<std::string> directories;
+          done = RetrieveJob(**itJ, queue.downloaddirprefix, queue.usejobname, queue.force, directories);
+          for (std::list<std::string>::iterator itD = directories.begin(); itD != directories.end(); ++itD) {
+            unit.downloaddirectories.push_back(std::make_pair((*itJ)->JobID, *itD));
+          }
+          if (done) {
+            unit.processed.push_back((*itJ)->JobID);
+          }
+          else {
+            unit.notprocessed.push_back((*itJ)->JobID);
+          }
+          break;
+        }
+        case CancelOp:
+          done = unit.jc->CancelJobs(std::list<Job*>(1, *itJ), unit.processed, unit.notprocessed);
+          break;
+        case CleanOp:
+          done = unit.jc->CleanJobs(std::list<Job*>(1, *itJ), unit.processed, unit.notprocessed);
+          break;
+        default:
+          break;
+        }
+        if (!done) {
+          unit.ok = false;
+          unit.rejected.insert(*itJ);
         }
       }
     }
+    if (skipped > 0) {
+      logger.msg(WARNING, "Time limit of %d seconds for endpoint %s exceeded - %u jobs not processed",
+                 endpointTimeout, unit.endpoint, skipped);
+    }
 
-    return ok;
+    Glib::TimeVal finished;
+    finished.assign_current_time();
+    double seconds = finished.as_double() - started.as_double();
+    logger.msg(VERBOSE, "Endpoint %s: %u jobs processed, %u not processed in %.3f seconds",
+               unit.endpoint, (unsigned int)unit.processed.size(), (unsigned int)unit.notprocessed.size(), seconds);
+
+    if (listener) {
+      Glib::Mutex::Lock l(queue.lock);
+      listener->EndpointDone(unit.endpoint, unit.processed, unit.notprocessed, seconds);
+    }
   }
+
 } // namespace Arc
@@ -37,6 +37,35 @@ namespace Arc {
     virtual bool Select(const Job& job) const = 0;
   };
 
+  /// Receives results of JobSupervisor operations per endpoint
+  /**
+   * JobSupervisor processes jobs of different endpoints in parallel. An
+   * object of class derived from this one may be passed to
+   * JobSupervisor::SetListener in order to get results for jobs of every
+   * endpoint as soon as they are available, instead of waiting for the
+   * whole operation to finish.
+   *
+   * \ingroup compute
+   * \headerfile JobSupervisor.h arc/compute/JobSupervisor.h
+   **/
+  class JobSupervisorListener {
+  public:
+    virtual ~JobSupervisorListener() {}
+
+    /// Called when all jobs of one endpoint are processed
+    /**
+     * Calls are serialized but may happen in different threads.
+     * @param endpoint URL of the endpoint (protocol, host and port).
+     * @param processed IDs of jobs successfully processed at the endpoint.
+     * @param notprocessed IDs of jobs which failed or were skipped.
+     * @param seconds time spent processing jobs of the endpoint.
+     **/
+    virtual void EndpointDone(const std::string& endpoint,
+                              const std::list<std::string>& processed,
+                              const std::list<std::string>& notprocessed,
+                              double seconds) = 0;
+  };
+
   /// JobSupervisor class
   /**
    * The JobSupervisor class is tool for loading JobControllerPlugin plugins
@@ -96,7 +125,8 @@ namespace Arc {
      * When invoking this method the job information for the jobs managed by
      * this JobSupervisor will be updated. Internally, for each loaded
      * JobControllerPlugin the JobControllerPlugin::UpdateJobs method will be
-     * called, which will be responsible for updating job information.
+     * called, which will be responsible for updating job information. Jobs
+     * at different endpoints are updated in parallel (see SetMaxParallel).
      **/
     void Update();
 
@@ -380,7 +410,50 @@ namespace Arc {
     const std::list<std::string>& GetIDsProcessed() const { return processed; }
     const std::list<std::string>& GetIDsNotProcessed() const { return notprocessed; }
 
+    /// Set number of endpoints processed in parallel
+    /**
+     * Update, Retrieve, Cancel and Clean split selected jobs by endpoint
+     * and process endpoints in parallel using at most this number of
+     * threads. Jobs of the same endpoint are always processed in sequence.
+     * Value 1 disables parallel processing. Default is
+     * JobSupervisor::DefaultMaxParallel.
+     **/
+    void SetMaxParallel(unsigned int n) { maxParallel = (n > 0) ? n : 1; }
+
+    /// Set time limit for processing jobs of one endpoint
+    /**
+     * When processing jobs of an endpoint takes longer than the given number
+     * of seconds, the remaining jobs of that endpoint are skipped and
+     * reported as not processed. Update queries jobs in slices when the
+     * limit is set, so that it is checked between them. Requests already
+     * sent are bounded by the connection timeout of UserConfig. Zero or
+     * negative value means no limit, which is the default.
+     **/
+    void SetEndpointTimeout(int seconds) { endpointTimeout = seconds; }
+
+    /// Set object receiving results of every endpoint
+    /**
+     * The listener is called from Update, Retrieve, Cancel and Clean. NULL
+     * removes the listener. The listener is not owned by JobSupervisor.
+     **/
+    void SetListener(JobSupervisorListener* l) { listener = l; }
+
+    static const unsigned int DefaultMaxParallel = 10;
+
   private:
+    enum EndpointOperation { UpdateOp, RetrieveOp, CancelOp, CleanOp };
+    class EndpointJobs;
+    class EndpointQueue;
+    class SelectionOrder;
+
+    bool ProcessEndpoints(EndpointOperation op, std::list<std::string>* downloaddirectories = NULL,
+                          const std::string& downloaddirprefix = "", bool usejobname = false, bool force = false);
+    void ProcessEndpoint(EndpointQueue& queue, EndpointJobs& unit);
+    bool RetrieveJob(const Job& job, const std::string& downloaddirprefix, bool usejobname, bool force,
+                     std::list<std::string>& downloaddirectories) const;
+    static void EndpointWorker(void* arg);
+
+
     const UserConfig& usercfg;
 
     std::list<Job> jobs;
@@ -393,6 +466,10 @@ namespace Arc {
 
     JobControllerPluginLoader loader;
 
+    unsigned int maxParallel;
+    int endpointTimeout;
+    JobSupervisorListener* listener;
+
     static Logger logger;
   };
 
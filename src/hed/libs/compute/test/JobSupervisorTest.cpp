@@ -6,6 +6,8 @@
 
 #include <stdlib.h>
 
+#include <map>
+
 #include <arc/URL.h>
 #include <arc/UserConfig.h>
 #include <arc/Utils.h>
@@ -26,6 +28,7 @@ class JobSupervisorTest
   CPPUNIT_TEST(TestCancel);
   CPPUNIT_TEST(TestClean);
   CPPUNIT_TEST(TestSelector);
+  CPPUNIT_TEST(TestEndpoints);
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -41,6 +44,7 @@ public:
   void TestCancel();
   void TestClean();
   void TestSelector();
+  void TestEndpoints();
 
 private:
   Arc::UserConfig usercfg;
@@ -64,6 +68,18 @@ private:
   Arc::Period three_days;
 };
 
+class EndpointRecorder : public Arc::JobSupervisorListener {
+public:
+  void EndpointDone(const std::string& endpoint,
+                    const std::list<std::string>& processed,
+                    const std::list<std::string>& notprocessed,
+                    double) {
+    results[endpoint].insert(results[endpoint].end(), processed.begin(), processed.end());
+    results[endpoint].insert(results[endpoint].end(), notprocessed.begin(), notprocessed.end());
+  }
+  std::map<std::string, std::list<std::string> > results;
+};
+
 JobSupervisorTest::JobSupervisorTest() : usercfg(Arc::initializeCredentialsType(Arc::initializeCredentialsType::SkipCredentials)), js(NULL) {
   j.JobStatusURL = Arc::URL("http://test.nordugrid.org");
   j.JobStatusInterfaceName = "org.nordugrid.test";
@@ -343,4 +359,51 @@ void JobSupervisorTest::TestSelector()
   delete js;
 }
 
+void JobSupervisorTest::TestEndpoints()
+{
+  std::list<Arc::Job> jobs;
+  std::string id1 = "http://test.nordugrid.org/1234567890test1";
+  std::string id2 = "http://test2.nordugrid.org/1234567890test2";
+  std::string id3 = "http://test.nordugrid.org/1234567890test3";
+
+  j.State = Arc::JobStateTEST(Arc::JobState::RUNNING);
+  j.JobID = id1;
+  jobs.push_back(j);
+
+  j.JobID = id2;
+  j.JobManagementURL = Arc::URL("http://test2.nordugrid.org");
+  jobs.push_back(j);
+
+  j.JobID = id3;
+  j.JobManagementURL = Arc::URL("http://test.nordugrid.org");
+  jobs.push_back(j);
+
+  js = new Arc::JobSupervisor(usercfg, jobs);
+  EndpointRecorder recorder;
+  js->SetListener(&recorder);
+
+  Arc::JobControllerPluginTestACCControl::cancelStatus = true;
+  CPPUNIT_ASSERT(js->Cancel());
+
+  // Every endpoint is reported separately
+  CPPUNIT_ASSERT_EQUAL(2, (int)recorder.results.size());
+  std::list<std::string>& first = recorder.results[Arc::URL("http://test.nordugrid.org").ConnectionURL()];
+  CPPUNIT_ASSERT_EQUAL(2, (int)first.size());
+  CPPUNIT_ASSERT_EQUAL(id1, first.front());
+  CPPUNIT_ASSERT_EQUAL(id3, first.back());
+  std::list<std::string>& second = recorder.results[Arc::URL("http://test2.nordugrid.org").ConnectionURL()];
+  CPPUNIT_ASSERT_EQUAL(1, (int)second.size());
+  CPPUNIT_ASSERT_EQUAL(id2, second.front());
+
+  // Merged results follow selection order
+  CPPUNIT_ASSERT_EQUAL(3, (int)js->GetIDsProcessed().size());
+  std::list<std::string>::const_iterator id = js->GetIDsProcessed().begin();
+  CPPUNIT_ASSERT_EQUAL(id1, *id++);
+  CPPUNIT_ASSERT_EQUAL(id2, *id++);
+  CPPUNIT_ASSERT_EQUAL(id3, *id);
+  CPPUNIT_ASSERT_EQUAL(0, (int)js->GetIDsNotProcessed().size());
+
+  delete js;
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(JobSupervisorTest);
@@ -5,12 +5,72 @@
 #endif
 
 #include <cstdlib>
+#include <map>
+
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include <arc/CheckSum.h>
 #include <arc/data/DataBuffer.h>
 
 namespace Arc {
 
+  // Blocks released by finished transfers are kept for next transfers
+  // instead of being returned to system. Big blocks are otherwise mapped
+  // and unmapped by allocator for every transfer.
+  static const unsigned long long int block_pool_max = 64 * 1024 * 1024;
+  static Glib::Mutex block_pool_lock;
+  static std::multimap<unsigned int, char*> block_pool;
+  static unsigned long long int block_pool_size = 0;
+
+  static const unsigned int huge_page_size = 2 * 1024 * 1024;
+  static const unsigned int max_block_size = 4 * 1024 * 1024;
+
+  static unsigned int page_size(void) {
+    static long size = 0;
+    if (size <= 0) {
+      size = sysconf(_SC_PAGESIZE);
+      if (size <= 0) size = 4096;
+    }
+    return size;
+  }
+
+  static char* block_alloc(unsigned int size) {
+    {
+      Glib::Mutex::Lock lock(block_pool_lock);
+      std::multimap<unsigned int, char*>::iterator b = block_pool.find(size);
+      if (b != block_pool.end()) {
+        char *start = b->second;
+        block_pool.erase(b);
+        block_pool_size -= size;
+        return start;
+      }
+    }
+#ifdef HAVE_POSIX_MEMALIGN
+    // Page aligned memory is accepted by O_DIRECT and zero-copy socket
+    // operations. Blocks of size of huge page are aligned to huge page.
+    void *start = NULL;
+    unsigned int align = (size >= huge_page_size) ? huge_page_size : page_size();
+    if (posix_memalign(&start, align, size) != 0) return NULL;
+#ifdef MADV_HUGEPAGE
+    if (size >= huge_page_size) (void)madvise(start, size, MADV_HUGEPAGE);
+#endif
+    return (char*)start;
+#else
+    return (char*)malloc(size);
+#endif
+  }
+
+  static void block_free(char *start, unsigned int size) {
+    Glib::Mutex::Lock lock(block_pool_lock);
+    if ((block_pool_size + size) <= block_pool_max) {
+      block_pool.insert(std::pair<unsigned int, char*>(size, start));
+      block_pool_size += size;
+      return;
+    }
+    free(start);
+  }
+
   bool DataBuffer::set(CheckSum *cksum, unsigned int size, int blocks) {
     lock.lock();
     if (blocks < 0) {
@@ -18,8 +78,11 @@ namespace Arc {
       return false;
     }
     if (bufs != NULL) {
+      /* buffers must not be used by helper thread anymore */
+      sum_jobs.clear();
+      while (sum_busy) cond.wait(lock);
       for (int i = 0; i < bufs_n; i++) {
-        if (bufs[i].start) free(bufs[i].start);
+        if (bufs[i].start) block_free(bufs[i].start, bufs[i].size);
       }
       free(bufs);
       bufs_n = 0;
@@ -27,10 +90,20 @@ namespace Arc {
       set_counter++;
       cond.broadcast(); /* make all waiting loops to exit */
     }
+    direct_state = direct_none;
+    direct_fd = -1;
+    direct_offset = 0;
+    direct_size = 0;
+    direct_checksums.clear();
+    direct_checksums_offset = 0;
+    direct_checksums_valid = false;
+    read_started = false;
+    write_started = false;
     if ((size == 0) || (blocks == 0)) {
       lock.unlock();
       return true;
     }
+    size = ((size + page_size() - 1) / page_size()) * page_size();
     bufs = (buf_desc*)malloc(sizeof(buf_desc) * blocks);
     if (bufs == NULL) {
       lock.unlock();
@@ -44,6 +117,7 @@ namespace Arc {
       bufs[i].size = size;
       bufs[i].used = 0;
       bufs[i].offset = 0;
+      bufs[i].sum_pending = 0;
     }
     //checksum = cksum;
     checksums.clear();
@@ -81,6 +155,11 @@ namespace Arc {
     bufs_n = 0;
     bufs = NULL;
     set_counter = 0;
+    direct_state = direct_none;
+    direct_fd = -1;
+    sum_busy = false;
+    sum_thread_started = false;
+    sum_thread_exit = false;
     eof_read_flag = false;
     eof_write_flag = false;
     error_read_flag = false;
@@ -95,6 +174,11 @@ namespace Arc {
     bufs_n = 0;
     bufs = NULL;
     set_counter = 0;
+    direct_state = direct_none;
+    direct_fd = -1;
+    sum_busy = false;
+    sum_thread_started = false;
+    sum_thread_exit = false;
     eof_read_flag = false;
     eof_write_flag = false;
     error_read_flag = false;
@@ -106,6 +190,71 @@ namespace Arc {
 
   DataBuffer::~DataBuffer() {
     set(NULL, 0, 0);
+    lock.lock();
+    sum_thread_exit = true;
+    cond.broadcast();
+    lock.unlock();
+    sum_thread_count.wait();
+  }
+
+  void DataBuffer::sum_thread_start(void *arg) {
+    ((DataBuffer*)arg)->sum_thread();
+  }
+
+  void DataBuffer::sum_add(CheckSum *sum, int handle) {
+    CheckSumAny *any = dynamic_cast<CheckSumAny*>(sum);
+    if (any && !any->active()) return;
+    if (!sum_thread_started) {
+      sum_thread_started = CreateThreadFunction(&sum_thread_start, this, &sum_thread_count);
+    }
+    if (!sum_thread_started) {
+      sum->add(bufs[handle].start, bufs[handle].used);
+      return;
+    }
+    sum_jobs.push_back(sum_job(sum, handle, bufs[handle].used));
+    bufs[handle].sum_pending++;
+    cond.broadcast();
+  }
+
+  void DataBuffer::sum_wait() {
+    while (sum_busy || !sum_jobs.empty()) cond.wait(lock);
+  }
+
+  void DataBuffer::sum_thread() {
+    // Size of piece of data passed to every checksum in turn. Small
+    // enough for data to stay in processor cache while all checksums of
+    // buffer are computed.
+    const unsigned int slice = 64 * 1024;
+    lock.lock();
+    for (;;) {
+      if (sum_jobs.empty()) {
+        if (sum_thread_exit) break;
+        cond.wait(lock);
+        continue;
+      }
+      /* take all computations waiting for same buffer */
+      std::list<sum_job> jobs;
+      int handle = sum_jobs.front().handle;
+      while ((!sum_jobs.empty()) && (sum_jobs.front().handle == handle)) {
+        jobs.push_back(sum_jobs.front());
+        sum_jobs.pop_front();
+      }
+      char *start = bufs[handle].start;
+      sum_busy = true;
+      lock.unlock();
+      for (unsigned int pos = 0; pos < jobs.front().length; pos += slice) {
+        unsigned int l = jobs.front().length - pos;
+        if (l > slice) l = slice;
+        for (std::list<sum_job>::iterator job = jobs.begin(); job != jobs.end(); ++job) {
+          job->sum->add(start + pos, l);
+        }
+      }
+      lock.lock();
+      sum_busy = false;
+      bufs[handle].sum_pending -= jobs.size();
+      cond.broadcast();
+    }
+    lock.unlock();
   }
 
   bool DataBuffer::eof_read() {
@@ -131,6 +280,7 @@ namespace Arc {
   void DataBuffer::eof_read(bool eof_) {
     lock.lock();
     if (eof_) {
+      sum_wait();
       for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
            itCheckSum != checksums.end(); itCheckSum++) {
         if (itCheckSum->sum) itCheckSum->sum->end();
@@ -273,7 +423,7 @@ namespace Arc {
     lock.lock();
     for (int i = 0; i < bufs_n; i++) {
       if ((!bufs[i].taken_for_read) && (!bufs[i].taken_for_write) &&
-          (bufs[i].used == 0)) {
+          (bufs[i].used == 0) && (bufs[i].sum_pending == 0)) {
         lock.unlock();
         return true;
       }
@@ -288,6 +438,10 @@ namespace Arc {
       lock.unlock();
       return false;
     }
+    if (!read_started) {
+      read_started = true;
+      cond.broadcast(); /* writing part may wait for direct transfer */
+    }
     for (;;) {
       if (error()) { /* errors detected/set - any continuation is unusable */
         lock.unlock();
@@ -295,9 +449,9 @@ namespace Arc {
       }
       for (int i = 0; i < bufs_n; i++) {
         if ((!bufs[i].taken_for_read) && (!bufs[i].taken_for_write) &&
-            (bufs[i].used == 0)) {
+            (bufs[i].used == 0) && (bufs[i].sum_pending == 0)) {
           if (bufs[i].start == NULL) {
-            bufs[i].start = (char*)malloc(bufs[i].size);
+            bufs[i].start = block_alloc(bufs[i].size);
             if (bufs[i].start == NULL) continue;
           }
           handle = i;
@@ -370,7 +524,7 @@ namespace Arc {
         for (int i = handle; i < bufs_n; i++) {
           if (bufs[i].used != 0) {
             if (bufs[i].offset == itCheckSum->offset) {
-              itCheckSum->sum->add(bufs[i].start, bufs[i].used);
+              sum_add(itCheckSum->sum, i);
               itCheckSum->offset += bufs[i].used;
               i = -1;
               itCheckSum->ready = true;
@@ -410,6 +564,10 @@ namespace Arc {
       lock.unlock();
       return false;
     }
+    if (!write_started) {
+      write_started = true;
+      cond.broadcast(); /* reading part may wait for direct transfer */
+    }
     for (;;) {
       if (error()) { /* internal/external errors - no need to continue */
         lock.unlock();
@@ -668,4 +826,171 @@ namespace Arc {
     return size;
   }
 
+  bool DataBuffer::checksum_required() const {
+    for (std::list<checksum_desc>::const_iterator itCheckSum = checksums.begin();
+         itCheckSum != checksums.end(); itCheckSum++) {
+      if (itCheckSum->sum == NULL) continue;
+      CheckSumAny *any = dynamic_cast<CheckSumAny*>(itCheckSum->sum);
+      if (any && !any->active()) continue;
+      return true;
+    }
+    for (std::list<CheckSum*>::const_iterator itCheckSum = direct_checksums.begin();
+         itCheckSum != direct_checksums.end(); itCheckSum++) {
+      if (*itCheckSum == NULL) continue;
+      CheckSumAny *any = dynamic_cast<CheckSumAny*>(*itCheckSum);
+      if (any && !any->active()) continue;
+      return true;
+    }
+    return false;
+  }
+
+  bool DataBuffer::offer_direct(int fd, unsigned long long int offset,
+                                unsigned long long int size,
+                                const std::list<CheckSum*>& sums) {
+    lock.lock();
+    if ((bufs == NULL) || (direct_state != direct_none) || read_started) {
+      lock.unlock();
+      return false;
+    }
+    direct_fd = fd;
+    direct_offset = offset;
+    direct_size = size;
+    direct_checksums = sums;
+    direct_checksums_offset = offset;
+    direct_checksums_valid = true;
+    direct_state = direct_offered;
+    cond.broadcast();
+    for (;;) {
+      if (direct_state == direct_done) {
+        direct_fd = -1;
+        direct_checksums.clear();
+        lock.unlock();
+        return true;
+      }
+      if (direct_state == direct_taken) {
+        /* descriptor is in use - wait for writing part to finish
+           regardless of errors */
+        Glib::TimeVal etime;
+        etime.assign_current_time();
+        etime.add_seconds(60);
+        cond.timed_wait(lock, etime);
+        continue;
+      }
+      if (direct_state != direct_offered) break;
+      if (write_started || eof_write_flag || error()) break;
+      if (!cond_wait()) break;
+    }
+    if (direct_state == direct_offered) direct_state = direct_declined;
+    direct_fd = -1;
+    direct_checksums.clear();
+    lock.unlock();
+    return false;
+  }
+
+  bool DataBuffer::take_direct(int& fd, unsigned long long int& offset,
+                               unsigned long long int& size) {
+    lock.lock();
+    for (;;) {
+      if (bufs == NULL) break;
+      if (error()) break;
+      if (direct_state == direct_offered) {
+        direct_state = direct_taken;
+        fd = direct_fd;
+        offset = direct_offset;
+        size = direct_size;
+        for (std::list<CheckSum*>::iterator itCheckSum = direct_checksums.begin();
+             itCheckSum != direct_checksums.end(); itCheckSum++) {
+          if (*itCheckSum) (*itCheckSum)->start();
+        }
+        cond.broadcast();
+        lock.unlock();
+        return true;
+      }
+      if (direct_state != direct_none) break;
+      if (read_started || eof_read_flag) break;
+      if (!cond_wait()) break;
+    }
+    if (direct_state == direct_offered) direct_state = direct_declined;
+    cond.broadcast();
+    lock.unlock();
+    return false;
+  }
+
+  bool DataBuffer::is_direct(const char *buf, unsigned int length,
+                             unsigned long long int offset) {
+    lock.lock();
+    if (direct_state != direct_taken) {
+      lock.unlock();
+      return false;
+    }
+    if ((offset + length) > eof_pos)
+      eof_pos = offset + length;
+    /* checksums are computed if data is available and comes in order */
+    for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
+         itCheckSum != checksums.end(); itCheckSum++) {
+      if (itCheckSum->sum == NULL) continue;
+      if (buf && (offset == itCheckSum->offset)) {
+        itCheckSum->sum->add((void*)buf, length);
+        itCheckSum->offset += length;
+      } else {
+        itCheckSum->ready = false;
+      }
+    }
+    if (buf && direct_checksums_valid && (offset == direct_checksums_offset)) {
+      for (std::list<CheckSum*>::iterator itCheckSum = direct_checksums.begin();
+           itCheckSum != direct_checksums.end(); itCheckSum++) {
+        if (*itCheckSum) (*itCheckSum)->add((void*)buf, length);
+      }
+      direct_checksums_offset += length;
+    } else {
+      direct_checksums_valid = false;
+    }
+    /* speed control */
+    if (!speed.transfer(length))
+      if ((!(error_read_flag || error_write_flag)) &&
+          (!(eof_read_flag && eof_write_flag))) {
+        error_transfer_flag = true;
+    }
+    bool res = !error();
+    cond.broadcast();
+    lock.unlock();
+    return res;
+  }
+
+  void DataBuffer::done_direct() {
+    lock.lock();
+    if (direct_state == direct_taken) {
+      /* checksums which missed part of content are left not computed */
+      if (direct_checksums_valid) {
+        for (std::list<CheckSum*>::iterator itCheckSum = direct_checksums.begin();
+             itCheckSum != direct_checksums.end(); itCheckSum++) {
+          if (*itCheckSum) (*itCheckSum)->end();
+        }
+      }
+      direct_state = direct_done;
+    }
+    cond.broadcast();
+    lock.unlock();
+  }
+
+  void DataBuffer::tune(unsigned long long int total, unsigned int& size, int& blocks) {
+    const unsigned int page = page_size();
+    if (size < page) size = page;
+    if (blocks < 1) blocks = 1;
+    if (total > 0) {
+      if (total < size) {
+        // Whole content fits into one block - no need to occupy more memory
+        size = total;
+      } else if ((total / size) > 64) {
+        // Big transfers use bigger blocks to reduce number of system
+        // calls and more of them to keep both sides busy
+        unsigned long long int nsize = total / 64;
+        if (nsize > max_block_size) nsize = max_block_size;
+        if (nsize > size) size = nsize;
+        if (blocks < 4) blocks = 4;
+      }
+    }
+    size = ((size + page - 1) / page) * page;
+  }
+
 } // namespace Arc
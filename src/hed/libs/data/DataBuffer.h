@@ -37,6 +37,8 @@ namespace Arc {
       unsigned int used;
       /// offset in file or similar, has meaning only for application
       unsigned long long int offset;
+      /// number of checksum computations still waiting for content
+      int sum_pending;
     } buf_desc;
     /// amount of data passed through buffer (including current stored).
     /// computed using offset and size. gaps are ignored.
@@ -70,6 +72,54 @@ namespace Arc {
     };
     /// checksums to be computed in this buffer
     std::list<checksum_desc> checksums;
+    /// checksum computation passed to helper thread
+    class sum_job {
+     public:
+      sum_job(CheckSum *sum, int handle, unsigned int length)
+        : sum(sum),
+          handle(handle),
+          length(length) {}
+      CheckSum *sum;
+      int handle;
+      unsigned int length;
+    };
+    /// computations in order of arrival
+    std::list<sum_job> sum_jobs;
+    /// helper thread is computing checksums and does not hold lock
+    bool sum_busy;
+    /// helper thread was started
+    bool sum_thread_started;
+    /// helper thread must exit
+    bool sum_thread_exit;
+    SimpleCounter sum_thread_count;
+    static void sum_thread_start(void *arg);
+    /// computes checksums in helper thread
+    void sum_thread();
+    /// passes content of buffer to checksum, must be called with lock held
+    void sum_add(CheckSum *sum, int handle);
+    /// waits till all checksum computations are done, must be called with lock held
+    void sum_wait();
+    /// states of negotiation of direct transfer between reading and writing parts
+    enum direct_state_t {
+      direct_none,     /// nothing negotiated yet
+      direct_offered,  /// reading part offered descriptor
+      direct_taken,    /// writing part took descriptor and copies data
+      direct_done,     /// direct transfer finished
+      direct_declined  /// buffers are used for transfer
+    };
+    direct_state_t direct_state;
+    /// descriptor and range offered by reading part
+    int direct_fd;
+    unsigned long long int direct_offset;
+    unsigned long long int direct_size;
+    /// checksums of reading part to be computed from directly transferred data
+    std::list<CheckSum*> direct_checksums;
+    /// position up to which checksums of reading part got content
+    unsigned long long int direct_checksums_offset;
+    bool direct_checksums_valid;
+    /// reading and writing parts started to use buffers
+    bool read_started;
+    bool write_started;
 
   public:
     /// This object controls transfer speed
@@ -296,6 +346,61 @@ namespace Arc {
      * If not initialized then this number represents size of default buffer.
      */
     unsigned int buffer_size() const;
+    /// Returns true if any checksum object needs content of transferred data.
+    bool checksum_required() const;
+    /// Offer descriptor of source for copying data without passing it through buffers.
+    /**
+     * Called by reading part before it requested any buffer. Waits till
+     * writing part either takes descriptor with take_direct() or starts
+     * using buffers. If descriptor was taken this method returns only after
+     * writing part called done_direct() and descriptor must be kept open
+     * till then. Reading part then must call eof_read() as usually without
+     * using any buffers.
+     * \param fd descriptor of source opened for reading.
+     * \param offset position of data in source.
+     * \param size amount of data to be transferred.
+     * \param sums checksums of reading part. They are computed from
+     * directly transferred data and finished only if whole data was
+     * seen. Otherwise they are left not computed.
+     * \return true if data was transferred directly.
+     */
+    bool offer_direct(int fd, unsigned long long int offset,
+                      unsigned long long int size,
+                      const std::list<CheckSum*>& sums);
+    /// Take descriptor offered by reading part.
+    /**
+     * Called by writing part before it requested any buffer. Waits till
+     * reading part either offers descriptor or starts using buffers.
+     * If descriptor was taken writing part must copy data from it,
+     * report it with is_direct() and finish with done_direct().
+     * \param fd returns descriptor of source
+     * \param offset returns position of data in source
+     * \param size returns amount of data to transfer
+     * \return true if descriptor was taken.
+     */
+    bool take_direct(int& fd, unsigned long long int& offset,
+                     unsigned long long int& size);
+    /// Informs object that data was transferred directly.
+    /**
+     * \param buf content of transferred data for computing checksums. If
+     * NULL checksums are not computed.
+     * \param length amount of data.
+     * \param offset offset in stream, file, etc.
+     * \return false if transfer must be stopped.
+     */
+    bool is_direct(const char *buf, unsigned int length,
+                   unsigned long long int offset);
+    /// Informs object that direct transfer is finished.
+    void done_direct();
+    /// Adjusts size and number of buffers for expected amount of data.
+    /**
+     * Sizes are rounded to memory pages. Small transfers use smaller blocks
+     * and big ones use bigger blocks and more of them.
+     * \param total expected amount of data, 0 if unknown.
+     * \param size size of every buffer in bytes, modified in place.
+     * \param blocks number of buffers, modified in place.
+     */
+    static void tune(unsigned long long int total, unsigned int& size, int& blocks);
   };
 
 } // namespace Arc
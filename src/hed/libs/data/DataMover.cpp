@@ -495,6 +495,10 @@ namespace Arc {
           bufnum = destination.BufNum();
       }
       bufnum = bufnum * 2;
+      /* adjust to amount of data if known */
+      unsigned int blocksize = bufsize;
+      DataBuffer::tune(source.CheckSize() ? source.GetSize() : 0, blocksize, bufnum);
+      bufsize = blocksize;
       logger.msg(VERBOSE, "Creating buffer: %lli x %i", bufsize, bufnum);
 
       // Checksum logic:
@@ -0,0 +1,155 @@
+// -*- indent-tabs-mode: nil -*-
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <list>
+
+#include <unistd.h>
+
+#include <arc/CheckSum.h>
+#include <arc/Thread.h>
+
+#include "../DataBuffer.h"
+
+class DataBufferTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(DataBufferTest);
+  CPPUNIT_TEST(testTune);
+  CPPUNIT_TEST(testAlignment);
+  CPPUNIT_TEST(testDirect);
+  CPPUNIT_TEST(testDirectDeclined);
+  CPPUNIT_TEST(testDirectNoContent);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void testTune();
+  void testAlignment();
+  void testDirect();
+  void testDirectDeclined();
+  void testDirectNoContent();
+};
+
+void DataBufferTest::testTune() {
+  unsigned int page = sysconf(_SC_PAGESIZE);
+
+  // Unknown size keeps defaults
+  unsigned int size = 1048576;
+  int blocks = 3;
+  Arc::DataBuffer::tune(0, size, blocks);
+  CPPUNIT_ASSERT_EQUAL(1048576u, size);
+  CPPUNIT_ASSERT_EQUAL(3, blocks);
+
+  // Small transfer uses one page
+  Arc::DataBuffer::tune(10, size, blocks);
+  CPPUNIT_ASSERT_EQUAL(page, size);
+  CPPUNIT_ASSERT_EQUAL(3, blocks);
+
+  // Big transfer uses bigger and more blocks
+  size = 1048576;
+  Arc::DataBuffer::tune(10ULL*1024*1024*1024, size, blocks);
+  CPPUNIT_ASSERT_EQUAL(4u*1024*1024, size);
+  CPPUNIT_ASSERT_EQUAL(4, blocks);
+}
+
+void DataBufferTest::testAlignment() {
+  Arc::DataBuffer buffer(1000, 2);
+  int h;
+  unsigned int l;
+  CPPUNIT_ASSERT(buffer.for_read(h, l, false));
+  CPPUNIT_ASSERT_EQUAL(0u, l % (unsigned int)sysconf(_SC_PAGESIZE));
+#ifdef HAVE_POSIX_MEMALIGN
+  CPPUNIT_ASSERT_EQUAL(0UL, ((unsigned long)buffer[h]) % sysconf(_SC_PAGESIZE));
+#endif
+  CPPUNIT_ASSERT(buffer.is_read(h, 0, 0));
+}
+
+static void direct_writer_common(Arc::DataBuffer& buffer, bool content) {
+  int fd;
+  unsigned long long int offset;
+  unsigned long long int size;
+  if (buffer.take_direct(fd, offset, size)) {
+    char data[] = "0123456789";
+    buffer.is_direct(content ? data : NULL, 10, offset);
+    buffer.done_direct();
+  } else {
+    int h;
+    unsigned int l;
+    unsigned long long int o;
+    while (buffer.for_write(h, l, o, true)) buffer.is_written(h);
+  }
+  buffer.eof_write(true);
+}
+
+static void direct_writer(void* arg) {
+  direct_writer_common(*((Arc::DataBuffer*)arg), true);
+}
+
+// Writing part which could not read copied data back
+static void direct_writer_no_content(void* arg) {
+  direct_writer_common(*((Arc::DataBuffer*)arg), false);
+}
+
+void DataBufferTest::testDirect() {
+  Arc::CheckSumAny crc("md5");
+  Arc::CheckSumAny crc_source("md5");
+  Arc::DataBuffer buffer(&crc);
+  Arc::SimpleCounter counter;
+  CPPUNIT_ASSERT(Arc::CreateThreadFunction(&direct_writer, &buffer, &counter));
+  std::list<Arc::CheckSum*> sums;
+  sums.push_back(&crc_source);
+  CPPUNIT_ASSERT(buffer.offer_direct(0, 0, 10, sums));
+  buffer.eof_read(true);
+  counter.wait();
+  CPPUNIT_ASSERT(!buffer.error());
+  CPPUNIT_ASSERT_EQUAL(10ULL, buffer.eof_position());
+  CPPUNIT_ASSERT_EQUAL(10ULL, buffer.speed.transferred_size());
+  // Checksums of buffer and of reading part are computed from data
+  CPPUNIT_ASSERT(buffer.checksum_valid());
+  char sum[100];
+  char sum_source[100];
+  crc.print(sum, sizeof(sum));
+  crc_source.print(sum_source, sizeof(sum_source));
+  CPPUNIT_ASSERT_EQUAL(std::string("md5:781e5e245d69b566979b86e28d23f2c7"), std::string(sum));
+  CPPUNIT_ASSERT_EQUAL(std::string(sum), std::string(sum_source));
+}
+
+void DataBufferTest::testDirectDeclined() {
+  Arc::DataBuffer buffer;
+  int h;
+  unsigned int l;
+  // Reading part which uses buffers can't offer descriptor anymore
+  CPPUNIT_ASSERT(buffer.for_read(h, l, false));
+  CPPUNIT_ASSERT(!buffer.offer_direct(0, 0, 10, std::list<Arc::CheckSum*>()));
+  CPPUNIT_ASSERT(buffer.is_read(h, 10, 0));
+  buffer.eof_read(true);
+  // and writing part does not get it
+  Arc::SimpleCounter counter;
+  CPPUNIT_ASSERT(Arc::CreateThreadFunction(&direct_writer, &buffer, &counter));
+  counter.wait();
+  CPPUNIT_ASSERT(!buffer.error());
+  CPPUNIT_ASSERT_EQUAL(10ULL, buffer.speed.transferred_size());
+}
+
+void DataBufferTest::testDirectNoContent() {
+  Arc::CheckSumAny crc("md5");
+  Arc::CheckSumAny crc_source("md5");
+  Arc::DataBuffer buffer(&crc);
+  Arc::SimpleCounter counter;
+  CPPUNIT_ASSERT(Arc::CreateThreadFunction(&direct_writer_no_content, &buffer, &counter));
+  std::list<Arc::CheckSum*> sums;
+  sums.push_back(&crc_source);
+  CPPUNIT_ASSERT(buffer.offer_direct(0, 0, 10, sums));
+  buffer.eof_read(true);
+  counter.wait();
+  CPPUNIT_ASSERT(!buffer.error());
+  CPPUNIT_ASSERT_EQUAL(10ULL, buffer.eof_position());
+  // Checksums which did not see content are not valid
+  CPPUNIT_ASSERT(!buffer.checksum_valid());
+  CPPUNIT_ASSERT(!crc_source);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DataBufferTest);
@@ -371,6 +371,10 @@ namespace Arc {
     return param;
   }
 
+  cJSON const* JWSE::Claims() const {
+    return content_.Ptr();
+  }
+
 
   void JWSE::Claim(char const* name, cJSON const* value) {
     if(!content_)
@@ -290,27 +290,13 @@ namespace Arc {
       cJSON* issuerObj = cJSON_GetObjectItem(content_.Ptr(), ClaimNameIssuer);
       if(!issuerObj || (issuerObj->type != cJSON_String))
         return false;
-      bool keyProtocolSafe = true;
-      if(strncasecmp("https:", issuerObj->valuestring, 6) != 0) keyProtocolSafe = false;
-
-      OpenIDMetadata serviceMetadata;
-      OpenIDMetadataFetcher metadataFetcher(issuerObj->valuestring);
-      if(!metadataFetcher.Fetch(serviceMetadata))
-        return false;
-      char const * jwksUri = serviceMetadata.JWKSURI();
-      if(strncasecmp("https:", jwksUri, 6) != 0) keyProtocolSafe = false;
-
-      logger_.msg(DEBUG, "JWSE::ExtractPublicKey: fetching jwl key from %s", jwksUri);
-      JWSEKeyFetcher keyFetcher(jwksUri);
-      JWSEKeyHolderList keys;
-      if(!keyFetcher.Fetch(keys))
-        return false;
-      for(JWSEKeyHolderList::iterator keyIt = keys.begin(); keyIt != keys.end(); ++keyIt) {
-        if(strcmp(kidObject->valuestring, (*keyIt)->Id()) == 0) {
-          keyOrigin_ = keyProtocolSafe ? ExternalSafeKey : ExternalUnsafeKey;
-          key_ = *keyIt;
-          return true;
-        }
+      // Issuer metadata and keys are cached and refreshed in background
+      bool keyProtocolSafe = false;
+      JWSEKeyHolder* key = OpenIDKeyCache::Instance().Key(issuerObj->valuestring, kidObject->valuestring, keyProtocolSafe);
+      if(key) {
+        keyOrigin_ = keyProtocolSafe ? ExternalSafeKey : ExternalUnsafeKey;
+        key_ = key;
+        return true;
       }
     } else {
       logger_.msg(ERROR, "JWSE::ExtractPublicKey: no supported key");
@@ -459,7 +445,13 @@ namespace Arc {
       return false;
     if(!(response->Content()))
       return false;
-    AutoPointer<cJSON> content(cJSON_Parse(response->Content()), &cJSON_Delete);
+    return Parse(response->Content(), keys);
+  }
+
+  bool JWSEKeyFetcher::Parse(char const * jwks, JWSEKeyHolderList& keys) {
+    if(!jwks)
+      return false;
+    AutoPointer<cJSON> content(cJSON_Parse(jwks), &cJSON_Delete);
     if(!content)
       return false;
     cJSON* keysObj = cJSON_GetObjectItem(content.Ptr(), "keys");
@@ -52,6 +52,8 @@ namespace Arc {
    public:
     JWSEKeyFetcher(char const * endpoint_url);
     bool Fetch(JWSEKeyHolderList& keys);
+    //! Parses JWKS document and adds obtained keys to list.
+    static bool Parse(char const * content, JWSEKeyHolderList& keys);
    private:
     Arc::URL url_;
     ClientHTTP client_;
@@ -0,0 +1,336 @@
+#include <cstring>
+#include <time.h>
+
+#include <openssl/evp.h>
+
+#include <arc/StringConv.h>
+#include <arc/DateTime.h>
+#include <arc/communication/ClientInterface.h>
+#include <arc/message/MCC.h>
+
+#include "otokens.h"
+#include "jwse_private.h"
+#include "openid_metadata.h"
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+static int EVP_PKEY_up_ref(EVP_PKEY *pkey) {
+  CRYPTO_add(&pkey->references, 1, CRYPTO_LOCK_EVP_PKEY);
+  return 1;
+}
+#endif
+
+
+namespace Arc {
+
+  Logger OpenIDKeyCache::logger_(Logger::getRootLogger(), "OpenIDKeyCache");
+
+  // Failed issuer is not contacted again for that many seconds. Interval
+  // is doubled after every consecutive failure up to max_retry_interval.
+  static const int retry_interval = 10;
+  static const int max_retry_interval = 600;
+
+  class OpenIDHTTPSource: public OpenIDKeyCache::Source {
+   public:
+    virtual bool Retrieve(std::string const & url, std::string& content, int& maxAge);
+  };
+
+  bool OpenIDHTTPSource::Retrieve(std::string const & url, std::string& content, int& maxAge) {
+    maxAge = -1;
+    URL docUrl(url);
+    if(!docUrl)
+      return false;
+    ClientHTTP client(MCCConfig(), docUrl);
+    HTTPClientInfo info;
+    PayloadRaw request;
+    PayloadRawInterface* response(NULL);
+    MCC_Status status = client.process("GET", &request, &info, &response);
+    AutoPointer<PayloadRawInterface> responseHolder(response);
+    if(!status)
+      return false;
+    if(info.code != 200)
+      return false;
+    if(!response)
+      return false;
+    if(!(response->Content()))
+      return false;
+    content.assign(response->Content());
+    // Cache-Control takes precedence over Expires
+    std::multimap<std::string, std::string>::iterator header = info.headers.find("HTTP:cache-control");
+    if(header != info.headers.end()) {
+      std::list<std::string> directives;
+      tokenize(header->second, directives, ",");
+      for(std::list<std::string>::iterator directive = directives.begin(); directive != directives.end(); ++directive) {
+        std::string value = lower(trim(*directive));
+        if((value == "no-cache") || (value == "no-store")) {
+          maxAge = 0;
+          break;
+        } else if(value.compare(0, 8, "max-age=") == 0) {
+          if(stringto(value.substr(8), maxAge) && (maxAge >= 0)) break;
+          maxAge = -1;
+        };
+      };
+    };
+    if(maxAge < 0) {
+      header = info.headers.find("HTTP:expires");
+      if(header != info.headers.end()) {
+        Time expires(header->second);
+        if(expires.GetTime() != Time::UNDEFINED) {
+          time_t now = time(NULL);
+          maxAge = (expires.GetTime() > now) ? (expires.GetTime() - now) : 0;
+        };
+      };
+    };
+    return true;
+  }
+
+
+  OpenIDKeyCache::Issuer::Issuer(): safe(true), metadataExpires(0), keys(new JWSEKeyHolderList),
+       fetched(0), refresh(0), expires(0), failures(0), retry(0), fetching(false) {
+  }
+
+  OpenIDKeyCache::Issuer::~Issuer() {
+    delete keys;
+  }
+
+  OpenIDKeyCache::OpenIDKeyCache(Source* source):
+       source_(source ? source : new OpenIDHTTPSource),
+       defaultAge_(3600), minAge_(60), maxAge_(86400), staleAge_(3600),
+       hits_(0), misses_(0), staleHits_(0), refreshes_(0) {
+  }
+
+  OpenIDKeyCache::~OpenIDKeyCache() {
+    refreshers_.wait();
+    for(std::map<std::string, Issuer*>::iterator issuer = issuers_.begin(); issuer != issuers_.end(); ++issuer)
+      delete issuer->second;
+    delete source_;
+  }
+
+  OpenIDKeyCache& OpenIDKeyCache::Instance() {
+    // Never destroyed because background refreshing may still be running at exit
+    static OpenIDKeyCache* cache = new OpenIDKeyCache();
+    return *cache;
+  }
+
+  void OpenIDKeyCache::Limits(int defaultAge, int minAge, int maxAge, int staleAge) {
+    Glib::Mutex::Lock lock(lock_);
+    if(minAge < 0) minAge = 0;
+    if(maxAge < minAge) maxAge = minAge;
+    if(staleAge < 0) staleAge = 0;
+    defaultAge_ = defaultAge;
+    minAge_ = minAge;
+    maxAge_ = maxAge;
+    staleAge_ = staleAge;
+  }
+
+  void OpenIDKeyCache::Clear() {
+    Glib::Mutex::Lock lock(lock_);
+    for(std::map<std::string, Issuer*>::iterator issuer = issuers_.begin(); issuer != issuers_.end();) {
+      // Entries being fetched are still referenced by fetching thread
+      if(issuer->second->fetching) {
+        issuer->second->expires = 0;
+        issuer->second->metadataExpires = 0;
+        ++issuer;
+        continue;
+      };
+      delete issuer->second;
+      issuers_.erase(issuer++);
+    };
+  }
+
+  unsigned long long int OpenIDKeyCache::Hits() const {
+    Glib::Mutex::Lock lock(lock_);
+    return hits_;
+  }
+
+  unsigned long long int OpenIDKeyCache::Misses() const {
+    Glib::Mutex::Lock lock(lock_);
+    return misses_;
+  }
+
+  unsigned long long int OpenIDKeyCache::StaleHits() const {
+    Glib::Mutex::Lock lock(lock_);
+    return staleHits_;
+  }
+
+  unsigned long long int OpenIDKeyCache::Refreshes() const {
+    Glib::Mutex::Lock lock(lock_);
+    return refreshes_;
+  }
+
+  int OpenIDKeyCache::Validity(int maxAge) const {
+    if(maxAge < 0) maxAge = defaultAge_;
+    if(maxAge < minAge_) maxAge = minAge_;
+    if(maxAge > maxAge_) maxAge = maxAge_;
+    return maxAge;
+  }
+
+  JWSEKeyHolder* OpenIDKeyCache::FindKey(Issuer const & issuer, char const * kid) {
+    for(JWSEKeyHolderList::iterator keyIt = issuer.keys->begin(); keyIt != issuer.keys->end(); ++keyIt) {
+      if(strcmp(kid, (*keyIt)->Id()) != 0) continue;
+      EVP_PKEY* publicKey = const_cast<EVP_PKEY*>((*keyIt)->PublicKey());
+      if(!publicKey) continue;
+      JWSEKeyHolder* key = new JWSEKeyHolder();
+      key->Id(kid);
+      EVP_PKEY_up_ref(publicKey);
+      key->PublicKey(publicKey);
+      return key;
+    };
+    return NULL;
+  }
+
+  bool OpenIDKeyCache::Update(std::string const & issuerUrl, Issuer& issuer, Glib::Mutex::Lock& lock) {
+    std::string jwksUri;
+    if(time(NULL) < issuer.metadataExpires) jwksUri = issuer.jwksUri;
+    lock.release();
+    bool metadataFetched = false;
+    int metadataAge = -1;
+    JWSEKeyHolderList keys;
+    int keysAge = -1;
+    bool result = false;
+    if(jwksUri.empty()) {
+      std::string metadataUrl = issuerUrl;
+      if(metadataUrl.empty() || (metadataUrl[metadataUrl.length()-1] != '/')) metadataUrl += '/';
+      metadataUrl += ".well-known/openid-configuration";
+      std::string content;
+      if(source_->Retrieve(metadataUrl, content, metadataAge)) {
+        OpenIDMetadata metadata;
+        if(metadata.Input(content) && metadata.JWKSURI()) {
+          jwksUri = metadata.JWKSURI();
+          metadataFetched = true;
+        };
+      };
+      if(!metadataFetched) logger_.msg(WARNING, "Failed to obtain metadata of issuer %s", issuerUrl);
+    };
+    if(!jwksUri.empty()) {
+      logger_.msg(DEBUG, "Fetching keys of issuer %s from %s", issuerUrl, jwksUri);
+      std::string content;
+      if(source_->Retrieve(jwksUri, content, keysAge) && JWSEKeyFetcher::Parse(content.c_str(), keys)) {
+        result = true;
+      } else {
+        logger_.msg(WARNING, "Failed to obtain keys of issuer %s from %s", issuerUrl, jwksUri);
+      };
+    };
+    lock.acquire();
+    time_t now = time(NULL);
+    if(metadataFetched) {
+      issuer.jwksUri = jwksUri;
+      issuer.metadataExpires = now + Validity(metadataAge);
+    };
+    if(!result) {
+      int delay = max_retry_interval;
+      if(issuer.failures < 16) {
+        delay = retry_interval << issuer.failures;
+        if(delay > max_retry_interval) delay = max_retry_interval;
+      };
+      ++issuer.failures;
+      issuer.retry = now + delay;
+      logger_.msg(VERBOSE, "Issuer %s will not be contacted for %i seconds", issuerUrl, delay);
+      return false;
+    };
+    int validity = Validity(keysAge);
+    issuer.keys->swap(keys);
+    issuer.safe = (strncasecmp("https:", issuerUrl.c_str(), 6) == 0) &&
+                  (strncasecmp("https:", jwksUri.c_str(), 6) == 0);
+    issuer.fetched = now;
+    issuer.expires = now + validity;
+    // Refresh in background during last fifth of validity period
+    issuer.refresh = now + validity - validity/5;
+    issuer.failures = 0;
+    issuer.retry = 0;
+    return true;
+  }
+
+  class OpenIDKeyCacheRefresh {
+   public:
+    OpenIDKeyCacheRefresh(OpenIDKeyCache& c, std::string const & i): cache(c), issuer(i) {}
+    OpenIDKeyCache& cache;
+    std::string issuer;
+  };
+
+  void OpenIDKeyCache::RefreshThread(void* arg) {
+    AutoPointer<OpenIDKeyCacheRefresh> refresh(reinterpret_cast<OpenIDKeyCacheRefresh*>(arg));
+    OpenIDKeyCache& cache = refresh->cache;
+    Glib::Mutex::Lock lock(cache.lock_);
+    std::map<std::string, Issuer*>::iterator issuer = cache.issuers_.find(refresh->issuer);
+    if(issuer == cache.issuers_.end()) return;
+    if(cache.Update(refresh->issuer, *(issuer->second), lock)) ++cache.refreshes_;
+    issuer->second->fetching = false;
+    cache.cond_.broadcast();
+  }
+
+  JWSEKeyHolder* OpenIDKeyCache::Key(char const * issuerUrl, char const * kid, bool& safe) {
+    safe = false;
+    if(!issuerUrl || !kid) return NULL;
+    std::string issuerName(issuerUrl);
+    Glib::Mutex::Lock lock(lock_);
+    Issuer* issuer = NULL;
+    while(true) {
+      Issuer*& entry = issuers_[issuerName];
+      if(!entry) entry = new Issuer;
+      issuer = entry;
+      time_t now = time(NULL);
+      if(now < issuer->expires) {
+        JWSEKeyHolder* key = FindKey(*issuer, kid);
+        if(key) {
+          ++hits_;
+          safe = issuer->safe;
+          if((now >= issuer->refresh) && !issuer->fetching) {
+            issuer->fetching = true;
+            OpenIDKeyCacheRefresh* refresh = new OpenIDKeyCacheRefresh(*this, issuerName);
+            if(!CreateThreadFunction(&RefreshThread, refresh, &refreshers_)) {
+              delete refresh;
+              issuer->fetching = false;
+            };
+          };
+          return key;
+        };
+        // Unknown key may appear after rotation, but issuer is not asked too often.
+        if(now < issuer->fetched + minAge_) {
+          ++misses_;
+          return NULL;
+        };
+      };
+      if(!issuer->fetching) break;
+      // Wait for concurrent fetching to finish and check again
+      cond_.wait(lock_);
+    };
+    ++misses_;
+    time_t now = time(NULL);
+    bool fetched = false;
+    if(now >= issuer->retry) {
+      issuer->fetching = true;
+      fetched = Update(issuerName, *issuer, lock);
+      issuer->fetching = false;
+      cond_.broadcast();
+      now = time(NULL);
+    };
+    if(!fetched && issuer->keys->empty()) {
+      // Entries of issuers which never provided keys are kept only to remember
+      // back-off and are dropped once it is long over.
+      for(std::map<std::string, Issuer*>::iterator entry = issuers_.begin(); entry != issuers_.end();) {
+        Issuer* other = entry->second;
+        if((other != issuer) && other->keys->empty() && !other->fetching &&
+           (now >= other->retry + max_retry_interval)) {
+          delete other;
+          issuers_.erase(entry++);
+          continue;
+        };
+        ++entry;
+      };
+      return NULL;
+    };
+    if(fetched || (now < issuer->expires + staleAge_)) {
+      JWSEKeyHolder* key = FindKey(*issuer, kid);
+      if(key) {
+        if(!fetched) {
+          ++staleHits_;
+          logger_.msg(WARNING, "Using expired key %s of unreachable issuer %s", kid, issuerName);
+        };
+        safe = issuer->safe;
+        return key;
+      };
+    };
+    return NULL;
+  }
+
+} // namespace Arc
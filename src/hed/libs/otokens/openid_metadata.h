@@ -1,4 +1,7 @@
 #include <string>
+#include <map>
+#include <glibmm/thread.h>
+#include <arc/Thread.h>
 #include <arc/Utils.h>
 #include <arc/URL.h>
 #include <arc/Logger.h>
@@ -9,6 +12,9 @@ struct cJSON;
 
 namespace Arc {
 
+  class JWSEKeyHolder;
+  class JWSEKeyHolderList;
+
   //! Class for parsing, verifying and extracting information
   //! from OpenID Metadata.
   class OpenIDMetadata {
@@ -184,6 +190,107 @@ namespace Arc {
     static Logger logger_;
   };
 
+  //! Process-wide cache of OpenID issuers metadata and their signing keys.
+  /** Keys are identified by issuer and key id (kid). Metadata and key sets
+     are kept as long as allowed by HTTP cache headers (Cache-Control max-age
+     or Expires) limited by configured bounds. Key set which is close to
+     expiration is refreshed in background while cached keys are still
+     served. If issuer can't be reached expired keys are served for limited
+     time. Unknown key id causes refetching of key set, but not more often
+     than minimal age allows. */
+  class OpenIDKeyCache {
+   public:
+    //! Source of metadata and key set documents.
+    class Source {
+     public:
+      virtual ~Source() {}
+      //! Obtains document at specified URL.
+      /** maxAge is set to validity of document in seconds as reported
+         by server or to -1 if not reported. */
+      virtual bool Retrieve(std::string const & url, std::string& content, int& maxAge) = 0;
+    };
+
+    //! Creates cache using specified source of documents.
+    /** Source is taken over by cache. If source is NULL documents are
+       retrieved using HTTP(S). */
+    OpenIDKeyCache(Source* source = NULL);
+
+    ~OpenIDKeyCache();
+
+    //! Cache shared by whole process.
+    static OpenIDKeyCache& Instance();
+
+    //! Returns copy of key with specified id provided by issuer.
+    /** Returns NULL if key is not available. Returned object must be
+       deleted by caller. safe is set to false if issuer metadata or keys
+       were obtained over insecure protocol. */
+    JWSEKeyHolder* Key(char const * issuer, char const * kid, bool& safe);
+
+    //! Sets bounds for validity of cached documents in seconds.
+    /** defaultAge is used if server does not report validity. Reported
+       validity is limited to range between minAge and maxAge. Expired keys
+       are used for staleAge seconds if issuer is not reachable. */
+    void Limits(int defaultAge, int minAge, int maxAge, int staleAge);
+
+    //! Removes all cached information.
+    void Clear();
+
+    //! Number of keys served from cache.
+    unsigned long long int Hits() const;
+    //! Number of requests which needed documents to be retrieved.
+    unsigned long long int Misses() const;
+    //! Number of expired keys served because issuer was not reachable.
+    unsigned long long int StaleHits() const;
+    //! Number of key sets refreshed in background.
+    unsigned long long int Refreshes() const;
+
+   private:
+    class Issuer {
+     public:
+      Issuer();
+      ~Issuer();
+      std::string jwksUri;
+      bool safe;
+      time_t metadataExpires;
+      JWSEKeyHolderList* keys;
+      time_t fetched;
+      time_t refresh;
+      time_t expires;
+      int failures;
+      time_t retry;
+      bool fetching;
+     private:
+      Issuer(Issuer const &);
+      Issuer& operator=(Issuer const &);
+    };
+
+    Source* source_;
+    mutable Glib::Mutex lock_;
+    Glib::Cond cond_;
+    std::map<std::string, Issuer*> issuers_;
+    SimpleCounter refreshers_;
+    int defaultAge_;
+    int minAge_;
+    int maxAge_;
+    int staleAge_;
+    unsigned long long int hits_;
+    unsigned long long int misses_;
+    unsigned long long int staleHits_;
+    unsigned long long int refreshes_;
+    static Logger logger_;
+
+    int Validity(int maxAge) const;
+    // Retrieves documents of issuer and stores them in entry. Must be called
+    // with lock held and entry marked as fetching. Lock is released while
+    // documents are retrieved.
+    bool Update(std::string const & issuerUrl, Issuer& issuer, Glib::Mutex::Lock& lock);
+    static JWSEKeyHolder* FindKey(Issuer const & issuer, char const * kid);
+    static void RefreshThread(void* arg);
+
+    OpenIDKeyCache(OpenIDKeyCache const &);
+    OpenIDKeyCache& operator=(OpenIDKeyCache const &);
+  };
+
 
 } // namespace Arc
 
@@ -77,6 +77,9 @@ namespace Arc {
     //! Access to claim by its name.
     cJSON const* Claim(char const* name) const;
 
+    //! Access to all claims as JSON object.
+    cJSON const* Claims() const;
+
     //! Set specified claim to new value.
     void Claim(char const* name, cJSON const* value);
 
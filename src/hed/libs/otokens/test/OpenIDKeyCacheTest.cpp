@@ -0,0 +1,153 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+
+#include "../otokens.h"
+#include "../jwse_private.h"
+#include "../openid_metadata.h"
+
+// Stub identity provider serving metadata and keys from memory
+class StubIdP: public Arc::OpenIDKeyCache::Source {
+ public:
+  StubIdP(): retrievals(0), fail(false), rotated(false), maxAge(-1) {}
+  virtual bool Retrieve(std::string const & url, std::string& content, int& age) {
+    ++retrievals;
+    age = maxAge;
+    if(fail) return false;
+    if(url == "https://idp.example.org/.well-known/openid-configuration") {
+      content = "{\"issuer\":\"https://idp.example.org\",\"jwks_uri\":\"https://idp.example.org/jwks\"}";
+      return true;
+    }
+    if(url == "https://idp.example.org/jwks") {
+      content = "{\"keys\":[" + jwk("key1") + (rotated ? ("," + jwk("key2")) : std::string()) + "]}";
+      return true;
+    }
+    return false;
+  }
+  int retrievals;
+  bool fail;
+  bool rotated;
+  int maxAge;
+ private:
+  static std::string jwk(char const * kid) {
+    return std::string("{\"kty\":\"RSA\",\"kid\":\"") + kid + "\",\"n\":\"wA7YEmnFt3sjVwAB\",\"e\":\"AQAB\"}";
+  }
+};
+
+class OpenIDKeyCacheTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(OpenIDKeyCacheTest);
+  CPPUNIT_TEST(TestCaching);
+  CPPUNIT_TEST(TestRotation);
+  CPPUNIT_TEST(TestStale);
+  CPPUNIT_TEST(TestUnreachable);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void TestCaching();
+  void TestRotation();
+  void TestStale();
+  void TestUnreachable();
+};
+
+static char const * const issuer = "https://idp.example.org";
+
+void OpenIDKeyCacheTest::TestCaching() {
+  StubIdP* idp = new StubIdP;
+  Arc::OpenIDKeyCache cache(idp);
+  bool safe = false;
+  Arc::AutoPointer<Arc::JWSEKeyHolder> key(cache.Key(issuer, "key1", safe));
+  CPPUNIT_ASSERT(key);
+  CPPUNIT_ASSERT(key->PublicKey());
+  CPPUNIT_ASSERT(safe);
+  CPPUNIT_ASSERT_EQUAL(2, idp->retrievals);
+  CPPUNIT_ASSERT_EQUAL(1ULL, cache.Misses());
+
+  // Second request is served without contacting issuer
+  key = cache.Key(issuer, "key1", safe);
+  CPPUNIT_ASSERT(key);
+  CPPUNIT_ASSERT_EQUAL(2, idp->retrievals);
+  CPPUNIT_ASSERT_EQUAL(1ULL, cache.Hits());
+
+  // Unknown key does not cause new retrieval just after keys were fetched
+  key = cache.Key(issuer, "key2", safe);
+  CPPUNIT_ASSERT(!key);
+  CPPUNIT_ASSERT_EQUAL(2, idp->retrievals);
+
+  // After clearing everything is retrieved again
+  cache.Clear();
+  key = cache.Key(issuer, "key1", safe);
+  CPPUNIT_ASSERT(key);
+  CPPUNIT_ASSERT_EQUAL(4, idp->retrievals);
+}
+
+void OpenIDKeyCacheTest::TestRotation() {
+  StubIdP* idp = new StubIdP;
+  Arc::OpenIDKeyCache cache(idp);
+  cache.Limits(3600, 0, 86400, 3600);
+  bool safe = false;
+  Arc::AutoPointer<Arc::JWSEKeyHolder> key(cache.Key(issuer, "key1", safe));
+  CPPUNIT_ASSERT(key);
+  CPPUNIT_ASSERT_EQUAL(2, idp->retrievals);
+
+  // New key makes only key set to be retrieved again
+  idp->rotated = true;
+  key = cache.Key(issuer, "key2", safe);
+  CPPUNIT_ASSERT(key);
+  CPPUNIT_ASSERT_EQUAL(std::string("key2"), std::string(key->Id()));
+  CPPUNIT_ASSERT_EQUAL(3, idp->retrievals);
+}
+
+void OpenIDKeyCacheTest::TestStale() {
+  StubIdP* idp = new StubIdP;
+  idp->maxAge = 0;
+  Arc::OpenIDKeyCache cache(idp);
+  // Keys expire immediately
+  cache.Limits(0, 0, 0, 3600);
+  bool safe = false;
+  Arc::AutoPointer<Arc::JWSEKeyHolder> key(cache.Key(issuer, "key1", safe));
+  CPPUNIT_ASSERT(key);
+
+  // Unreachable issuer - expired key is still served
+  idp->fail = true;
+  key = cache.Key(issuer, "key1", safe);
+  CPPUNIT_ASSERT(key);
+  CPPUNIT_ASSERT_EQUAL(1ULL, cache.StaleHits());
+  int retrievals = idp->retrievals;
+
+  // Failed issuer is not contacted again immediately and
+  // without allowed staleness there is no key.
+  cache.Limits(0, 0, 0, 0);
+  key = cache.Key(issuer, "key1", safe);
+  CPPUNIT_ASSERT(!key);
+  CPPUNIT_ASSERT_EQUAL(retrievals, idp->retrievals);
+}
+
+void OpenIDKeyCacheTest::TestUnreachable() {
+  StubIdP* idp = new StubIdP;
+  idp->fail = true;
+  Arc::OpenIDKeyCache cache(idp);
+  bool safe = false;
+  Arc::AutoPointer<Arc::JWSEKeyHolder> key(cache.Key(issuer, "key1", safe));
+  CPPUNIT_ASSERT(!key);
+  int retrievals = idp->retrievals;
+  CPPUNIT_ASSERT(retrievals > 0);
+
+  // Issuer which never provided keys is still backed off
+  idp->fail = false;
+  key = cache.Key(issuer, "key1", safe);
+  CPPUNIT_ASSERT(!key);
+  CPPUNIT_ASSERT_EQUAL(retrievals, idp->retrievals);
+
+  // Clearing forgets failure
+  cache.Clear();
+  key = cache.Key(issuer, "key1", safe);
+  CPPUNIT_ASSERT(key);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(OpenIDKeyCacheTest);
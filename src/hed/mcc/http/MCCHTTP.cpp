@@ -138,6 +138,15 @@ bool HTTPSecAttr::Export(SecAttrFormat format,XMLNode &val) const {
   return false;
 }
 
+// Keeps data which was read from connection together with previous
+// request but belongs to next one.
+class MCC_HTTP_Context:public MessageContextElement {
+ public:
+  std::string buffered;
+  MCC_HTTP_Context(void) { };
+  virtual ~MCC_HTTP_Context(void) { };
+};
+
 MCC_HTTP_Service::MCC_HTTP_Service(Config *cfg,PluginArgument* parg):MCC_HTTP(cfg,parg) {
   XMLNode header_node = (*cfg)["Header"];
   while(header_node) {
@@ -235,8 +244,20 @@ MCC_Status MCC_HTTP_Service::process(Message& inmsg,Message& outmsg) {
     inpayload = dynamic_cast<PayloadStreamInterface*>(inmsg.Payload());
   } catch(std::exception& e) { };
   if(!inpayload) return MCC_Status();
+  // Obtaining data left from previous request on same connection
+  MCC_HTTP_Context* context = NULL;
+  if(inmsg.Context()) {
+    MessageContextElement* mcontext = (*inmsg.Context())["http.service"];
+    if(mcontext) {
+      try {
+        context = dynamic_cast<MCC_HTTP_Context*>(mcontext);
+      } catch(std::exception& e) { };
+    };
+  };
+  std::string buffered;
+  if(context) buffered.swap(context->buffered);
   // Converting stream payload to HTTP which implements raw and stream interfaces
-  PayloadHTTPIn nextpayload(*inpayload);
+  PayloadHTTPIn nextpayload(*inpayload,false,false,buffered);
   if(!nextpayload) {
     logger.msg(WARNING, "Cannot create http payload");
     return make_http_fault(logger,nextpayload,*inpayload,outmsg,HTTP_BAD_REQUEST,headers_);
@@ -426,6 +447,19 @@ MCC_Status MCC_HTTP_Service::process(Message& inmsg,Message& outmsg) {
   if(!keep_alive) return MCC_Status(SESSION_CLOSE);
   // Make sure whole body sent to us was fetch from input stream.
   if(!nextpayload.Sync()) return MCC_Status(SESSION_CLOSE);
+  // Anything read beyond this request is beginning of next one
+  nextpayload.Buffered(buffered);
+  if(!buffered.empty()) {
+    if(!context && inmsg.Context()) {
+      context = new MCC_HTTP_Context;
+      inmsg.Context()->Add("http.service",context);
+    };
+    if(context) {
+      context->buffered.swap(buffered);
+      // Next request is already here - lower MCC must not wait for socket
+      outmsg.Attributes()->set("TCP:BUFFERED","yes");
+    };
+  };
   return MCC_Status(STATUS_OK);
 }
 
@@ -565,12 +565,15 @@ bool PayloadHTTPIn::get_body(void) {
   return true;
 }
 
-PayloadHTTPIn::PayloadHTTPIn(PayloadStreamInterface& stream,bool own,bool head_response):
+PayloadHTTPIn::PayloadHTTPIn(PayloadStreamInterface& stream,bool own,bool head_response,const std::string& buffered):
     head_response_(head_response),chunked_(CHUNKED_NONE),chunk_size_(0),
     multipart_(MULTIPART_NONE),stream_(&stream),stream_offset_(0),
     stream_own_(own),fetched_(false),header_read_(false),body_read_(false),
     body_(NULL),body_size_(0) {
-  tbuf_[0]=0; tbuflen_=0;
+  tbuflen_ = buffered.length();
+  if(tbuflen_ > (int)(sizeof(tbuf_)-1)) tbuflen_ = sizeof(tbuf_)-1;
+  memcpy(tbuf_,buffered.c_str(),tbuflen_);
+  tbuf_[tbuflen_]=0;
   if(!parse_header()) {
     error_ = IString("Failed to parse HTTP header").str();
     return;
@@ -755,6 +758,11 @@ bool PayloadHTTPIn::Sync(void) {
   return false;
 }
 
+void PayloadHTTPIn::Buffered(std::string& buf) {
+  buf.assign(tbuf_,tbuflen_);
+  tbuf_[0]=0; tbuflen_=0;
+}
+
 // ------------------- PayloadHTTPOut ---------------------------
 
 void PayloadHTTPOut::Attribute(const std::string& name,const std::string& value) {
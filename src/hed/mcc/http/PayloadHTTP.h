@@ -158,8 +158,9 @@ class PayloadHTTPIn: public PayloadHTTP, public PayloadRawInterface, public Payl
     Supplied stream is associated with object for later use. If 'own' is set to true
     then stream will be deleted in destructor. Because stream can be used by this
     object during whole lifetime it is important not to destroy stream till this 
-    object is deleted. */
-  PayloadHTTPIn(PayloadStreamInterface& stream,bool own = false,bool head_response = false);
+    object is deleted. If 'buffered' is not empty it is used as beginning of
+    message before reading from 'stream'. */
+  PayloadHTTPIn(PayloadStreamInterface& stream,bool own = false,bool head_response = false,const std::string& buffered = "");
 
   virtual ~PayloadHTTPIn(void);
 
@@ -174,6 +175,9 @@ class PayloadHTTPIn: public PayloadHTTP, public PayloadRawInterface, public Payl
   // Fetch anything what is left of current request from input stream 
   // to sync for next request.
   virtual bool Sync(void);
+  // Move data already read from stream past end of current message
+  // into 'buf'. Makes sense only after Sync().
+  void Buffered(std::string& buf);
 
   // PayloadRawInterface implemented methods
   virtual char operator[](PayloadRawInterface::Size_t pos) const;
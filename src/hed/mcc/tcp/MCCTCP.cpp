@@ -13,6 +13,10 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <netdb.h>
+#include <fcntl.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
 #define ErrNo errno
 
 #include <arc/message/PayloadStream.h>
@@ -67,7 +71,8 @@ namespace ArcMCCTCP {
 using namespace Arc;
 
 
-MCC_TCP_Service::MCC_TCP_Service(Config *cfg, PluginArgument* parg):MCC_TCP(cfg,parg),valid_(false),max_executers_(-1),max_executers_drop_(false) {
+MCC_TCP_Service::MCC_TCP_Service(Config *cfg, PluginArgument* parg):MCC_TCP(cfg,parg),valid_(false),max_executers_(-1),max_executers_drop_(false),workers_(0),workers_running_(0),shutdown_(false),poll_handle_(-1),accepting_(false) {
+    wakeup_[0] = -1; wakeup_[1] = -1;
     for(int i = 0;;++i) {
         struct addrinfo hint;
         struct addrinfo *info = NULL;
@@ -208,9 +213,60 @@ MCC_TCP_Service::MCC_TCP_Service(Config *cfg, PluginArgument* parg):MCC_TCP(cfg,
         logger.msg(INFO, "Setting connections limit to %i, connections over limit will be %s",max_executers_,max_executers_drop_?istring("dropped"):istring("put on hold"));
       };
     };
-    if(!CreateThreadFunction(&listener,this)) {
-        logger.msg(ERROR, "Failed to start thread for listening");
-        for(std::list<mcc_tcp_handle_t>::iterator i = handles_.begin();i!=handles_.end();i=handles_.erase(i)) ::close(i->handle);
+    if((*cfg)["Workers"]) {
+      std::string v = (*cfg)["Workers"];
+      workers_ = atoi(v.c_str());
+      if(workers_ < 0) workers_ = 0;
+#ifdef HAVE_SYS_EPOLL_H
+      if(workers_ > 0) {
+        poll_handle_ = ::epoll_create(1);
+        if(poll_handle_ == -1) {
+          logger.msg(WARNING, "Failed to create event loop, falling back to thread per connection: %s", StrError(errno));
+          workers_ = 0;
+        } else if(::pipe(wakeup_) == -1) {
+          logger.msg(WARNING, "Failed to create event loop, falling back to thread per connection: %s", StrError(errno));
+          ::close(poll_handle_); poll_handle_ = -1;
+          workers_ = 0;
+        } else {
+          ::fcntl(poll_handle_, F_SETFD, FD_CLOEXEC);
+          ::fcntl(wakeup_[0], F_SETFD, FD_CLOEXEC);
+          ::fcntl(wakeup_[1], F_SETFD, FD_CLOEXEC);
+          ::fcntl(wakeup_[0], F_SETFL, O_NONBLOCK);
+          ::fcntl(wakeup_[1], F_SETFL, O_NONBLOCK);
+          struct epoll_event ev;
+          memset(&ev, 0, sizeof(ev));
+          ev.events = EPOLLIN;
+          ev.data.fd = wakeup_[0];
+          ::epoll_ctl(poll_handle_, EPOLL_CTL_ADD, wakeup_[0], &ev);
+        };
+      };
+#else
+      if(workers_ > 0) {
+        logger.msg(WARNING, "Event-driven connection processing is not supported on this system, falling back to thread per connection");
+        workers_ = 0;
+      };
+#endif
+    };
+    if(workers_ > 0) {
+        logger.msg(INFO, "Serving connections with %i worker threads", workers_);
+        lock_.lock();
+        for(int n = 0; n < workers_; ++n) {
+            if(!CreateThreadFunction(&worker,this)) {
+                logger.msg(ERROR, "Failed to start worker thread");
+                break;
+            };
+            ++workers_running_;
+        };
+        lock_.unlock();
+        if(workers_running_ <= 0) {
+            for(std::list<mcc_tcp_handle_t>::iterator i = handles_.begin();i!=handles_.end();i=handles_.erase(i)) ::close(i->handle);
+        };
+    };
+    if(!handles_.empty()) {
+        if(!CreateThreadFunction((workers_ > 0)?&poller:&listener,this)) {
+            logger.msg(ERROR, "Failed to start thread for listening");
+            for(std::list<mcc_tcp_handle_t>::iterator i = handles_.begin();i!=handles_.end();i=handles_.erase(i)) ::close(i->handle);
+        };
     };
     valid_ = true;
 }
@@ -224,6 +280,12 @@ MCC_TCP_Service::~MCC_TCP_Service(void) {
     for(std::list<mcc_tcp_exec_t>::iterator e = executers_.begin();e != executers_.end();++e) {
         ::shutdown(e->handle,2);
     };
+    shutdown_ = true;
+    for(std::map<int,mcc_tcp_conn_t*>::iterator c = conns_.begin();c != conns_.end();++c) {
+        ::shutdown(c->first,2);
+    };
+    ready_cond_.broadcast();
+    wakeup();
     if(!valid_) {
         for(std::list<mcc_tcp_handle_t>::iterator i = handles_.begin();i!=handles_.end();i=handles_.erase(i)) { };
     };
@@ -231,10 +293,16 @@ MCC_TCP_Service::~MCC_TCP_Service(void) {
     while(executers_.size() > 0) {
         lock_.unlock(); sleep(1); lock_.lock();
     };
+    while((workers_running_ > 0) || (conns_.size() > 0)) {
+        lock_.unlock(); sleep(1); lock_.lock();
+    };
     while(handles_.size() > 0) {
         lock_.unlock(); sleep(1); lock_.lock();
     };
     lock_.unlock();
+    if(poll_handle_ != -1) ::close(poll_handle_);
+    if(wakeup_[0] != -1) ::close(wakeup_[0]);
+    if(wakeup_[1] != -1) ::close(wakeup_[1]);
 }
 
 MCC_TCP_Service::mcc_tcp_exec_t::mcc_tcp_exec_t(MCC_TCP_Service* o,int h,int t,bool nd):obj(o),handle(h),no_delay(nd),timeout(t) {
@@ -471,96 +539,98 @@ static bool get_host_port(struct sockaddr_storage *addr, std::string &host, std:
     return true;
 }
 
-void MCC_TCP_Service::executer(void* arg) {
-    MCC_TCP_Service& it = *(((mcc_tcp_exec_t*)arg)->obj);
-    int s = ((mcc_tcp_exec_t*)arg)->handle;
-    int no_delay = ((mcc_tcp_exec_t*)arg)->no_delay;
-    int timeout = ((mcc_tcp_exec_t*)arg)->timeout;
-    std::string host_attr,port_attr;
-    std::string remotehost_attr,remoteport_attr;
-    std::string endpoint_attr;
+MCC_TCP_Service::mcc_tcp_conn_t::mcc_tcp_conn_t(int h,int t,bool nd):handle(h),timeout(t),last_used(time(NULL)),busy(false),buffered(false),stream(h,t,logger) {
+    stream.NoDelay(nd);
     // Extract useful attributes
-    {
-        struct sockaddr_storage addr;
-        socklen_t addrlen;
-        addrlen=sizeof(addr);
-        if(getsockname(s, (struct sockaddr*)(&addr), &addrlen) == 0) {
-            if (get_host_port(&addr, host_attr, port_attr) == true) {
-                endpoint_attr = "://"+host_attr+":"+port_attr;
-            }
-        }
-        if(getpeername(s, (struct sockaddr*)&addr, &addrlen) == 0) {
-            get_host_port(&addr, remotehost_attr, remoteport_attr);
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+    addrlen=sizeof(addr);
+    if(getsockname(handle, (struct sockaddr*)(&addr), &addrlen) == 0) {
+        if (get_host_port(&addr, host_attr, port_attr) == true) {
+            endpoint_attr = "://"+host_attr+":"+port_attr;
         }
-        // SESSIONID
-    };
+    }
+    if(getpeername(handle, (struct sockaddr*)&addr, &addrlen) == 0) {
+        get_host_port(&addr, remotehost_attr, remoteport_attr);
+    }
+    // SESSIONID
+}
 
-    // Creating stream payload
-    PayloadTCPSocket stream(s, timeout, logger);
-    stream.NoDelay(no_delay);
-    MessageContext context;
-    MessageAuthContext auth_context;
-    for(;;) {
-        // TODO: Check state of socket here and leave immediately if not connected anymore.
-        // Preparing Message objects for chain
-        MessageAttributes attributes_in;
-        MessageAttributes attributes_out;
-        MessageAuth auth_in;
-        MessageAuth auth_out;
-        Message nextinmsg;
-        Message nextoutmsg;
-        nextinmsg.Payload(&stream);
-        nextinmsg.Attributes(&attributes_in);
-        nextinmsg.Attributes()->set("TCP:HOST",host_attr);
-        nextinmsg.Attributes()->set("TCP:PORT",port_attr);
-        nextinmsg.Attributes()->set("TCP:REMOTEHOST",remotehost_attr);
-        nextinmsg.Attributes()->set("TCP:REMOTEPORT",remoteport_attr);
-        nextinmsg.Attributes()->set("TCP:ENDPOINT",endpoint_attr);
-        nextinmsg.Attributes()->set("ENDPOINT",endpoint_attr);
-        nextinmsg.Context(&context);
-        nextinmsg.Auth(&auth_in);
-        TCPSecAttr* tattr = new TCPSecAttr(remotehost_attr, remoteport_attr, host_attr, port_attr);
-        nextinmsg.Auth()->set("TCP",tattr);
-        nextinmsg.AuthContext(&auth_context);
-        nextoutmsg.Attributes(&attributes_out);
-        nextoutmsg.Context(&context);
-        nextoutmsg.Auth(&auth_out);
-        nextoutmsg.AuthContext(&auth_context);
-        if(!it.ProcessSecHandlers(nextinmsg,"incoming")) break;
-        // Call next MCC
-        MCCInterface* next = it.Next();
-        if(!next) break;
-        logger.msg(VERBOSE, "next chain element called");
-        MCC_Status ret = next->process(nextinmsg,nextoutmsg);
-        if(!it.ProcessSecHandlers(nextoutmsg,"outgoing")) {
-          if(nextoutmsg.Payload()) delete nextoutmsg.Payload();
-          break;
-        };
-        // If nextoutmsg contains some useful payload send it here.
-        // So far only buffer payload is supported
-        // Extracting payload
-        if(nextoutmsg.Payload()) {
-            PayloadRawInterface* outpayload = NULL;
-            try {
-                outpayload = dynamic_cast<PayloadRawInterface*>(nextoutmsg.Payload());
-            } catch(std::exception& e) { };
-            if(!outpayload) {
-                logger.msg(WARNING, "Only Raw Buffer payload is supported for output");
-            } else {
-                // Sending payload
-                for(int n=0;;++n) {
-                    char* buf = outpayload->Buffer(n);
-                    if(!buf) break;
-                    int bufsize = outpayload->BufferSize(n);
-                    if(!(stream.Put(buf,bufsize))) {
-                        logger.msg(ERROR, "Failed to send content of buffer");
-                        break;
-                    };
+bool MCC_TCP_Service::serve(mcc_tcp_conn_t& conn) {
+    // TODO: Check state of socket here and leave immediately if not connected anymore.
+    // Preparing Message objects for chain
+    MessageAttributes attributes_in;
+    MessageAttributes attributes_out;
+    MessageAuth auth_in;
+    MessageAuth auth_out;
+    Message nextinmsg;
+    Message nextoutmsg;
+    nextinmsg.Payload(&conn.stream);
+    nextinmsg.Attributes(&attributes_in);
+    nextinmsg.Attributes()->set("TCP:HOST",conn.host_attr);
+    nextinmsg.Attributes()->set("TCP:PORT",conn.port_attr);
+    nextinmsg.Attributes()->set("TCP:REMOTEHOST",conn.remotehost_attr);
+    nextinmsg.Attributes()->set("TCP:REMOTEPORT",conn.remoteport_attr);
+    nextinmsg.Attributes()->set("TCP:ENDPOINT",conn.endpoint_attr);
+    nextinmsg.Attributes()->set("ENDPOINT",conn.endpoint_attr);
+    nextinmsg.Context(&conn.context);
+    nextinmsg.Auth(&auth_in);
+    TCPSecAttr* tattr = new TCPSecAttr(conn.remotehost_attr, conn.remoteport_attr, conn.host_attr, conn.port_attr);
+    nextinmsg.Auth()->set("TCP",tattr);
+    nextinmsg.AuthContext(&conn.auth_context);
+    nextoutmsg.Attributes(&attributes_out);
+    nextoutmsg.Context(&conn.context);
+    nextoutmsg.Auth(&auth_out);
+    nextoutmsg.AuthContext(&conn.auth_context);
+    conn.buffered = false;
+    if(!ProcessSecHandlers(nextinmsg,"incoming")) return false;
+    // Call next MCC
+    MCCInterface* next = Next();
+    if(!next) return false;
+    logger.msg(VERBOSE, "next chain element called");
+    MCC_Status ret = next->process(nextinmsg,nextoutmsg);
+    if(!ProcessSecHandlers(nextoutmsg,"outgoing")) {
+      if(nextoutmsg.Payload()) delete nextoutmsg.Payload();
+      return false;
+    };
+    // If nextoutmsg contains some useful payload send it here.
+    // So far only buffer payload is supported
+    // Extracting payload
+    if(nextoutmsg.Payload()) {
+        PayloadRawInterface* outpayload = NULL;
+        try {
+            outpayload = dynamic_cast<PayloadRawInterface*>(nextoutmsg.Payload());
+        } catch(std::exception& e) { };
+        if(!outpayload) {
+            logger.msg(WARNING, "Only Raw Buffer payload is supported for output");
+        } else {
+            // Sending payload
+            for(int n=0;;++n) {
+                char* buf = outpayload->Buffer(n);
+                if(!buf) break;
+                int bufsize = outpayload->BufferSize(n);
+                if(!(conn.stream.Put(buf,bufsize))) {
+                    logger.msg(ERROR, "Failed to send content of buffer");
+                    break;
                 };
             };
-            delete nextoutmsg.Payload();
         };
-        if(!ret) break;
+        delete nextoutmsg.Payload();
+    };
+    if(!ret) return false;
+    // Upper MCCs (TLS, HTTP) report if they have read ahead
+    conn.buffered = (attributes_out.get("TCP:BUFFERED") == "yes");
+    return true;
+}
+
+void MCC_TCP_Service::executer(void* arg) {
+    MCC_TCP_Service& it = *(((mcc_tcp_exec_t*)arg)->obj);
+    int s = ((mcc_tcp_exec_t*)arg)->handle;
+    int no_delay = ((mcc_tcp_exec_t*)arg)->no_delay;
+    int timeout = ((mcc_tcp_exec_t*)arg)->timeout;
+    {
+        mcc_tcp_conn_t conn(s, timeout, no_delay);
+        while(it.serve(conn)) { };
     };
     it.lock_.lock();
     for(std::list<mcc_tcp_exec_t>::iterator e = it.executers_.begin();e != it.executers_.end();++e) {
@@ -579,6 +649,208 @@ void MCC_TCP_Service::executer(void* arg) {
     return;
 }
 
+void MCC_TCP_Service::wakeup(void) {
+    if(wakeup_[1] == -1) return;
+    char c = 0;
+    (void)::write(wakeup_[1],&c,1);
+}
+
+void MCC_TCP_Service::drop(mcc_tcp_conn_t* conn) {
+    // lock_ is acquired externally
+    conns_.erase(conn->handle);
+    int s = conn->handle;
+    // Connection context may still refer to socket, hence destroy it first
+    delete conn;
+    ::shutdown(s,2);
+    ::close(s);
+    cond_.signal();
+    // Listening may have been suspended because of connections limit
+    if((max_executers_ > 0) && (!accepting_)) wakeup();
+}
+
+void MCC_TCP_Service::worker(void* arg) {
+    MCC_TCP_Service& it = *((MCC_TCP_Service*)arg);
+    it.lock_.lock();
+    for(;;) {
+        while((!it.shutdown_) && it.ready_.empty()) it.ready_cond_.wait(it.lock_);
+        if(it.ready_.empty()) break;
+        mcc_tcp_conn_t* conn = it.ready_.front();
+        it.ready_.pop_front();
+        if(it.shutdown_) {
+            it.drop(conn);
+            continue;
+        };
+        it.lock_.unlock();
+        // Connection is dispatched only when it has data to read - on
+        // socket or already buffered by upper MCCs. So request is
+        // processed without blocking worker on idle socket.
+        bool keep = it.serve(*conn);
+        it.lock_.lock();
+#ifdef HAVE_SYS_EPOLL_H
+        if(keep && !it.shutdown_ && conn->buffered) {
+            // Next request is already buffered by upper MCCs and socket
+            // may never become readable for it. Dispatch again behind
+            // other waiting connections.
+            it.ready_.push_back(conn);
+            it.ready_cond_.signal();
+            continue;
+        };
+        if(keep && !it.shutdown_) {
+            // Park connection in event loop till next request arrives.
+            conn->busy = false;
+            conn->last_used = time(NULL);
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLIN | EPOLLONESHOT;
+            ev.data.fd = conn->handle;
+            if(::epoll_ctl(it.poll_handle_, EPOLL_CTL_MOD, conn->handle, &ev) == 0) continue;
+            logger.msg(ERROR, "Failed to return connection to event loop: %s", StrError(errno));
+        };
+#endif
+        it.drop(conn);
+    };
+    logger.msg(VERBOSE, "TCP worker is exiting");
+    --(it.workers_running_);
+    it.lock_.unlock();
+    return;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+
+void MCC_TCP_Service::poller(void* arg) {
+    MCC_TCP_Service& it = *((MCC_TCP_Service*)arg);
+    const int max_events = 64;
+    struct epoll_event events[max_events];
+    time_t last_check = time(NULL);
+    for(;;) {
+        it.lock_.lock();
+        int handles_num = 0;
+        for(std::list<mcc_tcp_handle_t>::iterator i = it.handles_.begin();i!=it.handles_.end();) {
+            if(i->handle == -1) { i=it.handles_.erase(i); continue; };
+            ++handles_num; ++i;
+        };
+        if((handles_num == 0) || it.shutdown_) {
+            // Closing parked connections. Busy ones are handled by workers.
+            for(std::map<int,mcc_tcp_conn_t*>::iterator c = it.conns_.begin();c != it.conns_.end();) {
+                mcc_tcp_conn_t* conn = c->second; ++c;
+                if(!conn->busy) it.drop(conn);
+            };
+            it.shutdown_ = true;
+            it.ready_cond_.broadcast();
+            for(std::list<mcc_tcp_handle_t>::iterator i = it.handles_.begin();i!=it.handles_.end();) {
+                if(i->handle != -1) ::close(i->handle);
+                i=it.handles_.erase(i);
+            };
+            it.lock_.unlock();
+            break;
+        };
+        // Listening sockets are taken out of event loop while
+        // connections limit is reached.
+        bool accept_now = (it.max_executers_ <= 0) || it.max_executers_drop_ ||
+                          (it.conns_.size() < (size_t) it.max_executers_);
+        if(accept_now != it.accepting_) {
+            if(!accept_now) logger.msg(WARNING, "Too many connections - waiting for old to close");
+            for(std::list<mcc_tcp_handle_t>::iterator i = it.handles_.begin();i!=it.handles_.end();++i) {
+                struct epoll_event ev;
+                memset(&ev, 0, sizeof(ev));
+                ev.events = EPOLLIN;
+                ev.data.fd = i->handle;
+                ::epoll_ctl(it.poll_handle_, accept_now?EPOLL_CTL_ADD:EPOLL_CTL_DEL, i->handle, &ev);
+            };
+            it.accepting_ = accept_now;
+        };
+        it.lock_.unlock();
+        int n = ::epoll_wait(it.poll_handle_,events,max_events,2000);
+        if(n < 0) {
+            if(ErrNo != EINTR) {
+                logger.msg(ERROR, "Failed while waiting for connection request");
+                it.lock_.lock();
+                for(std::list<mcc_tcp_handle_t>::iterator i = it.handles_.begin();i!=it.handles_.end();++i) {
+                    if(i->handle != -1) ::close(i->handle);
+                    i->handle = -1;
+                };
+                it.lock_.unlock();
+            };
+            continue;
+        };
+        it.lock_.lock();
+        for(int e = 0; e < n; ++e) {
+            int s = events[e].data.fd;
+            if(s == it.wakeup_[0]) {
+                char buf[16];
+                while(::read(s,buf,sizeof(buf)) > 0) { };
+                continue;
+            };
+            std::map<int,mcc_tcp_conn_t*>::iterator c = it.conns_.find(s);
+            if(c != it.conns_.end()) {
+                mcc_tcp_conn_t* conn = c->second;
+                if(it.shutdown_) continue;
+                if(!(events[e].events & EPOLLIN)) {
+                    // Error or hangup without data
+                    it.drop(conn);
+                    continue;
+                };
+                conn->busy = true;
+                it.ready_.push_back(conn);
+                it.ready_cond_.signal();
+                continue;
+            };
+            std::list<mcc_tcp_handle_t>::iterator i = it.handles_.begin();
+            for(;i!=it.handles_.end();++i) if(i->handle == s) break;
+            if(i == it.handles_.end()) continue;
+            struct sockaddr addr;
+            socklen_t addrlen = sizeof(addr);
+            int h = ::accept(s,&addr,&addrlen);
+            if(h == -1) {
+                logger.msg(ERROR, "Failed to accept connection request");
+                continue;
+            };
+            if((it.max_executers_ > 0) &&
+               (it.conns_.size() >= (size_t) it.max_executers_)) {
+                logger.msg(WARNING, "Too many connections - dropping new one");
+                ::shutdown(h,2);
+                ::close(h);
+                continue;
+            };
+            ::fcntl(h, F_SETFD, FD_CLOEXEC);
+            mcc_tcp_conn_t* conn = new mcc_tcp_conn_t(h,i->timeout,i->no_delay);
+            it.conns_[h] = conn;
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLIN | EPOLLONESHOT;
+            ev.data.fd = h;
+            if(::epoll_ctl(it.poll_handle_, EPOLL_CTL_ADD, h, &ev) != 0) {
+                logger.msg(ERROR, "Failed to add connection to event loop: %s", StrError(errno));
+                it.drop(conn);
+            };
+        };
+        // Closing connections idle for longer than their timeout. That
+        // matches behavior of dedicated thread waiting for next request.
+        time_t now = time(NULL);
+        if(now != last_check) {
+            last_check = now;
+            for(std::map<int,mcc_tcp_conn_t*>::iterator c = it.conns_.begin();c != it.conns_.end();) {
+                mcc_tcp_conn_t* conn = c->second; ++c;
+                if(conn->busy) continue;
+                if(((int)(now - conn->last_used)) > conn->timeout) {
+                    logger.msg(VERBOSE, "Closing idle connection");
+                    it.drop(conn);
+                };
+            };
+        };
+        it.lock_.unlock();
+    };
+    return;
+}
+
+#else
+
+void MCC_TCP_Service::poller(void* arg) {
+    // Event loop is never started if epoll is not available
+}
+
+#endif
+
 MCC_Status MCC_TCP_Service::process(Message&,Message&) {
   // Service is not really processing messages because there
   // are no lower lelel MCCs in chain.
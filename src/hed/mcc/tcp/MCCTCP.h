@@ -1,6 +1,9 @@
 #ifndef __ARC_MCCTCP_H__
 #define __ARC_MCCTCP_H__
 
+#include <map>
+#include <list>
+
 #include <arc/message/MCC.h>
 #include <arc/message/PayloadStream.h>
 #include "PayloadTCPSocket.h"
@@ -38,6 +41,11 @@ using namespace Arc;
    TCP:REMOTEPORT - TCP port from which connection is accepted
    TCP:ENDPOINT - URL-like representation of remote connection - ://HOST:PORT
    ENDPOINT - global attribute equal to TCP:ENDPOINT
+  If Workers element is specified in configuration (and system supports
+ epoll) then instead of dedicated thread per connection fixed pool of
+ threads is used. Connections waiting for next request are kept in event
+ loop of listening thread and passed to one of worker threads only when
+ there is data to read.
 */
 class MCC_TCP_Service: public MCC_TCP
 {
@@ -60,6 +68,23 @@ class MCC_TCP_Service: public MCC_TCP
                 mcc_tcp_handle_t(int h, int t, bool nd = false):handle(h),no_delay(nd),timeout(t) { };
                 operator int(void) { return handle; };
         };
+        class mcc_tcp_conn_t {
+            public:
+                int handle;
+                int timeout;
+                time_t last_used;
+                bool busy;
+                bool buffered; /** upper MCCs already hold data of next request */
+                std::string host_attr;
+                std::string port_attr;
+                std::string remotehost_attr;
+                std::string remoteport_attr;
+                std::string endpoint_attr;
+                PayloadTCPSocket stream;
+                MessageContext context;
+                MessageAuthContext auth_context;
+                mcc_tcp_conn_t(int h,int t, bool nd = false);
+        };
         bool valid_;
         std::list<mcc_tcp_handle_t> handles_; /** listening sockets */
         std::list<mcc_tcp_exec_t> executers_; /** active connections and associated threads */
@@ -68,8 +93,27 @@ class MCC_TCP_Service: public MCC_TCP
         /* pthread_t listen_th_; ** thread listening for incoming connections */
         Glib::Mutex lock_; /** lock for safe operations in internal lists */
         Glib::Cond cond_;
+        int workers_; /** size of pool of worker threads, 0 for thread per connection */
+        int workers_running_; /** number of running worker threads */
+        bool shutdown_;
+        int poll_handle_; /** epoll handle */
+        int wakeup_[2]; /** pipe for interrupting event loop */
+        bool accepting_; /** listening sockets are registered in event loop */
+        std::map<int,mcc_tcp_conn_t*> conns_; /** connections in event-driven mode */
+        std::list<mcc_tcp_conn_t*> ready_; /** connections with request waiting for worker */
+        Glib::Cond ready_cond_;
         static void listener(void *); /** executing function for listening thread */
         static void executer(void *); /** executing function for connection thread */
+        static void poller(void *); /** executing function for event loop thread */
+        static void worker(void *); /** executing function for worker thread */
+        /** Processes one request arriving through connection.
+           Returns false if connection must be closed. Sets buffered
+           flag of connection if next request was already read. */
+        bool serve(mcc_tcp_conn_t& conn);
+        /** Closes connection and releases associated resources. Must
+           be called with lock_ acquired. */
+        void drop(mcc_tcp_conn_t* conn);
+        void wakeup(void);
     public:
         MCC_TCP_Service(Config *cfg, PluginArgument* parg);
         virtual ~MCC_TCP_Service(void);
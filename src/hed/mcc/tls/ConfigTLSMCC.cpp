@@ -5,6 +5,7 @@
 #include <glibmm/miscutils.h>
 #include <openssl/err.h>
 #include <openssl/dh.h> // For DH_* in newer OpenSSL
+#include <openssl/evp.h>
 
 #include <arc/credential/Credential.h>
 
@@ -24,6 +25,21 @@ using namespace Arc;
 
 Arc::Logger ConfigTLSMCC::logger(Arc::Logger::getRootLogger(), "MCC.TLS.Config");
 
+// Identifies in-memory credential without keeping it in context key
+static std::string credential_fingerprint(const std::string& credential) {
+  if(credential.empty()) return "";
+  unsigned char md[EVP_MAX_MD_SIZE];
+  unsigned int md_len = 0;
+  if(!EVP_Digest(credential.c_str(), credential.length(), md, &md_len, EVP_sha256(), NULL)) return credential;
+  static const char hex[] = "0123456789abcdef";
+  std::string fingerprint;
+  for(unsigned int n = 0; n < md_len; ++n) {
+    fingerprint += hex[md[n] >> 4];
+    fingerprint += hex[md[n] & 0x0f];
+  };
+  return fingerprint;
+}
+
 static void config_VOMS_add(XMLNode cfg,std::vector<std::string>& vomscert_trust_dn) {
   XMLNode nd = cfg["VOMSCertTrustDNChain"];
   for(;(bool)nd;++nd) {
@@ -49,6 +65,7 @@ static void config_VOMS_add(XMLNode cfg,std::vector<std::string>& vomscert_trust
 // This class is collection of configuration information
 
 ConfigTLSMCC::ConfigTLSMCC(XMLNode cfg,bool client) {
+  client_ = client;
   protocol_options_ = 0;
   curve_nid_ = NID_undef; // so far best seems to be NID_X25519, but let OpenSSL choose by default
   client_authn_ = true;
@@ -97,6 +114,7 @@ ConfigTLSMCC::ConfigTLSMCC(XMLNode cfg,bool client) {
   if(client) {
     protocol_options_ = SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3;
     hostname_ = (std::string)(cfg["Hostname"]);
+    port_ = (std::string)(cfg["Port"]);
     XMLNode protocol_node = cfg["Protocol"];
     while((bool)protocol_node) {
       std::string protocol = (std::string)protocol_node;
@@ -213,6 +231,26 @@ ConfigTLSMCC::ConfigTLSMCC(XMLNode cfg,bool client) {
   if(ca_dir_.empty() && ca_file_.empty()) ca_dir_= gridSecurityDir + G_DIR_SEPARATOR_S + "certificates";
   if(voms_dir_.empty()) voms_dir_= gridSecurityDir + G_DIR_SEPARATOR_S + "vomsdir";
   if(!proxy_file_.empty()) { key_file_=proxy_file_; cert_file_=proxy_file_; };
+  // Session resumption is on by default. GSI modes exchange additional
+  // data right after handshake and are left as they are.
+  session_resumption_ = true;
+  {
+    std::string v = cfg["SessionResumption"];
+    if((v == "false") || (v == "0")) session_resumption_ = false;
+  };
+  if(globus_gsi_ || globusio_gsi_) session_resumption_ = false;
+  // Everything affecting SSL_CTX goes into key
+  context_key_ = std::string(client_?"client":"server") + "\n" +
+                 tostring((int)handshake_) + "\n" +
+                 (client_authn_?"authn":"") + "\n" +
+                 (session_resumption_?"resume":"") + "\n" +
+                 (globus_policy_?"policy":"") + "\n" +
+                 ca_dir_ + "\n" + ca_file_ + "\n" +
+                 cert_file_ + "\n" + key_file_ + "\n" +
+                 cipher_list_ + "\n" + cipher_suites_ + "\n" +
+                 dhparam_file_ + "\n" + protocols_ + "\n" +
+                 tostring(protocol_options_) + "\n" + tostring(curve_nid_) + "\n" +
+                 credential_fingerprint(credential_);
 }
 
 bool ConfigTLSMCC::Set(SSL_CTX* sslctx) {
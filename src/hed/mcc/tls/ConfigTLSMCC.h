@@ -22,6 +22,7 @@ class ConfigTLSMCC {
   std::string cert_file_;
   std::string key_file_;
   std::string credential_;
+  bool client_;
   bool client_authn_;
   bool globus_policy_;
   bool globus_gsi_;
@@ -48,9 +49,12 @@ class ConfigTLSMCC {
   bool server_ciphers_priority_;
   std::string dhparam_file_;
   std::string hostname_;
+  std::string port_;
   std::string protocols_;
   long protocol_options_;
   int curve_nid_;
+  bool session_resumption_;
+  std::string context_key_;
   std::string failure_;
   ConfigTLSMCC(void);
  public:
@@ -61,12 +65,18 @@ class ConfigTLSMCC {
   const std::string& ProxyFile(void) const { return proxy_file_; };
   const std::string& CertFile(void) const { return cert_file_; };
   const std::string& KeyFile(void) const { return key_file_; };
+  const std::string& DHParamFile(void) const { return dhparam_file_; };
   bool GlobusPolicy(void) const { return globus_policy_; };
   bool GlobusGSI(void) const { return globus_gsi_; };
   bool GlobusIOGSI(void) const { return globusio_gsi_; };
   const std::vector<std::string>& VOMSCertTrustDN(void) { return vomscert_trust_dn_; };
   bool Set(SSL_CTX* sslctx);
+  bool IfClient(void) const { return client_; };
   bool IfClientAuthn(void) const { return client_authn_; };
+  bool IfSessionResumption(void) const { return session_resumption_; };
+  /** Identifies set of parameters used for SSL context. Connections
+     with same key may share same SSL context. */
+  const std::string& ContextKey(void) const { return context_key_; };
   bool IfTLSHandshake(void) const { return handshake_ == tls_handshake; };
   bool IfSSLv3Handshake(void) const { return handshake_ == ssl3_handshake; };
   bool IfTLSv1Handshake(void) const { return handshake_ == tls10_handshake; };
@@ -79,6 +89,8 @@ class ConfigTLSMCC {
   bool IfFailOnVOMSParsing(void) const { return (voms_processing_ == noerrors_voms) || (voms_processing_ == strict_voms); };
   bool IfFailOnVOMSInvalid(void) const { return (voms_processing_ == noerrors_voms); };
   const std::string& Hostname() const { return hostname_; };
+  /// Port of server on client side. May be empty if not known.
+  const std::string& Port() const { return port_; };
   const std::string& Failure(void) { return failure_; };
   static std::string HandleError(int code = SSL_ERROR_NONE);
   static void ClearError(void);
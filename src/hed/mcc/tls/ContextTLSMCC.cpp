@@ -0,0 +1,165 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#include <arc/StringConv.h>
+
+#include "PayloadTLSMCC.h"
+
+#include "ContextTLSMCC.h"
+
+namespace ArcMCCTLS {
+
+using namespace Arc;
+
+// How often content of CA directory is checked for changed files.
+// Added or renamed files are detected on every connection through
+// modification time of directory itself.
+#define CA_DIR_SCAN_PERIOD (60)
+
+// Upper limit for number of remembered client sessions
+#define MAX_CLIENT_SESSIONS (1000)
+
+Glib::Mutex ContextTLSMCC::lock_;
+std::map<std::string,ContextTLSMCC::Item> ContextTLSMCC::contexts_;
+std::map<std::string,SSL_SESSION*> ContextTLSMCC::sessions_;
+
+static void add_file_signature(const std::string& path, std::string& signature) {
+  signature += "\n";
+  if(path.empty()) return;
+  struct stat st;
+  if(::stat(path.c_str(),&st) != 0) return;
+  signature += tostring(st.st_mtime) + ":" + tostring(st.st_size) + ":" + tostring(st.st_ino);
+}
+
+static void ctx_add_reference(SSL_CTX* ctx) {
+#if (OPENSSL_VERSION_NUMBER >= 0x10100000L)
+  SSL_CTX_up_ref(ctx);
+#else
+  CRYPTO_add(&(ctx->references),1,CRYPTO_LOCK_SSL_CTX);
+#endif
+}
+
+std::string ContextTLSMCC::Signature(const ConfigTLSMCC& config) {
+  std::string signature;
+  add_file_signature(config.CADir(), signature);
+  add_file_signature(config.CAFile(), signature);
+  add_file_signature(config.CertFile(), signature);
+  add_file_signature(config.KeyFile(), signature);
+  add_file_signature(config.DHParamFile(), signature);
+  return signature;
+}
+
+std::string ContextTLSMCC::DirSignature(const ConfigTLSMCC& config) {
+  // Certificates and CRLs are loaded from hashed directory on demand
+  // and then kept in SSL_CTX. So any change in directory must cause
+  // rebuilding of context.
+  std::string signature;
+  if(config.CADir().empty()) return signature;
+  DIR* dir = ::opendir(config.CADir().c_str());
+  if(!dir) return signature;
+  unsigned long long int num = 0;
+  unsigned long long int sum = 0;
+  time_t latest = 0;
+  for(;;) {
+    struct dirent* d = ::readdir(dir);
+    if(!d) break;
+    std::string path = config.CADir() + "/" + d->d_name;
+    struct stat st;
+    if(::stat(path.c_str(),&st) != 0) continue;
+    ++num;
+    sum += st.st_size + st.st_ino;
+    if(st.st_mtime > latest) latest = st.st_mtime;
+  };
+  ::closedir(dir);
+  signature = tostring(num) + ":" + tostring(sum) + ":" + tostring(latest);
+  return signature;
+}
+
+SSL_CTX* ContextTLSMCC::Acquire(ConfigTLSMCC& config, Logger& logger) {
+  const std::string& key = config.ContextKey();
+  std::string signature = Signature(config);
+  time_t now = time(NULL);
+  Glib::Mutex::Lock lock(lock_);
+  Item& item = contexts_[key];
+  bool rebuild = (item.ctx == NULL);
+  if(!rebuild && (item.signature != signature)) {
+    logger.msg(VERBOSE, "Credentials or CA certificates changed, SSL context is recreated");
+    rebuild = true;
+  };
+  std::string dir_signature = item.dir_signature;
+  if(rebuild || (((int)(now - item.last_scan)) >= CA_DIR_SCAN_PERIOD) || (now < item.last_scan)) {
+    dir_signature = DirSignature(config);
+    item.last_scan = now;
+    if(!rebuild && (item.dir_signature != dir_signature)) {
+      logger.msg(VERBOSE, "Content of CA directory changed, SSL context is recreated");
+      rebuild = true;
+    };
+  };
+  if(rebuild) {
+    // Building context under lock prevents simultaneous connections
+    // from loading same files in parallel.
+    SSL_CTX* ctx = PayloadTLSMCC::CreateContext(config, logger);
+    if(!ctx) {
+      if(!item.ctx) contexts_.erase(key);
+      return NULL;
+    };
+    // Connections using old context have own references to it.
+    if(item.ctx) SSL_CTX_free(item.ctx);
+    item.ctx = ctx;
+    item.signature = signature;
+    item.dir_signature = dir_signature;
+  };
+  ctx_add_reference(item.ctx);
+  return item.ctx;
+}
+
+void ContextTLSMCC::StoreSession(const std::string& key, SSL_SESSION* session) {
+  if(!session) return;
+  Glib::Mutex::Lock lock(lock_);
+  std::map<std::string,SSL_SESSION*>::iterator s = sessions_.find(key);
+  if(s != sessions_.end()) {
+    SSL_SESSION_free(s->second);
+    s->second = session;
+    return;
+  };
+  if(sessions_.size() >= MAX_CLIENT_SESSIONS) {
+    // Simply forget arbitrary one. Sessions are only optimization.
+    SSL_SESSION_free(sessions_.begin()->second);
+    sessions_.erase(sessions_.begin());
+  };
+  sessions_[key] = session;
+}
+
+SSL_SESSION* ContextTLSMCC::RetrieveSession(const std::string& key) {
+  Glib::Mutex::Lock lock(lock_);
+  std::map<std::string,SSL_SESSION*>::iterator s = sessions_.find(key);
+  if(s == sessions_.end()) return NULL;
+#if (OPENSSL_VERSION_NUMBER >= 0x10101000L)
+  if(!SSL_SESSION_is_resumable(s->second)) {
+    SSL_SESSION_free(s->second);
+    sessions_.erase(s);
+    return NULL;
+  };
+#endif
+#if (OPENSSL_VERSION_NUMBER >= 0x10100000L)
+  SSL_SESSION_up_ref(s->second);
+#else
+  CRYPTO_add(&(s->second->references),1,CRYPTO_LOCK_SSL_SESSION);
+#endif
+  return s->second;
+}
+
+void ContextTLSMCC::DropSession(const std::string& key) {
+  Glib::Mutex::Lock lock(lock_);
+  std::map<std::string,SSL_SESSION*>::iterator s = sessions_.find(key);
+  if(s == sessions_.end()) return;
+  SSL_SESSION_free(s->second);
+  sessions_.erase(s);
+}
+
+} // namespace ArcMCCTLS
@@ -0,0 +1,56 @@
+#ifndef __ARC_CONTEXTTLSMCC_H__
+#define __ARC_CONTEXTTLSMCC_H__
+
+#include <map>
+#include <string>
+
+#include <openssl/ssl.h>
+
+#include <arc/Thread.h>
+#include <arc/Logger.h>
+
+#include "ConfigTLSMCC.h"
+
+namespace ArcMCCTLS {
+
+using namespace Arc;
+
+/** Process-wide cache of SSL contexts.
+  Loading CA certificates, CRLs and credentials is done once per
+  configuration (identified by ConfigTLSMCC::ContextKey()) and the
+  resulting SSL_CTX is shared by all connections. Context is rebuilt
+  when any of files it was made of changes. Sharing context also makes
+  server side session cache and client side session reuse possible. */
+class ContextTLSMCC {
+ public:
+  /** Returns SSL context for specified configuration. Returned context
+    carries own reference and must be released with SSL_CTX_free().
+    Returns NULL on failure with explanation in config.Failure(). */
+  static SSL_CTX* Acquire(ConfigTLSMCC& config, Logger& logger);
+  /** Stores client session for later reuse. Provided reference
+    to session is taken over. */
+  static void StoreSession(const std::string& key, SSL_SESSION* session);
+  /** Returns stored client session or NULL. Returned session
+    carries own reference and must be released with SSL_SESSION_free(). */
+  static SSL_SESSION* RetrieveSession(const std::string& key);
+  /** Forgets stored client session. */
+  static void DropSession(const std::string& key);
+ private:
+  class Item {
+   public:
+    SSL_CTX* ctx;
+    std::string signature; /** state of files used to build context */
+    std::string dir_signature; /** state of content of CA directory */
+    time_t last_scan; /** time of last check of CA directory content */
+    Item(void):ctx(NULL),last_scan(0) { };
+  };
+  static Glib::Mutex lock_;
+  static std::map<std::string,Item> contexts_;
+  static std::map<std::string,SSL_SESSION*> sessions_;
+  static std::string Signature(const ConfigTLSMCC& config);
+  static std::string DirSignature(const ConfigTLSMCC& config);
+};
+
+} // namespace ArcMCCTLS
+
+#endif /* __ARC_CONTEXTTLSMCC_H__ */
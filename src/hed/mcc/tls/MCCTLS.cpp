@@ -472,6 +472,9 @@ MCC_Status MCC_TLS_Service::process(Message& inmsg,Message& outmsg) {
    // For nextoutmsg, nothing to do for payload of msg, but
    // transfer some attributes of msg
    outmsg = nextoutmsg;
+   // Next request may be already decrypted and waiting in SSL buffers.
+   // Tell TCP MCC so it does not wait for socket to become readable.
+   if(stream->Pending()) outmsg.Attributes()->set("TCP:BUFFERED","yes");
    return MCC_Status(STATUS_OK);
 }
 
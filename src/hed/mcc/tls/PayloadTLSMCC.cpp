@@ -7,6 +7,7 @@
 #include "GlobusSigningPolicy.h"
 
 #include "PayloadTLSMCC.h"
+#include "ContextTLSMCC.h"
 #include <openssl/err.h>
 #include <glibmm/miscutils.h>
 #include <arc/DateTime.h>
@@ -30,8 +31,8 @@ static X509_VERIFY_PARAM *SSL_CTX_get0_param(SSL_CTX *ctx) {
 }
 #endif
 
-static const char * ex_data_id = "ARC_MCC_Payload_TLS";
 int PayloadTLSMCC::ex_data_index_ = -1;
+static Glib::Mutex ex_data_lock;
 
 Time asn1_to_utctime(const ASN1_UTCTIME *s) {
   std::string t_str;
@@ -148,23 +149,35 @@ static int no_passphrase_callback(char*, int, int, void*) {
    return -1;
 }
 
+// Called by OpenSSL when client receives session which may be
+// reused later. With TLSv1.3 that happens after handshake.
+static int new_session_callback(SSL* ssl, SSL_SESSION* session) {
+  PayloadTLSMCC* it = PayloadTLSMCC::RetrieveInstance(ssl);
+  if(!it) return 0;
+  if(it->SessionKey().empty()) return 0;
+  ContextTLSMCC::StoreSession(it->SessionKey(), session);
+  return 1; // reference is taken over
+}
+
 bool PayloadTLSMCC::StoreInstance(void) {
    if(ex_data_index_ == -1) {
-      // In case of race condition we will have 2 indices assigned - harmless?
-      ex_data_index_=OpenSSLAppDataIndex(ex_data_id);
+      // Instance is attached to SSL object because context is
+      // shared by many connections.
+      Glib::Mutex::Lock lock(ex_data_lock);
+      if(ex_data_index_ == -1) ex_data_index_=SSL_get_ex_new_index(0,NULL,NULL,NULL,NULL);
    };
    if(ex_data_index_ == -1) {
       logger_.msg(WARNING,"Failed to store application data");
       return false;
    };
-   if(!sslctx_) return false;
-   SSL_CTX_set_ex_data(sslctx_,ex_data_index_,this);
+   if(!ssl_) return false;
+   SSL_set_ex_data(ssl_,ex_data_index_,this);
    return true;
 }
 
 bool PayloadTLSMCC::ClearInstance(void) {
-  if((ex_data_index_ != -1) && sslctx_) {
-    SSL_CTX_set_ex_data(sslctx_,ex_data_index_,NULL);
+  if((ex_data_index_ != -1) && ssl_) {
+    SSL_set_ex_data(ssl_,ex_data_index_,NULL);
     return true;
   };
   return false;
@@ -172,116 +185,176 @@ bool PayloadTLSMCC::ClearInstance(void) {
 
 PayloadTLSMCC* PayloadTLSMCC::RetrieveInstance(X509_STORE_CTX* container) {
   PayloadTLSMCC* it = NULL;
-  if(ex_data_index_ != -1) {
-    SSL* ssl = (SSL*)X509_STORE_CTX_get_ex_data(container,SSL_get_ex_data_X509_STORE_CTX_idx());
-    if(ssl != NULL) {
-      SSL_CTX* ssl_ctx = SSL_get_SSL_CTX(ssl);
-      if(ssl_ctx != NULL) {
-        it = (PayloadTLSMCC*)SSL_CTX_get_ex_data(ssl_ctx,ex_data_index_);
-      }
-    };
-  };
+  SSL* ssl = (SSL*)X509_STORE_CTX_get_ex_data(container,SSL_get_ex_data_X509_STORE_CTX_idx());
+  if(ssl != NULL) it = RetrieveInstance(ssl);
   if(it == NULL) {
     Logger::getRootLogger().msg(WARNING,"Failed to retrieve application data from OpenSSL");
   };
   return it;
 }
 
+PayloadTLSMCC* PayloadTLSMCC::RetrieveInstance(SSL* ssl) {
+  if(ex_data_index_ == -1) return NULL;
+  return (PayloadTLSMCC*)SSL_get_ex_data(ssl,ex_data_index_);
+}
 
-PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger& logger):
-    PayloadTLSStream(logger),sslctx_(NULL),bio_(NULL),config_(cfg),flags_(0),connected_(false) {
-   // Client mode
-   int err = SSL_ERROR_NONE;
-   char gsi_cmd[1] = { '0' };
-   master_=true;
-   // Creating BIO for communication through stream which it will
-   // extract from provided MCC
-   BIO* bio = (bio_ = config_.GlobusIOGSI()?BIO_new_GSIMCC(mcc):BIO_new_MCC(mcc));
+SSL_CTX* PayloadTLSMCC::CreateContext(ConfigTLSMCC& cfg, Logger& logger) {
+   SSL_CTX* sslctx = NULL;
    // Initialize the SSL Context object
    long ctx_options = 0;
-
-   if(cfg.IfSSLv3Handshake()) {
+   if(cfg.IfClient()) {
+     if(cfg.IfSSLv3Handshake()) {
 #if defined HAVE_SSLV3_METHOD
-     sslctx_=SSL_CTX_new(SSLv3_client_method());
+       sslctx=SSL_CTX_new(SSLv3_client_method());
 #elif defined HAVE_TLS_METHOD
-     ctx_options |= SSL_OP_NO_SSLv3;
-     sslctx_=SSL_CTX_new(TLS_client_method());
+       ctx_options |= SSL_OP_NO_SSLv3;
+       sslctx=SSL_CTX_new(TLS_client_method());
 #endif
-   } else if(cfg.IfTLSv1Handshake()) {
+     } else if(cfg.IfTLSv1Handshake()) {
 #if defined HAVE_TLSV1_METHOD
-     sslctx_=SSL_CTX_new(TLSv1_client_method());
+       sslctx=SSL_CTX_new(TLSv1_client_method());
 #elif defined HAVE_TLS_METHOD
-     ctx_options = SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1_2 | SSL_OP_NO_TLSv1_1;
-     sslctx_=SSL_CTX_new(TLS_client_method());
+       ctx_options = SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1_2 | SSL_OP_NO_TLSv1_1;
+       sslctx=SSL_CTX_new(TLS_client_method());
 #endif
-   } else if(cfg.IfTLSv11Handshake()) {
+     } else if(cfg.IfTLSv11Handshake()) {
 #if defined HAVE_TLSV1_1_METHOD
-     sslctx_=SSL_CTX_new(TLSv1_1_client_method());
+       sslctx=SSL_CTX_new(TLSv1_1_client_method());
 #elif defined HAVE_TLS_METHOD
-     ctx_options = SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1_2 | SSL_OP_NO_TLSv1;
-     sslctx_=SSL_CTX_new(TLS_client_method());
+       ctx_options = SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1_2 | SSL_OP_NO_TLSv1;
+       sslctx=SSL_CTX_new(TLS_client_method());
 #endif
-   } else if(cfg.IfTLSv12Handshake()) {
+     } else if(cfg.IfTLSv12Handshake()) {
 #ifdef HAVE_TLSV1_2_METHOD
-     sslctx_=SSL_CTX_new(TLSv1_2_client_method());
+       sslctx=SSL_CTX_new(TLSv1_2_client_method());
 #elif defined HAVE_TLS_METHOD
-     ctx_options = SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1_1 | SSL_OP_NO_TLSv1;
-     sslctx_=SSL_CTX_new(TLS_client_method());
+       ctx_options = SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1_1 | SSL_OP_NO_TLSv1;
+       sslctx=SSL_CTX_new(TLS_client_method());
 #endif
-   } else if(cfg.IfDTLSHandshake()) {
+     } else if(cfg.IfDTLSHandshake()) {
 #if defined HAVE_DTLS_METHOD
-     sslctx_=SSL_CTX_new(DTLS_client_method());
+       sslctx=SSL_CTX_new(DTLS_client_method());
 #endif
-   } else if(cfg.IfDTLSv1Handshake()) {
+     } else if(cfg.IfDTLSv1Handshake()) {
 #if defined HAVE_DTLSV1_METHOD
-     sslctx_=SSL_CTX_new(DTLSv1_client_method());
+       sslctx=SSL_CTX_new(DTLSv1_client_method());
 #elif defined HAVE_DTLS_METHOD
-     sslctx_=SSL_CTX_new(DTLS_client_method());
-     ctx_options |= SSL_OP_NO_DTLSv1_2;
+       sslctx=SSL_CTX_new(DTLS_client_method());
+       ctx_options |= SSL_OP_NO_DTLSv1_2;
 #endif
-   } else if(cfg.IfDTLSv12Handshake()) {
+     } else if(cfg.IfDTLSv12Handshake()) {
 #if defined HAVE_DTLSV1_2_METHOD
-     sslctx_=SSL_CTX_new(DTLSv1_2_client_method());
+       sslctx=SSL_CTX_new(DTLSv1_2_client_method());
 #elif defined HAVE_DTLS_METHOD
-     sslctx_=SSL_CTX_new(DTLS_client_method());
-     ctx_options |= SSL_OP_NO_DTLSv1;
+       sslctx=SSL_CTX_new(DTLS_client_method());
+       ctx_options |= SSL_OP_NO_DTLSv1;
 #endif
-   } else { // default
+     } else { // default
+#if defined HAVE_TLS_METHOD
+       sslctx=SSL_CTX_new(TLS_client_method());
+#else
+       sslctx=SSL_CTX_new(SSLv23_client_method());
+#endif
+     };
+   } else {
+     if(cfg.IfTLSHandshake()) {
 #if defined HAVE_TLS_METHOD
-     sslctx_=SSL_CTX_new(TLS_client_method());
+       sslctx=SSL_CTX_new(TLS_server_method());
 #else
-     sslctx_=SSL_CTX_new(SSLv23_client_method());
+       sslctx=SSL_CTX_new(SSLv23_server_method());
 #endif
+     } else {
+#if defined HAVE_SSLV3_METHOD
+       sslctx=SSL_CTX_new(SSLv3_server_method());
+#elif defined HAVE_TLS_METHOD
+       sslctx=SSL_CTX_new(TLS_server_method());
+       ctx_options |= SSL_OP_NO_TLSv1 | SSL_OP_NO_TLSv1_2 | SSL_OP_NO_TLSv1_1;
+#endif
+     };
    };
-   if(sslctx_==NULL){
+   if(sslctx==NULL){
       logger.msg(ERROR, "Can not create the SSL Context object");
-      goto error;
+      return NULL;
    };
-   SSL_CTX_set_mode(sslctx_,SSL_MODE_ENABLE_PARTIAL_WRITE);
-   SSL_CTX_set_session_cache_mode(sslctx_,SSL_SESS_CACHE_OFF);
-   if(!config_.Set(sslctx_)) {
-      SetFailure(config_.Failure());
-      goto error;
+   SSL_CTX_set_mode(sslctx,SSL_MODE_ENABLE_PARTIAL_WRITE);
+   SSL_CTX_set_session_cache_mode(sslctx,SSL_SESS_CACHE_OFF);
+   if(cfg.IfClient()) {
+     if(!cfg.Set(sslctx)) goto error;
+     SSL_CTX_set_verify(sslctx, SSL_VERIFY_PEER |  SSL_VERIFY_FAIL_IF_NO_PEER_CERT, &verify_callback);
+   } else {
+     if(cfg.IfClientAuthn()) {
+       SSL_CTX_set_verify(sslctx, SSL_VERIFY_PEER |  SSL_VERIFY_FAIL_IF_NO_PEER_CERT | SSL_VERIFY_CLIENT_ONCE, &verify_callback);
+     }
+     else {
+       //SSL_CTX_set_verify(sslctx, SSL_VERIFY_NONE, NULL);
+       // Ask for client certificate but do not fail if not provided
+       SSL_CTX_set_verify(sslctx, SSL_VERIFY_PEER |  SSL_VERIFY_CLIENT_ONCE, &verify_callback);
+     }
+     if(!cfg.Set(sslctx)) goto error;
    };
-   SSL_CTX_set_verify(sslctx_, SSL_VERIFY_PEER |  SSL_VERIFY_FAIL_IF_NO_PEER_CERT, &verify_callback);
 
    // Allow proxies, request CRL check
-   if(SSL_CTX_get0_param(sslctx_) == NULL) {
+   if(SSL_CTX_get0_param(sslctx) == NULL) {
       logger.msg(ERROR,"Can't set OpenSSL verify flags");
       goto error;
    } else {
-      X509_VERIFY_PARAM_set_flags(SSL_CTX_get0_param(sslctx_),X509_V_FLAG_CRL_CHECK | X509_V_FLAG_ALLOW_PROXY_CERTS);
+      X509_VERIFY_PARAM_set_flags(SSL_CTX_get0_param(sslctx),X509_V_FLAG_CRL_CHECK | X509_V_FLAG_ALLOW_PROXY_CERTS);
    };
-   StoreInstance();
+
+   if(cfg.IfClient()) {
 #ifdef SSL_OP_NO_TICKET
-   ctx_options |= SSL_OP_SINGLE_DH_USE | SSL_OP_ALL | SSL_OP_NO_TICKET;
+     ctx_options |= SSL_OP_SINGLE_DH_USE | SSL_OP_ALL | SSL_OP_NO_TICKET;
 #else
-   ctx_options |= SSL_OP_SINGLE_DH_USE | SSL_OP_ALL;
+     ctx_options |= SSL_OP_SINGLE_DH_USE | SSL_OP_ALL;
+#endif
+#if (OPENSSL_VERSION_NUMBER >= 0x10100000L)
+     if(cfg.IfSessionResumption()) {
+       // Sessions are kept outside of context and assigned to
+       // connections going to same host.
+       SSL_CTX_set_session_cache_mode(sslctx,SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+       SSL_CTX_sess_set_new_cb(sslctx,&new_session_callback);
+     };
 #endif
-   SSL_CTX_set_options(sslctx_, ctx_options);
+   } else {
+     ctx_options |= SSL_OP_SINGLE_DH_USE | SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_ALL;
+#if (OPENSSL_VERSION_NUMBER >= 0x10100000L)
+     if(cfg.IfSessionResumption()) {
+       // Sessions are kept in memory instead of being sent to client
+       // in tickets. That way peer chain with VOMS attributes stays
+       // available after session is resumed.
+       static const char sid_ctx[] = "ARC_MCC_TLS";
+       SSL_CTX_set_session_cache_mode(sslctx,SSL_SESS_CACHE_SERVER);
+       SSL_CTX_set_session_id_context(sslctx,(const unsigned char*)sid_ctx,sizeof(sid_ctx)-1);
+#ifdef SSL_OP_NO_TICKET
+       ctx_options |= SSL_OP_NO_TICKET;
+#endif
+     };
+#endif
+   };
+   SSL_CTX_set_options(sslctx, ctx_options);
+   SSL_CTX_set_default_passwd_cb(sslctx, no_passphrase_callback);
+   return sslctx;
+error:
+   SSL_CTX_free(sslctx);
+   return NULL;
+}
 
-   SSL_CTX_set_default_passwd_cb(sslctx_, no_passphrase_callback);
-   /* Get DN from certificate, and put it into message's attribute */
+PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger& logger):
+    PayloadTLSStream(logger),sslctx_(NULL),bio_(NULL),config_(cfg),flags_(0),connected_(false) {
+   // Client mode
+   int err = SSL_ERROR_NONE;
+   char gsi_cmd[1] = { '0' };
+   master_=true;
+   // Creating BIO for communication through stream which it will
+   // extract from provided MCC
+   BIO* bio = (bio_ = config_.GlobusIOGSI()?BIO_new_GSIMCC(mcc):BIO_new_MCC(mcc));
+   bool resumed = false;
+   // Obtain shared SSL Context object
+   sslctx_ = ContextTLSMCC::Acquire(config_, logger);
+   if(sslctx_==NULL){
+      if(!config_.Failure().empty()) SetFailure(config_.Failure());
+      goto error;
+   };
 
    // Creating SSL object for handling connection
    ssl_ = SSL_new(sslctx_);
@@ -289,6 +362,7 @@ PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger&
       logger.msg(ERROR, "Can not create the SSL object");
       goto error;
    };
+   StoreInstance();
    //for(int n = 0;;++n) {
    //  const char * s = SSL_get_cipher_list(ssl_,n);
    //  if(!s) break;
@@ -299,6 +373,18 @@ PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger&
          logger.msg(WARNING, "Faile to assign hostname extension");
       };
    };
+#if (OPENSSL_VERSION_NUMBER >= 0x10100000L)
+   // Sessions are identified by host name and port. If host is not
+   // known there is no way to decide which one to use.
+   if(config_.IfSessionResumption() && !cfg.Hostname().empty()) {
+      session_key_ = config_.ContextKey() + "\n" + cfg.Hostname() + ":" + cfg.Port();
+      SSL_SESSION* session = ContextTLSMCC::RetrieveSession(session_key_);
+      if(session) {
+         SSL_set_session(ssl_, session);
+         SSL_SESSION_free(session);
+      };
+   };
+#endif
    SSL_set_bio(ssl_,bio,bio); bio=NULL;
    //SSL_set_connect_state(ssl_);
    if((err=SSL_connect(ssl_)) != 1) {
@@ -311,10 +397,13 @@ PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger&
       }
       */
       logger.msg(VERBOSE, "Failed to establish SSL connection");
+      // Do not try same session again
+      if(!session_key_.empty()) ContextTLSMCC::DropSession(session_key_);
       goto error;
    };
    connected_=true;
-   logger.msg(VERBOSE, "Using cipher: %s",SSL_get_cipher_name(ssl_));
+   resumed = SSL_session_reused(ssl_);
+   logger.msg(VERBOSE, "Using cipher: %s%s",SSL_get_cipher_name(ssl_),resumed?" (resumed session)":"");
    // if(SSL_in_init(ssl_)){
    //handle error
    // }
@@ -325,7 +414,7 @@ PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger&
 error:
    if (failure_) SetFailure(err); // Only set if not already set.
    if(bio) { BIO_free(bio); bio_=NULL; }
-   if(ssl_) { SSL_free(ssl_); ssl_=NULL; }
+   if(ssl_) { ClearInstance(); SSL_free(ssl_); ssl_=NULL; }
    if(sslctx_) { SSL_CTX_free(sslctx_); sslctx_=NULL; }
    return;
 }
@@ -337,53 +426,12 @@ PayloadTLSMCC::PayloadTLSMCC(PayloadStreamInterface* stream, const ConfigTLSMCC&
    master_=true;
    // Creating BIO for communication through provided stream
    BIO* bio = (bio_ = config_.GlobusIOGSI()?BIO_new_GSIMCC(stream):BIO_new_MCC(stream));
-   // Initialize the SSL Context object
-   long ctx_options = 0;
-   if(cfg.IfTLSHandshake()) {
-#if defined HAVE_TLS_METHOD
-     sslctx_=SSL_CTX_new(TLS_server_method());
-#else
-     sslctx_=SSL_CTX_new(SSLv23_server_method());
-#endif
-   } else {
-#if defined HAVE_SSLV3_METHOD
-     sslctx_=SSL_CTX_new(SSLv3_server_method());
-#elif defined HAVE_TLS_METHOD
-     sslctx_=SSL_CTX_new(TLS_server_method());
-     ctx_options |= SSL_OP_NO_TLSv1 | SSL_OP_NO_TLSv1_2 | SSL_OP_NO_TLSv1_1;
-#endif
-   };
+   // Obtain shared SSL Context object
+   sslctx_ = ContextTLSMCC::Acquire(config_, logger);
    if(sslctx_==NULL){
-      logger.msg(ERROR, "Can not create the SSL Context object");
+      if(!config_.Failure().empty()) SetFailure(config_.Failure());
       goto error;
    };
-   SSL_CTX_set_mode(sslctx_,SSL_MODE_ENABLE_PARTIAL_WRITE);
-   SSL_CTX_set_session_cache_mode(sslctx_,SSL_SESS_CACHE_OFF);
-   if(config_.IfClientAuthn()) {
-     SSL_CTX_set_verify(sslctx_, SSL_VERIFY_PEER |  SSL_VERIFY_FAIL_IF_NO_PEER_CERT | SSL_VERIFY_CLIENT_ONCE, &verify_callback);
-   }
-   else {
-     //SSL_CTX_set_verify(sslctx_, SSL_VERIFY_NONE, NULL);
-     // Ask for client certificate but do not fail if not provided
-     SSL_CTX_set_verify(sslctx_, SSL_VERIFY_PEER |  SSL_VERIFY_CLIENT_ONCE, &verify_callback);
-   }
-   if(!config_.Set(sslctx_)) {
-      SetFailure(config_.Failure());
-      goto error;
-   }
-
-   // Allow proxies, request CRL check
-   if(SSL_CTX_get0_param(sslctx_) == NULL) {
-      logger.msg(ERROR,"Can't set OpenSSL verify flags");
-      goto error;
-   } else {
-      X509_VERIFY_PARAM_set_flags(SSL_CTX_get0_param(sslctx_),X509_V_FLAG_CRL_CHECK | X509_V_FLAG_ALLOW_PROXY_CERTS);
-   };
-
-   StoreInstance();
-   ctx_options |= SSL_OP_SINGLE_DH_USE | SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_ALL;
-   SSL_CTX_set_options(sslctx_, ctx_options);
-   SSL_CTX_set_default_passwd_cb(sslctx_, no_passphrase_callback);
 
    // Creating SSL object for handling connection
    ssl_ = SSL_new(sslctx_);
@@ -391,6 +439,7 @@ PayloadTLSMCC::PayloadTLSMCC(PayloadStreamInterface* stream, const ConfigTLSMCC&
       logger.msg(ERROR, "Can not create the SSL object");
       goto error;
    };
+   StoreInstance();
    //for(int n = 0;;++n) {
    //  const char * s = SSL_get_cipher_list(ssl_,n);
    //  if(!s) break;
@@ -404,7 +453,7 @@ PayloadTLSMCC::PayloadTLSMCC(PayloadStreamInterface* stream, const ConfigTLSMCC&
       goto error;
    };
    connected_=true;
-   logger.msg(VERBOSE, "Using cipher: %s",SSL_get_cipher_name(ssl_));
+   logger.msg(VERBOSE, "Using cipher: %s%s",SSL_get_cipher_name(ssl_),SSL_session_reused(ssl_)?" (resumed session)":"");
    //handle error
    // if(SSL_in_init(ssl_)){
    //handle error
@@ -413,7 +462,7 @@ PayloadTLSMCC::PayloadTLSMCC(PayloadStreamInterface* stream, const ConfigTLSMCC&
 error:
    if (failure_) SetFailure(err); // Only set if not already set.
    if(bio) { BIO_free(bio); bio_=NULL; }
-   if(ssl_) { SSL_free(ssl_); ssl_=NULL; }
+   if(ssl_) { ClearInstance(); SSL_free(ssl_); ssl_=NULL; }
    if(sslctx_) { SSL_CTX_free(sslctx_); sslctx_=NULL; }
    return;
 }
@@ -433,8 +482,7 @@ PayloadTLSMCC::~PayloadTLSMCC(void) {
   // was called after this object was destroyed. Although
   // that may be misinterpretation it is probably safer
   // to detach code of this object from OpenSSL now by
-  // calling SSL_set_verify/SSL_CTX_set_verify and by
-  // removing associated ex_data.
+  // calling SSL_set_verify and by removing associated ex_data.
   ClearInstance();
   if (ssl_) {
     SSL_set_verify(ssl_,SSL_VERIFY_NONE,NULL);
@@ -467,7 +515,7 @@ PayloadTLSMCC::~PayloadTLSMCC(void) {
     ssl_ = NULL;
   }
   if(sslctx_) {
-    SSL_CTX_set_verify(sslctx_,SSL_VERIFY_NONE,NULL);
+    // Context is shared and only own reference is released here
     SSL_CTX_free(sslctx_);
     sslctx_ = NULL;
   }
@@ -21,7 +21,7 @@ class PayloadTLSMCC: public PayloadTLSStream {
  private:
   /** Specifies if this object owns internal SSL objects */
   bool master_;
-  /** SSL context */
+  /** SSL context - shared, this object holds reference to it */
   SSL_CTX* sslctx_;
   BIO* bio_;
   static int ex_data_index_;
@@ -32,6 +32,8 @@ class PayloadTLSMCC: public PayloadTLSStream {
   // Generic purpose bit flags
   unsigned long flags_;
   bool connected_;
+  // Identifies client session for reuse
+  std::string session_key_;
  public:
   /** Constructor - creates ssl object which is bound to next MCC.
     This instance must be used on client side. It obtains Stream interface
@@ -48,6 +50,12 @@ class PayloadTLSMCC: public PayloadTLSStream {
   virtual ~PayloadTLSMCC(void);
   const ConfigTLSMCC& Config(void) { return config_; };
   static PayloadTLSMCC* RetrieveInstance(X509_STORE_CTX* container);
+  static PayloadTLSMCC* RetrieveInstance(SSL* ssl);
+  /** Creates and configures SSL context according to configuration.
+    Context is meant to be shared by connections. Returns NULL on
+    failure with explanation in cfg.Failure(). */
+  static SSL_CTX* CreateContext(ConfigTLSMCC& cfg, Logger& logger);
+  const std::string& SessionKey(void) const { return session_key_; };
   unsigned long Flags(void) { return flags_; };
   void Flags(unsigned long flags) { flags_=flags; };
   void SetFailure(const std::string& err);
@@ -52,6 +52,16 @@ bool PayloadTLSStream::Get(std::string& buf) {
   return result;
 }
 
+bool PayloadTLSStream::Pending(void) const {
+  if(ssl_ == NULL) return false;
+  if(SSL_pending(ssl_) > 0) return true;
+#if (OPENSSL_VERSION_NUMBER >= 0x10100000L)
+  // Also records which are read but not processed yet
+  if(SSL_has_pending(ssl_)) return true;
+#endif
+  return false;
+}
+
 bool PayloadTLSStream::Put(const char* buf,Size_t size) {
   //ssl write
   ssize_t l;
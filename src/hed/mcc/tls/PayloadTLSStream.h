@@ -45,6 +45,9 @@ public:
   virtual Size_t Pos(void) const { return 0; };
   virtual Size_t Size(void) const { return 0; };
   virtual Size_t Limit(void) const { return 0; };
+  /** Returns true if data was already received and is waiting in
+     SSL buffers. Such data is not visible on underlying socket. */
+  virtual bool Pending(void) const;
   virtual void SetFailure(const std::string& err);
   virtual void SetFailure(int code = SSL_ERROR_NONE);
 
@@ -0,0 +1,132 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <arc/CheckSum.h>
+#include <arc/otokens/otokens.h>
+#include <arc/external/cJSON/cJSON.h>
+
+#include "OTokensCache.h"
+
+namespace ArcSec {
+
+// Rough memory overhead of single entry and of every stored string
+static const unsigned long long int entry_overhead = 256;
+static const unsigned long long int item_overhead = 64;
+
+OTokensCache::OTokensCache(unsigned long long int max_size, int max_age):
+    max_size_(max_size), max_age_(max_age), size_(0), hits_(0), misses_(0) {
+}
+
+OTokensCache::~OTokensCache(void) {
+}
+
+std::string OTokensCache::Digest(const std::string& token) {
+  Arc::SHA256Sum sum;
+  sum.start();
+  sum.add(const_cast<char*>(token.c_str()), token.length());
+  sum.end();
+  unsigned char* res = NULL;
+  unsigned int len = 0;
+  sum.result(res, len);
+  return std::string(reinterpret_cast<char*>(res), len);
+}
+
+void OTokensCache::Remove(std::map<std::string, Entry>::iterator entry) {
+  size_ -= entry->second.size;
+  lru_.erase(entry->second.lru);
+  entries_.erase(entry);
+}
+
+bool OTokensCache::Get(const std::string& token, Claims& claims) {
+  if(max_size_ == 0) return false;
+  std::string digest = Digest(token);
+  Glib::Mutex::Lock lock(lock_);
+  std::map<std::string, Entry>::iterator entry = entries_.find(digest);
+  if(entry == entries_.end()) {
+    ++misses_;
+    return false;
+  };
+  if(time(NULL) >= entry->second.expires) {
+    Remove(entry);
+    ++misses_;
+    return false;
+  };
+  lru_.splice(lru_.begin(), lru_, entry->second.lru);
+  claims = entry->second.claims;
+  ++hits_;
+  return true;
+}
+
+void OTokensCache::Put(const std::string& token, const Claims& claims, time_t expires) {
+  if(max_size_ == 0) return;
+  time_t now = time(NULL);
+  time_t limit = now + max_age_;
+  if((expires == 0) || (expires > limit)) expires = limit;
+  if(expires <= now) return;
+  unsigned long long int size = entry_overhead;
+  for(Claims::const_iterator claim = claims.begin(); claim != claims.end(); ++claim) {
+    size += claim->first.length() + item_overhead;
+    for(std::list<std::string>::const_iterator value = claim->second.begin(); value != claim->second.end(); ++value)
+      size += value->length() + item_overhead;
+  };
+  if(size > max_size_) return;
+  std::string digest = Digest(token);
+  Glib::Mutex::Lock lock(lock_);
+  std::map<std::string, Entry>::iterator entry = entries_.find(digest);
+  if(entry != entries_.end()) Remove(entry);
+  // Make space by dropping least recently used entries
+  while(!lru_.empty() && (size_ + size > max_size_)) {
+    Remove(entries_.find(lru_.back()));
+  };
+  lru_.push_front(digest);
+  Entry& new_entry = entries_[digest];
+  new_entry.claims = claims;
+  new_entry.expires = expires;
+  new_entry.size = size;
+  new_entry.lru = lru_.begin();
+  size_ += size;
+}
+
+void OTokensCache::Extract(const Arc::JWSE& jwse, Claims& claims, time_t& expires) {
+  cJSON const * notAfter = jwse.Claim(Arc::JWSE::ClaimNameNotAfter);
+  if(notAfter && (notAfter->type == cJSON_Number)) expires = static_cast<time_t>(notAfter->valueint);
+  // Only string values are used
+  cJSON const * content = jwse.Claims();
+  if(!content) return;
+  for(cJSON const * obj = content->child; obj; obj = obj->next) {
+    if(!obj->string) continue;
+    std::list<std::string> items;
+    if(obj->type == cJSON_String) {
+      if(obj->valuestring)
+        items.push_back(obj->valuestring);
+    }
+    else if(obj->type == cJSON_Array) {
+      for(cJSON const * item = obj->child; item; item = item->next) {
+        if(item->type == cJSON_String) {
+          if(item->valuestring) {
+            items.push_back(item->valuestring);
+          }
+        }
+      }
+    }
+    if(!items.empty()) claims[obj->string].splice(claims[obj->string].end(), items);
+  }
+}
+
+unsigned long long int OTokensCache::Hits(void) const {
+  Glib::Mutex::Lock lock(lock_);
+  return hits_;
+}
+
+unsigned long long int OTokensCache::Misses(void) const {
+  Glib::Mutex::Lock lock(lock_);
+  return misses_;
+}
+
+unsigned long long int OTokensCache::Size(void) const {
+  Glib::Mutex::Lock lock(lock_);
+  return size_;
+}
+
+} // namespace ArcSec
@@ -0,0 +1,73 @@
+#ifndef __ARC_SEC_OTOKENSCACHE_H__
+#define __ARC_SEC_OTOKENSCACHE_H__
+
+#include <time.h>
+
+#include <string>
+#include <list>
+#include <map>
+
+#include <glibmm/thread.h>
+
+namespace Arc {
+  class JWSE;
+}
+
+namespace ArcSec {
+
+/// Cache of claims extracted from already verified tokens.
+/** Tokens are identified by digest of their content. Entries are removed
+   when token expires, when they are older than configured maximal age,
+   or when least recently used ones exceed configured total size. */
+class OTokensCache {
+ public:
+  /// Claims of token - string values of every claim
+  typedef std::map< std::string, std::list<std::string> > Claims;
+
+  /// Creates cache limited by approximate total size in bytes and
+  /// maximal age of entries in seconds. Cache of size 0 stores nothing.
+  OTokensCache(unsigned long long int max_size, int max_age);
+  ~OTokensCache(void);
+
+  /// Obtains claims of previously verified token. Returns false if token
+  /// is not in cache or it expired.
+  bool Get(const std::string& token, Claims& claims);
+
+  /// Stores claims of verified token. expires is expiration time of token
+  /// or 0 if token does not expire.
+  void Put(const std::string& token, const Claims& claims, time_t expires);
+
+  /// Collects string values of claims of verified token. All string items
+  /// of array claims are collected. expires is set to expiration time of
+  /// token if it has one.
+  static void Extract(const Arc::JWSE& jwse, Claims& claims, time_t& expires);
+
+  unsigned long long int Hits(void) const;
+  unsigned long long int Misses(void) const;
+  /// Approximate size of stored information in bytes.
+  unsigned long long int Size(void) const;
+
+ private:
+  class Entry {
+   public:
+    Claims claims;
+    time_t expires;
+    unsigned long long int size;
+    std::list<std::string>::iterator lru;
+  };
+  mutable Glib::Mutex lock_;
+  std::map<std::string, Entry> entries_;
+  std::list<std::string> lru_; // most recently used first
+  unsigned long long int max_size_;
+  int max_age_;
+  unsigned long long int size_;
+  unsigned long long int hits_;
+  unsigned long long int misses_;
+
+  static std::string Digest(const std::string& token);
+  void Remove(std::map<std::string, Entry>::iterator entry);
+};
+
+} // namespace ArcSec
+
+#endif /* __ARC_SEC_OTOKENSCACHE_H__ */
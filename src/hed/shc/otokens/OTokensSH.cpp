@@ -8,8 +8,8 @@
 #include <arc/StringConv.h>
 #include <arc/otokens/otokens.h>
 #include <arc/message/SecAttr.h>
-#include <arc/external/cJSON/cJSON.h>
 
+#include "OTokensCache.h"
 #include "OTokensSH.h"
 
 static Arc::Logger logger(Arc::Logger::rootLogger, "OTokensSH");
@@ -35,15 +35,16 @@ using namespace Arc;
 
 class OTokensSecAttr: public SecAttr {
  public:
-  OTokensSecAttr(Arc::Message* msg);
+  OTokensSecAttr(Arc::Message* msg, OTokensCache& cache);
   virtual ~OTokensSecAttr(void);
   virtual operator bool(void) const;
   virtual std::string get(const std::string& id) const;
   virtual std::list<std::string> getAll(const std::string& id) const;
  protected:
   bool valid_;
-  Arc::JWSE jwse_;
+  OTokensCache::Claims claims_;
   std::string token_;
+  bool Verify(time_t& expires);
 };
 
 int strnicmp(char const* left, char const* right, size_t len) {
@@ -57,7 +58,7 @@ int strnicmp(char const* left, char const* right, size_t len) {
   return 0;
 }
 
-OTokensSecAttr::OTokensSecAttr(Arc::Message* msg):valid_(false) {
+OTokensSecAttr::OTokensSecAttr(Arc::Message* msg, OTokensCache& cache):valid_(false) {
   static const char tokenid[] = "bearer ";
   if(msg) {
     logger.msg(DEBUG, "OTokens: Attr: message");
@@ -74,17 +75,30 @@ OTokensSecAttr::OTokensSecAttr(Arc::Message* msg):valid_(false) {
       if(strnicmp(token_.c_str(), tokenid, sizeof(tokenid)-1) == 0) {
         token_.erase(0, sizeof(tokenid)-1);
         logger.msg(DEBUG, "OTokens: Attr: token: bearer: %s", token_);
-        valid_ = jwse_.Input(token_);
+        // Same token is usually presented many times. Avoid verifying it again.
+        valid_ = cache.Get(token_, claims_);
         if(valid_) {
-          // Additionally require signature protected by safely obtained key.
-          // So far only accepting keys fetched from issuer through https.
-          valid_ = (jwse_.InputKeyOrigin() == JWSE::ExternalSafeKey);
+          logger.msg(DEBUG, "OTokens: Attr: token: verified earlier");
+        } else {
+          time_t expires = 0;
+          valid_ = Verify(expires);
+          if(valid_) cache.Put(token_, claims_, expires);
         };
       };
     };
   };
 }
 
+bool OTokensSecAttr::Verify(time_t& expires) {
+  JWSE jwse;
+  if(!jwse.Input(token_)) return false;
+  // Additionally require signature protected by safely obtained key.
+  // So far only accepting keys fetched from issuer through https.
+  if(jwse.InputKeyOrigin() != JWSE::ExternalSafeKey) return false;
+  OTokensCache::Extract(jwse, claims_, expires);
+  return true;
+}
+
 OTokensSecAttr::~OTokensSecAttr() {
 }
 
@@ -111,23 +125,9 @@ std::list<std::string> OTokensSecAttr::getAll(const std::string& id) const {
     items.push_back(issuer + "/" + subject);
     return items;
   };
-  cJSON const * obj = jwse_.Claim(id.c_str());
-  if(obj) {
-    if(obj->type == cJSON_String) {
-      if(obj->valuestring)
-        items.push_back(obj->valuestring);
-    }
-    else if(obj->type == cJSON_Array) {
-      obj = obj->child;
-      for( ;obj; obj = obj->next) {
-        if(obj->type == cJSON_String) {
-          if(obj->valuestring) {
-            items.push_back(obj->valuestring);
-          }
-        }
-      }
-    }
-  }
+  OTokensCache::Claims::const_iterator claim = claims_.find(id);
+  if(claim != claims_.end())
+    items = claim->second;
   return items;
 }
 
@@ -135,18 +135,32 @@ OTokensSecAttr::operator bool() const {
   return valid_;
 }
 
-OTokensSH::OTokensSH(Config *cfg,ChainContext*,Arc::PluginArgument* parg):SecHandler(cfg,parg),valid_(false){
+OTokensSH::OTokensSH(Config *cfg,ChainContext*,Arc::PluginArgument* parg):SecHandler(cfg,parg),valid_(false),cache_(NULL){
+  unsigned long long int cache_size = 16*1024*1024;
+  int cache_time = 600;
+  std::string value = (std::string)((*cfg)["TokensCacheSize"]);
+  if(!value.empty() && !stringto(value, cache_size)) {
+    logger.msg(ERROR, "Wrong value of TokensCacheSize: %s", value);
+    return;
+  };
+  value = (std::string)((*cfg)["TokensCacheTime"]);
+  if(!value.empty() && !stringto(value, cache_time)) {
+    logger.msg(ERROR, "Wrong value of TokensCacheTime: %s", value);
+    return;
+  };
+  cache_ = new OTokensCache(cache_size, cache_time);
   valid_ = true;
 }
 
 OTokensSH::~OTokensSH(){
+  delete cache_;
 }
 
 SecHandlerStatus OTokensSH::Handle(Arc::Message* msg) const {
   logger.msg(DEBUG, "OTokens: Handle");
   if(msg) {
     logger.msg(DEBUG, "OTokens: Handle: message");
-    OTokensSecAttr* sattr = new OTokensSecAttr(msg);
+    OTokensSecAttr* sattr = new OTokensSecAttr(msg, *cache_);
     if(!*sattr) {
       logger.msg(ERROR, "Failed to create OTokens security attributes");
       delete sattr;
@@ -9,8 +9,13 @@
 
 namespace ArcSec {
 
-/// Adds OTokens support in HTTP Header
+class OTokensCache;
 
+/// Adds OTokens support in HTTP Header
+/** Claims of verified tokens are cached, so repeatedly presented token
+   is verified only once. Cache is configured with optional elements
+   TokensCacheSize (approximate size in bytes, 0 disables caching) and
+   TokensCacheTime (maximal time in seconds to keep verified token). */
 class OTokensSH : public SecHandler {
  private:
   /*
@@ -25,6 +30,7 @@ class OTokensSH : public SecHandler {
   std::string ca_dir_;
   */
   bool valid_;
+  OTokensCache* cache_;
 
  public:
   OTokensSH(Arc::Config *cfg, Arc::ChainContext* ctx, Arc::PluginArgument* parg);
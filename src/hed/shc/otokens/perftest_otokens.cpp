@@ -0,0 +1,87 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// Measures CPU time spent on authenticating single request carrying
+// bearer token. Full parsing and verification of token is compared to
+// obtaining claims of already verified token from OTokensCache.
+
+#include <ctime>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include <arc/Logger.h>
+#include <arc/otokens/otokens.h>
+
+#include "OTokensCache.h"
+
+using namespace ArcSec;
+
+int main(int argc, char* argv[]) {
+  Arc::LogStream logcerr(std::cerr);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+  Arc::Logger::getRootLogger().setThreshold(Arc::ERROR);
+
+  if ((argc < 2) || (argc > 3)) {
+    std::cerr << "Wrong number of arguments!" << std::endl
+              << std::endl
+              << "Usage:" << std::endl
+              << "perftest_otokens token [requests]" << std::endl
+              << std::endl
+              << "Arguments:" << std::endl
+              << "token     Token or path to file containing token." << std::endl
+              << "requests  Number of requests to authenticate. Default is 1000." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::string token(argv[1]);
+  {
+    std::ifstream tokenFile(argv[1]);
+    if (tokenFile) std::getline(tokenFile, token);
+  }
+  int requests = (argc > 2) ? atoi(argv[2]) : 1000;
+  if (requests < 1) requests = 1;
+
+  // Every request verifies token
+  clock_t cBefore = clock();
+  for (int n = 0; n < requests; ++n) {
+    Arc::JWSE jwse;
+    if (!jwse.Input(token)) {
+      std::cerr << "Token could not be verified" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    OTokensCache::Claims claims;
+    time_t expires = 0;
+    OTokensCache::Extract(jwse, claims, expires);
+  }
+  clock_t cAfter = clock();
+  double verify_time = ((double)(cAfter - cBefore)) / CLOCKS_PER_SEC / requests;
+
+  // Token is verified once and then taken from cache
+  OTokensCache cache(16*1024*1024, 600);
+  cBefore = clock();
+  for (int n = 0; n < requests; ++n) {
+    OTokensCache::Claims claims;
+    if (cache.Get(token, claims)) continue;
+    Arc::JWSE jwse;
+    if (!jwse.Input(token)) {
+      std::cerr << "Token could not be verified" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    time_t expires = 0;
+    OTokensCache::Extract(jwse, claims, expires);
+    cache.Put(token, claims, expires);
+  }
+  cAfter = clock();
+  double cache_time = ((double)(cAfter - cBefore)) / CLOCKS_PER_SEC / requests;
+
+  std::cout << "========================================" << std::endl;
+  std::cout << "Number of requests: " << requests << std::endl;
+  std::cout << "Without cache: " << verify_time * 1000000.0 << " us CPU per request" << std::endl;
+  std::cout << "With cache:    " << cache_time * 1000000.0 << " us CPU per request ("
+            << cache.Hits() << " hits, " << cache.Misses() << " misses)" << std::endl;
+  if (cache_time > 0)
+    std::cout << "Speedup: " << verify_time / cache_time << std::endl;
+  std::cout << "========================================" << std::endl;
+  return 0;
+}
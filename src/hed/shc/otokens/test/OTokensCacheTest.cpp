@@ -0,0 +1,154 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string>
+#include <unistd.h>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <arc/otokens/otokens.h>
+#include <arc/external/cJSON/cJSON.h>
+
+#include "../OTokensCache.h"
+
+using namespace ArcSec;
+
+class OTokensCacheTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(OTokensCacheTest);
+  CPPUNIT_TEST(TestGet);
+  CPPUNIT_TEST(TestEviction);
+  CPPUNIT_TEST(TestExpiration);
+  CPPUNIT_TEST(TestDisabled);
+  CPPUNIT_TEST(TestExtract);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void TestGet();
+  void TestEviction();
+  void TestExpiration();
+  void TestDisabled();
+  void TestExtract();
+
+private:
+  static OTokensCache::Claims MakeClaims(const std::string& subject);
+};
+
+OTokensCache::Claims OTokensCacheTest::MakeClaims(const std::string& subject) {
+  OTokensCache::Claims claims;
+  claims["iss"].push_back("https://issuer.example.org");
+  claims["sub"].push_back(subject);
+  return claims;
+}
+
+void OTokensCacheTest::TestGet() {
+  OTokensCache cache(1024*1024, 600);
+  OTokensCache::Claims claims;
+  CPPUNIT_ASSERT(!cache.Get("token1", claims));
+  cache.Put("token1", MakeClaims("user1"), 0);
+  CPPUNIT_ASSERT(cache.Get("token1", claims));
+  CPPUNIT_ASSERT(claims == MakeClaims("user1"));
+  CPPUNIT_ASSERT(!cache.Get("token2", claims));
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)1, cache.Hits());
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)2, cache.Misses());
+  // Storing same token again replaces entry
+  unsigned long long int size = cache.Size();
+  cache.Put("token1", MakeClaims("user2"), 0);
+  CPPUNIT_ASSERT_EQUAL(size, cache.Size());
+  CPPUNIT_ASSERT(cache.Get("token1", claims));
+  CPPUNIT_ASSERT(claims == MakeClaims("user2"));
+}
+
+void OTokensCacheTest::TestEviction() {
+  // Find out size of single entry
+  unsigned long long int entry_size = 0;
+  {
+    OTokensCache cache(1024*1024, 600);
+    cache.Put("token1", MakeClaims("user1"), 0);
+    entry_size = cache.Size();
+  }
+  CPPUNIT_ASSERT(entry_size > 0);
+
+  // Room for two entries only
+  OTokensCache cache(entry_size*2 + entry_size/2, 600);
+  OTokensCache::Claims claims;
+  cache.Put("token1", MakeClaims("user1"), 0);
+  cache.Put("token2", MakeClaims("user2"), 0);
+  CPPUNIT_ASSERT_EQUAL(entry_size*2, cache.Size());
+  // Make token1 most recently used so token2 is dropped
+  CPPUNIT_ASSERT(cache.Get("token1", claims));
+  cache.Put("token3", MakeClaims("user3"), 0);
+  CPPUNIT_ASSERT_EQUAL(entry_size*2, cache.Size());
+  CPPUNIT_ASSERT(cache.Get("token1", claims));
+  CPPUNIT_ASSERT(claims == MakeClaims("user1"));
+  CPPUNIT_ASSERT(cache.Get("token3", claims));
+  CPPUNIT_ASSERT(!cache.Get("token2", claims));
+
+  // Entry bigger than whole cache is not stored and does not flush others
+  OTokensCache::Claims big = MakeClaims(std::string(entry_size*3, 'x'));
+  cache.Put("token4", big, 0);
+  CPPUNIT_ASSERT(!cache.Get("token4", claims));
+  CPPUNIT_ASSERT(cache.Get("token1", claims));
+  CPPUNIT_ASSERT(cache.Get("token3", claims));
+}
+
+void OTokensCacheTest::TestExpiration() {
+  OTokensCache cache(1024*1024, 600);
+  OTokensCache::Claims claims;
+  // Already expired token is not stored
+  cache.Put("token1", MakeClaims("user1"), time(NULL) - 1);
+  CPPUNIT_ASSERT(!cache.Get("token1", claims));
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)0, cache.Size());
+  // Entry is dropped when token expires
+  cache.Put("token2", MakeClaims("user2"), time(NULL) + 1);
+  CPPUNIT_ASSERT(cache.Get("token2", claims));
+  sleep(2);
+  CPPUNIT_ASSERT(!cache.Get("token2", claims));
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)0, cache.Size());
+
+  // Entry is dropped after maximal age even if token is still valid
+  OTokensCache short_cache(1024*1024, 1);
+  short_cache.Put("token3", MakeClaims("user3"), time(NULL) + 3600);
+  CPPUNIT_ASSERT(short_cache.Get("token3", claims));
+  sleep(2);
+  CPPUNIT_ASSERT(!short_cache.Get("token3", claims));
+}
+
+void OTokensCacheTest::TestDisabled() {
+  OTokensCache cache(0, 600);
+  OTokensCache::Claims claims;
+  cache.Put("token1", MakeClaims("user1"), 0);
+  CPPUNIT_ASSERT(!cache.Get("token1", claims));
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)0, cache.Size());
+}
+
+void OTokensCacheTest::TestExtract() {
+  Arc::JWSE jwse;
+  jwse.Claim(Arc::JWSE::ClaimNameSubject, "user1");
+  cJSON* groups = cJSON_CreateArray();
+  cJSON_AddItemToArray(groups, cJSON_CreateString("/group1"));
+  cJSON_AddItemToArray(groups, cJSON_CreateNumber(1));
+  cJSON_AddItemToArray(groups, cJSON_CreateString("/group2"));
+  jwse.Claim("groups", groups);
+  cJSON_Delete(groups);
+  cJSON* notAfter = cJSON_CreateNumber(1700000000);
+  jwse.Claim(Arc::JWSE::ClaimNameNotAfter, notAfter);
+  cJSON_Delete(notAfter);
+
+  OTokensCache::Claims claims;
+  time_t expires = 0;
+  OTokensCache::Extract(jwse, claims, expires);
+  CPPUNIT_ASSERT_EQUAL((time_t)1700000000, expires);
+  CPPUNIT_ASSERT_EQUAL(1, (int)claims["sub"].size());
+  CPPUNIT_ASSERT_EQUAL(std::string("user1"), claims["sub"].front());
+  // Only string items of arrays are taken
+  CPPUNIT_ASSERT_EQUAL(2, (int)claims["groups"].size());
+  CPPUNIT_ASSERT_EQUAL(std::string("/group1"), claims["groups"].front());
+  CPPUNIT_ASSERT_EQUAL(std::string("/group2"), claims["groups"].back());
+  // Non-string claims are not collected
+  CPPUNIT_ASSERT(claims.find(Arc::JWSE::ClaimNameNotAfter) == claims.end());
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(OTokensCacheTest);
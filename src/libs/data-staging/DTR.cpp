@@ -72,7 +72,8 @@ namespace DataStaging {
        use_host_cert_for_remote_delivery(false),
        current_owner(GENERATOR),
        log_destinations(logs),
-       perf_record(perf_log)
+       perf_record(perf_log),
+       observer(NULL)
   {
     logger = new Arc::Logger(Arc::Logger::getRootLogger(), logname.c_str());
     logger->addDestinations(get_log_destinations());
@@ -145,6 +146,12 @@ namespace DataStaging {
     lock.unlock();
   }
 
+  void DTR::set_observer(DTRObserver* obs) {
+    lock.lock();
+    observer = obs;
+    lock.unlock();
+  }
+
   void DTR::reset() {
     // remove resolved locations
     if (source_endpoint->IsIndex()) {
@@ -196,6 +203,10 @@ namespace DataStaging {
     if (pri > 100) pri = 100;
     priority = pri;
     mark_modification();
+    lock.lock();
+    DTRObserver* obs = observer;
+    lock.unlock();
+    if (obs) obs->priority_changed(this, pri);
   }
   
   void DTR::set_tries_left(unsigned int tries) {
@@ -212,8 +223,10 @@ namespace DataStaging {
     logger->msg(Arc::VERBOSE, "%s->%s", status.str(), stat.str());
     lock.lock();
     status = stat;
+    DTRObserver* obs = observer;
     lock.unlock();
     mark_modification();
+    if (obs) obs->status_changed(this, stat.GetStatus());
   }
   
   DTRStatus DTR::get_status() {
@@ -205,6 +205,26 @@ namespace DataStaging {
       //virtual void cancelDTR(DTR& dtr) = 0;
   };
 
+  /// Interface for objects which follow changes of DTR properties used for scheduling.
+  /**
+   * An observer can be attached to a DTR with DTR::set_observer() to be
+   * notified when the status or priority of the DTR changes. It is used by
+   * DTRList to keep its queues up to date without scanning all DTRs.
+   * Notifications are called by the thread changing the DTR after the change
+   * is made and without holding the DTR lock.
+   * \ingroup datastaging
+   * \headerfile DTR.h arc/data-staging/DTR.h
+   */
+  class DTRObserver {
+    public:
+      /// Empty virtual destructor
+      virtual ~DTRObserver() {};
+      /// Called when status of dtr is set to status
+      virtual void status_changed(DTR* dtr, DTRStatus::DTRStatusType status) = 0;
+      /// Called when priority of dtr is set to priority
+      virtual void priority_changed(DTR* dtr, int priority) = 0;
+  };
+
   /// Data Transfer Request.
   /**
    * DTR stands for Data Transfer Request and a DTR describes a data transfer
@@ -374,6 +394,9 @@ namespace DataStaging {
     /// List of callback methods called when DTR moves between processes
     std::map<StagingProcesses,std::list<DTRCallback*> > proc_callback;
 
+    /// Object notified about status and priority changes
+    DTRObserver* observer;
+
     /// Lock to avoid collisions while changing DTR properties
     Arc::SimpleCondition lock;
 
@@ -450,6 +473,13 @@ namespace DataStaging {
      */
     void registerCallback(DTRCallback* cb, StagingProcesses owner);
 
+    /// Attach object to be notified about changes of status and priority.
+    /**
+     * Only one observer can be attached. NULL detaches current observer.
+     * Protected by lock.
+     */
+    void set_observer(DTRObserver* obs);
+
     /// Reset information held on this DTR, such as resolved replicas, error state etc.
     /**
      * Useful when a failed DTR is to be retried.
@@ -9,69 +9,141 @@
 
 namespace DataStaging {
   
+  DTRList::DTRList(): DTRSeq(0) {}
+
+  DTRList::~DTRList() {
+    Lock.lock();
+    for (std::map<unsigned long long int, DTR_ptr>::iterator it = DTRs.begin(); it != DTRs.end(); ++it)
+      it->second->set_observer(NULL);
+    Lock.unlock();
+  }
+
   bool DTRList::add_dtr(DTR_ptr DTRToAdd) {
-  	Lock.lock();
-  	DTRs.push_back(DTRToAdd);
-  	Lock.unlock();
-  	
-  	// Added successfully
-  	return true;
+    Lock.lock();
+    if (DTRIndex.find(DTRToAdd.Ptr()) != DTRIndex.end()) {
+      Lock.unlock();
+      return true;
+    }
+    // Observer is attached first so that no change is lost. Notifications
+    // wait for the lock and will then find the DTR already indexed.
+    DTRToAdd->set_observer(this);
+    DTRIndexEntry& entry = DTRIndex[DTRToAdd.Ptr()];
+    entry.dtr = DTRToAdd;
+    entry.seq = ++DTRSeq;
+    entry.status = DTRToAdd->get_status().GetStatus();
+    entry.priority = DTRToAdd->get_priority();
+    DTRs[entry.seq] = DTRToAdd;
+    StatusQueues[entry.status][QueueKey(-entry.priority, entry.seq)] = DTRToAdd;
+    JobDTRs[DTRToAdd->get_parent_job_id()][entry.seq] = DTRToAdd;
+    Lock.unlock();
+
+    // Added successfully
+    return true;
   }
   
   bool DTRList::delete_dtr(DTR_ptr DTRToDelete) {
-  	
-  	Lock.lock();
-  	DTRs.remove(DTRToDelete);
-  	Lock.unlock();
-  	
-  	// Deleted successfully
-  	return true;
+
+    Lock.lock();
+    std::map<const DTR*, DTRIndexEntry>::iterator entry = DTRIndex.find(DTRToDelete.Ptr());
+    if (entry != DTRIndex.end()) {
+      DTRToDelete->set_observer(NULL);
+      StatusQueues[entry->second.status].erase(QueueKey(-entry->second.priority, entry->second.seq));
+      std::map<std::string, std::map<unsigned long long int, DTR_ptr> >::iterator job =
+        JobDTRs.find(DTRToDelete->get_parent_job_id());
+      if (job != JobDTRs.end()) {
+        job->second.erase(entry->second.seq);
+        if (job->second.empty()) JobDTRs.erase(job);
+      }
+      DTRs.erase(entry->second.seq);
+      DTRIndex.erase(entry);
+    }
+    Lock.unlock();
+
+    // Deleted successfully
+    return true;
+  }
+
+  void DTRList::status_changed(DTR* dtr, DTRStatus::DTRStatusType status) {
+    Lock.lock();
+    std::map<const DTR*, DTRIndexEntry>::iterator entry = DTRIndex.find(dtr);
+    if (entry != DTRIndex.end() && entry->second.status != status) {
+      QueueKey key(-entry->second.priority, entry->second.seq);
+      StatusQueues[entry->second.status].erase(key);
+      StatusQueues[status][key] = entry->second.dtr;
+      entry->second.status = status;
+    }
+    Lock.unlock();
+  }
+
+  void DTRList::priority_changed(DTR* dtr, int priority) {
+    Lock.lock();
+    std::map<const DTR*, DTRIndexEntry>::iterator entry = DTRIndex.find(dtr);
+    if (entry != DTRIndex.end() && entry->second.priority != priority) {
+      DTRQueue& queue = StatusQueues[entry->second.status];
+      queue.erase(QueueKey(-entry->second.priority, entry->second.seq));
+      queue[QueueKey(-priority, entry->second.seq)] = entry->second.dtr;
+      entry->second.priority = priority;
+    }
+    Lock.unlock();
+  }
+
+  void DTRList::copy_queue(DTRStatus::DTRStatusType status, std::list<DTR_ptr>& FilteredList) {
+    std::map<DTRStatus::DTRStatusType, DTRQueue>::iterator queue = StatusQueues.find(status);
+    if (queue == StatusQueues.end()) return;
+    for (DTRQueue::iterator it = queue->second.begin(); it != queue->second.end(); ++it)
+      FilteredList.push_back(it->second);
   }
   
   bool DTRList::filter_dtrs_by_owner(StagingProcesses OwnerToFilter, std::list<DTR_ptr>& FilteredList){
-  	std::list<DTR_ptr>::iterator it;
-     
+    std::map<unsigned long long int, DTR_ptr>::iterator it;
+
     Lock.lock();
-  	for(it = DTRs.begin();it != DTRs.end(); ++it)
-  	  if((*it)->get_owner() == OwnerToFilter)
-  	    FilteredList.push_back(*it);
+    for(it = DTRs.begin();it != DTRs.end(); ++it)
+      if(it->second->get_owner() == OwnerToFilter)
+        FilteredList.push_back(it->second);
     Lock.unlock();
 
-  	// Filtered successfully
-  	return true;
+    // Filtered successfully
+    return true;
   }
   
   int DTRList::number_of_dtrs_by_owner(StagingProcesses OwnerToFilter){
-  	std::list<DTR_ptr>::iterator it;
+    std::map<unsigned long long int, DTR_ptr>::iterator it;
     int counter = 0;
     
     Lock.lock();
-  	for(it = DTRs.begin();it != DTRs.end(); ++it)
-  	  if((*it)->get_owner() == OwnerToFilter)
-  	    counter++;
+    for(it = DTRs.begin();it != DTRs.end(); ++it)
+      if(it->second->get_owner() == OwnerToFilter)
+        counter++;
     Lock.unlock();
 
-  	// Filtered successfully
-  	return counter;
+    // Filtered successfully
+    return counter;
   }
   
   bool DTRList::filter_dtrs_by_status(DTRStatus::DTRStatusType StatusToFilter, std::list<DTR_ptr>& FilteredList){
-    std::vector<DTRStatus::DTRStatusType> StatusesToFilter(1, StatusToFilter);
-    return filter_dtrs_by_statuses(StatusesToFilter, FilteredList);
+    Lock.lock();
+    copy_queue(StatusToFilter, FilteredList);
+    Lock.unlock();
+
+    // Filtered successfully
+    return true;
   }
 
   bool DTRList::filter_dtrs_by_statuses(const std::vector<DTRStatus::DTRStatusType>& StatusesToFilter,
                                         std::list<DTR_ptr>& FilteredList){
-    std::list<DTR_ptr>::iterator it;
-
     Lock.lock();
-    for(it = DTRs.begin();it != DTRs.end(); ++it) {
+    if (StatusesToFilter.size() == 1) {
+      copy_queue(StatusesToFilter.front(), FilteredList);
+    } else {
+      // Merge queues to keep result ordered by priority and arrival
+      DTRQueue merged;
       for (std::vector<DTRStatus::DTRStatusType>::const_iterator i = StatusesToFilter.begin(); i != StatusesToFilter.end(); ++i) {
-        if((*it)->get_status().GetStatus() == *i) {
-          FilteredList.push_back(*it);
-          break;
-        }
+        std::map<DTRStatus::DTRStatusType, DTRQueue>::iterator queue = StatusQueues.find(*i);
+        if (queue != StatusQueues.end()) merged.insert(queue->second.begin(), queue->second.end());
       }
+      for (DTRQueue::iterator it = merged.begin(); it != merged.end(); ++it)
+        FilteredList.push_back(it->second);
     }
     Lock.unlock();
 
@@ -81,16 +153,9 @@ namespace DataStaging {
 
   bool DTRList::filter_dtrs_by_statuses(const std::vector<DTRStatus::DTRStatusType>& StatusesToFilter,
                                         std::map<DTRStatus::DTRStatusType, std::list<DTR_ptr> >& FilteredList) {
-    std::list<DTR_ptr>::iterator it;
-
     Lock.lock();
-    for(it = DTRs.begin();it != DTRs.end(); ++it) {
-      for (std::vector<DTRStatus::DTRStatusType>::const_iterator i = StatusesToFilter.begin(); i != StatusesToFilter.end(); ++i) {
-        if((*it)->get_status().GetStatus() == *i) {
-          FilteredList[*i].push_back(*it);
-          break;
-        }
-      }
+    for (std::vector<DTRStatus::DTRStatusType>::const_iterator i = StatusesToFilter.begin(); i != StatusesToFilter.end(); ++i) {
+      copy_queue(*i, FilteredList[*i]);
     }
     Lock.unlock();
 
@@ -99,30 +164,30 @@ namespace DataStaging {
   }
 
   bool DTRList::filter_dtrs_by_next_receiver(StagingProcesses NextReceiver, std::list<DTR_ptr>& FilteredList) {
-  	std::list<DTR_ptr>::iterator it;
+  	std::map<unsigned long long int, DTR_ptr>::iterator it;
   	
   	switch(NextReceiver){
   	  case PRE_PROCESSOR: {
         Lock.lock();
         for(it = DTRs.begin();it != DTRs.end(); ++it)
-  	      if((*it)->is_destined_for_pre_processor())
-  	        FilteredList.push_back(*it);
+  	      if(it->second->is_destined_for_pre_processor())
+  	        FilteredList.push_back(it->second);
   	    Lock.unlock();
   	    return true;  	  	
   	  }
   	  case POST_PROCESSOR: {
   	  	Lock.lock();
   	  	for(it = DTRs.begin();it != DTRs.end(); ++it)
-  	      if((*it)->is_destined_for_post_processor())
-  	        FilteredList.push_back(*it);
+  	      if(it->second->is_destined_for_post_processor())
+  	        FilteredList.push_back(it->second);
   	    Lock.unlock();
   	    return true;
   	  }
   	  case DELIVERY: {
   	  	Lock.lock();
   	  	for(it = DTRs.begin();it != DTRs.end(); ++it)
-  	      if((*it)->is_destined_for_delivery())
-  	        FilteredList.push_back(*it);
+  	      if(it->second->is_destined_for_delivery())
+  	        FilteredList.push_back(it->second);
   	    Lock.unlock();
   	    return true;
   	  }
@@ -132,15 +197,15 @@ namespace DataStaging {
   }
   
   bool DTRList::filter_pending_dtrs(std::list<DTR_ptr>& FilteredList){
-  	std::list<DTR_ptr>::iterator it;
+  	std::map<unsigned long long int, DTR_ptr>::iterator it;
   	Arc::Time now;
   	
   	Lock.lock(); 	
   	for(it = DTRs.begin();it != DTRs.end(); ++it){
-  	  if( ((*it)->came_from_pre_processor() || (*it)->came_from_post_processor() ||
-  	       (*it)->came_from_delivery() || (*it)->came_from_generator()) &&
-  	      ((*it)->get_process_time() <= now) )
-  	    FilteredList.push_back(*it);
+  	  if( (it->second->came_from_pre_processor() || it->second->came_from_post_processor() ||
+  	       it->second->came_from_delivery() || it->second->came_from_generator()) &&
+  	      (it->second->get_process_time() <= now) )
+  	    FilteredList.push_back(it->second);
   	}  	    
   	Lock.unlock();
   	
@@ -149,12 +214,12 @@ namespace DataStaging {
   }
   
   bool DTRList::filter_dtrs_by_job(const std::string& jobid, std::list<DTR_ptr>& FilteredList) {
-    std::list<DTR_ptr>::iterator it;
-
     Lock.lock();
-    for(it = DTRs.begin();it != DTRs.end(); ++it)
-      if((*it)->get_parent_job_id() == jobid)
-        FilteredList.push_back(*it);
+    std::map<std::string, std::map<unsigned long long int, DTR_ptr> >::iterator job = JobDTRs.find(jobid);
+    if (job != JobDTRs.end()) {
+      for (std::map<unsigned long long int, DTR_ptr>::iterator it = job->second.begin(); it != job->second.end(); ++it)
+        FilteredList.push_back(it->second);
+    }
     Lock.unlock();
 
     // Filtered successfully
@@ -179,15 +244,21 @@ namespace DataStaging {
       }
     }
 
-    std::list<DTR_ptr>::iterator it;
+    std::list<DTR_ptr> changed;
+    std::map<unsigned long long int, DTR_ptr>::iterator it;
 
     Lock.lock();
     for(it = DTRs.begin();it != DTRs.end(); ++it) {
-      if(new_prio.find((*it)->get_id()) != new_prio.end()) {
-        (*it)->set_priority(new_prio[(*it)->get_id()]);
+      if(new_prio.find(it->second->get_id()) != new_prio.end()) {
+        changed.push_back(it->second);
       }
     }
     Lock.unlock();
+
+    // Priority is changed without lock because DTR reports change back to list
+    for(std::list<DTR_ptr>::iterator dtr = changed.begin(); dtr != changed.end(); ++dtr) {
+      (*dtr)->set_priority(new_prio[(*dtr)->get_id()]);
+    }
   }
 
   void DTRList::caching_started(DTR_ptr request) {
@@ -209,17 +280,22 @@ namespace DataStaging {
     bool caching = (i != CachingSources.end());
     // If already caching, find the DTR and increase its priority if necessary
     if (caching && i->second < DTRToCheck->get_priority()) {
+      std::list<DTR_ptr> boosted;
       Lock.lock();
-      for(std::list<DTR_ptr>::iterator it = DTRs.begin();it != DTRs.end(); ++it) {
-        if ((*it)->get_source_str() == DTRToCheck->get_source_str() &&
-            ((*it)->get_status() != DTRStatus::CACHE_WAIT && (*it)->get_status() != DTRStatus::CHECK_CACHE)) {
-          (*it)->get_logger()->msg(Arc::INFO, "Boosting priority from %i to %i due to incoming higher priority DTR",
-                                   (*it)->get_priority(), DTRToCheck->get_priority());
-          (*it)->set_priority(DTRToCheck->get_priority());
-          CachingSources[DTRToCheck->get_source_str()] = DTRToCheck->get_priority();
+      for(std::map<unsigned long long int, DTR_ptr>::iterator it = DTRs.begin();it != DTRs.end(); ++it) {
+        if (it->second->get_source_str() == DTRToCheck->get_source_str() &&
+            (it->second->get_status() != DTRStatus::CACHE_WAIT && it->second->get_status() != DTRStatus::CHECK_CACHE)) {
+          boosted.push_back(it->second);
         }
       }
       Lock.unlock();
+      // Priority is changed without lock because DTR reports change back to list
+      for(std::list<DTR_ptr>::iterator it = boosted.begin();it != boosted.end(); ++it) {
+        (*it)->get_logger()->msg(Arc::INFO, "Boosting priority from %i to %i due to incoming higher priority DTR",
+                                 (*it)->get_priority(), DTRToCheck->get_priority());
+        (*it)->set_priority(DTRToCheck->get_priority());
+        CachingSources[DTRToCheck->get_source_str()] = DTRToCheck->get_priority();
+      }
     }
     CachingLock.unlock();
     return caching;
@@ -241,17 +317,11 @@ namespace DataStaging {
 
   std::list<std::string> DTRList::all_jobs() {
     std::list<std::string> alljobs;
-    std::list<DTR_ptr>::iterator it;
 
     Lock.lock();
-    for(it = DTRs.begin();it != DTRs.end(); ++it) {
-      std::list<std::string>::iterator i = alljobs.begin();
-      for (; i != alljobs.end(); ++i) {
-        if (*i == (*it)->get_parent_job_id())
-          break;
-      }
-      if (i == alljobs.end())
-        alljobs.push_back((*it)->get_parent_job_id());
+    for(std::map<std::string, std::map<unsigned long long int, DTR_ptr> >::iterator job = JobDTRs.begin();
+        job != JobDTRs.end(); ++job) {
+      alljobs.push_back(job->first);
     }
     Lock.unlock();
 
@@ -262,15 +332,16 @@ namespace DataStaging {
     // only files supported for now - simply overwrite path
     std::string data;
     Lock.lock();
-    for(std::list<DTR_ptr>::iterator it = DTRs.begin();it != DTRs.end(); ++it) {
-      data += (*it)->get_id() + " " +
-              (*it)->get_status().str() + " " +
-              Arc::tostring((*it)->get_priority()) + " " +
-              (*it)->get_transfer_share();
+    for(std::map<unsigned long long int, DTR_ptr>::iterator i = DTRs.begin();i != DTRs.end(); ++i) {
+      DTR_ptr it = i->second;
+      data += it->get_id() + " " +
+              it->get_status().str() + " " +
+              Arc::tostring(it->get_priority()) + " " +
+              it->get_transfer_share();
       // add destination for recovery after crash
-      if ((*it)->get_status() == DTRStatus::TRANSFERRING || (*it)->get_status() == DTRStatus::TRANSFER) {
-        data += " " + (*it)->get_destination()->CurrentLocation().fullstr();
-        data += " " + (*it)->get_delivery_endpoint().Host();
+      if (it->get_status() == DTRStatus::TRANSFERRING || it->get_status() == DTRStatus::TRANSFER) {
+        data += " " + it->get_destination()->CurrentLocation().fullstr();
+        data += " " + it->get_delivery_endpoint().Host();
       }
       data += "\n";
     }
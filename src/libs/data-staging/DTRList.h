@@ -10,16 +10,47 @@ namespace DataStaging {
   /// Global list of all active DTRs in the system.
   /**
    * This class contains several methods for filtering the list by owner, state
-   * etc.
+   * etc. DTRs are additionally kept in queues per status and per job, which
+   * are updated through DTRObserver notifications when DTRs change status or
+   * priority. So selecting DTRs by status or job only costs as much as the
+   * number of DTRs selected. Queues are ordered by priority, highest first,
+   * and then by order of arrival.
    * \ingroup datastaging
    * \headerfile DTRList.h arc/data-staging/DTRList.h
    */
-  class DTRList {
+  class DTRList: public DTRObserver {
 
     private:
 
-      /// Internal list of DTRs
-      std::list<DTR_ptr> DTRs;
+      /// Position of DTR in queue ordered by priority (negated) and arrival
+      typedef std::pair<int, unsigned long long int> QueueKey;
+
+      /// Queue of DTRs ordered by priority and arrival
+      typedef std::map<QueueKey, DTR_ptr> DTRQueue;
+
+      /// Indexed information about DTR
+      class DTRIndexEntry {
+        public:
+          DTR_ptr dtr;
+          unsigned long long int seq;
+          DTRStatus::DTRStatusType status;
+          int priority;
+      };
+
+      /// Internal list of DTRs in order of arrival
+      std::map<unsigned long long int, DTR_ptr> DTRs;
+
+      /// Information about every DTR in list
+      std::map<const DTR*, DTRIndexEntry> DTRIndex;
+
+      /// DTRs sorted by status
+      std::map<DTRStatus::DTRStatusType, DTRQueue> StatusQueues;
+
+      /// DTRs sorted by parent job
+      std::map<std::string, std::map<unsigned long long int, DTR_ptr> > JobDTRs;
+
+      /// Counter used to order DTRs by arrival
+      unsigned long long int DTRSeq;
   
       /// Lock to protect list during modification
       Arc::SimpleCondition Lock;
@@ -34,8 +65,20 @@ namespace DataStaging {
       /// Lock to protect caching sources set during modification
       Arc::SimpleCondition CachingLock;
 
+      /// Copy DTRs from queue of specified status. Must be called with Lock held.
+      void copy_queue(DTRStatus::DTRStatusType status, std::list<DTR_ptr>& FilteredList);
+
+      /// Not implemented because DTRs keep pointer to list.
+      DTRList(const DTRList&);
+      DTRList& operator=(const DTRList&);
+
     public:
 
+      DTRList();
+
+      /// Detaches from all DTRs remaining in list.
+      virtual ~DTRList();
+
       /// Put a new DTR into the list.
       bool add_dtr(DTR_ptr DTRToAdd);
 
@@ -56,7 +99,8 @@ namespace DataStaging {
       /**
        * If we have only one common queue for all DTRs, this method is
        * necessary to make virtual queues for the DTRs about to go into the
-       * pre-, post-processor or delivery stages.
+       * pre-, post-processor or delivery stages. Filtered DTRs are sorted
+       * by priority, highest first.
        * @param StatusToFilter DTR status to filter on
        * @param FilteredList This list is filled with filtered DTRs
        */
@@ -74,7 +118,7 @@ namespace DataStaging {
       /**
        * @param StatusesToFilter Vector of DTR statuses to filter on
        * @param FilteredList This map is filled with filtered DTRs,
-       * one list per state.
+       * one list per state. Every list is sorted by priority, highest first.
        */
       bool filter_dtrs_by_statuses(const std::vector<DTRStatus::DTRStatusType>& StatusesToFilter,
                                    std::map<DTRStatus::DTRStatusType, std::list<DTR_ptr> >& FilteredList);
@@ -127,6 +171,12 @@ namespace DataStaging {
       /// Return the size of the DTR list
       unsigned int size();
 
+      /// Move DTR to queue of its new status. Called by DTR.
+      virtual void status_changed(DTR* dtr, DTRStatus::DTRStatusType status);
+
+      /// Reposition DTR in queue of its status. Called by DTR.
+      virtual void priority_changed(DTR* dtr, int priority);
+
       /// Dump state of all current DTRs to a destination, eg file, database, url...
       /**
        * Currently only file is supported.
@@ -10,7 +10,7 @@ namespace DataStaging {
   /// This class provides an abstract interface for the Delivery layer.
   /**
    * Different implementations provide different ways of providing Delivery
-   * functionality. DataDeliveryLocalComm launches a local process to perform
+   * functionality. DataDeliveryLocalComm uses a local process to perform
    * the transfer and DataDeliveryRemoteComm contacts a remote service which
    * performs the transfer. The implementation is chosen depending on what is
    * set in the DTR, which the Scheduler should set based on various factors.
@@ -43,7 +43,8 @@ namespace DataStaging {
     /// Plain C struct to pass information from executing process back to main thread
     /** \ingroup datastaging */
     struct Status {
-      CommStatusType commstatus;         ///< Communication state (filled by main thread)
+      CommStatusType commstatus;         ///< Communication state (filled by main thread,
+                                         ///< pooled delivery process marks end of transfer with CommExited or CommFailed)
       time_t timestamp;                  ///< Time when information was generated (filled externally)
       DTRStatus::DTRStatusType status;   ///< Generic status
       DTRErrorStatus::DTRErrorStatusType error; ///< Error type
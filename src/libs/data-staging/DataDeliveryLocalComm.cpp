@@ -2,14 +2,203 @@
 #include <config.h>
 #endif
 
+#include <map>
+
 #include <arc/ArcLocation.h>
 #include <arc/FileAccess.h>
 #include <arc/FileUtils.h>
+#include <arc/Utils.h>
 
 #include "DataDeliveryLocalComm.h"
 
 namespace DataStaging {
 
+  // Default number of idle delivery processes kept for every user
+  static const unsigned int DefaultMaxIdleWorkers = 8;
+  // Default time in seconds idle delivery process is kept
+  static const int DefaultWorkerIdleTimeout = 60;
+  // Delivery process exits by itself if not used for longer than
+  // pool keeps it. This covers case of parent being stuck.
+  static const int WorkerIdleMargin = 60;
+  // Number of transfers after which process is replaced. Limits effect of
+  // resources leaked by plugins and external libraries.
+  static const unsigned int MaxWorkerTransfers = 100;
+
+  static std::string delivery_executable(void) {
+    return Arc::ArcLocation::GetLibDir()+G_DIR_SEPARATOR_S+"DataStagingDelivery";
+  }
+
+  // DataStagingDelivery process started in worker mode. It performs
+  // transfers for one local user one after another.
+  class DataDeliveryWorker {
+  public:
+    DataDeliveryWorker(int uid, int gid): run(NULL), uid(uid), gid(gid), transfers(0) {};
+    ~DataDeliveryWorker();
+    bool Start(int idle_timeout);
+    /// Passes transfer arguments and credentials to process
+    bool Send(const std::list<std::string>& args, const std::string& credentials);
+    Arc::Run* run;
+    int uid;
+    int gid;
+    unsigned int transfers;
+    Arc::Time idle_since;
+  };
+
+  DataDeliveryWorker::~DataDeliveryWorker() {
+    if (!run) return;
+    // Idle worker exits as soon as there are no more requests
+    run->CloseStdin();
+    run->Kill(1);
+    delete run;
+  }
+
+  bool DataDeliveryWorker::Start(int idle_timeout) {
+    std::list<std::string> args;
+    args.push_back(delivery_executable());
+    args.push_back("--worker");
+    args.push_back(Arc::tostring(idle_timeout));
+    run = new Arc::Run(args);
+    run->KeepStdout(false);
+    run->KeepStderr(false);
+    run->KeepStdin(false);
+    run->AssignUserId(uid);
+    run->AssignGroupId(gid);
+    if (!run->Start()) {
+      delete run;
+      run = NULL;
+      return false;
+    }
+    return true;
+  }
+
+  bool DataDeliveryWorker::Send(const std::list<std::string>& args, const std::string& credentials) {
+    std::string request;
+    for (std::list<std::string>::const_iterator arg = args.begin(); arg != args.end(); ++arg) {
+      request += *arg;
+      request += '\0';
+    }
+    request += '\0';
+    request += credentials;
+    request += '\0';
+    std::string::size_type pos = 0;
+    while (pos < request.length()) {
+      int l = run->WriteStdin(10000, request.c_str()+pos, request.length()-pos);
+      if (l <= 0) return false;
+      pos += l;
+    }
+    ++transfers;
+    return true;
+  }
+
+  // Idle delivery processes kept separately for every user and group.
+  class DataDeliveryWorkerPool {
+  public:
+    static DataDeliveryWorkerPool& Instance();
+    bool Enabled() const { return (max_idle_ > 0); };
+    /// Takes idle process or starts new one. Returns NULL on failure.
+    DataDeliveryWorker* Acquire(int uid, int gid);
+    /// Keeps process for following transfers or destroys it.
+    void Release(DataDeliveryWorker* worker);
+    /// Counts started process, pooled or dedicated to one transfer.
+    void Started();
+    unsigned int StartedNum();
+    unsigned int IdleNum();
+  private:
+    DataDeliveryWorkerPool(unsigned int max_idle, int idle_timeout):
+      max_idle_(max_idle), idle_timeout_(idle_timeout), started_(0) {};
+    typedef std::multimap<std::pair<int,int>, DataDeliveryWorker*> IdleMap;
+    IdleMap idle_;
+    unsigned int max_idle_;
+    int idle_timeout_;
+    unsigned int started_;
+    Glib::Mutex lock_;
+    // Moves workers idle for too long to expired. They are destroyed
+    // outside lock because stopping process takes time.
+    void expire(const Arc::Time& now, std::list<DataDeliveryWorker*>& expired);
+  };
+
+  static Glib::Mutex pool_instance_lock;
+  static DataDeliveryWorkerPool* pool_instance = NULL;
+
+  DataDeliveryWorkerPool& DataDeliveryWorkerPool::Instance() {
+    Glib::Mutex::Lock lock(pool_instance_lock);
+    if (!pool_instance) {
+      // Never destroyed. Idle processes exit when this process exits
+      // because their stdin is closed.
+      unsigned int max_idle = DefaultMaxIdleWorkers;
+      int idle_timeout = DefaultWorkerIdleTimeout;
+      std::string value = Arc::GetEnv("ARC_DELIVERY_POOL_SIZE");
+      if (!value.empty()) Arc::stringto(value, max_idle);
+      value = Arc::GetEnv("ARC_DELIVERY_POOL_IDLE");
+      if (!value.empty()) Arc::stringto(value, idle_timeout);
+      pool_instance = new DataDeliveryWorkerPool(max_idle, idle_timeout);
+    }
+    return *pool_instance;
+  }
+
+  void DataDeliveryWorkerPool::expire(const Arc::Time& now, std::list<DataDeliveryWorker*>& expired) {
+    for (IdleMap::iterator it = idle_.begin(); it != idle_.end();) {
+      if (((now - it->second->idle_since).GetPeriod() >= idle_timeout_) || !(it->second->run->Running())) {
+        expired.push_back(it->second);
+        idle_.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  DataDeliveryWorker* DataDeliveryWorkerPool::Acquire(int uid, int gid) {
+    std::list<DataDeliveryWorker*> expired;
+    DataDeliveryWorker* worker = NULL;
+    {
+      Glib::Mutex::Lock lock(lock_);
+      expire(Arc::Time(), expired);
+      IdleMap::iterator it = idle_.find(std::make_pair(uid, gid));
+      if (it != idle_.end()) {
+        worker = it->second;
+        idle_.erase(it);
+      }
+    }
+    for (std::list<DataDeliveryWorker*>::iterator w = expired.begin(); w != expired.end(); ++w) delete *w;
+    if (worker) return worker;
+    worker = new DataDeliveryWorker(uid, gid);
+    if (!worker->Start(idle_timeout_ + WorkerIdleMargin)) {
+      delete worker;
+      return NULL;
+    }
+    Started();
+    return worker;
+  }
+
+  void DataDeliveryWorkerPool::Release(DataDeliveryWorker* worker) {
+    if (!worker) return;
+    if ((worker->transfers < MaxWorkerTransfers) && worker->run->Running()) {
+      Glib::Mutex::Lock lock(lock_);
+      std::pair<int,int> key(worker->uid, worker->gid);
+      if (idle_.count(key) < max_idle_) {
+        worker->idle_since = Arc::Time();
+        idle_.insert(std::make_pair(key, worker));
+        return;
+      }
+    }
+    delete worker;
+  }
+
+  void DataDeliveryWorkerPool::Started() {
+    Glib::Mutex::Lock lock(lock_);
+    ++started_;
+  }
+
+  unsigned int DataDeliveryWorkerPool::StartedNum() {
+    Glib::Mutex::Lock lock(lock_);
+    return started_;
+  }
+
+  unsigned int DataDeliveryWorkerPool::IdleNum() {
+    Glib::Mutex::Lock lock(lock_);
+    return idle_.size();
+  }
+
   // Check if needed and create copy of proxy with suitable ownership
   static std::string prepare_proxy(const std::string& proxy_path, int child_uid, int child_gid) {
     if (proxy_path.empty()) return ""; // No credentials
@@ -36,7 +225,7 @@ namespace DataStaging {
   }
 
   DataDeliveryLocalComm::DataDeliveryLocalComm(DTR_ptr dtr, const TransferParameters& params)
-    : DataDeliveryComm(dtr, params),child_(NULL),last_comm(Arc::Time()) {
+    : DataDeliveryComm(dtr, params),child_(NULL),worker_(NULL),last_comm(Arc::Time()) {
     // Initial empty status
     memset(&status_,0,sizeof(status_));
     status_.commstatus = CommInit;
@@ -53,8 +242,6 @@ namespace DataStaging {
       Glib::Mutex::Lock lock(lock_);
       // Generate options for child
       std::list<std::string> args;
-      std::string execpath = Arc::ArcLocation::GetLibDir()+G_DIR_SEPARATOR_S+"DataStagingDelivery";
-      args.push_back(execpath);
 
       // check for alternative source or destination eg cache, mapped URL, TURL
       std::string surl;
@@ -157,26 +344,53 @@ namespace DataStaging {
         args.push_back("--cstype");
         args.push_back(dtr->get_destination()->DefaultCheckSum());
       }
-      child_ = new Arc::Run(args);
-      // Set up pipes
-      child_->KeepStdout(false);
-      child_->KeepStderr(false);
-      child_->KeepStdin(false);
-      child_->AssignUserId(child_uid);
-      child_->AssignGroupId(child_gid);
-      child_->AssignStdin(stdin_);
-      // Start child
-      std::string cmd;
-      for(std::list<std::string>::iterator arg = args.begin();arg!=args.end();++arg) {
-        cmd += *arg;
-        cmd += " ";
-      }
-      logger_->msg(Arc::DEBUG, "Running command: %s", cmd);
-      if(!child_->Start()) {
-        delete child_;
-        child_=NULL;
-        logger_->msg(Arc::ERROR, "Failed to run command: %s", cmd);
-        return;
+      DataDeliveryWorkerPool& pool = DataDeliveryWorkerPool::Instance();
+      if (pool.Enabled()) {
+        std::string cmd;
+        for(std::list<std::string>::iterator arg = args.begin();arg!=args.end();++arg) {
+          cmd += " ";
+          cmd += *arg;
+        }
+        // Idle process may have exited just now, hence second attempt
+        for (int attempt = 0; (attempt < 2) && !child_; ++attempt) {
+          worker_ = pool.Acquire(child_uid, child_gid);
+          if (!worker_) break;
+          if (worker_->Send(args, stdin_)) {
+            child_ = worker_->run;
+          } else {
+            delete worker_;
+            worker_ = NULL;
+          }
+        }
+        if (!child_) {
+          logger_->msg(Arc::ERROR, "Failed to pass transfer to delivery process:%s", cmd);
+          return;
+        }
+        logger_->msg(Arc::DEBUG, "Passed transfer to delivery process:%s", cmd);
+      } else {
+        args.push_front(delivery_executable());
+        child_ = new Arc::Run(args);
+        // Set up pipes
+        child_->KeepStdout(false);
+        child_->KeepStderr(false);
+        child_->KeepStdin(false);
+        child_->AssignUserId(child_uid);
+        child_->AssignGroupId(child_gid);
+        child_->AssignStdin(stdin_);
+        // Start child
+        std::string cmd;
+        for(std::list<std::string>::iterator arg = args.begin();arg!=args.end();++arg) {
+          cmd += *arg;
+          cmd += " ";
+        }
+        logger_->msg(Arc::DEBUG, "Running command: %s", cmd);
+        if(!child_->Start()) {
+          delete child_;
+          child_=NULL;
+          logger_->msg(Arc::ERROR, "Failed to run command: %s", cmd);
+          return;
+        }
+        pool.Started();
       }
     }
     handler_->Add(this);
@@ -185,48 +399,64 @@ namespace DataStaging {
   DataDeliveryLocalComm::~DataDeliveryLocalComm(void) {
     {
       Glib::Mutex::Lock lock(lock_);
-      if(child_) {
-        child_->Kill(10); // Give it a chance
-        delete child_; child_=NULL;  // And then kill for sure
-      }
+      StopChild(10); // Give it a chance and then kill for sure
     }
     if(!tmp_proxy_.empty()) Arc::FileDelete(tmp_proxy_);
     if(handler_) handler_->Remove(this);
   }
 
+  void DataDeliveryLocalComm::StopChild(int kill_timeout) {
+    if(!child_) return;
+    if(kill_timeout > 0) child_->Kill(kill_timeout);
+    if(worker_) {
+      delete worker_; // owns child_
+      worker_ = NULL;
+    } else {
+      delete child_;
+    }
+    child_ = NULL;
+  }
+
+  void DataDeliveryLocalComm::ReadStderr(void) {
+    // TODO: direct redirect
+    for(;;) {
+      char buf[1024+1];
+      int l = child_->ReadStderr(0,buf,sizeof(buf)-1);
+      if(l <= 0) break;
+      buf[l] = 0;
+      char* start = buf;
+      for(;*start;) {
+        char* end = strchr(start,'\n');
+        if(end) *end = 0;
+        logger_->msg(Arc::INFO, "DataDelivery: %s", start);
+        if(!end) break;
+        start = end + 1;
+      }
+    }
+  }
+
   void DataDeliveryLocalComm::PullStatus(void) {
     Glib::Mutex::Lock lock(lock_);
     if(!child_) return;
     for(;;) {
       if(status_pos_ < sizeof(status_buf_)) {
-        int l;
-        // TODO: direct redirect
-        for(;;) {
-          char buf[1024+1];
-          l = child_->ReadStderr(0,buf,sizeof(buf)-1);
-          if(l <= 0) break;
-          buf[l] = 0;
-          char* start = buf;
-          for(;*start;) {
-            char* end = strchr(start,'\n');
-            if(end) *end = 0;
-            logger_->msg(Arc::INFO, "DataDelivery: %s", start);
-            if(!end) break;
-            start = end + 1;
-          }
-        }
-        l = child_->ReadStdout(0,((char*)&status_buf_)+status_pos_,sizeof(status_buf_)-status_pos_);
+        ReadStderr();
+        int l = child_->ReadStdout(0,((char*)&status_buf_)+status_pos_,sizeof(status_buf_)-status_pos_);
         if(l == -1) { // child error or closed comm
           if(child_->Running()) {
             status_.commstatus = CommClosed;
           } else {
             status_.commstatus = CommExited;
-            if(child_->Result() != 0) {
+            if(worker_) {
+              // Pooled process must report end of transfer before exiting
+              logger_->msg(Arc::ERROR, "DataStagingDelivery exited with code %i before finishing transfer", child_->Result());
+              status_.commstatus = CommFailed;
+            } else if(child_->Result() != 0) {
               logger_->msg(Arc::ERROR, "DataStagingDelivery exited with code %i", child_->Result());
               status_.commstatus = CommFailed;
             }
           }
-          delete child_; child_=NULL; return;
+          StopChild(0); return;
         }
         if(l == 0) break;
         status_pos_+=l;
@@ -234,17 +464,28 @@ namespace DataStaging {
       }
       if(status_pos_ >= sizeof(status_buf_)) {
         status_buf_.error_desc[sizeof(status_buf_.error_desc)-1] = 0;
-        status_=status_buf_;
         status_pos_-=sizeof(status_buf_);
+        if(worker_ && ((status_buf_.commstatus == CommExited) ||
+                       (status_buf_.commstatus == CommFailed))) {
+          // End of transfer reported. Process may be used for another one.
+          status_.commstatus = status_buf_.commstatus;
+          if(status_.commstatus == CommFailed) {
+            logger_->msg(Arc::ERROR, "DataStagingDelivery reported failure of transfer");
+          }
+          ReadStderr();
+          DataDeliveryWorkerPool::Instance().Release(worker_);
+          worker_ = NULL;
+          child_ = NULL;
+          return;
+        }
+        status_=status_buf_;
       }
     }
     // check for stuck child process (no report through comm channel)
     Arc::Period t = Arc::Time() - last_comm;
     if (transfer_params.max_inactivity_time > 0 && t >= transfer_params.max_inactivity_time*2) {
       logger_->msg(Arc::ERROR, "Transfer killed after %i seconds without communication", t.GetPeriod());
-      child_->Kill(1);
-      delete child_;
-      child_ = NULL;
+      StopChild(1);
     }
   }
 
@@ -260,5 +501,13 @@ namespace DataStaging {
     return true;
   }
 
+  unsigned int DataDeliveryLocalComm::StartedProcesses() {
+    return DataDeliveryWorkerPool::Instance().StartedNum();
+  }
+
+  unsigned int DataDeliveryLocalComm::IdleProcesses() {
+    return DataDeliveryWorkerPool::Instance().IdleNum();
+  }
+
 
 } // namespace DataStaging
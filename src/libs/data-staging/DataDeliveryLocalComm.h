@@ -7,8 +7,18 @@
 
 namespace DataStaging {
 
+  class DataDeliveryWorker;
+
   /// This class starts, monitors and controls a local Delivery process.
   /**
+   * Transfers are normally passed to long-living DataStagingDelivery
+   * processes kept in a pool, separately for every local user. Such
+   * process is returned to the pool after transfer is finished and is
+   * reused by following transfers of the same user. If pool is disabled
+   * by setting environment variable ARC_DELIVERY_POOL_SIZE to 0 a new
+   * process is started for every transfer. ARC_DELIVERY_POOL_IDLE
+   * defines time in seconds for which idle processes are kept.
+   *
    * \ingroup datastaging
    * \headerfile DataDeliveryLocalComm.h arc/data-staging/DataDeliveryLocalComm.h
    */
@@ -26,6 +36,11 @@ namespace DataStaging {
     /// Returns "/" since local Delivery can access everywhere
     static bool CheckComm(DTR_ptr dtr, std::vector<std::string>& allowed_dirs, std::string& load_avg);
 
+    /// Returns number of DataStagingDelivery processes started so far
+    static unsigned int StartedProcesses();
+    /// Returns number of idle DataStagingDelivery processes kept in pool
+    static unsigned int IdleProcesses();
+
     /// Returns true if child process exists
     virtual operator bool() const { return (child_ != NULL); };
     /// Returns true if child process does not exist
@@ -34,12 +49,19 @@ namespace DataStaging {
   private:
     /// Child process
     Arc::Run* child_;
+    /// Pooled process running transfer, NULL if child_ is dedicated to this transfer
+    DataDeliveryWorker* worker_;
     /// Stdin of child, used to pass credentials
     std::string stdin_;
     /// Temporary credentails location
     std::string tmp_proxy_;
     /// Time last communication was received from child
     Arc::Time last_comm;
+
+    /// Logs messages child wrote to stderr
+    void ReadStderr();
+    /// Kills child process if kill_timeout is positive and forgets it
+    void StopChild(int kill_timeout);
   };
 
 } // namespace DataStaging
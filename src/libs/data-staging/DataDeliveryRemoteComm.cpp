@@ -2,18 +2,263 @@
 #include <config.h>
 #endif
 
+#include <map>
+
 #include <arc/message/SOAPEnvelope.h>
+#include <arc/communication/ClientPool.h>
 #include <arc/delegation/DelegationInterface.h>
 
 #include "DataDeliveryRemoteComm.h"
 
 namespace DataStaging {
 
+  // Longest time in seconds delivery service is asked to hold a query until
+  // one of transfers finishes. It is limited further by connection timeout.
+  static const int ChannelWait = 5;
+  // Time in seconds channel thread is kept after its last transfer ended
+  static const int ChannelIdleTimeout = 60;
+  // Transfers younger than this number of seconds are checked every second
+  // because short transfers are common
+  static const int ChannelYoungTransfer = 20;
+
+  // All transfers on one delivery service share a channel. Its thread sends
+  // one query for all of them over connection taken from ClientHTTPPool and
+  // passes results to transfers. Services which support it hold the query
+  // until some transfer finishes and only report transfers which state
+  // changed. For older services every transfer is queried separately like
+  // before. Service does not check identity of client querying transfers,
+  // so all queries use credentials of one transfer - host credentials if
+  // those are used for delivery. Only starting and cancelling transfers
+  // needs credentials of their owners.
+  class DataDeliveryRemoteChannel {
+  public:
+    /// Registers transfer with channel for its service. Returns NULL on failure.
+    static DataDeliveryRemoteChannel* Add(DataDeliveryRemoteComm* comm);
+    /// Unregisters transfer. After return comm is not accessed anymore.
+    void Remove(DataDeliveryRemoteComm* comm);
+  private:
+    DataDeliveryRemoteChannel(const std::string& key, const Arc::MCCConfig& cfg,
+                              const Arc::URL& endpoint, int timeout):
+      key_(key), cfg_(cfg), endpoint_(endpoint), timeout_(timeout), legacy_(false), renew_(false) {};
+    std::string key_;
+    // Credentials and timeout used for queries. Used by channel thread only.
+    Arc::MCCConfig cfg_;
+    Arc::URL endpoint_;
+    int timeout_;
+    // Service does not support changes-only replies. Used by channel thread only.
+    bool legacy_;
+    // Query failed and credentials are taken from one of transfers still
+    // registered, because those of transfer which created channel may be
+    // gone. Used by channel thread only.
+    bool renew_;
+    // Registered transfers by DTR ID
+    std::map<std::string, DataDeliveryRemoteComm*> comms_;
+    // Protects comms_. If channels_lock is needed too it must be
+    // taken first, transfer's own lock is always taken after this one.
+    Glib::Mutex lock_;
+    static void func(void* arg);
+    void run();
+    // Queries state of DTRs, passing known number of bytes transferred
+    // for each. Returns false if communication failed.
+    bool query(const std::map<std::string, unsigned long long int>& dtrs, int wait);
+  };
+
+  // Protects channels map only
+  static Glib::Mutex channels_lock;
+  // Never destroyed because channel threads may still run at exit
+  static std::map<std::string, DataDeliveryRemoteChannel*>* channels = NULL;
+
+  DataDeliveryRemoteChannel* DataDeliveryRemoteChannel::Add(DataDeliveryRemoteComm* comm) {
+    std::string key(comm->endpoint.str());
+    Glib::Mutex::Lock lock(channels_lock);
+    if (!channels) channels = new std::map<std::string, DataDeliveryRemoteChannel*>;
+    DataDeliveryRemoteChannel* channel = NULL;
+    std::map<std::string, DataDeliveryRemoteChannel*>::iterator c = channels->find(key);
+    if (c != channels->end()) {
+      channel = c->second;
+    } else {
+      channel = new DataDeliveryRemoteChannel(key, comm->cfg, comm->endpoint, comm->timeout);
+      if (!Arc::CreateThreadFunction(&func, channel)) {
+        delete channel;
+        return NULL;
+      }
+      (*channels)[key] = channel;
+    }
+    Glib::Mutex::Lock channel_lock(channel->lock_);
+    channel->comms_[comm->dtr_full_id] = comm;
+    return channel;
+  }
+
+  void DataDeliveryRemoteChannel::Remove(DataDeliveryRemoteComm* comm) {
+    Glib::Mutex::Lock lock(lock_);
+    std::map<std::string, DataDeliveryRemoteComm*>::iterator c = comms_.find(comm->dtr_full_id);
+    if ((c != comms_.end()) && (c->second == comm)) comms_.erase(c);
+  }
+
+  void DataDeliveryRemoteChannel::func(void* arg) {
+    // disconnect from root logger since messages are logged to per-DTR Logger
+    Arc::Logger::getRootLogger().setThreadContext();
+    Arc::Logger::getRootLogger().removeDestinations();
+    ((DataDeliveryRemoteChannel*)arg)->run();
+  }
+
+  void DataDeliveryRemoteChannel::run() {
+    Arc::Time idle_since;
+    for (;;) {
+      std::map<std::string, unsigned long long int> dtrs;
+      bool young = false;
+      {
+        Glib::Mutex::Lock lock(lock_);
+        Arc::Time now;
+        if (comms_.empty()) {
+          if ((now - idle_since).GetPeriod() >= ChannelIdleTimeout) {
+            // Check again with channels locked so that no transfer is added meanwhile
+            lock.release();
+            Glib::Mutex::Lock list_lock(channels_lock);
+            lock.acquire();
+            if (comms_.empty()) {
+              channels->erase(key_);
+              break;
+            }
+          }
+        } else {
+          idle_since = now;
+        }
+        if (renew_) {
+          for (std::map<std::string, DataDeliveryRemoteComm*>::iterator c = comms_.begin(); c != comms_.end(); ++c) {
+            Glib::Mutex::Lock comm_lock(c->second->lock_);
+            if (!c->second->valid) continue;
+            cfg_ = c->second->cfg;
+            timeout_ = c->second->timeout;
+            renew_ = false;
+            break;
+          }
+        }
+        for (std::map<std::string, DataDeliveryRemoteComm*>::iterator c = comms_.begin(); c != comms_.end(); ++c) {
+          DataDeliveryRemoteComm* comm = c->second;
+          Glib::Mutex::Lock comm_lock(comm->lock_);
+          // finished transfers only wait to be removed
+          if (!comm->valid) continue;
+          dtrs[c->first] = comm->status_.transferred;
+          if ((now - comm->start_).GetPeriod() < ChannelYoungTransfer) young = true;
+        }
+      }
+      if (dtrs.empty()) {
+        Glib::usleep(500000);
+        continue;
+      }
+      if (legacy_) {
+        // check every second for the first 20s and after every 5s
+        for (std::map<std::string, unsigned long long int>::iterator d = dtrs.begin(); d != dtrs.end(); ++d) {
+          std::map<std::string, unsigned long long int> dtr;
+          dtr.insert(*d);
+          if (!query(dtr, 0)) renew_ = true;
+        }
+        Glib::usleep(young ? 1000000 : 5000000);
+        continue;
+      }
+      int wait = young ? 0 : ChannelWait;
+      if ((timeout_ > 0) && (wait > timeout_/2)) wait = timeout_/2;
+      if (!query(dtrs, wait)) {
+        renew_ = true;
+        Glib::usleep(1000000);
+      } else if (wait <= 0) {
+        Glib::usleep(1000000);
+      }
+    }
+    delete this;
+  }
+
+  bool DataDeliveryRemoteChannel::query(const std::map<std::string, unsigned long long int>& dtrs, int wait) {
+    Arc::NS ns;
+    Arc::PayloadSOAP request(ns);
+    Arc::XMLNode op = request.NewChild("DataDeliveryQuery");
+    for (std::map<std::string, unsigned long long int>::const_iterator d = dtrs.begin(); d != dtrs.end(); ++d) {
+      Arc::XMLNode dtrnode = op.NewChild("DTR");
+      dtrnode.NewChild("ID") = d->first;
+      if (!legacy_) dtrnode.NewChild("BytesTransferred") = Arc::tostring(d->second);
+    }
+    if (!legacy_) op.NewChild("Wait") = Arc::tostring(wait);
+
+    Arc::ClientHTTPPool& pool = Arc::ClientHTTPPool::Instance();
+    Arc::ClientSOAP* client = pool.AcquireSOAP(cfg_, endpoint_, timeout_);
+    Arc::PayloadSOAP *response = NULL;
+    Arc::MCC_Status status = client->process(&request, &response);
+
+    std::string err;
+    if (!status) {
+      pool.Discard(client);
+      err = (std::string)status;
+    } else {
+      pool.Release(client);
+      if (!response) {
+        err = "No SOAP response from delivery service";
+      } else if (response->IsFault()) {
+        Arc::SOAPFault& fault = *response->Fault();
+        err = "Failed to query state: SOAP fault";
+        for (int n = 0;;++n) {
+          if (fault.Reason(n).empty()) break;
+          err += ": " + fault.Reason(n);
+        }
+      } else if (!(*response)["DataDeliveryQueryResponse"]["DataDeliveryQueryResult"]) {
+        err = "Bad format in XML response from delivery service";
+      }
+    }
+
+    if (!err.empty()) {
+      delete response;
+      Glib::Mutex::Lock lock(lock_);
+      for (std::map<std::string, unsigned long long int>::const_iterator d = dtrs.begin(); d != dtrs.end(); ++d) {
+        std::map<std::string, DataDeliveryRemoteComm*>::iterator c = comms_.find(d->first);
+        if (c == comms_.end()) continue;
+        Glib::Mutex::Lock comm_lock(c->second->lock_);
+        c->second->HandleQueryFault(err);
+      }
+      return false;
+    }
+
+    // Collect results before locking so that registering and removing
+    // transfers is not blocked while response is processed
+    Arc::XMLNode results = (*response)["DataDeliveryQueryResponse"]["DataDeliveryQueryResult"];
+    bool changes = (bool)results["Changes"];
+    if (!changes) legacy_ = true;
+    std::map<std::string, Arc::XMLNode> reported;
+    for (Arc::XMLNode result = results["Result"]; result; ++result) {
+      std::string id((std::string)result["ID"]);
+      if (dtrs.find(id) == dtrs.end()) continue;
+      reported[id] = result;
+    }
+
+    Glib::Mutex::Lock lock(lock_);
+    for (std::map<std::string, unsigned long long int>::const_iterator d = dtrs.begin(); d != dtrs.end(); ++d) {
+      std::map<std::string, DataDeliveryRemoteComm*>::iterator c = comms_.find(d->first);
+      if (c == comms_.end()) continue;
+      DataDeliveryRemoteComm* comm = c->second;
+      Glib::Mutex::Lock comm_lock(comm->lock_);
+      std::map<std::string, Arc::XMLNode>::iterator result = reported.find(d->first);
+      if (result == reported.end()) {
+        // Transfers not reported are still going on without change
+        if (changes) comm->status_.timestamp = time(NULL);
+        continue;
+      }
+      if (comm->logger_->isEnabled(Arc::DEBUG)) {
+        std::string xml;
+        result->second.GetXML(xml, true);
+        comm->logger_->msg(Arc::DEBUG, "Response:\n%s", xml);
+      }
+      // Fill status fields with results from service
+      comm->FillStatus(result->second);
+    }
+    lock.release();
+    delete response;
+    return true;
+  }
+
   Arc::Logger DataDeliveryRemoteComm::logger(Arc::Logger::getRootLogger(), "DataStaging.DataDeliveryRemoteComm");
 
   DataDeliveryRemoteComm::DataDeliveryRemoteComm(DTR_ptr dtr, const TransferParameters& params)
     : DataDeliveryComm(dtr, params),
-      client(NULL),
+      channel_(NULL),
       dtr_full_id(dtr->get_id()),
       query_retries(20),
       endpoint(dtr->get_delivery_endpoint()),
@@ -65,7 +310,8 @@ namespace DataStaging {
 
     // connect to service and make a new transfer request
     logger_->msg(Arc::VERBOSE, "Connecting to Delivery service at %s", endpoint.str());
-    client = new Arc::ClientSOAP(cfg, endpoint, timeout);
+    Arc::ClientHTTPPool& pool = Arc::ClientHTTPPool::Instance();
+    Arc::ClientSOAP* client = pool.AcquireSOAP(cfg, endpoint, timeout);
 
     Arc::NS ns;
     Arc::PayloadSOAP request(ns);
@@ -90,8 +336,9 @@ namespace DataStaging {
 
     // delegate credentials
     Arc::XMLNode op = request.Child(0);
-    if (!SetupDelegation(op, dtr->get_usercfg())) {
+    if (!SetupDelegation(*client, op, dtr->get_usercfg())) {
       logger_->msg(Arc::ERROR, "Failed to set up credential delegation with %s", endpoint.str());
+      pool.Discard(client);
       return;
     }
 
@@ -105,10 +352,12 @@ namespace DataStaging {
     if (!status) {
       logger_->msg(Arc::ERROR, "Could not connect to service %s: %s",
                    endpoint.str(), (std::string)status);
+      pool.Discard(client);
       if (response)
         delete response;
       return;
     }
+    pool.Release(client);
 
     if (!response) {
       logger_->msg(Arc::ERROR, "No SOAP response from Delivery service %s", endpoint.str());
@@ -149,20 +398,26 @@ namespace DataStaging {
 
     delete response;
     valid = true;
-    handler_->Add(this);
+    if (!RegisterQuery()) {
+      logger_->msg(Arc::ERROR, "Failed to start thread for querying delivery service at %s", endpoint.str());
+      CancelDTR();
+      valid = false;
+    }
+  }
+
+  bool DataDeliveryRemoteComm::RegisterQuery() {
+    channel_ = DataDeliveryRemoteChannel::Add(this);
+    return (channel_ != NULL);
   }
 
   DataDeliveryRemoteComm::~DataDeliveryRemoteComm() {
+    if (channel_) channel_->Remove(this);
     // If transfer is still going, send cancellation request to service
     if (valid) CancelDTR();
-    if (handler_) handler_->Remove(this);
-    Glib::Mutex::Lock lock(lock_);
-    delete client;
   }
 
   void DataDeliveryRemoteComm::CancelDTR() {
     Glib::Mutex::Lock lock(lock_);
-    if (!client) return;
     Arc::NS ns;
     Arc::PayloadSOAP request(ns);
     Arc::XMLNode dtrnode = request.NewChild("DataDeliveryCancel").NewChild("DTR");
@@ -175,14 +430,18 @@ namespace DataStaging {
 
     Arc::PayloadSOAP *response = NULL;
 
+    Arc::ClientHTTPPool& pool = Arc::ClientHTTPPool::Instance();
+    Arc::ClientSOAP* client = pool.AcquireSOAP(cfg, endpoint, timeout);
     Arc::MCC_Status status = client->process(&request, &response);
 
     if (!status) {
       logger_->msg(Arc::ERROR, "Failed to send cancel request: %s", (std::string)status);
+      pool.Discard(client);
       if (response)
         delete response;
       return;
     }
+    pool.Release(client);
 
     if (!response) {
       logger_->msg(Arc::ERROR, "Failed to cancel: No SOAP response");
@@ -219,85 +478,7 @@ namespace DataStaging {
   }
 
   void DataDeliveryRemoteComm::PullStatus() {
-    // send query request to service and fill status_
-    Glib::Mutex::Lock lock(lock_);
-    if (!client) return;
-
-    // check time since last query - check every second for the first 20s and
-    // after every 5s
-    // TODO be more intelligent, using transfer rate and file size
-    if (Arc::Time() - start_ < 20 && Arc::Time() - Arc::Time(status_.timestamp) < 1) return;
-    if (Arc::Time() - start_ > 20 && Arc::Time() - Arc::Time(status_.timestamp) < 5) return;
-
-    Arc::NS ns;
-    Arc::PayloadSOAP request(ns);
-    Arc::XMLNode dtrnode = request.NewChild("DataDeliveryQuery").NewChild("DTR");
-
-    dtrnode.NewChild("ID") = dtr_full_id;
-
-    std::string xml;
-    request.GetXML(xml, true);
-    logger_->msg(Arc::DEBUG, "Request:\n%s", xml);
-
-    Arc::PayloadSOAP *response = NULL;
-
-    Arc::MCC_Status status = client->process(&request, &response);
-
-    if (!status) {
-      logger_->msg(Arc::ERROR, "%s", (std::string)status);
-      status_.commstatus = CommFailed;
-      if (response)
-        delete response;
-      valid = false;
-      return;
-    }
-
-    if (!response) {
-      if (--query_retries > 0) {
-        HandleQueryFault("No SOAP response from delivery service");
-        return;
-      }
-      logger_->msg(Arc::ERROR, "No SOAP response from delivery service");
-      status_.commstatus = CommFailed;
-      valid = false;
-      return;
-    }
-
-    response->GetXML(xml, true);
-    logger_->msg(Arc::DEBUG, "Response:\n%s", xml);
-
-    if (response->IsFault()) {
-      Arc::SOAPFault& fault = *response->Fault();
-      std::string err("SOAP fault: %s", fault.Code());
-      for (int n = 0;;++n) {
-        if (fault.Reason(n).empty()) break;
-        err += ": " + fault.Reason(n);
-      }
-      delete response;
-      if (--query_retries > 0) {
-        HandleQueryFault("Failed to query state: " + err);
-        return;
-      }
-      logger_->msg(Arc::ERROR, "Failed to query state: %s", err);
-      status_.commstatus = CommFailed;
-      strncpy(status_.error_desc, "SOAP error in connection with delivery service", sizeof(status_.error_desc));
-      valid = false;
-      return;
-    }
-
-    Arc::XMLNode resultnode = (*response)["DataDeliveryQueryResponse"]["DataDeliveryQueryResult"]["Result"][0];
-    if (!resultnode || !resultnode["ResultCode"]) {
-      logger_->msg(Arc::ERROR, "Bad format in XML response: %s", xml);
-      delete response;
-      status_.commstatus = CommFailed;
-      valid = false;
-      return;
-    }
-
-    // Fill status fields with results from service
-    FillStatus(resultnode[0]);
-
-    delete response;
+    // Status is filled by DataDeliveryRemoteChannel when service reports it
   }
 
   bool DataDeliveryRemoteComm::CheckComm(DTR_ptr dtr, std::vector<std::string>& allowed_dirs, std::string& load_avg) {
@@ -314,7 +495,8 @@ namespace DataStaging {
 
     dtr->get_logger()->msg(Arc::VERBOSE, "Connecting to Delivery service at %s",
                            dtr->get_delivery_endpoint().str());
-    Arc::ClientSOAP client(cfg, dtr->get_delivery_endpoint(), dtr->get_usercfg().Timeout());
+    Arc::ClientHTTPPool& pool = Arc::ClientHTTPPool::Instance();
+    Arc::ClientSOAP* client = pool.AcquireSOAP(cfg, dtr->get_delivery_endpoint(), dtr->get_usercfg().Timeout());
 
     Arc::NS ns;
     Arc::PayloadSOAP request(ns);
@@ -326,15 +508,17 @@ namespace DataStaging {
     dtr->get_logger()->msg(Arc::DEBUG, "Request:\n%s", xml);
 
     Arc::PayloadSOAP *response = NULL;
-    Arc::MCC_Status status = client.process(&request, &response);
+    Arc::MCC_Status status = client->process(&request, &response);
 
     if (!status) {
       dtr->get_logger()->msg(Arc::ERROR, "Could not connect to service %s: %s",
                              dtr->get_delivery_endpoint().str(), (std::string)status);
+      pool.Discard(client);
       if (response)
         delete response;
       return false;
     }
+    pool.Release(client);
 
     if (!response) {
       dtr->get_logger()->msg(Arc::ERROR, "No SOAP response from Delivery service %s",
@@ -477,7 +661,7 @@ namespace DataStaging {
   }
 
 
-  bool DataDeliveryRemoteComm::SetupDelegation(Arc::XMLNode& op, const Arc::UserConfig& usercfg) {
+  bool DataDeliveryRemoteComm::SetupDelegation(Arc::ClientSOAP& client, Arc::XMLNode& op, const Arc::UserConfig& usercfg) {
     const std::string& cert = (!usercfg.ProxyPath().empty() ? usercfg.ProxyPath() : usercfg.CertificatePath());
     const std::string& key  = (!usercfg.ProxyPath().empty() ? usercfg.ProxyPath() : usercfg.KeyPath());
     const std::string& credentials = usercfg.CredentialString();
@@ -487,12 +671,12 @@ namespace DataStaging {
       return false;
     }
 
-    if(!client->Load()) {
+    if(!client.Load()) {
       logger_->msg(Arc::VERBOSE, "Failed to initiate client connection");
       return false;
     }
 
-    Arc::MCC* entry = client->GetEntry();
+    Arc::MCC* entry = client.GetEntry();
     if(!entry) {
       logger_->msg(Arc::VERBOSE, "Client connection has no entry point");
       return false;
@@ -503,7 +687,7 @@ namespace DataStaging {
     if (!credentials.empty()) deleg = new Arc::DelegationProviderSOAP(credentials);
     else deleg = new Arc::DelegationProviderSOAP(cert, key);
     logger_->msg(Arc::VERBOSE, "Initiating delegation procedure");
-    if (!deleg->DelegateCredentialsInit(*entry, &(client->GetContext()))) {
+    if (!deleg->DelegateCredentialsInit(*entry, &(client.GetContext()))) {
       logger_->msg(Arc::VERBOSE, "Failed to initiate delegation credentials");
       delete deleg;
       return false;
@@ -514,12 +698,17 @@ namespace DataStaging {
   }
 
   void DataDeliveryRemoteComm::HandleQueryFault(const std::string& err) {
-    // Just return without changing status
-    logger_->msg(Arc::WARNING, err);
-    status_.timestamp = time(NULL);
-    // A reconnect may be needed after losing connection
-    delete client;
-    client = new Arc::ClientSOAP(cfg, endpoint, timeout);
+    if (--query_retries > 0) {
+      // Just return without changing status. Failed connection was
+      // discarded so next query makes new one.
+      logger_->msg(Arc::WARNING, err);
+      status_.timestamp = time(NULL);
+      return;
+    }
+    logger_->msg(Arc::ERROR, err);
+    status_.commstatus = CommFailed;
+    strncpy(status_.error_desc, "Error in connection with delivery service", sizeof(status_.error_desc));
+    valid = false;
   }
 
 } // namespace DataStaging
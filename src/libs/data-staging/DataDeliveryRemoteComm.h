@@ -9,8 +9,16 @@
 
 namespace DataStaging {
 
+  class DataDeliveryRemoteChannel;
+
   /// This class contacts a remote service to make a Delivery request.
   /**
+   * Connections to the service are taken from Arc::ClientHTTPPool. Status
+   * of all transfers on the same service is obtained by a single thread
+   * which sends one query for all of them and waits for the service to
+   * report changes, instead of each transfer polling separately. Queries
+   * use one credential per service, credentials of transfer owner are
+   * only used to start and cancel transfer.
    * \ingroup datastaging
    * \headerfile DataDeliveryRemoteComm.h arc/data-staging/DataDeliveryRemoteComm.h
    */
@@ -21,7 +29,7 @@ namespace DataStaging {
     /// If transfer is still ongoing, sends a cancellation message to the service.
     virtual ~DataDeliveryRemoteComm();
 
-    /// Read status from service
+    /// Does nothing, status is updated when service reports changes
     virtual void PullStatus();
 
     /// Pings service to find allowed dirs
@@ -33,8 +41,10 @@ namespace DataStaging {
     virtual bool operator!() const { return !valid; };
 
   private:
-    /// Connection to service
-    Arc::ClientSOAP* client;
+    friend class DataDeliveryRemoteChannel;
+    friend class DataDeliveryRemoteCommTest;
+    /// Channel delivering status of this transfer
+    DataDeliveryRemoteChannel* channel_;
     /// Full DTR ID
     std::string dtr_full_id;
     /// Retries allowed after failing to query transfer status, so that a
@@ -56,14 +66,19 @@ namespace DataStaging {
     /// Cancel a DTR, by sending a cancel request to the service
     void CancelDTR();
 
+    /// Register transfer with channel querying its service. Returns false
+    /// if channel could not be started.
+    bool RegisterQuery();
+
     /// Fill Status object with data in node. If empty fields are initialised
     /// to default values.
     void FillStatus(const Arc::XMLNode& node = Arc::XMLNode());
 
     /// Set up delegation so the credentials can be used by the service
-    bool SetupDelegation(Arc::XMLNode& op, const Arc::UserConfig& usercfg);
+    bool SetupDelegation(Arc::ClientSOAP& client, Arc::XMLNode& op, const Arc::UserConfig& usercfg);
 
-    /// Handle a fault during query of service. Attempts to reconnect
+    /// Handle a fault during query of service. Transfer is marked as failed
+    /// when no retries are left.
     void HandleQueryFault(const std::string& err="");
 
   };
@@ -3,6 +3,9 @@
 #endif
 
 #include <iostream>
+#include <vector>
+#include <errno.h>
+#include <poll.h>
 #include <string.h>
 #include <signal.h>
 #include <unistd.h>
@@ -21,6 +24,9 @@ using namespace Arc;
 static Arc::Logger logger(Arc::Logger::getRootLogger(), "DataDelivery");
 static bool delivery_shutdown = false;
 static Arc::Time start_time;
+static DataStaging::DataDeliveryComm::Status status;
+static unsigned int status_pos = 0;
+static bool status_changed = true;
 
 static void sig_shutdown(int)
 {
@@ -36,10 +42,6 @@ static void ReportStatus(DataStaging::DTRStatus::DTRStatusType st,
                          unsigned long long int size,
                          Arc::Time transfer_start_time,
                          const std::string& checksum = "") {
-  static DataStaging::DataDeliveryComm::Status status;
-  static unsigned int status_pos = 0;
-  static bool status_changed = true;
-
   unsigned long long int transfer_time = 0;
   if (transfer_start_time != Arc::Time(0)) {
     Arc::Period p = Arc::Time() - transfer_start_time;
@@ -82,6 +84,35 @@ static void ReportStatus(DataStaging::DTRStatus::DTRStatusType st,
   };
 }
 
+static bool WriteAll(const char* buf, unsigned int size) {
+  while(size > 0) {
+    ssize_t l = ::write(STDOUT_FILENO,buf,size);
+    if(l == -1) {
+      if(errno == EINTR) continue;
+      return false;
+    };
+    buf += l;
+    size -= l;
+  };
+  return true;
+}
+
+// Tells parent that transfer is finished. Last reported status is
+// repeated with commstatus set to CommExited or CommFailed depending
+// on result - same what parent would conclude from exit code of process.
+static void ReportEnd(int result) {
+  if(status_pos != 0) {
+    WriteAll(((char*)&status)+status_pos,sizeof(status)-status_pos);
+    status_pos = 0;
+  };
+  status_changed = true;
+  DataStaging::DataDeliveryComm::Status end = status;
+  end.commstatus = (result == 0) ? DataStaging::DataDeliveryComm::CommExited
+                                 : DataStaging::DataDeliveryComm::CommFailed;
+  end.timestamp = ::time(NULL);
+  WriteAll((char*)&end,sizeof(end));
+}
+
 static unsigned long long int transfer_bytes = 0;
 
 static void ReportOngoingStatus(unsigned long long int bytes) {
@@ -106,20 +137,18 @@ static unsigned long long int GetFileSize(const DataPoint& source, const DataPoi
   return 0;
 }
 
-int main(int argc,char* argv[]) {
+static int Transfer(int argc,char* argv[],const std::string& proxy_cred) {
 
-  // log to stderr
-  Arc::Logger::getRootLogger().setThreshold(Arc::VERBOSE); //TODO: configurable
-  Arc::LogStream logcerr(std::cerr);
-  logcerr.setFormat(Arc::EmptyFormat);
-  Arc::Logger::getRootLogger().addDestination(logcerr);
+  start_time = Arc::Time();
+  transfer_bytes = 0;
 
   // Collecting parameters
   // --surl: source URL 
   // --durl: destination URL
   // --sopt: any URL option, credential - path to file storing credentials
   // --dopt: any URL option, credential - path to file storing credentials
-  // --topt: minspeed, minspeedtime, minavgspeed, maxinacttime, avgtime
+  // --topt: minspeed, minspeedtime, minavgspeed, maxinacttime, avgtime,
+  //         bufsize, bufnum
   // --size: total size of data to be transferred
   // --cstype: checksum type to calculate
   // --csvalue: checksum value of source file to validate against
@@ -202,6 +231,9 @@ int main(int argc,char* argv[]) {
   buffer.speed.verbose(true);
   unsigned long long int minspeed = 0;
   time_t minspeedtime = 0;
+  // size and number of buffers are adjusted to size of data if not specified
+  unsigned int bufsize = 0;
+  int bufnum = 0;
   for(std::list<std::string>::iterator o = transfer_opts.begin();
                            o != transfer_opts.end();++o) {
     std::string::size_type p = o->find('=');
@@ -219,9 +251,13 @@ int main(int argc,char* argv[]) {
           buffer.speed.set_max_inactivity_time(value);
         } else if(name == "avgtime") {
           buffer.speed.set_base(value);
+        } else if(name == "bufsize") {
+          bufsize=value;
+        } else if(name == "bufnum") {
+          bufnum=value;
         } else {
           logger.msg(ERROR, "Unknown transfer option: %s", name);
-          _exit(-1);
+          return -1;
         }
       };
     };
@@ -233,10 +269,6 @@ int main(int argc,char* argv[]) {
   CheckSumAny crc_source;
   CheckSumAny crc_dest;
 
-  // Read credential from stdin if available
-  std::string proxy_cred;
-  std::getline(std::cin, proxy_cred, '\0');
-
   initializeCredentialsType source_cred(initializeCredentialsType::SkipCredentials);
   UserConfig source_cfg(source_cred);
   if(!source_cred_path.empty()) source_cfg.ProxyPath(source_cred_path);
@@ -246,12 +278,11 @@ int main(int argc,char* argv[]) {
   DataHandle source(source_url, source_cfg);
   if(!source) {
     logger.msg(ERROR, "Source URL not supported: %s", source_url.str());
-    _exit(-1);
-    //return -1;
+    return -1;
   };
   if (source->RequiresCredentialsInFile() && source_cred_path.empty()) {
     logger.msg(ERROR, "No credentials supplied");
-    _exit(-1);
+    return -1;
   }
 
   source->SetSecure(false);
@@ -265,12 +296,11 @@ int main(int argc,char* argv[]) {
   DataHandle dest(dest_url,dest_cfg);
   if(!dest) {
     logger.msg(ERROR, "Destination URL not supported: %s", dest_url.str());
-    _exit(-1);
-    //return -1;
+    return -1;
   };
   if (dest->RequiresCredentialsInFile() && dest_cred_path.empty()) {
     logger.msg(ERROR, "No credentials supplied");
-    _exit(-1);
+    return -1;
   }
   dest->SetSecure(false);
   dest->Passive(true);
@@ -317,17 +347,27 @@ int main(int argc,char* argv[]) {
     source->AddCheckSumObject(&crc_source);
     dest->AddCheckSumObject(&crc_dest);
   }
-  buffer.set(&crc);
 
+  unsigned long long int total_size = 0;
   if (!size.empty()) {
-    unsigned long long int total_size;
     if (stringto(size, total_size)) {
       dest->SetSize(total_size);
     } else {
+      total_size = 0;
       logger.msg(WARNING, "Cannot use supplied --size option");
     }
   }
 
+  if ((bufsize == 0) || (bufnum <= 0)) {
+    unsigned int tuned_size = 1048576;
+    int tuned_num = 3;
+    DataBuffer::tune(total_size, tuned_size, tuned_num);
+    if (bufsize == 0) bufsize = tuned_size;
+    if (bufnum <= 0) bufnum = tuned_num;
+  }
+  logger.msg(VERBOSE, "Using %i buffers of size %u", bufnum, bufsize);
+  buffer.set(&crc, bufsize, bufnum);
+
   bool reported = false;
   bool eof_reached = false;
   // checksum validation against supplied value
@@ -396,8 +436,7 @@ int main(int argc,char* argv[]) {
                    std::string("Failed reading from source: ")+source->CurrentLocation().str()+
                     " : "+std::string(source_st),
                    0,0,0);
-      _exit(-1);
-      //return -1;
+      return -1;
     };
     dest_st = dest->StartWriting(buffer);
     if(!dest_st) {
@@ -410,8 +449,7 @@ int main(int argc,char* argv[]) {
                    std::string("Failed writing to destination: ")+dest->CurrentLocation().str()+
                     " : "+std::string(dest_st),
                    0,0,0);
-      _exit(-1);
-      //return -1;
+      return -1;
     }
     // While transfer is running in another threads
     // here we periodically report status to parent
@@ -438,7 +476,7 @@ int main(int argc,char* argv[]) {
                  buffer.speed.transferred_size(),
                  GetFileSize(*source,*dest),0);
     dest->StopWriting();
-    _exit(-1);
+    return -1;
   }
   ReportStatus(DataStaging::DTRStatus::TRANSFERRING,
                DataStaging::DTRErrorStatus::NONE_ERROR,
@@ -567,7 +605,69 @@ int main(int argc,char* argv[]) {
                  start_time,
                  calc_csum);
   };
-  _exit(eof_reached?0:1);
-  //return eof_reached?0:1;
+  return eof_reached?0:1;
+}
+
+// Performs transfers requested through stdin one after another. Every
+// request consists of null-terminated command line arguments followed by
+// empty string and null-terminated credentials (may be empty). Same
+// status reports as for single transfer are sent to stdout followed by
+// ReportEnd(). Exits if stdin is closed, on signal or after idle_timeout
+// seconds without request.
+static int Worker(char* name,int idle_timeout) {
+  signal(SIGTERM, sig_shutdown);
+  signal(SIGINT, sig_shutdown);
+  while(!delivery_shutdown) {
+    if((idle_timeout > 0) && (std::cin.rdbuf()->in_avail() <= 0)) {
+      pollfd fd;
+      fd.fd = STDIN_FILENO; fd.events = POLLIN; fd.revents = 0;
+      int err = ::poll(&fd,1,idle_timeout*1000);
+      if((err < 0) && (errno == EINTR)) continue;
+      if(err <= 0) break;
+    };
+    std::list<std::string> args;
+    std::string arg;
+    while(std::getline(std::cin,arg,'\0') && !arg.empty()) args.push_back(arg);
+    std::string proxy_cred;
+    std::getline(std::cin,proxy_cred,'\0');
+    if(!std::cin) break; // parent closed pipe
+    std::vector<char*> argv;
+    argv.push_back(name);
+    for(std::list<std::string>::iterator a = args.begin(); a != args.end(); ++a) {
+      argv.push_back(const_cast<char*>(a->c_str()));
+    };
+    argv.push_back(NULL);
+    // OptionParser uses getopt which keeps its state between calls
+    optind = 0;
+    // Variables for 3rd party tools are set per transfer
+    UnsetEnv("X509_USER_PROXY");
+    UnsetEnv("X509_CERT_DIR");
+    UnsetEnv("X509_USER_CERT");
+    UnsetEnv("X509_USER_KEY");
+    ReportEnd(Transfer(argv.size()-1,&argv[0],proxy_cred));
+  };
+  return 0;
+}
+
+int main(int argc,char* argv[]) {
+
+  // log to stderr
+  Arc::Logger::getRootLogger().setThreshold(Arc::VERBOSE); //TODO: configurable
+  Arc::LogStream logcerr(std::cerr);
+  logcerr.setFormat(Arc::EmptyFormat);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+
+  // --worker idle_timeout: process many transfers passed through stdin
+  if((argc == 3) && (std::string(argv[1]) == "--worker")) {
+    int idle_timeout = 0;
+    stringto(std::string(argv[2]),idle_timeout);
+    _exit(Worker(argv[0],idle_timeout));
+  };
+
+  // Read credential from stdin if available
+  std::string proxy_cred;
+  std::getline(std::cin, proxy_cred, '\0');
+
+  _exit(Transfer(argc,argv,proxy_cred));
 }
 
@@ -16,6 +16,8 @@ namespace DataStaging {
 
   std::string Processor::hostname;
 
+  Arc::Logger Processor::logger(Arc::Logger::getRootLogger(), "DataStaging.Processor");
+
   /** Set up logging. Should be called at the start of each thread method. */
   void setUpLogger(DTR_ptr request) {
     // Move DTR destinations from DTR logger to Root logger to catch all messages.
@@ -27,7 +29,8 @@ namespace DataStaging {
     request->get_logger()->removeDestinations();
   }
 
-  Processor::Processor() {
+  // Waiting for threads is bounded by stop(), queue itself does not wait
+  Processor::Processor(): threads("DTR processor", 0, 0) {
     // Get hostname, needed to exclude ACIX replicas on localhost
     char hostn[256];
     if (gethostname(hostn, sizeof(hostn)) == 0){
@@ -815,51 +818,51 @@ namespace DataStaging {
 
       case DTRStatus::CHECK_CACHE: {
         request->set_status(DTRStatus::CHECKING_CACHE);
-        Arc::CreateThreadFunction(&DTRCheckCache, (void*)arg, &thread_count);
+        threads.Add(&DTRCheckCache, (void*)arg, &thread_count);
       }; break;
 
       case DTRStatus::RESOLVE: {
         request->set_status(DTRStatus::RESOLVING);
-        if (bulk_arg) Arc::CreateThreadFunction(&DTRBulkResolve, (void*)bulk_arg, &thread_count);
-        else if (arg) Arc::CreateThreadFunction(&DTRResolve, (void*)arg, &thread_count);
+        if (bulk_arg) threads.Add(&DTRBulkResolve, (void*)bulk_arg, &thread_count);
+        else if (arg) threads.Add(&DTRResolve, (void*)arg, &thread_count);
       }; break;
 
       case DTRStatus::QUERY_REPLICA: {
         request->set_status(DTRStatus::QUERYING_REPLICA);
-        if (bulk_arg) Arc::CreateThreadFunction(&DTRBulkQueryReplica, (void*)bulk_arg, &thread_count);
-        else if (arg) Arc::CreateThreadFunction(&DTRQueryReplica, (void*)arg, &thread_count);
+        if (bulk_arg) threads.Add(&DTRBulkQueryReplica, (void*)bulk_arg, &thread_count);
+        else if (arg) threads.Add(&DTRQueryReplica, (void*)arg, &thread_count);
       }; break;
 
       case DTRStatus::PRE_CLEAN: {
         request->set_status(DTRStatus::PRE_CLEANING);
-        Arc::CreateThreadFunction(&DTRPreClean, (void*)arg, &thread_count);
+        threads.Add(&DTRPreClean, (void*)arg, &thread_count);
       }; break;
 
       case DTRStatus::STAGE_PREPARE: {
         request->set_status(DTRStatus::STAGING_PREPARING);
-        Arc::CreateThreadFunction(&DTRStagePrepare, (void*)arg, &thread_count);
+        threads.Add(&DTRStagePrepare, (void*)arg, &thread_count);
       }; break;
 
       // post-processor states
 
       case DTRStatus::RELEASE_REQUEST: {
         request->set_status(DTRStatus::RELEASING_REQUEST);
-        Arc::CreateThreadFunction(&DTRReleaseRequest, (void*)arg, &thread_count);
+        threads.Add(&DTRReleaseRequest, (void*)arg, &thread_count);
       }; break;
 
       case DTRStatus::FINALISE_REPLICA: {
         request->set_status(DTRStatus::FINALISING_REPLICA);
-        Arc::CreateThreadFunction(&DTRFinaliseReplica, (void*)arg, &thread_count);
+        threads.Add(&DTRFinaliseReplica, (void*)arg, &thread_count);
       }; break;
 
       case DTRStatus::REGISTER_REPLICA: {
         request->set_status(DTRStatus::REGISTERING_REPLICA);
-        Arc::CreateThreadFunction(&DTRRegisterReplica, (void*)arg, &thread_count);
+        threads.Add(&DTRRegisterReplica, (void*)arg, &thread_count);
       }; break;
 
       case DTRStatus::PROCESS_CACHE: {
         request->set_status(DTRStatus::PROCESSING_CACHE);
-        Arc::CreateThreadFunction(&DTRProcessCache, (void*)arg, &thread_count);
+        threads.Add(&DTRProcessCache, (void*)arg, &thread_count);
       }; break;
 
       default: {
@@ -877,9 +880,15 @@ namespace DataStaging {
   void Processor::start(void) {
   }
 
+  void Processor::SetMaxThreads(int max_threads) {
+    threads.MaxRunning(max_threads);
+  }
+
   void Processor::stop(void) {
     // threads are short lived so wait for them to complete rather than interrupting
     thread_count.wait(60*1000);
+    logger.msg(Arc::VERBOSE, "Processor queue: maximum %i waiting, average wait %llu us",
+               threads.MaxQueued(), threads.AverageWait());
   }
 
 } // namespace DataStaging
@@ -2,6 +2,7 @@
 #define PROCESSOR_H_
 
 #include <arc/Logger.h>
+#include <arc/Thread.h>
 
 #include "DTR.h"
 
@@ -10,8 +11,10 @@ namespace DataStaging {
   /// The Processor performs pre- and post-transfer operations.
   /**
    * The Processor takes care of everything that should happen before
-   * and after a transfer takes place. Calling receiveDTR() spawns a
-   * thread to perform the required operation depending on the DTR state.
+   * and after a transfer takes place. Calling receiveDTR() submits the
+   * required operation depending on the DTR state to the Processor's own
+   * queue of worker threads, which limits the number of concurrently running
+   * operations.
    * \ingroup datastaging
    * \headerfile Processor.h arc/data-staging/Processor.h
    */
@@ -43,6 +46,9 @@ namespace DataStaging {
     /// Counter of active threads
     Arc::SimpleCounter thread_count;
 
+    /// Queue through which operations are run in worker threads
+    Arc::ThreadQueue threads;
+
     /// List of DTRs to be processed in bulk. Filled between receiveDTR
     /// receiving a DTR with bulk_start on and receiving one with bulk_end on.
     /// It is up to the caller to make sure that all the requests are suitable
@@ -52,6 +58,9 @@ namespace DataStaging {
     /// Our hostname
     static std::string hostname;
 
+    /// Logger object
+    static Arc::Logger logger;
+
     /* Thread methods which deal with each state */
     /// Check the cache to see if the file already exists
     static void DTRCheckCache(void* arg);
@@ -91,6 +100,12 @@ namespace DataStaging {
      */
     void start(void);
 
+    /// Set limit of concurrently running operations, 0 means no limit.
+    /**
+     * Further operations wait in queue until one of running ones finishes.
+     */
+    void SetMaxThreads(int max_threads);
+
     /// Stop Processor.
     /**
      * This method sends waits for all started threads to end and exits. Since
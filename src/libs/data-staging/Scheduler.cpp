@@ -9,6 +9,7 @@
 
 #include <arc/FileUtils.h>
 #include <arc/Utils.h>
+#include <arc/communication/ClientPool.h>
 
 #include "Scheduler.h"
 #include "DataDeliveryRemoteComm.h"
@@ -100,6 +101,9 @@ namespace DataStaging {
     scheduler_state = RUNNING;
     state_lock.unlock();
 
+    // Number of DTRs in processor stages is limited by slots, processor
+    // threads are limited to same number in case DTRs come from elsewhere
+    processor.SetMaxThreads(PreProcessorSlots + PostProcessorSlots + 2*EmergencySlots);
     processor.start();
     delivery.start();
     // if no delivery services set, then use local
@@ -377,7 +381,7 @@ namespace DataStaging {
         request->get_logger()->msg(Arc::INFO, "No more replicas, will use %s", request->get_source()->CurrentLocation().str());
       } else {
         request->get_source()->NextLocation();
-        request->get_logger()->msg(Arc::VERBOSE, "Checking replica %s", request->get_source()->CurrentLocation().str());
+        LOG(*request->get_logger(), Arc::VERBOSE, "Checking replica %s", request->get_source()->CurrentLocation().str());
         request->set_status(DTRStatus::QUERY_REPLICA);
         return;
       }
@@ -883,7 +887,7 @@ namespace DataStaging {
           if ((request->get_cache_state() == CACHEABLE) && !request->get_cache_file().empty()) dest = request->get_cache_file();
 
           if (dest.find(*dir) == 0) {
-            request->get_logger()->msg(Arc::DEBUG, "Delivery service at %s can copy to %s", service->first.str(), *dir);
+            LOG(*request->get_logger(), Arc::DEBUG, "Delivery service at %s can copy to %s", service->first.str(), *dir);
             possible_delivery_services.push_back(service->first);
             break;
           }
@@ -891,7 +895,7 @@ namespace DataStaging {
         else if (request->get_source()->Local()) {
 
           if (request->get_source()->TransferLocations()[0].Path().find(*dir) == 0) {
-            request->get_logger()->msg(Arc::DEBUG, "Delivery service at %s can copy from %s", service->first.str(), *dir);
+            LOG(*request->get_logger(), Arc::DEBUG, "Delivery service at %s can copy from %s", service->first.str(), *dir);
             possible_delivery_services.push_back(service->first);
             break;
           }
@@ -920,7 +924,7 @@ namespace DataStaging {
     for (std::vector<Arc::URL>::iterator possible = possible_delivery_services.begin();
          possible != possible_delivery_services.end();) {
       if (delivery_hosts[possible->Host()] > (int)(DeliverySlots/configured_delivery_services.size())) {
-        request->get_logger()->msg(Arc::DEBUG, "Not using delivery service at %s because it is full", possible->str());
+        LOG(*request->get_logger(), Arc::DEBUG, "Not using delivery service at %s because it is full", possible->str());
         possible = possible_delivery_services.erase(possible);
       } else {
         ++possible;
@@ -1048,8 +1052,8 @@ namespace DataStaging {
     // Go through "to process" states, work out shares and push DTRs
     for (unsigned int i = 0; i < DTRStatus::ToProcessStates.size(); ++i) {
 
-      std::list<DTR_ptr> DTRQueue = DTRQueueStates[DTRStatus::ToProcessStates.at(i)];
-      std::list<DTR_ptr> ActiveDTRs = DTRRunningStates[DTRStatus::ProcessingStates.at(i)];
+      std::list<DTR_ptr>& DTRQueue = DTRQueueStates[DTRStatus::ToProcessStates.at(i)];
+      std::list<DTR_ptr>& ActiveDTRs = DTRRunningStates[DTRStatus::ProcessingStates.at(i)];
 
       if (DTRQueue.empty() && ActiveDTRs.empty()) continue;
 
@@ -1059,9 +1063,8 @@ namespace DataStaging {
       // Transfer shares for this queue
       TransferShares transferShares(transferSharesConf);
 
-      // Sort the DTR queue according to the priorities the DTRs have.
-      // Highest priority will be at the beginning of the list.
-      DTRQueue.sort(dtr_sort_predicate);
+      // The DTR queue comes from DTRList already sorted according to the
+      // priorities the DTRs have. Highest priority is at the beginning.
 
       int highest_priority = 0;
 
@@ -1368,6 +1371,9 @@ namespace DataStaging {
     run_signal.wait();
     scheduler_state = STOPPED;
 
+    // close connections to remote delivery services
+    Arc::ClientHTTPPool::Instance().Clear();
+
     state_lock.unlock();
     return true;
   }
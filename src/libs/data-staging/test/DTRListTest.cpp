@@ -0,0 +1,167 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <arc/StringConv.h>
+
+#include "../DTRList.h"
+
+using namespace DataStaging;
+
+class DTRListTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(DTRListTest);
+  CPPUNIT_TEST(TestStatusQueues);
+  CPPUNIT_TEST(TestPriorityOrder);
+  CPPUNIT_TEST(TestJobs);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void TestStatusQueues();
+  void TestPriorityOrder();
+  void TestJobs();
+
+  void setUp();
+  void tearDown();
+
+private:
+  DTR_ptr makeDTR(const std::string& jobid, int priority);
+  std::list<DTRLogDestination> logs;
+  char const * log_name;
+  Arc::UserConfig cfg;
+  int dtr_num;
+};
+
+void DTRListTest::setUp() {
+  logs.clear();
+  const std::list<Arc::LogDestination*>& destinations = Arc::Logger::getRootLogger().getDestinations();
+  for(std::list<Arc::LogDestination*>::const_iterator dest = destinations.begin(); dest != destinations.end(); ++dest) {
+    logs.push_back(*dest);
+  }
+  log_name = "DataStagingTest";
+  dtr_num = 0;
+}
+
+void DTRListTest::tearDown() {
+}
+
+DTR_ptr DTRListTest::makeDTR(const std::string& jobid, int priority) {
+  std::string num(Arc::tostring(++dtr_num));
+  DTR_ptr dtr(new DTR("mock://mocksrc/" + num, "mock://mockdest/" + num, cfg, jobid, Arc::User().get_uid(), logs, log_name));
+  CPPUNIT_ASSERT(*dtr);
+  dtr->set_priority(priority);
+  return dtr;
+}
+
+void DTRListTest::TestStatusQueues() {
+  DTRList list;
+  DTR_ptr dtr1 = makeDTR("1", 50);
+  DTR_ptr dtr2 = makeDTR("1", 50);
+  CPPUNIT_ASSERT(list.add_dtr(dtr1));
+  CPPUNIT_ASSERT(list.add_dtr(dtr2));
+  CPPUNIT_ASSERT_EQUAL(2u, list.size());
+
+  std::list<DTR_ptr> dtrs;
+  CPPUNIT_ASSERT(list.filter_dtrs_by_status(DTRStatus::NEW, dtrs));
+  CPPUNIT_ASSERT_EQUAL(2, (int)dtrs.size());
+
+  // Status changes made through DTR are followed by list
+  dtr1->set_status(DTRStatus::TRANSFER);
+  dtrs.clear();
+  CPPUNIT_ASSERT(list.filter_dtrs_by_status(DTRStatus::NEW, dtrs));
+  CPPUNIT_ASSERT_EQUAL(1, (int)dtrs.size());
+  CPPUNIT_ASSERT_EQUAL(dtr2->get_id(), dtrs.front()->get_id());
+  dtrs.clear();
+  CPPUNIT_ASSERT(list.filter_dtrs_by_status(DTRStatus::TRANSFER, dtrs));
+  CPPUNIT_ASSERT_EQUAL(1, (int)dtrs.size());
+  CPPUNIT_ASSERT_EQUAL(dtr1->get_id(), dtrs.front()->get_id());
+
+  std::map<DTRStatus::DTRStatusType, std::list<DTR_ptr> > queues;
+  CPPUNIT_ASSERT(list.filter_dtrs_by_statuses(DTRStatus::ToProcessStates, queues));
+  CPPUNIT_ASSERT_EQUAL(1, (int)queues[DTRStatus::TRANSFER].size());
+  CPPUNIT_ASSERT(queues[DTRStatus::CHECK_CACHE].empty());
+
+  // Deleted DTR is not followed anymore
+  CPPUNIT_ASSERT(list.delete_dtr(dtr1));
+  dtr1->set_status(DTRStatus::NEW);
+  dtrs.clear();
+  CPPUNIT_ASSERT(list.filter_dtrs_by_status(DTRStatus::NEW, dtrs));
+  CPPUNIT_ASSERT_EQUAL(1, (int)dtrs.size());
+  CPPUNIT_ASSERT_EQUAL(1u, list.size());
+  CPPUNIT_ASSERT(list.delete_dtr(dtr2));
+  CPPUNIT_ASSERT(list.empty());
+}
+
+void DTRListTest::TestPriorityOrder() {
+  DTRList list;
+  DTR_ptr low = makeDTR("1", 10);
+  DTR_ptr high = makeDTR("1", 90);
+  DTR_ptr low2 = makeDTR("1", 10);
+  list.add_dtr(low);
+  list.add_dtr(high);
+  list.add_dtr(low2);
+
+  // Highest priority first, then order of arrival
+  std::list<DTR_ptr> dtrs;
+  list.filter_dtrs_by_status(DTRStatus::NEW, dtrs);
+  CPPUNIT_ASSERT_EQUAL(3, (int)dtrs.size());
+  std::list<DTR_ptr>::iterator dtr = dtrs.begin();
+  CPPUNIT_ASSERT_EQUAL(high->get_id(), (*dtr)->get_id()); ++dtr;
+  CPPUNIT_ASSERT_EQUAL(low->get_id(), (*dtr)->get_id()); ++dtr;
+  CPPUNIT_ASSERT_EQUAL(low2->get_id(), (*dtr)->get_id());
+
+  // Priority change reorders queue
+  low2->set_priority(100);
+  dtrs.clear();
+  list.filter_dtrs_by_status(DTRStatus::NEW, dtrs);
+  CPPUNIT_ASSERT_EQUAL(low2->get_id(), dtrs.front()->get_id());
+  CPPUNIT_ASSERT_EQUAL(low->get_id(), dtrs.back()->get_id());
+
+  // Several statuses are merged keeping the order
+  high->set_status(DTRStatus::TRANSFER);
+  std::vector<DTRStatus::DTRStatusType> statuses;
+  statuses.push_back(DTRStatus::NEW);
+  statuses.push_back(DTRStatus::TRANSFER);
+  dtrs.clear();
+  list.filter_dtrs_by_statuses(statuses, dtrs);
+  CPPUNIT_ASSERT_EQUAL(3, (int)dtrs.size());
+  dtr = dtrs.begin();
+  CPPUNIT_ASSERT_EQUAL(low2->get_id(), (*dtr)->get_id()); ++dtr;
+  CPPUNIT_ASSERT_EQUAL(high->get_id(), (*dtr)->get_id()); ++dtr;
+  CPPUNIT_ASSERT_EQUAL(low->get_id(), (*dtr)->get_id());
+
+  list.delete_dtr(low);
+  list.delete_dtr(high);
+  list.delete_dtr(low2);
+}
+
+void DTRListTest::TestJobs() {
+  DTRList list;
+  DTR_ptr dtr1 = makeDTR("1", 50);
+  DTR_ptr dtr2 = makeDTR("2", 50);
+  DTR_ptr dtr3 = makeDTR("1", 50);
+  list.add_dtr(dtr1);
+  list.add_dtr(dtr2);
+  list.add_dtr(dtr3);
+
+  std::list<DTR_ptr> dtrs;
+  list.filter_dtrs_by_job("1", dtrs);
+  CPPUNIT_ASSERT_EQUAL(2, (int)dtrs.size());
+  CPPUNIT_ASSERT_EQUAL(dtr1->get_id(), dtrs.front()->get_id());
+  CPPUNIT_ASSERT_EQUAL(dtr3->get_id(), dtrs.back()->get_id());
+  CPPUNIT_ASSERT_EQUAL(2, (int)list.all_jobs().size());
+
+  list.delete_dtr(dtr2);
+  CPPUNIT_ASSERT_EQUAL(1, (int)list.all_jobs().size());
+  dtrs.clear();
+  list.filter_dtrs_by_job("2", dtrs);
+  CPPUNIT_ASSERT(dtrs.empty());
+
+  list.delete_dtr(dtr1);
+  list.delete_dtr(dtr3);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DTRListTest);
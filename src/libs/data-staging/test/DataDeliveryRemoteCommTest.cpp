@@ -0,0 +1,256 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string>
+#include <list>
+#include <set>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arc/StringConv.h>
+#include <arc/Thread.h>
+#include <arc/UserConfig.h>
+#include <arc/XMLNode.h>
+#include <arc/communication/ClientPool.h>
+
+#include "../DataDeliveryRemoteComm.h"
+
+// Minimal HTTP server answering queries like delivery service does.
+// Transfers with IDs listed in finished are reported as done, others
+// are not reported which means no changes.
+class DeliveryServer {
+ public:
+  DeliveryServer(): sock(-1), port(0), queries(0), max_ids(0) {
+    sock = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if ((::bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) || (::listen(sock, 4) != 0)) {
+      ::close(sock);
+      sock = -1;
+      return;
+    }
+    socklen_t addrlen = sizeof(addr);
+    ::getsockname(sock, (struct sockaddr*)&addr, &addrlen);
+    port = ntohs(addr.sin_port);
+    Arc::CreateThreadFunction(&listen, this, &done);
+  }
+  ~DeliveryServer() {
+    if (sock != -1) ::shutdown(sock, SHUT_RDWR);
+    {
+      Glib::Mutex::Lock l(lock);
+      for (std::set<int>::iterator h = handles.begin(); h != handles.end(); ++h) ::shutdown(*h, SHUT_RDWR);
+    }
+    done.wait();
+    if (sock != -1) ::close(sock);
+  }
+  void Finish(const std::string& id) {
+    Glib::Mutex::Lock l(lock);
+    finished.insert(id);
+  }
+  int Queries() {
+    Glib::Mutex::Lock l(lock);
+    return queries;
+  }
+  int MaxIDs() {
+    Glib::Mutex::Lock l(lock);
+    return max_ids;
+  }
+  int sock;
+  int port;
+
+ private:
+  Glib::Mutex lock;
+  std::set<std::string> finished;
+  std::set<int> handles;
+  int queries;
+  int max_ids;
+  Arc::SimpleCounter done;
+  struct Connection {
+    DeliveryServer* server;
+    int handle;
+  };
+  static void listen(void* arg) {
+    DeliveryServer& it = *reinterpret_cast<DeliveryServer*>(arg);
+    for (;;) {
+      int h = ::accept(it.sock, NULL, NULL);
+      if (h == -1) return;
+      Connection* conn = new Connection;
+      conn->server = &it;
+      conn->handle = h;
+      {
+        Glib::Mutex::Lock l(it.lock);
+        it.handles.insert(h);
+      }
+      if (!Arc::CreateThreadFunction(&serve, conn, &it.done)) {
+        {
+          Glib::Mutex::Lock l(it.lock);
+          it.handles.erase(h);
+        }
+        ::close(h);
+        delete conn;
+      }
+    }
+  }
+  static void serve(void* arg) {
+    Connection* conn = reinterpret_cast<Connection*>(arg);
+    conn->server->handle(conn->handle);
+    {
+      Glib::Mutex::Lock l(conn->server->lock);
+      conn->server->handles.erase(conn->handle);
+    }
+    ::close(conn->handle);
+    delete conn;
+  }
+  void handle(int h) {
+    std::string buf;
+    for (;;) {
+      std::string::size_type hend;
+      while ((hend = buf.find("\r\n\r\n")) == std::string::npos) {
+        if (!read_more(h, buf)) return;
+      }
+      std::string header = Arc::lower(buf.substr(0, hend));
+      buf.erase(0, hend + 4);
+      std::string::size_type lpos = header.find("content-length:");
+      unsigned int length = 0;
+      if (lpos != std::string::npos) length = atoi(header.c_str() + lpos + 15);
+      while (buf.length() < length) {
+        if (!read_more(h, buf)) return;
+      }
+      Arc::XMLNode request(buf.substr(0, length));
+      buf.erase(0, length);
+      Arc::XMLNode query = request["Body"]["DataDeliveryQuery"];
+      std::string body = "<soap-env:Envelope xmlns:soap-env=\"http://schemas.xmlsoap.org/soap/envelope/\">"
+                         "<soap-env:Body><DataDeliveryQueryResponse><DataDeliveryQueryResult>"
+                         "<Changes>true</Changes>";
+      {
+        Glib::Mutex::Lock l(lock);
+        ++queries;
+        int ids = 0;
+        for (Arc::XMLNode dtr = query["DTR"]; (bool)dtr; ++dtr) {
+          ++ids;
+          std::string id = (std::string)dtr["ID"];
+          if (finished.find(id) == finished.end()) continue;
+          body += "<Result><ID>" + id + "</ID><ResultCode>TRANSFERRED</ResultCode>"
+                  "<BytesTransferred>1024</BytesTransferred></Result>";
+        }
+        if (ids > max_ids) max_ids = ids;
+      }
+      body += "</DataDeliveryQueryResult></DataDeliveryQueryResponse></soap-env:Body></soap-env:Envelope>";
+      std::string head = "HTTP/1.1 200 OK\r\nContent-Type: text/xml\r\nContent-Length: " +
+                         Arc::tostring(body.length()) + "\r\n\r\n";
+      send_all(h, head + body);
+    }
+  }
+  static bool read_more(int h, std::string& buf) {
+    char tmp[1024];
+    ssize_t l = ::recv(h, tmp, sizeof(tmp), 0);
+    if (l <= 0) return false;
+    buf.append(tmp, l);
+    return true;
+  }
+  static void send_all(int h, const std::string& data) {
+    std::string::size_type pos = 0;
+    while (pos < data.length()) {
+      ssize_t l = ::send(h, data.c_str() + pos, data.length() - pos, 0);
+      if (l <= 0) return;
+      pos += l;
+    }
+  }
+};
+
+namespace DataStaging {
+
+class DataDeliveryRemoteCommTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(DataDeliveryRemoteCommTest);
+  CPPUNIT_TEST(TestChannel);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void TestChannel();
+
+private:
+  // Makes transfer which is registered with channel without contacting
+  // service to start it.
+  DataDeliveryRemoteComm* MakeComm(DTR_ptr dtr, const Arc::URL& endpoint, const std::string& proxy);
+  void Forget(DataDeliveryRemoteComm* comm);
+};
+
+DataDeliveryRemoteComm* DataDeliveryRemoteCommTest::MakeComm(DTR_ptr dtr, const Arc::URL& endpoint, const std::string& proxy) {
+  // Transfer with unsupported source is not started
+  DataDeliveryRemoteComm* comm = new DataDeliveryRemoteComm(dtr, TransferParameters());
+  CPPUNIT_ASSERT(!(*comm));
+  comm->endpoint = endpoint;
+  comm->cfg.AddProxy(proxy);
+  comm->valid = true;
+  CPPUNIT_ASSERT(comm->RegisterQuery());
+  return comm;
+}
+
+void DataDeliveryRemoteCommTest::Forget(DataDeliveryRemoteComm* comm) {
+  // Avoid sending cancel request in destructor
+  {
+    Glib::Mutex::Lock lock(comm->lock_);
+    comm->valid = false;
+  }
+  delete comm;
+}
+
+void DataDeliveryRemoteCommTest::TestChannel() {
+  DeliveryServer server;
+  CPPUNIT_ASSERT(server.sock != -1);
+  Arc::URL endpoint("http://127.0.0.1:" + Arc::tostring(server.port) + "/datadeliveryservice");
+  Arc::URL other("http://127.0.0.1:" + Arc::tostring(server.port) + "/otherservice");
+
+  Arc::UserConfig usercfg(Arc::initializeCredentialsType(Arc::initializeCredentialsType::SkipCredentials));
+  usercfg.Timeout(10);
+  std::list<DTRLogDestination> logs;
+  DTR_ptr dtr1(new DTR("fake://source/1", "fake://destination/1", usercfg, "job", Arc::User().get_uid(), logs, "DataStagingTest"));
+  DTR_ptr dtr2(new DTR("fake://source/2", "fake://destination/2", usercfg, "job", Arc::User().get_uid(), logs, "DataStagingTest"));
+  DTR_ptr dtr3(new DTR("fake://source/3", "fake://destination/3", usercfg, "job", Arc::User().get_uid(), logs, "DataStagingTest"));
+
+  // Transfers of different users on same service share channel
+  DataDeliveryRemoteComm* comm1 = MakeComm(dtr1, endpoint, "/tmp/proxy1");
+  DataDeliveryRemoteComm* comm2 = MakeComm(dtr2, endpoint, "/tmp/proxy2");
+  DataDeliveryRemoteComm* comm3 = MakeComm(dtr3, other, "/tmp/proxy1");
+  CPPUNIT_ASSERT(comm1->channel_ != NULL);
+  CPPUNIT_ASSERT(comm1->channel_ == comm2->channel_);
+  CPPUNIT_ASSERT(comm1->channel_ != comm3->channel_);
+
+  // Finished transfer is reported through channel
+  server.Finish(dtr1->get_id());
+  for (int n = 0; (n < 100) && (*comm1); ++n) Glib::usleep(100000);
+  CPPUNIT_ASSERT(!(*comm1));
+  DataDeliveryComm::Status status = comm1->GetStatus();
+  CPPUNIT_ASSERT_EQUAL(DataDeliveryComm::CommExited, status.commstatus);
+  CPPUNIT_ASSERT_EQUAL(DTRStatus::TRANSFERRED, status.status);
+  CPPUNIT_ASSERT_EQUAL(1024ULL, status.transferred);
+  CPPUNIT_ASSERT(*comm2);
+  CPPUNIT_ASSERT(*comm3);
+
+  // Both transfers on same service were queried together
+  CPPUNIT_ASSERT(server.Queries() > 0);
+  CPPUNIT_ASSERT_EQUAL(2, server.MaxIDs());
+
+  Forget(comm1);
+  Forget(comm2);
+  Forget(comm3);
+  Arc::ClientHTTPPool::Instance().Clear();
+}
+
+} // namespace DataStaging
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DataStaging::DataDeliveryRemoteCommTest);
@@ -0,0 +1,86 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <sys/stat.h>
+
+#include <arc/ArcLocation.h>
+#include <arc/FileUtils.h>
+#include <arc/StringConv.h>
+#include <arc/UserConfig.h>
+#include <arc/Utils.h>
+
+#include "../DTRStatus.h"
+#include "../DTR.h"
+#include "../DataDelivery.h"
+#include "../DataDeliveryLocalComm.h"
+
+// Pool settings are read once per process, so this test is kept in
+// separate program from DeliveryTest.
+class DeliveryNoPoolTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(DeliveryNoPoolTest);
+  CPPUNIT_TEST(TestDeliveryNoPool);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void TestDeliveryNoPool();
+  void setUp();
+  void tearDown();
+
+private:
+  std::list<DataStaging::DTRLogDestination> logs;
+  char const * log_name;
+  Arc::UserConfig cfg;
+};
+
+void DeliveryNoPoolTest::setUp() {
+  // Same fake ARC location as in DeliveryTest
+  Arc::DirCreate(std::string("../tmp/")+std::string(PKGLIBSUBDIR), S_IRWXU, true);
+  Arc::ArcLocation::Init("../tmp/x/x");
+  Arc::FileLink("../../../DataStagingDelivery", std::string("../tmp/")+std::string(PKGLIBSUBDIR)+std::string("/DataStagingDelivery"), true);
+  Arc::SetEnv("ARC_DELIVERY_POOL_SIZE", "0");
+  logs.clear();
+  const std::list<Arc::LogDestination*>& destinations = Arc::Logger::getRootLogger().getDestinations();
+  for(std::list<Arc::LogDestination*>::const_iterator dest = destinations.begin(); dest != destinations.end(); ++dest) {
+    logs.push_back(*dest);
+  }
+
+  log_name = "DataStagingTest";
+}
+
+void DeliveryNoPoolTest::tearDown() {
+  Arc::DirDelete("../tmp");
+}
+
+void DeliveryNoPoolTest::TestDeliveryNoPool() {
+
+  // With pool disabled every transfer runs in its own process
+  DataStaging::DataDelivery delivery;
+  delivery.start();
+  unsigned int started = DataStaging::DataDeliveryLocalComm::StartedProcesses();
+  for(int n = 0; n < 3; ++n) {
+    std::string source("mock://mocksrc/"+Arc::tostring(n));
+    std::string destination("mock://mockdest/"+Arc::tostring(n));
+    std::string jobid("1234");
+    DataStaging::DTR_ptr dtr(new DataStaging::DTR(source,destination,cfg,jobid,Arc::User().get_uid(),logs,log_name));
+    CPPUNIT_ASSERT(*dtr);
+    delivery.receiveDTR(dtr);
+    DataStaging::DTRStatus status = dtr->get_status();
+    for(int cnt=0;;++cnt) {
+      status = dtr->get_status();
+      if((status != DataStaging::DTRStatus::TRANSFERRING) &&
+         (status != DataStaging::DTRStatus::NULL_STATE)) break;
+      CPPUNIT_ASSERT(cnt < 300); // 30s limit on transfer time
+      Glib::usleep(100000);
+    }
+    CPPUNIT_ASSERT_EQUAL(DataStaging::DTRStatus::TRANSFERRED, status.GetStatus());
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(dtr->get_error_status().GetDesc(), DataStaging::DTRErrorStatus::NONE_ERROR, dtr->get_error_status().GetErrorStatus());
+    CPPUNIT_ASSERT_EQUAL(0U, DataStaging::DataDeliveryLocalComm::IdleProcesses());
+  }
+  CPPUNIT_ASSERT_EQUAL(3U, DataStaging::DataDeliveryLocalComm::StartedProcesses() - started);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DeliveryNoPoolTest);
@@ -8,11 +8,13 @@
 
 #include <arc/ArcLocation.h>
 #include <arc/FileUtils.h>
+#include <arc/StringConv.h>
 #include <arc/UserConfig.h>
 
 #include "../DTRStatus.h"
 #include "../DTR.h"
 #include "../DataDelivery.h"
+#include "../DataDeliveryLocalComm.h"
 
 using namespace DataStaging;
 
@@ -23,12 +25,14 @@ class DeliveryTest
   CPPUNIT_TEST(TestDeliverySimple);
   CPPUNIT_TEST(TestDeliveryFailure);
   CPPUNIT_TEST(TestDeliveryUnsupported);
+  CPPUNIT_TEST(TestDeliveryReuse);
   CPPUNIT_TEST_SUITE_END();
 
 public:
   void TestDeliverySimple();
   void TestDeliveryFailure();
   void TestDeliveryUnsupported();
+  void TestDeliveryReuse();
   void setUp();
   void tearDown();
 
@@ -146,4 +150,40 @@ void DeliveryTest::TestDeliveryUnsupported() {
   CPPUNIT_ASSERT_EQUAL(DataStaging::DTRErrorStatus::INTERNAL_LOGIC_ERROR, dtr->get_error_status().GetErrorStatus());
 }
 
+void DeliveryTest::TestDeliveryReuse() {
+
+  // Transfers following each other are passed to same delivery process.
+  // Failed transfer must not affect following ones.
+  DataStaging::DataDelivery delivery;
+  delivery.start();
+  unsigned int started = DataStaging::DataDeliveryLocalComm::StartedProcesses();
+  const char* sources[] = { "mock://mocksrc/1", "fail://mocksrc/2", "mock://mocksrc/3" };
+  for(int n = 0; n < 3; ++n) {
+    std::string source(sources[n]);
+    std::string destination("mock://mockdest/"+Arc::tostring(n));
+    std::string jobid("1234");
+    DataStaging::DTR_ptr dtr(new DataStaging::DTR(source,destination,cfg,jobid,Arc::User().get_uid(),logs,log_name));
+    CPPUNIT_ASSERT(*dtr);
+    delivery.receiveDTR(dtr);
+    DataStaging::DTRStatus status = dtr->get_status();
+    for(int cnt=0;;++cnt) {
+      status = dtr->get_status();
+      if((status != DataStaging::DTRStatus::TRANSFERRING) &&
+         (status != DataStaging::DTRStatus::NULL_STATE)) break;
+      CPPUNIT_ASSERT(cnt < 300); // 30s limit on transfer time
+      Glib::usleep(100000);
+    }
+    CPPUNIT_ASSERT_EQUAL(DataStaging::DTRStatus::TRANSFERRED, status.GetStatus());
+    if(n == 1) {
+      CPPUNIT_ASSERT_EQUAL(DataStaging::DTRErrorStatus::TEMPORARY_REMOTE_ERROR, dtr->get_error_status().GetErrorStatus());
+    } else {
+      CPPUNIT_ASSERT_EQUAL_MESSAGE(dtr->get_error_status().GetDesc(), DataStaging::DTRErrorStatus::NONE_ERROR, dtr->get_error_status().GetErrorStatus());
+    }
+    // Process is returned to pool before transfer is reported finished
+    CPPUNIT_ASSERT(DataStaging::DataDeliveryLocalComm::IdleProcesses() >= 1);
+  }
+  // Process left idle by previous tests may have been taken too
+  CPPUNIT_ASSERT(DataStaging::DataDeliveryLocalComm::StartedProcesses() - started <= 1);
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(DeliveryTest);
@@ -0,0 +1,150 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// Measures cost of selecting DTRs for one pass of the Scheduler loop with
+// large number of synthetic DTRs. Selection through indexed DTRList queues
+// is compared to walking all DTRs and sorting them like it was done before.
+
+#include <cstdlib>
+#include <iostream>
+
+#include <glibmm.h>
+
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+
+#include "../DTRList.h"
+
+using namespace DataStaging;
+
+static bool dtr_sort_predicate(DTR_ptr dtr1, DTR_ptr dtr2) {
+  return dtr1->get_priority() > dtr2->get_priority();
+}
+
+// Old way - every status group is selected by walking all DTRs
+static void scanPass(std::list<DTR_ptr>& dtrs, unsigned int& selected) {
+  const std::vector<DTRStatus::DTRStatusType>* groups[] = {
+    &DTRStatus::ToProcessStates, &DTRStatus::ProcessingStates, &DTRStatus::StagedStates };
+  for (unsigned int g = 0; g < sizeof(groups)/sizeof(groups[0]); ++g) {
+    std::map<DTRStatus::DTRStatusType, std::list<DTR_ptr> > filtered;
+    for (std::list<DTR_ptr>::iterator it = dtrs.begin(); it != dtrs.end(); ++it) {
+      DTRStatus::DTRStatusType status = (*it)->get_status().GetStatus();
+      for (std::vector<DTRStatus::DTRStatusType>::const_iterator i = groups[g]->begin(); i != groups[g]->end(); ++i) {
+        if (status == *i) {
+          filtered[*i].push_back(*it);
+          break;
+        }
+      }
+    }
+    for (std::map<DTRStatus::DTRStatusType, std::list<DTR_ptr> >::iterator q = filtered.begin(); q != filtered.end(); ++q) {
+      if (g == 0) q->second.sort(dtr_sort_predicate);
+      selected += q->second.size();
+    }
+  }
+}
+
+// New way - queues are taken from DTRList indexes
+static void indexPass(DTRList& list, unsigned int& selected) {
+  std::map<DTRStatus::DTRStatusType, std::list<DTR_ptr> > queued;
+  list.filter_dtrs_by_statuses(DTRStatus::ToProcessStates, queued);
+  std::map<DTRStatus::DTRStatusType, std::list<DTR_ptr> > running;
+  list.filter_dtrs_by_statuses(DTRStatus::ProcessingStates, running);
+  std::list<DTR_ptr> staged;
+  list.filter_dtrs_by_statuses(DTRStatus::StagedStates, staged);
+  for (std::map<DTRStatus::DTRStatusType, std::list<DTR_ptr> >::iterator q = queued.begin(); q != queued.end(); ++q)
+    selected += q->second.size();
+  for (std::map<DTRStatus::DTRStatusType, std::list<DTR_ptr> >::iterator q = running.begin(); q != running.end(); ++q)
+    selected += q->second.size();
+  selected += staged.size();
+}
+
+// Moves some DTRs between states like processes do between scheduler passes
+static void changeStates(std::vector<DTR_ptr>& dtrs, unsigned int changes, unsigned int& next) {
+  for (unsigned int n = 0; n < changes; ++n) {
+    DTR_ptr dtr = dtrs[next];
+    next = (next + 1) % dtrs.size();
+    DTRStatus::DTRStatusType status = dtr->get_status().GetStatus();
+    if (status == DTRStatus::TRANSFER) dtr->set_status(DTRStatus::TRANSFERRING);
+    else dtr->set_status(DTRStatus::TRANSFER);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  Arc::LogStream logcerr(std::cerr);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+  Arc::Logger::getRootLogger().setThreshold(Arc::ERROR);
+
+  if ((argc < 2) || (argc > 4)) {
+    std::cerr << "Wrong number of arguments!" << std::endl
+              << std::endl
+              << "Usage:" << std::endl
+              << "perftest_scheduler dtrs [passes [changes]]" << std::endl
+              << std::endl
+              << "Arguments:" << std::endl
+              << "dtrs      Number of DTRs in the system, e.g. 100000." << std::endl
+              << "passes    Number of scheduler passes to average over. Default is 20." << std::endl
+              << "changes   Number of DTRs changing state between passes. Default is 100." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  unsigned int dtrs_num = atoi(argv[1]);
+  int passes = (argc > 2) ? atoi(argv[2]) : 20;
+  if (passes < 1) passes = 1;
+  unsigned int changes = (argc > 3) ? atoi(argv[3]) : 100;
+  if (dtrs_num == 0) dtrs_num = 1;
+
+  std::cout << "Creating " << dtrs_num << " DTRs" << std::endl;
+  Arc::UserConfig cfg;
+  std::list<DTRLogDestination> logs;
+  std::vector<DTR_ptr> dtrs;
+  std::list<DTR_ptr> dtr_list;
+  DTRList list;
+  for (unsigned int n = 0; n < dtrs_num; ++n) {
+    std::string num(Arc::tostring(n));
+    DTR_ptr dtr(new DTR("mock://mocksrc/" + num, "mock://mockdest/" + num, cfg,
+                        "job" + Arc::tostring(n / 100), Arc::User().get_uid(), logs, "DataStagingTest"));
+    dtr->set_priority(1 + n % 100);
+    // Most transfers wait in queue, some are running or in other states
+    if (n % 10 == 0) dtr->set_status(DTRStatus::TRANSFERRING);
+    else if (n % 10 == 1) dtr->set_status(DTRStatus::RESOLVE);
+    else if (n % 10 == 2) dtr->set_status(DTRStatus::STAGED_PREPARED);
+    else dtr->set_status(DTRStatus::TRANSFER);
+    dtrs.push_back(dtr);
+    dtr_list.push_back(dtr);
+    list.add_dtr(dtr);
+  }
+
+  unsigned int next = 0;
+  unsigned int selected_scan = 0;
+  Glib::TimeVal tBefore;
+  tBefore.assign_current_time();
+  for (int n = 0; n < passes; ++n) {
+    changeStates(dtrs, changes, next);
+    scanPass(dtr_list, selected_scan);
+  }
+  Glib::TimeVal tAfter;
+  tAfter.assign_current_time();
+  double scan_time = (tAfter.as_double() - tBefore.as_double()) / passes;
+
+  unsigned int selected_index = 0;
+  tBefore.assign_current_time();
+  for (int n = 0; n < passes; ++n) {
+    changeStates(dtrs, changes, next);
+    indexPass(list, selected_index);
+  }
+  tAfter.assign_current_time();
+  double index_time = (tAfter.as_double() - tBefore.as_double()) / passes;
+
+  for (std::vector<DTR_ptr>::iterator dtr = dtrs.begin(); dtr != dtrs.end(); ++dtr) list.delete_dtr(*dtr);
+
+  std::cout << "========================================" << std::endl;
+  std::cout << "Number of DTRs: " << dtrs_num << std::endl;
+  std::cout << "Number of passes: " << passes << std::endl;
+  std::cout << "Changes per pass: " << changes << std::endl;
+  std::cout << "Scanning all DTRs: " << selected_scan / passes << " selected in " << scan_time << " s per pass" << std::endl;
+  std::cout << "Indexed queues:    " << selected_index / passes << " selected in " << index_time << " s per pass" << std::endl;
+  if (index_time > 0)
+    std::cout << "Speedup: " << scan_time / index_time << std::endl;
+  std::cout << "========================================" << std::endl;
+  return 0;
+}
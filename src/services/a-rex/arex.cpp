@@ -26,7 +26,9 @@
 #include "grid-manager/log/JobsMetrics.h"
 #include "grid-manager/log/HeartBeatMetrics.h"
 #include "grid-manager/log/SpaceMetrics.h"
+#include "grid-manager/log/MetricsRegistry.h"
 #include "grid-manager/jobs/ContinuationPlugins.h"
+#include "grid-manager/jobs/JobOwnerIndex.h"
 #include "grid-manager/files/ControlFileHandling.h"
 #include "arex.h"
 
@@ -1087,9 +1089,11 @@ ARexService::ARexService(Arc::Config *cfg,Arc::PluginArgument *parg):Arc::Servic
               rest_(cfg, parg, config_, delegation_stores_, all_jobs_count_) {
   valid = false;
   config_.SetJobLog(new JobLog());
-  config_.SetJobsMetrics(new JobsMetrics());
-  config_.SetHeartBeatMetrics(new HeartBeatMetrics());
-  config_.SetSpaceMetrics(new SpaceMetrics());
+  config_.SetMetricsRegistry(new MetricsRegistry());
+  config_.SetJobsMetrics(new JobsMetrics(*config_.GetMetricsRegistry()));
+  config_.SetJobOwnerIndex(new JobOwnerIndex());
+  config_.SetHeartBeatMetrics(new HeartBeatMetrics(*config_.GetMetricsRegistry()));
+  config_.SetSpaceMetrics(new SpaceMetrics(*config_.GetMetricsRegistry()));
   config_.SetJobPerfLog(new Arc::JobPerfLog());
   config_.SetContPlugins(new ContinuationPlugins());
   // logger_.addDestination(logcerr);
@@ -1211,6 +1215,8 @@ ARexService::~ARexService(void) {
   delete config_.GetJobsMetrics();
   delete config_.GetHeartBeatMetrics();
   delete config_.GetSpaceMetrics();
+  delete config_.GetJobOwnerIndex();
+  delete config_.GetMetricsRegistry();
 }
 
 } // namespace ARex
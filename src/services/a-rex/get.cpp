@@ -274,6 +274,8 @@ Arc::MCC_Status ARexService::GetInfo(Arc::Message& inmsg,Arc::Message& outmsg,AR
 }
 
 Arc::MCC_Status ARexService::GetInfo(Arc::Message& inmsg,Arc::Message& outmsg) {
+  // Served from memory with support for conditional requests
+  if(rest_.InfoCache().Respond("raw", inmsg, outmsg)) return Arc::MCC_Status(Arc::STATUS_OK);
   int h = OpenInfoDocument();
   if(h == -1) return Arc::MCC_Status();
   Arc::MessagePayload* payload = newFileRead(h);
@@ -11,13 +11,16 @@
 #include <arc/Logger.h>
 #include <arc/Watchdog.h>
 #include "jobs/JobsList.h"
+#include "jobs/JobOwnerIndex.h"
 #include "jobs/CommFIFO.h"
+#include "jobs/ControlDirWatcher.h"
 #include "log/JobLog.h"
 #include "log/JobsMetrics.h"
 #include "log/HeartBeatMetrics.h"
 #include "log/SpaceMetrics.h"
 #include "run/RunRedirected.h"
 #include "files/ControlFileHandling.h"
+#include "files/JobStateStore.h"
 #include "../delegation/DelegationStore.h"
 #include "../delegation/DelegationStores.h"
 
@@ -235,6 +238,14 @@ bool GridManager::thread() {
     };
   };
 
+  // Falling back to files would hide jobs kept in database
+  if(config_.ControlStoreType() == GMConfig::control_store_sqlite) {
+    if(!JobStateStore::Get(config_)) {
+      logger.msg(Arc::FATAL,"Error opening job state database in %s.", config_.ControlDir());
+      return false;
+    };
+  };
+
   /* start timer thread - wake up every 2 minutes */
   // TODO: use timed wait instead of dedicated thread
   // check if cache cleaning is enabled, if so activate cleaning thread
@@ -271,11 +282,20 @@ bool GridManager::thread() {
     return false;
   };  
 
+  // Index owners and states of all jobs for front-ends in background
+  if(config_.GetJobOwnerIndex()) config_.GetJobOwnerIndex()->Load(config_);
+
   // Start jobs processing
   jobs_ = &jobs;
   logger.msg(Arc::INFO,"Picking up left jobs");
   jobs.RestartJobs();
 
+  // Follow new jobs and marks without scanning control directory if possible
+  ControlDirWatcher controldir_watcher(config_, jobs);
+  if(!controldir_watcher.start()) {
+    logger.msg(Arc::INFO,"Control directory will be scanned for changes every %u seconds",config_.WakeupPeriod());
+  };
+
   logger.msg(Arc::INFO, "Starting data staging threads");
   std::string heartbeat_file("gm-heartbeat");
   Arc::WatchdogChannel wd(config_.WakeupPeriod()*3+300);
@@ -310,12 +330,13 @@ bool GridManager::thread() {
       }
     }
 
-    // TODO: review metrics calls to reduce frequency of calling gmetrics tool.
+    // Passes collected changes to gmetric tool if enough time passed.
     JobsMetrics* metrics = config_.GetJobsMetrics();
     if(metrics) metrics->Sync();
     // Process jobs which need attention ASAP
     jobs.ActJobsAttention();
-    if(((int)(time(NULL) - poll_job_time)) >= 0) {
+    bool polling = (((int)(time(NULL) - poll_job_time)) >= 0);
+    if(polling) {
       // Polling time
       poll_job_time = time(NULL) + config_.WakeupPeriod();
 
@@ -325,10 +346,22 @@ bool GridManager::thread() {
       if(config_.ConfigIsTemp()) ::utimes(config_.ConfigFile().c_str(), NULL);
       // Tell watchdog we are alive
       wd.Kick();
-      /* check for new marks and activate related jobs - TODO: remove */
+    };
+    // Full scan is done at polling time only if notifications are not available
+    // or some changes could not be handled through notifications.
+    bool rescan = controldir_watcher.TakeRescan(polling);
+    if(rescan || (polling && !controldir_watcher.WatchesMarks())) {
+      /* check for new marks and activate related jobs */
       jobs.ScanNewMarks();
-      /* look for new jobs - TODO: remove */
+    };
+    if(rescan) {
+      /* look for new jobs */
       jobs.ScanNewJobs();
+      // Jobs left waiting because of limit will not cause new notifications
+      if((config_.MaxJobs() != -1) && (jobs.AcceptedJobs() >= config_.MaxJobs()))
+        controldir_watcher.RequestRescan(false);
+    };
+    if(polling) {
       /* process jobs which do not get attention calls in their current state */
       jobs.ActJobsPolling();
       //jobs.ActJobs();
@@ -45,6 +45,14 @@ namespace ARex {
          * write record about job state change to accounting log 
          **/
         virtual bool addJobEvent(aar_jobevent_t& events, const std::string& jobid) = 0;
+        /// Start group of operations
+        /**
+         * Operations till matching commit() may be stored together, which is
+         * faster than storing every one separately.
+         **/
+        virtual bool begin() { return true; }
+        /// Store group of operations started with begin()
+        virtual bool commit() { return true; }
     protected:
         const std::string name;
         bool isValid;
@@ -58,36 +58,60 @@ namespace ARex {
   }
 
   void AccountingDBThread::thread() {
-    while(true) {
-      Arc::AutoLock<Arc::SimpleCondition> lock(lock_);
-      if(queue_.empty()) {
-        lock_.wait_nonblock();
-        if(queue_.empty()) continue;
+    bool quit = false;
+    while(!quit) {
+      std::list<AccountingDBAsync::Event*> events;
+      {
+        Arc::AutoLock<Arc::SimpleCondition> lock(lock_);
+        if(queue_.empty()) {
+          lock_.wait_nonblock();
+          if(queue_.empty()) continue;
+        }
+        // take all queued events so they are stored in one transaction
+        events.swap(queue_);
       }
-      Arc::AutoPointer<AccountingDBAsync::Event> event(queue_.front());
-      queue_.pop_front();
-      AccountingDBAsync::EventQuit* eventQuit = dynamic_cast<AccountingDBAsync::EventQuit*>(event.Ptr());
-      if(eventQuit) break;
-      std::map< std::string,Arc::AutoPointer<AccountingDB> >::iterator db = dbs_.find(event->name);
-      if(db == dbs_.end()) continue; // not expected
-      lock.unlock(); // no need to keep lock anymore - db and event are picked up
-
-      AccountingDBAsync::EventCreateAAR* eventCreateAAR = dynamic_cast<AccountingDBAsync::EventCreateAAR*>(event.Ptr());
-      if(eventCreateAAR) {
-        db->second->createAAR(eventCreateAAR->aar);
-        continue;
-      };
-      AccountingDBAsync::EventUpdateAAR* eventUpdateAAR = dynamic_cast<AccountingDBAsync::EventUpdateAAR*>(event.Ptr());
-      if(eventUpdateAAR) {
-        db->second->updateAAR(eventUpdateAAR->aar);
-        continue;
-      };
-      AccountingDBAsync::EventAddJobEvent* eventAddJobEvent = dynamic_cast<AccountingDBAsync::EventAddJobEvent*>(event.Ptr());
-      if(eventAddJobEvent) {
-        db->second->addJobEvent(eventAddJobEvent->events, eventAddJobEvent->jobid);
-        continue;
+      AccountingDB* batch = NULL;
+      for(std::list<AccountingDBAsync::Event*>::iterator e = events.begin(); e != events.end(); ++e) {
+        Arc::AutoPointer<AccountingDBAsync::Event> event(*e);
+        if(quit) continue; // events after quit are dropped like those left in queue
+        AccountingDBAsync::EventQuit* eventQuit = dynamic_cast<AccountingDBAsync::EventQuit*>(event.Ptr());
+        if(eventQuit) {
+          quit = true;
+          continue;
+        }
+        AccountingDB* db = NULL;
+        {
+          Arc::AutoLock<Arc::SimpleCondition> lock(lock_);
+          std::map< std::string,Arc::AutoPointer<AccountingDB> >::iterator dbIt = dbs_.find(event->name);
+          if(dbIt == dbs_.end()) continue; // not expected
+          db = dbIt->second.Ptr();
+        }
+        if(db != batch) {
+          if(batch) batch->commit();
+          batch = db;
+          batch->begin();
+        }
+
+        AccountingDBAsync::EventCreateAAR* eventCreateAAR = dynamic_cast<AccountingDBAsync::EventCreateAAR*>(event.Ptr());
+        if(eventCreateAAR) {
+          db->createAAR(eventCreateAAR->aar);
+          continue;
+        };
+        AccountingDBAsync::EventUpdateAAR* eventUpdateAAR = dynamic_cast<AccountingDBAsync::EventUpdateAAR*>(event.Ptr());
+        if(eventUpdateAAR) {
+          db->updateAAR(eventUpdateAAR->aar);
+          continue;
+        };
+        AccountingDBAsync::EventAddJobEvent* eventAddJobEvent = dynamic_cast<AccountingDBAsync::EventAddJobEvent*>(event.Ptr());
+        if(eventAddJobEvent) {
+          db->addJobEvent(eventAddJobEvent->events, eventAddJobEvent->jobid);
+          continue;
+        };
       };
+      if(batch) batch->commit();
     };
+    Arc::AutoLock<Arc::SimpleCondition> lock(lock_);
+    exited_ = true;
   }
 
 
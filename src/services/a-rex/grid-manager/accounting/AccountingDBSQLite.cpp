@@ -28,7 +28,70 @@ namespace ARex {
         return err;
     }
 
-    AccountingDBSQLite::SQLiteDB::SQLiteDB(const std::string& name, bool create): aDB(NULL) {
+    sqlite3_stmt* AccountingDBSQLite::SQLiteDB::statement(const std::string& sql) {
+        std::map<std::string, sqlite3_stmt*>::iterator it = statements.find(sql);
+        if (it != statements.end()) {
+            (void)sqlite3_reset(it->second);
+            (void)sqlite3_clear_bindings(it->second);
+            return it->second;
+        }
+        sqlite3_stmt* stmt = NULL;
+        int err;
+        while((err = sqlite3_prepare_v2(aDB, sql.c_str(), -1, &stmt, NULL)) == SQLITE_BUSY) {
+            struct timespec delay = { 0, 10000000 }; // 0.01s
+            (void)::nanosleep(&delay, NULL);
+        };
+        if (err != SQLITE_OK) {
+            logError("Failed to prepare SQL statement", err, Arc::ERROR);
+            AccountingDBSQLite::logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
+            return NULL;
+        }
+        statements[sql] = stmt;
+        return stmt;
+    }
+
+    int AccountingDBSQLite::SQLiteDB::step(sqlite3_stmt* stmt) {
+        int err;
+        while((err = sqlite3_step(stmt)) == SQLITE_BUSY) {
+            // Same as in exec() - lock is expected to be released soon
+            (void)sqlite3_reset(stmt);
+            struct timespec delay = { 0, 10000000 }; // 0.01s
+            (void)::nanosleep(&delay, NULL);
+        };
+        // Reset releases read lock held by statement
+        if (err != SQLITE_ROW) (void)sqlite3_reset(stmt);
+        return err;
+    }
+
+    bool AccountingDBSQLite::SQLiteDB::begin(void) {
+        if (transaction_depth++ > 0) return true;
+        // Take write lock immediately so that statements inside transaction
+        // do not fail to upgrade lock
+        int err = exec("BEGIN IMMEDIATE", NULL, NULL, NULL);
+        if (err != SQLITE_OK) {
+            logError("Failed to start transaction", err, Arc::ERROR);
+            return false;
+        }
+        transaction_started = true;
+        return true;
+    }
+
+    bool AccountingDBSQLite::SQLiteDB::commit(void) {
+        if (transaction_depth <= 0) return false;
+        if (--transaction_depth > 0) return true;
+        if (!transaction_started) return false;
+        transaction_started = false;
+        int err = exec("COMMIT", NULL, NULL, NULL);
+        if (err != SQLITE_OK) {
+            logError("Failed to commit transaction", err, Arc::ERROR);
+            (void)exec("ROLLBACK", NULL, NULL, NULL);
+            return false;
+        }
+        return true;
+    }
+
+    AccountingDBSQLite::SQLiteDB::SQLiteDB(const std::string& name, bool create):
+        aDB(NULL), transaction_depth(0), transaction_started(false) {
         if (aDB != NULL) return; // already open
 
         int flags = SQLITE_OPEN_READWRITE;
@@ -45,6 +108,11 @@ namespace ARex {
             closeDB();
             return;
         };
+        // Write-ahead log lets reporting tools read while records are written
+        // and makes commits cheaper. Loosing last transactions on power loss
+        // is acceptable for accounting records.
+        (void)exec("PRAGMA journal_mode=WAL", NULL, NULL, NULL);
+        (void)exec("PRAGMA synchronous=NORMAL", NULL, NULL, NULL);
         if (create) {
             std::string db_schema_str;
             std::string sql_file = Arc::ArcLocation::Get() + G_DIR_SEPARATOR_S + PKGDATASUBDIR + 
@@ -84,6 +152,10 @@ namespace ARex {
     }
 
     void AccountingDBSQLite::SQLiteDB::closeDB(void) {
+        for (std::map<std::string, sqlite3_stmt*>::iterator it = statements.begin(); it != statements.end(); ++it) {
+            (void)sqlite3_finalize(it->second);
+        }
+        statements.clear();
         if (aDB) {
             (void)sqlite3_close(aDB); // TODO: handle errors?
             aDB = NULL;
@@ -156,16 +228,28 @@ namespace ARex {
         closeSQLiteDB();
     }
 
-    // perform insert query and return
+    // bind escaped string value to statement parameter
+    static bool sql_bind(sqlite3_stmt* stmt, int idx, const std::string& str) {
+        std::string value = sql_escape(str);
+        return (sqlite3_bind_text(stmt, idx, value.c_str(), value.length(), SQLITE_TRANSIENT) == SQLITE_OK);
+    }
+
+    static bool sql_bind(sqlite3_stmt* stmt, int idx, const Arc::Time& val) {
+        std::string value = sql_escape(val);
+        return (sqlite3_bind_text(stmt, idx, value.c_str(), value.length(), SQLITE_TRANSIENT) == SQLITE_OK);
+    }
+
+    static bool sql_bind_int(sqlite3_stmt* stmt, int idx, sqlite3_int64 num) {
+        return (sqlite3_bind_int64(stmt, idx, num) == SQLITE_OK);
+    }
+
+    // perform prepared insert query and return
     //  0 - failure
     //  id - autoincrement id of the inserted raw
-    unsigned int AccountingDBSQLite::GeneralSQLInsert(const std::string& sql) {
-        if (!isValid) return 0;
-        initSQLiteDB();
-        Glib::Mutex::Lock lock(lock_);
-        int err;
-        err = db->exec(sql.c_str(), NULL, NULL, NULL);
-        if (err != SQLITE_OK) {
+    unsigned int AccountingDBSQLite::GeneralSQLInsert(sqlite3_stmt* stmt) {
+        if (!isValid || !stmt) return 0;
+        int err = db->step(stmt);
+        if (err != SQLITE_DONE) {
             if (err == SQLITE_CONSTRAINT) {
                 db->logError("It seams record exists already", err, Arc::ERROR);
             } else {
@@ -180,14 +264,11 @@ namespace ARex {
         return (unsigned int) newid;
     }
 
-    // perform update query
-    bool AccountingDBSQLite::GeneralSQLUpdate(const std::string& sql) {
-        if (!isValid) return false;
-        initSQLiteDB();
-        Glib::Mutex::Lock lock(lock_);
-        int err;
-        err = db->exec(sql.c_str(), NULL, NULL, NULL);
-        if (err != SQLITE_OK ) {
+    // perform prepared update query
+    bool AccountingDBSQLite::GeneralSQLUpdate(sqlite3_stmt* stmt) {
+        if (!isValid || !stmt) return false;
+        int err = db->step(stmt);
+        if (err != SQLITE_DONE) {
             db->logError("Failed to update data in the database", err, Arc::ERROR);
             return false;
         }
@@ -232,22 +313,26 @@ namespace ARex {
 
     // general helper to build (name,id) map from database table
     unsigned int AccountingDBSQLite::QueryAndInsertNameID(const std::string& table, const std::string& iname, name_id_map_t* name_id_map) {
-        // fill map with db values
-        if (name_id_map->empty()) {
+        // find name in cached values
+        name_id_map_t::iterator it;
+        it = name_id_map->find(iname);
+        if (it != name_id_map->end()) return it->second;
+        // fill map with db values once, table may be empty
+        if (db_loaded.find(table) == db_loaded.end()) {
             if (!QueryNameIDmap(table, name_id_map)) {
                 logger.msg(Arc::ERROR, "Failed to fetch data from %s accounting database table", table);
                 return 0;
             }
+            db_loaded.insert(table);
         }
-        // find name
-        name_id_map_t::iterator it;
         it = name_id_map->find(iname);
         if (it != name_id_map->end()) {
             return it->second;
         } else {
             // if not found - create the new record in the database
-            std::string sql = "INSERT INTO " + sql_escape(table) + " (Name) VALUES ('" + sql_escape(iname) + "')";
-            unsigned int newid = GeneralSQLInsert(sql);
+            sqlite3_stmt* stmt = db->statement("INSERT INTO " + sql_escape(table) + " (Name) VALUES (?)");
+            if (stmt) sql_bind(stmt, 1, iname);
+            unsigned int newid = GeneralSQLInsert(stmt);
             if ( newid ) {
                 name_id_map->insert(std::pair <std::string, unsigned int>(iname, newid));
                 return newid;
@@ -308,22 +393,29 @@ namespace ARex {
     }
 
     unsigned int AccountingDBSQLite::getDBEndpointId(const aar_endpoint_t& endpoint) {
-        // fill map with db values
-        if (db_endpoints.empty()) {
+        // find endpoint in cached values
+        std::map <aar_endpoint_t, unsigned int>::iterator it;
+        it = db_endpoints.find(endpoint);
+        if (it != db_endpoints.end()) return it->second;
+        // fill map with db values once
+        if (db_loaded.find("Endpoints") == db_loaded.end()) {
             if (!QueryEnpointsmap()) {
                 logger.msg(Arc::ERROR, "Failed to fetch data from accounting database Endpoints table");
                 return 0;
             }
+            db_loaded.insert("Endpoints");
         }
-        // find endpoint
-        std::map <aar_endpoint_t, unsigned int>::iterator it;
         it = db_endpoints.find(endpoint);
         if (it != db_endpoints.end()) {
             return it->second;
         } else {
             // if not found - create the new record in the database
-            std::string sql = "INSERT INTO Endpoints (Interface, URL) VALUES ('" + sql_escape(endpoint.interface) + "', '" + sql_escape(endpoint.url) +"')";
-            unsigned int newid = GeneralSQLInsert(sql);
+            sqlite3_stmt* stmt = db->statement("INSERT INTO Endpoints (Interface, URL) VALUES (?, ?)");
+            if (stmt) {
+                sql_bind(stmt, 1, endpoint.interface);
+                sql_bind(stmt, 2, endpoint.url);
+            }
+            unsigned int newid = GeneralSQLInsert(stmt);
             if ( newid ) {
                 db_endpoints.insert(std::pair <aar_endpoint_t, unsigned int>(endpoint, newid));
                 return newid;
@@ -334,26 +426,21 @@ namespace ARex {
         return 0;
     }
     
-    // callback to get id from database table
-    static int ReadIdCallback(void* arg, int colnum, char** texts, char** names) {
-        unsigned int* dbid = static_cast<unsigned int*>(arg);
-        for (int n = 0; n < colnum; ++n) {
-            if (names[n] && texts[n]) {
-                int id;
-                sql_unescape(texts[n], id);
-                *dbid = id;
-            }
-        }
-        return 0;
-    }
-
     // AAR processing
     unsigned int AccountingDBSQLite::getAARDBId(const AAR& aar) {
         if (!isValid) return 0;
         initSQLiteDB();
         unsigned int dbid = 0;
-        std::string sql = "SELECT RecordID FROM AAR WHERE JobID = '" + sql_escape(aar.jobid) + "'";
-        if (db->exec(sql.c_str(), &ReadIdCallback, &dbid, NULL) != SQLITE_OK ) {
+        sqlite3_stmt* stmt = db->statement("SELECT RecordID FROM AAR WHERE JobID = ?");
+        int err = SQLITE_ERROR;
+        if (stmt) {
+            sql_bind(stmt, 1, aar.jobid);
+            err = db->step(stmt);
+        }
+        if (err == SQLITE_ROW) {
+            dbid = (unsigned int)sqlite3_column_int64(stmt, 0);
+            (void)sqlite3_reset(stmt);
+        } else if (err != SQLITE_DONE) {
             logger.msg(Arc::ERROR, "Failed to query AAR database ID for job %s", aar.jobid);
             return 0;
         }
@@ -368,7 +455,9 @@ namespace ARex {
 
     bool AccountingDBSQLite::createAAR(AAR& aar) {
         if (!isValid) return false;
+        Glib::Mutex::Lock lock(lock_);
         initSQLiteDB();
+        Transaction transaction(db);
         // get the corresponding IDs in connected tables
         unsigned int endpointid = getDBEndpointId(aar.endpoint);
         if (!endpointid) return false;
@@ -381,36 +470,36 @@ namespace ARex {
         unsigned int statusid = getDBStatusId(aar.status);
         if (!statusid) return false;
         // construct insert statement
-        std::string sql = "INSERT INTO AAR ("
+        sqlite3_stmt* stmt = db->statement("INSERT INTO AAR ("
             "JobID, LocalJobID, EndpointID, QueueID, UserID, VOID, StatusID, ExitCode, "
             "SubmitTime, EndTime, NodeCount, CPUCount, UsedMemory, UsedVirtMem, UsedWalltime, "
             "UsedCPUUserTime, UsedCPUKernelTime, UsedScratch, StageInVolume, StageOutVolume ) "
-            "VALUES ('" +
-                sql_escape(aar.jobid) + "', '" +
-                sql_escape(aar.localid) + "', " +
-                sql_escape(endpointid) + ", " + 
-                sql_escape(queueid) + ", " + 
-                sql_escape(userid) + ", " + 
-                sql_escape(wlcgvoid) + ", " + 
-                sql_escape(statusid) + ", " +
-                sql_escape(aar.exitcode) + ", " +
-                sql_escape(aar.submittime.GetTime()) + ", " + 
-                sql_escape(aar.endtime.GetTime()) + ", " +
-                sql_escape(aar.nodecount) + ", " + 
-                sql_escape(aar.cpucount) + ", " + 
-                sql_escape(aar.usedmemory) + ", " + 
-                sql_escape(aar.usedvirtmemory) + ", " +
-                sql_escape(aar.usedwalltime) + ", " + 
-                sql_escape(aar.usedcpuusertime) + ", " + 
-                sql_escape(aar.usedcpukerneltime) + ", " +
-                sql_escape(aar.usedscratch) + ", " + 
-                sql_escape(aar.stageinvolume) + ", " + 
-                sql_escape(aar.stageoutvolume) +
-            ")";
-        unsigned int recordid = GeneralSQLInsert(sql);
+            "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+        if (stmt) {
+            sql_bind(stmt, 1, aar.jobid);
+            sql_bind(stmt, 2, aar.localid);
+            sql_bind_int(stmt, 3, endpointid);
+            sql_bind_int(stmt, 4, queueid);
+            sql_bind_int(stmt, 5, userid);
+            sql_bind_int(stmt, 6, wlcgvoid);
+            sql_bind_int(stmt, 7, statusid);
+            sql_bind_int(stmt, 8, aar.exitcode);
+            sql_bind_int(stmt, 9, aar.submittime.GetTime());
+            sql_bind_int(stmt, 10, aar.endtime.GetTime());
+            sql_bind_int(stmt, 11, aar.nodecount);
+            sql_bind_int(stmt, 12, aar.cpucount);
+            sql_bind_int(stmt, 13, aar.usedmemory);
+            sql_bind_int(stmt, 14, aar.usedvirtmemory);
+            sql_bind_int(stmt, 15, aar.usedwalltime);
+            sql_bind_int(stmt, 16, aar.usedcpuusertime);
+            sql_bind_int(stmt, 17, aar.usedcpukerneltime);
+            sql_bind_int(stmt, 18, aar.usedscratch);
+            sql_bind_int(stmt, 19, aar.stageinvolume);
+            sql_bind_int(stmt, 20, aar.stageoutvolume);
+        }
+        unsigned int recordid = GeneralSQLInsert(stmt);
         if (!recordid) {
             logger.msg(Arc::ERROR, "Failed to insert AAR into the database for job %s", aar.jobid);
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
             return false;
         }
         // insert authtoken attributes
@@ -426,7 +515,9 @@ namespace ARex {
 
     bool AccountingDBSQLite::updateAAR(AAR& aar) {
         if (!isValid) return false;
+        Glib::Mutex::Lock lock(lock_);
         initSQLiteDB();
+        Transaction transaction(db);
         // get AAR ID in the database
         unsigned int recordid = getAARDBId(aar);
         if (!recordid) {
@@ -438,26 +529,31 @@ namespace ARex {
         
         // construct update statement 
         // NOTE: it only make sense update the dynamic information not available on submission time
-        std::string sql = "UPDATE AAR SET "
-            "LocalJobID = '" + sql_escape(aar.localid) + "', " +
-            "StatusID = " + sql_escape(statusid) + ", " +
-            "ExitCode = " + sql_escape(aar.exitcode) + ", " +
-            "EndTime = " + sql_escape(aar.endtime.GetTime()) + ", " +
-            "NodeCount = " + sql_escape(aar.nodecount) + ", " + 
-            "CPUCount = " + sql_escape(aar.cpucount) + ", " + 
-            "UsedMemory = " + sql_escape(aar.usedmemory) + ", " + 
-            "UsedVirtMem = " + sql_escape(aar.usedvirtmemory) + ", " +
-            "UsedWalltime = " + sql_escape(aar.usedwalltime) + ", " + 
-            "UsedCPUUserTime = " + sql_escape(aar.usedcpuusertime) + ", " + 
-            "UsedCPUKernelTime = " + sql_escape(aar.usedcpukerneltime) + ", " +
-            "UsedScratch = " + sql_escape(aar.usedscratch) + ", " + 
-            "StageInVolume = " + sql_escape(aar.stageinvolume) + ", " + 
-            "StageOutVolume = " + sql_escape(aar.stageoutvolume) + " " +
-            "WHERE RecordId = " + sql_escape(recordid);
+        sqlite3_stmt* stmt = db->statement("UPDATE AAR SET "
+            "LocalJobID = ?, StatusID = ?, ExitCode = ?, EndTime = ?, NodeCount = ?, CPUCount = ?, "
+            "UsedMemory = ?, UsedVirtMem = ?, UsedWalltime = ?, UsedCPUUserTime = ?, UsedCPUKernelTime = ?, "
+            "UsedScratch = ?, StageInVolume = ?, StageOutVolume = ? "
+            "WHERE RecordId = ?");
+        if (stmt) {
+            sql_bind(stmt, 1, aar.localid);
+            sql_bind_int(stmt, 2, statusid);
+            sql_bind_int(stmt, 3, aar.exitcode);
+            sql_bind_int(stmt, 4, aar.endtime.GetTime());
+            sql_bind_int(stmt, 5, aar.nodecount);
+            sql_bind_int(stmt, 6, aar.cpucount);
+            sql_bind_int(stmt, 7, aar.usedmemory);
+            sql_bind_int(stmt, 8, aar.usedvirtmemory);
+            sql_bind_int(stmt, 9, aar.usedwalltime);
+            sql_bind_int(stmt, 10, aar.usedcpuusertime);
+            sql_bind_int(stmt, 11, aar.usedcpukerneltime);
+            sql_bind_int(stmt, 12, aar.usedscratch);
+            sql_bind_int(stmt, 13, aar.stageinvolume);
+            sql_bind_int(stmt, 14, aar.stageoutvolume);
+            sql_bind_int(stmt, 15, recordid);
+        }
         // run update
-        if (!GeneralSQLUpdate(sql)) {
+        if (!GeneralSQLUpdate(stmt)) {
             logger.msg(Arc::ERROR, "Failed to update AAR in the database for job %s", aar.jobid);
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
             return false;
         }
         // write RTE info
@@ -481,100 +577,105 @@ namespace ARex {
 
     bool AccountingDBSQLite::writeRTEs(std::list <std::string>& rtes, unsigned int recordid) {
         if (rtes.empty()) return true;
-        std::string sql = "BEGIN TRANSACTION; ";
-        std::string sql_base = "INSERT INTO RunTimeEnvironments (RecordID, RTEName) VALUES ";
+        bool r = true;
         for (std::list<std::string>::iterator it=rtes.begin(); it != rtes.end(); ++it) {
-            sql += sql_base + "(" + sql_escape(recordid) + ", '" + sql_escape(*it) + "'); ";
-        }
-        sql += "COMMIT;";
-        if(!GeneralSQLInsert(sql)) {
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
-            return false;
+            sqlite3_stmt* stmt = db->statement("INSERT INTO RunTimeEnvironments (RecordID, RTEName) VALUES (?, ?)");
+            if (!stmt) return false;
+            sql_bind_int(stmt, 1, recordid);
+            sql_bind(stmt, 2, *it);
+            if (!GeneralSQLInsert(stmt)) r = false;
         }
-        return true;
+        return r;
     }
 
     bool AccountingDBSQLite::writeAuthTokenAttrs(std::list <aar_authtoken_t>& attrs, unsigned int recordid) {
         if (attrs.empty()) return true;
-        std::string sql = "BEGIN TRANSACTION; ";
-        std::string sql_base = "INSERT INTO AuthTokenAttributes (RecordID, AttrKey, AttrValue) VALUES ";
+        bool r = true;
         for (std::list <aar_authtoken_t>::iterator it=attrs.begin(); it!=attrs.end(); ++it) {
-            sql += sql_base + "(" + sql_escape(recordid) + ", '" + sql_escape(it->first) + "', '" +
-                   sql_escape(it->second) + "'); ";
-        }
-        sql += "COMMIT;";
-        if(!GeneralSQLInsert(sql)) {
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
-            return false;
+            sqlite3_stmt* stmt = db->statement("INSERT INTO AuthTokenAttributes (RecordID, AttrKey, AttrValue) VALUES (?, ?, ?)");
+            if (!stmt) return false;
+            sql_bind_int(stmt, 1, recordid);
+            sql_bind(stmt, 2, it->first);
+            sql_bind(stmt, 3, it->second);
+            if (!GeneralSQLInsert(stmt)) r = false;
         }
-        return true;
+        return r;
     }
 
     bool AccountingDBSQLite::writeExtraInfo(std::map <std::string, std::string>& info, unsigned int recordid) {
         if (info.empty()) return true;
-        std::string sql = "BEGIN TRANSACTION; ";
-        std::string sql_base = "INSERT INTO JobExtraInfo (RecordID, InfoKey, InfoValue) VALUES ";
+        bool r = true;
         for (std::map<std::string,std::string>::iterator it=info.begin(); it!=info.end(); ++it) {
-            sql += sql_base + "(" + sql_escape(recordid) + ", '" + sql_escape(it->first) + "', '" +
-                   sql_escape(it->second) + "'); ";
-        }
-        sql += "COMMIT;";
-        if(!GeneralSQLInsert(sql)) {
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
-            return false;
+            sqlite3_stmt* stmt = db->statement("INSERT INTO JobExtraInfo (RecordID, InfoKey, InfoValue) VALUES (?, ?, ?)");
+            if (!stmt) return false;
+            sql_bind_int(stmt, 1, recordid);
+            sql_bind(stmt, 2, it->first);
+            sql_bind(stmt, 3, it->second);
+            if (!GeneralSQLInsert(stmt)) r = false;
         }
-        return true;
+        return r;
     }
 
     bool AccountingDBSQLite::writeDTRs(std::list <aar_data_transfer_t>& dtrs, unsigned int recordid) {
         if (dtrs.empty()) return true;
-        std::string sql = "BEGIN TRANSACTION; ";
-        std::string sql_base = "INSERT INTO DataTransfers "
-            "(RecordID, URL, FileSize, TransferStart, TransferEnd, TransferType) VALUES ";
+        bool r = true;
         for (std::list<aar_data_transfer_t>::iterator it=dtrs.begin(); it != dtrs.end(); ++it) {
-            sql += sql_base + "( " + sql_escape(recordid) + ", '" + 
-                   sql_escape(it->url) + "', " +
-                   sql_escape(it->size) + ", " + 
-                   sql_escape(it->transferstart.GetTime()) + ", " + 
-                   sql_escape(it->transferend.GetTime()) + ", " + 
-                   sql_escape(static_cast<int>(it->type)) + "); ";
-        }
-        sql += "COMMIT;";
-        if(!GeneralSQLInsert(sql)) {
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
-            return false;
+            sqlite3_stmt* stmt = db->statement("INSERT INTO DataTransfers "
+                "(RecordID, URL, FileSize, TransferStart, TransferEnd, TransferType) VALUES (?, ?, ?, ?, ?, ?)");
+            if (!stmt) return false;
+            sql_bind_int(stmt, 1, recordid);
+            sql_bind(stmt, 2, it->url);
+            sql_bind_int(stmt, 3, it->size);
+            sql_bind_int(stmt, 4, it->transferstart.GetTime());
+            sql_bind_int(stmt, 5, it->transferend.GetTime());
+            sql_bind_int(stmt, 6, static_cast<int>(it->type));
+            if (!GeneralSQLInsert(stmt)) r = false;
         }
-        return true;
+        return r;
     }
 
     bool AccountingDBSQLite::writeEvents(std::list <aar_jobevent_t>& events, unsigned int recordid) {
         if (events.empty()) return true;
-        std::string sql = "BEGIN TRANSACTION; ";
-        std::string sql_base = "INSERT INTO JobEvents (RecordID, EventKey, EventTime) VALUES ";
+        bool r = true;
         for (std::list<aar_jobevent_t>::iterator it=events.begin(); it != events.end(); ++it) {
-            sql += sql_base + "( " + sql_escape(recordid) + ", '" + sql_escape(it->first) + "', '" +
-                   sql_escape(it->second) + "'); ";
-        }
-        sql += "COMMIT;";
-        if(!GeneralSQLInsert(sql)) {
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
-            return false;
+            sqlite3_stmt* stmt = db->statement("INSERT INTO JobEvents (RecordID, EventKey, EventTime) VALUES (?, ?, ?)");
+            if (!stmt) return false;
+            sql_bind_int(stmt, 1, recordid);
+            sql_bind(stmt, 2, it->first);
+            sql_bind(stmt, 3, it->second);
+            if (!GeneralSQLInsert(stmt)) r = false;
         }
-        return true;
+        return r;
     }
 
     bool AccountingDBSQLite::addJobEvent(aar_jobevent_t& event, const std::string& jobid) {
+        if (!isValid) return false;
+        Glib::Mutex::Lock lock(lock_);
+        initSQLiteDB();
+        Transaction transaction(db);
         unsigned int recordid = getAARDBId(jobid);
         if (!recordid) {
             logger.msg(Arc::ERROR, "Unable to add event: cannot find AAR for job %s in accounting database.", jobid);
             return false;
         }
-        std::string sql = "INSERT INTO JobEvents (RecordID, EventKey, EventTime) VALUES (" +
-            sql_escape(recordid) + ", '" + sql_escape(event.first) + "', '" + sql_escape(event.second) + "')";
-        if(!GeneralSQLInsert(sql)) {
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
-            return false;
-        }
-        return true;
+        sqlite3_stmt* stmt = db->statement("INSERT INTO JobEvents (RecordID, EventKey, EventTime) VALUES (?, ?, ?)");
+        if (!stmt) return false;
+        sql_bind_int(stmt, 1, recordid);
+        sql_bind(stmt, 2, event.first);
+        sql_bind(stmt, 3, event.second);
+        return (GeneralSQLInsert(stmt) != 0);
+    }
+
+    bool AccountingDBSQLite::begin() {
+        if (!isValid) return false;
+        Glib::Mutex::Lock lock(lock_);
+        initSQLiteDB();
+        return db->begin();
+    }
+
+    bool AccountingDBSQLite::commit() {
+        if (!isValid) return false;
+        Glib::Mutex::Lock lock(lock_);
+        return db->commit();
     }
 }
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <map>
+#include <set>
 #include <sqlite3.h>
 #include <arc/Logger.h>
 #include <arc/Thread.h>
@@ -24,6 +25,10 @@ namespace ARex {
         bool updateAAR(AAR& aar);
         /// Add job event record to AAR (any other state changes)
         bool addJobEvent(aar_jobevent_t& events, const std::string& jobid);
+        /// Start transaction grouping following operations
+        bool begin();
+        /// Commit transaction started by begin()
+        bool commit();
       private:
         static Arc::Logger logger;
         Glib::Mutex lock_;
@@ -34,6 +39,8 @@ namespace ARex {
         name_id_map_t db_status;
         // AAR specific structures representation
         std::map <aar_endpoint_t, unsigned int> db_endpoints;
+        // Tables already read into maps above
+        std::set <std::string> db_loaded;
         // Class to handle SQLite DB Operations
         class SQLiteDB {
         public:
@@ -43,21 +50,44 @@ namespace ARex {
             int changes(void) { return sqlite3_changes(aDB); }
             sqlite3_int64 insertID(void) { return sqlite3_last_insert_rowid(aDB); }
             int exec(const char *sql, int (*callback)(void*,int,char**,char**), void *arg, char **errmsg);
+            /// Returns prepared statement for sql, reset and ready for binding
+            /** Statements are prepared once and kept till connection is closed.
+                Returns NULL on error. */
+            sqlite3_stmt* statement(const std::string& sql);
+            /// Executes statement waiting if database is busy
+            /** Statement is reset unless SQLITE_ROW is returned. */
+            int step(sqlite3_stmt* stmt);
+            /// Start transaction. Nested calls are merged into outermost one.
+            bool begin(void);
+            /// Commit transaction when outermost begin() is matched.
+            bool commit(void);
             void logError(const char* errpfx, int err, Arc::LogLevel level = Arc::DEBUG);
         private:
             sqlite3* aDB;
+            std::map<std::string, sqlite3_stmt*> statements;
+            int transaction_depth;
+            bool transaction_started;
             void closeDB();
         };
 
+        // Keeps transaction open while in scope
+        class Transaction {
+        public:
+            Transaction(SQLiteDB* db): db_(db) { db_->begin(); }
+            ~Transaction() { db_->commit(); }
+        private:
+            SQLiteDB* db_;
+        };
+
         SQLiteDB* db;
         /// Initialize and close connection to SQLite database
         void initSQLiteDB(void);
         void closeSQLiteDB(void);
 
-        /// General helper to execute INSERT statement and return the autoincrement ID
-        unsigned int GeneralSQLInsert(const std::string& sql);
-        /// General helper to execute UPDATE statement
-        bool GeneralSQLUpdate(const std::string& sql);
+        /// General helper to execute prepared INSERT statement and return the autoincrement ID
+        unsigned int GeneralSQLInsert(sqlite3_stmt* stmt);
+        /// General helper to execute prepared UPDATE statement
+        bool GeneralSQLUpdate(sqlite3_stmt* stmt);
 
         /// General helper that return accounting database ID for requested iname 
         /** 
@@ -2,16 +2,95 @@
 #include <config.h>
 #endif
 
+#include <cstdlib>
 #include <iostream>
+#include <unistd.h>
+
+#include <arc/StringConv.h>
 
 #include "AccountingDBSQLite.h"
 #include "AAR.h"
 
+static double now(void) {
+    Glib::TimeVal t;
+    t.assign_current_time();
+    return t.as_double();
+}
+
+static void report(const char* name, int jobs, double start) {
+    double seconds = now() - start;
+    if (seconds <= 0) seconds = 1e-9;
+    // every job makes createAAR, 4 addJobEvent and updateAAR
+    std::cout << name << ": " << (long long int)(jobs * 6 / seconds) << " operations per second" << std::endl;
+}
+
+// Stores full life cycle of jobs committing every group jobs together.
+// group 0 means every operation is committed separately.
+static void write_jobs(ARex::AccountingDB& adb, const std::string& prefix, int jobs, int group) {
+    static const char* states[] = { "PREPARING", "SUBMIT", "INLRMS", "FINISHING" };
+    for (int n = 0; n < jobs; ++n) {
+        if (group && ((n % group) == 0)) adb.begin();
+        ARex::AAR aar;
+        aar.jobid = prefix + Arc::tostring(n);
+        aar.endpoint.interface = "org.ogf.glue.emies.activitycreation";
+        aar.endpoint.url = "https://arc.example.org:443/arex";
+        aar.queue = "grid";
+        aar.userdn = "/DC=org/DC=example/CN=User " + Arc::tostring(n % 50);
+        aar.wlcgvo = "vo" + Arc::tostring(n % 5);
+        aar.status = "in-progress";
+        aar.submittime = Arc::Time();
+        aar.authtokenattrs.push_back(ARex::aar_authtoken_t("vomsfqan", "/vo" + Arc::tostring(n % 5)));
+        aar.jobevents.push_back(ARex::aar_jobevent_t("ACCEPTED", Arc::Time()));
+        adb.createAAR(aar);
+        for (int s = 0; s < 4; ++s) {
+            ARex::aar_jobevent_t event(states[s], Arc::Time());
+            adb.addJobEvent(event, aar.jobid);
+        }
+        aar.jobevents.clear();
+        aar.jobevents.push_back(ARex::aar_jobevent_t("FINISHED", Arc::Time()));
+        aar.status = "completed";
+        aar.endtime = Arc::Time();
+        aar.usedwalltime = 3600;
+        aar.rtes.push_back("ENV/PROXY");
+        aar.extrainfo.insert(std::pair <std::string, std::string>("jobname", "bench"));
+        adb.updateAAR(aar);
+        if (group && (((n + 1) % group) == 0 || (n + 1) == jobs)) adb.commit();
+    }
+}
+
+// Usage: test_adb [number_of_jobs [database]]
+// Without arguments writes single AAR. With number of jobs measures rate of
+// writing when every operation is committed separately and in groups.
+static int bench(int jobs, const std::string& path) {
+    Arc::Logger::getRootLogger().setThreshold(Arc::ERROR);
+    (void)unlink(path.c_str());
+    (void)unlink((path + "-wal").c_str());
+    (void)unlink((path + "-shm").c_str());
+    ARex::AccountingDBSQLite adb(path);
+    if (!adb.IsValid()) {
+       std::cerr << "Database connection was not successfull" << std::endl;
+       return EXIT_FAILURE;
+    }
+    double start = now();
+    write_jobs(adb, "single", jobs, 0);
+    report("Committed separately", jobs, start);
+    start = now();
+    write_jobs(adb, "group", jobs, 100);
+    report("Committed in groups of 100 jobs", jobs, start);
+    return EXIT_SUCCESS;
+}
+
 int main(int argc, char **argv) {
     Arc::LogStream logcerr(std::cerr);
     Arc::Logger::getRootLogger().addDestination(logcerr);
     Arc::Logger::getRootLogger().setThreshold(Arc::DEBUG);
 
+    if (argc > 1) {
+        int jobs = atoi(argv[1]);
+        if (jobs <= 0) return EXIT_FAILURE;
+        return bench(jobs, (argc > 2) ? argv[2] : "/tmp/adb-bench.sqlite");
+    }
+
     ARex::AccountingDBSQLite adb("/tmp/adb.sqlite");
     if (!adb.IsValid()) {
        std::cerr << "Database connection was not successfull" << std::endl;
@@ -234,6 +234,13 @@ bool CoreConfig::ParseConfINI(GMConfig& config, Arc::ConfigFile& cfile) {
           }
           if (config.max_scripts < 0) config.max_scripts = -1;
         }
+        else if (command == "processingthreads") {
+          std::string threads_s = Arc::ConfigIni::NextArg(rest);
+          if (!Arc::stringto(threads_s, config.processing_threads)) {
+            logger.msg(Arc::ERROR, "Wrong number in processingthreads: %s", threads_s); return false;
+          }
+          if (config.processing_threads < 1) config.processing_threads = 1;
+        }
         else if(command == "norootpower") {
           if (!CheckYesNoCommand(config.strict_session, command, rest)) return false;
         }
@@ -364,6 +371,21 @@ bool CoreConfig::ParseConfINI(GMConfig& config, Arc::ConfigFile& cfile) {
             logger.msg(Arc::ERROR, "Wrong option in delegationdb"); return false;
           };
         }
+        else if (command == "controlstore") {
+          std::string s = Arc::ConfigIni::NextArg(rest);
+          if (s == "files") {
+            config.control_store = GMConfig::control_store_files;
+          }
+          else if (s == "sqlite") {
+            config.control_store = GMConfig::control_store_sqlite;
+          }
+          else {
+            logger.msg(Arc::ERROR, "Wrong option in controlstore"); return false;
+          };
+        }
+        else if (command == "controldirwatch") {
+          if (!CheckYesNoCommand(config.control_watch, command, rest)) return false;
+        }
         else if (command == "forcedefaultvoms") {
           std::string str = rest;
           if (str.empty()) {
@@ -408,6 +430,16 @@ bool CoreConfig::ParseConfINI(GMConfig& config, Arc::ConfigFile& cfile) {
 	      config.space_metrics->SetEnabled(true);
 	    };
           };
+        }
+        else if (command == "frequency") {
+          int period = 0;
+          if (!Arc::stringto(rest, period) || (period < 0)) {
+            logger.msg(Arc::ERROR, "Wrong number in frequency: %s", rest);
+            return false;
+          }
+          config.jobs_metrics->SetPeriod(period);
+          config.heartbeat_metrics->SetPeriod(period);
+          config.space_metrics->SetPeriod(period);
         };
       };
       continue;
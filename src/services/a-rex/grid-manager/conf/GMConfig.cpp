@@ -75,6 +75,8 @@ void GMConfig::SetDefaults() {
   jobs_metrics = NULL;
   heartbeat_metrics = NULL;
   space_metrics = NULL;
+  metrics_registry = NULL;
+  job_owner_index = NULL;
   job_perf_log = NULL;
   cont_plugins = NULL;
   delegations = NULL;
@@ -94,8 +96,11 @@ void GMConfig::SetDefaults() {
   max_jobs = -1;
   max_jobs_per_dn = -1;
   max_scripts = -1;
+  processing_threads = 1;
 
   deleg_db = deleg_db_sqlite;
+  control_store = control_store_files;
+  control_watch = true;
 
   enable_arc_interface = false;
   enable_emies_interface = false;
@@ -17,6 +17,8 @@ class JobLog;
 class JobsMetrics;
 class HeartBeatMetrics;
 class SpaceMetrics;
+class MetricsRegistry;
+class JobOwnerIndex;
 class ContinuationPlugins;
 class DelegationStores;
 
@@ -60,6 +62,12 @@ public:
     deleg_db_sqlite
   };
 
+  /// Where job states and marks are stored
+  enum control_store_t {
+    control_store_files,
+    control_store_sqlite
+  };
+
   /// Returns configuration file as guessed.
   /**
    * Guessing uses $ARC_CONFIG, $ARC_LOCATION/etc/arc.conf or the default
@@ -110,6 +118,10 @@ public:
 
   /// Set control directory
   void SetControlDir(const std::string &dir);
+  /// Set storage type for job states and marks
+  void SetControlStoreType(control_store_t type) { control_store = type; }
+  /// Set if changes in control directory are followed through notifications
+  void SetWatchControlDir(bool watch) { control_watch = watch; }
   /// Set session root dir
   void SetSessionRoot(const std::string &dir);
   /// Set multiple session root dirs
@@ -129,6 +141,10 @@ public:
   std::string DelegationDir() const;
   /// Database type to use for delegation storage
   deleg_db_t DelegationDBType() const;
+  /// Storage type for job states and marks
+  control_store_t ControlStoreType() const { return control_store; }
+  /// Whether changes in control directory are followed using kernel notifications
+  bool WatchControlDir() const { return control_watch; }
   /// Helper(s) log file path
   const std::string& HelperLog() const { return helper_log; }
 
@@ -145,6 +161,10 @@ public:
   void SetHeartBeatMetrics(HeartBeatMetrics* metrics) { heartbeat_metrics = metrics; }
   /// Set HeartBeatMetrics object
   void SetSpaceMetrics(SpaceMetrics* metrics) { space_metrics = metrics; }
+  /// Set MetricsRegistry object
+  void SetMetricsRegistry(MetricsRegistry* registry) { metrics_registry = registry; }
+  /// Set JobOwnerIndex object
+  void SetJobOwnerIndex(JobOwnerIndex* index) { job_owner_index = index; }
   /// Set ContinuationPlugins (plugins run at state transitions)
   void SetContPlugins(ContinuationPlugins* plugins) { cont_plugins = plugins; }
   /// Set DelegationStores object
@@ -157,6 +177,10 @@ public:
   HeartBeatMetrics* GetHeartBeatMetrics() const { return heartbeat_metrics; }
   /// SpaceMetrics object
   SpaceMetrics* GetSpaceMetrics() const { return space_metrics; }
+  /// MetricsRegistry object
+  MetricsRegistry* GetMetricsRegistry() const { return metrics_registry; }
+  /// States and owners of all jobs
+  JobOwnerIndex* GetJobOwnerIndex() const { return job_owner_index; }
   /// JobPerfLog object
   Arc::JobPerfLog* GetJobPerfLog() const { return job_perf_log; }
   /// Plugins run at state transitions
@@ -243,6 +267,8 @@ public:
   int MaxTotal() const { return max_jobs_total; }
   /// Max submit/cancel scripts 
   int MaxScripts() const { return max_scripts; }
+  /// Number of threads processing jobs state changes
+  int ProcessingThreads() const { return processing_threads; }
 
   /// Returns true if the shared uid matches the given uid
   bool MatchShareUid(uid_t suid) const { return ((share_uid==0) || (share_uid==suid)); };
@@ -278,6 +304,10 @@ private:
   HeartBeatMetrics* heartbeat_metrics;
   /// For reporting free space metric to ganglia
   SpaceMetrics* space_metrics;
+  /// In-process storage of all metrics
+  MetricsRegistry* metrics_registry;
+  /// States and owners of all jobs for listing by front-ends
+  JobOwnerIndex* job_owner_index;
   /// For logging performace/profiling information
   Arc::JobPerfLog* job_perf_log;
   /// Plugins run at certain state changes
@@ -351,6 +381,8 @@ private:
   int max_jobs_per_dn;
   /// Maximum submit/cancel scripts running
   int max_scripts;
+  /// Number of threads processing jobs state changes
+  int processing_threads;
 
   /// Whether WS-interface is enabled
   bool enable_arc_interface;
@@ -364,6 +396,10 @@ private:
   std::string arex_endpoint;
   /// Delegation db type
   deleg_db_t deleg_db;
+  /// Job states and marks storage type
+  control_store_t control_store;
+  /// Whether to use kernel notifications instead of periodic scanning of control directory
+  bool control_watch;
   /// Forced VOMS attribute for non-VOMS credentials per queue
   std::map<std::string,std::string> forced_voms;
   /// VOs authorized per queue
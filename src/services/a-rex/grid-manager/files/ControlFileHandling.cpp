@@ -14,6 +14,7 @@
 #include "../conf/GMConfig.h"
 #include "../jobs/GMJob.h"
 
+#include "JobStateStore.h"
 #include "ControlFileHandling.h"
 
 namespace ARex {
@@ -53,6 +54,11 @@ static bool job_state_write_file(const std::string &fname,job_state_t state,bool
 static bool job_mark_put(Arc::FileAccess& fa, const std::string &fname);
 static bool job_mark_remove(Arc::FileAccess& fa,const std::string &fname);
 
+static inline JobStateStore* state_store(const GMConfig &config) {
+  if(config.ControlStoreType() == GMConfig::control_store_files) return NULL;
+  return JobStateStore::Get(config);
+}
+
 
 bool fix_file_permissions(const std::string &fname,bool executable) {
   mode_t mode = S_IRUSR | S_IWUSR;
@@ -151,72 +157,114 @@ LRMSResult job_lrms_mark_read(const JobId &id,const GMConfig &config) {
 }
 
 bool job_cancel_mark_put(const GMJob &job,const GMConfig &config) {
+  JobStateStore* store = state_store(config);
+  if(store) return store->PutMark(job.get_id(),JobStateStore::MarkCancel);
   std::string fname = config.ControlDir() + "/" + subdir_new + "/job." + job.get_id() + sfx_cancel;
   return job_mark_put(fname) && fix_file_owner(fname,job) && fix_file_permissions(fname);
 }
 
 bool job_cancel_mark_check(const JobId &id,const GMConfig &config) {
+  JobStateStore* store = state_store(config);
+  if(store) return store->CheckMark(id,JobStateStore::MarkCancel);
   std::string fname = config.ControlDir() + "/" + subdir_new + "/job." + id + sfx_cancel;
   return job_mark_check(fname);
 }
 
 bool job_cancel_mark_remove(const JobId &id,const GMConfig &config) {
+  JobStateStore* store = state_store(config);
+  if(store) return store->RemoveMark(id,JobStateStore::MarkCancel);
   std::string fname = config.ControlDir() + "/" + subdir_new + "/job." + id + sfx_cancel;
   return job_mark_remove(fname);
 }
 
 bool job_restart_mark_put(const GMJob &job,const GMConfig &config) {
+  JobStateStore* store = state_store(config);
+  if(store) return store->PutMark(job.get_id(),JobStateStore::MarkRestart);
   std::string fname = config.ControlDir() + "/" + subdir_new + "/job." + job.get_id() + sfx_restart;
   return job_mark_put(fname) && fix_file_owner(fname,job) && fix_file_permissions(fname);
 }
 
 bool job_restart_mark_check(const JobId &id,const GMConfig &config) {
+  JobStateStore* store = state_store(config);
+  if(store) return store->CheckMark(id,JobStateStore::MarkRestart);
   std::string fname = config.ControlDir() + "/" + subdir_new + "/job." + id + sfx_restart;
   return job_mark_check(fname);
 }
 
 bool job_restart_mark_remove(const JobId &id,const GMConfig &config) {
+  JobStateStore* store = state_store(config);
+  if(store) return store->RemoveMark(id,JobStateStore::MarkRestart);
   std::string fname = config.ControlDir() + "/" + subdir_new + "/job." + id + sfx_restart;
   return job_mark_remove(fname);
 }
 
 bool job_clean_mark_put(const GMJob &job,const GMConfig &config) {
+  JobStateStore* store = state_store(config);
+  if(store) return store->PutMark(job.get_id(),JobStateStore::MarkClean);
   std::string fname = config.ControlDir() + "/" + subdir_new + "/job." + job.get_id() + sfx_clean;
   return job_mark_put(fname) && fix_file_owner(fname,job) && fix_file_permissions(fname);
 }
 
 bool job_clean_mark_check(const JobId &id,const GMConfig &config) {
+  JobStateStore* store = state_store(config);
+  if(store) return store->CheckMark(id,JobStateStore::MarkClean);
   std::string fname = config.ControlDir() + "/" + subdir_new + "/job." + id + sfx_clean;
   return job_mark_check(fname);
 }
 
 bool job_clean_mark_remove(const JobId &id,const GMConfig &config) {
+  JobStateStore* store = state_store(config);
+  if(store) return store->RemoveMark(id,JobStateStore::MarkClean);
   std::string fname = config.ControlDir() + "/" + subdir_new + "/job." + id + sfx_clean;
   return job_mark_remove(fname);
 }
 
+// With consolidated store failure mark is also written into file because
+// information system reads it. But it is never read back by A-REX.
 bool job_failed_mark_put(const GMJob &job,const GMConfig &config,const std::string &content) {
   std::string fname = config.ControlDir() + "/job." + job.get_id() + sfx_failed;
-  if(job_mark_size(fname) > 0) return true;
+  JobStateStore* store = state_store(config);
+  if(store) {
+    std::string old_content;
+    if(store->CheckMark(job.get_id(),JobStateStore::MarkFailed,&old_content) && !old_content.empty()) return true;
+    if(!store->PutMark(job.get_id(),JobStateStore::MarkFailed,content)) return false;
+  } else {
+    if(job_mark_size(fname) > 0) return true;
+  };
   return job_mark_write(fname,content) && fix_file_owner(fname,job) && fix_file_permissions(fname,job,config);
 }
 
 bool job_failed_mark_add(const GMJob &job,const GMConfig &config,const std::string &content) {
   std::string fname = config.ControlDir() + "/job." + job.get_id() + sfx_failed;
+  JobStateStore* store = state_store(config);
+  if(store && !store->AddMark(job.get_id(),JobStateStore::MarkFailed,content)) return false;
   return job_mark_add(fname,content) && fix_file_owner(fname,job) && fix_file_permissions(fname,job,config);
 }
 
 bool job_failed_mark_check(const JobId &id,const GMConfig &config) {
+  JobStateStore* store = state_store(config);
+  if(store) return store->CheckMark(id,JobStateStore::MarkFailed);
   std::string fname = config.ControlDir() + "/job." + id + sfx_failed;
   return job_mark_check(fname);
 }
 
 bool job_failed_mark_remove(const JobId &id,const GMConfig &config) {
   std::string fname = config.ControlDir() + "/job." + id + sfx_failed;
+  JobStateStore* store = state_store(config);
+  if(store) {
+    (void)job_mark_remove(fname);
+    return store->RemoveMark(id,JobStateStore::MarkFailed);
+  };
   return job_mark_remove(fname);
 }
 
 std::string job_failed_mark_read(const JobId &id,const GMConfig &config) {
+  JobStateStore* store = state_store(config);
+  if(store) {
+    std::string content;
+    (void)store->CheckMark(id,JobStateStore::MarkFailed,&content);
+    return content;
+  };
   std::string fname = config.ControlDir() + "/job." + id + sfx_failed;
   return job_mark_read(fname);
 }
@@ -389,6 +437,12 @@ std::string job_errors_filename(const JobId &id, const GMConfig &config) {
 
 
 time_t job_state_time(const JobId &id,const GMConfig &config) {
+  JobStateStore* store = state_store(config);
+  if(store) {
+    JobStateStore::Record rec;
+    if(!store->ReadState(id,rec)) return 0;
+    return rec.modified;
+  };
   std::string fname = config.ControlDir() + "/job." + id + sfx_status;
   time_t t = job_mark_time(fname);
   if(t != 0) return t;
@@ -411,6 +465,13 @@ job_state_t job_state_read_file(const JobId &id,const GMConfig &config) {
 }
 
 job_state_t job_state_read_file(const JobId &id,const GMConfig &config,bool& pending) {
+  JobStateStore* store = state_store(config);
+  if(store) {
+    JobStateStore::Record rec;
+    if(!store->ReadState(id,rec)) return JOB_STATE_DELETED; /* job does not exist */
+    pending = rec.pending;
+    return rec.state;
+  };
   std::string fname = config.ControlDir() + "/job." + id + sfx_status;
   job_state_t st = job_state_read_file(fname,pending);
   if(st != JOB_STATE_DELETED) return st;
@@ -427,8 +488,32 @@ job_state_t job_state_read_file(const JobId &id,const GMConfig &config,bool& pen
   return job_state_read_file(fname,pending);
 }
 
+static const char* store_group_subdir(JobStateStore::group_t group) {
+  switch(group) {
+    case JobStateStore::GroupNew: return subdir_new;
+    case JobStateStore::GroupCurrent: return subdir_cur;
+    case JobStateStore::GroupOld: return subdir_old;
+    case JobStateStore::GroupRestarting: return subdir_rew;
+    default: break;
+  };
+  return NULL;
+}
+
 bool job_state_write_file(const GMJob &job,const GMConfig &config,job_state_t state,bool pending) {
   std::string fname;
+  JobStateStore* store = state_store(config);
+  if(store) {
+    // Store is authoritative. Status file is only kept for external readers
+    // and store tells where previous one is, so no need to try all locations.
+    JobStateStore::group_t old_group;
+    if(!store->WriteState(job.get_id(),job.get_user().get_uid(),job.get_user().get_gid(),state,pending,old_group)) return false;
+    JobStateStore::group_t new_group = JobStateStore::StateGroup(state);
+    if((old_group != new_group) && store_group_subdir(old_group)) {
+      fname = config.ControlDir() + "/" + store_group_subdir(old_group) + "/job." + job.get_id() + sfx_status; remove(fname.c_str());
+    };
+    fname = config.ControlDir() + "/" + store_group_subdir(new_group) + "/job." + job.get_id() + sfx_status;
+    return job_state_write_file(fname,state,pending) && fix_file_owner(fname,job) && fix_file_permissions(fname,job,config);
+  };
   if(state == JOB_STATE_ACCEPTED) { 
     fname = config.ControlDir() + "/" + subdir_old + "/job." + job.get_id() + sfx_status; remove(fname.c_str());
     fname = config.ControlDir() + "/" + subdir_cur + "/job." + job.get_id() + sfx_status; remove(fname.c_str());
@@ -566,6 +651,12 @@ bool job_local_read_delegationid(const JobId &id,const GMConfig &config,std::str
   return true;
 }
 
+bool job_local_read_subject(const JobId &id,const GMConfig &config,std::string &dn) {
+  std::string fname = config.ControlDir() + "/job." + id + sfx_local;
+  if(!job_local_read_var(fname,"subject",dn)) return false;
+  return true;
+}
+
 /* job.ID.input functions */
 
 bool job_input_write_file(const GMJob &job,const GMConfig &config,std::list<FileData> &files) {
@@ -724,6 +815,12 @@ bool job_clean_deleted(const GMJob &job,const GMConfig &config,std::list<std::st
   fname = config.ControlDir()+"/job."+id+sfx_errors; remove(fname.c_str());
   fname = config.ControlDir()+"/"+subdir_new+"/job."+id+sfx_cancel; remove(fname.c_str());
   fname = config.ControlDir()+"/"+subdir_new+"/job."+id+sfx_clean;  remove(fname.c_str());
+  JobStateStore* store = state_store(config);
+  if(store) {
+    (void)store->RemoveMark(id,JobStateStore::MarkRestart);
+    (void)store->RemoveMark(id,JobStateStore::MarkCancel);
+    (void)store->RemoveMark(id,JobStateStore::MarkClean);
+  };
   fname = config.ControlDir()+"/job."+id+sfx_output; remove(fname.c_str());
   fname = config.ControlDir()+"/job."+id+sfx_input; remove(fname.c_str());
   fname = config.ControlDir()+"/job."+id+".grami_log"; remove(fname.c_str());
@@ -763,6 +860,8 @@ bool job_clean_final(const GMJob &job,const GMConfig &config) {
   fname = config.ControlDir()+"/"+subdir_rew+"/job."+id+sfx_status; remove(fname.c_str());
   fname = config.ControlDir()+"/job."+id+sfx_desc; remove(fname.c_str());
   fname = config.ControlDir()+"/job."+id+sfx_xml; remove(fname.c_str());
+  JobStateStore* store = state_store(config);
+  if(store) (void)store->RemoveJob(id);
   return true;
 }
 
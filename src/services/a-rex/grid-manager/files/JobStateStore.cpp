@@ -0,0 +1,401 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <map>
+#include <cstring>
+#include <time.h>
+
+#include <sqlite3.h>
+
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+
+#include "../conf/GMConfig.h"
+
+#include "JobStateStore.h"
+
+namespace ARex {
+
+static Arc::Logger logger(Arc::Logger::getRootLogger(), "JobStateStore");
+
+#define JOB_STATE_STORE_NAME "jobstates.db"
+
+JobStateStore::JobStateStore(const std::string& fname, bool create):db_(NULL),transaction_depth_(0),rollback_requested_(false) {
+  int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_FULLMUTEX;
+  if(create) flags |= SQLITE_OPEN_CREATE;
+  int err;
+  while((err = sqlite3_open_v2(fname.c_str(), &db_, flags, NULL)) == SQLITE_BUSY) {
+    if(db_) (void)sqlite3_close(db_);
+    db_ = NULL;
+    struct timespec delay = { 0, 10000000 }; // 0.01s
+    (void)::nanosleep(&delay, NULL);
+  };
+  if(!dberr("Error opening database", err)) {
+    if(db_) (void)sqlite3_close(db_);
+    db_ = NULL;
+    return;
+  };
+  // Other process may be writing. Operations are short, so let SQLite wait.
+  (void)sqlite3_busy_timeout(db_, BusyTimeout);
+  // Database is shared by several processes. Write-ahead log lets readers
+  // proceed while state is being written. Loosing last transactions on power
+  // loss is same as loosing not yet flushed files.
+  (void)exec("PRAGMA journal_mode=WAL");
+  (void)exec("PRAGMA synchronous=NORMAL");
+  if(create) {
+    if(!dberr("Error creating table jobs", exec(
+         "CREATE TABLE IF NOT EXISTS jobs(id TEXT PRIMARY KEY, state INTEGER, pending INTEGER, "
+         "grp INTEGER, uid INTEGER, gid INTEGER, modified INTEGER)")) ||
+       !dberr("Error creating index on group", exec(
+         "CREATE INDEX IF NOT EXISTS jobs_grp ON jobs(grp)")) ||
+       !dberr("Error creating index on state", exec(
+         "CREATE INDEX IF NOT EXISTS jobs_state ON jobs(state)")) ||
+       !dberr("Error creating table marks", exec(
+         "CREATE TABLE IF NOT EXISTS marks(id TEXT, mark INTEGER, content TEXT, modified INTEGER, "
+         "PRIMARY KEY(id, mark))")) ||
+       !dberr("Error creating index on mark", exec(
+         "CREATE INDEX IF NOT EXISTS marks_mark ON marks(mark)"))) {
+      (void)sqlite3_close(db_);
+      db_ = NULL;
+      return;
+    };
+  } else {
+    // SQLite opens database in lazy way. But we still want to know if it is good database.
+    if(!dberr("Error checking database", exec("PRAGMA schema_version"))) {
+      (void)sqlite3_close(db_);
+      db_ = NULL;
+      return;
+    };
+  };
+}
+
+JobStateStore::~JobStateStore(void) {
+  for(std::map<std::string, sqlite3_stmt*>::iterator s = statements_.begin(); s != statements_.end(); ++s) {
+    (void)sqlite3_finalize(s->second);
+  };
+  statements_.clear();
+  if(db_) (void)sqlite3_close(db_);
+  db_ = NULL;
+}
+
+bool JobStateStore::dberr(const char* s, int err) {
+  if((err == SQLITE_OK) || (err == SQLITE_DONE) || (err == SQLITE_ROW)) return true;
+#ifdef HAVE_SQLITE3_ERRSTR
+  error_str_ = std::string(s)+": "+sqlite3_errstr(err);
+#else
+  error_str_ = std::string(s)+": error code "+Arc::tostring(err);
+#endif
+  logger.msg(Arc::ERROR, "%s", error_str_);
+  return false;
+}
+
+int JobStateStore::exec(const char* sql) {
+  return sqlite3_exec(db_, sql, NULL, NULL, NULL);
+}
+
+sqlite3_stmt* JobStateStore::statement(const char* sql) {
+  std::map<std::string, sqlite3_stmt*>::iterator s = statements_.find(sql);
+  if(s != statements_.end()) {
+    (void)sqlite3_reset(s->second);
+    (void)sqlite3_clear_bindings(s->second);
+    return s->second;
+  };
+  sqlite3_stmt* stmt = NULL;
+  if(!dberr("Failed to prepare statement", sqlite3_prepare_v2(db_, sql, -1, &stmt, NULL))) return NULL;
+  statements_[sql] = stmt;
+  return stmt;
+}
+
+int JobStateStore::step(sqlite3_stmt* stmt) {
+  int err = sqlite3_step(stmt);
+  // Reset releases read lock held by statement
+  if(err != SQLITE_ROW) (void)sqlite3_reset(stmt);
+  return err;
+}
+
+bool JobStateStore::begin_locked(void) {
+  if(transaction_depth_++ > 0) return true;
+  rollback_requested_ = false;
+  // Take write lock immediately so that reading and writing inside
+  // transaction is not interleaved with other processes
+  if(dberr("Failed to start transaction", exec("BEGIN IMMEDIATE"))) return true;
+  transaction_depth_ = 0;
+  return false;
+}
+
+bool JobStateStore::commit_locked(void) {
+  if(transaction_depth_ <= 0) return false;
+  if(--transaction_depth_ > 0) return !rollback_requested_;
+  if(rollback_requested_) {
+    // Something inside failed - partial modifications must not be stored
+    rollback_requested_ = false;
+    (void)exec("ROLLBACK");
+    error_str_ = "Transaction rolled back because of earlier failure";
+    logger.msg(Arc::ERROR, "%s", error_str_);
+    return false;
+  };
+  if(dberr("Failed to commit transaction", exec("COMMIT"))) return true;
+  (void)exec("ROLLBACK");
+  return false;
+}
+
+void JobStateStore::rollback_locked(void) {
+  if(transaction_depth_ <= 0) return;
+  // Nested failure makes outermost transaction roll back
+  rollback_requested_ = true;
+  if(--transaction_depth_ > 0) return;
+  rollback_requested_ = false;
+  (void)exec("ROLLBACK");
+}
+
+static bool BindText(sqlite3_stmt* stmt, int idx, const std::string& str) {
+  return (sqlite3_bind_text(stmt, idx, str.c_str(), str.length(), SQLITE_TRANSIENT) == SQLITE_OK);
+}
+
+static bool BindInt(sqlite3_stmt* stmt, int idx, sqlite3_int64 num) {
+  return (sqlite3_bind_int64(stmt, idx, num) == SQLITE_OK);
+}
+
+std::string JobStateStore::Path(const std::string& control_dir) {
+  return control_dir + "/" + JOB_STATE_STORE_NAME;
+}
+
+JobStateStore* JobStateStore::Get(const GMConfig& config) {
+  if(config.ControlStoreType() != GMConfig::control_store_sqlite) return NULL;
+  static Glib::Mutex stores_lock;
+  static std::map<std::string,JobStateStore*> stores;
+  Glib::Mutex::Lock lock(stores_lock);
+  std::map<std::string,JobStateStore*>::iterator s = stores.find(config.ControlDir());
+  if(s != stores.end()) return s->second;
+  JobStateStore* store = new JobStateStore(Path(config.ControlDir()));
+  if(!*store) {
+    // Not remembered - next call tries again
+    logger.msg(Arc::ERROR, "Failed to open job state database in %s: %s", config.ControlDir(), store->Error());
+    delete store;
+    return NULL;
+  };
+  stores[config.ControlDir()] = store;
+  return store;
+}
+
+JobStateStore::group_t JobStateStore::StateGroup(job_state_t state) {
+  if(state == JOB_STATE_ACCEPTED) return GroupNew;
+  if((state == JOB_STATE_FINISHED) || (state == JOB_STATE_DELETED)) return GroupOld;
+  return GroupCurrent;
+}
+
+static void ReadRecord(sqlite3_stmt* stmt, JobStateStore::Record& rec) {
+  int colnum = sqlite3_column_count(stmt);
+  for(int n = 0; n < colnum; ++n) {
+    const char* name = sqlite3_column_name(stmt, n);
+    if(!name || (sqlite3_column_type(stmt, n) == SQLITE_NULL)) continue;
+    if(strcmp(name, "id") == 0) {
+      const char* text = (const char*)sqlite3_column_text(stmt, n);
+      if(text) rec.id = text;
+    } else if(strcmp(name, "state") == 0) {
+      rec.state = (job_state_t)sqlite3_column_int(stmt, n);
+    } else if(strcmp(name, "pending") == 0) {
+      rec.pending = (sqlite3_column_int(stmt, n) != 0);
+    } else if(strcmp(name, "grp") == 0) {
+      rec.group = (JobStateStore::group_t)sqlite3_column_int(stmt, n);
+    } else if(strcmp(name, "uid") == 0) {
+      rec.uid = (uid_t)sqlite3_column_int64(stmt, n);
+    } else if(strcmp(name, "gid") == 0) {
+      rec.gid = (gid_t)sqlite3_column_int64(stmt, n);
+    } else if(strcmp(name, "modified") == 0) {
+      rec.modified = (time_t)sqlite3_column_int64(stmt, n);
+    };
+  };
+}
+
+// Must be called with lock_ held and parameters bound
+bool JobStateStore::ListRecords(sqlite3_stmt* stmt, std::list<Record>& recs) {
+  int err;
+  while((err = step(stmt)) == SQLITE_ROW) {
+    recs.push_back(Record());
+    ReadRecord(stmt, recs.back());
+  };
+  return dberr("Failed to query database", err);
+}
+
+#define JOB_COLUMNS "id, state, pending, grp, uid, gid, modified"
+
+bool JobStateStore::WriteState(const JobId& id, uid_t uid, gid_t gid, job_state_t state, bool pending, group_t& old_group) {
+  old_group = GroupNone;
+  if(!db_) return false;
+  Glib::RecMutex::Lock lock(lock_);
+  // Reading old group and writing new state must not be interleaved with other processes
+  if(!begin_locked()) return false;
+  std::list<Record> recs;
+  sqlite3_stmt* stmt = statement("SELECT grp FROM jobs WHERE id = ?");
+  if(!stmt || !BindText(stmt, 1, id) || !ListRecords(stmt, recs)) {
+    rollback_locked();
+    return false;
+  };
+  if(!recs.empty()) old_group = recs.front().group;
+  stmt = statement("INSERT OR REPLACE INTO jobs(" JOB_COLUMNS ") VALUES (?, ?, ?, ?, ?, ?, ?)");
+  if(!stmt || !BindText(stmt, 1, id) || !BindInt(stmt, 2, state) || !BindInt(stmt, 3, pending ? 1 : 0) ||
+     !BindInt(stmt, 4, StateGroup(state)) || !BindInt(stmt, 5, uid) || !BindInt(stmt, 6, gid) ||
+     !BindInt(stmt, 7, time(NULL)) || !dberr("Failed to store job state", step(stmt))) {
+    rollback_locked();
+    return false;
+  };
+  return commit_locked();
+}
+
+bool JobStateStore::WriteRecord(const Record& rec) {
+  if(!db_) return false;
+  Glib::RecMutex::Lock lock(lock_);
+  sqlite3_stmt* stmt = statement("INSERT OR REPLACE INTO jobs(" JOB_COLUMNS ") VALUES (?, ?, ?, ?, ?, ?, ?)");
+  if(!stmt || !BindText(stmt, 1, rec.id) || !BindInt(stmt, 2, rec.state) || !BindInt(stmt, 3, rec.pending ? 1 : 0) ||
+     !BindInt(stmt, 4, rec.group) || !BindInt(stmt, 5, rec.uid) || !BindInt(stmt, 6, rec.gid) ||
+     !BindInt(stmt, 7, rec.modified)) return false;
+  return dberr("Failed to store job state", step(stmt));
+}
+
+bool JobStateStore::ReadState(const JobId& id, Record& rec) {
+  if(!db_) return false;
+  std::list<Record> recs;
+  Glib::RecMutex::Lock lock(lock_);
+  sqlite3_stmt* stmt = statement("SELECT " JOB_COLUMNS " FROM jobs WHERE id = ?");
+  if(!stmt || !BindText(stmt, 1, id) || !ListRecords(stmt, recs)) return false;
+  if(recs.empty()) return false;
+  rec = recs.front();
+  return true;
+}
+
+bool JobStateStore::SetGroup(const JobId& id, group_t group) {
+  if(!db_) return false;
+  Glib::RecMutex::Lock lock(lock_);
+  sqlite3_stmt* stmt = statement("UPDATE jobs SET grp = ? WHERE id = ?");
+  if(!stmt || !BindInt(stmt, 1, group) || !BindText(stmt, 2, id)) return false;
+  if(!dberr("Failed to update job", step(stmt))) return false;
+  return (sqlite3_changes(db_) > 0);
+}
+
+bool JobStateStore::RemoveJob(const JobId& id) {
+  if(!db_) return false;
+  Glib::RecMutex::Lock lock(lock_);
+  if(!begin_locked()) return false;
+  sqlite3_stmt* stmt = statement("DELETE FROM marks WHERE id = ?");
+  if(!stmt || !BindText(stmt, 1, id) || !dberr("Failed to remove job", step(stmt))) {
+    rollback_locked();
+    return false;
+  };
+  stmt = statement("DELETE FROM jobs WHERE id = ?");
+  if(!stmt || !BindText(stmt, 1, id) || !dberr("Failed to remove job", step(stmt))) {
+    rollback_locked();
+    return false;
+  };
+  return commit_locked();
+}
+
+bool JobStateStore::ListGroup(group_t group, std::list<Record>& recs) {
+  if(!db_) return false;
+  Glib::RecMutex::Lock lock(lock_);
+  sqlite3_stmt* stmt = statement("SELECT " JOB_COLUMNS " FROM jobs WHERE grp = ?");
+  if(!stmt || !BindInt(stmt, 1, group)) return false;
+  return ListRecords(stmt, recs);
+}
+
+bool JobStateStore::ListState(job_state_t state, std::list<Record>& recs) {
+  if(!db_) return false;
+  Glib::RecMutex::Lock lock(lock_);
+  sqlite3_stmt* stmt = statement("SELECT " JOB_COLUMNS " FROM jobs WHERE state = ?");
+  if(!stmt || !BindInt(stmt, 1, state)) return false;
+  return ListRecords(stmt, recs);
+}
+
+bool JobStateStore::PutMark(const JobId& id, mark_t mark, const std::string& content) {
+  if(!db_) return false;
+  Glib::RecMutex::Lock lock(lock_);
+  sqlite3_stmt* stmt = statement("INSERT OR REPLACE INTO marks(id, mark, content, modified) VALUES (?, ?, ?, ?)");
+  if(!stmt || !BindText(stmt, 1, id) || !BindInt(stmt, 2, mark) || !BindText(stmt, 3, content) ||
+     !BindInt(stmt, 4, time(NULL))) return false;
+  return dberr("Failed to store mark", step(stmt));
+}
+
+bool JobStateStore::AddMark(const JobId& id, mark_t mark, const std::string& content) {
+  if(!db_) return false;
+  Glib::RecMutex::Lock lock(lock_);
+  if(!begin_locked()) return false;
+  sqlite3_stmt* stmt = statement("INSERT OR IGNORE INTO marks(id, mark, content, modified) VALUES (?, ?, '', ?)");
+  if(!stmt || !BindText(stmt, 1, id) || !BindInt(stmt, 2, mark) || !BindInt(stmt, 3, time(NULL)) ||
+     !dberr("Failed to store mark", step(stmt))) {
+    rollback_locked();
+    return false;
+  };
+  stmt = statement("UPDATE marks SET content = content || ? WHERE id = ? AND mark = ?");
+  if(!stmt || !BindText(stmt, 1, content) || !BindText(stmt, 2, id) || !BindInt(stmt, 3, mark) ||
+     !dberr("Failed to store mark", step(stmt))) {
+    rollback_locked();
+    return false;
+  };
+  return commit_locked();
+}
+
+bool JobStateStore::CheckMark(const JobId& id, mark_t mark, std::string* content) {
+  if(!db_) return false;
+  Glib::RecMutex::Lock lock(lock_);
+  sqlite3_stmt* stmt = statement("SELECT content FROM marks WHERE id = ? AND mark = ?");
+  if(!stmt || !BindText(stmt, 1, id) || !BindInt(stmt, 2, mark)) return false;
+  int err = step(stmt);
+  if(err != SQLITE_ROW) {
+    (void)dberr("Failed to query database", err);
+    return false;
+  };
+  if(content) {
+    const char* text = (const char*)sqlite3_column_text(stmt, 0);
+    *content = text ? text : "";
+  };
+  (void)sqlite3_reset(stmt);
+  return true;
+}
+
+bool JobStateStore::RemoveMark(const JobId& id, mark_t mark) {
+  if(!db_) return false;
+  Glib::RecMutex::Lock lock(lock_);
+  sqlite3_stmt* stmt = statement("DELETE FROM marks WHERE id = ? AND mark = ?");
+  if(!stmt || !BindText(stmt, 1, id) || !BindInt(stmt, 2, mark)) return false;
+  if(!dberr("Failed to remove mark", step(stmt))) return false;
+  return (sqlite3_changes(db_) > 0);
+}
+
+bool JobStateStore::ListMarks(mark_t mark, std::list<Record>& recs) {
+  if(!db_) return false;
+  Glib::RecMutex::Lock lock(lock_);
+  sqlite3_stmt* stmt = statement("SELECT marks.id AS id, jobs.uid AS uid, jobs.gid AS gid, marks.modified AS modified "
+                                 "FROM marks LEFT JOIN jobs ON marks.id = jobs.id WHERE marks.mark = ?");
+  if(!stmt || !BindInt(stmt, 1, mark)) return false;
+  return ListRecords(stmt, recs);
+}
+
+bool JobStateStore::Begin(void) {
+  if(!db_) return false;
+  // Lock is kept till matching Commit() or Rollback()
+  lock_.lock();
+  if(begin_locked()) return true;
+  lock_.unlock();
+  return false;
+}
+
+bool JobStateStore::Commit(void) {
+  if(!db_) return false;
+  Glib::RecMutex::Lock lock(lock_);
+  // Transaction, if any, belongs to this thread because it holds lock
+  if(transaction_depth_ <= 0) return false;
+  bool result = commit_locked();
+  lock_.unlock();
+  return result;
+}
+
+void JobStateStore::Rollback(void) {
+  if(!db_) return;
+  Glib::RecMutex::Lock lock(lock_);
+  if(transaction_depth_ <= 0) return;
+  rollback_locked();
+  lock_.unlock();
+}
+
+} // namespace ARex
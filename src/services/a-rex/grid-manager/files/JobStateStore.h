@@ -0,0 +1,154 @@
+#ifndef GRID_MANAGER_JOB_STATE_STORE_H
+#define GRID_MANAGER_JOB_STATE_STORE_H
+
+#include <string>
+#include <list>
+#include <map>
+
+#include <arc/Thread.h>
+
+#include "../jobs/GMJob.h"
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace ARex {
+
+class GMConfig;
+
+/// Keeps states and marks of all jobs in single SQLite database.
+/** This is alternative to keeping every state and mark in separate file in
+   control directory. Jobs are indexed by group which corresponds to
+   subdirectory their status file would reside in and by state. Marks are
+   indexed by their type. So scanning for jobs and marks does not require
+   reading directories and stat'ing every file.
+   Database is stored in control directory and may be shared by several
+   processes (A-REX, gm-jobs, gridftp job plugin). */
+class JobStateStore {
+ public:
+  /// Groups of jobs matching subdirectories of control directory.
+  enum group_t {
+    GroupNew = 0,        // accepting
+    GroupCurrent = 1,    // processing
+    GroupOld = 2,        // finished
+    GroupRestarting = 3, // restarting
+    GroupNone = -1
+  };
+
+  /// Types of marks
+  enum mark_t {
+    MarkCancel = 0,
+    MarkRestart = 1,
+    MarkClean = 2,
+    MarkFailed = 3
+  };
+
+  /// Information about stored job
+  class Record {
+   public:
+    JobId id;
+    job_state_t state;
+    bool pending;
+    group_t group;
+    uid_t uid;
+    gid_t gid;
+    time_t modified; // time of last state change or of mark creation
+    Record(void):state(JOB_STATE_UNDEFINED),pending(false),group(GroupNone),uid(0),gid(0),modified(0) {};
+  };
+
+  /// Opens or creates database stored in file fname.
+  JobStateStore(const std::string& fname, bool create = true);
+  ~JobStateStore(void);
+
+  operator bool(void) const { return (db_ != NULL); };
+  bool operator!(void) const { return (db_ == NULL); };
+  const std::string& Error(void) const { return error_str_; };
+
+  /// Returns store shared by all users of specified configuration.
+  /** Returns NULL if configuration does not request consolidated store
+     or if database could not be opened. Failed opening is retried on
+     next call. Stores are kept till process exits. */
+  static JobStateStore* Get(const GMConfig& config);
+
+  /// Returns path of database file for specified control directory.
+  static std::string Path(const std::string& control_dir);
+
+  /// Group in which job in specified state is kept.
+  static group_t StateGroup(job_state_t state);
+
+  /// Stores state of job and moves it to group matching new state.
+  /** Previous group of job or GroupNone is returned in old_group. */
+  bool WriteState(const JobId& id, uid_t uid, gid_t gid, job_state_t state, bool pending, group_t& old_group);
+
+  /// Stores all information about job as is. Used for importing jobs.
+  bool WriteRecord(const Record& rec);
+
+  /// Fetches information about job. Returns false if job is not stored.
+  bool ReadState(const JobId& id, Record& rec);
+
+  /// Moves job to another group without changing its state.
+  bool SetGroup(const JobId& id, group_t group);
+
+  /// Removes job and all its marks.
+  bool RemoveJob(const JobId& id);
+
+  /// Collects all jobs belonging to specified group.
+  bool ListGroup(group_t group, std::list<Record>& recs);
+
+  /// Collects all jobs in specified state.
+  bool ListState(job_state_t state, std::list<Record>& recs);
+
+  /// Creates mark or replaces its content.
+  bool PutMark(const JobId& id, mark_t mark, const std::string& content = "");
+
+  /// Appends to content of mark creating it if needed.
+  bool AddMark(const JobId& id, mark_t mark, const std::string& content);
+
+  /// Returns true if mark exists. Optionally provides its content.
+  bool CheckMark(const JobId& id, mark_t mark, std::string* content = NULL);
+
+  bool RemoveMark(const JobId& id, mark_t mark);
+
+  /// Collects jobs having specified mark.
+  /** Owner of job and time of mark creation are filled in records. State
+     is not filled. */
+  bool ListMarks(mark_t mark, std::list<Record>& recs);
+
+  /// Groups many modifications into one transaction.
+  /** Calls may be nested. Modifications are committed by outermost Commit().
+     Methods which need own transaction join the open one. Transaction
+     belongs to calling thread - other threads wait till it is finished. */
+  bool Begin(void);
+  /// Ends transaction. Returns false if anything in it failed and it was rolled back.
+  bool Commit(void);
+  /// Ends transaction and makes outermost one roll back.
+  void Rollback(void);
+
+  /// Time in milliseconds to wait for other process holding database lock.
+  static const int BusyTimeout = 60000;
+
+ private:
+  // Held by thread which opened transaction till it is finished
+  Glib::RecMutex lock_;
+  sqlite3* db_;
+  std::string error_str_;
+  std::map<std::string, sqlite3_stmt*> statements_;
+  int transaction_depth_;
+  bool rollback_requested_;
+
+  int exec(const char* sql);
+  sqlite3_stmt* statement(const char* sql);
+  int step(sqlite3_stmt* stmt);
+  bool dberr(const char* s, int err);
+  bool begin_locked(void);
+  bool commit_locked(void);
+  void rollback_locked(void);
+  bool ListRecords(sqlite3_stmt* stmt, std::list<Record>& recs);
+
+  JobStateStore(const JobStateStore&);
+  JobStateStore& operator=(const JobStateStore&);
+};
+
+} // namespace ARex
+
+#endif
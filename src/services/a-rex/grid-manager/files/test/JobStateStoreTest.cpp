@@ -0,0 +1,258 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string>
+#include <list>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <arc/FileUtils.h>
+#include <arc/Thread.h>
+
+#include "../../conf/GMConfig.h"
+#include "../JobStateStore.h"
+
+using namespace ARex;
+
+class JobStateStoreTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(JobStateStoreTest);
+  CPPUNIT_TEST(TestStates);
+  CPPUNIT_TEST(TestMarks);
+  CPPUNIT_TEST(TestTransaction);
+  CPPUNIT_TEST(TestTransactionThreads);
+  CPPUNIT_TEST(TestGet);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+  void TestStates();
+  void TestMarks();
+  void TestTransaction();
+  void TestTransactionThreads();
+  void TestGet();
+
+private:
+  std::string dir;
+};
+
+// Writes job state from other thread
+class StateWriter {
+ public:
+  StateWriter(JobStateStore& store): store(store), written(false) {}
+  static void Write(void* arg) {
+    StateWriter& writer = *reinterpret_cast<StateWriter*>(arg);
+    JobStateStore::group_t old_group;
+    bool result = writer.store.WriteState("job3", 100, 200, JOB_STATE_ACCEPTED, false, old_group);
+    Glib::Mutex::Lock lock(writer.lock);
+    writer.written = result;
+  }
+  bool Written() {
+    Glib::Mutex::Lock lock(this->lock);
+    return written;
+  }
+  JobStateStore& store;
+ private:
+  Glib::Mutex lock;
+  bool written;
+};
+
+void JobStateStoreTest::setUp() {
+  CPPUNIT_ASSERT(Arc::TmpDirCreate(dir));
+}
+
+void JobStateStoreTest::tearDown() {
+  Arc::DirDelete(dir, true);
+}
+
+void JobStateStoreTest::TestStates() {
+  JobStateStore store(JobStateStore::Path(dir));
+  CPPUNIT_ASSERT(store);
+
+  JobStateStore::group_t old_group;
+  CPPUNIT_ASSERT(store.WriteState("job1", 100, 200, JOB_STATE_ACCEPTED, false, old_group));
+  CPPUNIT_ASSERT_EQUAL(JobStateStore::GroupNone, old_group);
+  CPPUNIT_ASSERT(store.WriteState("job2", 101, 201, JOB_STATE_INLRMS, true, old_group));
+  // Quotes must survive round trip
+  CPPUNIT_ASSERT(store.WriteState("job'3", 102, 202, JOB_STATE_FINISHED, false, old_group));
+
+  JobStateStore::Record rec;
+  CPPUNIT_ASSERT(store.ReadState("job2", rec));
+  CPPUNIT_ASSERT_EQUAL(std::string("job2"), rec.id);
+  CPPUNIT_ASSERT_EQUAL(JOB_STATE_INLRMS, rec.state);
+  CPPUNIT_ASSERT(rec.pending);
+  CPPUNIT_ASSERT_EQUAL(JobStateStore::GroupCurrent, rec.group);
+  CPPUNIT_ASSERT_EQUAL((uid_t)101, rec.uid);
+  CPPUNIT_ASSERT_EQUAL((gid_t)201, rec.gid);
+  CPPUNIT_ASSERT(rec.modified > 0);
+  CPPUNIT_ASSERT(store.ReadState("job'3", rec));
+  CPPUNIT_ASSERT_EQUAL(std::string("job'3"), rec.id);
+  CPPUNIT_ASSERT(!store.ReadState("job4", rec));
+
+  // Changing state moves job to new group and reports previous one
+  CPPUNIT_ASSERT(store.WriteState("job1", 100, 200, JOB_STATE_PREPARING, false, old_group));
+  CPPUNIT_ASSERT_EQUAL(JobStateStore::GroupNew, old_group);
+
+  std::list<JobStateStore::Record> recs;
+  CPPUNIT_ASSERT(store.ListGroup(JobStateStore::GroupCurrent, recs));
+  CPPUNIT_ASSERT_EQUAL(2, (int)recs.size());
+  recs.clear();
+  CPPUNIT_ASSERT(store.ListGroup(JobStateStore::GroupNew, recs));
+  CPPUNIT_ASSERT_EQUAL(0, (int)recs.size());
+  CPPUNIT_ASSERT(store.ListState(JOB_STATE_FINISHED, recs));
+  CPPUNIT_ASSERT_EQUAL(1, (int)recs.size());
+  CPPUNIT_ASSERT_EQUAL(std::string("job'3"), recs.front().id);
+
+  CPPUNIT_ASSERT(store.SetGroup("job2", JobStateStore::GroupRestarting));
+  CPPUNIT_ASSERT(store.ReadState("job2", rec));
+  CPPUNIT_ASSERT_EQUAL(JobStateStore::GroupRestarting, rec.group);
+  CPPUNIT_ASSERT_EQUAL(JOB_STATE_INLRMS, rec.state);
+  CPPUNIT_ASSERT(!store.SetGroup("job4", JobStateStore::GroupOld));
+
+  JobStateStore::Record imported;
+  imported.id = "job5";
+  imported.state = JOB_STATE_DELETED;
+  imported.group = JobStateStore::GroupOld;
+  imported.uid = 5;
+  imported.modified = 12345;
+  CPPUNIT_ASSERT(store.WriteRecord(imported));
+  CPPUNIT_ASSERT(store.ReadState("job5", rec));
+  CPPUNIT_ASSERT_EQUAL((time_t)12345, rec.modified);
+
+  CPPUNIT_ASSERT(store.RemoveJob("job5"));
+  CPPUNIT_ASSERT(!store.ReadState("job5", rec));
+}
+
+void JobStateStoreTest::TestMarks() {
+  JobStateStore store(JobStateStore::Path(dir));
+  CPPUNIT_ASSERT(store);
+
+  JobStateStore::group_t old_group;
+  CPPUNIT_ASSERT(store.WriteState("job1", 100, 200, JOB_STATE_INLRMS, false, old_group));
+
+  std::string content;
+  CPPUNIT_ASSERT(!store.CheckMark("job1", JobStateStore::MarkCancel));
+  CPPUNIT_ASSERT(store.PutMark("job1", JobStateStore::MarkCancel));
+  CPPUNIT_ASSERT(store.CheckMark("job1", JobStateStore::MarkCancel, &content));
+  CPPUNIT_ASSERT_EQUAL(std::string(""), content);
+  CPPUNIT_ASSERT(!store.CheckMark("job1", JobStateStore::MarkClean));
+
+  // Appending creates mark and then extends it
+  CPPUNIT_ASSERT(store.AddMark("job1", JobStateStore::MarkFailed, "first 'failure'\n"));
+  CPPUNIT_ASSERT(store.AddMark("job1", JobStateStore::MarkFailed, "second"));
+  CPPUNIT_ASSERT(store.CheckMark("job1", JobStateStore::MarkFailed, &content));
+  CPPUNIT_ASSERT_EQUAL(std::string("first 'failure'\nsecond"), content);
+  CPPUNIT_ASSERT(store.PutMark("job1", JobStateStore::MarkFailed, "replaced"));
+  CPPUNIT_ASSERT(store.CheckMark("job1", JobStateStore::MarkFailed, &content));
+  CPPUNIT_ASSERT_EQUAL(std::string("replaced"), content);
+
+  // Marks of unknown jobs are listed without owner
+  CPPUNIT_ASSERT(store.PutMark("job2", JobStateStore::MarkCancel));
+  std::list<JobStateStore::Record> recs;
+  CPPUNIT_ASSERT(store.ListMarks(JobStateStore::MarkCancel, recs));
+  CPPUNIT_ASSERT_EQUAL(2, (int)recs.size());
+  for(std::list<JobStateStore::Record>::iterator rec = recs.begin(); rec != recs.end(); ++rec) {
+    if(rec->id == "job1") {
+      CPPUNIT_ASSERT_EQUAL((uid_t)100, rec->uid);
+    } else {
+      CPPUNIT_ASSERT_EQUAL(std::string("job2"), rec->id);
+      CPPUNIT_ASSERT_EQUAL((uid_t)0, rec->uid);
+    }
+    CPPUNIT_ASSERT(rec->modified > 0);
+  }
+
+  CPPUNIT_ASSERT(store.RemoveMark("job2", JobStateStore::MarkCancel));
+  CPPUNIT_ASSERT(!store.RemoveMark("job2", JobStateStore::MarkCancel));
+
+  // Removing job removes its marks
+  CPPUNIT_ASSERT(store.RemoveJob("job1"));
+  CPPUNIT_ASSERT(!store.CheckMark("job1", JobStateStore::MarkCancel));
+  CPPUNIT_ASSERT(!store.CheckMark("job1", JobStateStore::MarkFailed));
+}
+
+void JobStateStoreTest::TestTransaction() {
+  JobStateStore store(JobStateStore::Path(dir));
+  CPPUNIT_ASSERT(store);
+  // Same database seen by other process
+  JobStateStore other(JobStateStore::Path(dir), false);
+  CPPUNIT_ASSERT(other);
+
+  JobStateStore::group_t old_group;
+  JobStateStore::Record rec;
+  CPPUNIT_ASSERT(store.Begin());
+  // Methods with own transaction join outer one
+  CPPUNIT_ASSERT(store.WriteState("job1", 100, 200, JOB_STATE_ACCEPTED, false, old_group));
+  CPPUNIT_ASSERT(store.Begin());
+  CPPUNIT_ASSERT(store.AddMark("job1", JobStateStore::MarkFailed, "failed"));
+  CPPUNIT_ASSERT(store.Commit());
+  CPPUNIT_ASSERT(store.ReadState("job1", rec));
+  CPPUNIT_ASSERT(!other.ReadState("job1", rec));
+  CPPUNIT_ASSERT(!other.CheckMark("job1", JobStateStore::MarkFailed));
+  CPPUNIT_ASSERT(store.Commit());
+  CPPUNIT_ASSERT(other.ReadState("job1", rec));
+  CPPUNIT_ASSERT(other.CheckMark("job1", JobStateStore::MarkFailed));
+
+  // Unbalanced commit is refused
+  CPPUNIT_ASSERT(!store.Commit());
+  // Store keeps working after transactions
+  CPPUNIT_ASSERT(store.WriteState("job1", 100, 200, JOB_STATE_FINISHED, false, old_group));
+  CPPUNIT_ASSERT_EQUAL(JobStateStore::GroupNew, old_group);
+  CPPUNIT_ASSERT(other.ReadState("job1", rec));
+  CPPUNIT_ASSERT_EQUAL(JOB_STATE_FINISHED, rec.state);
+
+  // Nested rollback discards whole transaction
+  CPPUNIT_ASSERT(store.Begin());
+  CPPUNIT_ASSERT(store.WriteState("job2", 100, 200, JOB_STATE_ACCEPTED, false, old_group));
+  CPPUNIT_ASSERT(store.Begin());
+  store.Rollback();
+  CPPUNIT_ASSERT(!store.Commit());
+  CPPUNIT_ASSERT(!store.ReadState("job2", rec));
+  CPPUNIT_ASSERT(!other.ReadState("job2", rec));
+  // Next transaction is not affected
+  CPPUNIT_ASSERT(store.Begin());
+  CPPUNIT_ASSERT(store.WriteState("job2", 100, 200, JOB_STATE_ACCEPTED, false, old_group));
+  CPPUNIT_ASSERT(store.Commit());
+  CPPUNIT_ASSERT(other.ReadState("job2", rec));
+}
+
+void JobStateStoreTest::TestTransactionThreads() {
+  JobStateStore store(JobStateStore::Path(dir));
+  CPPUNIT_ASSERT(store);
+  JobStateStore::group_t old_group;
+  JobStateStore::Record rec;
+  StateWriter writer(store);
+  Arc::SimpleCounter count;
+  CPPUNIT_ASSERT(store.Begin());
+  CPPUNIT_ASSERT(store.WriteState("job1", 100, 200, JOB_STATE_ACCEPTED, false, old_group));
+  // Other thread does not join transaction but waits for it to finish
+  CPPUNIT_ASSERT(Arc::CreateThreadFunction(&StateWriter::Write, &writer, &count));
+  usleep(200000);
+  CPPUNIT_ASSERT(!writer.Written());
+  store.Rollback();
+  count.wait();
+  CPPUNIT_ASSERT(writer.Written());
+  CPPUNIT_ASSERT(!store.ReadState("job1", rec));
+  CPPUNIT_ASSERT(store.ReadState("job3", rec));
+}
+
+void JobStateStoreTest::TestGet() {
+  GMConfig config;
+  config.SetControlDir(dir + "/control");
+  CPPUNIT_ASSERT(!JobStateStore::Get(config));
+  config.SetControlStoreType(GMConfig::control_store_sqlite);
+  // Directory is missing - database can't be created
+  CPPUNIT_ASSERT(!JobStateStore::Get(config));
+  // Failure is not remembered
+  CPPUNIT_ASSERT(Arc::DirCreate(dir + "/control", S_IRWXU, false));
+  JobStateStore* store = JobStateStore::Get(config);
+  CPPUNIT_ASSERT(store);
+  CPPUNIT_ASSERT(store == JobStateStore::Get(config));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(JobStateStoreTest);
@@ -0,0 +1,273 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cstdio>
+#include <iostream>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <utime.h>
+#include <unistd.h>
+
+#include <glibmm.h>
+
+#include <arc/FileUtils.h>
+#include <arc/Logger.h>
+#include <arc/OptionParser.h>
+#include <arc/StringConv.h>
+
+#include "conf/GMConfig.h"
+#include "files/ControlFileHandling.h"
+#include "files/JobStateStore.h"
+
+using namespace ARex;
+
+static const char* const subdirs[] = { subdir_rew, subdir_new, subdir_cur, subdir_old };
+static const JobStateStore::group_t groups[] = {
+  JobStateStore::GroupRestarting, JobStateStore::GroupNew,
+  JobStateStore::GroupCurrent, JobStateStore::GroupOld };
+static const unsigned int subdirs_num = sizeof(subdirs)/sizeof(subdirs[0]);
+
+static const char* const mark_sfx[] = { sfx_cancel, sfx_restart, sfx_clean };
+static const JobStateStore::mark_t mark_types[] = {
+  JobStateStore::MarkCancel, JobStateStore::MarkRestart, JobStateStore::MarkClean };
+static bool (* const mark_put[])(const GMJob&,const GMConfig&) = {
+  &job_cancel_mark_put, &job_restart_mark_put, &job_clean_mark_put };
+static const unsigned int marks_num = sizeof(mark_sfx)/sizeof(mark_sfx[0]);
+
+static const char* group_subdir(JobStateStore::group_t group) {
+  for(unsigned int n = 0; n < subdirs_num; ++n) {
+    if(groups[n] == group) return subdirs[n];
+  };
+  return subdir_cur;
+}
+
+// Collects ids of jobs having files with specified suffix in directory
+static bool list_files(const std::string& dir, const std::string& sfx, std::list<JobId>& ids) {
+  try {
+    Glib::Dir d(dir);
+    for(;;) {
+      std::string file = d.read_name();
+      if(file.empty()) break;
+      int l = file.length();
+      int ll = sfx.length();
+      if(l > (4+ll) && file.substr(0,4) == "job." && file.substr(l-ll) == sfx) {
+        ids.push_back(file.substr(4,l-ll-4));
+      };
+    };
+  } catch(Glib::FileError& e) {
+    std::cerr << "Failed reading directory " << dir << ": " << e.what() << std::endl;
+    return false;
+  };
+  return true;
+}
+
+static bool files_to_sqlite(GMConfig& config) {
+  std::string dbpath = JobStateStore::Path(config.ControlDir());
+  JobStateStore store(dbpath, true);
+  if(!store) {
+    std::cerr << "Failed creating database " << dbpath << ": " << store.Error() << std::endl;
+    return false;
+  };
+  // Source is always read from files
+  config.SetControlStoreType(GMConfig::control_store_files);
+  unsigned int jobs_num = 0;
+  unsigned int marks_copied = 0;
+  if(!store.Begin()) return false;
+  for(unsigned int n = 0; n < subdirs_num; ++n) {
+    std::string dir = config.ControlDir() + "/" + subdirs[n];
+    std::list<JobId> ids;
+    if(!list_files(dir, ".status", ids)) return false;
+    for(std::list<JobId>::iterator id = ids.begin(); id != ids.end(); ++id) {
+      std::string fname = dir + "/job." + *id + ".status";
+      uid_t uid; gid_t gid; time_t t;
+      if(!check_file_owner(fname, uid, gid, t)) continue;
+      std::string data;
+      if(!Arc::FileRead(fname, data)) continue;
+      data = data.substr(0, data.find('\n'));
+      JobStateStore::Record rec;
+      rec.id = *id;
+      rec.pending = (data.substr(0, 8) == "PENDING:");
+      if(rec.pending) data = data.substr(8);
+      rec.state = GMJob::get_state(data.c_str());
+      rec.group = groups[n];
+      rec.uid = uid; rec.gid = gid; rec.modified = t;
+      if(!store.WriteRecord(rec)) {
+        std::cerr << "Failed storing job " << *id << ": " << store.Error() << std::endl;
+        return false;
+      };
+      if(job_failed_mark_check(*id, config)) {
+        if(!store.PutMark(*id, JobStateStore::MarkFailed, job_failed_mark_read(*id, config))) {
+          std::cerr << "Failed storing failure mark of job " << *id << ": " << store.Error() << std::endl;
+          return false;
+        };
+      };
+      ++jobs_num;
+    };
+  };
+  std::list<std::string> copied_marks;
+  for(unsigned int n = 0; n < marks_num; ++n) {
+    std::string dir = config.ControlDir() + "/" + subdir_new;
+    std::list<JobId> ids;
+    if(!list_files(dir, mark_sfx[n], ids)) return false;
+    for(std::list<JobId>::iterator id = ids.begin(); id != ids.end(); ++id) {
+      if(!store.PutMark(*id, mark_types[n])) {
+        std::cerr << "Failed storing mark of job " << *id << ": " << store.Error() << std::endl;
+        return false;
+      };
+      copied_marks.push_back(dir + "/job." + *id + mark_sfx[n]);
+      ++marks_copied;
+    };
+  };
+  if(!store.Commit()) {
+    std::cerr << "Failed storing information: " << store.Error() << std::endl;
+    return false;
+  };
+  // Marks in files would be ignored from now on
+  for(std::list<std::string>::iterator fname = copied_marks.begin(); fname != copied_marks.end(); ++fname) {
+    (void)Arc::FileDelete(*fname);
+  };
+  std::cout << "Copied " << jobs_num << " jobs and " << marks_copied << " marks into " << dbpath << std::endl;
+  return true;
+}
+
+static bool sqlite_to_files(GMConfig& config) {
+  std::string dbpath = JobStateStore::Path(config.ControlDir());
+  unsigned int jobs_num = 0;
+  unsigned int marks_copied = 0;
+  {
+    JobStateStore store(dbpath, false);
+    if(!store) {
+      std::cerr << "Failed opening database " << dbpath << ": " << store.Error() << std::endl;
+      return false;
+    };
+    // Destination is files
+    config.SetControlStoreType(GMConfig::control_store_files);
+    for(unsigned int n = 0; n < subdirs_num; ++n) {
+      std::list<JobStateStore::Record> recs;
+      if(!store.ListGroup(groups[n], recs)) {
+        std::cerr << "Failed reading database: " << store.Error() << std::endl;
+        return false;
+      };
+      for(std::list<JobStateStore::Record>::iterator rec = recs.begin(); rec != recs.end(); ++rec) {
+        GMJob job(rec->id, Arc::User(rec->uid));
+        if(!job_state_write_file(job, config, rec->state, rec->pending)) {
+          std::cerr << "Failed writing state of job " << rec->id << std::endl;
+          return false;
+        };
+        std::string fname = config.ControlDir() + "/" +
+               group_subdir(JobStateStore::StateGroup(rec->state)) + "/job." + rec->id + ".status";
+        if(groups[n] == JobStateStore::GroupRestarting) {
+          // Restarting is not a state, so file has to be moved
+          std::string oname = config.ControlDir() + "/" + subdir_rew + "/job." + rec->id + ".status";
+          if(::rename(fname.c_str(), oname.c_str()) != 0) {
+            std::cerr << "Failed moving state of job " << rec->id << std::endl;
+            return false;
+          };
+          fname = oname;
+        };
+        // Time of state change is used for cleaning and ordering jobs
+        struct utimbuf times;
+        times.actime = rec->modified;
+        times.modtime = rec->modified;
+        (void)::utime(fname.c_str(), &times);
+        std::string failed;
+        if(store.CheckMark(rec->id, JobStateStore::MarkFailed, &failed)) {
+          (void)job_failed_mark_remove(rec->id, config);
+          if(!job_failed_mark_put(job, config, failed)) {
+            std::cerr << "Failed writing failure mark of job " << rec->id << std::endl;
+            return false;
+          };
+        };
+        ++jobs_num;
+      };
+    };
+    for(unsigned int n = 0; n < marks_num; ++n) {
+      std::list<JobStateStore::Record> recs;
+      if(!store.ListMarks(mark_types[n], recs)) {
+        std::cerr << "Failed reading database: " << store.Error() << std::endl;
+        return false;
+      };
+      for(std::list<JobStateStore::Record>::iterator rec = recs.begin(); rec != recs.end(); ++rec) {
+        GMJob job(rec->id, Arc::User(rec->uid));
+        if(!(*mark_put[n])(job, config)) {
+          std::cerr << "Failed writing mark of job " << rec->id << std::endl;
+          return false;
+        };
+        ++marks_copied;
+      };
+    };
+  };
+  std::cout << "Copied " << jobs_num << " jobs and " << marks_copied << " marks from " << dbpath << std::endl;
+  (void)Arc::FileDelete(dbpath);
+  (void)Arc::FileDelete(dbpath + "-wal");
+  (void)Arc::FileDelete(dbpath + "-shm");
+  std::cout << "Database " << dbpath << " removed" << std::endl;
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+
+  // stderr destination for error messages
+  Arc::LogStream logcerr(std::cerr);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+  Arc::Logger::getRootLogger().setThreshold(Arc::ERROR);
+
+  Arc::OptionParser options(" ",
+                            istring("gm-controldir-converter changes the way "
+                                    "states and marks of jobs are stored in "
+                                    "control directory."));
+
+  std::string conf_file;
+  options.AddOption('c', "conffile",
+                    istring("use specified configuration file"),
+                    istring("file"), conf_file);
+
+  std::string control_dir;
+  options.AddOption('d', "controldir",
+                    istring("read information from specified control directory"),
+                    istring("dir"), control_dir);
+
+  std::string output_format;
+  options.AddOption('o', "output",
+                    istring("convert into specified storage type [files|sqlite]"),
+                    istring("storage type"), output_format);
+
+  std::list<std::string> params = options.Parse(argc, argv);
+
+  GMConfig config;
+  if (!conf_file.empty()) config.SetConfigFile(conf_file);
+
+  std::cout << "Using configuration at " << config.ConfigFile() << std::endl;
+  if(!config.Load()) exit(1);
+
+  if (!control_dir.empty()) config.SetControlDir(control_dir);
+
+  GMConfig::control_store_t store_type_out = GMConfig::control_store_sqlite;
+  if(config.ControlStoreType() == GMConfig::control_store_sqlite)
+    store_type_out = GMConfig::control_store_files;
+  if(!output_format.empty()) {
+    if(output_format == "files") {
+      store_type_out = GMConfig::control_store_files;
+    } else if(output_format == "sqlite") {
+      store_type_out = GMConfig::control_store_sqlite;
+    } else {
+      std::cerr << "Unknown output storage type requested - " << output_format << std::endl;
+      exit(-1);
+    };
+  };
+
+  std::cout << "Converting control directory " << config.ControlDir() << std::endl;
+  std::cout << "A-REX must not be running during conversion" << std::endl;
+  bool result = false;
+  if(store_type_out == GMConfig::control_store_sqlite) {
+    result = files_to_sqlite(config);
+  } else {
+    result = sqlite_to_files(config);
+  };
+  if(!result) exit(-1);
+  std::cout << "Do NOT forget to set controlstore="
+            << ((store_type_out == GMConfig::control_store_sqlite) ? "sqlite" : "files")
+            << " in configuration file." << std::endl;
+  return 0;
+}
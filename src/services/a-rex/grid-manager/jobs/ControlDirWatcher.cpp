@@ -0,0 +1,238 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+
+#include <arc/Logger.h>
+
+#include "../conf/GMConfig.h"
+#include "../files/ControlFileHandling.h"
+#include "../log/MetricsRegistry.h"
+#include "JobsList.h"
+
+#include "ControlDirWatcher.h"
+
+namespace ARex {
+
+static Arc::Logger& logger = Arc::Logger::getRootLogger();
+
+static const char* const metric_events = "arex_controldir_events_total";
+static const char* const metric_rescans = "arex_controldir_rescans_total";
+
+ControlDirWatcher::ControlDirWatcher(const GMConfig& config, JobsList& jobs):
+    config_(config), jobs_(jobs), fd_(-1), kick_in_(-1), kick_out_(-1), to_exit_(false), failed_(false),
+    rescan_now_(true), rescan_polling_(false), events_(0), rescans_(0) {
+  // First scan is always needed to pick up jobs which arrived while A-REX was not running.
+  MetricsRegistry* registry = config_.GetMetricsRegistry();
+  if(registry) {
+    registry->Describe(metric_events, MetricsRegistry::Counter,
+                       "Changes in control directory picked up through notifications");
+    registry->Describe(metric_rescans, MetricsRegistry::Counter,
+                       "Full scans of control directory for new jobs and marks");
+  };
+}
+
+ControlDirWatcher::~ControlDirWatcher(void) {
+  if(fd_ != -1) {
+    to_exit_ = true;
+    if(kick_in_ != -1) { char c = 0; (void)::write(kick_in_, &c, 1); };
+    exited_.wait();
+  };
+  close_fds();
+}
+
+void ControlDirWatcher::close_fds(void) {
+  if(fd_ != -1) { ::close(fd_); fd_ = -1; };
+  if(kick_in_ != -1) { ::close(kick_in_); kick_in_ = -1; };
+  if(kick_out_ != -1) { ::close(kick_out_); kick_out_ = -1; };
+  watches_.clear();
+}
+
+bool ControlDirWatcher::start(void) {
+  if(fd_ != -1) return false;
+  if(!config_.WatchControlDir()) return false;
+#ifdef HAVE_SYS_INOTIFY_H
+  fd_ = ::inotify_init();
+  if(fd_ == -1) {
+    logger.msg(Arc::WARNING, "Failed to initialize notifications for control directory: %s", Arc::StrError(errno));
+    return false;
+  };
+  (void)::fcntl(fd_, F_SETFD, FD_CLOEXEC);
+  int filedes[2];
+  if(::pipe(filedes) != 0) {
+    close_fds();
+    return false;
+  };
+  kick_in_ = filedes[1];
+  kick_out_ = filedes[0];
+  (void)::fcntl(kick_in_, F_SETFD, FD_CLOEXEC);
+  (void)::fcntl(kick_out_, F_SETFD, FD_CLOEXEC);
+  const char* subdirs[] = { subdir_new, subdir_cur, subdir_old, subdir_rew };
+  for(unsigned int n = 0; n < sizeof(subdirs)/sizeof(subdirs[0]); ++n) {
+    std::string dir = config_.ControlDir() + "/" + subdirs[n];
+    int wd = ::inotify_add_watch(fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+    if(wd == -1) {
+      logger.msg(Arc::WARNING, "Failed to watch directory %s: %s", dir, Arc::StrError(errno));
+      close_fds();
+      return false;
+    };
+    watches_[wd] = subdirs[n];
+  };
+  if(!Arc::Thread::start(&exited_)) {
+    close_fds();
+    return false;
+  };
+  logger.msg(Arc::INFO, "Following changes in control directory %s through notifications", config_.ControlDir());
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool ControlDirWatcher::active(void) const {
+  Glib::Mutex::Lock lock(lock_);
+  return (fd_ != -1) && !failed_;
+}
+
+bool ControlDirWatcher::WatchesMarks(void) const {
+  if(config_.ControlStoreType() == GMConfig::control_store_sqlite) return false;
+  return active();
+}
+
+void ControlDirWatcher::RequestRescan(bool immediate) {
+  Glib::Mutex::Lock lock(lock_);
+  if(immediate) rescan_now_ = true; else rescan_polling_ = true;
+}
+
+bool ControlDirWatcher::TakeRescan(bool polling) {
+  {
+    Glib::Mutex::Lock lock(lock_);
+    bool rescan = rescan_now_ || (polling && (rescan_polling_ || (fd_ == -1) || failed_));
+    if(!rescan) return false;
+    rescan_now_ = false;
+    rescan_polling_ = false;
+    ++rescans_;
+  };
+  MetricsRegistry* registry = config_.GetMetricsRegistry();
+  if(registry) registry->Add(metric_rescans, "");
+  return true;
+}
+
+unsigned long long int ControlDirWatcher::Events(void) const {
+  Glib::Mutex::Lock lock(lock_);
+  return events_;
+}
+
+unsigned long long int ControlDirWatcher::Rescans(void) const {
+  Glib::Mutex::Lock lock(lock_);
+  return rescans_;
+}
+
+void ControlDirWatcher::count_event(void) {
+  {
+    Glib::Mutex::Lock lock(lock_);
+    ++events_;
+  };
+  MetricsRegistry* registry = config_.GetMetricsRegistry();
+  if(registry) registry->Add(metric_events, "");
+}
+
+bool ControlDirWatcher::process(const std::string& subdir, const std::string& name) {
+  static const std::string sfx_status(".status");
+  static const char* const marks[] = { sfx_cancel, sfx_clean, sfx_restart };
+  int l = name.length();
+  // job id contains at least 1 character
+  if((l < 4+1) || (name.compare(0, 4, "job.") != 0)) return false;
+  if((l > 4+(int)sfx_status.length()) && (name.compare(l-sfx_status.length(), sfx_status.length(), sfx_status) == 0)) {
+    JobId id = name.substr(4, l-4-sfx_status.length());
+    count_event();
+    if(jobs_.ScanChangedJob(id)) return false;
+    if(subdir == subdir_rew) {
+      // Jobs in restarting are only picked up by full scan
+      RequestRescan(true);
+      return true;
+    };
+    // New job which can't be accepted now must be picked up later
+    if(subdir == subdir_new) RequestRescan(false);
+    return false;
+  };
+  if(subdir != subdir_new) return false;
+  for(unsigned int n = 0; n < sizeof(marks)/sizeof(marks[0]); ++n) {
+    int ll = strlen(marks[n]);
+    if((l > 4+ll) && (name.compare(l-ll, ll, marks[n]) == 0)) {
+      JobId id = name.substr(4, l-4-ll);
+      count_event();
+      logger.msg(Arc::DEBUG, "%s: mark %s appeared in control directory", id, marks[n]);
+      if(jobs_.RequestAttention(id) || jobs_.HasJob(id)) return false;
+      // Marks of unknown jobs are handled (and removed if stale) by scanning
+      RequestRescan(true);
+      return true;
+    };
+  };
+  return false;
+}
+
+void ControlDirWatcher::thread(void) {
+#ifdef HAVE_SYS_INOTIFY_H
+  char buf[16*1024] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  for(;;) {
+    if(to_exit_) break;
+    struct pollfd fds[2];
+    fds[0].fd = fd_; fds[0].events = POLLIN; fds[0].revents = 0;
+    fds[1].fd = kick_out_; fds[1].events = POLLIN; fds[1].revents = 0;
+    int r = ::poll(fds, 2, -1);
+    if(to_exit_) break;
+    if(r == -1) {
+      if(errno == EINTR) continue;
+      logger.msg(Arc::ERROR, "Failed waiting for changes in control directory: %s", Arc::StrError(errno));
+      break;
+    };
+    if(!(fds[0].revents & POLLIN)) continue;
+    ssize_t len = ::read(fd_, buf, sizeof(buf));
+    if(len <= 0) {
+      if((len == -1) && (errno == EINTR)) continue;
+      logger.msg(Arc::ERROR, "Failed reading changes in control directory: %s", Arc::StrError(errno));
+      break;
+    };
+    bool wakeup = false;
+    for(char* p = buf; p < buf + len; ) {
+      struct inotify_event* event = (struct inotify_event*)p;
+      p += sizeof(struct inotify_event) + event->len;
+      if(event->mask & IN_Q_OVERFLOW) {
+        logger.msg(Arc::WARNING, "Notifications about control directory changes were lost - full scan is needed");
+        RequestRescan(true);
+        wakeup = true;
+        continue;
+      };
+      if(event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+        RequestRescan(true);
+        wakeup = true;
+        continue;
+      };
+      if(event->len == 0) continue;
+      std::map<int,std::string>::iterator watch = watches_.find(event->wd);
+      if(watch == watches_.end()) continue;
+      if(process(watch->second, event->name)) wakeup = true;
+    };
+    if(wakeup) jobs_.RequestAttention();
+  };
+  // Without notifications control directory must be scanned periodically again
+  {
+    Glib::Mutex::Lock lock(lock_);
+    failed_ = true;
+    rescan_now_ = true;
+  };
+  jobs_.RequestAttention();
+#endif
+}
+
+} // namespace ARex
@@ -0,0 +1,85 @@
+#ifndef GM_CONTROLDIR_WATCHER_H
+#define GM_CONTROLDIR_WATCHER_H
+
+#include <string>
+#include <map>
+
+#include <arc/Thread.h>
+
+namespace ARex {
+
+class GMConfig;
+class JobsList;
+
+/// Follows changes in control directory using kernel (inotify) notifications.
+/** Status files and marks appearing in accepting, processing, restarting and
+   finished subdirectories are passed to JobsList as requests for attention
+   for specific jobs. That makes periodic full scanning of control directory
+   unnecessary. Full scan is still requested if notifications were lost
+   because of queue overflow or if new job could not be accepted due to
+   limits. If notifications are not supported or disabled in configuration
+   object reports itself inactive and every polling causes full scan.
+   Marks are followed only if they are stored as files. */
+class ControlDirWatcher: protected Arc::Thread {
+ public:
+  ControlDirWatcher(const GMConfig& config, JobsList& jobs);
+  ~ControlDirWatcher(void);
+
+  /// Starts following changes. Returns false if that is not possible.
+  bool start(void);
+
+  /// Returns true if changes are followed by notifications.
+  bool active(void) const;
+
+  /// Returns true if new marks are reported through notifications.
+  /** Marks kept in job state database do not appear as files, hence
+     they still have to be scanned for at polling time. */
+  bool WatchesMarks(void) const;
+
+  /// Requests full scan of control directory.
+  /** If immediate is false scan will be done at next polling time. */
+  void RequestRescan(bool immediate);
+
+  /// Returns true if full scan of control directory is due.
+  /** polling tells if it is called at polling time. Inactive watcher
+     always requires scanning at polling time. Pending requests are
+     cleared and scan is counted. */
+  bool TakeRescan(bool polling);
+
+  /// Number of notifications which were passed to jobs processing.
+  unsigned long long int Events(void) const;
+
+  /// Number of full scans of control directory.
+  unsigned long long int Rescans(void) const;
+
+ protected:
+  void thread(void);
+
+ private:
+  const GMConfig& config_;
+  JobsList& jobs_;
+  int fd_;
+  int kick_in_;
+  int kick_out_;
+  std::map<int,std::string> watches_; // watch descriptor -> subdirectory
+  bool to_exit_;
+  bool failed_;
+  Arc::SimpleCounter exited_;
+  mutable Glib::Mutex lock_;
+  bool rescan_now_;
+  bool rescan_polling_;
+  unsigned long long int events_;
+  unsigned long long int rescans_;
+
+  void close_fds(void);
+  // Returns true if jobs processing must be woken up to do full scan
+  bool process(const std::string& subdir, const std::string& name);
+  void count_event(void);
+
+  ControlDirWatcher(const ControlDirWatcher&);
+  ControlDirWatcher& operator=(const ControlDirWatcher&);
+};
+
+} // namespace ARex
+
+#endif // GM_CONTROLDIR_WATCHER_H
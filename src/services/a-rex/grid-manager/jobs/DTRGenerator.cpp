@@ -12,6 +12,7 @@
 #include "../conf/UrlMapConfig.h"
 #include "../files/ControlFileHandling.h"
 #include "../conf/StagingConfig.h"
+#include "../log/JobsMetrics.h"
 #include "../../delegation/DelegationStore.h"
 #include "../../delegation/DelegationStores.h"
 
@@ -426,6 +427,12 @@ bool DTRGenerator::processReceivedDTR(DataStaging::DTR_ptr dtr) {
     session_dir = config.SessionRoot(jobid) + '/' + jobid;
   }
 
+  if (dtr->get_status() != DataStaging::DTRStatus::CANCELLED) {
+    JobsMetrics* metrics = config.GetJobsMetrics();
+    if (metrics) metrics->ReportTransfer(dtr->get_source()->Local(), !dtr->error(),
+                                         dtr->get_bytes_transferred(), dtr->get_transfer_time());
+  }
+
   std::string dtr_transfer_statistics;
   
   if (dtr->error() && dtr->is_mandatory() && dtr->get_status() != DataStaging::DTRStatus::CANCELLED) {
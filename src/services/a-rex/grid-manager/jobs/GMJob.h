@@ -36,6 +36,7 @@ typedef std::string JobId;
 
 class GMJobRef;
 class GMJobQueue;
+class JobIndex;
 
 /// Represents a job in memory as it passes through the JobsList state machine.
 class GMJob {
@@ -44,6 +45,7 @@ class GMJob {
  friend class GMJobQueue;
  friend class GMJobMock;
  friend class JobsMetrics;
+ friend class JobIndex;
 
  private:
   // State of the job (state machine)
@@ -0,0 +1,166 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "../files/ControlFileContent.h"
+
+#include "JobIndex.h"
+
+namespace ARex {
+
+JobIndex::JobIndex(void) {
+}
+
+JobIndex::~JobIndex(void) {
+}
+
+JobIndex::Shard& JobIndex::ShardFor(const JobId& id) const {
+  return const_cast<Shard&>(shards_[g_str_hash(id.c_str()) % ShardsNum]);
+}
+
+void JobIndex::IndexState(const JobId& id, job_state_t state, bool pending) {
+  Glib::Mutex::Lock lock(state_lock_);
+  if(pending) pending_.insert(id);
+  else if(state < JOB_STATE_NUM) in_state_[state].insert(id);
+}
+
+void JobIndex::UnindexState(const JobId& id, job_state_t state, bool pending) {
+  Glib::Mutex::Lock lock(state_lock_);
+  if(pending) pending_.erase(id);
+  else if(state < JOB_STATE_NUM) in_state_[state].erase(id);
+}
+
+#define IS_ACTIVE_STATE(state) ((state >= JOB_STATE_PREPARING) && (state <= JOB_STATE_FINISHING))
+
+void JobIndex::IndexDN(Item& item) {
+  if(IS_ACTIVE_STATE(item.state)) {
+    if(item.dn_counted) return;
+    if(!(item.job->local)) return;
+    item.dn = item.job->local->DN;
+    item.dn_counted = true;
+    AddDN(item.dn);
+  } else {
+    if(!item.dn_counted) return;
+    item.dn_counted = false;
+    RemoveDN(item.dn);
+  };
+}
+
+bool JobIndex::Add(GMJobRef& i) {
+  if(!i) return false;
+  Shard& shard = ShardFor(i->get_id());
+  Glib::Mutex::Lock lock(shard.lock);
+  std::map<JobId,Item>::iterator item = shard.jobs.find(i->get_id());
+  if(item != shard.jobs.end()) return false;
+  Item& newitem = shard.jobs[i->get_id()];
+  newitem.job = i;
+  newitem.state = i->get_state();
+  newitem.pending = i->job_pending;
+  newitem.dn_counted = false;
+  IndexState(i->get_id(), newitem.state, newitem.pending);
+  IndexDN(newitem);
+  return true;
+}
+
+bool JobIndex::Remove(GMJobRef& i) {
+  if(!i) return false;
+  Shard& shard = ShardFor(i->get_id());
+  Glib::Mutex::Lock lock(shard.lock);
+  std::map<JobId,Item>::iterator item = shard.jobs.find(i->get_id());
+  if(item == shard.jobs.end()) return false;
+  UnindexState(item->first, item->second.state, item->second.pending);
+  if(item->second.dn_counted) RemoveDN(item->second.dn);
+  shard.jobs.erase(item);
+  return true;
+}
+
+GMJobRef JobIndex::Find(const JobId& id) const {
+  Shard& shard = ShardFor(id);
+  Glib::Mutex::Lock lock(shard.lock);
+  std::map<JobId,Item>::iterator item = shard.jobs.find(id);
+  if(item == shard.jobs.end()) return GMJobRef();
+  return item->second.job;
+}
+
+bool JobIndex::Has(const JobId& id) const {
+  Shard& shard = ShardFor(id);
+  Glib::Mutex::Lock lock(shard.lock);
+  return (shard.jobs.find(id) != shard.jobs.end());
+}
+
+void JobIndex::GetAll(std::list<GMJobRef>& jobs) const {
+  for(unsigned int n = 0; n < ShardsNum; ++n) {
+    Glib::Mutex::Lock lock(shards_[n].lock);
+    for(std::map<JobId,Item>::const_iterator item = shards_[n].jobs.begin();
+                           item != shards_[n].jobs.end(); ++item) {
+      jobs.push_back(item->second.job);
+    };
+  };
+}
+
+unsigned int JobIndex::Size(void) const {
+  unsigned int size = 0;
+  for(unsigned int n = 0; n < ShardsNum; ++n) {
+    Glib::Mutex::Lock lock(shards_[n].lock);
+    size += shards_[n].jobs.size();
+  };
+  return size;
+}
+
+void JobIndex::StateChanged(GMJobRef& i) {
+  if(!i) return;
+  Shard& shard = ShardFor(i->get_id());
+  Glib::Mutex::Lock lock(shard.lock);
+  std::map<JobId,Item>::iterator item = shard.jobs.find(i->get_id());
+  if(item == shard.jobs.end()) return;
+  job_state_t state = i->get_state();
+  bool pending = i->job_pending;
+  if((item->second.state != state) || (item->second.pending != pending)) {
+    UnindexState(item->first, item->second.state, item->second.pending);
+    item->second.state = state;
+    item->second.pending = pending;
+    IndexState(item->first, state, pending);
+  };
+  // Description may be loaded after job entered active state
+  IndexDN(item->second);
+}
+
+unsigned int JobIndex::InState(job_state_t state) const {
+  if(state >= JOB_STATE_NUM) return 0;
+  Glib::Mutex::Lock lock(state_lock_);
+  return in_state_[state].size();
+}
+
+unsigned int JobIndex::Pending(void) const {
+  Glib::Mutex::Lock lock(state_lock_);
+  return pending_.size();
+}
+
+void JobIndex::AddDN(const std::string& dn) {
+  Glib::Mutex::Lock lock(dn_lock_);
+  ++(dns_[dn]);
+}
+
+void JobIndex::RemoveDN(const std::string& dn) {
+  Glib::Mutex::Lock lock(dn_lock_);
+  std::map<std::string,unsigned int>::iterator it = dns_.find(dn);
+  if(it == dns_.end()) return;
+  if(it->second > 1) --(it->second);
+  else dns_.erase(it);
+}
+
+unsigned int JobIndex::ForDN(const std::string& dn) const {
+  Glib::Mutex::Lock lock(dn_lock_);
+  std::map<std::string,unsigned int>::const_iterator it = dns_.find(dn);
+  if(it == dns_.end()) return 0;
+  return it->second;
+}
+
+void JobIndex::GetDNs(std::map<std::string,unsigned int>& dns) const {
+  Glib::Mutex::Lock lock(dn_lock_);
+  dns = dns_;
+}
+
+} // namespace ARex
@@ -0,0 +1,101 @@
+#ifndef GRID_MANAGER_JOB_INDEX_H
+#define GRID_MANAGER_JOB_INDEX_H
+
+#include <string>
+#include <list>
+#include <map>
+#include <set>
+
+#include <arc/Thread.h>
+
+#include "GMJob.h"
+
+namespace ARex {
+
+/// Jobs tracked in memory indexed by identifier, state and owner DN.
+/** Jobs are distributed among shards by hash of identifier and every shard
+   has own lock. So lookups from different threads (processing loop, data
+   staging callbacks, front-ends) mostly do not compete for same lock.
+   Secondary indexes by state and DN are protected by separate locks which
+   are always taken after shard lock and never held while taking shard lock.
+   Job is counted for its owner DN while it is in one of active states
+   (PREPARING to FINISHING) and its local description is loaded. */
+class JobIndex {
+ public:
+  JobIndex(void);
+  ~JobIndex(void);
+
+  /// Adds job using its current state. Returns false if job with same id is already present.
+  bool Add(GMJobRef& i);
+
+  /// Removes job from all indexes. Returns false if job is not present.
+  bool Remove(GMJobRef& i);
+
+  /// Returns reference to job with specified id or null reference.
+  GMJobRef Find(const JobId& id) const;
+
+  /// Returns true if job with specified id is present.
+  bool Has(const JobId& id) const;
+
+  /// Collects references to all jobs.
+  void GetAll(std::list<GMJobRef>& jobs) const;
+
+  /// Total number of jobs.
+  unsigned int Size(void) const;
+
+  /// Moves job in state and DN indexes according to its current state and pending flag.
+  void StateChanged(GMJobRef& i);
+
+  /// Number of not pending jobs in specified state.
+  unsigned int InState(job_state_t state) const;
+
+  /// Number of pending jobs in all states.
+  unsigned int Pending(void) const;
+
+  /// Number of active jobs belonging to DN.
+  unsigned int ForDN(const std::string& dn) const;
+
+  /// Copies numbers of active jobs of all DNs.
+  void GetDNs(std::map<std::string,unsigned int>& dns) const;
+
+ private:
+  static const unsigned int ShardsNum = 64;
+
+  class Item {
+   public:
+    GMJobRef job;
+    job_state_t state; // state under which job is indexed
+    bool pending;
+    std::string dn;    // DN under which job is counted
+    bool dn_counted;
+  };
+
+  class Shard {
+   public:
+    mutable Glib::Mutex lock;
+    std::map<JobId,Item> jobs;
+  };
+
+  Shard shards_[ShardsNum];
+
+  mutable Glib::Mutex state_lock_;
+  std::set<JobId> in_state_[JOB_STATE_NUM];
+  std::set<JobId> pending_;
+
+  mutable Glib::Mutex dn_lock_;
+  std::map<std::string,unsigned int> dns_;
+
+  Shard& ShardFor(const JobId& id) const;
+  void IndexState(const JobId& id, job_state_t state, bool pending);
+  void UnindexState(const JobId& id, job_state_t state, bool pending);
+  void IndexDN(Item& item);
+  void AddDN(const std::string& dn);
+  void RemoveDN(const std::string& dn);
+
+  JobIndex(const JobIndex&);
+  JobIndex& operator=(const JobIndex&);
+};
+
+} // namespace ARex
+
+#endif
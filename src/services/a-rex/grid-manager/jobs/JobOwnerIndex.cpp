@@ -0,0 +1,193 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <arc/Logger.h>
+
+#include "../conf/GMConfig.h"
+#include "../files/ControlFileHandling.h"
+#include "JobsList.h"
+
+#include "JobOwnerIndex.h"
+
+namespace ARex {
+
+static Arc::Logger& logger = Arc::Logger::getRootLogger();
+
+// Explanation stored in failure mark by cancel processing
+static char const * const killed_failure = "Job is canceled by external request";
+
+JobOwnerIndex::JobOwnerIndex(void):
+    loading_(false), ready_(false), to_exit_(false), config_(NULL) {
+}
+
+JobOwnerIndex::~JobOwnerIndex(void) {
+  {
+    Glib::Mutex::Lock lock(lock_);
+    to_exit_ = true;
+  };
+  loader_.wait();
+}
+
+bool JobOwnerIndex::Load(const GMConfig& config) {
+  Glib::Mutex::Lock lock(lock_);
+  if(loading_ || ready_) return false;
+  config_ = &config;
+  loading_ = true;
+  if(!Arc::CreateThreadFunction(&loader, this, &loader_)) {
+    loading_ = false;
+    return false;
+  };
+  return true;
+}
+
+bool JobOwnerIndex::Ready(void) const {
+  Glib::Mutex::Lock lock(lock_);
+  return ready_;
+}
+
+void JobOwnerIndex::loader(void* arg) {
+  reinterpret_cast<JobOwnerIndex*>(arg)->load();
+}
+
+void JobOwnerIndex::load(void) {
+  std::list<JobId> ids;
+  if(!JobsList::GetAllJobIds(*config_, ids)) {
+    logger.msg(Arc::ERROR, "Failed to list jobs in control directory - jobs will be listed by scanning");
+    Glib::Mutex::Lock lock(lock_);
+    loading_ = false;
+    changed_.clear();
+    changed_states_.clear();
+    changed_failures_.clear();
+    return;
+  };
+  unsigned int loaded = 0;
+  for(std::list<JobId>::iterator id = ids.begin(); id != ids.end(); ++id) {
+    Entry entry;
+    entry.state = job_state_read_file(*id, *config_, entry.pending);
+    if(entry.state == JOB_STATE_UNDEFINED) continue; // job is gone already
+    if(!job_local_read_subject(*id, *config_, entry.dn)) continue;
+    entry.failed = job_failed_mark_check(*id, *config_);
+    entry.killed = entry.failed && Killed(*id, *config_);
+    Glib::Mutex::Lock lock(lock_);
+    if(to_exit_) return;
+    if(changed_.find(*id) != changed_.end()) continue;
+    if(jobs_.find(*id) != jobs_.end()) continue;
+    std::map< JobId,std::pair<job_state_t,bool> >::iterator state = changed_states_.find(*id);
+    if(state != changed_states_.end()) {
+      entry.state = state->second.first;
+      entry.pending = state->second.second;
+    };
+    std::map< JobId,std::pair<bool,bool> >::iterator failed = changed_failures_.find(*id);
+    if(failed != changed_failures_.end()) {
+      entry.failed = failed->second.first;
+      entry.killed = failed->second.second;
+    };
+    add(*id, entry);
+    ++loaded;
+  };
+  Glib::Mutex::Lock lock(lock_);
+  loading_ = false;
+  ready_ = true;
+  changed_.clear();
+  changed_states_.clear();
+  changed_failures_.clear();
+  logger.msg(Arc::INFO, "Indexed %u jobs of %u owners (%u read from control directory)",
+             (unsigned int)jobs_.size(), (unsigned int)owners_.size(), loaded);
+}
+
+void JobOwnerIndex::add(const JobId& id, const Entry& entry) {
+  std::map<JobId,Entry>::iterator job = jobs_.find(id);
+  if(job != jobs_.end()) {
+    if(job->second.dn != entry.dn) remove(id);
+  };
+  jobs_[id] = entry;
+  owners_[entry.dn].insert(id);
+}
+
+void JobOwnerIndex::remove(const JobId& id) {
+  std::map<JobId,Entry>::iterator job = jobs_.find(id);
+  if(job == jobs_.end()) return;
+  std::map< std::string,std::set<JobId> >::iterator owner = owners_.find(job->second.dn);
+  if(owner != owners_.end()) {
+    owner->second.erase(id);
+    if(owner->second.empty()) owners_.erase(owner);
+  };
+  jobs_.erase(job);
+}
+
+bool JobOwnerIndex::Killed(const JobId& id, const GMConfig& config) {
+  return (job_failed_mark_read(id, config).find(killed_failure) != std::string::npos);
+}
+
+void JobOwnerIndex::Add(const JobId& id, const std::string& dn, job_state_t state, bool pending, bool failed, bool killed) {
+  Entry entry;
+  entry.dn = dn;
+  entry.state = state;
+  entry.pending = pending;
+  entry.failed = failed;
+  entry.killed = failed && killed;
+  Glib::Mutex::Lock lock(lock_);
+  if(loading_) changed_.insert(id);
+  add(id, entry);
+}
+
+void JobOwnerIndex::State(const JobId& id, job_state_t state, bool pending) {
+  Glib::Mutex::Lock lock(lock_);
+  std::map<JobId,Entry>::iterator job = jobs_.find(id);
+  if(job == jobs_.end()) {
+    if(loading_) changed_states_[id] = std::make_pair(state, pending);
+    return;
+  };
+  job->second.state = state;
+  job->second.pending = pending;
+}
+
+void JobOwnerIndex::Failed(const JobId& id, bool failed, bool killed) {
+  killed = failed && killed;
+  Glib::Mutex::Lock lock(lock_);
+  std::map<JobId,Entry>::iterator job = jobs_.find(id);
+  if(job == jobs_.end()) {
+    if(loading_) changed_failures_[id] = std::make_pair(failed, killed);
+    return;
+  };
+  job->second.failed = failed;
+  job->second.killed = killed;
+}
+
+void JobOwnerIndex::Remove(const JobId& id) {
+  Glib::Mutex::Lock lock(lock_);
+  if(loading_) changed_.insert(id);
+  remove(id);
+}
+
+bool JobOwnerIndex::List(const std::string& dn, const JobId& after, unsigned int max,
+                         const Filter* filter, std::list<Item>& items) const {
+  Glib::Mutex::Lock lock(lock_);
+  std::map< std::string,std::set<JobId> >::const_iterator owner = owners_.find(dn);
+  if(owner == owners_.end()) return false;
+  std::set<JobId>::const_iterator id = after.empty() ? owner->second.begin() : owner->second.upper_bound(after);
+  unsigned int n = 0;
+  for(; id != owner->second.end(); ++id) {
+    std::map<JobId,Entry>::const_iterator job = jobs_.find(*id);
+    if(job == jobs_.end()) continue;
+    Item item;
+    item.id = *id;
+    item.state = job->second.state;
+    item.pending = job->second.pending;
+    item.failed = job->second.failed;
+    item.killed = job->second.killed;
+    if(filter && !filter->accept(item)) continue;
+    if(n >= max) return true;
+    items.push_back(item);
+    ++n;
+  };
+  return false;
+}
+
+unsigned int JobOwnerIndex::Size(void) const {
+  Glib::Mutex::Lock lock(lock_);
+  return jobs_.size();
+}
+
+} // namespace ARex
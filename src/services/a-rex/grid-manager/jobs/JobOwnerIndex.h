@@ -0,0 +1,117 @@
+#ifndef GRID_MANAGER_JOB_OWNER_INDEX_H
+#define GRID_MANAGER_JOB_OWNER_INDEX_H
+
+#include <string>
+#include <list>
+#include <map>
+#include <set>
+
+#include <arc/Thread.h>
+
+#include "GMJob.h"
+
+namespace ARex {
+
+class GMConfig;
+
+/// States and owners of all jobs known to A-REX, including finished ones.
+/** Unlike JobIndex which only holds jobs being processed this table covers
+   every job present in control directory. It is filled once by scanning
+   control directory in background and afterwards kept up to date by jobs
+   processing. Front-ends use it to list jobs of specific owner without
+   reading control files of every job. Jobs of every owner are kept ordered
+   by identifier so listing can be continued after any identifier. */
+class JobOwnerIndex {
+ public:
+  /// Information about one job.
+  class Item {
+   public:
+    JobId id;
+    job_state_t state;
+    bool pending;
+    bool failed;
+    /// Failure was caused by cancel request.
+    bool killed;
+  };
+
+  /// Selects jobs while listing.
+  class Filter {
+   public:
+    virtual ~Filter(void) {};
+    virtual bool accept(const Item& item) const = 0;
+  };
+
+  JobOwnerIndex(void);
+  ~JobOwnerIndex(void);
+
+  /// Starts scanning control directory in background thread.
+  /** Information passed through other methods during scanning takes
+     precedence over information read from control directory. */
+  bool Load(const GMConfig& config);
+
+  /// Returns true if scanning control directory is finished.
+  /** Before that listing may miss some jobs. */
+  bool Ready(void) const;
+
+  /// Adds or replaces job.
+  void Add(const JobId& id, const std::string& dn, job_state_t state, bool pending, bool failed, bool killed = false);
+
+  /// Records new state of job. Unknown jobs are ignored once loading is finished.
+  void State(const JobId& id, job_state_t state, bool pending);
+
+  /// Records presence of failure mark. Unknown jobs are ignored once loading is finished.
+  void Failed(const JobId& id, bool failed, bool killed = false);
+
+  /// Returns true if failure mark of job tells it was cancelled.
+  static bool Killed(const JobId& id, const GMConfig& config);
+
+  /// Forgets job.
+  void Remove(const JobId& id);
+
+  /// Collects jobs belonging to dn with identifiers following after.
+  /** At most max jobs accepted by filter (if not NULL) are stored in
+     items ordered by identifier. Empty after means from the beginning.
+     Returns true if there are more accepted jobs after returned ones. */
+  bool List(const std::string& dn, const JobId& after, unsigned int max,
+            const Filter* filter, std::list<Item>& items) const;
+
+  /// Total number of jobs.
+  unsigned int Size(void) const;
+
+ private:
+  class Entry {
+   public:
+    std::string dn;
+    job_state_t state;
+    bool pending;
+    bool failed;
+    bool killed;
+  };
+
+  mutable Glib::Mutex lock_;
+  std::map<JobId,Entry> jobs_;
+  std::map< std::string,std::set<JobId> > owners_;
+  // Jobs added or removed while loading - their stored information is not trusted
+  std::set<JobId> changed_;
+  // States and failure marks reported while loading for jobs not loaded yet.
+  // Loader may have read older information from control directory.
+  std::map< JobId,std::pair<job_state_t,bool> > changed_states_;
+  std::map< JobId,std::pair<bool,bool> > changed_failures_;
+  bool loading_;
+  bool ready_;
+  bool to_exit_;
+  const GMConfig* config_;
+  Arc::SimpleCounter loader_;
+
+  static void loader(void* arg);
+  void load(void);
+  void add(const JobId& id, const Entry& entry);
+  void remove(const JobId& id);
+
+  JobOwnerIndex(const JobOwnerIndex&);
+  JobOwnerIndex& operator=(const JobOwnerIndex&);
+};
+
+} // namespace ARex
+
+#endif // GRID_MANAGER_JOB_OWNER_INDEX_H
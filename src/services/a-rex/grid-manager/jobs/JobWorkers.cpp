@@ -0,0 +1,194 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "JobWorkers.h"
+
+namespace ARex {
+
+JobWorkers::Reservation::Reservation(JobWorkers& workers, int limit):
+    workers_(workers), running_(true), reserved_(false) {
+  reserved_ = workers_.ReserveRunning(limit);
+}
+
+JobWorkers::Reservation::Reservation(JobWorkers& workers, const std::string& dn, int limit):
+    workers_(workers), running_(false), dn_(dn), reserved_(false) {
+  reserved_ = workers_.ReservePerDN(dn_, limit);
+}
+
+JobWorkers::Reservation::~Reservation(void) {
+  if(!reserved_) return;
+  Glib::Mutex::Lock lock(workers_.limits_lock_);
+  if(running_) workers_.ReleaseRunning(); else workers_.ReleasePerDN(dn_);
+}
+
+void JobWorkers::Reservation::Commit(GMJobRef& i) {
+  Glib::Mutex::Lock lock(workers_.limits_lock_);
+  // Other threads see job either as reserved place or as counted in index
+  workers_.index_.StateChanged(i);
+  if(!reserved_) return;
+  if(running_) workers_.ReleaseRunning(); else workers_.ReleasePerDN(dn_);
+  reserved_ = false;
+}
+
+JobWorkers::JobWorkers(GMJobQueue& queue, JobIndex& index):
+    queue_(queue), index_(index),
+    processor_(NULL), processor_arg_(NULL), threads_num_(0), stopping_(false),
+    running_reserved_(0) {
+}
+
+JobWorkers::~JobWorkers(void) {
+  Stop();
+}
+
+bool JobWorkers::Run(int threads, processor_t processor, void* arg) {
+  Glib::Mutex::Lock lock(processing_lock_);
+  if(threads_num_ > 0) return false;
+  processor_ = processor;
+  processor_arg_ = arg;
+  stopping_ = false;
+  for(int n = 0; n < threads; ++n) {
+    if(!Arc::CreateThreadFunction(&Worker, this, &threads_)) break;
+    ++threads_num_;
+  };
+  return (threads_num_ > 0);
+}
+
+void JobWorkers::Stop(void) {
+  {
+    Glib::Mutex::Lock lock(processing_lock_);
+    if(threads_num_ == 0) return;
+    stopping_ = true;
+    work_cond_.broadcast();
+  };
+  threads_.wait();
+  Glib::Mutex::Lock lock(processing_lock_);
+  threads_num_ = 0;
+}
+
+bool JobWorkers::Process(void) {
+  Glib::Mutex::Lock lock(processing_lock_);
+  if((threads_num_ == 0) || stopping_) return false;
+  work_cond_.broadcast();
+  // Workers check queue under same lock before waiting, so queued
+  // jobs can't be left behind while all workers are waiting.
+  while((!queue_.IsEmpty()) || (!processing_.empty())) idle_cond_.wait(processing_lock_);
+  return true;
+}
+
+void JobWorkers::Worker(void* arg) {
+  JobWorkers& it = *reinterpret_cast<JobWorkers*>(arg);
+  Glib::Mutex::Lock lock(it.processing_lock_);
+  while(!it.stopping_) {
+    GMJobRef i = it.queue_.Pop();
+    if(!i) {
+      it.work_cond_.wait(it.processing_lock_);
+      continue;
+    };
+    JobId id = i->get_id(); // job reference is released if job is dropped
+    if(!it.processing_.insert(id).second) {
+      // Job was queued again while being processed. Handle it later.
+      it.deferred_.push_back(i);
+      continue;
+    };
+    lock.release();
+    (*(it.processor_))(it.processor_arg_, i);
+    lock.acquire();
+    it.EndLocked(id, !i);
+  };
+}
+
+bool JobWorkers::Start(GMJobRef& i) {
+  Glib::Mutex::Lock lock(processing_lock_);
+  if(!processing_.insert(i->get_id()).second) {
+    // Job was queued again while being processed. Handle it later.
+    deferred_.push_back(i);
+    return false;
+  };
+  return true;
+}
+
+void JobWorkers::End(const JobId& id, bool dropped) {
+  Glib::Mutex::Lock lock(processing_lock_);
+  EndLocked(id, dropped);
+}
+
+void JobWorkers::EndLocked(const JobId& id, bool dropped) {
+  processing_.erase(id);
+  for(std::list<GMJobRef>::iterator i = deferred_.begin(); i != deferred_.end();) {
+    if((*i)->get_id() != id) {
+      ++i;
+      continue;
+    };
+    GMJobRef job = *i;
+    i = deferred_.erase(i);
+    // Dropped job must not be processed again
+    if(dropped) continue;
+    queue_.Push(job);
+    break;
+  };
+  if(processing_.empty()) idle_cond_.broadcast();
+}
+
+bool JobWorkers::RunningLimitReached(int limit) const {
+  if(limit < 0) return false;
+  Glib::Mutex::Lock lock(limits_lock_);
+  unsigned int num = index_.InState(JOB_STATE_SUBMITTING) +
+                     index_.InState(JOB_STATE_INLRMS) +
+                     running_reserved_;
+  return num >= (unsigned int)limit;
+}
+
+bool JobWorkers::ReserveRunning(int limit) {
+  Glib::Mutex::Lock lock(limits_lock_);
+  if(limit >= 0) {
+    unsigned int num = index_.InState(JOB_STATE_SUBMITTING) +
+                       index_.InState(JOB_STATE_INLRMS) +
+                       running_reserved_;
+    if(num >= (unsigned int)limit) return false;
+  };
+  ++running_reserved_;
+  return true;
+}
+
+void JobWorkers::ReleaseRunning(void) {
+  if(running_reserved_) --running_reserved_;
+}
+
+bool JobWorkers::ReservePerDN(const std::string& dn, int limit) {
+  Glib::Mutex::Lock lock(limits_lock_);
+  if(limit >= 0) {
+    unsigned int reserved = 0;
+    std::map<std::string,unsigned int>::iterator it = dn_reserved_.find(dn);
+    if(it != dn_reserved_.end()) reserved = it->second;
+    if((index_.ForDN(dn) + reserved) >= (unsigned int)limit) return false;
+  };
+  ++(dn_reserved_[dn]);
+  return true;
+}
+
+void JobWorkers::ReleasePerDN(const std::string& dn) {
+  std::map<std::string,unsigned int>::iterator it = dn_reserved_.find(dn);
+  if(it == dn_reserved_.end()) return;
+  if(--(it->second) == 0) dn_reserved_.erase(it);
+}
+
+unsigned int JobWorkers::Processing(void) const {
+  Glib::Mutex::Lock lock(processing_lock_);
+  return processing_.size();
+}
+
+unsigned int JobWorkers::Deferred(void) const {
+  Glib::Mutex::Lock lock(processing_lock_);
+  return deferred_.size();
+}
+
+unsigned int JobWorkers::Reserved(void) const {
+  Glib::Mutex::Lock lock(limits_lock_);
+  unsigned int num = running_reserved_;
+  for(std::map<std::string,unsigned int>::const_iterator it = dn_reserved_.begin();
+                     it != dn_reserved_.end(); ++it) num += it->second;
+  return num;
+}
+
+} // namespace ARex
@@ -0,0 +1,132 @@
+#ifndef GRID_MANAGER_JOB_WORKERS_H
+#define GRID_MANAGER_JOB_WORKERS_H
+
+#include <string>
+#include <list>
+#include <map>
+#include <set>
+
+#include <arc/Thread.h>
+
+#include "GMJob.h"
+#include "JobIndex.h"
+
+namespace ARex {
+
+/// Fixed set of threads which process jobs taken from common queue.
+/** Worker threads are started once and wait for jobs to appear in queue.
+   Same job is never handled by two threads at once - request for job
+   which is already being processed is deferred and put back into queue
+   when processing ends, unless job was dropped meanwhile. Threads moving
+   jobs into states restricted by limits hold Reservation till job is
+   counted in index, so concurrent threads can't exceed limits. Negative
+   limit means no limit. */
+class JobWorkers {
+ public:
+  /// Function called by worker thread for every job taken from queue.
+  /// It must release job reference if job was dropped.
+  typedef void (*processor_t)(void* arg, GMJobRef& i);
+
+  /// Place reserved for job going to state restricted by limit.
+  /** Place is kept till job is counted in index by Commit(). If that
+     does not happen place is released when object is destroyed. */
+  class Reservation {
+   public:
+    /// Reserves place for job going to SUBMITTING if limit allows.
+    Reservation(JobWorkers& workers, int limit);
+    /// Reserves place for job of specified DN going to PREPARING if limit allows.
+    Reservation(JobWorkers& workers, const std::string& dn, int limit);
+    ~Reservation(void);
+    /// Updates job which is already in new state in index and releases
+    /// place in one step.
+    void Commit(GMJobRef& i);
+    operator bool(void) const { return reserved_; };
+    bool operator!(void) const { return !reserved_; };
+   private:
+    JobWorkers& workers_;
+    bool running_;
+    std::string dn_;
+    bool reserved_;
+    Reservation(const Reservation&);
+    Reservation& operator=(const Reservation&);
+  };
+  friend class Reservation;
+
+  JobWorkers(GMJobQueue& queue, JobIndex& index);
+  /// Stops worker threads.
+  ~JobWorkers(void);
+
+  /// Starts specified number of worker threads which pass jobs to processor.
+  /// Returns false if no thread could be started.
+  bool Run(int threads, processor_t processor, void* arg);
+
+  /// Stops worker threads. Jobs left in queue are not processed.
+  void Stop(void);
+
+  /// Wakes workers to process jobs in queue and waits till queue is empty
+  /// and no job is being processed. Must not be called from worker thread.
+  bool Process(void);
+
+  /// Marks job as being processed. If job is already processed by another
+  /// thread it is deferred and false is returned.
+  bool Start(GMJobRef& i);
+
+  /// Removes processing mark and re-queues deferred request for same job.
+  /// Deferred request for dropped job is discarded.
+  void End(const JobId& id, bool dropped = false);
+
+  /// Checks if jobs in SUBMITTING and INLRMS states together with reserved
+  /// places reach the limit.
+  bool RunningLimitReached(int limit) const;
+
+  /// Number of jobs being processed.
+  unsigned int Processing(void) const;
+
+  /// Number of deferred requests.
+  unsigned int Deferred(void) const;
+
+  /// Number of places reserved for running jobs and for all DNs.
+  unsigned int Reserved(void) const;
+
+ private:
+  GMJobQueue& queue_;
+  JobIndex& index_;
+
+  // Jobs currently handled by one of processing threads
+  std::set<JobId> processing_;
+  // Jobs which were requested while being handled by another thread
+  std::list<GMJobRef> deferred_;
+  mutable Glib::Mutex processing_lock_;
+
+  // Worker threads and what they do
+  processor_t processor_;
+  void* processor_arg_;
+  unsigned int threads_num_;
+  bool stopping_;
+  Arc::SimpleCounter threads_;
+  // Signaled when jobs are queued or workers are to stop
+  Glib::Cond work_cond_;
+  // Signaled when no job is processed
+  Glib::Cond idle_cond_;
+
+  // Number of jobs being moved to SUBMITTING but not counted in index yet
+  unsigned int running_reserved_;
+  // Number of jobs per DN being moved to active state but not counted in index yet
+  std::map<std::string,unsigned int> dn_reserved_;
+  mutable Glib::Mutex limits_lock_;
+
+  static void Worker(void* arg);
+  void EndLocked(const JobId& id, bool dropped);
+  bool ReserveRunning(int limit);
+  bool ReservePerDN(const std::string& dn, int limit);
+  // Caller must hold limits_lock_
+  void ReleaseRunning(void);
+  void ReleasePerDN(const std::string& dn);
+
+  JobWorkers(const JobWorkers&);
+  JobWorkers& operator=(const JobWorkers&);
+};
+
+} // namespace ARex
+
+#endif
@@ -4,12 +4,14 @@
 
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <cstring>
 
 #include <arc/ArcLocation.h>
 #include <arc/JobPerfLog.h>
 #include <arc/credential/VOMSUtil.h>
 
 #include "../files/ControlFileHandling.h"
+#include "../files/JobStateStore.h"
 #include "../run/RunParallel.h"
 #include "../mail/send_mail.h"
 #include "../log/JobLog.h"
@@ -21,6 +23,7 @@
 
 #include "ContinuationPlugins.h"
 #include "DTRGenerator.h"
+#include "JobOwnerIndex.h"
 #include "JobsList.h"
 
 namespace ARex {
@@ -70,45 +73,47 @@ void JobsList::ExternalHelpers::thread(void) {
 JobsList::JobsList(const GMConfig& gmconfig) :
     valid(false),
     jobs_processing(ProcessingQueuePriority, "processing"),
+    workers(jobs_processing, jobs),
     jobs_attention(AttentionQueuePriority, "attention"),
     jobs_polling(0, "polling"),
     jobs_wait_for_running(WaitQueuePriority, "wait for running"),
     config(gmconfig), staging_config(gmconfig),
     dtr_generator(config, *this),
-    job_desc_handler(config), jobs_pending(0),
+    job_desc_handler(config),
     helpers(config.Helpers(), *this) {
 
   job_slow_polling_last = time(NULL);
   job_slow_polling_dir = NULL;
 
-  for(int n = 0;n<JOB_STATE_NUM;n++) jobs_num[n]=0;
   jobs_scripts = 0;
-  jobs.clear();
 
   if(!dtr_generator) {
     logger.msg(Arc::ERROR, "Failed to start data staging threads");
     return;
   };
 
+  // Jobs are independent, so they are processed in parallel by fixed
+  // set of threads fed from processing queue.
+  if(!workers.Run(config.ProcessingThreads(), &ActJobsProcessingJob, this)) {
+    logger.msg(Arc::ERROR, "Failed to start job processing threads");
+    return;
+  };
+
   helpers.start();
 
   valid = true;
 }
 
 JobsList::~JobsList(void) {
+  workers.Stop();
 }
 
 GMJobRef JobsList::FindJob(const JobId &id) {
-  Glib::RecMutex::Lock lock(jobs_lock);
-  std::map<JobId,GMJobRef>::iterator ji = jobs.find(id);
-  if(ji == jobs.end()) return GMJobRef();
-  return ji->second;
+  return jobs.Find(id);
 }
 
 bool JobsList::HasJob(const JobId &id) const {
-  Glib::RecMutex::Lock lock(jobs_lock);
-  std::map<JobId,GMJobRef>::const_iterator ji = jobs.find(id);
-  return (ji != jobs.end());
+  return jobs.Has(id);
 }
 
 void JobsList::UpdateJobCredentials(GMJobRef i) {
@@ -145,6 +150,11 @@ void JobsList::SetJobState(GMJobRef i, job_state_t new_state, const char* reason
       msg += "\n";
       i->job_state = new_state;
       i->job_pending = false;
+      JobOwnerIndex* owners = config.GetJobOwnerIndex();
+      if(owners) {
+        if(new_state == JOB_STATE_UNDEFINED) owners->Remove(i->job_id);
+        else owners->State(i->job_id, new_state, false);
+      };
       job_errors_mark_add(*i,config,msg);
       // During intermediate period job.proxy file must contain full delegated proxy.
       // To ensure its content is up to date even if proxy was updated in store here
@@ -170,6 +180,7 @@ void JobsList::SetJobPending(GMJobRef i, const char* reason) {
       };
       msg += "\n";
       i->job_pending = true;
+      if(config.GetJobOwnerIndex()) config.GetJobOwnerIndex()->State(i->job_id, i->job_state, true);
       job_errors_mark_add(*i,config,msg);
     };
   };
@@ -190,47 +201,59 @@ bool JobsList::AddJob(const JobId &id,uid_t uid,gid_t gid,job_state_t state,cons
       logger.msg(Arc::ERROR, "%s: Failed reading .local and changing state, job and "
                              "A-REX may be left in an inconsistent state", id);
     }
-    Glib::RecMutex::Lock lock(jobs_lock);
-    if(jobs.find(id) != jobs.end()) {
+    if(!jobs.Add(i)) {
       logger.msg(Arc::ERROR, "%s: unexpected failed job add request: %s", i->job_id, reason?reason:"");
     } else {
-      jobs[id] = i;
       RequestReprocess(i); // To make job being properly thrown from system
     }
     return false;
   }
   i->session_dir = i->local->sessiondir;
   if (i->session_dir.empty()) i->session_dir = config.SessionRoot(id)+'/'+id;
-  Glib::RecMutex::Lock lock(jobs_lock);
-  if(jobs.find(id) != jobs.end()) {
+  if(!jobs.Add(i)) {
     logger.msg(Arc::ERROR, "%s: unexpected job add request: %s", i->job_id, reason?reason:"");
   } else {
-    jobs[id] = i;
+    JobOwnerIndex* owners = config.GetJobOwnerIndex();
+    if(owners) {
+      bool failed = job_failed_mark_check(id,config);
+      owners->Add(id, i->local->DN, i->job_state, i->job_pending, failed, failed && JobOwnerIndex::Killed(id,config));
+    };
     RequestAttention(i);
   }
   return true;
 }
 
 int JobsList::AcceptedJobs() const {
-  return jobs_num[JOB_STATE_ACCEPTED] +
-         jobs_num[JOB_STATE_PREPARING] +
-         jobs_num[JOB_STATE_SUBMITTING] +
-         jobs_num[JOB_STATE_INLRMS] +
-         jobs_num[JOB_STATE_FINISHING] +
-         jobs_pending;
+  return jobs.InState(JOB_STATE_ACCEPTED) +
+         jobs.InState(JOB_STATE_PREPARING) +
+         jobs.InState(JOB_STATE_SUBMITTING) +
+         jobs.InState(JOB_STATE_INLRMS) +
+         jobs.InState(JOB_STATE_FINISHING) +
+         jobs.Pending();
+}
+
+bool JobsList::ScriptsLimitReached() const {
+  if(config.MaxScripts()==-1) return false;
+  Glib::Mutex::Lock lock(limits_lock);
+  return (jobs_scripts>=config.MaxScripts());
+}
+
+bool JobsList::AddScript() {
+  Glib::Mutex::Lock lock(limits_lock);
+  ++jobs_scripts;
+  return ((config.MaxScripts()!=-1) && (jobs_scripts>=config.MaxScripts()));
 }
 
 bool JobsList::RunningJobsLimitReached() const {
   if(config.MaxRunning()==-1) return false;
-  int num = jobs_num[JOB_STATE_SUBMITTING] +
-            jobs_num[JOB_STATE_INLRMS];
-  return num >= config.MaxRunning();
+  return workers.RunningLimitReached(config.MaxRunning());
 }
 
 void JobsList::PrepareToDestroy(void) {
-  Glib::RecMutex::Lock lock(jobs_lock);
-  for(std::map<JobId,GMJobRef>::iterator i=jobs.begin();i!=jobs.end();++i) {
-    i->second->PrepareToDestroy();
+  std::list<GMJobRef> alljobs;
+  jobs.GetAll(alljobs);
+  for(std::list<GMJobRef>::iterator i=alljobs.begin();i!=alljobs.end();++i) {
+    (*i)->PrepareToDestroy();
   }
 }
 
@@ -271,7 +294,14 @@ void JobsList::RequestAttention(void) {
 }
 
 bool JobsList::ScanOldJobs(void) {
-  if(job_slow_polling_dir) {
+  if(!job_slow_polling_ids.empty()) {
+    // continue already started scaning of database content
+    JobId id = job_slow_polling_ids.front();
+    job_slow_polling_ids.pop_front();
+    logger.msg(Arc::DEBUG, "%s: job found while scanning", id);
+    RequestAttention(id);
+    return !job_slow_polling_ids.empty();
+  } else if(job_slow_polling_dir) {
     // continue already started scaning
     std::string file = job_slow_polling_dir->read_name();
     if(file.empty()) {
@@ -289,6 +319,16 @@ bool JobsList::ScanOldJobs(void) {
   } else {
     // Check if it is time for next scanning
     if((time(NULL) - job_slow_polling_last) >= job_slow_polling_period) {
+      JobStateStore* store = JobStateStore::Get(config);
+      if(store) {
+        std::list<JobStateStore::Record> recs;
+        if(store->ListGroup(JobStateStore::GroupOld, recs)) {
+          for(std::list<JobStateStore::Record>::iterator rec = recs.begin(); rec != recs.end(); ++rec)
+            job_slow_polling_ids.push_back(rec->id);
+          job_slow_polling_last = time(NULL);
+        };
+        return !job_slow_polling_ids.empty();
+      };
       job_slow_polling_dir = new Glib::Dir(config.ControlDir()+"/"+subdir_old);
       if(job_slow_polling_dir) job_slow_polling_last = time(NULL);
     };
@@ -342,12 +382,16 @@ bool JobsList::RequestReprocess(GMJobRef i) {
   return false;
 }
 
+void JobsList::ActJobsProcessingJob(void* arg, GMJobRef& i) {
+  logger.msg(Arc::DEBUG, "%s: job being processed", i->job_id);
+  reinterpret_cast<JobsList*>(arg)->ActJob(i);
+}
+
 bool JobsList::ActJobsProcessing(void) {
-  while(true) {
-    GMJobRef i = jobs_processing.Pop();
-    if(!i) break;
-    logger.msg(Arc::DEBUG, "%s: job being processed", i->job_id);
-    ActJob(i);
+  // Wait for worker threads to empty processing queue
+  if(!workers.Process()) {
+    logger.msg(Arc::ERROR, "Job processing threads are not running");
+    return false;
   };
   // Check limit on number of running jobs and activate some of them if possible
   if(!RunningJobsLimitReached()) {
@@ -380,10 +424,11 @@ bool JobsList::ActJobsPolling(void) {
   ActJobsProcessing();
   // debug info on jobs per DN
   {
-    Glib::RecMutex::Lock lock(jobs_lock);
+    std::map<std::string, unsigned int> jobs_dn;
+    jobs.GetDNs(jobs_dn);
     logger.msg(Arc::VERBOSE, "Current jobs in system (PREPARING to FINISHING) per-DN (%i entries)", jobs_dn.size());
-    for (std::map<std::string, ZeroUInt>::iterator it = jobs_dn.begin(); it != jobs_dn.end(); ++it)
-      logger.msg(Arc::VERBOSE, "%s: %i", it->first, (unsigned int)(it->second));
+    for (std::map<std::string, unsigned int>::iterator it = jobs_dn.begin(); it != jobs_dn.end(); ++it)
+      logger.msg(Arc::VERBOSE, "%s: %i", it->first, it->second);
   };
   return true;
 }
@@ -394,6 +439,7 @@ bool JobsList::FailedJob(GMJobRef i,bool cancel) {
   // add failure mark
   if(job_failed_mark_add(*i,config,i->failure_reason)) {
     i->failure_reason = "";
+    if(config.GetJobOwnerIndex()) config.GetJobOwnerIndex()->Failed(i->job_id, true, cancel || JobOwnerIndex::Killed(i->job_id,config));
   } else {
     logger.msg(Arc::ERROR,"%s: Failed storing failure reason: %s",i->job_id,Arc::StrError(errno));
     r = false;
@@ -465,7 +511,10 @@ bool JobsList::GetLocalDescription(GMJobRef i) const {
 void JobsList::CleanChildProcess(GMJobRef i) {
   if(i->child) {
     delete i->child; i->child=NULL;
-    if((i->job_state == JOB_STATE_SUBMITTING) || (i->job_state == JOB_STATE_CANCELING)) --jobs_scripts;
+    if((i->job_state == JOB_STATE_SUBMITTING) || (i->job_state == JOB_STATE_CANCELING)) {
+      Glib::Mutex::Lock lock(limits_lock);
+      --jobs_scripts;
+    }
   }
 }
 
@@ -499,7 +548,7 @@ bool JobsList::state_submitting_success(GMJobRef i,bool &state_changed,std::stri
 bool JobsList::state_submitting(GMJobRef i,bool &state_changed) {
   if(i->child == NULL) {
     // no child was running yet, or recovering from fault
-    if((config.MaxScripts()!=-1) && (jobs_scripts>=config.MaxScripts())) {
+    if(ScriptsLimitReached()) {
       //logger.msg(Arc::WARNING,"%s: Too many LRMS scripts running - limit is %u",
       //                     i->job_id,config.MaxScripts());
       // returning true but not advancing to next state should cause retry
@@ -542,8 +591,7 @@ bool JobsList::state_submitting(GMJobRef i,bool &state_changed) {
       logger.msg(Arc::ERROR,"%s: Failed running submission process",i->job_id);
       return false;
     }
-    ++jobs_scripts;
-    if((config.MaxScripts()!=-1) && (jobs_scripts>=config.MaxScripts())) {
+    if(AddScript()) {
       logger.msg(Arc::WARNING,"%s: LRMS scripts limit of %u is reached - suspending submit/cancel",
                               i->job_id,config.MaxScripts());
     }
@@ -620,7 +668,7 @@ bool JobsList::state_canceling_success(GMJobRef i,bool &state_changed) {
 bool JobsList::state_canceling(GMJobRef i,bool &state_changed) {
   if(i->child == NULL) {
     // no child was running yet, or recovering from fault
-    if((config.MaxScripts()!=-1) && (jobs_scripts>=config.MaxScripts())) {
+    if(ScriptsLimitReached()) {
       //logger.msg(Arc::WARNING,"%s: Too many LRMS scripts running - limit is %u",
       //                     i->job_id,config.MaxScripts());
       // returning true but not advancing to next state should cause retry
@@ -649,8 +697,7 @@ bool JobsList::state_canceling(GMJobRef i,bool &state_changed) {
       logger.msg(Arc::ERROR,"%s: Failed running cancellation process",i->job_id);
       return false;
     }
-    ++jobs_scripts;
-    if((config.MaxScripts()!=-1) && (jobs_scripts>=config.MaxScripts())) {
+    if(AddScript()) {
       logger.msg(Arc::WARNING,"%s: LRMS scripts limit of %u is reached - suspending submit/cancel",
                            i->job_id,config.MaxScripts());
     }
@@ -976,19 +1023,6 @@ JobsList::ActJobResult JobsList::ActJobAccepted(GMJobRef i) {
   // TODO: do it in ActJobUndefined. Otherwise one DN can block others if total limit is reached.
 
 
-  if (config.MaxPerDN() > 0) {
-    bool limited = false;
-    {
-      Glib::RecMutex::Lock lock(jobs_lock);
-      limited = (jobs_dn[i->local->DN] >= config.MaxPerDN());
-    }
-    if (limited) {
-      SetJobPending(i,"Jobs per DN limit is reached");
-      // Because we have no event for per-DN limit just do polling
-      RequestPolling(i);
-      return JobSuccess;
-    }
-  }
   // check for user specified time
   if(i->local->processtime != -1 && (i->local->processtime) > time(NULL)) {
     logger.msg(Arc::INFO,"%s: State: ACCEPTED: has process time %s",i->job_id.c_str(),
@@ -997,8 +1031,20 @@ JobsList::ActJobResult JobsList::ActJobAccepted(GMJobRef i) {
     RequestPolling(i);
     return JobSuccess;
   }
-  logger.msg(Arc::INFO,"%s: State: ACCEPTED: moving to PREPARING",i->job_id);
-  SetJobState(i, JOB_STATE_PREPARING, "Starting job processing");
+  // Other jobs of same DN may be processed in parallel. So slot is reserved
+  // till job is counted in index as active.
+  {
+    JobWorkers::Reservation place(workers, i->local->DN, (config.MaxPerDN() > 0) ? config.MaxPerDN() : -1);
+    if (!place) {
+      SetJobPending(i,"Jobs per DN limit is reached");
+      // Because we have no event for per-DN limit just do polling
+      RequestPolling(i);
+      return JobSuccess;
+    }
+    logger.msg(Arc::INFO,"%s: State: ACCEPTED: moving to PREPARING",i->job_id);
+    SetJobState(i, JOB_STATE_PREPARING, "Starting job processing");
+    place.Commit(i);
+  }
   i->Start();
 
   // gather some frontend specific information for user, do it only once
@@ -1048,9 +1094,11 @@ JobsList::ActJobResult JobsList::ActJobPreparing(GMJobRef i) {
         // RequestPolling(i);
       } else if(i->local->exec.size() > 0 && !i->local->exec.front().empty()) {
         // Job has executable
-        if(!RunningJobsLimitReached()) {
+        JobWorkers::Reservation place(workers, config.MaxRunning());
+        if(place) {
           // And limit of running jobs is not reached
           SetJobState(i, JOB_STATE_SUBMITTING, "Pre-staging finished, passing job to LRMS");
+          place.Commit(i); // count it immediately for other workers
           RequestReprocess(i); // act on new state immediately
         } else {
           // Wait for running jobs to fall below limit keeping job in PENDING
@@ -1187,6 +1235,7 @@ JobsList::ActJobResult JobsList::ActJobFinished(GMJobRef i) {
     if(state_ == JOB_STATE_PREPARING) {
       if(RecreateTransferLists(i)) {
         job_failed_mark_remove(i->job_id,config);
+        if(config.GetJobOwnerIndex()) config.GetJobOwnerIndex()->Failed(i->job_id, false);
         SetJobState(i, JOB_STATE_ACCEPTED, "Request to restart job failed in PREPARING");
         SetJobPending(i, "Skip job to PREPARING immediately"); // make it go to end of state immediately
         logger.msg(Arc::DEBUG, "%s: restarted PREPARING job", i->job_id);
@@ -1197,6 +1246,7 @@ JobsList::ActJobResult JobsList::ActJobFinished(GMJobRef i) {
               (state_ == JOB_STATE_INLRMS)) {
       if(RecreateTransferLists(i)) {
         job_failed_mark_remove(i->job_id,config);
+        if(config.GetJobOwnerIndex()) config.GetJobOwnerIndex()->Failed(i->job_id, false);
         if(i->local->downloads > 0) {
           // missing input files has to be re-downloaded
           SetJobState(i, JOB_STATE_ACCEPTED, "Request to restart job failed in INLRMS (some input files are missing)");
@@ -1212,6 +1262,7 @@ JobsList::ActJobResult JobsList::ActJobFinished(GMJobRef i) {
     } else if(state_ == JOB_STATE_FINISHING) {
       if(RecreateTransferLists(i)) {
         job_failed_mark_remove(i->job_id,config);
+        if(config.GetJobOwnerIndex()) config.GetJobOwnerIndex()->Failed(i->job_id, false);
         SetJobState(i, JOB_STATE_INLRMS, "Request to restart job failed in FINISHING");
         SetJobPending(i, "Skip job to FINISHING immediately"); // make it go to end of state immediately
         logger.msg(Arc::DEBUG, "%s: restarted FINISHING job", i->job_id);
@@ -1370,16 +1421,7 @@ bool JobsList::CheckJobContinuePlugins(GMJobRef i) {
 bool JobsList::NextJob(GMJobRef i, job_state_t old_state, bool old_pending) {
   bool at_limit = RunningJobsLimitReached();
   // update counters
-  if(!old_pending) {
-    jobs_num[old_state]--;
-  } else {
-    jobs_pending--;
-  }
-  if(!i->job_pending) {
-    jobs_num[i->job_state]++;
-  } else {
-    jobs_pending++;
-  }
+  jobs.StateChanged(i);
   if(at_limit && !RunningJobsLimitReached()) {
     // Report about change in conditions
     //RequestAttention();
@@ -1390,19 +1432,11 @@ bool JobsList::NextJob(GMJobRef i, job_state_t old_state, bool old_pending) {
 bool JobsList::DropJob(GMJobRef& i, job_state_t old_state, bool old_pending) {
   bool at_limit = RunningJobsLimitReached();
   // update counters
-  if(!old_pending) {
-    jobs_num[old_state]--;
-  } else {
-    jobs_pending--;
-  }
+  jobs.Remove(i);
   if(at_limit && !RunningJobsLimitReached()) {
     // Report about change in conditions
     RequestAttention(); // TODO: Check if really needed
   };
-  {
-    Glib::RecMutex::Lock lock(jobs_lock);
-    jobs.erase(i->job_id);
-  };
   i.Destroy();
   return true;
 }
@@ -1506,24 +1540,14 @@ bool JobsList::ActJob(GMJobRef& i) {
     // do not send if something really wrong happened to avoid email DoS
     if(job_result != JobFailed) send_mail(*i,config);
 
-    // Manage per-DN counter
+    // Per-DN counter is managed by jobs index. It needs DN of active job.
     // Any job state change goes through here
     if(!IS_ACTIVE_STATE(old_state)) {
       if(IS_ACTIVE_STATE(i->job_state)) {
         if(i->GetLocalDescription(config)) {
-          // add to DN map
           if (i->local->DN.empty()) {
              logger.msg(Arc::WARNING, "Failed to get DN information from .local file for job %s", i->job_id);
           }
-          Glib::RecMutex::Lock lock(jobs_lock);
-          ++(jobs_dn[i->local->DN]);
-        };
-      };
-    } else if(IS_ACTIVE_STATE(old_state)) {
-      if(!IS_ACTIVE_STATE(i->job_state)) {
-        if(i->GetLocalDescription(config)) {
-          Glib::RecMutex::Lock lock(jobs_lock);
-          if (--(jobs_dn[i->local->DN]) == 0) jobs_dn.erase(i->local->DN);
         };
       };
     };
@@ -1645,6 +1669,26 @@ bool JobsList::RestartJobs(const std::string& cdir,const std::string& odir) {
 // This code is run at service restart
 bool JobsList::RestartJobs(void) {
   std::string cdir=config.ControlDir();
+  JobStateStore* store = JobStateStore::Get(config);
+  if(store) {
+    std::list<JobStateStore::Record> recs;
+    if(!store->ListGroup(JobStateStore::GroupCurrent, recs)) return false;
+    bool res = true;
+    (void)store->Begin();
+    for(std::list<JobStateStore::Record>::iterator rec = recs.begin(); rec != recs.end(); ++rec) {
+      if(!store->SetGroup(rec->id, JobStateStore::GroupRestarting)) {
+        logger.msg(Arc::ERROR,"%s: Failed to move job to restarting in database",rec->id);
+        res=false;
+        continue;
+      };
+      // Keep status file for information system in matching location
+      std::string fname=cdir+"/"+subdir_cur+"/job."+rec->id+".status";
+      std::string oname=cdir+"/"+subdir_rew+"/job."+rec->id+".status";
+      (void)::rename(fname.c_str(),oname.c_str());
+    };
+    (void)store->Commit();
+    return res;
+  };
   // Jobs from old version
   bool res1 = RestartJobs(cdir,cdir+"/"+subdir_rew);
   // Jobs after service restart
@@ -1652,9 +1696,25 @@ bool JobsList::RestartJobs(void) {
   return res1 && res2;
 }
 
-bool JobsList::ScanJobDesc(const std::string& cdir, JobFDesc& id) {
+static JobStateStore::group_t subdir_group(const char* subdir) {
+  if(strcmp(subdir,subdir_new) == 0) return JobStateStore::GroupNew;
+  if(strcmp(subdir,subdir_cur) == 0) return JobStateStore::GroupCurrent;
+  if(strcmp(subdir,subdir_old) == 0) return JobStateStore::GroupOld;
+  if(strcmp(subdir,subdir_rew) == 0) return JobStateStore::GroupRestarting;
+  return JobStateStore::GroupNone;
+}
+
+bool JobsList::ScanJobDesc(const char* subdir, JobFDesc& id) {
   if(!FindJob(id.id)) {
-    std::string fname=cdir+'/'+"job."+id.id+".status";
+    JobStateStore* store = JobStateStore::Get(config);
+    if(store) {
+      JobStateStore::Record rec;
+      if(!store->ReadState(id.id,rec)) return false;
+      if(rec.group != subdir_group(subdir)) return false;
+      id.uid=rec.uid; id.gid=rec.gid; id.t=rec.modified;
+      return true;
+    };
+    std::string fname=config.ControlDir()+'/'+subdir+'/'+"job."+id.id+".status";
     uid_t uid;
     gid_t gid;
     time_t t;
@@ -1666,7 +1726,7 @@ bool JobsList::ScanJobDesc(const std::string& cdir, JobFDesc& id) {
   return false;
 }
 
-bool JobsList::ScanJobDescs(const std::string& cdir,std::list<JobFDesc>& ids) const {
+bool JobsList::ScanJobDescs(const char* subdir,std::list<JobFDesc>& ids) const {
   class JobFilterSkipExisting: public JobFilter {
   public:
     JobFilterSkipExisting(JobsList const& jobs): jobs_(jobs) {};
@@ -1677,7 +1737,7 @@ bool JobsList::ScanJobDescs(const std::string& cdir,std::list<JobFDesc>& ids) co
   };
 
   Arc::JobPerfRecord perfrecord(*config.GetJobPerfLog(), "*");
-  bool result = ScanAllJobs(cdir, ids, JobFilterSkipExisting(*this));
+  bool result = ScanAllJobs(config, subdir, ids, JobFilterSkipExisting(*this));
   perfrecord.End("SCAN-JOBS");
   return result;
 }
@@ -1713,6 +1773,23 @@ bool JobsList::ScanAllJobs(const std::string& cdir,std::list<JobFDesc>& ids, Job
   return true;
 }
 
+bool JobsList::ScanAllJobs(const GMConfig& config,const char* subdir,std::list<JobFDesc>& ids, JobFilter const& filter) {
+  JobStateStore* store = JobStateStore::Get(config);
+  if(!store) return ScanAllJobs(config.ControlDir()+"/"+subdir, ids, filter);
+  std::list<JobStateStore::Record> recs;
+  if(!store->ListGroup(subdir_group(subdir), recs)) {
+    logger.msg(Arc::ERROR,"Failed reading jobs database: %s", store->Error());
+    return false;
+  };
+  for(std::list<JobStateStore::Record>::iterator rec = recs.begin(); rec != recs.end(); ++rec) {
+    if(!filter.accept(rec->id)) continue;
+    JobFDesc id(rec->id);
+    id.uid=rec->uid; id.gid=rec->gid; id.t=rec->modified;
+    ids.push_back(id);
+  };
+  return true;
+}
+
 bool JobsList::ScanMarks(const std::string& cdir,const std::list<std::string>& suffices,std::list<JobFDesc>& ids) {
   Arc::JobPerfRecord perfrecord(*config.GetJobPerfLog(), "*");
 
@@ -1758,9 +1835,7 @@ bool JobsList::ScanNewJob(const JobId& id) {
   // New jobs will be accepted only if number of jobs being processed
   if((AcceptedJobs() < config.MaxJobs()) || (config.MaxJobs() == -1)) {
     JobFDesc fid(id);
-    std::string cdir=config.ControlDir();
-    std::string ndir=cdir+"/"+subdir_new;
-    if(!ScanJobDesc(ndir,fid)) return false;
+    if(!ScanJobDesc(subdir_new,fid)) return false;
     return AddJob(fid.id,fid.uid,fid.gid,"scan for specific new job");
   }
   return false;
@@ -1768,9 +1843,7 @@ bool JobsList::ScanNewJob(const JobId& id) {
 
 bool JobsList::ScanOldJob(const JobId& id) {
   JobFDesc fid(id);
-  std::string cdir=config.ControlDir();
-  std::string ndir=cdir+"/"+subdir_old;
-  if(!ScanJobDesc(ndir,fid)) return false;
+  if(!ScanJobDesc(subdir_old,fid)) return false;
   job_state_t st = job_state_read_file(id,config);
   if(st == JOB_STATE_FINISHED || st == JOB_STATE_DELETED) {
     return AddJob(fid.id,fid.uid,fid.gid,st,"scan for specific old job");
@@ -1778,17 +1851,20 @@ bool JobsList::ScanOldJob(const JobId& id) {
   return false;
 }
 
+bool JobsList::ScanChangedJob(const JobId& id) {
+  if(HasJob(id)) return true;
+  return ScanNewJob(id) || ScanOldJob(id);
+}
+
 // find new jobs - sort by date to implement FIFO
 bool JobsList::ScanNewJobs(void) {
   Arc::JobPerfRecord perfrecord(*config.GetJobPerfLog(), "*");
   // New jobs will be accepted only if number of jobs being processed
   // does not exceed allowed. So avoid scanning if no jobs will be allowed.
-  std::string cdir=config.ControlDir();
   if((config.MaxJobs() == -1) || (AcceptedJobs() < config.MaxJobs())) {
     std::list<JobFDesc> ids;
     // For picking up jobs after service restart
-    std::string odir=cdir+"/"+subdir_rew;
-    if(!ScanJobDescs(odir,ids)) return false;
+    if(!ScanJobDescs(subdir_rew,ids)) return false;
     // sorting by date
     ids.sort();
     for(std::list<JobFDesc>::iterator id=ids.begin();id!=ids.end();++id) {
@@ -1799,8 +1875,7 @@ bool JobsList::ScanNewJobs(void) {
   if((config.MaxJobs() == -1) || (AcceptedJobs() < config.MaxJobs())) {
     std::list<JobFDesc> ids;
     // For new jobs
-    std::string ndir=cdir+"/"+subdir_new;
-    if(!ScanJobDescs(ndir,ids)) return false;
+    if(!ScanJobDescs(subdir_new,ids)) return false;
     // sorting by date
     ids.sort();
     for(std::list<JobFDesc>::iterator id=ids.begin();id!=ids.end();++id) {
@@ -1816,14 +1891,29 @@ bool JobsList::ScanNewJobs(void) {
 bool JobsList::ScanNewMarks(void) {
   Arc::JobPerfRecord perfrecord(*config.GetJobPerfLog(), "*");
 
-  std::string cdir=config.ControlDir();
-  std::string ndir=cdir+"/"+subdir_new;
   std::list<JobFDesc> ids;
-  std::list<std::string> sfx;
-  sfx.push_back(sfx_clean);
-  sfx.push_back(sfx_restart);
-  sfx.push_back(sfx_cancel);
-  if(!ScanMarks(ndir,sfx,ids)) return false;
+  JobStateStore* store = JobStateStore::Get(config);
+  if(store) {
+    static const JobStateStore::mark_t marks[] = {
+      JobStateStore::MarkClean, JobStateStore::MarkRestart, JobStateStore::MarkCancel };
+    for(unsigned int n = 0; n < sizeof(marks)/sizeof(marks[0]); ++n) {
+      std::list<JobStateStore::Record> recs;
+      if(!store->ListMarks(marks[n], recs)) return false;
+      for(std::list<JobStateStore::Record>::iterator rec = recs.begin(); rec != recs.end(); ++rec) {
+        if(FindJob(rec->id)) continue;
+        JobFDesc id(rec->id);
+        id.uid=rec->uid; id.gid=rec->gid; id.t=rec->modified;
+        ids.push_back(id);
+      };
+    };
+  } else {
+    std::string ndir=config.ControlDir()+"/"+subdir_new;
+    std::list<std::string> sfx;
+    sfx.push_back(sfx_clean);
+    sfx.push_back(sfx_restart);
+    sfx.push_back(sfx_cancel);
+    if(!ScanMarks(ndir,sfx,ids)) return false;
+  };
   ids.sort();
   std::string last_id;
   for(std::list<JobFDesc>::iterator id=ids.begin();id!=ids.end();++id) {
@@ -1856,17 +1946,15 @@ bool JobsList::GetAllJobs(const GMConfig& config, std::list<GMJobRef>& alljobs)
     virtual bool accept(JobId const& id) const { return true; };
   };
 
-  std::list<std::string> subdirs;
-  subdirs.push_back(std::string("/")+subdir_rew); // For picking up jobs after service restart
-  subdirs.push_back(std::string("/")+subdir_new); // For new jobs
-  subdirs.push_back(std::string("/")+subdir_cur); // For active jobs
-  subdirs.push_back(std::string("/")+subdir_old); // For done jobs
-  for(std::list<std::string>::iterator subdir = subdirs.begin();
+  std::list<const char*> subdirs;
+  subdirs.push_back(subdir_rew); // For picking up jobs after service restart
+  subdirs.push_back(subdir_new); // For new jobs
+  subdirs.push_back(subdir_cur); // For active jobs
+  subdirs.push_back(subdir_old); // For done jobs
+  for(std::list<const char*>::iterator subdir = subdirs.begin();
                                subdir != subdirs.end();++subdir) {
-    std::string cdir=config.ControlDir();
     std::list<JobFDesc> ids;
-    std::string odir=cdir+(*subdir);
-    if(!ScanAllJobs(odir,ids,JobFilterNoSkip())) return false;
+    if(!ScanAllJobs(config,*subdir,ids,JobFilterNoSkip())) return false;
     // sorting by date
     ids.sort();
     for(std::list<JobFDesc>::iterator id=ids.begin();id!=ids.end();++id) {
@@ -1890,17 +1978,15 @@ bool JobsList::GetAllJobIds(const GMConfig& config, std::list<JobId>& alljobs) {
     virtual bool accept(JobId const& id) const { return true; };
   };
 
-  std::list<std::string> subdirs;
-  subdirs.push_back(std::string("/")+subdir_rew); // For picking up jobs after service restart
-  subdirs.push_back(std::string("/")+subdir_new); // For new jobs
-  subdirs.push_back(std::string("/")+subdir_cur); // For active jobs
-  subdirs.push_back(std::string("/")+subdir_old); // For done jobs
-  for(std::list<std::string>::iterator subdir = subdirs.begin();
+  std::list<const char*> subdirs;
+  subdirs.push_back(subdir_rew); // For picking up jobs after service restart
+  subdirs.push_back(subdir_new); // For new jobs
+  subdirs.push_back(subdir_cur); // For active jobs
+  subdirs.push_back(subdir_old); // For done jobs
+  for(std::list<const char*>::iterator subdir = subdirs.begin();
                                subdir != subdirs.end();++subdir) {
-    std::string cdir=config.ControlDir();
     std::list<JobFDesc> ids;
-    std::string odir=cdir+(*subdir);
-    if(!ScanAllJobs(odir,ids,JobFilterNoSkip())) return false;
+    if(!ScanAllJobs(config,*subdir,ids,JobFilterNoSkip())) return false;
     // sorting by date
     ids.sort();
     for(std::list<JobFDesc>::iterator id=ids.begin();id!=ids.end();++id) {
@@ -1912,6 +1998,16 @@ bool JobsList::GetAllJobIds(const GMConfig& config, std::list<JobId>& alljobs) {
 
 // Only used by gm-jobs
 GMJobRef JobsList::GetJob(const GMConfig& config, const JobId& id) {
+  JobStateStore* store = JobStateStore::Get(config);
+  if(store) {
+    JobStateStore::Record rec;
+    if(!store->ReadState(id,rec)) return GMJobRef();
+    GMJobRef i(new GMJob(id,Arc::User(rec.uid)));
+    if (!i->GetLocalDescription(config)) return GMJobRef();
+    i->session_dir = i->local->sessiondir;
+    if (i->session_dir.empty()) i->session_dir = config.SessionRoot(id)+'/'+id;
+    return i;
+  };
   std::list<std::string> subdirs;
   subdirs.push_back(std::string("/")+subdir_rew); // For picking up jobs after service restart
   subdirs.push_back(std::string("/")+subdir_new); // For new jobs
@@ -1947,17 +2043,15 @@ int JobsList::CountAllJobs(const GMConfig& config) {
   };
 
   int count = 0;
-  std::list<std::string> subdirs;
-  subdirs.push_back(std::string("/")+subdir_rew); // For picking up jobs after service restart
-  subdirs.push_back(std::string("/")+subdir_new); // For new jobs
-  subdirs.push_back(std::string("/")+subdir_cur); // For active jobs
-  subdirs.push_back(std::string("/")+subdir_old); // For done jobs
-  for(std::list<std::string>::iterator subdir = subdirs.begin();
+  std::list<const char*> subdirs;
+  subdirs.push_back(subdir_rew); // For picking up jobs after service restart
+  subdirs.push_back(subdir_new); // For new jobs
+  subdirs.push_back(subdir_cur); // For active jobs
+  subdirs.push_back(subdir_old); // For done jobs
+  for(std::list<const char*>::iterator subdir = subdirs.begin();
                                subdir != subdirs.end();++subdir) {
-    std::string cdir=config.ControlDir();
     std::list<JobFDesc> ids;
-    std::string odir=cdir+(*subdir);
-    if(ScanAllJobs(odir,ids,JobFilterNoSkip())) {
+    if(ScanAllJobs(config,*subdir,ids,JobFilterNoSkip())) {
       count += ids.size();
     };
   };
@@ -3,6 +3,7 @@
 
 #include <sys/types.h>
 #include <list>
+#include <set>
 #include <glib.h>
 
 #include <arc/Thread.h>
@@ -10,6 +11,8 @@
 #include "../conf/StagingConfig.h"
 
 #include "GMJob.h"
+#include "JobIndex.h"
+#include "JobWorkers.h"
 #include "JobDescriptionHandler.h"
 #include "DTRGenerator.h"
 
@@ -46,15 +49,18 @@ class JobsList {
  private:
   bool valid;
 
-  // List of jobs currently tracked in memory conveniently indexed by identifier.
+  // List of jobs currently tracked in memory conveniently indexed by identifier,
+  // state and DN. It also holds number of jobs for every state and number of
+  // active jobs for each DN.
   // TODO: It would be nice to remove it and use status files distribution among
   // subfolders in controldir.
-  std::map<JobId,GMJobRef> jobs;         
-
-  mutable Glib::RecMutex jobs_lock;
+  JobIndex jobs;
 
   GMJobQueue jobs_processing;   // List of jobs currently scheduled for processing
 
+  // Processing threads and reservations for limited states
+  JobWorkers workers;
+
   GMJobQueue jobs_attention;    // List of jobs which need attention
   Arc::SimpleCondition jobs_attention_cond;
 
@@ -66,6 +72,7 @@ class JobsList {
   time_t job_slow_polling_last;
   static time_t const job_slow_polling_period = 24UL*60UL*60UL; // todo: variable
   Glib::Dir* job_slow_polling_dir;
+  std::list<JobId> job_slow_polling_ids; // used instead of directory if states are in database
 
   // GM configuration
   const GMConfig& config;
@@ -75,13 +82,10 @@ class JobsList {
   DTRGenerator dtr_generator;
   // Job description handler
   JobDescriptionHandler job_desc_handler;
-  // number of jobs for every state
-  int jobs_num[JOB_STATE_NUM];
+  // number of running submit/cancel scripts
   int jobs_scripts;
-  // map of number of active jobs for each DN
-  std::map<std::string, ZeroUInt> jobs_dn;
-  // number of jobs currently in pending state
-  int jobs_pending;
+  // protects number of running scripts
+  mutable Glib::Mutex limits_lock;
 
   // Add job into list. It is supposed to be called only for jobs which are not in main list.
   bool AddJob(const JobId &id,uid_t uid,gid_t gid,job_state_t state,const char* reason = NULL);
@@ -114,11 +118,11 @@ class JobsList {
   // In case of job restart, recreates lists of input and output files taking
   // into account what was already transferred
   bool RecreateTransferLists(GMJobRef i);
-  // Read into ids all jobs in the given dir except those already being handled
-  bool ScanJobDescs(const std::string& cdir,std::list<JobFDesc>& ids) const;
-  // Check and read into id information about job in the given dir 
+  // Read into ids all jobs in the given subdir except those already being handled
+  bool ScanJobDescs(const char* subdir,std::list<JobFDesc>& ids) const;
+  // Check and read into id information about job in the given subdir
   // (id has job id filled on entry) unless job is already handled
-  bool ScanJobDesc(const std::string& cdir,JobFDesc& id);
+  bool ScanJobDesc(const char* subdir,JobFDesc& id);
   // Read into ids all jobs in the given dir with marks given by suffices
   // (corresponding to file suffixes) except those of jobs already handled
   bool ScanMarks(const std::string& cdir,const std::list<std::string>& suffices,std::list<JobFDesc>& ids);
@@ -190,9 +194,17 @@ class JobsList {
   // Returns false if job is not allowed to continue.
   bool CheckJobContinuePlugins(GMJobRef i);
 
-  // Call ActJob for all jobs in processing queue
+  // Let worker threads call ActJob for all jobs in processing queue
   bool ActJobsProcessing(void);
 
+  // Called by worker thread for every job taken from processing queue
+  static void ActJobsProcessingJob(void* arg, GMJobRef& i);
+
+  // Checks limit on submit/cancel scripts
+  bool ScriptsLimitReached() const;
+  // Counts new script. Returns true if limit is reached.
+  bool AddScript();
+
   // Inform this instance that job with specified id needs immediate re-processing
   bool RequestReprocess(GMJobRef i);
 
@@ -263,8 +275,6 @@ class JobsList {
   // Return iterator to object matching given id or null if not found
   GMJobRef FindJob(const JobId &id);
 
-  bool HasJob(const JobId &id) const;
-
  public:
   static const int ProcessingQueuePriority = 3;
   static const int AttentionQueuePriority = 2;
@@ -295,6 +305,9 @@ class JobsList {
   // Inform this instance that generic unscheduled attention is needed
   void RequestAttention();
 
+  // Check if job with specified id is being processed
+  bool HasJob(const JobId &id) const;
+
   // Call ActJob for all current jobs
   bool ActJobs(void);
 
@@ -313,6 +326,11 @@ class JobsList {
   // Look for old job with specified id. Job is added to list with its current state and requested for attention.
   bool ScanOldJob(const JobId& id);
 
+  // Status file of job with specified id was written. Jobs which are already being processed
+  // are skipped because such changes are caused by processing itself. Otherwise job is looked
+  // for as new or old one. Returns false if job was not picked up.
+  bool ScanChangedJob(const JobId& id);
+
   // Pick jobs which have been marked for restarting, cancelling or cleaning
   bool ScanNewMarks(void);
 
@@ -343,6 +361,10 @@ class JobsList {
   // Fils ids with information about those jobs.
   // Uses filter to skip jobs which do not fit filter requirments.
   static bool ScanAllJobs(const std::string& cdir,std::list<JobFDesc>& ids, JobFilter const& filter);
+
+  // Same as above but for jobs residing in specified subdirectory of control
+  // directory. If states are kept in database it is used instead of directory.
+  static bool ScanAllJobs(const GMConfig& config,const char* subdir,std::list<JobFDesc>& ids, JobFilter const& filter);
   
 
   // Collect all jobs in all states and return references to their descriptions in alljobs.
@@ -0,0 +1,118 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <arc/FileUtils.h>
+#include <arc/User.h>
+
+#include "../../conf/GMConfig.h"
+#include "../../files/ControlFileHandling.h"
+#include "../GMJob.h"
+#include "../JobsList.h"
+#include "../ControlDirWatcher.h"
+
+using namespace ARex;
+
+class ControlDirWatcherTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(ControlDirWatcherTest);
+  CPPUNIT_TEST(TestMarkFiles);
+  CPPUNIT_TEST(TestMarksInDatabase);
+  CPPUNIT_TEST(TestInactive);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+  void TestMarkFiles();
+  void TestMarksInDatabase();
+  void TestInactive();
+
+private:
+  std::string dir;
+  GMConfig* config;
+};
+
+void ControlDirWatcherTest::setUp() {
+  CPPUNIT_ASSERT(Arc::TmpDirCreate(dir));
+  const char* subdirs[] = { subdir_new, subdir_cur, subdir_old, subdir_rew };
+  for(unsigned int n = 0; n < sizeof(subdirs)/sizeof(subdirs[0]); ++n) {
+    CPPUNIT_ASSERT(Arc::DirCreate(dir + "/" + subdirs[n], S_IRWXU, false));
+  }
+  config = new GMConfig();
+  config->SetControlDir(dir);
+}
+
+void ControlDirWatcherTest::tearDown() {
+  delete config;
+  Arc::DirDelete(dir, true);
+}
+
+// Waits for notification to be processed
+static bool WaitEvents(const ControlDirWatcher& watcher, unsigned long long int events) {
+  for(int n = 0; n < 100; ++n) {
+    if(watcher.Events() >= events) return true;
+    ::usleep(50000);
+  }
+  return false;
+}
+
+void ControlDirWatcherTest::TestMarkFiles() {
+  JobsList jobs(*config);
+  ControlDirWatcher watcher(*config, jobs);
+  // Kernel may not support notifications
+  if(!watcher.start()) return;
+  CPPUNIT_ASSERT(watcher.active());
+  CPPUNIT_ASSERT(watcher.WatchesMarks());
+  // First scan is always done, then only when requested
+  CPPUNIT_ASSERT(watcher.TakeRescan(false));
+  CPPUNIT_ASSERT(!watcher.TakeRescan(true));
+
+  GMJob job("watchertest1", Arc::User());
+  CPPUNIT_ASSERT(job_cancel_mark_put(job, *config));
+  CPPUNIT_ASSERT(WaitEvents(watcher, 1));
+  // Mark of unknown job needs scan
+  CPPUNIT_ASSERT(watcher.TakeRescan(false));
+}
+
+void ControlDirWatcherTest::TestMarksInDatabase() {
+  config->SetControlStoreType(GMConfig::control_store_sqlite);
+  JobsList jobs(*config);
+  ControlDirWatcher watcher(*config, jobs);
+  if(!watcher.start()) return;
+  CPPUNIT_ASSERT(watcher.active());
+  // Marks are rows in database and must be scanned for at polling
+  CPPUNIT_ASSERT(!watcher.WatchesMarks());
+  CPPUNIT_ASSERT(watcher.TakeRescan(false));
+
+  GMJob job("watchertest2", Arc::User());
+  CPPUNIT_ASSERT(job_cancel_mark_put(job, *config));
+  CPPUNIT_ASSERT(job_cancel_mark_check(job.get_id(), *config));
+  ::usleep(200000);
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)0, watcher.Events());
+  CPPUNIT_ASSERT(!watcher.TakeRescan(false));
+}
+
+void ControlDirWatcherTest::TestInactive() {
+  config->SetWatchControlDir(false);
+  JobsList jobs(*config);
+  ControlDirWatcher watcher(*config, jobs);
+  CPPUNIT_ASSERT(!watcher.start());
+  CPPUNIT_ASSERT(!watcher.active());
+  CPPUNIT_ASSERT(!watcher.WatchesMarks());
+  // Every polling causes full scan
+  CPPUNIT_ASSERT(watcher.TakeRescan(false));
+  CPPUNIT_ASSERT(!watcher.TakeRescan(false));
+  CPPUNIT_ASSERT(watcher.TakeRescan(true));
+  CPPUNIT_ASSERT(watcher.TakeRescan(true));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ControlDirWatcherTest);
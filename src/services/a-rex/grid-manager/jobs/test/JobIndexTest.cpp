@@ -0,0 +1,318 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string>
+#include <list>
+#include <map>
+#include <set>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <sched.h>
+
+#include <arc/StringConv.h>
+#include <arc/Thread.h>
+#include <arc/User.h>
+
+#include "../../files/ControlFileContent.h"
+#include "../GMJob.h"
+#include "../JobIndex.h"
+
+namespace ARex {
+
+// Gives test access to job internals normally changed by JobsList
+class GMJobMock {
+ public:
+  static void SetState(GMJobRef& i, job_state_t state, bool pending = false) {
+    i->job_state = state;
+    i->job_pending = pending;
+  }
+  static void SetDN(GMJobRef& i, const std::string& dn) {
+    if(!i->local) i->local = new JobLocalDescription;
+    i->local->DN = dn;
+  }
+  static bool Pending(GMJobRef& i) { return i->job_pending; }
+};
+
+} // namespace ARex
+
+using namespace ARex;
+
+class JobIndexTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(JobIndexTest);
+  CPPUNIT_TEST(TestAddRemove);
+  CPPUNIT_TEST(TestStates);
+  CPPUNIT_TEST(TestDN);
+  CPPUNIT_TEST(TestConcurrent);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+  void TestAddRemove();
+  void TestStates();
+  void TestDN();
+  void TestConcurrent();
+
+private:
+  static const int StableNum = 50;
+  static const int TransientNum = 10;
+  static const int ChangersNum = 2;
+  static const int Iterations = 200;
+
+  JobIndex* index;
+  std::list<GMJobRef> jobs;
+
+  Glib::Mutex lock;
+  int changers;
+  int errors;
+
+  GMJobRef NewJob(const JobId& id, job_state_t state, const std::string& dn = "");
+  void Error();
+  bool Running();
+  static void Change(void* arg);
+  static void Churn(void* arg);
+  static void Read(void* arg);
+};
+
+void JobIndexTest::setUp() {
+  index = new JobIndex;
+  changers = 0;
+  errors = 0;
+}
+
+void JobIndexTest::tearDown() {
+  for(std::list<GMJobRef>::iterator i = jobs.begin(); i != jobs.end(); ++i) index->Remove(*i);
+  delete index;
+  for(std::list<GMJobRef>::iterator i = jobs.begin(); i != jobs.end(); ++i) i->Destroy();
+  jobs.clear();
+}
+
+GMJobRef JobIndexTest::NewJob(const JobId& id, job_state_t state, const std::string& dn) {
+  GMJobRef i(new GMJob(id, Arc::User(), "", state));
+  if(!dn.empty()) GMJobMock::SetDN(i, dn);
+  return i;
+}
+
+void JobIndexTest::TestAddRemove() {
+  GMJobRef i1 = NewJob("indextest1", JOB_STATE_ACCEPTED);
+  GMJobRef i2 = NewJob("indextest2", JOB_STATE_ACCEPTED);
+  jobs.push_back(i1);
+  jobs.push_back(i2);
+  CPPUNIT_ASSERT(index->Add(i1));
+  CPPUNIT_ASSERT(!index->Add(i1));
+  CPPUNIT_ASSERT(index->Add(i2));
+  CPPUNIT_ASSERT_EQUAL(2U, index->Size());
+  CPPUNIT_ASSERT(index->Has("indextest1"));
+  CPPUNIT_ASSERT(index->Find("indextest2") == i2);
+  CPPUNIT_ASSERT(!index->Find("indextest3"));
+  std::list<GMJobRef> all;
+  index->GetAll(all);
+  CPPUNIT_ASSERT_EQUAL(2, (int)all.size());
+  all.clear();
+
+  CPPUNIT_ASSERT(index->Remove(i1));
+  CPPUNIT_ASSERT(!index->Remove(i1));
+  CPPUNIT_ASSERT(!index->Has("indextest1"));
+  CPPUNIT_ASSERT_EQUAL(1U, index->Size());
+  CPPUNIT_ASSERT_EQUAL(1U, index->InState(JOB_STATE_ACCEPTED));
+  // Removed job is not affected by state changes
+  GMJobMock::SetState(i1, JOB_STATE_PREPARING);
+  index->StateChanged(i1);
+  CPPUNIT_ASSERT_EQUAL(0U, index->InState(JOB_STATE_PREPARING));
+  CPPUNIT_ASSERT_EQUAL(1U, index->Size());
+}
+
+void JobIndexTest::TestStates() {
+  GMJobRef i1 = NewJob("indextest1", JOB_STATE_ACCEPTED);
+  GMJobRef i2 = NewJob("indextest2", JOB_STATE_ACCEPTED);
+  jobs.push_back(i1);
+  jobs.push_back(i2);
+  index->Add(i1);
+  index->Add(i2);
+  CPPUNIT_ASSERT_EQUAL(2U, index->InState(JOB_STATE_ACCEPTED));
+
+  GMJobMock::SetState(i1, JOB_STATE_PREPARING);
+  index->StateChanged(i1);
+  CPPUNIT_ASSERT_EQUAL(1U, index->InState(JOB_STATE_ACCEPTED));
+  CPPUNIT_ASSERT_EQUAL(1U, index->InState(JOB_STATE_PREPARING));
+
+  // Pending jobs are counted separately
+  GMJobMock::SetState(i2, JOB_STATE_ACCEPTED, true);
+  index->StateChanged(i2);
+  CPPUNIT_ASSERT_EQUAL(0U, index->InState(JOB_STATE_ACCEPTED));
+  CPPUNIT_ASSERT_EQUAL(1U, index->Pending());
+
+  GMJobMock::SetState(i2, JOB_STATE_PREPARING);
+  index->StateChanged(i2);
+  CPPUNIT_ASSERT_EQUAL(0U, index->Pending());
+  CPPUNIT_ASSERT_EQUAL(2U, index->InState(JOB_STATE_PREPARING));
+
+  index->Remove(i2);
+  CPPUNIT_ASSERT_EQUAL(1U, index->InState(JOB_STATE_PREPARING));
+}
+
+void JobIndexTest::TestDN() {
+  GMJobRef i1 = NewJob("indextest1", JOB_STATE_ACCEPTED, "/CN=user1");
+  GMJobRef i2 = NewJob("indextest2", JOB_STATE_PREPARING, "/CN=user1");
+  GMJobRef i3 = NewJob("indextest3", JOB_STATE_PREPARING);
+  jobs.push_back(i1);
+  jobs.push_back(i2);
+  jobs.push_back(i3);
+  index->Add(i1);
+  index->Add(i2);
+  index->Add(i3);
+  // Only active jobs are counted
+  CPPUNIT_ASSERT_EQUAL(1U, index->ForDN("/CN=user1"));
+  GMJobMock::SetState(i1, JOB_STATE_INLRMS);
+  index->StateChanged(i1);
+  CPPUNIT_ASSERT_EQUAL(2U, index->ForDN("/CN=user1"));
+  // Description loaded after job became active
+  GMJobMock::SetDN(i3, "/CN=user2");
+  index->StateChanged(i3);
+  CPPUNIT_ASSERT_EQUAL(1U, index->ForDN("/CN=user2"));
+  std::map<std::string,unsigned int> dns;
+  index->GetDNs(dns);
+  CPPUNIT_ASSERT_EQUAL(2, (int)dns.size());
+
+  GMJobMock::SetState(i1, JOB_STATE_FINISHED);
+  index->StateChanged(i1);
+  CPPUNIT_ASSERT_EQUAL(1U, index->ForDN("/CN=user1"));
+  index->Remove(i2);
+  CPPUNIT_ASSERT_EQUAL(0U, index->ForDN("/CN=user1"));
+  index->Remove(i3);
+  index->GetDNs(dns);
+  CPPUNIT_ASSERT(dns.empty());
+}
+
+void JobIndexTest::Error() {
+  Glib::Mutex::Lock l(lock);
+  ++errors;
+}
+
+bool JobIndexTest::Running() {
+  Glib::Mutex::Lock l(lock);
+  return (changers > 0);
+}
+
+struct ChangerArg {
+  JobIndexTest* test;
+  std::list<GMJobRef> jobs;
+};
+
+// Moves own subset of jobs through states like processing threads do
+void JobIndexTest::Change(void* arg) {
+  ChangerArg* carg = reinterpret_cast<ChangerArg*>(arg);
+  static const job_state_t states[] = { JOB_STATE_ACCEPTED, JOB_STATE_PREPARING,
+                                        JOB_STATE_SUBMITTING, JOB_STATE_INLRMS,
+                                        JOB_STATE_FINISHING, JOB_STATE_FINISHED };
+  static const int statesNum = sizeof(states)/sizeof(states[0]);
+  for(int n = 0; n < Iterations; ++n) {
+    for(std::list<GMJobRef>::iterator i = carg->jobs.begin(); i != carg->jobs.end(); ++i) {
+      GMJobMock::SetState(*i, states[n % statesNum], (n % 7) == 3);
+      carg->test->index->StateChanged(*i);
+    }
+    sched_yield();
+  }
+  Glib::Mutex::Lock l(carg->test->lock);
+  --(carg->test->changers);
+}
+
+// Adds and removes unrelated jobs
+void JobIndexTest::Churn(void* arg) {
+  JobIndexTest& test = *reinterpret_cast<JobIndexTest*>(arg);
+  std::list<GMJobRef> transient;
+  {
+    Glib::Mutex::Lock l(test.lock);
+    for(std::list<GMJobRef>::iterator i = test.jobs.begin(); i != test.jobs.end(); ++i) {
+      if((*i)->get_id().find("indextransient") == 0) transient.push_back(*i);
+    }
+  }
+  while(test.Running()) {
+    for(std::list<GMJobRef>::iterator i = transient.begin(); i != transient.end(); ++i) {
+      GMJobMock::SetState(*i, JOB_STATE_INLRMS);
+      if(!test.index->Add(*i)) test.Error();
+    }
+    sched_yield();
+    for(std::list<GMJobRef>::iterator i = transient.begin(); i != transient.end(); ++i) {
+      GMJobMock::SetState(*i, JOB_STATE_FINISHED);
+      test.index->StateChanged(*i);
+      if(!test.index->Remove(*i)) test.Error();
+    }
+  }
+}
+
+// Iterates index while it is modified
+void JobIndexTest::Read(void* arg) {
+  JobIndexTest& test = *reinterpret_cast<JobIndexTest*>(arg);
+  while(test.Running()) {
+    std::list<GMJobRef> all;
+    test.index->GetAll(all);
+    std::set<JobId> ids;
+    int stable = 0;
+    for(std::list<GMJobRef>::iterator i = all.begin(); i != all.end(); ++i) {
+      if(!(*i) || !ids.insert((*i)->get_id()).second) test.Error();
+      if((*i)->get_id().find("indexstable") == 0) ++stable;
+    }
+    // Jobs which are never removed must always be seen
+    if(stable != StableNum) test.Error();
+    all.clear();
+    if(test.index->InState(JOB_STATE_INLRMS) > (unsigned int)(StableNum + TransientNum)) test.Error();
+    sched_yield();
+  }
+}
+
+void JobIndexTest::TestConcurrent() {
+  ChangerArg cargs[ChangersNum];
+  for(int n = 0; n < StableNum; ++n) {
+    GMJobRef i = NewJob("indexstable" + Arc::tostring(n), JOB_STATE_ACCEPTED, "/CN=user" + Arc::tostring(n % 3));
+    CPPUNIT_ASSERT(index->Add(i));
+    jobs.push_back(i);
+    cargs[n % ChangersNum].test = this;
+    cargs[n % ChangersNum].jobs.push_back(i);
+  }
+  // Transient jobs are kept outside of index except while churning
+  for(int n = 0; n < TransientNum; ++n) {
+    jobs.push_back(NewJob("indextransient" + Arc::tostring(n), JOB_STATE_INLRMS, "/CN=transient"));
+  }
+  changers = ChangersNum;
+  Arc::SimpleCounter count;
+  for(int n = 0; n < ChangersNum; ++n) {
+    CPPUNIT_ASSERT(Arc::CreateThreadFunction(&Change, &(cargs[n]), &count));
+  }
+  CPPUNIT_ASSERT(Arc::CreateThreadFunction(&Churn, this, &count));
+  CPPUNIT_ASSERT(Arc::CreateThreadFunction(&Read, this, &count));
+  CPPUNIT_ASSERT(Arc::CreateThreadFunction(&Read, this, &count));
+  count.wait();
+
+  CPPUNIT_ASSERT_EQUAL(0, errors);
+  CPPUNIT_ASSERT_EQUAL((unsigned int)StableNum, index->Size());
+  // Every job is indexed exactly once and according to its final state
+  unsigned int indexed = index->Pending();
+  std::map<job_state_t,unsigned int> expected;
+  unsigned int pending = 0;
+  std::map<std::string,unsigned int> active;
+  for(std::list<GMJobRef>::iterator i = jobs.begin(); i != jobs.end(); ++i) {
+    if(!index->Has((*i)->get_id())) continue;
+    if(GMJobMock::Pending(*i)) ++pending;
+    else ++(expected[(*i)->get_state()]);
+    job_state_t state = (*i)->get_state();
+    if((state >= JOB_STATE_PREPARING) && (state <= JOB_STATE_FINISHING))
+      ++(active[(*i)->GetLocalDescription()->DN]);
+  }
+  CPPUNIT_ASSERT_EQUAL(pending, index->Pending());
+  for(int state = 0; state < JOB_STATE_NUM; ++state) {
+    CPPUNIT_ASSERT_EQUAL(expected[(job_state_t)state], index->InState((job_state_t)state));
+    indexed += index->InState((job_state_t)state);
+  }
+  CPPUNIT_ASSERT_EQUAL(index->Size(), indexed);
+  std::map<std::string,unsigned int> dns;
+  index->GetDNs(dns);
+  CPPUNIT_ASSERT(dns == active);
+  CPPUNIT_ASSERT_EQUAL(0U, index->ForDN("/CN=transient"));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(JobIndexTest);
@@ -0,0 +1,287 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string>
+#include <list>
+#include <set>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <arc/FileUtils.h>
+#include <arc/StringConv.h>
+#include <arc/User.h>
+
+#include "../../conf/GMConfig.h"
+#include "../../files/ControlFileContent.h"
+#include "../../files/ControlFileHandling.h"
+#include "../GMJob.h"
+#include "../JobOwnerIndex.h"
+
+using namespace ARex;
+
+class JobOwnerIndexTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(JobOwnerIndexTest);
+  CPPUNIT_TEST(TestOwners);
+  CPPUNIT_TEST(TestFilter);
+  CPPUNIT_TEST(TestPaging);
+  CPPUNIT_TEST(TestLoad);
+  CPPUNIT_TEST(TestLoadRace);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+  void TestOwners();
+  void TestFilter();
+  void TestPaging();
+  void TestLoad();
+  void TestLoadRace();
+
+private:
+  std::string dir;
+  GMConfig* config;
+
+  void WriteJob(const JobId& id, const std::string& dn, job_state_t state);
+  static bool WaitReady(const JobOwnerIndex& index);
+  static std::string Ids(const std::list<JobOwnerIndex::Item>& items);
+};
+
+// Accepts jobs in one state only
+class StateFilter: public JobOwnerIndex::Filter {
+ public:
+  StateFilter(job_state_t state): state_(state) {};
+  virtual bool accept(const JobOwnerIndex::Item& item) const { return item.state == state_; };
+ private:
+  job_state_t state_;
+};
+
+void JobOwnerIndexTest::setUp() {
+  CPPUNIT_ASSERT(Arc::TmpDirCreate(dir));
+  const char* subdirs[] = { subdir_new, subdir_cur, subdir_old, subdir_rew };
+  for(unsigned int n = 0; n < sizeof(subdirs)/sizeof(subdirs[0]); ++n) {
+    CPPUNIT_ASSERT(Arc::DirCreate(dir + "/" + subdirs[n], S_IRWXU, false));
+  }
+  config = new GMConfig();
+  config->SetControlDir(dir);
+}
+
+void JobOwnerIndexTest::tearDown() {
+  delete config;
+  Arc::DirDelete(dir, true);
+}
+
+void JobOwnerIndexTest::WriteJob(const JobId& id, const std::string& dn, job_state_t state) {
+  GMJob job(id, Arc::User());
+  JobLocalDescription local;
+  local.DN = dn;
+  CPPUNIT_ASSERT(job_local_write_file(job, *config, local));
+  CPPUNIT_ASSERT(job_state_write_file(job, *config, state, false));
+}
+
+bool JobOwnerIndexTest::WaitReady(const JobOwnerIndex& index) {
+  for(int n = 0; n < 100; ++n) {
+    if(index.Ready()) return true;
+    ::usleep(50000);
+  }
+  return false;
+}
+
+std::string JobOwnerIndexTest::Ids(const std::list<JobOwnerIndex::Item>& items) {
+  std::string ids;
+  for(std::list<JobOwnerIndex::Item>::const_iterator item = items.begin(); item != items.end(); ++item) {
+    if(!ids.empty()) ids += ",";
+    ids += item->id;
+  }
+  return ids;
+}
+
+void JobOwnerIndexTest::TestOwners() {
+  JobOwnerIndex index;
+  index.Add("job3", "/CN=user1", JOB_STATE_INLRMS, false, false);
+  index.Add("job1", "/CN=user1", JOB_STATE_ACCEPTED, false, false);
+  index.Add("job2", "/CN=user2", JOB_STATE_FINISHED, false, true);
+  CPPUNIT_ASSERT_EQUAL(3U, index.Size());
+
+  // Only jobs of requested owner ordered by identifier
+  std::list<JobOwnerIndex::Item> items;
+  CPPUNIT_ASSERT(!index.List("/CN=user1", "", 10, NULL, items));
+  CPPUNIT_ASSERT_EQUAL(std::string("job1,job3"), Ids(items));
+  items.clear();
+  index.List("/CN=user2", "", 10, NULL, items);
+  CPPUNIT_ASSERT_EQUAL(std::string("job2"), Ids(items));
+  CPPUNIT_ASSERT(items.front().failed);
+  CPPUNIT_ASSERT_EQUAL(JOB_STATE_FINISHED, items.front().state);
+  items.clear();
+  index.List("/CN=user3", "", 10, NULL, items);
+  CPPUNIT_ASSERT(items.empty());
+
+  // Job added again with other owner moves to that owner
+  index.Add("job3", "/CN=user2", JOB_STATE_INLRMS, false, false);
+  CPPUNIT_ASSERT_EQUAL(3U, index.Size());
+  index.List("/CN=user1", "", 10, NULL, items);
+  CPPUNIT_ASSERT_EQUAL(std::string("job1"), Ids(items));
+  items.clear();
+  index.List("/CN=user2", "", 10, NULL, items);
+  CPPUNIT_ASSERT_EQUAL(std::string("job2,job3"), Ids(items));
+  items.clear();
+
+  // State and failure updates
+  index.State("job1", JOB_STATE_PREPARING, true);
+  index.Failed("job1", true);
+  index.State("job4", JOB_STATE_PREPARING, false);
+  index.List("/CN=user1", "", 10, NULL, items);
+  CPPUNIT_ASSERT_EQUAL(JOB_STATE_PREPARING, items.front().state);
+  CPPUNIT_ASSERT(items.front().pending);
+  CPPUNIT_ASSERT(items.front().failed);
+  CPPUNIT_ASSERT(!items.front().killed);
+  items.clear();
+  index.Failed("job1", true, true);
+  index.List("/CN=user1", "", 10, NULL, items);
+  CPPUNIT_ASSERT(items.front().killed);
+  items.clear();
+  CPPUNIT_ASSERT_EQUAL(3U, index.Size());
+
+  index.Remove("job1");
+  index.List("/CN=user1", "", 10, NULL, items);
+  CPPUNIT_ASSERT(items.empty());
+  CPPUNIT_ASSERT_EQUAL(2U, index.Size());
+}
+
+void JobOwnerIndexTest::TestFilter() {
+  JobOwnerIndex index;
+  for(int n = 0; n < 6; ++n) {
+    index.Add("job" + Arc::tostring(n), "/CN=user1",
+              (n % 2) ? JOB_STATE_FINISHED : JOB_STATE_INLRMS, false, false);
+  }
+  StateFilter filter(JOB_STATE_FINISHED);
+  std::list<JobOwnerIndex::Item> items;
+  // Limit counts accepted jobs only
+  CPPUNIT_ASSERT(index.List("/CN=user1", "", 2, &filter, items));
+  CPPUNIT_ASSERT_EQUAL(std::string("job1,job3"), Ids(items));
+  items.clear();
+  CPPUNIT_ASSERT(!index.List("/CN=user1", "job3", 2, &filter, items));
+  CPPUNIT_ASSERT_EQUAL(std::string("job5"), Ids(items));
+  items.clear();
+  // Nothing more accepted after last page
+  CPPUNIT_ASSERT(!index.List("/CN=user1", "job1", 2, &filter, items));
+  CPPUNIT_ASSERT_EQUAL(std::string("job3,job5"), Ids(items));
+}
+
+// Pages are taken the way REST interface does - next page starts after
+// last identifier of previous one.
+void JobOwnerIndexTest::TestPaging() {
+  JobOwnerIndex index;
+  for(int n = 10; n < 20; ++n) {
+    index.Add("job" + Arc::tostring(n), "/CN=user1", JOB_STATE_INLRMS, false, false);
+  }
+  std::list<JobOwnerIndex::Item> items;
+  std::set<JobId> seen;
+  CPPUNIT_ASSERT(index.List("/CN=user1", "", 3, NULL, items));
+  CPPUNIT_ASSERT_EQUAL(std::string("job10,job11,job12"), Ids(items));
+  std::string after = items.back().id;
+  items.clear();
+
+  // Job at cursor and one ahead are removed, jobs are added before and after cursor
+  index.Remove("job12");
+  index.Remove("job14");
+  index.Add("job105", "/CN=user1", JOB_STATE_ACCEPTED, false, false);
+  index.Add("job125", "/CN=user1", JOB_STATE_ACCEPTED, false, false);
+  index.Add("job30", "/CN=user2", JOB_STATE_ACCEPTED, false, false);
+
+  CPPUNIT_ASSERT(index.List("/CN=user1", after, 3, NULL, items));
+  CPPUNIT_ASSERT_EQUAL(std::string("job125,job13,job15"), Ids(items));
+  after = items.back().id;
+  items.clear();
+  index.Add("job99", "/CN=user1", JOB_STATE_ACCEPTED, false, false);
+  CPPUNIT_ASSERT(index.List("/CN=user1", after, 3, NULL, items));
+  CPPUNIT_ASSERT_EQUAL(std::string("job16,job17,job18"), Ids(items));
+  after = items.back().id;
+  items.clear();
+  // Last page
+  CPPUNIT_ASSERT(!index.List("/CN=user1", after, 3, NULL, items));
+  CPPUNIT_ASSERT_EQUAL(std::string("job19,job99"), Ids(items));
+  items.clear();
+  // Cursor after everything
+  CPPUNIT_ASSERT(!index.List("/CN=user1", "job999", 3, NULL, items));
+  CPPUNIT_ASSERT(items.empty());
+}
+
+void JobOwnerIndexTest::TestLoad() {
+  WriteJob("job1", "/CN=user1", JOB_STATE_INLRMS);
+  WriteJob("job2", "/CN=user1", JOB_STATE_FINISHED);
+  WriteJob("job3", "/CN=user2", JOB_STATE_FINISHED);
+  GMJob job2("job2", Arc::User());
+  CPPUNIT_ASSERT(job_failed_mark_put(job2, *config, "failure"));
+  GMJob job3("job3", Arc::User());
+  CPPUNIT_ASSERT(job_failed_mark_put(job3, *config, "Job is canceled by external request"));
+
+  JobOwnerIndex index;
+  CPPUNIT_ASSERT(!index.Ready());
+  CPPUNIT_ASSERT(index.Load(*config));
+  CPPUNIT_ASSERT(!index.Load(*config));
+  CPPUNIT_ASSERT(WaitReady(index));
+  CPPUNIT_ASSERT_EQUAL(3U, index.Size());
+  std::list<JobOwnerIndex::Item> items;
+  index.List("/CN=user1", "", 10, NULL, items);
+  CPPUNIT_ASSERT_EQUAL(std::string("job1,job2"), Ids(items));
+  CPPUNIT_ASSERT_EQUAL(JOB_STATE_INLRMS, items.front().state);
+  CPPUNIT_ASSERT(!items.front().failed);
+  CPPUNIT_ASSERT_EQUAL(JOB_STATE_FINISHED, items.back().state);
+  CPPUNIT_ASSERT(items.back().failed);
+  CPPUNIT_ASSERT(!items.back().killed);
+  items.clear();
+  index.List("/CN=user2", "", 10, NULL, items);
+  CPPUNIT_ASSERT_EQUAL(std::string("job3"), Ids(items));
+  CPPUNIT_ASSERT(items.front().killed);
+}
+
+// Changes reported while control directory is scanned must not be
+// overwritten by information scanner read earlier.
+void JobOwnerIndexTest::TestLoadRace() {
+  for(int n = 0; n < 20; ++n) {
+    WriteJob("job" + Arc::tostring(n), "/CN=user1", JOB_STATE_INLRMS);
+  }
+  JobOwnerIndex index;
+  CPPUNIT_ASSERT(index.Load(*config));
+  // Scanner may be anywhere now. Control files are intentionally left
+  // unchanged to detect if they override reported changes.
+  for(int n = 0; n < 20; n += 4) {
+    index.State("job" + Arc::tostring(n), JOB_STATE_FINISHED, false);
+    index.Failed("job" + Arc::tostring(n+1), true);
+    index.Remove("job" + Arc::tostring(n+2));
+    index.Add("job" + Arc::tostring(n+3), "/CN=user2", JOB_STATE_FINISHING, true, false);
+  }
+  CPPUNIT_ASSERT(WaitReady(index));
+  CPPUNIT_ASSERT_EQUAL(15U, index.Size());
+
+  std::list<JobOwnerIndex::Item> items;
+  index.List("/CN=user1", "", 100, NULL, items);
+  CPPUNIT_ASSERT_EQUAL(10, (int)items.size());
+  for(std::list<JobOwnerIndex::Item>::iterator item = items.begin(); item != items.end(); ++item) {
+    int n = 0;
+    CPPUNIT_ASSERT(Arc::stringto(item->id.substr(3), n));
+    if((n % 4) == 0) {
+      CPPUNIT_ASSERT_EQUAL(JOB_STATE_FINISHED, item->state);
+      CPPUNIT_ASSERT(!item->failed);
+    } else {
+      CPPUNIT_ASSERT_EQUAL(1, n % 4);
+      CPPUNIT_ASSERT_EQUAL(JOB_STATE_INLRMS, item->state);
+      CPPUNIT_ASSERT(item->failed);
+    }
+  }
+  items.clear();
+  index.List("/CN=user2", "", 100, NULL, items);
+  CPPUNIT_ASSERT_EQUAL(5, (int)items.size());
+  for(std::list<JobOwnerIndex::Item>::iterator item = items.begin(); item != items.end(); ++item) {
+    CPPUNIT_ASSERT_EQUAL(JOB_STATE_FINISHING, item->state);
+    CPPUNIT_ASSERT(item->pending);
+  }
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(JobOwnerIndexTest);
@@ -0,0 +1,279 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string>
+#include <list>
+#include <set>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <sched.h>
+
+#include <arc/StringConv.h>
+#include <arc/Thread.h>
+#include <arc/User.h>
+
+#include "../../files/ControlFileContent.h"
+#include "../GMJob.h"
+#include "../JobIndex.h"
+#include "../JobWorkers.h"
+
+namespace ARex {
+
+// Gives test access to job internals normally changed by JobsList
+class GMJobMock {
+ public:
+  static void SetState(GMJobRef& i, job_state_t state) { i->job_state = state; }
+  static void SetDN(GMJobRef& i, const std::string& dn) {
+    if(!i->local) i->local = new JobLocalDescription;
+    i->local->DN = dn;
+  }
+};
+
+} // namespace ARex
+
+using namespace ARex;
+
+class JobWorkersTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(JobWorkersTest);
+  CPPUNIT_TEST(TestDeferral);
+  CPPUNIT_TEST(TestDropped);
+  CPPUNIT_TEST(TestReservations);
+  CPPUNIT_TEST(TestConcurrentProcessing);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  JobWorkersTest(): queue(0, "test") {}
+  void setUp();
+  void tearDown();
+  void TestDeferral();
+  void TestDropped();
+  void TestReservations();
+  void TestConcurrentProcessing();
+
+private:
+  static const int JobsNum = 60;
+  static const int WorkersNum = 4;
+  static const int RunningLimit = 3;
+  static const int PerDNLimit = 2;
+
+  GMJobQueue queue;
+  JobIndex* index;
+  JobWorkers* workers;
+
+  Glib::Mutex lock;
+  std::set<JobId> active;
+  int overlaps;
+  int exceeded;
+  int finished;
+
+  GMJobRef AddJob(const JobId& id, const std::string& dn);
+  void Process(GMJobRef& i);
+  static void Work(void* arg, GMJobRef& i);
+};
+
+void JobWorkersTest::setUp() {
+  index = new JobIndex;
+  workers = new JobWorkers(queue, *index);
+  overlaps = 0;
+  exceeded = 0;
+  finished = 0;
+}
+
+void JobWorkersTest::tearDown() {
+  delete workers;
+  std::list<GMJobRef> jobs;
+  index->GetAll(jobs);
+  for(std::list<GMJobRef>::iterator i = jobs.begin(); i != jobs.end(); ++i) {
+    queue.Erase(*i);
+    index->Remove(*i);
+  }
+  for(std::list<GMJobRef>::iterator i = jobs.begin(); i != jobs.end(); ++i) i->Destroy();
+  delete index;
+}
+
+GMJobRef JobWorkersTest::AddJob(const JobId& id, const std::string& dn) {
+  GMJobRef i(new GMJob(id, Arc::User(), "", JOB_STATE_ACCEPTED));
+  GMJobMock::SetDN(i, dn);
+  index->Add(i);
+  return i;
+}
+
+void JobWorkersTest::TestDeferral() {
+  GMJobRef i = AddJob("workerstest1", "/CN=user1");
+  CPPUNIT_ASSERT(workers->Start(i));
+  CPPUNIT_ASSERT_EQUAL(1U, workers->Processing());
+  // Request for same job coming while job is processed is postponed
+  CPPUNIT_ASSERT(!workers->Start(i));
+  CPPUNIT_ASSERT_EQUAL(1U, workers->Deferred());
+  CPPUNIT_ASSERT(queue.IsEmpty());
+  // and returned to queue when processing ends
+  workers->End(i->get_id());
+  CPPUNIT_ASSERT_EQUAL(0U, workers->Processing());
+  CPPUNIT_ASSERT_EQUAL(0U, workers->Deferred());
+  CPPUNIT_ASSERT(queue.Exists(i));
+  GMJobRef next = queue.Pop();
+  CPPUNIT_ASSERT(next == i);
+  CPPUNIT_ASSERT(workers->Start(next));
+  workers->End(next->get_id());
+  CPPUNIT_ASSERT(queue.IsEmpty());
+}
+
+void JobWorkersTest::TestDropped() {
+  GMJobRef i = AddJob("workerstest1", "/CN=user1");
+  CPPUNIT_ASSERT(workers->Start(i));
+  CPPUNIT_ASSERT(!workers->Start(i));
+  CPPUNIT_ASSERT(!workers->Start(i));
+  CPPUNIT_ASSERT_EQUAL(2U, workers->Deferred());
+  // Requests for job dropped while being processed are discarded
+  workers->End(i->get_id(), true);
+  CPPUNIT_ASSERT_EQUAL(0U, workers->Processing());
+  CPPUNIT_ASSERT_EQUAL(0U, workers->Deferred());
+  CPPUNIT_ASSERT(queue.IsEmpty());
+}
+
+void JobWorkersTest::TestReservations() {
+  GMJobRef i1 = AddJob("workerstest1", "/CN=user1");
+  GMJobRef i2 = AddJob("workerstest2", "/CN=user1");
+
+  // Reserved places count towards limit
+  CPPUNIT_ASSERT(!workers->RunningLimitReached(1));
+  {
+    JobWorkers::Reservation place(*workers, 1);
+    CPPUNIT_ASSERT(place);
+    CPPUNIT_ASSERT(workers->RunningLimitReached(1));
+    JobWorkers::Reservation over(*workers, 1);
+    CPPUNIT_ASSERT(!over);
+    JobWorkers::Reservation unlimited(*workers, -1);
+    CPPUNIT_ASSERT(unlimited);
+    CPPUNIT_ASSERT_EQUAL(2U, workers->Reserved());
+  }
+  // Place is released if job did not change state
+  CPPUNIT_ASSERT_EQUAL(0U, workers->Reserved());
+  {
+    JobWorkers::Reservation place(*workers, 1);
+    CPPUNIT_ASSERT(place);
+    // Job counted in index takes place of reservation
+    GMJobMock::SetState(i1, JOB_STATE_SUBMITTING);
+    place.Commit(i1);
+    CPPUNIT_ASSERT(!place);
+    CPPUNIT_ASSERT_EQUAL(0U, workers->Reserved());
+  }
+  CPPUNIT_ASSERT_EQUAL(0U, workers->Reserved());
+  CPPUNIT_ASSERT(workers->RunningLimitReached(1));
+  {
+    JobWorkers::Reservation over(*workers, 1);
+    CPPUNIT_ASSERT(!over);
+    JobWorkers::Reservation place(*workers, 2);
+    CPPUNIT_ASSERT(place);
+  }
+  CPPUNIT_ASSERT_EQUAL(0U, workers->Reserved());
+
+  // Same for jobs of one DN
+  CPPUNIT_ASSERT_EQUAL(1U, index->ForDN("/CN=user1"));
+  {
+    JobWorkers::Reservation place1(*workers, "/CN=user1", 2);
+    CPPUNIT_ASSERT(place1);
+    JobWorkers::Reservation over(*workers, "/CN=user1", 2);
+    CPPUNIT_ASSERT(!over);
+    JobWorkers::Reservation place2(*workers, "/CN=user2", 2);
+    CPPUNIT_ASSERT(place2);
+    CPPUNIT_ASSERT_EQUAL(2U, workers->Reserved());
+    GMJobMock::SetState(i2, JOB_STATE_PREPARING);
+    place1.Commit(i2);
+    CPPUNIT_ASSERT_EQUAL(1U, workers->Reserved());
+  }
+  CPPUNIT_ASSERT_EQUAL(2U, index->ForDN("/CN=user1"));
+  CPPUNIT_ASSERT_EQUAL(0U, workers->Reserved());
+  JobWorkers::Reservation over(*workers, "/CN=user1", 2);
+  CPPUNIT_ASSERT(!over);
+}
+
+// Moves job through ACCEPTED -> PREPARING -> SUBMITTING -> FINISHED the
+// way JobsList does, requesting reprocessing after every step.
+void JobWorkersTest::Process(GMJobRef& i) {
+  std::string dn = i->GetLocalDescription()->DN;
+  switch(i->get_state()) {
+    case JOB_STATE_ACCEPTED: {
+      JobWorkers::Reservation place(*workers, dn, PerDNLimit);
+      if(!place) break;
+      sched_yield();
+      GMJobMock::SetState(i, JOB_STATE_PREPARING);
+      place.Commit(i);
+      if(index->ForDN(dn) > (unsigned int)PerDNLimit) {
+        Glib::Mutex::Lock l(lock);
+        ++exceeded;
+      }
+    }; break;
+    case JOB_STATE_PREPARING: {
+      JobWorkers::Reservation place(*workers, RunningLimit);
+      if(!place) break;
+      sched_yield();
+      GMJobMock::SetState(i, JOB_STATE_SUBMITTING);
+      place.Commit(i);
+      if((index->InState(JOB_STATE_SUBMITTING) + index->InState(JOB_STATE_INLRMS)) >
+         (unsigned int)RunningLimit) {
+        Glib::Mutex::Lock l(lock);
+        ++exceeded;
+      }
+    }; break;
+    case JOB_STATE_SUBMITTING: {
+      GMJobMock::SetState(i, JOB_STATE_FINISHED);
+      index->StateChanged(i);
+      Glib::Mutex::Lock l(lock);
+      ++finished;
+    }; return;
+    default:
+      return;
+  }
+  // Request comes while job is still marked as processed
+  queue.Push(i);
+  sched_yield();
+}
+
+void JobWorkersTest::Work(void* arg, GMJobRef& i) {
+  JobWorkersTest& test = *reinterpret_cast<JobWorkersTest*>(arg);
+  JobId id = i->get_id();
+  {
+    Glib::Mutex::Lock l(test.lock);
+    if(!test.active.insert(id).second) ++test.overlaps;
+  }
+  test.Process(i);
+  Glib::Mutex::Lock l(test.lock);
+  test.active.erase(id);
+}
+
+void JobWorkersTest::TestConcurrentProcessing() {
+  for(int n = 0; n < JobsNum; ++n) {
+    GMJobRef i = AddJob("workerstest" + Arc::tostring(n), "/CN=user" + Arc::tostring(n % 3));
+    queue.Push(i);
+  }
+  CPPUNIT_ASSERT(workers->Run(WorkersNum, &Work, this));
+  // Workers are started only once
+  CPPUNIT_ASSERT(!workers->Run(WorkersNum, &Work, this));
+  CPPUNIT_ASSERT(workers->Process());
+
+  CPPUNIT_ASSERT_EQUAL(0, overlaps);
+  CPPUNIT_ASSERT_EQUAL(0, exceeded);
+  CPPUNIT_ASSERT_EQUAL((int)JobsNum, finished);
+  CPPUNIT_ASSERT_EQUAL((unsigned int)JobsNum, index->InState(JOB_STATE_FINISHED));
+  CPPUNIT_ASSERT(queue.IsEmpty());
+  CPPUNIT_ASSERT_EQUAL(0U, workers->Processing());
+  CPPUNIT_ASSERT_EQUAL(0U, workers->Deferred());
+  CPPUNIT_ASSERT_EQUAL(0U, workers->Reserved());
+  CPPUNIT_ASSERT_EQUAL(0U, index->ForDN("/CN=user0"));
+
+  // Same idle workers pick up jobs queued later
+  GMJobRef i = AddJob("workerstestlate", "/CN=user0");
+  queue.Push(i);
+  CPPUNIT_ASSERT(workers->Process());
+  CPPUNIT_ASSERT_EQUAL((int)JobsNum + 1, finished);
+  CPPUNIT_ASSERT_EQUAL((unsigned int)JobsNum + 1, index->InState(JOB_STATE_FINISHED));
+  workers->Stop();
+  CPPUNIT_ASSERT(!workers->Process());
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(JobWorkersTest);
@@ -0,0 +1,136 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <list>
+
+#include <arc/Logger.h>
+#include <arc/Run.h>
+
+#include "GMetricSender.h"
+
+namespace ARex {
+
+static Arc::Logger& logger = Arc::Logger::getRootLogger();
+
+// Maximal time to wait for single gmetric call
+#define GMETRIC_TIMEOUT (60)
+
+GMetricSender::GMetricSender(const std::string& group):
+    group_(group),period_(GMETRIC_DEFAULT_PERIOD),last_flush_(0),sending_(false),failed_(false) {
+}
+
+GMetricSender::~GMetricSender(void) {
+  threads_.wait();
+}
+
+void GMetricSender::SetConfig(const std::string& fname) {
+  Glib::Mutex::Lock lock(lock_);
+  config_filename_ = fname;
+}
+
+void GMetricSender::SetGmetricPath(const std::string& path) {
+  Glib::Mutex::Lock lock(lock_);
+  tool_path_ = path;
+}
+
+void GMetricSender::SetPeriod(int period) {
+  Glib::Mutex::Lock lock(lock_);
+  period_ = period;
+}
+
+void GMetricSender::Report(const std::string& name, const std::string& value, const std::string& unit_type, const std::string& unit) {
+  Glib::Mutex::Lock lock(lock_);
+  Value& v = queued_[name];
+  v.value = value;
+  v.unit_type = unit_type;
+  v.unit = unit;
+}
+
+void GMetricSender::Flush(void) {
+  Glib::Mutex::Lock lock(lock_);
+  if(sending_) return;
+  if(queued_.empty()) return;
+  time_t now = time(NULL);
+  // After failure wait longer to avoid storm of failing calls
+  int period = failed_ ? (period_ > 60 ? period_ : 60) : period_;
+  if((now >= last_flush_) && (((int)(now - last_flush_)) < period)) return;
+  if(tool_path_.empty()) {
+    logger.msg(Arc::ERROR,"gmetric_bin_path empty in arc.conf (should never happen the default value should be used)");
+    queued_.clear();
+    return;
+  };
+  last_flush_ = now;
+  sending_batch_.swap(queued_);
+  queued_.clear();
+  sending_ = true;
+  if(!Arc::CreateThreadFunction(&SendBatch, this, &threads_)) {
+    // Put values back for next attempt
+    for(std::map<std::string,Value>::iterator v = sending_batch_.begin(); v != sending_batch_.end(); ++v) {
+      if(queued_.find(v->first) == queued_.end()) queued_[v->first] = v->second;
+    };
+    sending_batch_.clear();
+    sending_ = false;
+  };
+}
+
+void GMetricSender::SendBatch(void* arg) {
+  GMetricSender& it = *reinterpret_cast<GMetricSender*>(arg);
+  // Batch is not touched by other threads while sending_ is set
+  std::map<std::string,Value>::iterator v = it.sending_batch_.begin();
+  for(; v != it.sending_batch_.end(); ++v) {
+    if(!it.Send(v->first, v->second)) break;
+  };
+  bool failed = (v != it.sending_batch_.end());
+  Glib::Mutex::Lock lock(it.lock_);
+  // Values not sent will be reported in next batch unless updated meanwhile
+  for(; v != it.sending_batch_.end(); ++v) {
+    if(it.queued_.find(v->first) == it.queued_.end()) it.queued_[v->first] = v->second;
+  };
+  it.sending_batch_.clear();
+  it.failed_ = failed;
+  it.sending_ = false;
+}
+
+bool GMetricSender::Send(const std::string& name, const Value& value) {
+  std::list<std::string> cmd;
+  {
+    Glib::Mutex::Lock lock(lock_);
+    cmd.push_back(tool_path_);
+    if(!config_filename_.empty()) {
+      cmd.push_back("-c");
+      cmd.push_back(config_filename_);
+    };
+  };
+  cmd.push_back("-n");
+  cmd.push_back(name);
+  cmd.push_back("-g");
+  cmd.push_back(group_);
+  cmd.push_back("-v");
+  cmd.push_back(value.value);
+  cmd.push_back("-t");//unit-type
+  cmd.push_back(value.unit_type);
+  cmd.push_back("-u");//unit
+  cmd.push_back(value.unit);
+
+  std::string proc_stderr;
+  Arc::Run proc(cmd);
+  proc.AssignStderr(proc_stderr);
+  if(!(proc.Start())) {
+    logger.msg(Arc::ERROR,"Failed to start metrics tool %s",cmd.front());
+    return false;
+  };
+  if(!(proc.Wait(GMETRIC_TIMEOUT))) {
+    logger.msg(Arc::ERROR,"Metrics tool %s timed out",cmd.front());
+    proc.Kill(1);
+    return false;
+  };
+  int run_result = proc.Result();
+  if(run_result != 0) {
+    logger.msg(Arc::ERROR,": Metrics tool returned error code %i: %s",run_result,proc_stderr);
+    return false;
+  };
+  return true;
+}
+
+} // namespace ARex
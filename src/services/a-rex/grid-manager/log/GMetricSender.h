@@ -0,0 +1,66 @@
+/* batched reporting of metrics through gmetric tool */
+#ifndef __GM_GMETRIC_SENDER_H__
+#define __GM_GMETRIC_SENDER_H__
+
+#include <string>
+#include <map>
+#include <ctime>
+
+#include <arc/Thread.h>
+
+// Default interval between information gathering cycles (arc.conf frequency)
+#define GMETRIC_DEFAULT_PERIOD (60)
+
+namespace ARex {
+
+/// Collects values to be reported to Ganglia and sends them in batches.
+/** Values are queued in memory and only latest value of every metric is
+   kept. Once per period all queued values are passed to gmetric tool
+   from a separate thread, so callers never wait for external processes. */
+class GMetricSender {
+ friend class GMetricSenderTest;
+ public:
+  GMetricSender(const std::string& group);
+  ~GMetricSender(void);
+
+  /* Set path of configuration file */
+  void SetConfig(const std::string& fname);
+
+  /* Set path/name of gmetric  */
+  void SetGmetricPath(const std::string& path);
+
+  /* Set minimal interval between batches */
+  void SetPeriod(int period);
+
+  /// Queue value for reporting. Replaces value queued earlier under same name.
+  void Report(const std::string& name, const std::string& value, const std::string& unit_type, const std::string& unit);
+
+  /// Start sending of queued values if period passed and previous batch is done.
+  void Flush(void);
+
+ private:
+  class Value {
+   public:
+    std::string value;
+    std::string unit_type;
+    std::string unit;
+  };
+  Glib::Mutex lock_;
+  std::string group_;
+  std::string config_filename_;
+  std::string tool_path_;
+  int period_;
+  time_t last_flush_;
+  bool sending_;
+  bool failed_;
+  std::map<std::string,Value> queued_;
+  std::map<std::string,Value> sending_batch_;
+  Arc::SimpleCounter threads_;
+
+  static void SendBatch(void* arg);
+  bool Send(const std::string& name, const Value& value);
+};
+
+} // namespace ARex
+
+#endif
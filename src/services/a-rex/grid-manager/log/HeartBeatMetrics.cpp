@@ -20,13 +20,16 @@ namespace ARex {
 
 static Arc::Logger& logger = Arc::Logger::getRootLogger();
 
-HeartBeatMetrics::HeartBeatMetrics():enabled(false),proc(NULL) {
+HeartBeatMetrics::HeartBeatMetrics(MetricsRegistry& registry_):enabled(false),registry(registry_),gmetric("arc_system") {
   free = 0;
   totalfree = 0;
 
   time_delta = 0;
 
   time_update = false;
+
+  registry.Describe("arex_heartbeat_age_seconds", MetricsRegistry::Gauge,
+                    "Time since last update of A-REX heartbeat file");
 }
 
 HeartBeatMetrics::~HeartBeatMetrics() {
@@ -37,11 +40,15 @@ void HeartBeatMetrics::SetEnabled(bool val) {
 }
 
 void HeartBeatMetrics::SetConfig(const char* fname) {
-  config_filename = fname;
+  gmetric.SetConfig(fname);
 }
   
 void HeartBeatMetrics::SetGmetricPath(const char* path) {
-  tool_path = path;
+  gmetric.SetGmetricPath(path);
+}
+
+void HeartBeatMetrics::SetPeriod(int period) {
+  gmetric.SetPeriod(period);
 }
 
 
@@ -56,6 +63,7 @@ void HeartBeatMetrics::ReportHeartBeatChange(const GMConfig& config) {
     time_t time_now = time(NULL);
     time_delta = time_now - time_lastupdate;
     time_update = true;
+    registry.Set("arex_heartbeat_age_seconds", "", time_delta);
   }
   else{
     logger.msg(Arc::ERROR,"Error with hearbeatfile: %s",heartbeat_file.c_str());
@@ -65,95 +73,18 @@ void HeartBeatMetrics::ReportHeartBeatChange(const GMConfig& config) {
   Sync();
 }
 
-bool HeartBeatMetrics::CheckRunMetrics(void) {
-  if(!proc) return true;
-  if(proc->Running()) return false;
-  int run_result = proc->Result();
-  if(run_result != 0) {
-   logger.msg(Arc::ERROR,": Metrics tool returned error code %i: %s",run_result,proc_stderr);
-  };
-  delete proc;
-  proc = NULL;
-  return true;
-}
-
 void HeartBeatMetrics::Sync(void) {
   if(!enabled) return; // not configured
   Glib::RecMutex::Lock lock_(lock);
-  if(!CheckRunMetrics()) return;
-  // Run gmetric to report one change at a time
-  //since only one process can be started from Sync(), only 1 histogram can be sent at a time, therefore return for each call;
-  //Sync is therefore called multiple times until there are not more histograms that have changed
-
+  // Queue changed values and let sender pass them to gmetric in one batch
 
   if(time_update){
-    if(RunMetrics(
-		  std::string("AREX-HEARTBEAT_LAST_SEEN"),
-		  Arc::tostring(time_delta), "int32", "sec"
-		  )) {
-      time_update = false;
-      return;
-    };
+    gmetric.Report(std::string("AREX-HEARTBEAT_LAST_SEEN"),
+                   Arc::tostring(time_delta), "int32", "sec");
+    time_update = false;
   }
 
-
-}
-
- 
-bool HeartBeatMetrics::RunMetrics(const std::string name, const std::string& value, const std::string unit_type, const std::string unit) {
-  if(proc) return false;
-  std::list<std::string> cmd;
-  if(tool_path.empty()) {
-    logger.msg(Arc::ERROR,"gmetric_bin_path empty in arc.conf (should never happen the default value should be used)");
-    return false;
-  } else {
-    cmd.push_back(tool_path);
-  };
-  if(!config_filename.empty()) {
-    cmd.push_back("-c");
-    cmd.push_back(config_filename);
-  };
-  cmd.push_back("-n");
-  cmd.push_back(name);
-  cmd.push_back("-g");
-  cmd.push_back("arc_system");
-  cmd.push_back("-v");
-  cmd.push_back(value);
-  cmd.push_back("-t");//unit-type
-  cmd.push_back(unit_type);
-  cmd.push_back("-u");//unit
-  cmd.push_back(unit);
-  
-  proc = new Arc::Run(cmd);
-  proc->AssignStderr(proc_stderr);
-  proc->AssignKicker(&RunMetricsKicker, this);
-  if(!(proc->Start())) {
-    delete proc;
-    proc = NULL;
-    return false;
-  };
-  return true;
-}
-
-void HeartBeatMetrics::SyncAsync(void* arg) {
-  if(arg) {
-    HeartBeatMetrics& it = *reinterpret_cast<HeartBeatMetrics*>(arg);
-    Glib::RecMutex::Lock lock_(it.lock);
-    if(it.proc) {
-      // Continue only if no failure in previous call.
-      // Otherwise it can cause storm of failed calls.
-      if(it.proc->Result() == 0) {
-        it.Sync();
-      };
-    };
-  };
-}
-
-void HeartBeatMetrics::RunMetricsKicker(void* arg) {
-  // Currently it is not allowed to start new external process
-  // from inside process kicker (todo: redesign).
-  // So do it asynchronously from another thread.
-  Arc::CreateThreadFunction(&SyncAsync, arg);
+  gmetric.Flush();
 }
 
 } // namespace ARex
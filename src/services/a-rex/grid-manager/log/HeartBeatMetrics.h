@@ -7,11 +7,9 @@
 #include <fstream>
 #include <ctime>
 
-#include <arc/Run.h>
-
 #include "../jobs/GMJob.h"
-
-#define GMETRIC_STATERATE_UPDATE_INTERVAL 5//to-fix this value could be set in arc.conf to be tailored to site
+#include "MetricsRegistry.h"
+#include "GMetricSender.h"
 
 
 namespace ARex {
@@ -20,8 +18,8 @@ class HeartBeatMetrics {
  private:
   Glib::RecMutex lock;
   bool enabled;
-  std::string config_filename;
-  std::string tool_path;
+  MetricsRegistry& registry;
+  GMetricSender gmetric;
 
   time_t time_delta;
 
@@ -30,17 +28,9 @@ class HeartBeatMetrics {
   double totalfree;
 
   bool time_update;
-  
-  Arc::Run *proc;
-  std::string proc_stderr;
-
-  bool RunMetrics(const std::string name, const std::string& value, const std::string unit_type, const std::string unit);
-  bool CheckRunMetrics(void);
-  static void RunMetricsKicker(void* arg);
-  static void SyncAsync(void* arg);
 
  public:
-  HeartBeatMetrics(void);
+  HeartBeatMetrics(MetricsRegistry& registry);
   ~HeartBeatMetrics(void);
 
   void SetEnabled(bool val);
@@ -51,6 +41,9 @@ class HeartBeatMetrics {
   /* Set path/name of gmetric  */
   void SetGmetricPath(const char* path);
 
+  /* Set minimal interval between reports */
+  void SetPeriod(int period);
+
   void ReportHeartBeatChange(const GMConfig& config);
   void Sync(void);
 
@@ -12,8 +12,6 @@
 
 namespace ARex {
 
-static Arc::Logger& logger = Arc::Logger::getRootLogger();
-
 JobStateList::JobStateList(int _limit):limit(_limit){
   failures = 0;
 }
@@ -69,19 +67,33 @@ void JobStateList::SetFailure(bool _isfailed,std::string _job_id){
 
 
 
-JobsMetrics::JobsMetrics():enabled(false),proc(NULL),jobstatelist(100) {
+// Upper bounds of buckets for time spent by job in one state
+static const double state_duration_buckets[] = {
+  1, 10, 60, 300, 900, 3600, 3*3600, 12*3600, 24*3600, 3*24*3600
+};
+
+JobsMetrics::JobsMetrics(MetricsRegistry& registry_):enabled(false),registry(registry_),gmetric("arc_jobs"),jobstatelist(100) {
   job_fail_counter = 0;
   std::memset(jobs_in_state, 0, sizeof(jobs_in_state));
   std::memset(jobs_in_state_changed, 0, sizeof(jobs_in_state_changed));
-  std::memset(jobs_state_old_new, 0, sizeof(jobs_state_old_new));
-  std::memset(jobs_state_old_new_changed, 0, sizeof(jobs_state_old_new_changed));
-  std::memset(jobs_rate, 0, sizeof(jobs_rate));
-  std::memset(jobs_rate_changed, 0, sizeof(jobs_rate_changed));
 
   fail_changed = false;
 
-  time_lastupdate = time(NULL);
-
+  registry.Describe("arex_jobs_in_state", MetricsRegistry::Gauge,
+                    "Number of jobs in A-REX internal states");
+  registry.Describe("arex_jobs_failed_per_100", MetricsRegistry::Gauge,
+                    "Number of failed jobs among last 100 finished jobs");
+  registry.Describe("arex_job_state_transitions_total", MetricsRegistry::Counter,
+                    "Number of job state changes");
+  registry.DescribeHistogram("arex_job_state_duration_seconds",
+                    "Time spent by jobs in state before moving to next one",
+                    state_duration_buckets, sizeof(state_duration_buckets)/sizeof(state_duration_buckets[0]));
+  registry.Describe("arex_staging_transfers_total", MetricsRegistry::Counter,
+                    "Number of finished data staging transfers");
+  registry.Describe("arex_staging_bytes_total", MetricsRegistry::Counter,
+                    "Amount of data moved by successful data staging transfers");
+  registry.Describe("arex_staging_transfer_seconds_total", MetricsRegistry::Counter,
+                    "Time spent in successful data staging transfers");
 }
 
 JobsMetrics::~JobsMetrics() {
@@ -92,147 +104,110 @@ void JobsMetrics::SetEnabled(bool val) {
 }
 
 void JobsMetrics::SetConfig(const char* fname) {
-  config_filename = fname;
+  gmetric.SetConfig(fname);
 }
   
 void JobsMetrics::SetGmetricPath(const char* path) {
-  tool_path = path;
+  gmetric.SetGmetricPath(path);
+}
+
+void JobsMetrics::SetPeriod(int period) {
+  gmetric.SetPeriod(period);
 }
 
 
 void JobsMetrics::ReportJobStateChange(const GMConfig& config,  GMJobRef i, job_state_t old_state,  job_state_t new_state) {
-  if(!enabled) return; // not configured
+  // Values are always collected in registry. Only reporting to
+  // gmetric depends on configuration.
+  if(old_state == new_state) return; // only pending flag changed
   Glib::RecMutex::Lock lock_(lock);
 
-
   std::string job_id = i->job_id;
+  time_t now = time(NULL);
 
   /*
-    ## - failed jobs -- of the last 100 jobs, the number of failed jobs
+    ## - failed jobs -- of the last 100 finished jobs, the number of failed jobs
     ## - job states -- number of jobs in different A-REX internal stages
   */
   
 
   /*jobstatelist holds jobid and true for failed or false for non-failed job for 100 latest jobs */
-  jobstatelist.SetFailure(i->CheckFailure(config),job_id);
-  job_fail_counter = jobstatelist.failures;
-  fail_changed = true;
+  if(new_state == JOB_STATE_FINISHED) {
+    // Checking failure may involve reading file, so do it only once per job
+    jobstatelist.SetFailure(i->CheckFailure(config),job_id);
+    if(job_fail_counter != jobstatelist.failures) {
+      job_fail_counter = jobstatelist.failures;
+      fail_changed = true;
+      registry.Set("arex_jobs_failed_per_100", "", job_fail_counter);
+    };
+  };
 
   //actual states (jobstates)
   if(old_state < JOB_STATE_UNDEFINED) {
     --(jobs_in_state[old_state]);
     jobs_in_state_changed[old_state] = true;
+    registry.Add("arex_jobs_in_state",
+                 MetricsRegistry::Label("state", GMJob::get_state_name(old_state)), -1);
   };
   if(new_state < JOB_STATE_UNDEFINED) {
     ++(jobs_in_state[new_state]);
     jobs_in_state_changed[new_state] = true;
+    registry.Add("arex_jobs_in_state",
+                 MetricsRegistry::Label("state", GMJob::get_state_name(new_state)), 1);
+  };
+  registry.Add("arex_job_state_transitions_total",
+               MetricsRegistry::Label("from", GMJob::get_state_name(old_state),
+                                      "to", GMJob::get_state_name(new_state)), 1);
+
+  // Time spent in previous state. Jobs picked up after restart have no record.
+  std::map<std::string,time_t>::iterator state_time = jobs_state_time.find(job_id);
+  if(state_time != jobs_state_time.end()) {
+    if(old_state < JOB_STATE_UNDEFINED) {
+      registry.Observe("arex_job_state_duration_seconds",
+                       MetricsRegistry::Label("state", GMJob::get_state_name(old_state)),
+                       (now >= state_time->second) ? (now - state_time->second) : 0);
+    };
+  };
+  if((new_state == JOB_STATE_FINISHED) || (new_state == JOB_STATE_DELETED) || (new_state == JOB_STATE_UNDEFINED)) {
+    // Nothing interesting happens to job after this point
+    if(state_time != jobs_state_time.end()) jobs_state_time.erase(state_time);
+  } else {
+    jobs_state_time[job_id] = now;
   };
 
-  Sync();
+  if(enabled) Sync();
 }
 
-bool JobsMetrics::CheckRunMetrics(void) {
-  if(!proc) return true;
-  if(proc->Running()) return false;
-  int run_result = proc->Result();
-  if(run_result != 0) {
-   logger.msg(Arc::ERROR,": Metrics tool returned error code %i: %s",run_result,proc_stderr);
-  };
-  delete proc;
-  proc = NULL;
-  return true;
+void JobsMetrics::ReportTransfer(bool upload, bool success, unsigned long long int bytes, unsigned long long int time_ns) {
+  std::string direction(upload ? "upload" : "download");
+  registry.Add("arex_staging_transfers_total",
+               MetricsRegistry::Label("direction", direction, "result", success ? "success" : "failure"), 1);
+  if(!success) return;
+  registry.Add("arex_staging_bytes_total", MetricsRegistry::Label("direction", direction), bytes);
+  registry.Add("arex_staging_transfer_seconds_total", MetricsRegistry::Label("direction", direction),
+               ((double)time_ns) / 1000000000.0);
 }
 
 void JobsMetrics::Sync(void) {
   if(!enabled) return; // not configured
   Glib::RecMutex::Lock lock_(lock);
-  if(!CheckRunMetrics()) return;
-  // Run gmetric to report one change at a time
-  //since only one process can be started from Sync(), only 1 histogram can be sent at a time, therefore return for each call;
-  //Sync is therefore called multiple times until there are not more histograms that have changed
+  // Queue changed values and let sender pass them to gmetric in one batch
 
   if(fail_changed){
-    if(RunMetrics(
-		  std::string("AREX-JOBS-FAILED-PER-100"),
-		  Arc::tostring(job_fail_counter), "int32", "failed"
-		  )) {
-      fail_changed = false;
-      return;
-    };
+    gmetric.Report(std::string("AREX-JOBS-FAILED-PER-100"),
+                   Arc::tostring(job_fail_counter), "int32", "failed");
+    fail_changed = false;
   }
-  
-
 
   for(int state = 0; state < JOB_STATE_UNDEFINED; ++state) {
     if(jobs_in_state_changed[state]) {
-      if(RunMetrics(
-          std::string("AREX-JOBS-IN_STATE-") + Arc::tostring(state) + "-" + GMJob::get_state_name(static_cast<job_state_t>(state)),
-          Arc::tostring(jobs_in_state[state]), "int32", "jobs"
-		    )) {
-        jobs_in_state_changed[state] = false;
-        return;
-      };
+      gmetric.Report(std::string("AREX-JOBS-IN_STATE-") + Arc::tostring(state) + "-" + GMJob::get_state_name(static_cast<job_state_t>(state)),
+                     Arc::tostring(jobs_in_state[state]), "int32", "jobs");
+      jobs_in_state_changed[state] = false;
     };
   };
 
-
-}
-
- 
-bool JobsMetrics::RunMetrics(const std::string name, const std::string& value, const std::string unit_type, const std::string unit) {
-  if(proc) return false;
-  std::list<std::string> cmd;
-  if(tool_path.empty()) {
-    logger.msg(Arc::ERROR,"gmetric_bin_path empty in arc.conf (should never happen the default value should be used)");
-    return false;
-  } else {
-    cmd.push_back(tool_path);
-  };
-  if(!config_filename.empty()) {
-    cmd.push_back("-c");
-    cmd.push_back(config_filename);
-  };
-  cmd.push_back("-n");
-  cmd.push_back(name);
-  cmd.push_back("-g");
-  cmd.push_back("arc_jobs");
-  cmd.push_back("-v");
-  cmd.push_back(value);
-  cmd.push_back("-t");//unit-type
-  cmd.push_back(unit_type);
-  cmd.push_back("-u");//unit
-  cmd.push_back(unit);
-  
-  proc = new Arc::Run(cmd);
-  proc->AssignStderr(proc_stderr);
-  proc->AssignKicker(&RunMetricsKicker, this);
-  if(!(proc->Start())) {
-    delete proc;
-    proc = NULL;
-    return false;
-  };
-  return true;
-}
-
-void JobsMetrics::SyncAsync(void* arg) {
-  if(arg) {
-    JobsMetrics& it = *reinterpret_cast<JobsMetrics*>(arg);
-    Glib::RecMutex::Lock lock_(it.lock);
-    if(it.proc) {
-      // Continue only if no failure in previous call.
-      // Otherwise it can cause storm of failed calls.
-      if(it.proc->Result() == 0) {
-        it.Sync();
-      };
-    };
-  };
-}
-
-void JobsMetrics::RunMetricsKicker(void* arg) {
-  // Currently it is not allowed to start new external process
-  // from inside process kicker (todo: redesign).
-  // So do it asynchronously from another thread.
-  Arc::CreateThreadFunction(&SyncAsync, arg);
+  gmetric.Flush();
 }
 
 } // namespace ARex
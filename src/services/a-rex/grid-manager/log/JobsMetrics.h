@@ -6,12 +6,11 @@
 #include <list>
 #include <fstream>
 #include <ctime>
-
-#include <arc/Run.h>
+#include <map>
 
 #include "../jobs/GMJob.h"
-
-#define GMETRIC_STATERATE_UPDATE_INTERVAL 5//to-fix this value could be set in arc.conf to be tailored to site
+#include "MetricsRegistry.h"
+#include "GMetricSender.h"
 
 
 namespace ARex {
@@ -57,38 +56,21 @@ class JobsMetrics {
  private:
   Glib::RecMutex lock;
   bool enabled;
-  std::string config_filename;
-  std::string tool_path;
-
-  time_t time_lastupdate;
+  MetricsRegistry& registry;
+  GMetricSender gmetric;
 
   unsigned long long int job_fail_counter;
   unsigned long long int jobs_in_state[JOB_STATE_UNDEFINED];
-  unsigned long long int jobs_state_old_new[JOB_STATE_UNDEFINED+1][JOB_STATE_UNDEFINED];
-  unsigned long long int jobs_state_accum[JOB_STATE_UNDEFINED+1];
-  unsigned long long int jobs_state_accum_last[JOB_STATE_UNDEFINED+1];
-  double jobs_rate[JOB_STATE_UNDEFINED];
 
   bool fail_changed;
   bool jobs_in_state_changed[JOB_STATE_UNDEFINED];
-  bool jobs_state_old_new_changed[JOB_STATE_UNDEFINED+1][JOB_STATE_UNDEFINED];
-  bool jobs_rate_changed[JOB_STATE_UNDEFINED];
 
-  //id,state
-  std::map<std::string,job_state_t> jobs_state_old_map;
-  std::map<std::string,job_state_t> jobs_state_new_map;
-  
-  Arc::Run *proc;
-  std::string proc_stderr;
-
-  bool RunMetrics(const std::string name, const std::string& value, const std::string unit_type, const std::string unit);
-  bool CheckRunMetrics(void);
-  static void RunMetricsKicker(void* arg);
-  static void SyncAsync(void* arg);
+  // id, time when job entered its current state
+  std::map<std::string,time_t> jobs_state_time;
 
   JobStateList jobstatelist;
  public:
-  JobsMetrics(void);
+  JobsMetrics(MetricsRegistry& registry);
   ~JobsMetrics(void);
 
   void SetEnabled(bool val);
@@ -99,8 +81,14 @@ class JobsMetrics {
   /* Set path/name of gmetric  */
   void SetGmetricPath(const char* path);
 
+  /* Set minimal interval between reports sent to gmetric */
+  void SetPeriod(int period);
+
   void ReportJobStateChange(const GMConfig& config, GMJobRef i, job_state_t old_state, job_state_t new_state);
 
+  /* Report data staging transfer which finished */
+  void ReportTransfer(bool upload, bool success, unsigned long long int bytes, unsigned long long int time_ns);
+
   void Sync(void);
 
 };
@@ -0,0 +1,123 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <arc/StringConv.h>
+
+#include "MetricsRegistry.h"
+
+namespace ARex {
+
+static std::string value_to_string(double value) {
+  return Arc::tostring(value, 0, 15);
+}
+
+MetricsRegistry::MetricsRegistry(void) {
+}
+
+MetricsRegistry::~MetricsRegistry(void) {
+}
+
+void MetricsRegistry::Describe(const std::string& name, metric_type_t type, const std::string& help) {
+  Glib::Mutex::Lock lock(lock_);
+  Family& family = families_[name];
+  family.type = type;
+  family.help = help;
+}
+
+void MetricsRegistry::DescribeHistogram(const std::string& name, const std::string& help, const double* bounds, int num) {
+  Glib::Mutex::Lock lock(lock_);
+  Family& family = families_[name];
+  family.type = Histogram;
+  family.help = help;
+  family.bounds.assign(bounds, bounds+num);
+  // Observations recorded with previous buckets layout can't be converted
+  family.series.clear();
+}
+
+void MetricsRegistry::Add(const std::string& name, const std::string& labels, double delta) {
+  Glib::Mutex::Lock lock(lock_);
+  families_[name].series[labels].value += delta;
+}
+
+void MetricsRegistry::Set(const std::string& name, const std::string& labels, double value) {
+  Glib::Mutex::Lock lock(lock_);
+  families_[name].series[labels].value = value;
+}
+
+void MetricsRegistry::Observe(const std::string& name, const std::string& labels, double value) {
+  Glib::Mutex::Lock lock(lock_);
+  Family& family = families_[name];
+  Series& series = family.series[labels];
+  if(series.buckets.size() != family.bounds.size()+1) series.buckets.resize(family.bounds.size()+1, 0);
+  std::vector<double>::size_type n = 0;
+  for(; n < family.bounds.size(); ++n) if(value <= family.bounds[n]) break;
+  ++(series.buckets[n]);
+  series.sum += value;
+  ++(series.count);
+}
+
+double MetricsRegistry::Get(const std::string& name, const std::string& labels) const {
+  Glib::Mutex::Lock lock(lock_);
+  std::map<std::string,Family>::const_iterator family = families_.find(name);
+  if(family == families_.end()) return 0;
+  std::map<std::string,Series>::const_iterator series = family->second.series.find(labels);
+  if(series == family->second.series.end()) return 0;
+  return series->second.value;
+}
+
+void MetricsRegistry::Render(std::string& out) const {
+  Glib::Mutex::Lock lock(lock_);
+  for(std::map<std::string,Family>::const_iterator family = families_.begin();
+                               family != families_.end(); ++family) {
+    const std::string& name = family->first;
+    if(!family->second.help.empty())
+      out += "# HELP " + name + " " + family->second.help + "\n";
+    switch(family->second.type) {
+      case Counter: out += "# TYPE " + name + " counter\n"; break;
+      case Gauge: out += "# TYPE " + name + " gauge\n"; break;
+      case Histogram: out += "# TYPE " + name + " histogram\n"; break;
+      default: out += "# TYPE " + name + " untyped\n"; break;
+    };
+    for(std::map<std::string,Series>::const_iterator series = family->second.series.begin();
+                               series != family->second.series.end(); ++series) {
+      const std::string& labels = series->first;
+      if(family->second.type != Histogram) {
+        out += name;
+        if(!labels.empty()) out += "{" + labels + "}";
+        out += " " + value_to_string(series->second.value) + "\n";
+        continue;
+      };
+      std::string prefix = labels.empty() ? std::string("") : (labels + ",");
+      unsigned long long int cumulative = 0;
+      for(std::vector<unsigned long long int>::size_type n = 0; n < series->second.buckets.size(); ++n) {
+        cumulative += series->second.buckets[n];
+        std::string le = (n < family->second.bounds.size()) ? value_to_string(family->second.bounds[n]) : std::string("+Inf");
+        out += name + "_bucket{" + prefix + "le=\"" + le + "\"} " + Arc::tostring(cumulative) + "\n";
+      };
+      std::string suffix = labels.empty() ? std::string("") : ("{" + labels + "}");
+      out += name + "_sum" + suffix + " " + value_to_string(series->second.sum) + "\n";
+      out += name + "_count" + suffix + " " + Arc::tostring(series->second.count) + "\n";
+    };
+  };
+}
+
+std::string MetricsRegistry::Label(const std::string& name, const std::string& value) {
+  std::string label = name + "=\"";
+  for(std::string::size_type p = 0; p < value.length(); ++p) {
+    char c = value[p];
+    if(c == '\\') label += "\\\\";
+    else if(c == '"') label += "\\\"";
+    else if(c == '\n') label += "\\n";
+    else label += c;
+  };
+  label += "\"";
+  return label;
+}
+
+std::string MetricsRegistry::Label(const std::string& name1, const std::string& value1,
+                                   const std::string& name2, const std::string& value2) {
+  return Label(name1, value1) + "," + Label(name2, value2);
+}
+
+} // namespace ARex
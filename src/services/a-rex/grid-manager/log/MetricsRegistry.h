@@ -0,0 +1,79 @@
+/* in-process registry of A-REX metrics */
+#ifndef __GM_METRICS_REGISTRY_H__
+#define __GM_METRICS_REGISTRY_H__
+
+#include <string>
+#include <map>
+#include <vector>
+
+#include <arc/Thread.h>
+
+namespace ARex {
+
+/// Collection of counters, gauges and histograms kept in memory.
+/** Values are updated by grid-manager components and rendered on request
+   in Prometheus text exposition format. Updating is cheap - it only takes
+   lock and modifies value in memory. Each metric (family) is identified by
+   name and consists of series distinguished by set of labels. Labels are
+   passed in already rendered form like state="INLRMS",share="atlas" - use
+   Label() to produce them. */
+class MetricsRegistry {
+ public:
+  typedef enum {
+    Untyped,
+    Counter,
+    Gauge,
+    Histogram
+  } metric_type_t;
+
+  MetricsRegistry(void);
+  ~MetricsRegistry(void);
+
+  /// Assign type and description to metric.
+  void Describe(const std::string& name, metric_type_t type, const std::string& help);
+  /// Assign description and upper bounds of buckets to histogram metric.
+  /** bounds must be sorted in increasing order. Bucket +Inf is added automatically. */
+  void DescribeHistogram(const std::string& name, const std::string& help, const double* bounds, int num);
+
+  /// Increase value of counter or gauge by delta.
+  void Add(const std::string& name, const std::string& labels, double delta = 1);
+  /// Set value of gauge.
+  void Set(const std::string& name, const std::string& labels, double value);
+  /// Record one observation in histogram.
+  void Observe(const std::string& name, const std::string& labels, double value);
+  /// Returns current value of counter or gauge. Missing series gives 0.
+  double Get(const std::string& name, const std::string& labels) const;
+
+  /// Produce text representation of all metrics in Prometheus format.
+  void Render(std::string& out) const;
+
+  /// Renders label with proper escaping of value.
+  static std::string Label(const std::string& name, const std::string& value);
+  /// Renders two labels.
+  static std::string Label(const std::string& name1, const std::string& value1,
+                           const std::string& name2, const std::string& value2);
+
+ private:
+  class Series {
+   public:
+    double value;
+    std::vector<unsigned long long int> buckets;
+    double sum;
+    unsigned long long int count;
+    Series(void):value(0),sum(0),count(0) {};
+  };
+  class Family {
+   public:
+    metric_type_t type;
+    std::string help;
+    std::vector<double> bounds;
+    std::map<std::string,Series> series;
+    Family(void):type(Untyped) {};
+  };
+  mutable Glib::Mutex lock_;
+  std::map<std::string,Family> families_;
+};
+
+} // namespace ARex
+
+#endif
@@ -21,7 +21,7 @@ namespace ARex {
 
   static Arc::Logger& logger = Arc::Logger::getRootLogger();
 
-  SpaceMetrics::SpaceMetrics():enabled(false),proc(NULL) {
+  SpaceMetrics::SpaceMetrics(MetricsRegistry& registry_):enabled(false),registry(registry_),gmetric("arc_system") {
     freeCache = 0;
     totalFreeCache = 0;
     freeCache_update = false;
@@ -29,6 +29,14 @@ namespace ARex {
     freeSession = 0;
     totalFreeSession = 0;
     freeSession_update = false;
+
+    period = GMETRIC_DEFAULT_PERIOD;
+    time_lastupdate = 0;
+
+    registry.Describe("arex_session_free_gigabytes", MetricsRegistry::Gauge,
+                      "Free space in session directories");
+    registry.Describe("arex_cache_free_gigabytes", MetricsRegistry::Gauge,
+                      "Free space in cache directories");
   }
 
   SpaceMetrics::~SpaceMetrics() {
@@ -39,11 +47,16 @@ namespace ARex {
   }
 
   void SpaceMetrics::SetConfig(const char* fname) {
-    config_filename = fname;
+    gmetric.SetConfig(fname);
   }
   
   void SpaceMetrics::SetGmetricPath(const char* path) {
-    tool_path = path;
+    gmetric.SetGmetricPath(path);
+  }
+
+  void SpaceMetrics::SetPeriod(int val) {
+    period = val;
+    gmetric.SetPeriod(val);
   }
 
 
@@ -51,6 +64,11 @@ namespace ARex {
     if(!enabled) return; // not configured
     Glib::RecMutex::Lock lock_(lock);
 
+    // Checking file systems is not cheap and free space changes slowly
+    time_t now = time(NULL);
+    if((now >= time_lastupdate) && (((int)(now - time_lastupdate)) < period)) return;
+    time_lastupdate = now;
+
     /*Free sessiondir space*/
     struct statvfs info_session;
     totalFreeSession = 0;
@@ -86,6 +104,7 @@ namespace ARex {
         logger.msg(Arc::DEBUG, "Sessiondir %s: Free space %f GB", path, totalFreeSession);
 	
         freeSession_update = true;
+        registry.Set("arex_session_free_gigabytes", MetricsRegistry::Label("path", path), freeSession);
 
       }
 
@@ -118,6 +137,7 @@ namespace ARex {
           logger.msg(Arc::DEBUG, "Cache %s: Free space %f GB", path, totalFreeCache);
 	
           freeCache_update = true;
+          registry.Set("arex_cache_free_gigabytes", MetricsRegistry::Label("path", path), freeCache);
         }
       }
     }
@@ -128,103 +148,24 @@ namespace ARex {
     Sync();
   }
 
-  bool SpaceMetrics::CheckRunMetrics(void) {
-    if(!proc) return true;
-    if(proc->Running()) return false;
-    int run_result = proc->Result();
-    if(run_result != 0) {
-      logger.msg(Arc::ERROR,": Metrics tool returned error code %i: %s",run_result,proc_stderr);
-    };
-    delete proc;
-    proc = NULL;
-    return true;
-  }
-
   void SpaceMetrics::Sync(void) {
     if(!enabled) return; // not configured
     Glib::RecMutex::Lock lock_(lock);
-    if(!CheckRunMetrics()) return;
-    // Run gmetric to report one change at a time
-    //since only one process can be started from Sync(), only 1 histogram can be sent at a time, therefore return for each call;
-    //Sync is therefore called multiple times until there are not more histograms that have changed
+    // Queue changed values and let sender pass them to gmetric in one batch
 
     if(freeCache_update){
-      if(RunMetrics(
-                    std::string("AREX-CACHE-FREE"),
-                    Arc::tostring(totalFreeCache), "int32", "GB")
-                   ) {
-        freeCache_update = false;
-        return;
-      };
+      gmetric.Report(std::string("AREX-CACHE-FREE"),
+                     Arc::tostring(totalFreeCache), "int32", "GB");
+      freeCache_update = false;
     }
 
     if(freeSession_update){
-      if(RunMetrics(
-                    std::string("AREX-SESSION-FREE"),
-                    Arc::tostring(totalFreeSession), "int32", "GB")
-                   ) {
-        freeSession_update = false;
-        return;
-      };
+      gmetric.Report(std::string("AREX-SESSION-FREE"),
+                     Arc::tostring(totalFreeSession), "int32", "GB");
+      freeSession_update = false;
     }
 
-  }
-
- 
-  bool SpaceMetrics::RunMetrics(const std::string name, const std::string& value, const std::string unit_type, const std::string unit) {
-    if(proc) return false;
-    std::list<std::string> cmd;
-    if(tool_path.empty()) {
-      logger.msg(Arc::ERROR,"gmetric_bin_path empty in arc.conf (should never happen the default value should be used)");
-      return false;
-    } else {
-      cmd.push_back(tool_path);
-    };
-    if(!config_filename.empty()) {
-      cmd.push_back("-c");
-      cmd.push_back(config_filename);
-    };
-    cmd.push_back("-n");
-    cmd.push_back(name);
-    cmd.push_back("-g");
-    cmd.push_back("arc_system");
-    cmd.push_back("-v");
-    cmd.push_back(value);
-    cmd.push_back("-t");//unit-type
-    cmd.push_back(unit_type);
-    cmd.push_back("-u");//unit
-    cmd.push_back(unit);
-  
-    proc = new Arc::Run(cmd);
-    proc->AssignStderr(proc_stderr);
-    proc->AssignKicker(&RunMetricsKicker, this);
-    if(!(proc->Start())) {
-      delete proc;
-      proc = NULL;
-      return false;
-    };
-    return true;
-  }
-
-  void SpaceMetrics::SyncAsync(void* arg) {
-    if(arg) {
-      SpaceMetrics& it = *reinterpret_cast<SpaceMetrics*>(arg);
-      Glib::RecMutex::Lock lock_(it.lock);
-      if(it.proc) {
-        // Continue only if no failure in previous call.
-        // Otherwise it can cause storm of failed calls.
-        if(it.proc->Result() == 0) {
-          it.Sync();
-        };
-      };
-    };
-  }
-
-  void SpaceMetrics::RunMetricsKicker(void* arg) {
-    // Currently it is not allowed to start new external process
-    // from inside process kicker (todo: redesign).
-    // So do it asynchronously from another thread.
-    Arc::CreateThreadFunction(&SyncAsync, arg);
+    gmetric.Flush();
   }
 
 } // namespace ARex
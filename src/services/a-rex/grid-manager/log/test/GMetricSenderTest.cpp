@@ -0,0 +1,150 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string>
+#include <list>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <arc/FileUtils.h>
+
+#include "../GMetricSender.h"
+
+namespace ARex {
+
+class GMetricSenderTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(GMetricSenderTest);
+  CPPUNIT_TEST(TestBatch);
+  CPPUNIT_TEST(TestRequeue);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+  void TestBatch();
+  void TestRequeue();
+
+private:
+  std::string dir;
+  std::string tool;
+  // Waits till batch being sent is processed
+  static bool WaitSent(GMetricSender& sender);
+  static unsigned int Queued(GMetricSender& sender);
+  std::list<std::string> Sent();
+};
+
+void GMetricSenderTest::setUp() {
+  CPPUNIT_ASSERT(Arc::TmpDirCreate(dir));
+  // Fake gmetric records group, name and value of every call
+  // and fails while marker file exists
+  tool = dir + "/gmetric";
+  CPPUNIT_ASSERT(Arc::FileCreate(tool,
+    "#!/bin/sh\n"
+    "[ -f " + dir + "/fail ] && exit 1\n"
+    "echo \"$4 $2 $6\" >> " + dir + "/sent\n",
+    0, 0, S_IRWXU));
+}
+
+void GMetricSenderTest::tearDown() {
+  Arc::DirDelete(dir, true);
+}
+
+bool GMetricSenderTest::WaitSent(GMetricSender& sender) {
+  for(int n = 0; n < 200; ++n) {
+    {
+      Glib::Mutex::Lock lock(sender.lock_);
+      if(!sender.sending_) return true;
+    }
+    ::usleep(50000);
+  }
+  return false;
+}
+
+unsigned int GMetricSenderTest::Queued(GMetricSender& sender) {
+  Glib::Mutex::Lock lock(sender.lock_);
+  return sender.queued_.size();
+}
+
+std::list<std::string> GMetricSenderTest::Sent() {
+  std::list<std::string> lines;
+  Arc::FileRead(dir + "/sent", lines);
+  return lines;
+}
+
+void GMetricSenderTest::TestBatch() {
+  GMetricSender sender("arex");
+  sender.SetGmetricPath(tool);
+  sender.SetPeriod(0);
+  sender.Report("jobs", "1", "int32", "jobs");
+  sender.Report("slots", "2", "int32", "slots");
+  // Only latest value is sent
+  sender.Report("jobs", "3", "int32", "jobs");
+  sender.Flush();
+  CPPUNIT_ASSERT(WaitSent(sender));
+  std::list<std::string> sent = Sent();
+  CPPUNIT_ASSERT_EQUAL(2, (int)sent.size());
+  CPPUNIT_ASSERT_EQUAL(std::string("arex jobs 3"), sent.front());
+  CPPUNIT_ASSERT_EQUAL(std::string("arex slots 2"), sent.back());
+  CPPUNIT_ASSERT_EQUAL(0U, Queued(sender));
+
+  // Values reported within period are kept for next batch
+  sender.SetPeriod(3600);
+  sender.Report("jobs", "4", "int32", "jobs");
+  sender.Flush();
+  CPPUNIT_ASSERT(WaitSent(sender));
+  CPPUNIT_ASSERT_EQUAL(2, (int)Sent().size());
+  CPPUNIT_ASSERT_EQUAL(1U, Queued(sender));
+}
+
+void GMetricSenderTest::TestRequeue() {
+  CPPUNIT_ASSERT(Arc::FileCreate(dir + "/fail", ""));
+  GMetricSender sender("arex");
+  sender.SetGmetricPath(tool);
+  sender.SetPeriod(0);
+  sender.Report("jobs", "1", "int32", "jobs");
+  sender.Report("slots", "2", "int32", "slots");
+  sender.Flush();
+  CPPUNIT_ASSERT(WaitSent(sender));
+  CPPUNIT_ASSERT(Sent().empty());
+  // Whole batch is put back after failure
+  CPPUNIT_ASSERT_EQUAL(2U, Queued(sender));
+  {
+    Glib::Mutex::Lock lock(sender.lock_);
+    CPPUNIT_ASSERT(sender.failed_);
+  }
+
+  // Failure makes sender wait longer than period before next attempt
+  CPPUNIT_ASSERT(Arc::FileDelete(dir + "/fail"));
+  sender.Flush();
+  CPPUNIT_ASSERT(WaitSent(sender));
+  CPPUNIT_ASSERT(Sent().empty());
+  CPPUNIT_ASSERT_EQUAL(2U, Queued(sender));
+
+  // Requeued value is replaced by newer one
+  sender.Report("slots", "5", "int32", "slots");
+  {
+    Glib::Mutex::Lock lock(sender.lock_);
+    sender.last_flush_ = 0;
+  }
+  sender.Flush();
+  CPPUNIT_ASSERT(WaitSent(sender));
+  std::list<std::string> sent = Sent();
+  CPPUNIT_ASSERT_EQUAL(2, (int)sent.size());
+  CPPUNIT_ASSERT_EQUAL(std::string("arex jobs 1"), sent.front());
+  CPPUNIT_ASSERT_EQUAL(std::string("arex slots 5"), sent.back());
+  CPPUNIT_ASSERT_EQUAL(0U, Queued(sender));
+  {
+    Glib::Mutex::Lock lock(sender.lock_);
+    CPPUNIT_ASSERT(!sender.failed_);
+  }
+}
+
+} // namespace ARex
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ARex::GMetricSenderTest);
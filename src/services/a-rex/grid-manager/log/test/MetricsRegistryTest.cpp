@@ -0,0 +1,115 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "../MetricsRegistry.h"
+
+using namespace ARex;
+
+class MetricsRegistryTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(MetricsRegistryTest);
+  CPPUNIT_TEST(TestLabel);
+  CPPUNIT_TEST(TestValues);
+  CPPUNIT_TEST(TestHistogram);
+  CPPUNIT_TEST(TestRender);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void TestLabel();
+  void TestValues();
+  void TestHistogram();
+  void TestRender();
+};
+
+void MetricsRegistryTest::TestLabel() {
+  CPPUNIT_ASSERT_EQUAL(std::string("state=\"INLRMS\""), MetricsRegistry::Label("state", "INLRMS"));
+  // Backslash, double quote and new line must be escaped
+  CPPUNIT_ASSERT_EQUAL(std::string("share=\"a\\\\b\\\"c\\nd\""), MetricsRegistry::Label("share", "a\\b\"c\nd"));
+  CPPUNIT_ASSERT_EQUAL(std::string("share=\"\""), MetricsRegistry::Label("share", ""));
+  CPPUNIT_ASSERT_EQUAL(std::string("state=\"FINISHED\",share=\"x\\\"y\""),
+                       MetricsRegistry::Label("state", "FINISHED", "share", "x\"y"));
+}
+
+void MetricsRegistryTest::TestValues() {
+  MetricsRegistry metrics;
+  std::string labels = MetricsRegistry::Label("state", "ACCEPTED");
+  CPPUNIT_ASSERT_EQUAL(0.0, metrics.Get("jobs", labels));
+  metrics.Add("jobs", labels);
+  metrics.Add("jobs", labels, 2);
+  CPPUNIT_ASSERT_EQUAL(3.0, metrics.Get("jobs", labels));
+  metrics.Add("jobs", labels, -1);
+  CPPUNIT_ASSERT_EQUAL(2.0, metrics.Get("jobs", labels));
+  CPPUNIT_ASSERT_EQUAL(0.0, metrics.Get("jobs", ""));
+  metrics.Set("jobs", labels, 10);
+  CPPUNIT_ASSERT_EQUAL(10.0, metrics.Get("jobs", labels));
+}
+
+void MetricsRegistryTest::TestHistogram() {
+  MetricsRegistry metrics;
+  const double bounds[] = { 1, 5, 10 };
+  metrics.DescribeHistogram("time", "Processing time", bounds, 3);
+  std::string labels = MetricsRegistry::Label("share", "a");
+  metrics.Observe("time", labels, 0.5);
+  // Value equal to bound belongs to that bucket
+  metrics.Observe("time", labels, 1);
+  metrics.Observe("time", labels, 3);
+  metrics.Observe("time", labels, 7);
+  metrics.Observe("time", labels, 100);
+  std::string out;
+  metrics.Render(out);
+  // Buckets are cumulative and end with +Inf holding all observations
+  CPPUNIT_ASSERT_EQUAL(std::string(
+    "# HELP time Processing time\n"
+    "# TYPE time histogram\n"
+    "time_bucket{share=\"a\",le=\"1\"} 2\n"
+    "time_bucket{share=\"a\",le=\"5\"} 3\n"
+    "time_bucket{share=\"a\",le=\"10\"} 4\n"
+    "time_bucket{share=\"a\",le=\"+Inf\"} 5\n"
+    "time_sum{share=\"a\"} 111.5\n"
+    "time_count{share=\"a\"} 5\n"), out);
+
+  // Changing buckets drops observations made with old layout
+  const double other[] = { 2 };
+  metrics.DescribeHistogram("time", "Processing time", other, 1);
+  metrics.Observe("time", "", 3);
+  out.clear();
+  metrics.Render(out);
+  CPPUNIT_ASSERT_EQUAL(std::string(
+    "# HELP time Processing time\n"
+    "# TYPE time histogram\n"
+    "time_bucket{le=\"2\"} 0\n"
+    "time_bucket{le=\"+Inf\"} 1\n"
+    "time_sum 3\n"
+    "time_count 1\n"), out);
+}
+
+void MetricsRegistryTest::TestRender() {
+  MetricsRegistry metrics;
+  metrics.Describe("jobs", MetricsRegistry::Counter, "Processed jobs");
+  metrics.Describe("free", MetricsRegistry::Gauge, "Free slots");
+  metrics.Add("jobs", MetricsRegistry::Label("state", "FINISHED"), 3);
+  metrics.Add("jobs", MetricsRegistry::Label("state", "FAILED"));
+  metrics.Set("free", "", 7);
+  metrics.Add("other", "");
+  std::string out;
+  metrics.Render(out);
+  // Families and series are ordered by name
+  CPPUNIT_ASSERT_EQUAL(std::string(
+    "# HELP free Free slots\n"
+    "# TYPE free gauge\n"
+    "free 7\n"
+    "# HELP jobs Processed jobs\n"
+    "# TYPE jobs counter\n"
+    "jobs{state=\"FAILED\"} 1\n"
+    "jobs{state=\"FINISHED\"} 3\n"
+    "# TYPE other untyped\n"
+    "other 1\n"), out);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MetricsRegistryTest);
@@ -0,0 +1,120 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// Compares time needed to find all jobs in control directory when states
+// are kept in separate files and when they are kept in database.
+
+#include <cstdlib>
+#include <iostream>
+
+#include <glibmm.h>
+
+#include <arc/FileUtils.h>
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+
+#include "conf/GMConfig.h"
+#include "files/ControlFileHandling.h"
+#include "files/JobStateStore.h"
+#include "jobs/JobsList.h"
+
+using namespace ARex;
+
+static double scanJobs(const GMConfig& config, int repeats, unsigned int& found) {
+  Glib::TimeVal tBefore;
+  tBefore.assign_current_time();
+  for(int n = 0; n < repeats; ++n) {
+    std::list<JobId> ids;
+    if(!JobsList::GetAllJobIds(config, ids)) {
+      std::cerr << "Failed to scan jobs" << std::endl;
+      exit(EXIT_FAILURE);
+    };
+    found = ids.size();
+  };
+  Glib::TimeVal tAfter;
+  tAfter.assign_current_time();
+  return (tAfter.as_double()-tBefore.as_double())/repeats;
+}
+
+int main(int argc, char* argv[]) {
+  Arc::LogStream logcerr(std::cerr);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+  Arc::Logger::getRootLogger().setThreshold(Arc::ERROR);
+
+  if((argc < 2) || (argc > 4)) {
+    std::cerr << "Wrong number of arguments!" << std::endl
+              << std::endl
+              << "Usage:" << std::endl
+              << "perftest_controlstore jobs [repeats [dir]]" << std::endl
+              << std::endl
+              << "Arguments:" << std::endl
+              << "jobs      Number of jobs to create, e.g. 100000." << std::endl
+              << "repeats   Number of scans to average over. Default is 3." << std::endl
+              << "dir       Directory in which temporary control directory is created." << std::endl
+              << "          It should reside on filesystem to be evaluated." << std::endl;
+    exit(EXIT_FAILURE);
+  };
+  unsigned int jobs = atoi(argv[1]);
+  int repeats = (argc > 2) ? atoi(argv[2]) : 3;
+  if(repeats < 1) repeats = 1;
+  std::string control_dir;
+  if(argc > 3) {
+    control_dir = std::string(argv[3]) + "/perftest_controlstore." + Arc::tostring(getpid());
+    if(!Arc::DirCreate(control_dir, S_IRWXU, false)) control_dir.clear();
+  } else {
+    if(!Arc::TmpDirCreate(control_dir)) control_dir.clear();
+  };
+  if(control_dir.empty()) {
+    std::cerr << "Failed to create control directory" << std::endl;
+    exit(EXIT_FAILURE);
+  };
+
+  GMConfig config;
+  config.SetControlDir(control_dir);
+  const char* subdirs[] = { subdir_new, subdir_cur, subdir_old, subdir_rew };
+  for(unsigned int n = 0; n < sizeof(subdirs)/sizeof(subdirs[0]); ++n) {
+    (void)Arc::DirCreate(control_dir + "/" + subdirs[n], S_IRWXU, false);
+  };
+
+  // Typical site has most of jobs finished and some active. Every state
+  // is written by same functions A-REX uses, so both layouts get filled.
+  std::cout << "Creating " << jobs << " jobs in " << control_dir << std::endl;
+  config.SetControlStoreType(GMConfig::control_store_sqlite);
+  JobStateStore* store = JobStateStore::Get(config);
+  if(!store) {
+    std::cerr << "Failed to create database" << std::endl;
+    Arc::DirDelete(control_dir, true);
+    exit(EXIT_FAILURE);
+  };
+  (void)store->Begin();
+  for(unsigned int n = 0; n < jobs; ++n) {
+    GMJob job("perftest" + Arc::tostring(n), Arc::User());
+    job_state_t state = (n % 10 == 0) ? JOB_STATE_INLRMS : JOB_STATE_FINISHED;
+    if(!job_state_write_file(job, config, state, false)) {
+      std::cerr << "Failed to create job " << job.get_id() << std::endl;
+      Arc::DirDelete(control_dir, true);
+      exit(EXIT_FAILURE);
+    };
+  };
+  (void)store->Commit();
+
+  unsigned int found_files = 0;
+  unsigned int found_store = 0;
+  config.SetControlStoreType(GMConfig::control_store_files);
+  double files_time = scanJobs(config, repeats, found_files);
+  config.SetControlStoreType(GMConfig::control_store_sqlite);
+  double store_time = scanJobs(config, repeats, found_store);
+
+  Arc::DirDelete(control_dir, true);
+
+  std::cout << "========================================" << std::endl;
+  std::cout << "Number of jobs: " << jobs << std::endl;
+  std::cout << "Number of scans: " << repeats << std::endl;
+  std::cout << "Files:    " << found_files << " jobs found in " << files_time << " s" << std::endl;
+  std::cout << "Database: " << found_store << " jobs found in " << store_time << " s" << std::endl;
+  if(store_time > 0)
+    std::cout << "Speedup: " << files_time/store_time << std::endl;
+  std::cout << "========================================" << std::endl;
+  return 0;
+}
@@ -76,6 +76,8 @@ void ARexService::InformationCollector(void) {
       if(!xml_str.empty()) {
         // Currently glue states are lost. Counter of all jobs is lost too.
         infodoc_.Assign(xml_str, config_.InformationFile());
+        // Representations served to clients are prepared once per cycle
+        rest_.UpdateInfo(xml_str);
         Arc::XMLNode root = infodoc_.Acquire();
         Arc::XMLNode all_jobs_count = root["Domains"]["AdminDomain"]["Services"]["ComputingService"]["AllJobs"];
         if((bool)all_jobs_count) {
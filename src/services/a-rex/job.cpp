@@ -34,6 +34,7 @@
 #include "grid-manager/jobs/JobDescriptionHandler.h"
 #include "grid-manager/jobs/CommFIFO.h"
 #include "grid-manager/jobs/JobsList.h"
+#include "grid-manager/jobs/JobOwnerIndex.h"
 #include "grid-manager/files/ControlFileHandling.h"
 #include "delegation/DelegationStores.h"
 #include "delegation/DelegationStore.h"
@@ -872,6 +873,9 @@ void ARexJob::make_new_job(std::string const& job_desc_str,const std::string& de
     failure_type_=ARexJobInternalError;
     return;
   };
+  // Make job visible in listings before grid-manager picks it up
+  JobOwnerIndex* owners = config_.GmConfig().GetJobOwnerIndex();
+  if(owners) owners->Add(id_,job_.DN,JOB_STATE_ACCEPTED,false,false);
   // Put lock on all delegated credentials of this job.
   // Because same delegation id can be used multiple times remove
   // duplicates to avoid adding multiple identical locking records.
@@ -1047,9 +1051,21 @@ int ARexJob::TotalJobs(ARexGMConfig& config,Arc::Logger& /* logger */) {
   return JobsList::CountAllJobs(config.GmConfig());
 }
 
-// TODO: optimize
 std::list<std::string> ARexJob::Jobs(ARexGMConfig& config,Arc::Logger& logger) {
   std::list<std::string> jlist;
+  JobOwnerIndex* owners = config.GmConfig().GetJobOwnerIndex();
+  if(owners && owners->Ready()) {
+    // Jobs without session directory are not reported
+    class NotDeleted: public JobOwnerIndex::Filter {
+     public:
+      virtual bool accept(const JobOwnerIndex::Item& item) const { return (item.state != JOB_STATE_DELETED); };
+    } filter;
+    std::list<JobOwnerIndex::Item> items;
+    owners->List(config.GridName(),"",(unsigned int)(-1),&filter,items);
+    for(std::list<JobOwnerIndex::Item>::iterator item = items.begin(); item != items.end(); ++item)
+      jlist.push_back(item->id);
+    return jlist;
+  };
   JobsList::GetAllJobIds(config.GmConfig(),jlist);
   std::list<std::string>::iterator i = jlist.begin();
   while(i!=jlist.end()) {
@@ -0,0 +1,185 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cstring>
+#include <list>
+
+#include <zlib.h>
+
+#include <arc/CheckSum.h>
+#include <arc/StringConv.h>
+#include <arc/message/PayloadRaw.h>
+
+#include "info_cache.h"
+
+namespace ARex {
+
+// Compresses content into gzip format. Returns false on failure.
+static bool Compress(std::string const& content, std::string& compressed) {
+  compressed.clear();
+  z_stream zs;
+  std::memset(&zs, 0, sizeof(zs));
+  // 15 bits window + 16 for gzip header
+  if(deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15+16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+  compressed.resize(deflateBound(&zs, content.length()));
+  zs.next_in = (Bytef*)content.c_str();
+  zs.avail_in = content.length();
+  zs.next_out = (Bytef*)&(compressed[0]);
+  zs.avail_out = compressed.length();
+  int r = deflate(&zs, Z_FINISH);
+  compressed.resize(zs.total_out);
+  deflateEnd(&zs);
+  if(r != Z_STREAM_END) {
+    compressed.clear();
+    return false;
+  };
+  return true;
+}
+
+static std::string Digest(std::string const& content) {
+  Arc::SHA256Sum sum;
+  sum.start();
+  sum.add(const_cast<char*>(content.c_str()), content.length());
+  sum.end();
+  char buf[128];
+  sum.print(buf, sizeof(buf));
+  // Skip algorithm name and use half of digest - enough to tell versions apart
+  char const* hex = std::strchr(buf, ':');
+  hex = hex ? (hex+1) : buf;
+  return std::string(hex, std::strlen(hex) > 32 ? 32 : std::strlen(hex));
+}
+
+// Checks if list of entity tags from If-None-Match contains specified one.
+static bool MatchETag(std::string const& header, std::string const& etag) {
+  std::list<std::string> tags;
+  Arc::tokenize(header, tags, ",");
+  for(std::list<std::string>::iterator tag = tags.begin(); tag != tags.end(); ++tag) {
+    std::string value = Arc::trim(*tag);
+    if(value == "*") return true;
+    // Weak comparison is used for conditional GET
+    if(value.compare(0, 2, "W/") == 0) value.erase(0, 2);
+    if(value == etag) return true;
+  };
+  return false;
+}
+
+static bool AcceptsGzip(Arc::Message& inmsg) {
+  for(Arc::AttributeIterator attrIt = inmsg.Attributes()->getAll("HTTP:accept-encoding"); attrIt.hasMore(); ++attrIt) {
+    std::list<std::string> encodings;
+    Arc::tokenize(*attrIt, encodings, ",");
+    for(std::list<std::string>::iterator enc = encodings.begin(); enc != encodings.end(); ++enc) {
+      std::string value = Arc::lower(Arc::trim(*enc));
+      std::string::size_type pos = value.find(';');
+      std::string params;
+      if(pos != std::string::npos) {
+        params = value.substr(pos+1);
+        value = Arc::trim(value.substr(0, pos));
+      };
+      if((value != "gzip") && (value != "x-gzip")) continue;
+      // Only explicit refusal is q=0
+      params = Arc::trim(params);
+      if((params.compare(0, 2, "q=") == 0) && (Arc::stringtod(params.substr(2)) <= 0)) return false;
+      return true;
+    };
+  };
+  return false;
+}
+
+InfoDocumentCache::InfoDocumentCache(void): modified_(Arc::Time::UNDEFINED), version_(0) {
+}
+
+InfoDocumentCache::~InfoDocumentCache(void) {
+}
+
+void InfoDocumentCache::Assign(Representations& representations) {
+  // Heavy processing is done outside of lock
+  std::map<std::string, Representation> prepared;
+  for(Representations::iterator r = representations.begin(); r != representations.end(); ++r) {
+    Representation& representation = prepared[r->first];
+    representation.mime = r->second.first;
+    representation.content.swap(r->second.second);
+    representation.etag = Digest(representation.content);
+    // Compressed version is only kept if it makes sense
+    if(Compress(representation.content, representation.compressed)) {
+      if(representation.compressed.length() >= representation.content.length())
+        representation.compressed.clear();
+    };
+  };
+  representations.clear();
+  Arc::Time modified;
+  Glib::Mutex::Lock lock(lock_);
+  // Document regenerated with same content keeps its modification time
+  bool changed = (prepared.size() != representations_.size());
+  for(std::map<std::string, Representation>::iterator r = prepared.begin();
+                                 (!changed) && (r != prepared.end()); ++r) {
+    std::map<std::string, Representation>::const_iterator old = representations_.find(r->first);
+    if((old == representations_.end()) || (old->second.etag != r->second.etag)) changed = true;
+  };
+  representations_.swap(prepared);
+  if(changed || (modified_.GetTime() == Arc::Time::UNDEFINED)) {
+    // Last-Modified has seconds resolution - make sure it changes
+    if((modified_.GetTime() != Arc::Time::UNDEFINED) && (modified.GetTime() <= modified_.GetTime()))
+      modified = Arc::Time(modified_.GetTime()+1);
+    modified_ = modified;
+  };
+  ++version_;
+}
+
+bool InfoDocumentCache::Valid(void) const {
+  Glib::Mutex::Lock lock(lock_);
+  return version_ > 0;
+}
+
+unsigned int InfoDocumentCache::Version(void) const {
+  Glib::Mutex::Lock lock(lock_);
+  return version_;
+}
+
+bool InfoDocumentCache::Respond(std::string const& name, Arc::Message& inmsg, Arc::Message& outmsg) const {
+  bool gzip = AcceptsGzip(inmsg);
+  std::string ifNoneMatch = inmsg.Attributes()->get("HTTP:if-none-match");
+  std::string ifModifiedSince = inmsg.Attributes()->get("HTTP:if-modified-since");
+  bool head = (inmsg.Attributes()->get("HTTP:METHOD") == "HEAD");
+  Glib::Mutex::Lock lock(lock_);
+  std::map<std::string, Representation>::const_iterator r = representations_.find(name);
+  if(r == representations_.end()) return false;
+  Representation const& representation = r->second;
+  if(representation.compressed.empty()) gzip = false;
+  // Different encodings are different entities
+  std::string etag = "\"" + representation.etag + (gzip ? "-gz" : "") + "\"";
+  bool modified = true;
+  if(!ifNoneMatch.empty()) {
+    // If-Modified-Since is ignored if If-None-Match is present
+    modified = !MatchETag(ifNoneMatch, etag);
+  } else if(!ifModifiedSince.empty()) {
+    Arc::Time since(ifModifiedSince);
+    if(since.GetTime() != Arc::Time::UNDEFINED)
+      modified = (modified_.GetTime() > since.GetTime());
+  };
+  Arc::PayloadRaw* outpayload = new Arc::PayloadRaw();
+  if(!modified) {
+    outmsg.Attributes()->set("HTTP:CODE","304");
+    outmsg.Attributes()->set("HTTP:REASON","Not Modified");
+  } else {
+    std::string const& content = gzip ? representation.compressed : representation.content;
+    if(head) {
+      outpayload->Truncate(content.length());
+    } else {
+      outpayload->Insert(content.c_str(),0,content.length());
+    };
+    outmsg.Attributes()->set("HTTP:CODE","200");
+    outmsg.Attributes()->set("HTTP:REASON","OK");
+    outmsg.Attributes()->set("HTTP:content-type",representation.mime);
+    if(gzip) outmsg.Attributes()->set("HTTP:content-encoding","gzip");
+  };
+  delete outmsg.Payload(outpayload);
+  outmsg.Attributes()->set("HTTP:etag",etag);
+  outmsg.Attributes()->set("HTTP:last-modified",modified_.str(Arc::RFC1123Time));
+  outmsg.Attributes()->set("HTTP:vary","Accept, Accept-Encoding");
+  // Clients must revalidate because document may change every collector cycle
+  outmsg.Attributes()->set("HTTP:cache-control","no-cache");
+  return true;
+}
+
+} // namespace ARex
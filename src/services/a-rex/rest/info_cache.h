@@ -0,0 +1,61 @@
+#ifndef __ARC_AREX_INFO_CACHE_H__
+#define __ARC_AREX_INFO_CACHE_H__
+
+#include <string>
+#include <map>
+
+#include <glibmm/thread.h>
+
+#include <arc/DateTime.h>
+#include <arc/message/Message.h>
+
+namespace ARex {
+
+/// Pre-rendered representations of information document.
+/** Information collector renders document into every supported representation
+   once per cycle. Each representation is stored together with its gzip
+   compressed version and entity tag, so that requests are served from memory
+   and repeated polls with If-None-Match or If-Modified-Since are answered
+   with 304 Not Modified. */
+class InfoDocumentCache {
+ public:
+  /// Content of representations ready to be stored - name -> (content type, content)
+  typedef std::map<std::string, std::pair<std::string,std::string> > Representations;
+
+  InfoDocumentCache(void);
+  ~InfoDocumentCache(void);
+
+  /// Replaces stored representations with new ones. Passed content is taken over.
+  void Assign(Representations& representations);
+
+  /// Returns true if document was assigned.
+  bool Valid(void) const;
+
+  /// Number of times document was assigned.
+  unsigned int Version(void) const;
+
+  /// Makes response with specified representation taking into account
+  /// conditional and encoding related headers of request.
+  /** Returns false if there is no such representation. */
+  bool Respond(std::string const& name, Arc::Message& inmsg, Arc::Message& outmsg) const;
+
+ private:
+  class Representation {
+   public:
+    std::string mime;
+    std::string content;
+    std::string compressed;
+    std::string etag;
+  };
+  mutable Glib::Mutex lock_;
+  std::map<std::string, Representation> representations_;
+  Arc::Time modified_;
+  unsigned int version_;
+
+  InfoDocumentCache(InfoDocumentCache const&);
+  InfoDocumentCache& operator=(InfoDocumentCache const&);
+};
+
+} // namespace ARex
+
+#endif // __ARC_AREX_INFO_CACHE_H__
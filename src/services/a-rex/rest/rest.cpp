@@ -4,6 +4,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <algorithm>
+#include <cstring>
 
 #include <arc/message/PayloadRaw.h>
 #include <arc/message/PayloadStream.h>
@@ -16,6 +17,8 @@
 #include "../FileChunks.h"
 #include "../delegation/DelegationStores.h"
 #include "../grid-manager/files/ControlFileHandling.h"
+#include "../grid-manager/jobs/JobOwnerIndex.h"
+#include "../grid-manager/log/MetricsRegistry.h"
 
 #include "rest.h"
 
@@ -711,6 +714,9 @@ Arc::MCC_Status ARexRest::process(Arc::Message& inmsg,Arc::Message& outmsg) {
     // {<service endpoint URL>/rest}/<version>/jobs[?state=<state1>[&state=<state2>[...]]]
     // {<service endpoint URL>/rest}/<version>/jobs?action={new|info|status|kill|clean|restart}
     return processJobs(inmsg, outmsg, context);
+  } else if (functionality == "metrics") {
+    // {<service endpoint URL>/rest}/<version>/metrics
+    return processMetrics(inmsg, outmsg, context);
   }
 
   return HTTPFault(inmsg,outmsg,404,"Functionality Not Supported");
@@ -749,12 +755,59 @@ Arc::MCC_Status ARexRest::processInfo(Arc::Message& inmsg,Arc::Message& outmsg,
     return HTTPFault(inmsg,outmsg,501,"Schema not implemented");
   }
 
-  std::string infoStr;
-  Arc::FileRead(config_.InformationFile(), infoStr);
-  XMLNode infoXml(infoStr);
+  if(!info_cache_.Valid()) {
+    // Information collector did not provide document yet - use stored one
+    std::string infoStr;
+    if(Arc::FileRead(config_.InformationFile(), infoStr)) UpdateInfo(infoStr);
+  }
+  char const * representation = "html";
+  switch(ProcessAcceptedFormat(inmsg,outmsg)) {
+    case ResponseFormatXml: representation = "xml"; break;
+    case ResponseFormatJson: representation = "json"; break;
+    default: break;
+  }
+  if(info_cache_.Respond(representation, inmsg, outmsg))
+    return Arc::MCC_Status(Arc::STATUS_OK);
+  XMLNode infoXml;
   return HTTPResponse(inmsg, outmsg, infoXml);
 }
 
+void ARexRest::UpdateInfo(std::string const& infoStr) {
+  XMLNode infoXml(infoStr);
+  if(!infoXml) return;
+  InfoDocumentCache::Representations representations;
+  representations["raw"] = std::make_pair(std::string("text/xml"), infoStr);
+  representations["xml"].first = "application/xml";
+  RenderResponse(infoXml, ResponseFormatXml, representations["xml"].second);
+  representations["json"].first = "application/json";
+  RenderResponse(infoXml, ResponseFormatJson, representations["json"].second);
+  representations["html"].first = "text/html";
+  RenderResponse(infoXml, ResponseFormatHtml, representations["html"].second);
+  info_cache_.Assign(representations);
+}
+
+// ---------------------------- METRICS ---------------------------------
+
+Arc::MCC_Status ARexRest::processMetrics(Arc::Message& inmsg,Arc::Message& outmsg, ProcessingContext& context) {
+  if(!context.subpath.empty())
+    return HTTPFault(inmsg,outmsg,404,"Not Found");
+
+  // GET <base URL>/metrics - retrieve internal metrics in Prometheus text format.
+  // HEAD - supported.
+  // PUT,POST,DELETE - not supported.
+  if((context.method != "GET") && (context.method != "HEAD")) {
+    logger_.msg(Arc::VERBOSE, "process: method %s is not supported for subpath %s",context.method,context.processed);
+    return HTTPFault(inmsg,outmsg,501,"Not Implemented");
+  }
+
+  MetricsRegistry* registry = config_.GetMetricsRegistry();
+  if(!registry)
+    return HTTPFault(inmsg,outmsg,404,"Not Found");
+  std::string metricsStr;
+  registry->Render(metricsStr);
+  return HTTPResponse(inmsg, outmsg, metricsStr, "text/plain; version=0.0.4");
+}
+
 // ---------------------------- DELEGATIONS ---------------------------------
 
 Arc::MCC_Status ARexRest::processDelegations(Arc::Message& inmsg,Arc::Message& outmsg, ProcessingContext& context) {
@@ -886,8 +939,161 @@ static bool processJobClean(Arc::Message& inmsg,ARexConfigContext& config, Arc::
 static bool processJobRestart(Arc::Message& inmsg,ARexConfigContext& config, Arc::Logger& logger, std::string const & id, XMLNode jobXml);
 static bool processJobDelegations(Arc::Message& inmsg,ARexConfigContext& config, Arc::Logger& logger, std::string const & id, XMLNode jobXml, ARex::DelegationStores& delegation_stores);
 
+// Selects jobs by their REST states. Jobs without session directory are never listed.
+class RESTJobsFilter: public JobOwnerIndex::Filter {
+ public:
+  RESTJobsFilter(std::list<std::string> const& states): states_(states) {};
+  virtual ~RESTJobsFilter(void) {};
+  virtual bool accept(const JobOwnerIndex::Item& item) const {
+    if(item.state == JOB_STATE_DELETED) return false;
+    if(states_.empty()) return true;
+    std::string rest_state = State(item);
+    return (std::find(states_.begin(), states_.end(), rest_state) != states_.end());
+  };
+  static std::string State(const JobOwnerIndex::Item& item) {
+    // Only cancellation matters out of failure cause
+    std::string rest_state;
+    convertActivityStatusREST(GMJob::get_state_name(item.state),rest_state,item.failed,item.pending,"",
+                              item.killed ? "Job is canceled by external request" : "");
+    return rest_state;
+  };
+ private:
+  std::list<std::string> states_;
+};
+
+// Produces list of jobs taken from JobOwnerIndex portion by portion while
+// being sent. Output is same as rendering of <jobs><job><id/><state/></job>...</jobs>
+// but whole list is never kept in memory. Because size is not known in advance
+// HTTP response is sent with chunked encoding.
+class RESTJobsPayload: public Arc::PayloadStreamInterface {
+ public:
+  static const unsigned int PortionSize = 1024;
+
+  RESTJobsPayload(JobOwnerIndex& owners, std::string const& dn, std::string const& after,
+                  unsigned int limit, std::list<std::string> const& states, ResponseFormat format):
+      owners_(owners), dn_(dn), cursor_(after), limit_(limit), filter_(states), with_state_(!states.empty()),
+      format_(format), started_(false), finished_(false), first_(true), single_(false), buffer_pos_(0), pos_(0) {
+    // With limit whole page is taken at once to know if there are more jobs.
+    // Otherwise first portion is needed to choose JSON rendering of single job.
+    more_ = owners_.List(dn_, cursor_, (limit_ > 0) ? limit_ : PortionSize, &filter_, items_);
+    single_ = (items_.size() == 1) && ((limit_ > 0) || !more_);
+    if(!items_.empty()) last_ = items_.back().id;
+  };
+  virtual ~RESTJobsPayload(void) {};
+
+  /// Identifier to continue listing after if limit was reached.
+  std::string Next(void) const { return ((limit_ > 0) && more_) ? last_ : ""; };
+
+  virtual bool Get(char* buf,int& size) {
+    while(buffer_pos_ >= buffer_.length()) {
+      if(!Fill()) { size = 0; return false; };
+    };
+    std::string::size_type l = buffer_.length() - buffer_pos_;
+    if(l > (std::string::size_type)size) l = size;
+    memcpy(buf, buffer_.c_str() + buffer_pos_, l);
+    buffer_pos_ += l;
+    pos_ += l;
+    size = l;
+    return true;
+  };
+  virtual bool Put(const char* /* buf */,Size_t /* size */) { return false; };
+  virtual operator bool(void) { return true; };
+  virtual bool operator!(void) { return false; };
+  virtual int Timeout(void) const { return 0; };
+  virtual void Timeout(int /* to */) { };
+  virtual Size_t Pos(void) const { return pos_; };
+  virtual Size_t Size(void) const { return 0; };
+  virtual Size_t Limit(void) const { return 0; };
+
+ private:
+  JobOwnerIndex& owners_;
+  std::string dn_;
+  std::string cursor_;
+  unsigned int limit_;
+  RESTJobsFilter filter_;
+  bool with_state_;
+  ResponseFormat format_;
+  bool started_;
+  bool finished_;
+  bool first_;
+  bool single_;
+  bool more_;
+  std::string last_;
+  std::list<JobOwnerIndex::Item> items_;
+  std::string buffer_;
+  std::string::size_type buffer_pos_;
+  Size_t pos_;
+
+  // Renders next portion of output. Returns false at end of output.
+  bool Fill(void) {
+    if(finished_) return false;
+    buffer_.resize(0);
+    buffer_pos_ = 0;
+    if(items_.empty() && more_ && (limit_ == 0)) {
+      more_ = owners_.List(dn_, cursor_, PortionSize, &filter_, items_);
+    };
+    if(!started_) {
+      started_ = true;
+      if(format_ == ResponseFormatHtml) {
+        buffer_ += "<HTML><HEAD>jobs</HEAD><BODY>";
+        if(!items_.empty()) buffer_ += "<table border=\"1\">";
+      } else if(format_ == ResponseFormatXml) {
+        buffer_ += items_.empty() ? "<jobs/>" : "<jobs>";
+      } else if(format_ == ResponseFormatJson) {
+        if(!items_.empty()) buffer_ += single_ ? "{\"job\":" : "{\"job\":[";
+      };
+      if(items_.empty()) {
+        if(format_ == ResponseFormatHtml) buffer_ += "</BODY></HTML>";
+        finished_ = true;
+      };
+      return true;
+    };
+    if(items_.empty()) {
+      if(format_ == ResponseFormatHtml) {
+        buffer_ += "</table></BODY></HTML>";
+      } else if(format_ == ResponseFormatXml) {
+        buffer_ += "</jobs>";
+      } else if(format_ == ResponseFormatJson) {
+        buffer_ += single_ ? "}" : "]}";
+      };
+      finished_ = true;
+      return true;
+    };
+    for(std::list<JobOwnerIndex::Item>::iterator item = items_.begin(); item != items_.end(); ++item) {
+      XMLNode jobXml("<job/>");
+      jobXml.NewChild("id") = item->id;
+      if(with_state_) jobXml.NewChild("state") = RESTJobsFilter::State(*item);
+      if(format_ == ResponseFormatHtml) {
+        buffer_ += "<tr><td>job</td><td>";
+        RenderToHtml(jobXml, buffer_, 1);
+        buffer_ += "</td></tr>";
+      } else if(format_ == ResponseFormatXml) {
+        std::string jobStr;
+        RenderToXml(jobXml, jobStr);
+        buffer_ += jobStr;
+      } else if(format_ == ResponseFormatJson) {
+        if(!first_) buffer_ += ",";
+        RenderToJson(jobXml, buffer_, 1);
+      };
+      first_ = false;
+    };
+    cursor_ = items_.back().id;
+    items_.clear();
+    return true;
+  };
+};
+
+// Relative reference to next page of jobs list for Link header.
+static std::string NextJobsLink(std::string const& after, unsigned int limit, std::string const& states) {
+  std::string link = "<?after=" + Arc::uri_encode(after, true) + "&limit=" + Arc::tostring(limit);
+  if(!states.empty()) link += "&state=" + Arc::uri_encode(states, true);
+  link += ">; rel=\"next\"";
+  return link;
+}
+
 Arc::MCC_Status ARexRest::processJobs(Arc::Message& inmsg,Arc::Message& outmsg,ProcessingContext& context) {
-  // GET <base URL>/jobs[?state=<state1[,state2[...]]>]
+  // GET <base URL>/jobs[?state=<state1[,state2[...]]>][&limit=<number>][&after=<job id>]
+  //   Jobs are listed ordered by id. If limit is reached Link header points to next page.
   // HEAD - supported.
   // POST <base URL>/jobs?action=new initiates creation of a new job instance or multiple jobs.
   // POST <base URL>/jobs?action={info|status|kill|clean|restart|delegations} - job management operations supporting arrays of jobs.
@@ -908,9 +1114,41 @@ Arc::MCC_Status ARexRest::processJobs(Arc::Message& inmsg,Arc::Message& outmsg,P
   if((context.method == "GET") || (context.method == "HEAD")) {
     std::list<std::string> states;
     tokenize(context["state"], states, ",");
+    std::string after = context["after"];
+    unsigned int limit = 0;
+    if(!context["limit"].empty()) {
+      if((!Arc::stringto(context["limit"], limit)) || (limit == 0))
+        return HTTPFault(inmsg,outmsg,400,"Wrong limit");
+    }
+    JobOwnerIndex* owners = config->GmConfig().GetJobOwnerIndex();
+    if(owners && owners->Ready()) {
+      ResponseFormat outFormat = ProcessAcceptedFormat(inmsg,outmsg);
+      RESTJobsPayload* payload = new RESTJobsPayload(*owners, config->GridName(), after, limit, states, outFormat);
+      std::string next = payload->Next();
+      if(!next.empty()) outmsg.Attributes()->set("HTTP:link", NextJobsLink(next, limit, context["state"]));
+      if(context.method == "HEAD") {
+        std::string respStr;
+        std::string portion;
+        while(static_cast<Arc::PayloadStreamInterface*>(payload)->Get(portion)) respStr += portion;
+        delete payload;
+        Arc::PayloadRaw* outpayload = new Arc::PayloadRaw();
+        if(outpayload) outpayload->Truncate(respStr.length());
+        delete outmsg.Payload(outpayload);
+      } else {
+        delete outmsg.Payload(payload);
+      }
+      outmsg.Attributes()->set("HTTP:CODE","200");
+      outmsg.Attributes()->set("HTTP:REASON","OK");
+      return Arc::MCC_Status(Arc::STATUS_OK);
+    }
+    // Index is not available yet - scanning control directory
     XMLNode listXml("<jobs/>");
     std::list<std::string> ids = ARexJob::Jobs(*config,logger_);
+    ids.sort();
+    unsigned int listed = 0;
+    std::string last;
     for(std::list<std::string>::iterator itId = ids.begin(); itId != ids.end(); ++itId) {
+      if((!after.empty()) && (*itId <= after)) continue;
       std::string rest_state;
       if(!states.empty()) {
         ARexJob job(*itId,*config,logger_);
@@ -930,10 +1168,16 @@ Arc::MCC_Status ARexRest::processJobs(Arc::Message& inmsg,Arc::Message& outmsg,P
         }
         if(!state_found) continue;
       } // states filter
+      if((limit > 0) && (listed >= limit)) {
+        outmsg.Attributes()->set("HTTP:link", NextJobsLink(last, limit, context["state"]));
+        break;
+      }
       XMLNode jobXml = listXml.NewChild("job");
       jobXml.NewChild("id") = *itId;
       if(!rest_state.empty())
         jobXml.NewChild("state") = rest_state;
+      ++listed;
+      last = *itId;
     }
     return HTTPResponse(inmsg, outmsg, listXml);
   } else if(context.method == "POST") {
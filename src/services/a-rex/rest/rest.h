@@ -6,6 +6,7 @@
 #include <arc/Logger.h>
 #include <arc/ArcConfig.h>
 #include "../grid-manager/conf/GMConfig.h"
+#include "info_cache.h"
 
 namespace ARex {
 
@@ -16,6 +17,13 @@ namespace ARex {
     virtual ~ARexRest(void);
     Arc::MCC_Status process(Arc::Message& inmsg,Arc::Message& outmsg);
 
+    /// Renders new information document into all served representations.
+    /** To be called by information collector after every cycle. */
+    void UpdateInfo(std::string const& infoStr);
+
+    /// Pre-rendered information document.
+    InfoDocumentCache& InfoCache(void) { return info_cache_; };
+
    private:
     class ProcessingContext {
      public:
@@ -34,6 +42,7 @@ namespace ARex {
     ARex::GMConfig& config_;
     ARex::DelegationStores& delegation_stores_;
     unsigned int& all_jobs_count_;
+    InfoDocumentCache info_cache_;
 
     Arc::MCC_Status processVersions(Arc::Message& inmsg,Arc::Message& outmsg,ProcessingContext& context);
 
@@ -42,6 +51,7 @@ namespace ARex {
     Arc::MCC_Status processInfo(Arc::Message& inmsg,Arc::Message& outmsg,ProcessingContext& context);
     Arc::MCC_Status processJobs(Arc::Message& inmsg,Arc::Message& outmsg,ProcessingContext& context);
     Arc::MCC_Status processDelegations(Arc::Message& inmsg,Arc::Message& outmsg,ProcessingContext& context);
+    Arc::MCC_Status processMetrics(Arc::Message& inmsg,Arc::Message& outmsg,ProcessingContext& context);
 
     Arc::MCC_Status processDelegation(Arc::Message& inmsg,Arc::Message& outmsg,ProcessingContext& context,
                         std::string const & id);
@@ -0,0 +1,113 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <unistd.h>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <arc/message/MessageAttributes.h>
+#include <arc/message/PayloadRaw.h>
+
+#include "../info_cache.h"
+
+using namespace ARex;
+
+class InfoDocumentCacheTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(InfoDocumentCacheTest);
+  CPPUNIT_TEST(TestRespond);
+  CPPUNIT_TEST(TestUnchanged);
+  CPPUNIT_TEST(TestChanged);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void TestRespond();
+  void TestUnchanged();
+  void TestChanged();
+
+private:
+  static void Assign(InfoDocumentCache& cache, const std::string& content);
+  // Sends GET with optional conditional headers and returns HTTP code.
+  static std::string Request(InfoDocumentCache& cache, const std::string& ifNoneMatch,
+                             const std::string& ifModifiedSince,
+                             std::string& etag, std::string& modified);
+};
+
+void InfoDocumentCacheTest::Assign(InfoDocumentCache& cache, const std::string& content) {
+  InfoDocumentCache::Representations representations;
+  representations["xml"] = std::make_pair(std::string("application/xml"), content);
+  cache.Assign(representations);
+}
+
+std::string InfoDocumentCacheTest::Request(InfoDocumentCache& cache, const std::string& ifNoneMatch,
+                                           const std::string& ifModifiedSince,
+                                           std::string& etag, std::string& modified) {
+  Arc::Message inmsg;
+  Arc::Message outmsg;
+  inmsg.Attributes()->set("HTTP:METHOD", "GET");
+  if (!ifNoneMatch.empty()) inmsg.Attributes()->set("HTTP:if-none-match", ifNoneMatch);
+  if (!ifModifiedSince.empty()) inmsg.Attributes()->set("HTTP:if-modified-since", ifModifiedSince);
+  CPPUNIT_ASSERT(cache.Respond("xml", inmsg, outmsg));
+  delete outmsg.Payload(NULL);
+  etag = outmsg.Attributes()->get("HTTP:etag");
+  modified = outmsg.Attributes()->get("HTTP:last-modified");
+  return outmsg.Attributes()->get("HTTP:CODE");
+}
+
+void InfoDocumentCacheTest::TestRespond() {
+  InfoDocumentCache cache;
+  CPPUNIT_ASSERT(!cache.Valid());
+  Assign(cache, "<info/>");
+  CPPUNIT_ASSERT(cache.Valid());
+  Arc::Message inmsg;
+  Arc::Message outmsg;
+  CPPUNIT_ASSERT(!cache.Respond("json", inmsg, outmsg));
+  std::string etag;
+  std::string modified;
+  CPPUNIT_ASSERT_EQUAL(std::string("200"), Request(cache, "", "", etag, modified));
+  CPPUNIT_ASSERT(!etag.empty());
+  CPPUNIT_ASSERT(!modified.empty());
+  std::string etag2;
+  std::string modified2;
+  CPPUNIT_ASSERT_EQUAL(std::string("304"), Request(cache, etag, "", etag2, modified2));
+  CPPUNIT_ASSERT_EQUAL(std::string("304"), Request(cache, "", modified, etag2, modified2));
+  CPPUNIT_ASSERT_EQUAL(std::string("200"), Request(cache, "\"other\"", "", etag2, modified2));
+}
+
+void InfoDocumentCacheTest::TestUnchanged() {
+  InfoDocumentCache cache;
+  Assign(cache, "<info/>");
+  std::string etag;
+  std::string modified;
+  CPPUNIT_ASSERT_EQUAL(std::string("200"), Request(cache, "", "", etag, modified));
+  // Same document generated in next cycle is still not modified
+  sleep(1);
+  Assign(cache, "<info/>");
+  CPPUNIT_ASSERT_EQUAL(2U, cache.Version());
+  std::string etag2;
+  std::string modified2;
+  CPPUNIT_ASSERT_EQUAL(std::string("304"), Request(cache, "", modified, etag2, modified2));
+  CPPUNIT_ASSERT_EQUAL(modified, modified2);
+  CPPUNIT_ASSERT_EQUAL(std::string("304"), Request(cache, etag, "", etag2, modified2));
+  CPPUNIT_ASSERT_EQUAL(etag, etag2);
+}
+
+void InfoDocumentCacheTest::TestChanged() {
+  InfoDocumentCache cache;
+  Assign(cache, "<info/>");
+  std::string etag;
+  std::string modified;
+  CPPUNIT_ASSERT_EQUAL(std::string("200"), Request(cache, "", "", etag, modified));
+  // Changed document gets new time even within same second
+  Assign(cache, "<info><changed/></info>");
+  std::string etag2;
+  std::string modified2;
+  CPPUNIT_ASSERT_EQUAL(std::string("200"), Request(cache, "", modified, etag2, modified2));
+  CPPUNIT_ASSERT(modified != modified2);
+  CPPUNIT_ASSERT(etag != etag2);
+  CPPUNIT_ASSERT_EQUAL(std::string("200"), Request(cache, etag, "", etag2, modified2));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(InfoDocumentCacheTest);
@@ -2,6 +2,7 @@
 #include <config.h>
 #endif
 
+#include <set>
 #include <sys/stat.h>
 
 #include <arc/message/MessageAttributes.h>
@@ -118,6 +119,11 @@ namespace DataStaging {
       }
     }
     if (current_processes > 0) --current_processes;
+
+    // wake up queries waiting for changes
+    Glib::Mutex::Lock lock(finished_lock);
+    ++finished_count;
+    finished_cond.broadcast();
   }
 
   /*
@@ -329,14 +335,17 @@ namespace DataStaging {
    <DataDeliveryQuery>
      <DTR>
        <ID>id</ID>
+       <BytesTransferred>1234</BytesTransferred>
      </DTR>
      <DTR>
      ...
+     <Wait>10</Wait>
    </DataDeliveryQuery>
 
    Returns:
    <DataDeliveryQueryResponse>
      <DataDeliveryQueryResult>
+       <Changes>true</Changes>
        <Result>
          <ID>id</ID>
          <ReturnCode>ERROR</ReturnCode>
@@ -351,37 +360,53 @@ namespace DataStaging {
        ...
      </DataDeliveryQueryResult>
    </DataDeliveryQueryResponse>
+
+   Wait and BytesTransferred are optional. If Wait is present the reply is
+   delayed until any of the DTRs finishes or Wait seconds pass, and DTRs
+   which are still transferring are only reported if BytesTransferred
+   differs and then without Log. Changes in reply tells that this was done.
    */
   Arc::MCC_Status DataDeliveryService::Query(Arc::XMLNode in, Arc::XMLNode out) {
 
+    Arc::XMLNode query = in["DataDeliveryQuery"];
     Arc::XMLNode resp = out.NewChild("DataDeliveryQueryResponse");
     Arc::XMLNode results = resp.NewChild("DataDeliveryQueryResult");
 
+    bool changes = (bool)query["Wait"];
+    if (changes) {
+      int wait = 0;
+      Arc::stringto((std::string)query["Wait"], wait);
+      if (wait > MaxQueryWait) wait = MaxQueryWait;
+      if (wait > 0) WaitForChange(query, wait);
+      results.NewChild("Changes") = "true";
+    }
+
+    active_dtrs_lock.lock();
+    // Index active DTRs once instead of searching for every DTR in query
+    std::map<std::string, std::map<DTR_ptr, sstream_ptr>::iterator> active_ids;
+    for (std::map<DTR_ptr, sstream_ptr>::iterator i = active_dtrs.begin(); i != active_dtrs.end(); ++i) {
+      active_ids[i->first->get_id()] = i;
+    }
+
     for(int n = 0;;++n) {
-      Arc::XMLNode dtrnode = in["DataDeliveryQuery"]["DTR"][n];
+      Arc::XMLNode dtrnode = query["DTR"][n];
 
       if (!dtrnode) break;
 
       std::string dtrid((std::string)dtrnode["ID"]);
 
-      Arc::XMLNode resultelement = results.NewChild("Result");
-      resultelement.NewChild("ID") = dtrid;
-
-      active_dtrs_lock.lock();
-      std::map<DTR_ptr, sstream_ptr>::iterator dtr_it = active_dtrs.begin();
-      for (; dtr_it != active_dtrs.end(); ++dtr_it) {
-        if (dtr_it->first->get_id() == dtrid) break;
-      }
+      std::map<std::string, std::map<DTR_ptr, sstream_ptr>::iterator>::iterator id_it = active_ids.find(dtrid);
 
-      if (dtr_it == active_dtrs.end()) {
-        active_dtrs_lock.unlock();
+      if (id_it == active_ids.end()) {
+        Arc::XMLNode resultelement = results.NewChild("Result");
+        resultelement.NewChild("ID") = dtrid;
 
         // if not in active list, look in archived list
         archived_dtrs_lock.lock();
         std::map<std::string, std::pair<std::string, std::string> >::const_iterator arc_it = archived_dtrs.find(dtrid);
         if (arc_it != archived_dtrs.end()) {
-          resultelement.NewChild("ResultCode") = archived_dtrs[dtrid].first;
-          resultelement.NewChild("ErrorDescription") = archived_dtrs[dtrid].second;
+          resultelement.NewChild("ResultCode") = arc_it->second.first;
+          resultelement.NewChild("ErrorDescription") = arc_it->second.second;
           archived_dtrs_lock.unlock();
           continue;
         }
@@ -393,7 +418,24 @@ namespace DataStaging {
         continue;
       }
 
+      std::map<DTR_ptr, sstream_ptr>::iterator dtr_it = id_it->second;
       DTR_ptr dtr = dtr_it->first;
+
+      if (!dtr->error() && dtr->get_status() != DTRStatus::TRANSFERRED) {
+        if (changes && dtrnode["BytesTransferred"] &&
+            (std::string)dtrnode["BytesTransferred"] == Arc::tostring(dtr->get_bytes_transferred())) continue;
+        logger.msg(Arc::VERBOSE, "DTR %s still in progress (%lluB transferred)",
+                   dtrid, dtr->get_bytes_transferred());
+        Arc::XMLNode resultelement = results.NewChild("Result");
+        resultelement.NewChild("ID") = dtrid;
+        if (!changes) resultelement.NewChild("Log") = dtr_it->second->str();
+        resultelement.NewChild("BytesTransferred") = Arc::tostring(dtr->get_bytes_transferred());
+        resultelement.NewChild("ResultCode") = "TRANSFERRING";
+        continue;
+      }
+
+      Arc::XMLNode resultelement = results.NewChild("Result");
+      resultelement.NewChild("ID") = dtrid;
       resultelement.NewChild("Log") = dtr_it->second->str();
       resultelement.NewChild("BytesTransferred") = Arc::tostring(dtr->get_bytes_transferred());
 
@@ -408,7 +450,7 @@ namespace DataStaging {
         archived_dtrs[dtrid] = std::pair<std::string, std::string>("TRANSFER_ERROR", dtr->get_error_status().GetDesc());
         archived_dtrs_lock.unlock();
       }
-      else if (dtr->get_status() == DTRStatus::TRANSFERRED) {
+      else {
         logger.msg(Arc::INFO, "DTR %s finished successfully", dtrid);
         resultelement.NewChild("ResultCode") = "TRANSFERRED";
         resultelement.NewChild("TransferTime") = Arc::tostring(dtr->get_transfer_time());
@@ -418,21 +460,50 @@ namespace DataStaging {
         archived_dtrs[dtrid] = std::pair<std::string, std::string>("TRANSFERRED", "");
         archived_dtrs_lock.unlock();
       }
-      else {
-        logger.msg(Arc::VERBOSE, "DTR %s still in progress (%lluB transferred)",
-                   dtrid, dtr->get_bytes_transferred());
-        resultelement.NewChild("ResultCode") = "TRANSFERRING";
-        active_dtrs_lock.unlock();
-        return Arc::MCC_Status(Arc::STATUS_OK);
-      }
       // Terminal state
-      //delete dtr_it->second;
+      active_ids.erase(id_it);
       active_dtrs.erase(dtr_it);
-      active_dtrs_lock.unlock();
     }
+    active_dtrs_lock.unlock();
     return Arc::MCC_Status(Arc::STATUS_OK);
   }
 
+  bool DataDeliveryService::QueryFinished(Arc::XMLNode query) {
+    std::set<std::string> ids;
+    for (Arc::XMLNode dtrnode = query["DTR"]; dtrnode; ++dtrnode) {
+      ids.insert((std::string)dtrnode["ID"]);
+    }
+    active_dtrs_lock.lock();
+    unsigned int found = 0;
+    for (std::map<DTR_ptr, sstream_ptr>::iterator i = active_dtrs.begin(); i != active_dtrs.end(); ++i) {
+      if (ids.find(i->first->get_id()) == ids.end()) continue;
+      ++found;
+      if (i->first->error() || i->first->get_status() == DTRStatus::TRANSFERRED) {
+        active_dtrs_lock.unlock();
+        return true;
+      }
+    }
+    active_dtrs_lock.unlock();
+    // DTRs which are not active any more must be reported immediately
+    return (found < ids.size());
+  }
+
+  void DataDeliveryService::WaitForChange(Arc::XMLNode query, int wait) {
+    Glib::TimeVal etime;
+    etime.assign_current_time();
+    etime.add_seconds(wait);
+    for (;;) {
+      finished_lock.lock();
+      unsigned int seen = finished_count;
+      finished_lock.unlock();
+      if (QueryFinished(query)) return;
+      Glib::Mutex::Lock lock(finished_lock);
+      while (finished_count == seen) {
+        if (!finished_cond.timed_wait(finished_lock, etime)) return;
+      }
+    }
+  }
+
   /*
    Accepts:
    <DataDeliveryCancel>
@@ -555,7 +626,8 @@ namespace DataStaging {
   DataDeliveryService::DataDeliveryService(Arc::Config *cfg, Arc::PluginArgument* parg)
     : Service(cfg,parg),
       max_processes(100),
-      current_processes(0) {
+      current_processes(0),
+      finished_count(0) {
 
     valid = false;
     // Set medium format for logging
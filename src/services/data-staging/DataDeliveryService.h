@@ -36,9 +36,17 @@ namespace DataStaging {
    * deleted. This archived list is also kept in memory. In case a transfer is
    * never queried, a separate thread moves any transfers which completed more
    * than one hour ago to the archived list.
+   *
+   * A query may cover many DTRs. If it contains Wait the reply is delayed
+   * until one of the DTRs finishes or Wait seconds pass, and only DTRs
+   * whose state differs from what the client reported are included. Such
+   * replies are marked with Changes so the client knows that missing DTRs
+   * are still transferring.
    */
   class DataDeliveryService: public Arc::Service, DTRCallback {
 
+    friend class DataDeliveryServiceTest;
+
     /// Managed pointer to stringstream used to hold log output
     typedef Arc::ThreadedPointer<std::stringstream> sstream_ptr;
 
@@ -62,6 +70,12 @@ namespace DataStaging {
     std::map<std::string, std::pair<std::string, std::string> > archived_dtrs;
     /// Lock for archive DTRs list
     Arc::SimpleCondition archived_dtrs_lock;
+    /// Number of DTRs which finished transfer, used to wake up waiting queries
+    unsigned int finished_count;
+    /// Lock for finished_count
+    Glib::Mutex finished_lock;
+    /// Signalled when finished_count changes
+    Glib::Cond finished_cond;
     /// Object to manage Delivery processes
     DataDelivery delivery;
     /// Container for delegated credentials
@@ -73,6 +87,8 @@ namespace DataStaging {
     std::list<Arc::LogDestination*> root_destinations;
     /// Logger object
     static Arc::Logger logger;
+    /// Longest time in seconds a query is allowed to wait for changes
+    static const int MaxQueryWait = 30;
 
     /// Log a message to root destinations
     void LogToRootLogger(Arc::LogLevel level, const std::string& message);
@@ -93,6 +109,12 @@ namespace DataStaging {
     /// Query status of transfer
     Arc::MCC_Status Query(Arc::XMLNode in, Arc::XMLNode out);
 
+    /// Returns true if any of DTRs in query finished or is not active
+    bool QueryFinished(Arc::XMLNode query);
+
+    /// Wait up to wait seconds until any of DTRs in query finishes
+    void WaitForChange(Arc::XMLNode query, int wait);
+
     /// Cancel a transfer
     Arc::MCC_Status Cancel(Arc::XMLNode in, Arc::XMLNode out);
 
@@ -0,0 +1,246 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <arc/ArcConfig.h>
+#include <arc/DateTime.h>
+#include <arc/StringConv.h>
+#include <arc/Thread.h>
+#include <arc/User.h>
+#include <arc/UserConfig.h>
+#include <arc/message/MessageAttributes.h>
+#include <arc/message/PayloadSOAP.h>
+
+#include "../DataDeliveryService.h"
+
+namespace DataStaging {
+
+  // Gives test access to transfers held by service. Transfers are added
+  // directly because starting them needs delegation and helper processes.
+  class DataDeliveryServiceTest {
+  public:
+    static void AddActive(DataDeliveryService& service, DTR_ptr dtr) {
+      service.active_dtrs_lock.lock();
+      service.active_dtrs[dtr] = DataDeliveryService::sstream_ptr(new std::stringstream);
+      service.active_dtrs_lock.unlock();
+    }
+    static unsigned int Active(DataDeliveryService& service) {
+      service.active_dtrs_lock.lock();
+      unsigned int size = service.active_dtrs.size();
+      service.active_dtrs_lock.unlock();
+      return size;
+    }
+  };
+
+} // namespace DataStaging
+
+using namespace DataStaging;
+
+class QueryTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(QueryTest);
+  CPPUNIT_TEST(TestQuery);
+  CPPUNIT_TEST(TestQueryWait);
+  CPPUNIT_TEST(TestQueryWaitFinished);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void TestQuery();
+  void TestQueryWait();
+  void TestQueryWaitFinished();
+  void setUp();
+  void tearDown();
+
+private:
+  std::list<DTRLogDestination> logs;
+  Arc::UserConfig usercfg;
+  Arc::Config* cfg;
+  DataDeliveryService* service;
+  DTR_ptr MakeDTR(const std::string& name, unsigned long long int transferred);
+  // Sends query for DTRs with their transferred bytes. Negative wait means
+  // no Wait element. Result of query is placed into response.
+  void Query(const std::map<std::string, unsigned long long int>& dtrs, int wait, Arc::XMLNode& response);
+  static Arc::XMLNode FindResult(Arc::XMLNode results, const std::string& id);
+  static int CountResults(Arc::XMLNode results);
+  static void Finish(void* arg);
+};
+
+struct FinishArg {
+  DataDeliveryService* service;
+  DTR_ptr dtr;
+};
+
+void QueryTest::setUp() {
+  cfg = new Arc::Config(Arc::XMLNode(
+    "<Service name=\"datadeliveryservice\" id=\"datadeliveryservice\">"
+     "<SecHandler><PDP><Policy><Rule><Subjects>"
+      "<Subject>127.0.0.1</Subject>"
+     "</Subjects></Rule></Policy></PDP></SecHandler>"
+     "<AllowedDir>/</AllowedDir>"
+    "</Service>"));
+  service = new DataDeliveryService(cfg, NULL);
+  CPPUNIT_ASSERT(*service);
+}
+
+void QueryTest::tearDown() {
+  delete service;
+  delete cfg;
+}
+
+DTR_ptr QueryTest::MakeDTR(const std::string& name, unsigned long long int transferred) {
+  DTR_ptr dtr(new DTR("mock://mocksrc/"+name, "mock://mockdest/"+name, usercfg,
+                      "123456789", Arc::User().get_uid(), logs, "DataStagingTest"));
+  CPPUNIT_ASSERT(*dtr);
+  dtr->set_status(DTRStatus::TRANSFERRING);
+  dtr->set_bytes_transferred(transferred);
+  DataDeliveryServiceTest::AddActive(*service, dtr);
+  return dtr;
+}
+
+void QueryTest::Query(const std::map<std::string, unsigned long long int>& dtrs, int wait, Arc::XMLNode& response) {
+  Arc::NS ns;
+  Arc::PayloadSOAP request(ns);
+  Arc::XMLNode op = request.NewChild("DataDeliveryQuery");
+  for (std::map<std::string, unsigned long long int>::const_iterator d = dtrs.begin(); d != dtrs.end(); ++d) {
+    Arc::XMLNode dtrnode = op.NewChild("DTR");
+    dtrnode.NewChild("ID") = d->first;
+    dtrnode.NewChild("BytesTransferred") = Arc::tostring(d->second);
+  }
+  if (wait >= 0) op.NewChild("Wait") = Arc::tostring(wait);
+
+  Arc::Message inmsg;
+  Arc::Message outmsg;
+  inmsg.Payload(&request);
+  inmsg.Attributes()->set("HTTP:METHOD", "POST");
+  CPPUNIT_ASSERT(service->process(inmsg, outmsg));
+  inmsg.Payload(NULL);
+  Arc::PayloadSOAP* outpayload = dynamic_cast<Arc::PayloadSOAP*>(outmsg.Payload());
+  CPPUNIT_ASSERT(outpayload);
+  CPPUNIT_ASSERT(!outpayload->IsFault());
+  (*outpayload)["DataDeliveryQueryResponse"]["DataDeliveryQueryResult"].New(response);
+  delete outpayload;
+  CPPUNIT_ASSERT(response);
+}
+
+Arc::XMLNode QueryTest::FindResult(Arc::XMLNode results, const std::string& id) {
+  for (Arc::XMLNode result = results["Result"]; result; ++result) {
+    if ((std::string)result["ID"] == id) return result;
+  }
+  return Arc::XMLNode();
+}
+
+int QueryTest::CountResults(Arc::XMLNode results) {
+  int n = 0;
+  for (Arc::XMLNode result = results["Result"]; result; ++result) ++n;
+  return n;
+}
+
+void QueryTest::Finish(void* arg) {
+  FinishArg* finish = (FinishArg*)arg;
+  sleep(1);
+  finish->dtr->set_status(DTRStatus::TRANSFERRED);
+  finish->service->receiveDTR(finish->dtr);
+}
+
+void QueryTest::TestQuery() {
+  DTR_ptr running = MakeDTR("1", 100);
+  DTR_ptr done = MakeDTR("2", 200);
+  done->set_status(DTRStatus::TRANSFERRED);
+
+  // Without Wait every DTR is reported, with full log
+  std::map<std::string, unsigned long long int> dtrs;
+  dtrs[running->get_id()] = 100;
+  dtrs[done->get_id()] = 0;
+  dtrs["unknown"] = 0;
+  Arc::XMLNode results;
+  Query(dtrs, -1, results);
+  CPPUNIT_ASSERT(!results["Changes"]);
+  CPPUNIT_ASSERT_EQUAL(3, CountResults(results));
+
+  Arc::XMLNode result = FindResult(results, running->get_id());
+  CPPUNIT_ASSERT_EQUAL(std::string("TRANSFERRING"), (std::string)result["ResultCode"]);
+  CPPUNIT_ASSERT_EQUAL(std::string("100"), (std::string)result["BytesTransferred"]);
+  CPPUNIT_ASSERT(result["Log"]);
+  result = FindResult(results, done->get_id());
+  CPPUNIT_ASSERT_EQUAL(std::string("TRANSFERRED"), (std::string)result["ResultCode"]);
+  CPPUNIT_ASSERT_EQUAL(std::string("200"), (std::string)result["BytesTransferred"]);
+  result = FindResult(results, "unknown");
+  CPPUNIT_ASSERT_EQUAL(std::string("SERVICE_ERROR"), (std::string)result["ResultCode"]);
+
+  // Finished DTR is archived after being reported
+  CPPUNIT_ASSERT_EQUAL(1U, DataDeliveryServiceTest::Active(*service));
+  dtrs.erase("unknown");
+  Query(dtrs, -1, results);
+  CPPUNIT_ASSERT_EQUAL(2, CountResults(results));
+  result = FindResult(results, done->get_id());
+  CPPUNIT_ASSERT_EQUAL(std::string("TRANSFERRED"), (std::string)result["ResultCode"]);
+  CPPUNIT_ASSERT(!result["Log"]);
+}
+
+void QueryTest::TestQueryWait() {
+  DTR_ptr same = MakeDTR("1", 100);
+  DTR_ptr progressed = MakeDTR("2", 200);
+
+  // Only DTRs which changed are reported and without log
+  std::map<std::string, unsigned long long int> dtrs;
+  dtrs[same->get_id()] = 100;
+  dtrs[progressed->get_id()] = 150;
+  Arc::XMLNode results;
+  Query(dtrs, 0, results);
+  CPPUNIT_ASSERT(results["Changes"]);
+  CPPUNIT_ASSERT_EQUAL(1, CountResults(results));
+  Arc::XMLNode result = FindResult(results, progressed->get_id());
+  CPPUNIT_ASSERT_EQUAL(std::string("TRANSFERRING"), (std::string)result["ResultCode"]);
+  CPPUNIT_ASSERT_EQUAL(std::string("200"), (std::string)result["BytesTransferred"]);
+  CPPUNIT_ASSERT(!result["Log"]);
+
+  // Nothing finishes so reply comes after Wait seconds and is empty
+  dtrs[progressed->get_id()] = 200;
+  Arc::Time start;
+  Query(dtrs, 2, results);
+  Arc::Period elapsed(Arc::Time() - start);
+  CPPUNIT_ASSERT(elapsed.GetPeriod() >= 1);
+  CPPUNIT_ASSERT(elapsed.GetPeriod() <= 4);
+  CPPUNIT_ASSERT(results["Changes"]);
+  CPPUNIT_ASSERT_EQUAL(0, CountResults(results));
+
+  // DTR which is not active any more is reported without waiting
+  dtrs["unknown"] = 0;
+  start = Arc::Time();
+  Query(dtrs, 10, results);
+  CPPUNIT_ASSERT((Arc::Time() - start).GetPeriod() <= 2);
+  CPPUNIT_ASSERT_EQUAL(1, CountResults(results));
+  CPPUNIT_ASSERT_EQUAL(std::string("SERVICE_ERROR"), (std::string)FindResult(results, "unknown")["ResultCode"]);
+}
+
+void QueryTest::TestQueryWaitFinished() {
+  DTR_ptr running = MakeDTR("1", 100);
+  DTR_ptr finishing = MakeDTR("2", 200);
+
+  // Waiting query is woken up as soon as one of DTRs finishes
+  FinishArg finish;
+  finish.service = service;
+  finish.dtr = finishing;
+  Arc::SimpleCounter threads;
+  CPPUNIT_ASSERT(Arc::CreateThreadFunction(&Finish, &finish, &threads));
+
+  std::map<std::string, unsigned long long int> dtrs;
+  dtrs[running->get_id()] = 100;
+  dtrs[finishing->get_id()] = 200;
+  Arc::XMLNode results;
+  Arc::Time start;
+  Query(dtrs, 20, results);
+  threads.wait();
+  CPPUNIT_ASSERT((Arc::Time() - start).GetPeriod() < 10);
+  CPPUNIT_ASSERT(results["Changes"]);
+  CPPUNIT_ASSERT_EQUAL(1, CountResults(results));
+  Arc::XMLNode result = FindResult(results, finishing->get_id());
+  CPPUNIT_ASSERT_EQUAL(std::string("TRANSFERRED"), (std::string)result["ResultCode"]);
+  CPPUNIT_ASSERT(result["Log"]);
+  CPPUNIT_ASSERT_EQUAL(1U, DataDeliveryServiceTest::Active(*service));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(QueryTest);
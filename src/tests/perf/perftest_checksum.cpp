@@ -0,0 +1,108 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// perftest_checksum.cpp
+
+// Measures throughput of every checksum algorithm supported by
+// Arc::CheckSumAny. Additionally it compares computing all checksums
+// in one pass over memory (the way DataBuffer feeds them in slices) to
+// computing them one after another.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <string>
+
+#include <glibmm/timer.h>
+
+#include <arc/CheckSum.h>
+
+static const char* const types[] = { "cksum", "md5", "adler32", "crc32c", "sha256" };
+static const unsigned int types_num = sizeof(types)/sizeof(types[0]);
+static const unsigned long long int slice = 65536;
+
+static double mbps(unsigned long long int bytes, double seconds) {
+  if (seconds <= 0) return 0;
+  return ((double)bytes) / seconds / (1024.0*1024.0);
+}
+
+int main(int argc, char* argv[]) {
+  if ((argc < 2) || (argc > 3)) {
+    std::cerr << "Wrong number of arguments!" << std::endl
+              << std::endl
+              << "Usage:" << std::endl
+              << "perftest_checksum size [iterations]" << std::endl
+              << std::endl
+              << "Arguments:" << std::endl
+              << "size        Size of data in MiB processed per iteration, e.g. 256." << std::endl
+              << "iterations  Number of iterations to average over. Default is 4." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  unsigned long long int size = atoi(argv[1]);
+  if (size == 0) size = 1;
+  size *= 1024*1024;
+  int iterations = (argc > 2) ? atoi(argv[2]) : 4;
+  if (iterations < 1) iterations = 1;
+
+  unsigned char* data = (unsigned char*)malloc(size);
+  if (!data) {
+    std::cerr << "Failed to allocate " << size << " bytes" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  srand(1);
+  for (unsigned long long int n = 0; n < size; ++n) data[n] = (unsigned char)rand();
+  unsigned long long int total = size * iterations;
+
+  std::cout << "========================================" << std::endl;
+  std::cout << "Data size: " << (size / (1024*1024)) << " MiB" << std::endl;
+  std::cout << "Number of iterations: " << iterations << std::endl;
+
+  // Each algorithm separately
+  double sequential_time = 0;
+  for (unsigned int t = 0; t < types_num; ++t) {
+    Arc::CheckSumAny sum(types[t]);
+    Glib::TimeVal tBefore;
+    tBefore.assign_current_time();
+    for (int i = 0; i < iterations; ++i) {
+      sum.start();
+      sum.add(data, size);
+      sum.end();
+    }
+    Glib::TimeVal tAfter;
+    tAfter.assign_current_time();
+    double t_sum = tAfter.as_double() - tBefore.as_double();
+    sequential_time += t_sum;
+    char result[256];
+    sum.print(result, sizeof(result));
+    std::cout << types[t] << ": " << mbps(total, t_sum) << " MB/s (" << result << ")" << std::endl;
+  }
+
+  // All algorithms in one pass over data
+  std::list<Arc::CheckSum*> sums;
+  for (unsigned int t = 0; t < types_num; ++t) sums.push_back(new Arc::CheckSumAny(types[t]));
+  Glib::TimeVal tBefore;
+  tBefore.assign_current_time();
+  for (int i = 0; i < iterations; ++i) {
+    for (std::list<Arc::CheckSum*>::iterator s = sums.begin(); s != sums.end(); ++s) (*s)->start();
+    for (unsigned long long int p = 0; p < size; p += slice) {
+      unsigned long long int l = size - p;
+      if (l > slice) l = slice;
+      for (std::list<Arc::CheckSum*>::iterator s = sums.begin(); s != sums.end(); ++s) (*s)->add(data + p, l);
+    }
+    for (std::list<Arc::CheckSum*>::iterator s = sums.begin(); s != sums.end(); ++s) (*s)->end();
+  }
+  Glib::TimeVal tAfter;
+  tAfter.assign_current_time();
+  double onepass_time = tAfter.as_double() - tBefore.as_double();
+  for (std::list<Arc::CheckSum*>::iterator s = sums.begin(); s != sums.end(); ++s) delete *s;
+  free(data);
+
+  std::cout << "All checksums one after another: " << sequential_time << " s" << std::endl;
+  std::cout << "All checksums in one pass:       " << onepass_time << " s" << std::endl;
+  if (onepass_time > 0)
+    std::cout << "Speedup: " << sequential_time / onepass_time << std::endl;
+  std::cout << "========================================" << std::endl;
+  return 0;
+}
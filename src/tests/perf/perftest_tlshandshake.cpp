@@ -0,0 +1,172 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// perftest_tlshandshake.cpp
+// Measures rate of new TLS connections to HTTPS service with full
+// and with resumed handshakes.
+
+#include <iostream>
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+#include <glibmm/thread.h>
+#include <glibmm/timer.h>
+
+#include <arc/ArcConfig.h>
+#include <arc/Logger.h>
+#include <arc/URL.h>
+#include <arc/message/MCC.h>
+#include <arc/message/PayloadRaw.h>
+#include <arc/communication/ClientInterface.h>
+
+// Some global shared variables...
+Glib::Mutex* mutex;
+bool run;
+int finishedThreads;
+bool resumption;
+unsigned long completedConnections;
+unsigned long failedConnections;
+std::string url_str;
+std::string cert_file;
+std::string key_file;
+std::string ca_dir;
+
+// Make new connection and send one request over it for every iteration.
+// Request is needed because with TLSv1.3 session is delivered to client
+// after handshake.
+void connectRepeatedly(){
+  unsigned long completedConnections = 0;
+  unsigned long failedConnections = 0;
+
+  Arc::URL url(url_str);
+  Arc::MCCConfig mcc_cfg;
+  if(!key_file.empty()) mcc_cfg.AddPrivateKey(key_file);
+  if(!cert_file.empty()) mcc_cfg.AddCertificate(cert_file);
+  if(!ca_dir.empty()) mcc_cfg.AddCADir(ca_dir);
+
+  while(run){
+    Arc::ClientHTTP client(mcc_cfg,url,60);
+    Arc::XMLNode chain = client.GetConfig()["Chain"];
+    for(Arc::XMLNode comp = chain["Component"]; (bool)comp; ++comp) {
+      if((std::string)(comp.Attribute("name")) == "tls.client") {
+        comp.NewChild("SessionResumption") = resumption?"true":"false";
+      };
+    };
+    Arc::PayloadRaw req;
+    Arc::PayloadRawInterface* resp = NULL;
+    Arc::HTTPClientInfo info;
+    Arc::MCC_Status status = client.process("GET",&req,&info,&resp);
+    if(!status) {
+      failedConnections++;
+    } else {
+      completedConnections++;
+    }
+    if(resp) delete resp;
+  }
+
+  // Update global variables.
+  Glib::Mutex::Lock lock(*mutex);
+  ::completedConnections+=completedConnections;
+  ::failedConnections+=failedConnections;
+  finishedThreads++;
+}
+
+double runTest(int numberOfThreads, int duration){
+  Glib::Thread** threads = new Glib::Thread*[numberOfThreads];
+  completedConnections = 0;
+  failedConnections = 0;
+  finishedThreads = 0;
+  run = true;
+  Glib::TimeVal tBefore;
+  tBefore.assign_current_time();
+  for (int i=0; i<numberOfThreads; i++)
+    threads[i]=Glib::Thread::create(sigc::ptr_fun(connectRepeatedly),true);
+  Glib::usleep(duration*1000000);
+  run = false;
+  for (int i=0; i<numberOfThreads; i++)
+    threads[i]->join();
+  Glib::TimeVal tAfter;
+  tAfter.assign_current_time();
+  delete[] threads;
+  double seconds = tAfter.as_double()-tBefore.as_double();
+  if(seconds <= 0) return 0;
+  return completedConnections/seconds;
+}
+
+int main(int argc, char* argv[]){
+  int debug_level = -1;
+  Arc::LogStream logcerr(std::cerr);
+
+  // Process options - quick hack, must use Glib options later
+  while(argc >= 5) {
+    if(strcmp(argv[1],"-d") == 0) {
+      debug_level=Arc::istring_to_level(argv[2]);
+      argv[2]=argv[0]; argv+=2; argc-=2;
+    } else if(strcmp(argv[1],"-C") == 0) {
+      cert_file=argv[2];
+      argv[2]=argv[0]; argv+=2; argc-=2;
+    } else if(strcmp(argv[1],"-K") == 0) {
+      key_file=argv[2];
+      argv[2]=argv[0]; argv+=2; argc-=2;
+    } else if(strcmp(argv[1],"-A") == 0) {
+      ca_dir=argv[2];
+      argv[2]=argv[0]; argv+=2; argc-=2;
+    } else {
+      break;
+    };
+  }
+  if(debug_level >= 0) {
+    Arc::Logger::getRootLogger().setThreshold((Arc::LogLevel)debug_level);
+    Arc::Logger::getRootLogger().addDestination(logcerr);
+  }
+  // Extract command line arguments.
+  if (argc!=4){
+    std::cerr << "Wrong number of arguments!" << std::endl
+              << std::endl
+              << "Usage:" << std::endl
+              << "perftest_tlshandshake [-d debug] [-C cert] [-K key] [-A cadir] url threads duration" << std::endl
+              << std::endl
+              << "Arguments:" << std::endl
+              << "url       The https url of the service." << std::endl
+              << "threads   The number of concurrent connecting clients." << std::endl
+              << "duration  The duration of every test in seconds." << std::endl
+              << "-d debug  The textual representation of desired debug level. Available " << std::endl
+              << "          levels: DEBUG, VERBOSE, INFO, WARNING, ERROR, FATAL." << std::endl
+              << "-C cert   Client certificate or proxy." << std::endl
+              << "-K key    Client private key." << std::endl
+              << "-A cadir  Directory with CA certificates." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  url_str = std::string(argv[1]);
+  int numberOfThreads = atoi(argv[2]);
+  int duration = atoi(argv[3]);
+  if(key_file.empty()) key_file = cert_file;
+
+  // Start threads.
+  mutex=new Glib::Mutex;
+
+  resumption = false;
+  double fullRate = runTest(numberOfThreads, duration);
+  unsigned long fullFailed = failedConnections;
+  resumption = true;
+  double resumedRate = runTest(numberOfThreads, duration);
+  unsigned long resumedFailed = failedConnections;
+
+  std::cout << "========================================" << std::endl;
+  std::cout << "URL: " << url_str << std::endl;
+  std::cout << "Number of threads: " << numberOfThreads << std::endl;
+  std::cout << "Duration of every test: " << duration << " s" << std::endl;
+  std::cout << "Full handshakes: " << fullRate << " connections/s, "
+            << fullFailed << " failed" << std::endl;
+  std::cout << "Resumed handshakes: " << resumedRate << " connections/s, "
+            << resumedFailed << " failed" << std::endl;
+  if(fullRate > 0)
+    std::cout << "Speedup: " << resumedRate/fullRate << std::endl;
+  std::cout << "========================================" << std::endl;
+
+  delete mutex;
+  return 0;
+}
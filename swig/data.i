@@ -100,6 +100,9 @@
 #include <arc/data/DataBuffer.h>
 %}
 %ignore Arc::DataBuffer::operator[](int);
+%ignore Arc::DataBuffer::offer_direct;
+%ignore Arc::DataBuffer::take_direct;
+%ignore Arc::DataBuffer::tune;
 #ifdef SWIGPYTHON
 %{
 namespace Arc {